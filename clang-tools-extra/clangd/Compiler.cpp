@@ -60,6 +60,9 @@ buildCompilerInvocation(const ParseInputs &Inputs, clang::DiagnosticConsumer &D,
   CI->getFrontendOpts().DisableFree = false;
   CI->getLangOpts()->CommentOpts.ParseAllComments = true;
   CI->getLangOpts()->RetainCommentsFromSystemHeaders = true;
+  // Each reparse of a file checks the bounds declarations of all of its
+  // Checked C functions again; reuse the diagnostics of the unchanged ones.
+  CI->getLangOpts()->CheckedCReuseBoundsChecks = true;
   // Disable "clang -verify" diagnostics, they are rarely useful in clangd, and
   // our compiler invocation set-up doesn't seem to work with it (leading
   // assertions in VerifyDiagnosticConsumer).
@@ -54,6 +54,9 @@ struct ParseInputs {
   const SymbolIndex *Index = nullptr;
   ParseOptions Opts = ParseOptions();
   TidyProviderRef ClangTidyProvider = {};
+  // Shared by the parses of the same file, so that they can reuse the Checked
+  // C bounds checking diagnostics of the functions that did not change.
+  std::shared_ptr<BoundsCheckReuseCache> BoundsCheckReuse = nullptr;
 };
 
 /// Builds compiler invocation that could be used to build AST or preamble.
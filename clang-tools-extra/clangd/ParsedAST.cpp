@@ -274,6 +274,7 @@ ParsedAST::build(llvm::StringRef Filename, const ParseInputs &Inputs,
       ASTDiags);
   if (!Clang)
     return None;
+  Clang->setBoundsCheckReuseCache(Inputs.BoundsCheckReuse);
 
   auto Action = std::make_unique<ClangdFrontendAction>();
   const FrontendInputFile &MainInput = Clang->getFrontendOpts().Inputs[0];
@@ -61,6 +61,7 @@
 #include "support/Threading.h"
 #include "support/Trace.h"
 #include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Sema/BoundsCheckReuseCache.h"
 #include "clang/Tooling/CompilationDatabase.h"
 #include "llvm/ADT/FunctionExtras.h"
 #include "llvm/ADT/None.h"
@@ -492,6 +493,10 @@ private:
   /// Writes and reads from unknown threads are locked. Reads from the worker
   /// thread are not locked, as it's the only writer.
   ParseInputs FileInputs; /* GUARDED_BY(Mutex) */
+  /// The Checked C bounds checking diagnostics of the previous ASTs of the
+  /// file, which the next AST reuses for the functions that did not change.
+  const std::shared_ptr<BoundsCheckReuseCache> BoundsCheckReuse =
+      std::make_shared<BoundsCheckReuseCache>();
   /// Times of recent AST rebuilds, used for UpdateDebounce computation.
   llvm::SmallVector<DebouncePolicy::clock::duration>
       RebuildTimes; /* GUARDED_BY(Mutex) */
@@ -639,6 +644,8 @@ void ASTWorker::update(ParseInputs Inputs, WantDiagnostics WantDiags,
       RanASTCallback = false;
     }
 
+    Inputs.BoundsCheckReuse = BoundsCheckReuse;
+
     // Update current inputs so that subsequent reads can see them.
     {
       std::lock_guard<std::mutex> Lock(Mutex);
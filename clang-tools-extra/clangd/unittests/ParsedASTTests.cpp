@@ -31,6 +31,7 @@
 #include "clang/Basic/TokenKinds.h"
 #include "clang/Lex/PPCallbacks.h"
 #include "clang/Lex/Token.h"
+#include "clang/Sema/BoundsCheckReuseCache.h"
 #include "clang/Tooling/Syntax/Tokens.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
@@ -44,8 +45,11 @@ namespace clangd {
 namespace {
 
 using ::testing::AllOf;
+using ::testing::Contains;
 using ::testing::ElementsAre;
 using ::testing::ElementsAreArray;
+using ::testing::HasSubstr;
+using ::testing::Not;
 
 MATCHER_P(DeclNamed, Name, "") {
   if (NamedDecl *ND = dyn_cast<NamedDecl>(arg))
@@ -636,6 +640,94 @@ TEST(ParsedASTTest, PatchesDeletedIncludes) {
                 testPath("foo.cpp"))));
 }
 
+// The ranges and messages of the diagnostics of AST and of their notes.
+std::vector<std::string> diagnosticsOf(const ParsedAST &AST) {
+  std::vector<std::string> Result;
+  for (const Diag &D : AST.getDiagnostics()) {
+    Result.push_back(llvm::to_string(D.Range) + " " + D.Message);
+    for (const Note &N : D.Notes)
+      Result.push_back(llvm::to_string(N.Range) + " " + N.Message);
+  }
+  return Result;
+}
+
+const char *BoundsCheckReuseCode = R"c(
+  int n;
+  _Array_ptr<int> g : count(n);
+
+  int get(int i) {
+    return g[i];
+  }
+
+  void f(_Array_ptr<int> p : count(len), int len, int m) {
+    _Array_ptr<int> q : count(m) = p;
+  }
+)c";
+
+const char *BoundsWarning = "cannot prove declared bounds for 'q'";
+
+TEST(ParsedASTTest, ReusesCheckedCBoundsDiagnostics) {
+  TestTU TU = TestTU::withCode(BoundsCheckReuseCode);
+  TU.Filename = "reuse.c";
+  TU.BoundsCheckReuse = std::make_shared<BoundsCheckReuseCache>();
+  auto First = TU.build();
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumHits(), 0u);
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumMisses(), 2u);
+  EXPECT_THAT(diagnosticsOf(First), Contains(HasSubstr(BoundsWarning)));
+
+  // Neither function is checked again, and their diagnostics are the same.
+  auto Second = TU.build();
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumHits(), 2u);
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumMisses(), 2u);
+  EXPECT_THAT(diagnosticsOf(Second), ElementsAreArray(diagnosticsOf(First)));
+}
+
+TEST(ParsedASTTest, ChangedDependencyInvalidatesCheckedCBoundsDiagnostics) {
+  TestTU TU = TestTU::withCode(BoundsCheckReuseCode);
+  TU.Filename = "reuse.c";
+  TU.BoundsCheckReuse = std::make_shared<BoundsCheckReuseCache>();
+  auto First = TU.build();
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumMisses(), 2u);
+
+  // The text of get is the same, but it uses g, whose bounds changed. f does
+  // not depend on g.
+  std::string Code = BoundsCheckReuseCode;
+  Code.replace(Code.find("count(n)"), strlen("count(n)"), "count(n + 1)");
+  TU.Code = Code;
+  auto Second = TU.build();
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumHits(), 1u);
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumMisses(), 3u);
+  EXPECT_THAT(diagnosticsOf(Second), Contains(HasSubstr(BoundsWarning)));
+}
+
+TEST(ParsedASTTest, ChangedOptionsInvalidateCheckedCBoundsDiagnostics) {
+  TestTU TU = TestTU::withCode(BoundsCheckReuseCode);
+  TU.Filename = "reuse.c";
+  TU.BoundsCheckReuse = std::make_shared<BoundsCheckReuseCache>();
+  auto First = TU.build();
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumMisses(), 2u);
+
+  // The warning was not disabled when the cached diagnostics were recorded.
+  TU.ExtraArgs = {"-Wno-check-bounds-decls-unchecked-scope"};
+  auto NoWarning = TU.build();
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumHits(), 0u);
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumMisses(), 4u);
+  EXPECT_THAT(diagnosticsOf(NoWarning),
+              Not(Contains(HasSubstr(BoundsWarning))));
+
+  // A warning that is enabled again must not be missing either.
+  TU.ExtraArgs = {};
+  auto Warning = TU.build();
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumHits(), 2u);
+  EXPECT_THAT(diagnosticsOf(Warning), ElementsAreArray(diagnosticsOf(First)));
+
+  // The options that change checking are part of the key as well.
+  TU.ExtraArgs = {"-fcheckedc-bounds-proof-budget=5"};
+  TU.build();
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumHits(), 2u);
+  EXPECT_EQ(TU.BoundsCheckReuse->getNumMisses(), 6u);
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
@@ -62,6 +62,7 @@ ParseInputs TestTU::inputs(MockFS &FS) const {
   if (ClangTidyProvider)
     Inputs.ClangTidyProvider = ClangTidyProvider;
   Inputs.Index = ExternalIndex;
+  Inputs.BoundsCheckReuse = BoundsCheckReuse;
   return Inputs;
 }
 
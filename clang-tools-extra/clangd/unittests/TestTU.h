@@ -60,6 +60,8 @@ struct TestTU {
   std::vector<std::string> ExtraArgs;
 
   TidyProvider ClangTidyProvider = {};
+  // The cache of Checked C bounds checking diagnostics to reuse, if any.
+  std::shared_ptr<BoundsCheckReuseCache> BoundsCheckReuse = nullptr;
   // Index to use when building AST.
   const SymbolIndex *ExternalIndex = nullptr;
 
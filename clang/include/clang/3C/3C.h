@@ -15,12 +15,15 @@
 #ifndef LLVM_CLANG_3C_3C_H
 #define LLVM_CLANG_3C_3C_H
 
+#include "clang/3C/3CGlobalOptions.h"
 #include "clang/3C/3CInteractiveData.h"
 #include "clang/3C/ConstraintVariables.h"
 #include "clang/3C/PersistentSourceLoc.h"
 #include "clang/3C/ProgramInfo.h"
+#include "clang/3C/SolutionFile.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include <mutex>
+#include <shared_mutex>
 
 // Options used to initialize 3C tool.
 //
@@ -33,11 +36,18 @@ struct _3COptions {
 
   std::string OutputPostfix;
   std::string OutputDir;
+  std::string OutputPatch;
 
   std::string ConstraintOutputJson;
 
   bool DumpStats;
 
+  // Print the memory used by the constraint variables in dumpStats.
+  bool DumpMemoryStats;
+
+  // Print the statistics of the constraint graphs in dumpStats.
+  bool DumpConstraintGraphStats;
+
   std::string StatsOutputJson;
 
   std::string WildPtrInfoJson;
@@ -72,6 +82,27 @@ struct _3COptions {
   bool AllowUnwritableChanges;
 
   bool AllowRewriteFailures;
+
+  // The number of threads used to parse the source files. 0 means one thread
+  // per hardware thread.
+  unsigned ParseThreads;
+
+  // Parse each source file only with the first of its compile commands,
+  // rather than once for each of them.
+  bool FirstCompileCommandOnly;
+
+  // The number of threads used to solve the independent components of the
+  // constraint graphs. 0 means one thread per hardware thread.
+  unsigned SolveThreads;
+
+  // 3C summaries of earlier runs to load, and the file to write the summary
+  // of this run to after solving, if not empty (see ProgramInfo::loadSummary).
+  std::vector<std::string> SummaryFiles;
+  std::string SummaryOutput;
+
+  // The file to write the binary solution file to after solving, if not
+  // empty (see SolutionFile.h).
+  std::string SolutionOutput;
 };
 
 // The main interface exposed by the 3C to interact with the tool.
@@ -82,8 +113,12 @@ class _3CInterface {
 
 public:
   ProgramInfo GlobalProgramInfo;
-  // Mutex for this interface.
-  std::mutex InterfaceMutex;
+  // Mutex for this interface. The queries that only read the solved
+  // constraints (getRootCauses, getPtrsAffectedByRootCause,
+  // getRootCausesInFile and getRootCauseConstraint) hold it shared, so they
+  // can run concurrently with each other; every stage and every change to the
+  // constraints holds it exclusively.
+  std::shared_timed_mutex InterfaceMutex;
 
   // If the parameters are invalid, this function prints an error message to
   // stderr and returns null.
@@ -120,6 +155,30 @@ public:
   // Get all the WILD pointers and corresponding reason why they became WILD.
   ConstraintsInfo &getWildPtrsInfo();
 
+  // Get the root causes of the pointer with key PtrKey, the pointers made
+  // WILD by the root cause RootKey, or the root causes of the pointers
+  // declared in FileName. Unlike getWildPtrsInfo, these are computed on
+  // demand for the requested pointer or file, and remembered until the
+  // constraints change.
+  CVars getRootCauses(ConstraintKey PtrKey);
+  CVars getPtrsAffectedByRootCause(ConstraintKey RootKey);
+  CVars getRootCausesInFile(const std::string &FileName);
+
+  // Get the constraint that makes the root cause RootKey WILD, which holds
+  // the reason and the source location of the root cause, or null if RootKey
+  // is not a root cause.
+  const Constraint *getRootCauseConstraint(ConstraintKey RootKey);
+
+  // Get the pointers of the source files that are WILD now but were not WILD
+  // in Baseline, the solution file of an earlier run (see
+  // SolutionFile::findNewWildPtrs).
+  std::vector<SolutionFile::NewWildPtr>
+  findNewWildPtrs(const SolutionFile &Baseline);
+
+  // Compute the WILD pointer information returned by getWildPtrsInfo, which
+  // solveConstraints only computes when root cause warnings are enabled.
+  void computeWildPtrsInfo();
+
   // Given a constraint key make the corresponding constraint var
   // to be non-WILD.
   bool makeSinglePtrNonWild(ConstraintKey TargetPtr);
@@ -135,6 +194,14 @@ public:
   // to disk
   bool writeAllConvertedFilesToDisk();
 
+  // Rewrite only the files in FileNames against the current solution and
+  // store their new contents in NewContents, keyed by canonical path, without
+  // writing anything to disk. Only the translation units that contain these
+  // files are traversed. Returns false if a file is not part of any
+  // translation unit.
+  bool previewConvertedFiles(const std::vector<std::string> &FileNames,
+                             std::map<std::string, std::string> &NewContents);
+
   // Dump all stats related to performance.
   bool dumpStats();
 
@@ -148,22 +215,47 @@ private:
                const std::vector<std::string> &SourceFileList,
                clang::tooling::CompilationDatabase *CompDB);
 
+  // The options of this conversion, which its entry points make the options
+  // of the current thread.
+  _3CGlobalOptions Opts;
+  clang::tooling::CommandLineArguments SourceFiles;
+  clang::tooling::CompilationDatabase *CompDB;
+  // The database that CompDB points to with -first-compile-command-only.
+  std::unique_ptr<clang::tooling::CompilationDatabase> FirstCommandCompDB;
+
   bool ConstructionFailed = false;
   bool DeterminedExitCode = false;
 
   bool HadNonDiagnosticError = false;
 
+  // The root cause queries remember their answers in ProgramInfo, so queries
+  // that share InterfaceMutex still take this to update the memos one at a
+  // time.
+  std::mutex QueryCacheMutex;
+
   // Determine whether 3C can continue to the next stage of processing. Checks
   // HadNonDiagnosticError and error diagnostics but ignores diagnostic
   // verification.
   bool isSuccessfulSoFar();
 
   // saved ASTs
+  //
+  // Every stage walks every translation unit, so the ASTs stay resident
+  // until 3C exits. They cannot be dropped after constraint building:
+  // solving runs the bounds inference and IntermediateToolHook visitors over
+  // the ASTs, rewriting needs the source managers and Decls, and
+  // determineExitCode finishes diagnostic verification through the
+  // diagnostic clients of the ASTs. ProgramInfo also looks up constraint
+  // variables through Decl and Expr pointers, with expression keys that
+  // depend on the ASTContext, so an AST cannot be reparsed in a later stage
+  // and still map to the same constraint variables.
   std::vector<std::unique_ptr<ASTUnit>> ASTs;
 
   // Are constraints already built?
   bool ConstraintsBuilt;
-  void invalidateAllConstraintsWithReason(Constraint *ConstraintToRemove);
+  // Returns true if the only edges removed from the checked graph are edges
+  // from WILD.
+  bool invalidateAllConstraintsWithReason(Constraint *ConstraintToRemove);
 };
 
 #endif // LLVM_CLANG_3C_3C_H
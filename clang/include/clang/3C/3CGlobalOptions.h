@@ -13,30 +13,83 @@
 #ifndef LLVM_CLANG_3C_3CGLOBALOPTIONS_H
 #define LLVM_CLANG_3C_3CGLOBALOPTIONS_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/CommandLine.h"
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
 
-extern bool Verbose;
-extern bool DumpIntermediate;
-extern std::string OutputPostfix;
-extern std::string OutputDir;
-extern bool HandleVARARGS;
-extern bool SeperateMultipleFuncDecls;
-extern bool EnablePropThruIType;
-extern bool ConsiderAllocUnsafe;
-extern bool AllTypes;
-extern bool NewSolver;
-extern std::string BaseDir;
-extern std::vector<std::string> AllocatorFunctions;
-extern bool AddCheckedRegions;
-extern bool WarnRootCause;
-extern bool WarnAllRootCause;
-extern bool DumpUnwritableChanges;
-extern bool AllowUnwritableChanges;
-extern bool AllowRewriteFailures;
+// The options of a 3C conversion. Each _3CInterface owns its options and
+// makes them the current options of the threads that work on its conversion
+// (see _3COptionsScope), so several conversions with different options can
+// run concurrently in one process.
+//
+// See clang/docs/checkedc/3C/clang-tidy.md#_3c-name-prefix
+// NOLINTNEXTLINE(readability-identifier-naming)
+struct _3CGlobalOptions {
+  bool Verbose = false;
+  bool DumpIntermediate = false;
+  std::string OutputPostfix = "-";
+  std::string OutputDir;
+  std::string OutputPatch;
+  std::string ConstraintOutputJson;
+  bool DumpStats = false;
+  bool DumpMemoryStats = false;
+  bool DumpConstraintGraphStats = false;
+  std::string StatsOutputJson;
+  std::string WildPtrInfoJson;
+  std::string PerWildPtrInfoJson;
+  bool HandleVARARGS = false;
+  bool EnablePropThruIType = false;
+  bool AllTypes = false;
+  // The canonical path of the base directory.
+  std::string BaseDir;
+  std::vector<std::string> AllocatorFunctions;
+  bool AddCheckedRegions = false;
+  bool EnableCCTypeChecker = false;
+  bool WarnRootCause = false;
+  bool WarnAllRootCause = false;
+  bool DumpUnwritableChanges = false;
+  bool AllowUnwritableChanges = false;
+  bool AllowRewriteFailures = false;
+  unsigned ParseThreads = 1;
+  unsigned SolveThreads = 1;
+  std::string SummaryOutput;
+  std::string SolutionOutput;
 
 #ifdef FIVE_C
-extern bool RemoveItypes;
-extern bool ForceItypes;
+  bool RemoveItypes = false;
+  bool ForceItypes = false;
 #endif
 
+  // The canonical paths of the source files of the conversion.
+  std::set<std::string> FilePaths;
+
+  // Whether canWrite holds for each interned file name of a
+  // PersistentSourceLoc, keyed by the storage of the name. FilePaths and
+  // BaseDir must not change once it is used.
+  mutable std::mutex CanWriteMutex;
+  mutable llvm::DenseMap<const char *, bool> CanWriteCache;
+};
+
+// Get the options of the conversion that is running on the current thread,
+// or the default options if there is none.
+const _3CGlobalOptions &get3COptions();
+
+// Makes Opts the options of the current thread until the scope ends. Every
+// entry point of _3CInterface opens one, and so must the bodies of the tasks
+// that a conversion runs on other threads.
+//
+// See clang/docs/checkedc/3C/clang-tidy.md#_3c-name-prefix
+// NOLINTNEXTLINE(readability-identifier-naming)
+class _3COptionsScope {
+public:
+  explicit _3COptionsScope(const _3CGlobalOptions &Opts);
+  ~_3COptionsScope();
+
+private:
+  const _3CGlobalOptions *Saved;
+};
+
 #endif // LLVM_CLANG_3C_3CGLOBALOPTIONS_H
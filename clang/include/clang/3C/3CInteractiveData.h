@@ -82,7 +82,7 @@ private:
 
   float getPtrAffectedScore(const std::set<ConstraintVariable *> CVs);
 
-  void printConstraintStats(raw_ostream &O, Constraints &CS,
+  void printConstraintStats(llvm::json::OStream &J, Constraints &CS,
                             ConstraintKey Cause);
 };
 
@@ -11,6 +11,7 @@
 #ifndef LLVM_CLANG_3C_3CSTATS_H
 #define LLVM_CLANG_3C_3CSTATS_H
 
+#include "clang/3C/Constraints.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Decl.h"
 #include "clang/AST/RecursiveASTVisitor.h"
@@ -35,6 +36,9 @@ public:
   unsigned long NumCheckedRegions;
   unsigned long NumUnCheckedRegions;
 
+  // Solver Stats
+  SolverComponentStats SolverComponents;
+
   PerformanceStats() {
     CompileTime = ConstraintBuilderTime = 0;
     ConstraintSolverTime = ArrayBoundsInferenceTime = 0;
@@ -42,7 +42,6 @@ protected:
 
 protected:
   ABounds(BoundsKind K) : Kind(K) {}
-  void addBoundsUsedKey(BoundsKey);
   // Get the variable name of the the given bounds key that corresponds
   // to the given declaration.
   static std::string getBoundsKeyStr(BoundsKey, AVarBoundsInfo *,
@@ -56,20 +55,13 @@ public:
   virtual BoundsKey getBKey() = 0;
   virtual ABounds *makeCopy(BoundsKey NK) = 0;
 
-  // Set that maintains all the bound keys that are used inin
-  // TODO: Is this still needed?
-  static std::set<BoundsKey> KeysUsedInBounds;
-  static bool isKeyUsedInBounds(BoundsKey ToCheck);
-
   static ABounds *getBoundsInfo(AVarBoundsInfo *AVBInfo, BoundsExpr *BExpr,
                                 const ASTContext &C);
 };
 
 class CountBound : public ABounds {
 public:
-  CountBound(BoundsKey Var) : ABounds(CountBoundKind), CountVar(Var) {
-    addBoundsUsedKey(Var);
-  }
+  CountBound(BoundsKey Var) : ABounds(CountBoundKind), CountVar(Var) {}
 
   virtual ~CountBound() {}
 
@@ -104,9 +96,7 @@ public:
 
 class ByteBound : public ABounds {
 public:
-  ByteBound(BoundsKey Var) : ABounds(ByteBoundKind), ByteVar(Var) {
-    addBoundsUsedKey(Var);
-  }
+  ByteBound(BoundsKey Var) : ABounds(ByteBoundKind), ByteVar(Var) {}
 
   virtual ~ByteBound() {}
 
@@ -126,10 +116,8 @@ private:
 
 class RangeBound : public ABounds {
 public:
-  RangeBound(BoundsKey L, BoundsKey R) : ABounds(RangeBoundKind), LB(L), UB(R) {
-    addBoundsUsedKey(L);
-    addBoundsUsedKey(R);
-  }
+  RangeBound(BoundsKey L, BoundsKey R)
+      : ABounds(RangeBoundKind), LB(L), UB(R) {}
 
   virtual ~RangeBound() {}
 
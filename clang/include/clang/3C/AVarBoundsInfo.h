@@ -44,6 +44,9 @@ public:
   // These are bounds key having bounds, but unfortunately cannot be handled
   // by our inference.
   std::set<BoundsKey> DeclaredButNotHandled;
+  // Number of context-sensitive bounds keys created for call sites and
+  // struct member accesses.
+  unsigned NumCtxSensKeys;
   AVarBoundsStats() { clear(); }
   ~AVarBoundsStats() { clear(); }
 
@@ -77,6 +80,7 @@ private:
     DataflowMatch.clear();
     DeclaredBounds.clear();
     DeclaredButNotHandled.clear();
+    NumCtxSensKeys = 0;
   }
 };
 
@@ -146,7 +150,7 @@ private:
   // Potential Bounds for each bounds key inferred for the current iteration.
   std::map<BoundsKey, BndsKindMap> CurrIterInferBounds;
   // BoundsKey that failed the flow inference.
-  std::set<BoundsKey> BKsFailedFlowInference;
+  BoundsKeySet BKsFailedFlowInference;
 };
 
 // Class that maintains information about potential bounds for
@@ -298,8 +302,8 @@ private:
 
   // Variable that is used to generate new bound keys.
   BoundsKey BCount;
-  // Map of VarKeys and corresponding program variables.
-  std::map<BoundsKey, ProgramVar *> PVarInfo;
+  // The program variable of each VarKey, indexed by the key, or null.
+  std::vector<ProgramVar *> PVarInfo;
   // Map of APSInt (constants) and a BoundKey that correspond to it.
   std::map<uint64_t, BoundsKey> ConstVarKeys;
   // Map of BoundsKey and corresponding prioritized bounds information.
@@ -310,7 +314,7 @@ private:
   std::set<BoundsKey> InvalidBounds;
   // These are the bounds key of the pointers that has arithmetic operations
   // performed on them.
-  std::set<BoundsKey> ArrPointersWithArithmetic;
+  BoundsKeySet ArrPointersWithArithmetic;
   // Set of BoundsKeys that correspond to pointers.
   std::set<BoundsKey> PointerBoundsKey;
   // Set of BoundsKey that correspond to array pointers.
@@ -319,7 +323,7 @@ private:
   // These are array and nt arr pointers which cannot have bounds.
   // E.g., return value of strdup and in general any return value
   // which is an nt array.
-  std::set<BoundsKey> PointersWithImpossibleBounds;
+  BoundsKeySet PointersWithImpossibleBounds;
   // Set of BoundsKey that correspond to array pointers with in the program
   // being compiled i.e., it does not include array pointers that belong
   // to libraries.
@@ -16,28 +16,16 @@
 #include "clang/3C/RewriteUtils.h"
 #include "clang/AST/RecursiveASTVisitor.h"
 
-// Locates expressions which are children of explicit cast expressions after
-// ignoring any intermediate implicit expressions introduced in the clang AST.
-class CastLocatorVisitor : public RecursiveASTVisitor<CastLocatorVisitor> {
-public:
-  // This visitor happens to not use the ASTContext itself.
-  explicit CastLocatorVisitor(ASTContext *C) {}
-
-  bool VisitCastExpr(CastExpr *C);
-
-  std::set<Expr *> &getExprsWithCast() { return ExprsWithCast; }
-
-private:
-  std::set<Expr *> ExprsWithCast;
-};
-
 class CastPlacementVisitor : public RecursiveASTVisitor<CastPlacementVisitor> {
 public:
-  explicit CastPlacementVisitor(ASTContext *C, ProgramInfo &I, Rewriter &R,
-                                std::set<Expr *> &EWC)
-      : Context(C), Info(I), Writer(R), CR(Info, Context), ABRewriter(I),
-        ExprsWithCast(EWC) {}
+  explicit CastPlacementVisitor(ASTContext *C, ProgramInfo &I, Rewriter &R)
+      : Context(C), Info(I), Writer(R), CR(Info, Context), ABRewriter(I) {}
 
+  // Locates expressions which are children of explicit cast expressions after
+  // ignoring any intermediate implicit expressions introduced in the clang
+  // AST. The traversal visits a cast before the expressions inside it, so the
+  // casts around a call are known by the time the call is visited.
+  bool VisitCastExpr(CastExpr *C);
   bool VisitCallExpr(CallExpr *C);
 
 private:
@@ -46,7 +34,7 @@ private:
   Rewriter &Writer;
   ConstraintResolver CR;
   ArrayBoundsRewriter ABRewriter;
-  std::set<Expr *> &ExprsWithCast;
+  std::set<Expr *> ExprsWithCast;
 
   // Enumeration indicating what type of cast is required at a call site.
   enum CastNeeded {
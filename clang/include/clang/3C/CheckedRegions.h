@@ -34,18 +34,31 @@ public:
       std::map<llvm::FoldingSetNodeID, AnnotationNeeded> &M, ProgramInfo &I)
       : Context(C), Writer(R), Map(M), Info(I) {}
 
-  bool VisitCompoundStmt(clang::CompoundStmt *S);
+  bool TraverseCompoundStmt(clang::CompoundStmt *S);
   bool VisitCallExpr(clang::CallExpr *C);
 
 private:
-  std::pair<const clang::CompoundStmt *, int>
-  findParentCompound(const clang::DynTypedNode &N, int);
-  bool isParentChecked(const clang::DynTypedNode &N);
+  bool isParentChecked();
   bool isWrittenChecked(const clang::CompoundStmt *);
   clang::ASTContext *Context;
   clang::Rewriter &Writer;
   std::map<llvm::FoldingSetNodeID, AnnotationNeeded> &Map;
   ProgramInfo &Info;
+  // Whether each compound statement enclosing the node being visited is
+  // checked, innermost last. Tracking this during the traversal avoids
+  // building the parent map of the ASTContext.
+  std::vector<bool> CheckedStack;
+};
+
+// The wildness of the types and functions that CheckedRegionFinder has
+// already looked at. The constraints are solved before checked regions are
+// found, so each entry is computed once and is shared by the sub-visitors
+// that CheckedRegionFinder creates for the statements of a function.
+struct WildnessSummary {
+  // Whether a canonical type contains an unchecked pointer.
+  std::map<const clang::Type *, bool> UncheckedTypes;
+  // Whether a function has a wild parameter.
+  std::map<const clang::FunctionDecl *, bool> WildParams;
 };
 
 class CheckedRegionFinder
@@ -54,11 +67,13 @@ public:
   explicit CheckedRegionFinder(
       clang::ASTContext *C, clang::Rewriter &R, ProgramInfo &I,
       std::set<llvm::FoldingSetNodeID> &S,
-      std::map<llvm::FoldingSetNodeID, AnnotationNeeded> &M, bool EmitWarnings)
-      : Context(C), Writer(R), Info(I), Seen(S), Map(M),
+      std::map<llvm::FoldingSetNodeID, AnnotationNeeded> &M,
+      WildnessSummary &WS, bool EmitWarnings)
+      : Context(C), Writer(R), Info(I), Seen(S), Map(M), Summary(WS),
         EmitWarnings(EmitWarnings) {}
   bool Wild = false;
 
+  bool TraverseFunctionDecl(clang::FunctionDecl *FD);
   bool VisitForStmt(clang::ForStmt *S);
   bool VisitSwitchStmt(clang::SwitchStmt *S);
   bool VisitIfStmt(clang::IfStmt *S);
@@ -75,9 +90,12 @@ public:
 
 private:
   void handleChildren(const clang::Stmt::child_range &Stmts);
-  void markChecked(clang::CompoundStmt *S, int LocalWild);
+  void markChecked(clang::CompoundStmt *S, clang::FunctionDecl *FD,
+                   int LocalWild);
   bool isInStatementPosition(clang::CallExpr *C);
-  bool hasUncheckedParameters(clang::CompoundStmt *S);
+  clang::FunctionDecl *getFunctionDeclOfBody(clang::CompoundStmt *S);
+  bool hasUncheckedParameters(clang::FunctionDecl *Parent);
+  bool hasWildParams(clang::FunctionDecl *FD);
   bool containsUncheckedPtr(clang::QualType Qt);
   bool containsUncheckedPtrAcc(clang::QualType Qt, std::set<std::string> &Seen);
   bool isUncheckedStruct(clang::QualType Qt, std::set<std::string> &Seen);
@@ -89,8 +107,16 @@ private:
   ProgramInfo &Info;
   std::set<llvm::FoldingSetNodeID> &Seen;
   std::map<llvm::FoldingSetNodeID, AnnotationNeeded> &Map;
+  WildnessSummary &Summary;
   std::set<PersistentSourceLoc *> Emitted;
   bool EmitWarnings;
+  // The function whose declaration is being traversed, if any.
+  clang::FunctionDecl *CurrentFunction = nullptr;
+  // If this visitor traverses a statement of a compound statement, the
+  // statement and the compound statement. This stands in for the parent map
+  // of the ASTContext, which is costly to build.
+  const clang::Stmt *StmtInCompound = nullptr;
+  const clang::CompoundStmt *ParentCompound = nullptr;
 };
 
 #endif // LLVM_CLANG_3C_CHECKEDREGIONS_H
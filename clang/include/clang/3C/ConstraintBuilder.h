@@ -15,6 +15,51 @@
 #include "clang/3C/TypeVariableAnalysis.h"
 #include "clang/AST/ASTConsumer.h"
 
+// Remembers the top-level function declarations in header files that have
+// been visited, keyed by their source location and their ODR hash, which
+// covers the body of a definition. A header included in many translation
+// units declares the same functions in each of them, and what 3C does for
+// such a declaration only depends on its source location, so the visitors
+// can skip the copies in the later translation units.
+class HeaderFunctionDeduplicator {
+public:
+  // Returns true if FD is in a header file and an earlier translation unit
+  // visited a function at the same location with the same ODR hash. Records
+  // FD otherwise.
+  bool isDuplicate(clang::FunctionDecl *FD, clang::ASTContext &C);
+
+private:
+  std::map<std::pair<PersistentSourceLoc, unsigned>, std::string> Seen;
+};
+
+// The variables that the VariableAdderConsumer adds for one translation unit,
+// found by a traversal of its AST that does not touch ProgramInfo. The
+// traversals of several translation units can therefore run in parallel,
+// while the variables are still added to ProgramInfo one translation unit at
+// a time, in the same order as by HandleTranslationUnit, so the constraint
+// variables and atoms are the same as after a serial run.
+class RecordedVariables {
+public:
+  // Traverse the AST of C. May run concurrently with the traversals of other
+  // ASTs.
+  void record(clang::ASTContext &C);
+
+private:
+  friend class VariableAdderConsumer;
+  friend class VariableRecorder;
+
+  enum EntryKind { Variable, ABoundsVariable, Typedef };
+  struct Entry {
+    EntryKind Kind;
+    clang::Decl *D;
+    PersistentSourceLoc PSL;
+    bool CanRewriteDef;
+  };
+  // The entries of each top-level declaration, in the order of the
+  // declarations.
+  std::vector<std::pair<clang::Decl *, std::vector<Entry>>> TopLevelDecls;
+};
+
 // First step in generating initial constraints is to collect functions
 // and variables the need to be analysed. This will also merge
 // function definitions together.
@@ -25,8 +70,16 @@ public:
 
   virtual void HandleTranslationUnit(clang::ASTContext &);
 
+  // Add the variables that R recorded from the AST of C.
+  void addRecordedVariables(clang::ASTContext &C, const RecordedVariables &R);
+
 private:
   ProgramInfo &Info;
+  HeaderFunctionDeduplicator HeaderFunctions;
+
+  void enterTranslationUnit(clang::ASTContext &C);
+  void exitTranslationUnit();
+  bool isDuplicateFunction(clang::Decl *D, clang::ASTContext &C);
 };
 
 // Final step in generating initial constraints is to scan type variables and
@@ -40,6 +93,7 @@ public:
 
 private:
   ProgramInfo &Info;
+  HeaderFunctionDeduplicator HeaderFunctions;
 };
 
 #endif
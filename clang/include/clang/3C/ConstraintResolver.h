@@ -65,13 +65,13 @@ private:
   ProgramInfo &Info;
   ASTContext *Context;
 
-  CVarSet handleDeref(CVarSet T);
+  CVarSet handleDeref(const CVarSet &T);
 
   CVarSet getInvalidCastPVCons(CastExpr *E);
 
   // Update a PVConstraint with one additional level of indirection
   PVConstraint *addAtom(PVConstraint *PVC, ConstAtom *NewA, Constraints &CS);
-  CVarSet addAtomAll(CVarSet CVS, ConstAtom *PtrTyp, Constraints &CS);
+  CVarSet addAtomAll(const CVarSet &CVS, ConstAtom *PtrTyp, Constraints &CS);
   CVarSet pvConstraintFromType(QualType TypE);
 
   CSetBkeyPair getAllSubExprConstraintVars(std::vector<Expr *> &Exprs);
@@ -29,6 +29,8 @@
 #include "clang/3C/ProgramVar.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/Lex/Lexer.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSwitch.h"
 
 using namespace clang;
@@ -38,8 +40,9 @@ class ProgramInfo;
 // Holds integers representing constraint variables, with semantics as
 // defined in the text above
 typedef std::set<ConstraintKey> CVars;
-// Holds Atoms, one for each of the pointer (*) declared in the program.
-typedef std::vector<Atom *> CAtoms;
+// Holds Atoms, one for each of the pointer (*) declared in the program. Most
+// pointers have one or two levels, which are stored inline.
+typedef llvm::SmallVector<Atom *, 2> CAtoms;
 
 // Base class for ConstraintVariables. A ConstraintVariable can either be a
 // PointerVariableConstraint or a FunctionVariableConstraint. The difference
@@ -55,7 +58,8 @@ private:
   ConstraintVariableKind Kind;
 
 protected:
-  std::string OriginalType;
+  // Interned (see internString).
+  llvm::StringRef OriginalType;
   // Underlying name of the C variable this ConstraintVariable represents.
   std::string Name;
   // Set of constraint variables that have been constrained due to a
@@ -63,22 +67,41 @@ protected:
   // so that later on we do not introduce a spurious constraint
   // making those variables WILD.
   std::set<ConstraintKey> ConstrainedVars;
+  // Bounds key of this Constraint Variable.
+  BoundsKey BKey;
   // A flag to indicate that we already forced argConstraints to be equated
   // Avoids infinite recursive calls.
-  bool HasEqArgumentConstraints;
+  bool HasEqArgumentConstraints : 1;
   // Flag to indicate if this Constraint Variable has a bounds key.
-  bool ValidBoundsKey;
-  // Bounds key of this Constraint Variable.
-  BoundsKey BKey;
+  bool ValidBoundsKey : 1;
   // Is this Constraint Variable for a declaration?
-  bool IsForDecl;
+  bool IsForDecl : 1;
 
   // Only subclasses should call this
-  ConstraintVariable(ConstraintVariableKind K, std::string T, std::string N)
-      : Kind(K), OriginalType(T), Name(N), HasEqArgumentConstraints(false),
-        ValidBoundsKey(false), IsForDecl(false) {}
+  ConstraintVariable(ConstraintVariableKind K, llvm::StringRef T,
+                     std::string N)
+      : Kind(K), OriginalType(internString(T)), Name(N),
+        HasEqArgumentConstraints(false), ValidBoundsKey(false),
+        IsForDecl(false) {}
+
+  // The type strings of the constraint variables repeat a lot: every copy of
+  // a variable and every variable of the same type has the same ones. They
+  // are therefore kept once, for the lifetime of 3C, and the variables only
+  // refer to them.
+  static llvm::StringRef internString(llvm::StringRef S);
+
+  // The heap memory used by S, if its characters are not stored inline.
+  static size_t getStringHeapBytes(const std::string &S);
 
 public:
+  // The number of bytes used by this constraint variable and by the
+  // containers that it owns, not counting the interned strings and the other
+  // constraint variables it refers to. Used by -dump-memory-stats.
+  virtual size_t getOwnedBytes() const = 0;
+
+  // The number of interned strings, and the bytes used to store them.
+  static void getInternedStringStats(size_t &NumStrings, size_t &Bytes);
+
   // Create a "for-rewriting" representation of this ConstraintVariable.
   // The 'emitName' parameter is true when the generated string should include
   // the name of the variable, false for just the type.
@@ -153,7 +176,7 @@ public:
   virtual void mergeDeclaration(ConstraintVariable *, ProgramInfo &,
                                 std::string &ReasonFailed) = 0;
 
-  std::string getOriginalTy() const { return OriginalType; }
+  std::string getOriginalTy() const { return OriginalType.str(); }
   // Get the original type string that can be directly
   // used for rewriting.
   std::string getRewritableOriginalTy() const;
@@ -250,29 +273,38 @@ public:
   derefPVConstraint(PointerVariableConstraint *PVC);
 
 private:
-  std::string BaseType;
+  // Interned, as are the other type strings below.
+  llvm::StringRef BaseType;
   CAtoms Vars;
-  std::vector<ConstAtom *> SrcVars;
+  llvm::SmallVector<ConstAtom *, 2> SrcVars;
   FunctionVariableConstraint *FV;
-  std::map<uint32_t, std::set<Qualification>> QualMap;
+  // The qualifiers of each pointer level, as a mask of the bits
+  // 1 << Qualification.
+  llvm::SmallVector<uint8_t, 2> QualFlags;
   enum OriginalArrType { O_Pointer, O_SizedArray, O_UnSizedArray };
   // Map from pointer idx to original type and size.
   // If the original variable U was:
   //  * A pointer, then U -> (a,b) , a = O_Pointer, b has no meaning.
   //  * A sized array, then U -> (a,b) , a = O_SizedArray, b is static size.
   //  * An unsized array, then U -(a,b) , a = O_UnSizedArray, b has no meaning.
-  std::map<uint32_t, std::pair<OriginalArrType, uint64_t>> ArrSizes;
+  typedef std::map<uint32_t, std::pair<OriginalArrType, uint64_t>> ArrSizesMap;
 
   // To help rewriting preserve macros and constant expressions in arrays size
   // expressions, the source strings for bounds of arrays are also stored.
-  std::map<uint32_t, std::string> ArrSizeStrs;
+  typedef std::map<uint32_t, std::string> ArrSizeStrsMap;
+
+  // Both maps are only filled in while the variable is constructed from its
+  // type, so the copies made by the copy constructor share them with the
+  // original. A null map is empty.
+  std::shared_ptr<const ArrSizesMap> ArrSizes;
+  std::shared_ptr<const ArrSizeStrsMap> ArrSizeStrs;
+  const ArrSizesMap &getArrSizes() const;
+  const ArrSizeStrsMap &getArrSizeStrs() const;
 
-  // True if this variable has an itype in the original source code.
-  bool SrcHasItype;
   // The string representation of the itype of in the original source. This
   // string is empty if the variable did not have an itype OR if the itype was
   // implicitly declared by a bounds declaration on an unchecked pointer.
-  std::string ItypeStr;
+  llvm::StringRef ItypeStr;
 
   // Get the qualifier string (e.g., const, etc) for the provided
   // pointer type into the provided string stream (ss).
@@ -286,6 +318,14 @@ private:
   void addArrayAnnotations(std::stack<std::string> &ConstArrs,
                            std::deque<std::string> &EndStrs) const;
 
+  // The key under which mkString caches the type it generates for this
+  // variable, without the name, or an empty string if the type is not cached.
+  // Only the types without arrays, function pointers or internal typedefs are
+  // cached, since those are a function of the base type and of the solution
+  // and qualifiers of each level.
+  std::string getTypeStrCacheKey(Constraints &CS, bool ForItype,
+                                 bool EmitPointee) const;
+
   // Utility used by the constructor to obtain a string representation of a
   // declaration's base type. To preserve macros, this we first try to take
   // the type directly from source code. Where that is not possible, the type
@@ -301,9 +341,6 @@ private:
                                         QualType QT, const Type *Ty,
                                         const ASTContext &C);
 
-  // Flag to indicate that this constraint is a part of function prototype
-  // e.g., Parameters or Return.
-  bool PartOfFuncPrototype;
   // For the function parameters and returns,
   // this set contains the constraint variable of
   // the values used as arguments.
@@ -314,7 +351,7 @@ private:
   PointerVariableConstraint(PointerVariableConstraint *Ot, Constraints &CS);
   PointerVariableConstraint *Parent;
   // String representing declared bounds expression.
-  std::string BoundsAnnotationStr;
+  llvm::StringRef BoundsAnnotationStr;
 
   // Does this variable represent a generic type? Which one (or -1 for none)?
   // Generic types can be used with fewer restrictions, so this field is used
@@ -322,34 +359,45 @@ private:
   // to be wild.
   int GenericIndex;
 
+  TypedefNameDecl *TDT;
+  llvm::StringRef TypedefString;
+  // Does the type internally contain a typedef, and if so: at what level and
+  // what is it's name?
+  struct InternalTypedefInfo TypedefLevelInfo;
+
+  // The flags of the variable are packed together.
+
+  // True if this variable has an itype in the original source code.
+  bool SrcHasItype : 1;
+
+  // Flag to indicate that this constraint is a part of function prototype
+  // e.g., Parameters or Return.
+  bool PartOfFuncPrototype : 1;
+
   // Empty array pointers are represented the same as standard pointers. This
   // lets pointers be passed to functions expecting a zero width array. This
   // flag is used to discriminate between standard pointer and zero width array
   // pointers.
-  bool IsZeroWidthArray;
+  bool IsZeroWidthArray : 1;
 
-  bool IsTypedef = false;
-  TypedefNameDecl *TDT;
-  std::string TypedefString;
-  // Does the type internally contain a typedef, and if so: at what level and
-  // what is it's name?
-  struct InternalTypedefInfo TypedefLevelInfo;
+  bool IsTypedef : 1;
 
   // Is this a pointer to void? Possibly with multiple levels of indirection.
-  bool IsVoidPtr;
+  bool IsVoidPtr : 1;
 
   // Constructor for when we know a CVars and a type string.
-  PointerVariableConstraint(CAtoms V, std::vector<ConstAtom *> SV,
-                            std::string T, std::string Name,
-                            FunctionVariableConstraint *F, std::string Is,
+  PointerVariableConstraint(CAtoms V, llvm::SmallVector<ConstAtom *, 2> SV,
+                            llvm::StringRef T, std::string Name,
+                            FunctionVariableConstraint *F, llvm::StringRef Is,
                             int Generic = -1)
-      : ConstraintVariable(PointerVariable, "" /*not used*/, Name), BaseType(T),
-        Vars(V), SrcVars(SV), FV(F), SrcHasItype(!Is.empty()), ItypeStr(Is),
-        PartOfFuncPrototype(false), Parent(nullptr), BoundsAnnotationStr(""),
-        GenericIndex(Generic), IsZeroWidthArray(false), IsVoidPtr(false) {}
+      : ConstraintVariable(PointerVariable, "" /*not used*/, Name),
+        BaseType(internString(T)), Vars(V), SrcVars(SV), FV(F),
+        ItypeStr(internString(Is)), Parent(nullptr), GenericIndex(Generic),
+        SrcHasItype(!Is.empty()), PartOfFuncPrototype(false),
+        IsZeroWidthArray(false), IsTypedef(false), IsVoidPtr(false) {}
 
 public:
-  std::string getTy() const { return BaseType; }
+  std::string getTy() const { return BaseType.str(); }
   bool getArrPresent() const;
   // Check if the outermost pointer is an unsized array.
   bool isTopCvarUnsizedArr() const;
@@ -365,11 +413,11 @@ public:
   // Return the string representation of the itype for this constraint if an
   // itype was present in the original source code. Returns empty string
   // otherwise.
-  std::string getItype() const { return ItypeStr; }
+  std::string getItype() const { return ItypeStr.str(); }
   // Check if this variable has bounds annotation.
   bool srcHasBounds() const override { return !BoundsAnnotationStr.empty(); }
   // Get bounds annotation.
-  std::string getBoundsStr() const { return BoundsAnnotationStr; }
+  std::string getBoundsStr() const { return BoundsAnnotationStr.str(); }
 
   bool getIsGeneric() const { return GenericIndex >= 0; }
   int getGenericIndex() const { return GenericIndex; }
@@ -475,6 +523,8 @@ public:
 
   PointerVariableConstraint *getCopy(Constraints &CS) override;
 
+  size_t getOwnedBytes() const override;
+
   // Retrieve the atom at the specified index. This function includes special
   // handling for generic constraint variables to create deeper pointers as
   // they are needed.
@@ -651,6 +701,8 @@ public:
 
   FunctionVariableConstraint *getCopy(Constraints &CS) override;
 
+  size_t getOwnedBytes() const override;
+
   bool isOriginallyChecked() const override;
   bool isSolutionChecked(const EnvironmentMap &E) const override;
   bool isSolutionFullyChecked(const EnvironmentMap &E) const override;
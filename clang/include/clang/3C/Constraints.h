@@ -19,11 +19,15 @@
 #define LLVM_CLANG_3C_CONSTRAINTS_H
 
 #include "clang/3C/Utils.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/iterator.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/JSON.h"
 #include "llvm/Support/raw_ostream.h"
 #include <map>
 #include <set>
+#include <thread>
+#include <vector>
 
 class Constraint;
 class ConstraintVariable;
@@ -260,13 +264,16 @@ private:
   const ConstraintKind Kind;
   PersistentSourceLoc PL;
 
+  // Return the copy of Rsn in the table of reasons. Many constraints share
+  // the same few reasons, so they only keep a reference into the table.
+  static llvm::StringRef internReason(const std::string &Rsn);
+
 public:
-  std::string REASON = DEFAULT_REASON;
+  llvm::StringRef REASON = DEFAULT_REASON;
 
   Constraint(ConstraintKind K) : Kind(K) {}
-  Constraint(ConstraintKind K, const std::string &Rsn) : Kind(K) {
-    REASON = Rsn;
-  }
+  Constraint(ConstraintKind K, const std::string &Rsn)
+      : Kind(K), REASON(internReason(Rsn)) {}
   Constraint(ConstraintKind K, const std::string &Rsn, PersistentSourceLoc *PL);
 
   virtual ~Constraint() {}
@@ -279,8 +286,8 @@ public:
   virtual bool operator==(const Constraint &Other) const = 0;
   virtual bool operator!=(const Constraint &Other) const = 0;
   virtual bool operator<(const Constraint &Other) const = 0;
-  virtual std::string getReason() { return REASON; }
-  virtual void setReason(const std::string &Rsn) { REASON = Rsn; }
+  virtual std::string getReason() { return REASON.str(); }
+  virtual void setReason(const std::string &Rsn) { REASON = internReason(Rsn); }
 
   const PersistentSourceLoc &getLocation() const { return PL; }
 };
@@ -437,12 +444,94 @@ private:
   Geq *Conclusion;
 };
 
+typedef uint32_t ConstraintKey;
+
 // This is the solution, the first item is Checked Solution and the second
 // is Ptr solution.
 typedef std::pair<ConstAtom *, ConstAtom *> VarSolTy;
-typedef std::map<VarAtom *, VarSolTy, PComp<VarAtom *>> EnvironmentMap;
 
-typedef uint32_t ConstraintKey;
+// Solution map: Var --> Sol. The solutions are stored in a vector indexed by
+// the keys of the VarAtoms, which ConstraintsEnv::getFreshVar hands out
+// densely, so a lookup does not need to search a tree. Iteration visits the
+// VarAtoms in the order of their keys, which keeps the JSON dumps of the
+// environment deterministic.
+class EnvironmentMap {
+public:
+  typedef std::pair<VarAtom *, VarSolTy> value_type;
+
+private:
+  typedef std::vector<value_type> StorageTy;
+
+  // An iterator over the VarAtoms in the map that skips unused keys.
+  template <typename IterT, typename ValueT>
+  class IteratorImpl
+      : public llvm::iterator_facade_base<IteratorImpl<IterT, ValueT>,
+                                          std::forward_iterator_tag, ValueT> {
+    IterT I, E;
+
+    void skipUnused() {
+      while (I != E && I->first == nullptr)
+        ++I;
+    }
+
+  public:
+    IteratorImpl() = default;
+    IteratorImpl(IterT I, IterT E) : I(I), E(E) { skipUnused(); }
+
+    bool operator==(const IteratorImpl &Other) const { return I == Other.I; }
+    ValueT &operator*() const { return *I; }
+    IteratorImpl &operator++() {
+      ++I;
+      skipUnused();
+      return *this;
+    }
+  };
+
+public:
+  typedef IteratorImpl<StorageTy::iterator, value_type> iterator;
+  typedef IteratorImpl<StorageTy::const_iterator, const value_type>
+      const_iterator;
+
+  iterator begin() { return iterator(Slots.begin(), Slots.end()); }
+  iterator end() { return iterator(Slots.end(), Slots.end()); }
+  const_iterator begin() const {
+    return const_iterator(Slots.begin(), Slots.end());
+  }
+  const_iterator end() const {
+    return const_iterator(Slots.end(), Slots.end());
+  }
+
+  iterator find(const VarAtom *V);
+  const_iterator find(const VarAtom *V) const;
+  iterator find(ConstraintKey K) {
+    if (K >= Slots.size() || Slots[K].first == nullptr)
+      return end();
+    return iterator(Slots.begin() + K, Slots.end());
+  }
+  const_iterator find(ConstraintKey K) const {
+    if (K >= Slots.size() || Slots[K].first == nullptr)
+      return end();
+    return const_iterator(Slots.begin() + K, Slots.end());
+  }
+
+  // Get the solution of V, which must be in the map.
+  VarSolTy &at(const VarAtom *V);
+  const VarSolTy &at(const VarAtom *V) const;
+
+  // Add V with the solution Sol. V must not already be in the map.
+  void insert(VarAtom *V, VarSolTy Sol);
+
+  size_t size() const { return NumVars; }
+  bool empty() const { return NumVars == 0; }
+  void clear() {
+    Slots.clear();
+    NumVars = 0;
+  }
+
+private:
+  StorageTy Slots;
+  size_t NumVars = 0;
+};
 
 using VarAtomPred = llvm::function_ref<bool(VarAtom *)>;
 
@@ -470,13 +559,32 @@ public:
   std::set<VarAtom *> filterAtoms(VarAtomPred Pred);
 
 private:
-  EnvironmentMap Environment; // Solution map: Var --> Sol
+  EnvironmentMap Environment;
   uint32_t ConsFreeKey;       // Next available integer to assign to a Var
   bool UseChecked;            // Which solution map to use -- checked (vs. ptyp)
+  // The keys are handed out in order, so they only depend on the order in
+  // which the constraint variables are created. All of them must therefore be
+  // created on one thread, which is the thread that created the first one;
+  // the stages that run on several threads (parsing, finding the variables to
+  // add and solving the components) do not create any.
+  std::thread::id KeyThread;
 };
 
 class ConstraintVariable;
 
+// The sizes of the weakly connected components of the checked constraint
+// graph, counted in variables, and the time spent solving them. A component is
+// dirty if it can reach a solution other than the default one, and only dirty
+// components are solved.
+struct SolverComponentStats {
+  unsigned long NumComponents = 0;
+  unsigned long NumDirtyComponents = 0;
+  unsigned long NumDirtyVars = 0;
+  unsigned long LargestComponent = 0;
+  unsigned long LargestDirtyComponent = 0;
+  double ComponentSolveTime = 0;
+};
+
 class Constraints {
 public:
   Constraints();
@@ -491,6 +599,12 @@ public:
       FuncKeyToConsMap;
 
   bool removeConstraint(Constraint *C);
+  // Remove the constraints in ToRemove and add the ones that were removed
+  // to Removed. Only Geq constraints of a VarAtom to a ConstAtom can be
+  // removed. The reason index and the constraint graphs are updated once for
+  // the whole batch.
+  void removeConstraints(const ConstraintSet &ToRemove,
+                         ConstraintSet &Removed);
   bool addConstraint(Constraint *C);
   // It's important to return these by reference. Programs can have
   // 10-100-100000 constraints and variables, and copying them each time
@@ -499,6 +613,9 @@ public:
   const EnvironmentMap &getVariables() const {
     return Environment.getVariables();
   }
+  const std::map<std::string, ConstraintSet> &getConstraintsByReason() const {
+    return ConstraintsByReason;
+  }
 
   void editConstraintHook(Constraint *C);
 
@@ -534,6 +651,11 @@ public:
   void resetEnvironment();
   bool checkInitialEnvSanity();
 
+  // Statistics about the components of the checked graph in the last solve.
+  const SolverComponentStats &getComponentStats() const {
+    return ComponentStats;
+  }
+
   // Remove all constraints that were generated because of the
   // provided reason.
   bool removeAllConstraintsOnReason(std::string &Reason,
@@ -546,6 +668,7 @@ private:
   ConstraintsGraph *PtrTypCG;
   std::map<std::string, ConstraintSet> ConstraintsByReason;
   ConstraintsEnv Environment;
+  SolverComponentStats ComponentStats;
 
   // Confirm a constraint is well-formed
   bool check(Constraint *C);
@@ -553,8 +676,6 @@ private:
   // Managing constraints based on the underlying reason.
   // add constraint to the map.
   bool addReasonBasedConstraint(Constraint *C);
-  // Remove constraint from the map.
-  bool removeReasonBasedConstraint(Constraint *C);
 
   VarSolTy getDefaultSolution();
 
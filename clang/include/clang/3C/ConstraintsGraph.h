@@ -14,9 +14,13 @@
 
 #include "clang/3C/Constraints.h"
 #include "llvm/ADT/BreadthFirstIterator.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DirectedGraph.h"
 #include "llvm/ADT/GraphTraits.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SparseBitVector.h"
 #include "llvm/Support/GraphWriter.h"
+#include "llvm/Support/MathExtras.h"
 
 template <class DataType> struct DataEdge;
 
@@ -122,6 +126,36 @@ public:
     invalidateBFSCache();
   }
 
+  // Take a compressed sparse row copy of the edges of the graph, which
+  // getNeighbors and visitBreadthFirst then use instead of walking the edge
+  // lists of the nodes. This should be called once the graph is no longer
+  // changing, e.g. when the constraints have been built. Changing the graph
+  // drops the copy, so a frozen graph can still be modified.
+  void freeze() {
+    auto F = std::make_unique<FrozenGraph>();
+    unsigned NumNodes = this->Nodes.size();
+    F->NodeData.reserve(NumNodes);
+    for (NodeType *N : this->Nodes) {
+      F->Index[N->getData()] = F->NodeData.size();
+      F->NodeData.push_back(N->getData());
+    }
+    F->SuccBegin.reserve(NumNodes + 1);
+    F->PredBegin.reserve(NumNodes + 1);
+    for (NodeType *N : this->Nodes) {
+      F->SuccBegin.push_back(F->Succs.size());
+      for (EdgeType *E : N->getEdges())
+        F->Succs.push_back(
+            {F->Index[E->getTargetNode().getData()], E->IsSoft});
+      F->PredBegin.push_back(F->Preds.size());
+      for (EdgeType *E : N->getPredecessors())
+        F->Preds.push_back(
+            {F->Index[E->getTargetNode().getData()], E->IsSoft});
+    }
+    F->SuccBegin.push_back(F->Succs.size());
+    F->PredBegin.push_back(F->Preds.size());
+    Frozen = std::move(F);
+  }
+
   void removeEdge(Data Src, Data Dst) {
     NodeType *NSrc = this->findNode(Src);
     NodeType *NDst = this->findNode(Dst);
@@ -135,6 +169,29 @@ public:
     invalidateBFSCache();
   }
 
+  // Remove the edges between each pair of Edges as removeEdge does, but
+  // looking at the edges of each node only once.
+  void removeEdges(const std::vector<std::pair<Data, Data>> &Edges) {
+    llvm::DenseMap<NodeType *, llvm::SmallPtrSet<NodeType *, 4>> SrcsOfDst;
+    for (const auto &SrcDst : Edges) {
+      NodeType *NSrc = this->findNode(SrcDst.first);
+      NodeType *NDst = this->findNode(SrcDst.second);
+      assert(NSrc && NDst);
+      SrcsOfDst[NDst].insert(NSrc);
+    }
+    for (auto &DstSrcs : SrcsOfDst) {
+      llvm::SmallVector<EdgeType *, 10> ToRemove;
+      for (EdgeType *E : DstSrcs.first->getEdges())
+        if (DstSrcs.second.count(&E->getTargetNode()))
+          ToRemove.push_back(E);
+      for (EdgeType *E : ToRemove) {
+        DstSrcs.first->removeEdge(*E);
+        delete E;
+      }
+    }
+    invalidateBFSCache();
+  }
+
   void addEdge(Data L, Data R, bool SoftEdge = false) {
     NodeType *BL = this->findOrCreateNode(L);
     NodeType *BR = this->findOrCreateNode(R);
@@ -154,16 +211,25 @@ public:
 
   bool getNeighbors(Data D, std::set<Data> &DataSet, bool Succ,
                     bool Append = false, bool IgnoreSoftEdges = false) {
+    if (Frozen) {
+      auto I = Frozen->Index.find(D);
+      if (I == Frozen->Index.end())
+        return false;
+      if (!Append)
+        DataSet.clear();
+      for (const FrozenEdge &E : Frozen->edges(I->second, Succ))
+        if (!E.IsSoft || !IgnoreSoftEdges)
+          DataSet.insert(Frozen->NodeData[E.Target]);
+      return !DataSet.empty();
+    }
+
     NodeType *N = this->findNode(D);
     if (N == nullptr)
       return false;
     if (!Append)
       DataSet.clear();
-    llvm::SetVector<EdgeType *> Edges;
-    if (Succ)
-      Edges = N->getEdges();
-    else
-      Edges = N->getPredecessors();
+    const llvm::SetVector<EdgeType *> &Edges =
+        Succ ? N->getEdges() : N->getPredecessors();
     for (auto *E : Edges)
       if (!E->IsSoft || !IgnoreSoftEdges)
         DataSet.insert(E->getTargetNode().getData());
@@ -179,8 +245,9 @@ public:
   }
 
   NodeType *findNode(Data D) {
-    if (NodeSet.find(D) != NodeSet.end())
-      return NodeSet[D];
+    auto I = NodeSet.find(D);
+    if (I != NodeSet.end())
+      return I->second;
     return nullptr;
   }
 
@@ -189,38 +256,355 @@ public:
     if (N == nullptr)
       return;
     // Insert into BFS cache.
-    if (BFSCache.find(Start) == BFSCache.end()) {
+    auto I = BFSCache.find(Start);
+    if (I == BFSCache.end()) {
       std::set<Data> ReachableNodes;
-      for (auto TNode : llvm::breadth_first(N)) {
-        ReachableNodes.insert(TNode->getData());
+      if (Frozen) {
+        Frozen->visitReachable(Frozen->Index[Start], [&](unsigned Node) {
+          ReachableNodes.insert(Frozen->NodeData[Node]);
+        });
+      } else {
+        for (auto TNode : llvm::breadth_first(N)) {
+          ReachableNodes.insert(TNode->getData());
+        }
       }
-      BFSCache[Start] = ReachableNodes;
+      I = BFSCache.insert({Start, std::move(ReachableNodes)}).first;
     }
-    for (auto SN : BFSCache[Start])
+    for (auto SN : I->second)
       Fn(SN);
   }
 
+  // Call Fn on every node from which Start can be reached, including Start
+  // itself. Unlike visitBreadthFirst, the result is not cached.
+  void visitBreadthFirstBackward(Data Start,
+                                 llvm::function_ref<void(Data)> Fn) {
+    if (!Frozen)
+      freeze();
+    auto I = Frozen->Index.find(Start);
+    if (I == Frozen->Index.end())
+      return;
+    Frozen->visitReachable(
+        I->second, [&](unsigned Node) { Fn(Frozen->NodeData[Node]); },
+        /*Succ=*/false);
+  }
+
+  // Call Fn once on every node that is not one of Sources and is reachable
+  // from one of them through successor edges, or through predecessor edges if
+  // Succ is false, not counting soft edges if IgnoreSoftEdges is true. The
+  // traversal continues through a node only if Fn returns true for it. Unlike
+  // getNeighbors from each node, this does not build a set per node.
+  void visitReachableFrom(llvm::ArrayRef<Data> Sources, bool Succ,
+                          bool IgnoreSoftEdges,
+                          llvm::function_ref<bool(Data)> Fn) {
+    if (!Frozen)
+      freeze();
+    std::vector<bool> Visited(Frozen->NodeData.size(), false);
+    std::vector<unsigned> Queue;
+    for (Data D : Sources) {
+      auto I = Frozen->Index.find(D);
+      if (I != Frozen->Index.end() && !Visited[I->second]) {
+        Visited[I->second] = true;
+        Queue.push_back(I->second);
+      }
+    }
+    for (size_t I = 0; I != Queue.size(); ++I) {
+      for (const FrozenEdge &E : Frozen->edges(Queue[I], Succ)) {
+        if (Visited[E.Target] || (E.IsSoft && IgnoreSoftEdges))
+          continue;
+        Visited[E.Target] = true;
+        if (Fn(Frozen->NodeData[E.Target]))
+          Queue.push_back(E.Target);
+      }
+    }
+  }
+
+  // Call Fn on every node reachable from one of Sources, with the labels of
+  // all the sources that reach it. A source is a node and a label, and a node
+  // may be the source of several labels. Unlike visitBreadthFirst from each
+  // source, this visits each reachable edge once, so it is linear in the size
+  // of the graph apart from the cost of merging the label sets.
+  void visitReachableLabeled(
+      llvm::ArrayRef<std::pair<Data, unsigned>> Sources,
+      llvm::function_ref<void(Data, const llvm::SparseBitVector<> &)> Fn) {
+    if (!Frozen)
+      freeze();
+    std::vector<std::pair<unsigned, unsigned>> IndexSources;
+    for (const auto &S : Sources) {
+      auto I = Frozen->Index.find(S.first);
+      if (I != Frozen->Index.end())
+        IndexSources.push_back({I->second, S.second});
+    }
+    Frozen->visitReachableLabeled(
+        IndexSources, [&](unsigned Node, const llvm::SparseBitVector<> &L) {
+          Fn(Frozen->NodeData[Node], L);
+        });
+  }
+
+  // Statistics of the shape of the graph, returned by computeStats.
+  struct GraphStats {
+    unsigned long NumNodes = 0;
+    unsigned long NumEdges = 0;
+    unsigned long NumSoftEdges = 0;
+    unsigned long NumSCCs = 0;
+    unsigned long NumWCCs = 0;
+    // The number of nodes by in-degree and by out-degree, in buckets of
+    // powers of two: bucket 0 counts the nodes of degree 0, and bucket B > 0
+    // the nodes of degree 2^(B-1) to 2^B - 1.
+    std::vector<unsigned long> InDegrees, OutDegrees;
+    // The sizes of the largest strongly and weakly connected components, and
+    // the nodes with the most predecessors and successors with their
+    // degrees, largest first.
+    std::vector<unsigned long> LargestSCCs, LargestWCCs;
+    std::vector<std::pair<Data, unsigned long>> TopFanIn, TopFanOut;
+  };
+
+  // Compute the statistics of the graph, keeping the TopN largest components
+  // and nodes. This freezes the graph if it is not frozen.
+  GraphStats computeStats(unsigned TopN) {
+    if (!Frozen)
+      freeze();
+    return Frozen->computeStats(TopN);
+  }
+
 protected:
   // Finds the node containing the Data if it exists, otherwise a new Node
   // is allocated. Node equality is defined only by the data stored in a node,
   // so if any node already contains the data, this node will be found.
   virtual NodeType *findOrCreateNode(Data D) {
-    if (NodeSet.find(D) != NodeSet.end())
-      return NodeSet[D];
-
-    auto *NewN = new NodeType(D);
-    this->Nodes.push_back(NewN);
-    NodeSet[D] = NewN;
-    return NewN;
+    NodeType *&N = NodeSet[D];
+    if (N != nullptr)
+      return N;
+
+    N = new NodeType(D);
+    this->Nodes.push_back(N);
+    Frozen.reset();
+    return N;
   }
 
 private:
   template <typename G> friend struct llvm::GraphTraits;
   friend class GraphVizOutputGraph;
+
+  // An edge in the frozen copy of the graph, to the node with index Target.
+  struct FrozenEdge {
+    unsigned Target;
+    bool IsSoft;
+  };
+
+  // The frozen copy of the graph. The nodes are numbered in the order of
+  // Nodes, and the successor (predecessor) edges of node I are
+  // Succs[SuccBegin[I]] to Succs[SuccBegin[I + 1] - 1].
+  struct FrozenGraph {
+    llvm::DenseMap<Data, unsigned> Index;
+    std::vector<Data> NodeData;
+    std::vector<unsigned> SuccBegin, PredBegin;
+    std::vector<FrozenEdge> Succs, Preds;
+
+    llvm::ArrayRef<FrozenEdge> edges(unsigned Node, bool Succ) const {
+      const std::vector<unsigned> &Begin = Succ ? SuccBegin : PredBegin;
+      const std::vector<FrozenEdge> &Edges = Succ ? Succs : Preds;
+      return llvm::makeArrayRef(Edges.data() + Begin[Node],
+                                Begin[Node + 1] - Begin[Node]);
+    }
+
+    // Call Fn on every node reachable from Start through successor edges, or
+    // through predecessor edges if Succ is false, including Start itself.
+    void visitReachable(unsigned Start, llvm::function_ref<void(unsigned)> Fn,
+                        bool Succ = true) const {
+      std::vector<bool> Visited(NodeData.size(), false);
+      std::vector<unsigned> Queue;
+      Queue.push_back(Start);
+      Visited[Start] = true;
+      for (size_t I = 0; I != Queue.size(); ++I) {
+        unsigned Node = Queue[I];
+        Fn(Node);
+        for (const FrozenEdge &E : edges(Node, Succ)) {
+          if (!Visited[E.Target]) {
+            Visited[E.Target] = true;
+            Queue.push_back(E.Target);
+          }
+        }
+      }
+    }
+
+    // Find the strongly connected components of the nodes reachable from
+    // Roots with Tarjan's algorithm, which finds a component only after all
+    // the components reachable from it. SCCOf is set to the component of
+    // every reachable node and to ~0U for the other nodes. The members of
+    // component K are SCCNodes[SCCBegin[K]] to SCCNodes[SCCBegin[K + 1] - 1].
+    void findSCCs(llvm::ArrayRef<unsigned> Roots, std::vector<unsigned> &SCCOf,
+                  std::vector<unsigned> &SCCNodes,
+                  std::vector<unsigned> &SCCBegin) const {
+      const unsigned None = ~0U;
+      unsigned NumNodes = NodeData.size();
+      std::vector<unsigned> Num(NumNodes, 0), Low(NumNodes, 0);
+      SCCOf.assign(NumNodes, None);
+      SCCNodes.clear();
+      SCCBegin.clear();
+      std::vector<unsigned> Stack;
+      // The DFS path, with the index of the next edge of each node.
+      std::vector<std::pair<unsigned, unsigned>> Path;
+      unsigned Counter = 0;
+      for (unsigned Root : Roots) {
+        if (Num[Root])
+          continue;
+        Num[Root] = Low[Root] = ++Counter;
+        Stack.push_back(Root);
+        Path.push_back({Root, 0});
+        while (!Path.empty()) {
+          unsigned V = Path.back().first;
+          llvm::ArrayRef<FrozenEdge> Edges = edges(V, true);
+          if (Path.back().second < Edges.size()) {
+            unsigned W = Edges[Path.back().second++].Target;
+            if (!Num[W]) {
+              Num[W] = Low[W] = ++Counter;
+              Stack.push_back(W);
+              Path.push_back({W, 0});
+            } else if (SCCOf[W] == None) {
+              Low[V] = std::min(Low[V], Num[W]);
+            }
+            continue;
+          }
+          Path.pop_back();
+          if (!Path.empty()) {
+            unsigned P = Path.back().first;
+            Low[P] = std::min(Low[P], Low[V]);
+          }
+          if (Low[V] != Num[V])
+            continue;
+          unsigned K = SCCBegin.size();
+          SCCBegin.push_back(SCCNodes.size());
+          unsigned X;
+          do {
+            X = Stack.back();
+            Stack.pop_back();
+            SCCOf[X] = K;
+            SCCNodes.push_back(X);
+          } while (X != V);
+        }
+      }
+      SCCBegin.push_back(SCCNodes.size());
+    }
+
+    // Call Fn on every node reachable from one of Sources, a list of nodes
+    // and their labels, with the labels of the sources that reach it. The
+    // labels are pushed along the edges in the reverse order in which
+    // findSCCs finds the components, so that all the labels of a component
+    // are known when it is visited, and its label set can be dropped right
+    // after.
+    void visitReachableLabeled(
+        llvm::ArrayRef<std::pair<unsigned, unsigned>> Sources,
+        llvm::function_ref<void(unsigned, const llvm::SparseBitVector<> &)> Fn)
+        const {
+      std::vector<unsigned> Roots;
+      for (const auto &S : Sources)
+        Roots.push_back(S.first);
+      std::vector<unsigned> SCCOf, SCCNodes, SCCBegin;
+      findSCCs(Roots, SCCOf, SCCNodes, SCCBegin);
+
+      unsigned NumSCCs = SCCBegin.size() - 1;
+      std::vector<llvm::SparseBitVector<>> Labels(NumSCCs);
+      for (const auto &S : Sources)
+        Labels[SCCOf[S.first]].set(S.second);
+      for (unsigned K = NumSCCs; K-- > 0;) {
+        for (unsigned I = SCCBegin[K]; I != SCCBegin[K + 1]; ++I)
+          Fn(SCCNodes[I], Labels[K]);
+        for (unsigned I = SCCBegin[K]; I != SCCBegin[K + 1]; ++I)
+          for (const FrozenEdge &E : edges(SCCNodes[I], true))
+            if (SCCOf[E.Target] != K)
+              Labels[SCCOf[E.Target]] |= Labels[K];
+        Labels[K].clear();
+      }
+    }
+
+    GraphStats computeStats(unsigned TopN) const {
+      GraphStats S;
+      unsigned NumNodes = NodeData.size();
+      S.NumNodes = NumNodes;
+      S.NumEdges = Succs.size();
+      for (const FrozenEdge &E : Succs)
+        S.NumSoftEdges += E.IsSoft;
+
+      auto AddDegree = [](std::vector<unsigned long> &Buckets,
+                          unsigned Degree) {
+        unsigned B = Degree == 0 ? 0 : llvm::Log2_32(Degree) + 1;
+        if (Buckets.size() <= B)
+          Buckets.resize(B + 1, 0);
+        ++Buckets[B];
+      };
+      auto AddTop = [TopN](std::vector<std::pair<Data, unsigned long>> &Top,
+                           Data D, unsigned long N) {
+        if (N == 0 || TopN == 0 ||
+            (Top.size() == TopN && Top.back().second >= N))
+          return;
+        auto I = std::upper_bound(
+            Top.begin(), Top.end(), N,
+            [](unsigned long N, const std::pair<Data, unsigned long> &P) {
+              return N > P.second;
+            });
+        Top.insert(I, {D, N});
+        if (Top.size() > TopN)
+          Top.pop_back();
+      };
+      for (unsigned I = 0; I < NumNodes; ++I) {
+        unsigned In = PredBegin[I + 1] - PredBegin[I];
+        unsigned Out = SuccBegin[I + 1] - SuccBegin[I];
+        AddDegree(S.InDegrees, In);
+        AddDegree(S.OutDegrees, Out);
+        AddTop(S.TopFanIn, NodeData[I], In);
+        AddTop(S.TopFanOut, NodeData[I], Out);
+      }
+
+      auto AddSizes = [TopN](std::vector<unsigned long> &Largest,
+                             std::vector<unsigned long> Sizes) {
+        std::sort(Sizes.begin(), Sizes.end(),
+                  std::greater<unsigned long>());
+        if (Sizes.size() > TopN)
+          Sizes.resize(TopN);
+        Largest = std::move(Sizes);
+      };
+      std::vector<unsigned> Roots(NumNodes);
+      for (unsigned I = 0; I < NumNodes; ++I)
+        Roots[I] = I;
+      std::vector<unsigned> SCCOf, SCCNodes, SCCBegin;
+      findSCCs(Roots, SCCOf, SCCNodes, SCCBegin);
+      S.NumSCCs = SCCBegin.size() - 1;
+      std::vector<unsigned long> Sizes;
+      for (unsigned K = 0; K < S.NumSCCs; ++K)
+        Sizes.push_back(SCCBegin[K + 1] - SCCBegin[K]);
+      AddSizes(S.LargestSCCs, std::move(Sizes));
+
+      // The weakly connected components are found by union-find over the
+      // successor edges.
+      std::vector<unsigned> Parent(Roots);
+      auto Find = [&Parent](unsigned X) {
+        while (Parent[X] != X)
+          X = Parent[X] = Parent[Parent[X]];
+        return X;
+      };
+      for (unsigned I = 0; I < NumNodes; ++I)
+        for (const FrozenEdge &E : edges(I, true))
+          Parent[Find(E.Target)] = Find(I);
+      std::map<unsigned, unsigned long> WCCSizes;
+      for (unsigned I = 0; I < NumNodes; ++I)
+        ++WCCSizes[Find(I)];
+      S.NumWCCs = WCCSizes.size();
+      Sizes.clear();
+      for (const auto &W : WCCSizes)
+        Sizes.push_back(W.second);
+      AddSizes(S.LargestWCCs, std::move(Sizes));
+      return S;
+    }
+  };
+
   std::map<Data, std::set<Data>> BFSCache;
-  std::map<Data, NodeType *> NodeSet;
+  llvm::DenseMap<Data, NodeType *> NodeSet;
+  std::unique_ptr<FrozenGraph> Frozen;
 
-  void invalidateBFSCache() { BFSCache.clear(); }
+  void invalidateBFSCache() {
+    BFSCache.clear();
+    Frozen.reset();
+  }
 };
 
 // Specialize the graph for the checked and pointer type constraint graphs. This
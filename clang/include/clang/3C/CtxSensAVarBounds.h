@@ -83,19 +83,11 @@ private:
     GlobalMEBoundsKey.clear();
   }
 
-  // Get the map (i.e., local or global) where the context-sensitive
-  // bounds key for ME should be stored.
-  CtxStKeyMap *getCtxStKeyMap(MemberExpr *ME, ASTContext *C);
-
   void contextualizeStructRecord(ProgramInfo &I, ASTContext *C,
                                  const RecordDecl *RD, const std::string &AK,
                                  std::map<BoundsKey, BoundsKey> &BKMap,
                                  bool IsGlobal);
 
-  // Get string that represents a context sensitive key for the struct
-  // member access ME.
-  std::string getCtxStructKey(MemberExpr *ME, ASTContext *C);
-
   // For the given expression E, get all the bounds key and store them in
   // AllKeys. This function returns true on success.
   bool deriveBoundsKeys(clang::Expr *E, const CVarSet &CVars, ASTContext *C,
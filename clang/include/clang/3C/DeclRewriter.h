@@ -15,6 +15,7 @@
 
 #include "clang/3C/ConstraintBuilder.h"
 #include "clang/3C/RewriteUtils.h"
+#include "clang/3C/StructInit.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Decl.h"
 #include "clang/AST/RecursiveASTVisitor.h"
@@ -36,9 +37,9 @@ public:
   static void rewriteDecls(ASTContext &Context, ProgramInfo &Info, Rewriter &R);
 
 private:
-  static RecordDecl *LastRecordDecl;
-  static std::map<Decl *, Decl *> VDToRDMap;
-  static std::set<Decl *> InlineVarDecls;
+  RecordDecl *LastRecordDecl = nullptr;
+  std::map<Decl *, Decl *> VDToRDMap;
+  std::set<Decl *> InlineVarDecls;
   Rewriter &R;
   ASTContext &A;
   GlobalVariableGroups &GP;
@@ -73,7 +74,7 @@ private:
   bool isSingleDeclaration(DeclReplacement *N);
   bool areDeclarationsOnSameLine(DeclReplacement *N1, DeclReplacement *N2);
   SourceRange getNextCommaOrSemicolon(SourceLocation L);
-  static void detectInlineStruct(Decl *D, SourceManager &SM);
+  void detectInlineStruct(Decl *D, SourceManager &SM);
 };
 
 // Visits function declarations and adds entries with their new rewritten
@@ -83,9 +84,13 @@ public:
   explicit FunctionDeclBuilder(ASTContext *C, ProgramInfo &I, RSet &DR,
                                ArrayBoundsRewriter &ArrRewriter)
       : Context(C), Info(I), RewriteThese(DR), ABRewriter(ArrRewriter),
-        VisitedSet() {}
+        VisitedSet(), StructInits(C, I, DR) {}
 
   bool VisitFunctionDecl(FunctionDecl *);
+  bool VisitDeclStmt(DeclStmt *S) {
+    StructInits.addInitializers(S);
+    return true;
+  }
   bool isFunctionVisited(std::string FuncName);
 
 protected:
@@ -98,6 +103,8 @@ protected:
   // Used to ensure the new signature is only computed once for each function.
   std::set<std::string> VisitedSet;
 
+  StructVariableInitializer StructInits;
+
   // Get existing itype string from constraint variables.
   std::string getExistingIType(ConstraintVariable *DeclC);
 
@@ -22,42 +22,55 @@
 #include "clang/Rewrite/Core/Rewriter.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
 class PersistentSourceLoc {
 protected:
-  PersistentSourceLoc(std::string F, uint32_t L, uint32_t C, uint32_t E)
-      : FileName(F), LineNo(L), ColNoS(C), ColNoE(E), IsValid(true) {}
+  PersistentSourceLoc(const std::string &F, uint32_t L, uint32_t C,
+                      uint32_t E)
+      : FileName(internFileName(F)), LineNo(L), ColNoS(C), ColNoE(E),
+        IsValid(true) {}
+  // F must already be interned by internFileName.
+  PersistentSourceLoc(llvm::StringRef F, uint32_t L, uint32_t C, uint32_t E,
+                      bool Valid)
+      : FileName(F), LineNo(L), ColNoS(C), ColNoE(E), IsValid(Valid) {}
 
 public:
   PersistentSourceLoc()
       : FileName(""), LineNo(0), ColNoS(0), ColNoE(0), IsValid(false) {}
-  std::string getFileName() const { return FileName; }
+  std::string getFileName() const { return FileName.str(); }
+  // The interned file name. Locations in the same file share its storage.
+  llvm::StringRef getInternedFileName() const { return FileName; }
   uint32_t getLineNo() const { return LineNo; }
   uint32_t getColSNo() const { return ColNoS; }
   uint32_t getColENo() const { return ColNoE; }
   bool valid() const { return IsValid; }
 
   bool operator<(const PersistentSourceLoc &O) const {
-    if (FileName == O.FileName)
-      if (LineNo == O.LineNo)
-        if (ColNoS == O.ColNoS)
-          if (ColNoE == O.ColNoE)
-            return false;
-          else
-            return ColNoE < O.ColNoE;
+    // File names are interned, so the names only have to be compared when
+    // they are different strings.
+    if (FileName.data() != O.FileName.data()) {
+      int Cmp = FileName.compare(O.FileName);
+      if (Cmp != 0)
+        return Cmp < 0;
+    }
+    if (LineNo == O.LineNo)
+      if (ColNoS == O.ColNoS)
+        if (ColNoE == O.ColNoE)
+          return false;
         else
-          return ColNoS < O.ColNoS;
+          return ColNoE < O.ColNoE;
       else
-        return LineNo < O.LineNo;
+        return ColNoS < O.ColNoS;
     else
-      return FileName < O.FileName;
+      return LineNo < O.LineNo;
   }
 
   std::string toString() const {
-    return FileName + ":" + std::to_string(LineNo) + ":" +
+    return FileName.str() + ":" + std::to_string(LineNo) + ":" +
            std::to_string(ColNoS) + ":" + std::to_string(ColNoE);
   }
 
@@ -80,8 +93,17 @@ private:
   static PersistentSourceLoc mkPSL(clang::SourceRange SR,
                                    clang::SourceLocation SL,
                                    clang::ASTContext &Context);
-  // The source file name.
-  std::string FileName;
+  // Compute the location that mkPSL(SR, SL, Context) returns. FileNames
+  // caches the interned absolute file name of each FileID of Context.
+  static PersistentSourceLoc
+  computePSL(clang::SourceRange SR, clang::SourceLocation SL,
+             clang::ASTContext &Context,
+             llvm::DenseMap<clang::FileID, llvm::StringRef> &FileNames);
+  // Return the copy of F in the table of file names, which lives as long as
+  // the process.
+  static llvm::StringRef internFileName(const std::string &F);
+  // The source file name, interned by internFileName.
+  llvm::StringRef FileName;
   // Starting line number.
   uint32_t LineNo;
   // Column number start.
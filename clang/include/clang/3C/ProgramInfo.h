@@ -28,17 +28,12 @@ class ProgramVariableAdder {
 public:
   virtual void addVariable(clang::DeclaratorDecl *D,
                            clang::ASTContext *AstContext) = 0;
-  void addABoundsVariable(clang::Decl *D) {
-    getABoundsInfo().insertVariable(D);
-  }
+  virtual void addABoundsVariable(clang::Decl *D) = 0;
 
   virtual bool seenTypedef(PersistentSourceLoc PSL) = 0;
 
   virtual void addTypedef(PersistentSourceLoc PSL, bool CanRewriteDef,
                           TypedefDecl *TD, ASTContext &C) = 0;
-
-protected:
-  virtual AVarBoundsInfo &getABoundsInfo() = 0;
 };
 
 typedef std::pair<CVarSet, BKeySet> CSetBkeyPair;
@@ -68,6 +63,16 @@ public:
   void printAggregateStats(const std::set<std::string> &F,
                            llvm::raw_ostream &O);
 
+  // Print the number of constraint variables of each kind and the memory
+  // they use (see ConstraintVariable::getOwnedBytes).
+  void printMemoryStats(llvm::raw_ostream &O) const;
+
+  // Print the size, degree distribution and largest components of the
+  // checked and pointer type constraint graphs, the TopN atoms with the most
+  // edges with the locations of their pointers, and the TopN reasons with the
+  // most constraints.
+  void printConstraintGraphStats(llvm::raw_ostream &O, unsigned TopN = 10);
+
   // Populate Variables, VarDeclToStatement, RVariables, and DepthMap with
   // AST data structures that correspond do the data stored in PDMap and
   // ReversePDMap.
@@ -81,6 +86,11 @@ public:
   bool hasPersistentConstraints(clang::Expr *E, ASTContext *C) const;
   const CSetBkeyPair &getPersistentConstraints(clang::Expr *E,
                                                ASTContext *C) const;
+  // Return the persistent constraints of E, or null if there are none. This
+  // computes the key of E once, rather than once for the check and once for
+  // the lookup.
+  const CSetBkeyPair *findPersistentConstraints(clang::Expr *E,
+                                                ASTContext *C) const;
   void storePersistentConstraints(clang::Expr *E, const CSetBkeyPair &Vars,
                                   ASTContext *C);
   // Get only constraint vars from the persistent contents of the
@@ -96,15 +106,25 @@ public:
 
   // Retrieve a function's constraints by decl, or by name; nullptr if not found
   FVConstraint *getFuncConstraint(FunctionDecl *D, ASTContext *C) const;
-  FVConstraint *getExtFuncDefnConstraint(std::string FuncName) const;
-  FVConstraint *getStaticFuncConstraint(std::string FuncName,
-                                        std::string FileName) const;
+  FVConstraint *getExtFuncDefnConstraint(const std::string &FuncName) const;
+  FVConstraint *getStaticFuncConstraint(const std::string &FuncName,
+                                        const std::string &FileName) const;
 
   // Called when we are done adding constraints and visiting ASTs.
   // Links information about global symbols together and adds
   // constraints where appropriate.
   bool link();
 
+  // A 3C summary records the solution and the count or byte bounds of the
+  // parameters and returns of the external functions defined in a 3C run. An
+  // external function that has no body in a later run but has a loaded
+  // summary is constrained as in the summary rather than being made WILD
+  // entirely, as if its definition had been analyzed again. loadSummary must
+  // be called before link; it returns false and sets Error if the file cannot
+  // be read.
+  bool loadSummary(const std::string &FileName, std::string &Error);
+  void writeSummary(llvm::raw_ostream &O);
+
   const VariableMap &getVarMap() const { return Variables; }
   Constraints &getConstraints() { return CS; }
   AVarBoundsInfo &getABoundsInfo() { return ArrBInfo; }
@@ -113,6 +133,26 @@ public:
 
   ConstraintsInfo &getInterimConstraintState() { return CState; }
   bool computeInterimConstraintState(const std::set<std::string> &FilePaths);
+  // Update the interim constraint state after some of the constraints that
+  // directly make atoms WILD were removed and the constraints were solved
+  // again, without traversing the checked graph: no atom can become WILD, and
+  // the atoms that are still WILD keep the root causes that are still root
+  // causes. Falls back to computeInterimConstraintState if a new root cause
+  // appears.
+  bool updateInterimConstraintState(const std::set<std::string> &FilePaths);
+
+  // On-demand versions of the root cause information of the interim
+  // constraint state, which only look at the part of the checked graph that
+  // is needed. The root causes of an atom are the atoms directly constrained
+  // to WILD that make it WILD. The answers are memoized until
+  // invalidateRootCauseQueries is called, which must be done whenever the
+  // constraints change.
+  const CVars &getRootCausesOf(ConstraintKey Key);
+  // The atoms that the root cause RootKey makes WILD, in any file.
+  const CVars &getWildAffectedAtomsOf(ConstraintKey RootKey);
+  // The root causes of the atoms of the declarations in FileName.
+  CVars getRootCausesInFile(const std::string &FileName);
+  void invalidateRootCauseQueries();
 
   const ExternalFunctionMapType &getExternFuncDefFVMap() const {
     return ExternalFunctionFVCons;
@@ -144,6 +184,13 @@ public:
   void addTypedef(PersistentSourceLoc PSL, bool CanRewriteDef, TypedefDecl *TD,
                   ASTContext &C);
 
+  void addABoundsVariable(clang::Decl *D) { ArrBInfo.insertVariable(D); }
+
+  // addVariable for a declaration whose source location PLoc has already
+  // been computed.
+  void addVariableAt(clang::DeclaratorDecl *D, clang::ASTContext *AstContext,
+                     PersistentSourceLoc PLoc);
+
 private:
   // List of constraint variables for declarations, indexed by their location in
   // the source. This information persists across invocations of the constraint
@@ -184,14 +231,51 @@ private:
 
   // Maps for global/static functions, global variables.
   ExternalFunctionMapType ExternalFunctionFVCons;
+
+  // The bounds of a return or parameter in a summary. The length is the
+  // parameter at index Param, or the constant Const if Param is negative.
+  struct SummaryBounds {
+    ABounds::BoundsKind Kind;
+    int Param;
+    uint64_t Const;
+  };
+  // The summary of a function. Index 0 of each vector is the external return,
+  // followed by the parameters. Solutions holds the solution of each atom and
+  // Bounds the bounds, if any, of the outer pointer.
+  struct FunctionSummary {
+    std::vector<std::vector<std::string>> Solutions;
+    std::vector<llvm::Optional<SummaryBounds>> Bounds;
+  };
+  std::map<std::string, FunctionSummary> Summaries;
+
+  // Constrain the components of an undefined external function as in the
+  // summary Sum. Returns false, without adding any constraint, if the summary
+  // does not have the shape of the components.
+  bool applySummary(const FunctionSummary &Sum,
+                    const std::vector<const FVComponentVariable *> &Components,
+                    const std::string &Rsn);
   StaticFunctionMapType StaticFunctionFVCons;
   std::map<std::string, std::set<PVConstraint *>> GlobalVariableSymbols;
 
+  // The signatures (see insertNewFVConstraint) of the function declarations
+  // merged into the function maps so far.
+  std::set<size_t> MergedFVSignatures;
+
   // Object that contains all the bounds information of various array variables.
   AVarBoundsInfo ArrBInfo;
   // Constraints state.
   ConstraintsInfo CState;
 
+  // The memoized answers of the on-demand root cause queries, and the parts
+  // of the constraints that they need, built by the first query.
+  std::map<ConstraintKey, CVars> RootCauseQueries;
+  std::map<ConstraintKey, CVars> WildAffectedQueries;
+  std::set<Atom *> QueryDirectWildAtoms;
+  std::map<Atom *, std::set<Atom *>> QueryImpByPremise;
+  std::map<Atom *, std::set<Atom *>> QueryImpByConclusion;
+  bool RootCauseQueryStateBuilt = false;
+  void buildRootCauseQueryState();
+
   // For each call to a generic function, remember how the type parameters were
   // instantiated so they can be inserted during rewriting.
   TypeParamBindingsT TypeParamBindings;
@@ -16,6 +16,7 @@
 
 #include "clang/3C/PersistentSourceLoc.h"
 #include "clang/AST/ASTContext.h"
+#include "llvm/ADT/BitVector.h"
 #include <stdint.h>
 #include <string>
 
@@ -25,6 +26,30 @@ typedef uint32_t BoundsKey;
 
 typedef std::set<BoundsKey> BKeySet;
 
+// A set of BoundsKeys that is never removed from. BoundsKeys are allocated
+// consecutively from a counter, so the set is a bit vector indexed by the key
+// rather than a tree of nodes.
+class BoundsKeySet {
+public:
+  void insert(BoundsKey BK) {
+    if (BK >= Bits.size())
+      Bits.resize(BK + 1);
+    Bits.set(BK);
+  }
+  bool count(BoundsKey BK) const { return BK < Bits.size() && Bits.test(BK); }
+  void clear() { Bits.clear(); }
+  // The keys in the set, in increasing order.
+  llvm::BitVector::const_set_bits_iterator begin() const {
+    return Bits.set_bits_begin();
+  }
+  llvm::BitVector::const_set_bits_iterator end() const {
+    return Bits.set_bits_end();
+  }
+
+private:
+  llvm::BitVector Bits;
+};
+
 // Class representing scope of a program variable.
 class ProgramVarScope {
 public:
@@ -181,18 +181,43 @@ private:
 
 class RewriteConsumer : public ASTConsumer {
 public:
-  explicit RewriteConsumer(ProgramInfo &I) : Info(I) {}
+  // If Previews is not null, only the files whose canonical paths are keys of
+  // *Previews are rewritten, and their new contents are stored as the values
+  // instead of being written out. A translation unit that does not contain
+  // any of these files, or only contains files previewed in an earlier
+  // translation unit, is skipped.
+  //
+  // If PatchOut is not null (-output-patch), the changes are appended to it
+  // as a unified diff instead of being written to the output files.
+  explicit RewriteConsumer(ProgramInfo &I,
+                           std::map<std::string, std::string> *Previews =
+                               nullptr,
+                           llvm::raw_ostream *PatchOut = nullptr)
+      : Info(I), Previews(Previews), PatchOut(PatchOut) {}
 
   virtual void HandleTranslationUnit(ASTContext &Context);
 
+  // The files of *Previews that have been previewed so far.
+  const std::set<std::string> &getPreviewedFiles() const {
+    return PreviewedFiles;
+  }
+
 private:
   ProgramInfo &Info;
-  static std::map<std::string, std::string> ModifiedFuncSignatures;
+  std::map<std::string, std::string> *Previews;
+  std::set<std::string> PreviewedFiles;
+  llvm::raw_ostream *PatchOut;
+
+  // The canonical paths of the files already written out (or found up to
+  // date, or written to PatchOut) by an earlier translation unit. A header
+  // included by several translation units gets the same changes in each of
+  // them, so it is only rewritten and written out for the first.
+  std::set<std::string> EmittedFiles;
 
   // A single header file can be included in multiple translations units. This
   // set ensures that the diagnostics for a header file are not emitted each
   // time a translation unit containing the header is vistied.
-  static std::set<PersistentSourceLoc> EmittedDiagnostics;
+  std::set<PersistentSourceLoc> EmittedDiagnostics;
 
   void emitRootCauseDiagnostics(ASTContext &Context);
 };
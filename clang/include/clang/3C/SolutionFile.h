@@ -0,0 +1,105 @@
+//=--SolutionFile.h-----------------------------------------------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+// A compact, read-only binary file of the solution of a 3C run, indexed by
+// file and line, which tools outside of 3C can map into memory and query
+// without loading the JSON dumps.
+//
+// All of the integers in the file are 32-bit little-endian values. The file
+// is laid out as:
+//
+//   Header:  "3CSF", Version, NumFiles, NumEntries, StringsSize
+//   Files:   NumFiles x {Name, FirstEntry, NumEntries}, sorted by name
+//   Entries: NumEntries x {Line, ColStart, ColEnd, Kind, Key, Bounds,
+//                          NumRootCauses, RootCauseReason, RootCauseFile,
+//                          RootCauseLine},
+//            sorted by line and column within each file
+//   Strings: StringsSize bytes of NUL-terminated strings
+//
+// Name, Bounds, RootCauseReason and RootCauseFile are offsets into Strings,
+// or NoString. Each entry is a pointer declared at the location: Kind is a
+// SolutionFile::PtrKind and Key is the ConstraintKey of its outer pointer,
+// which can be passed to the root cause queries of _3CInterface. A WILD
+// pointer also records the number of its root causes and the reason and
+// location of the first of them.
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_3C_SOLUTIONFILE_H
+#define LLVM_CLANG_3C_SOLUTIONFILE_H
+
+#include "clang/3C/ProgramInfo.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+class SolutionFile {
+public:
+  static const uint32_t Version = 1;
+  static const uint32_t NoString = ~0U;
+
+  enum PtrKind : uint32_t { Ptr, Arr, NTArr, Wild, Unknown };
+
+  struct Entry {
+    uint32_t Line;
+    uint32_t ColStart;
+    uint32_t ColEnd;
+    PtrKind Kind;
+    ConstraintKey Key;
+    llvm::StringRef Bounds;
+    uint32_t NumRootCauses;
+    llvm::StringRef RootCauseReason;
+    llvm::StringRef RootCauseFile;
+    uint32_t RootCauseLine;
+  };
+
+  // Write the solution of the pointers of Info to O. The root causes are
+  // computed on demand, so this must be called after solving.
+  static void write(ProgramInfo &Info, llvm::raw_ostream &O);
+
+  // Map the solution file FileName into memory. Returns null and sets Error
+  // if the file cannot be read or is not a solution file.
+  static std::unique_ptr<SolutionFile> open(const std::string &FileName,
+                                            std::string &Error);
+
+  // Get the pointers declared on line Line of file FileName, which is a path
+  // as it is written in PersistentSourceLocs.
+  std::vector<Entry> lookup(llvm::StringRef FileName, uint32_t Line) const;
+
+  // Get the names of all the files in the solution, in sorted order.
+  std::vector<llvm::StringRef> files() const;
+
+  // A pointer that is WILD in the current solution but was not WILD in the
+  // solution file, with the first of its current root causes.
+  struct NewWildPtr {
+    PersistentSourceLoc Loc;
+    ConstraintKey Key;
+    uint32_t NumRootCauses;
+    std::string RootCauseReason;
+    PersistentSourceLoc RootCauseLoc;
+  };
+
+  // Compare the solved pointers of Info in the writable files against this
+  // solution file and get the pointers that are newly WILD, in the order of
+  // their locations. A pointer is matched by the file, line and starting
+  // column of its declaration, so a WILD pointer that has moved to another
+  // line is also reported. Must be called after solving.
+  std::vector<NewWildPtr> findNewWildPtrs(ProgramInfo &Info) const;
+
+private:
+  SolutionFile(std::unique_ptr<llvm::MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  uint32_t NumFiles = 0;
+  uint32_t NumEntries = 0;
+  const char *FilesStart = nullptr;
+  const char *EntriesStart = nullptr;
+  llvm::StringRef Strings;
+
+  uint32_t read(const char *Record, unsigned Field) const;
+  llvm::StringRef getString(uint32_t Offset) const;
+};
+
+#endif // LLVM_CLANG_3C_SOLUTIONFILE_H
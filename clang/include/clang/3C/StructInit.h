@@ -28,13 +28,16 @@
 using namespace clang;
 using namespace llvm;
 
-class StructVariableInitializer
-    : public RecursiveASTVisitor<StructVariableInitializer> {
+// Adds initializers to the struct variables declared in a DeclStmt that have
+// checked pointer members. This is not a visitor of its own: the
+// FunctionDeclBuilder calls it for each DeclStmt it visits, so that the
+// declarations are only traversed once.
+class StructVariableInitializer {
 public:
   explicit StructVariableInitializer(ASTContext *C, ProgramInfo &I, RSet &R)
       : Context(C), I(I), RewriteThese(R), RecordsWithCPointers() {}
 
-  bool VisitDeclStmt(DeclStmt *S);
+  void addInitializers(DeclStmt *S);
 
 private:
   bool hasCheckedMembers(DeclaratorDecl *DD);
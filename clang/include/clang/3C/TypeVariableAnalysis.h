@@ -14,32 +14,41 @@
 #include "clang/3C/ConstraintResolver.h"
 #include "clang/3C/ConstraintVariables.h"
 #include "clang/3C/ProgramInfo.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include <set>
 
 class TypeVariableEntry {
 public:
   // Note: does not initialize TyVarType!
-  TypeVariableEntry() : IsConsistent(false), TypeParamConsVar(nullptr) {}
-  TypeVariableEntry(QualType Ty, std::set<ConstraintVariable *> &CVs,
+  TypeVariableEntry()
+      : IsConsistent(false), TypeParamConsVar(nullptr), NumUnifiedConsVars(0) {}
+  TypeVariableEntry(QualType Ty, const std::set<ConstraintVariable *> &CVs,
                     bool ForceInconsistent = false)
-      : TypeParamConsVar(nullptr) {
+      : TypeParamConsVar(nullptr), NumUnifiedConsVars(0) {
     // We'll need a name to provide the type arguments during rewriting, so no
     // anonymous types are allowed.
     IsConsistent = !ForceInconsistent &&
                    (Ty->isPointerType() || Ty->isArrayType()) &&
                    !isTypeAnonymous(Ty->getPointeeOrArrayElementType());
     TyVarType = Ty;
-    ArgConsVars = CVs;
+    insertConstraintVariables(CVs);
   }
 
   bool getIsConsistent() const;
   QualType getType();
-  std::set<ConstraintVariable *> &getConstraintVariables();
+  bool hasTypeParamConsVar() const { return TypeParamConsVar != nullptr; }
   ConstraintVariable *getTypeParamConsVar();
 
-  void insertConstraintVariables(std::set<ConstraintVariable *> &CVs);
+  // Get the constraint variables that have not been unified with the type
+  // variable yet, i.e., those added since the last call, or all of them if the
+  // entry has become inconsistent since then.
+  llvm::ArrayRef<ConstraintVariable *> takeNewConstraintVariables();
+
+  void insertConstraintVariables(const std::set<ConstraintVariable *> &CVs);
   void setTypeParamConsVar(ConstraintVariable *CV);
-  void updateEntry(QualType Ty, std::set<ConstraintVariable *> &CVs);
+  void updateEntry(QualType Ty, const std::set<ConstraintVariable *> &CVs);
 
 private:
   // Is this type variable instantiated consistently. True when all uses have
@@ -52,12 +61,18 @@ private:
   QualType TyVarType;
 
   // Collection of constraint variables generated for all uses of the type
-  // variable. Also should not be used when IsConsistent is false.
-  std::set<ConstraintVariable *> ArgConsVars;
+  // variable, without duplicates, in the order they were added. A call
+  // rarely has more than a few uses of a type variable, so a flat vector is
+  // cheaper than a set.
+  llvm::SmallVector<ConstraintVariable *, 2> ArgConsVars;
 
   // A single constraint variable for solving the checked type of the type
   // variable. It is constrained GEQ all elements of ArgConsVars.
   ConstraintVariable *TypeParamConsVar;
+
+  // The number of elements at the front of ArgConsVars that have been
+  // unified with the type variable.
+  unsigned NumUnifiedConsVars;
 };
 
 // Stores the instantiated type for each type variables. This map has
@@ -65,7 +80,7 @@ private:
 // typed parameter. The values in the map are another maps from type variable
 // index in the called function's parameter list to the type the type variable
 // becomes (or null if it is not used consistently).
-typedef std::map<CallExpr *, std::map<unsigned int, TypeVariableEntry>>
+typedef llvm::DenseMap<CallExpr *, std::map<unsigned int, TypeVariableEntry>>
     TypeVariableMapT;
 
 // Abstract class exposing methods for accessing the type variable map in a
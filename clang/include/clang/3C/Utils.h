@@ -76,8 +76,6 @@ private:
   std::map<ValueT, KeyT> ValToK;
 };
 
-extern std::set<std::string> FilePaths;
-
 template <typename T> T getOnly(const std::set<T> &SingletonSet) {
   assert(SingletonSet.size() == 1);
   return (*SingletonSet.begin());
@@ -172,6 +170,10 @@ bool isCastSafe(clang::QualType DstType, clang::QualType SrcType);
 // PersistentSourceLoc can normally be assumed to be canonical.
 bool canWrite(const std::string &FilePath);
 
+// Check if the file of the provided location can be rewritten. The answer is
+// remembered for each file, so this is cheaper than the overload above.
+bool canWrite(const PersistentSourceLoc &PSL);
+
 // Check if the provided variable has void as one of its type.
 bool hasVoidType(clang::ValueDecl *D);
 // Check if the provided type has void as one of its type
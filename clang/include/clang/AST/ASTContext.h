@@ -72,6 +72,7 @@
 #include <iterator>
 #include <memory>
 #include <string>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -105,6 +106,7 @@ class DynTypedNode;
 class DynTypedNodeList;
 class Expr;
 class GlobalDecl;
+class LinearForm;
 class MangleContext;
 class MangleNumberingContext;
 class MaterializeTemporaryExpr;
@@ -310,6 +312,11 @@ class ASTContext : public RefCountedBase<ASTContext> {
   llvm::DenseMap<std::pair<const RecordDecl *, ArrayRef<const Type *> >, RecordDecl *>
     CachedTypeApps;
 
+  /// Index of CachedTypeApps by generic record decl, in the order in which the
+  /// type applications were cached.
+  /// e.g. List -> [List<int>, List<char>, ...]
+  llvm::DenseMap<const RecordDecl *, llvm::SmallVector<const RecordDecl *, 4> > CachedTypeAppsByBase;
+
   /// Mapping from RecordDecls to list of delayed type applications.
   /// The key is a declaration or definition of the generic RecordDecl, and the
   /// corresponding values all have the given RecordDecl as base.
@@ -1097,6 +1104,11 @@ public:
   ASTMutationListener *getASTMutationListener() const { return Listener; }
 
   void PrintStats() const;
+
+  /// Print the number of entries and the memory used by the tables and
+  /// caches that Checked C keeps in the ASTContext.
+  void PrintCheckedCStats() const;
+
   const SmallVectorImpl<Type *>& getTypes() const { return Types; }
 
   BuiltinTemplateDecl *buildBuiltinTemplateDecl(BuiltinTemplateKind BTK,
@@ -2838,6 +2850,15 @@ private:
   BoundsExpr *PrebuiltCountOne;
   BoundsExpr *PrebuiltBoundsUnknown;
 
+  // The element count bounds of string literals, keyed by the number of
+  // characters in the literal.
+  llvm::DenseMap<uint64_t, BoundsExpr *> StringLiteralCountBounds;
+
+  // The bounds annotations of declarations, uniqued by their bounds
+  // expression and interop type.
+  llvm::DenseMap<std::pair<BoundsExpr *, InteropTypeExpr *>,
+                 BoundsAnnotations *> UniquedBoundsAnnotations;
+
 public:
   bool EquivalentAnnotations(const BoundsAnnotations &Annots1,
                              const BoundsAnnotations &Annots2);
@@ -2851,6 +2872,116 @@ public:
   BoundsExpr *getPrebuiltCountOne();
   BoundsExpr *getPrebuiltBoundsUnknown();
 
+  /// \brief Get the element count bounds count(Length) of a string literal
+  /// with Length characters, excluding the null terminator.  String literals
+  /// of the same length share the bounds, so they must not be modified.
+  BoundsExpr *getStringLiteralCountBounds(uint64_t Length);
+
+  /// \brief Get the bounds annotations with the bounds expression Bounds and
+  /// the interop type IType.  Declarations with the same annotations share
+  /// them, so the annotations must not be modified.  Returns null if Bounds
+  /// and IType are both null.
+  const BoundsAnnotations *getUniquedBoundsAnnotations(BoundsExpr *Bounds,
+                                                       InteropTypeExpr *IType);
+
+  // Cache of the results of structurally comparing two expressions using
+  // Lexicographic without any equality facts. The cache is only valid while
+  // the expressions it contains are not modified, so it is only enabled
+  // while the bounds declarations of a function body are checked, and it is
+  // cleared when checking of the function body is complete.
+  typedef std::pair<const Expr *, const Expr *> ExprPairTy;
+  typedef llvm::DenseMap<ExprPairTy, Lexicographic::Result>
+    LexicographicCacheTy;
+
+  LexicographicCacheTy *getLexicographicCache() {
+    return LexicographicCacheEnabled ? &LexicographicCache : nullptr;
+  }
+
+  void enableLexicographicCache(bool Enable);
+
+  // Cache of the linear forms of expressions that are computed by
+  // Lexicographic::GetExprIntDiff and Lexicographic::GetDerefOffset.  Linear
+  // forms do not use equality facts, so the cache is enabled and cleared
+  // together with the lexicographic cache.
+  typedef llvm::DenseMap<const Expr *, std::unique_ptr<LinearForm>>
+    LinearFormCacheTy;
+
+  LinearFormCacheTy *getLinearFormCache() {
+    return LexicographicCacheEnabled ? &LinearFormCache : nullptr;
+  }
+
+  // Cache of the variables that occur in an expression, with the number of
+  // occurrences of each, that is used by ExprUtil::VariableOccurrenceCount
+  // and ExprUtil::LValueOccurrenceCount.  Each variable is represented by its
+  // canonical declaration.  The cache is enabled and cleared together with
+  // the lexicographic cache.
+  typedef llvm::SmallVector<std::pair<const ValueDecl *, unsigned>, 4>
+    VariableOccurrencesTy;
+  typedef llvm::DenseMap<const Expr *, VariableOccurrencesTy>
+    VariableOccurrenceCacheTy;
+
+  VariableOccurrenceCacheTy *getVariableOccurrenceCache() {
+    return LexicographicCacheEnabled ? &VariableOccurrenceCache : nullptr;
+  }
+
+private:
+  LexicographicCacheTy LexicographicCache;
+  LinearFormCacheTy LinearFormCache;
+  VariableOccurrenceCacheTy VariableOccurrenceCache;
+  bool LexicographicCacheEnabled = false;
+
+public:
+  // Tables of the expressions that are synthesized by ExprCreatorUtil while
+  // the bounds declarations of a function body are checked.  Checking builds
+  // the same integer literals, implicit casts and binary operators (for
+  // example, p + i when expanding count(i) bounds) over and over again, so
+  // each form is created once per function body and then shared.  Like the
+  // lexicographic cache, the tables are only enabled while a function body is
+  // checked and are cleared when checking of the function body is complete.
+  // The nodes themselves are allocated in the ASTContext, since they may be
+  // attached to the AST and used by code generation.
+  //
+  // ConcreteMemberBounds maps the declared bounds of a member, a member base
+  // expression and whether the member is accessed with an arrow to the
+  // bounds made concrete by Sema::MakeMemberBoundsConcrete (or null if they
+  // could not be made concrete).
+  struct SynthesizedExprTables {
+    typedef std::pair<QualType, llvm::APInt> IntegerLiteralKeyTy;
+    typedef std::tuple<unsigned, const Expr *, QualType> ImplicitCastKeyTy;
+    typedef std::tuple<unsigned, const Expr *, const Expr *>
+      BinaryOperatorKeyTy;
+    typedef std::tuple<const BoundsExpr *, const Expr *, unsigned>
+      MemberBoundsKeyTy;
+
+    llvm::DenseMap<IntegerLiteralKeyTy, IntegerLiteral *> IntegerLiterals;
+    llvm::DenseMap<ImplicitCastKeyTy, ImplicitCastExpr *> ImplicitCasts;
+    llvm::DenseMap<BinaryOperatorKeyTy, BinaryOperator *> BinaryOperators;
+    llvm::DenseMap<MemberBoundsKeyTy, BoundsExpr *> ConcreteMemberBounds;
+
+    void clear() {
+      IntegerLiterals.clear();
+      ImplicitCasts.clear();
+      BinaryOperators.clear();
+      ConcreteMemberBounds.clear();
+    }
+  };
+
+  SynthesizedExprTables *getSynthesizedExprTables() {
+    return SynthesizedExprsEnabled ? &SynthesizedExprs : nullptr;
+  }
+
+  void enableSynthesizedExprTables(bool Enable) {
+    SynthesizedExprsEnabled = Enable;
+    if (!Enable)
+      SynthesizedExprs.clear();
+  }
+
+private:
+  SynthesizedExprTables SynthesizedExprs;
+  bool SynthesizedExprsEnabled = false;
+
+public:
+
   // Track the set of member bounds declarations that use a given
   // member path.   For each member bounds declaration, we store the
   // field with the declaration, not the member bound itself.
@@ -2880,10 +3011,18 @@ public:
   };
 
   typedef llvm::TinyPtrVector<const FieldDecl*> MemberDeclVector;
+  typedef std::map<MemberPath, MemberDeclVector, PathCompare>
+    MemberBoundsUsesTy;
 private:
-  std::map<MemberPath, MemberDeclVector, PathCompare> UsingBounds;
+  MemberBoundsUsesTy UsingBounds;
 
 public:
+  /// \brief All of the member paths used by member bounds declarations,
+  /// with the members whose bounds use them.
+  const MemberBoundsUsesTy &getMemberBoundsUses() const {
+    return UsingBounds;
+  }
+
   typedef MemberDeclVector::const_iterator member_bounds_iterator;
   member_bounds_iterator using_member_bounds_begin(const MemberPath &Path) const;
   member_bounds_iterator using_member_bounds_end(const MemberPath &Path) const;
@@ -2897,6 +3036,38 @@ public:
   void addMemberBoundsUse(const MemberPath &MemberPath,
                           const FieldDecl *UsingBounds);
 
+  // The uses of the fields of a record in the declared bounds of their
+  // sibling fields, as pairs of a field F and a field of the same record in
+  // whose declared bounds F occurs.  A field with count bounds occurs in its
+  // own bounds.  Only fields that are named directly (not through a member
+  // expression) are included, and the fields of nested records belong to
+  // the nested records.
+  typedef SmallVector<std::pair<const FieldDecl *, const FieldDecl *>, 4>
+    SiblingFieldBoundsUsesTy;
+  typedef llvm::DenseMap<const RecordDecl *, SiblingFieldBoundsUsesTy>
+    SiblingFieldBoundsUsesMapTy;
+private:
+  SiblingFieldBoundsUsesMapTy SiblingFieldBoundsUses;
+
+public:
+  /// \brief Get the sibling field bounds uses of the fields of \p RD.  They
+  /// are computed the first time they are asked for and shared by all of
+  /// the functions that use \p RD.  The result is empty for a record that is
+  /// not completely defined, and is only valid until the uses of another
+  /// record are computed or added.
+  const SiblingFieldBoundsUsesTy &
+  getSiblingFieldBoundsUses(const RecordDecl *RD);
+
+  /// \brief All of the records whose sibling field bounds uses are known.
+  const SiblingFieldBoundsUsesMapTy &getAllSiblingFieldBoundsUses() const {
+    return SiblingFieldBoundsUses;
+  }
+
+  /// \brief Note the sibling field bounds uses of \p RD that were read from
+  /// an AST file, unless they are already known.
+  void addSiblingFieldBoundsUses(const RecordDecl *RD,
+                                 SiblingFieldBoundsUsesTy Uses);
+
   /// \brief Given an InteropTypeExpr pointer, return the interop type.
   /// Adjust the type if the type is for a parameter.  Return a null QualType
   /// if the pointer is null.
@@ -3327,9 +3498,7 @@ public:
   RecordDecl *getCachedTypeApp(const RecordDecl *Base, ArrayRef<const Type *> TypeArgs);
 
   /// Return all type applications that have the given generic decl as base.
-  /// This is currently slow since it iterates over all cached type applications.
-  /// TODO: improve its efficiency. See issues/644.
-  std::vector<const RecordDecl *> getTypeAppsWithBase(const RecordDecl *Base);
+  ArrayRef<const RecordDecl *> getTypeAppsWithBase(const RecordDecl *Base) const;
 
   /// Add the instantiated record type 'Inst' as the result of the type application 'Base<TypeArgs>'.
   /// Cached applications shouldn't be overwritten, so this should be called at most once per key.
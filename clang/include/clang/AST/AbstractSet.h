@@ -17,6 +17,7 @@
 #define LLVM_CLANG_ABSTRACT_SET_H
 
 #include <set>
+#include "llvm/Support/Allocator.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/CanonBounds.h"
 #include "clang/AST/Expr.h"
@@ -78,16 +79,44 @@ namespace clang {
 
     // The comparison between two AbstractSets is the same as the
     // lexicographic comparison between their CanonicalForms.
-    Result Compare(AbstractSet &Other) const {
+    Result Compare(const AbstractSet &Other) const {
       return CanonicalForm.Compare(Other.CanonicalForm);
     }
 
-    bool operator<(AbstractSet &Other) const {
+    // Compares the CanonicalForm of this AbstractSet with the canonical
+    // form P of an lvalue expression.
+    Result Compare(const PreorderAST &P) const {
+      return CanonicalForm.Compare(P);
+    }
+
+    bool operator<(const AbstractSet &Other) const {
       return Compare(Other) == Result::LessThan;
     }
-    bool operator==(AbstractSet &Other) const {
+    bool operator==(const AbstractSet &Other) const {
       return Compare(Other) == Result::Equal;
     }
+
+    // Releases the nodes of the CanonicalForm.
+    void Cleanup() {
+      CanonicalForm.Cleanup();
+    }
+  };
+
+  // Orders AbstractSets by their CanonicalForms.  The comparer is
+  // transparent so that a set of AbstractSets can be searched with the
+  // canonical form of an lvalue expression without creating an AbstractSet.
+  struct AbstractSetComparer {
+    typedef void is_transparent;
+
+    bool operator()(const AbstractSet *A, const AbstractSet *B) const {
+      return *A < *B;
+    }
+    bool operator()(const AbstractSet *A, const PreorderAST &P) const {
+      return A->Compare(P) == Result::LessThan;
+    }
+    bool operator()(const PreorderAST &P, const AbstractSet *A) const {
+      return A->Compare(P) == Result::GreaterThan;
+    }
   };
 
   class AbstractSetManager {
@@ -107,21 +136,32 @@ namespace clang {
     // be sufficient. We choose the first use of V.
     VarUsageTy &VarUses;
 
-    // Maintain a sorted set of PreorderASTs that have been created while
+    // Maintain a sorted set of the AbstractSets that have been created while
     // traversing a function. A binary search in this set is used to determine
     // whether an lvalue expression belongs to an existing AbstractSet (an
-    // AbstractSet whose CanonicalForm is in the SortedPreorderASTs set).
-    // An std::set is used for this set since std::sets are sorted by default.
-    // Here, the PreorderASTComparer is used to sort the PreorderASTs
-    // lexicographically. This avoids the need for a linear search through
-    // SortedPreorderASTs in GetOrCreateAbstractSet.
-    std::set<PreorderAST *, PreorderASTComparer> SortedPreorderASTs;
-
-    // Map each PreorderAST P that has been created while traversing a function
-    // to the AbstractSet whose CanonicalForm is P. This is used to retrieve
-    // the AbstractSet whose CanonicalForm already exists in SortedPreorderASTs
-    // (if any).
-    llvm::DenseMap<PreorderAST *, const AbstractSet *> PreorderASTAbstractSetMap;
+    // AbstractSet whose CanonicalForm is equivalent to the canonical form of
+    // the lvalue expression). An std::set is used for this set since
+    // std::sets are sorted by default. Here, the AbstractSetComparer is used
+    // to sort the AbstractSets lexicographically by their CanonicalForms.
+    // This avoids the need for a linear search through SortedAbstractSets in
+    // GetOrCreateAbstractSet.
+    //
+    // The AbstractSets are not ordered by a hash of their CanonicalForms,
+    // since lexicographically equal leaf expressions may differ structurally
+    // (for example, parameters are compared by position and uses of
+    // expression temporaries are equal to their binding expressions).
+    std::set<const AbstractSet *, AbstractSetComparer> SortedAbstractSets;
+
+    // Map each lvalue expression E that has been looked up while traversing a
+    // function to the AbstractSet that contains E. The AST is not modified
+    // while a function is checked, so the AbstractSet for E never changes.
+    // This avoids creating and normalizing a canonical form for E each time
+    // the same expression (for example, the use of a VarDecl in VarUses) is
+    // looked up.
+    llvm::DenseMap<const Expr *, const AbstractSet *> ExprAbstractSetMap;
+
+    // Storage for the AbstractSets created while traversing a function.
+    llvm::SpecificBumpPtrAllocator<AbstractSet> AbstractSetAllocator;
 
   public:
     AbstractSetManager(Sema &S, VarUsageTy &VarUses) :
@@ -142,13 +182,11 @@ namespace clang {
 
     // Clears the storage of the PreorderASTs and AbstractSets.
     void Clear() {
-      for (const auto &Pair : PreorderASTAbstractSetMap) {
-        Pair.first->Cleanup();
-        delete Pair.first;
-        delete Pair.second;
-      }
-      SortedPreorderASTs.clear();
-      PreorderASTAbstractSetMap.clear();
+      for (const AbstractSet *A : SortedAbstractSets)
+        const_cast<AbstractSet *>(A)->Cleanup();
+      SortedAbstractSets.clear();
+      ExprAbstractSetMap.clear();
+      AbstractSetAllocator.DestroyAll();
     }
   };
 } // end namespace clang
@@ -31,6 +31,7 @@
 #include "clang/Basic/OpenMPKinds.h"
 #include "clang/Basic/Sanitizers.h"
 #include "clang/Basic/SourceLocation.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
@@ -58,6 +59,18 @@ namespace clang {
     EquivExprSets *EquivExprs;
     bool Trace;
 
+    // EquivClasses maps an expression to the indices of the sets in
+    // EquivExprs that contain an expression that is equivalent to it.  An
+    // expression is looked up in EquivExprs at most once per Lexicographic
+    // object, so EquivExprs must not change during the lifetime of the
+    // object.
+    using EquivClassIndices = SmallVector<unsigned, 2>;
+    mutable llvm::DenseMap<const Expr *, EquivClassIndices> EquivClasses;
+
+    // Get the indices of the sets in EquivExprs that contain an expression
+    // that is equivalent to E (without using equality facts).
+    const EquivClassIndices &GetEquivClasses(const Expr *E) const;
+
     template <typename T>
     Lexicographic::Result Compare(const Expr *Raw1, const Expr *Raw2) const {
       const T *E1 = dyn_cast<T>(Raw1);
@@ -72,6 +85,10 @@ namespace clang {
     // they are not, return Current.
     Result CheckEquivExprs(Result Current, const Expr *E1, const Expr *E2) const;
 
+    // Compare E1 and E2, which have already had value-preserving operations
+    // removed.  CompareExpr handles caching of the results.
+    Result CompareExprImpl(Expr *E1, Expr *E2) const;
+
     Result CompareInteger(signed I1, signed I2) const;
     Result CompareInteger(unsigned I1, unsigned I2) const;
     Result CompareRelativeBoundsClause(const RelativeBoundsClause *RC1,
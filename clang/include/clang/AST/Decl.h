@@ -711,7 +711,10 @@ protected:
       : ValueDecl(DK, DC, L, N, T), DeclInfo(TInfo), InnerLocStart(StartL),
         Annotations(nullptr), NormalizedBounds(nullptr) {}
 
-  BoundsAnnotations *Annotations;
+  // The bounds annotations are immutable and are shared by all declarations
+  // with the same bounds expression and interop type (see
+  // ASTContext::getUniquedBoundsAnnotations).
+  const BoundsAnnotations *Annotations;
   BoundsExpr *NormalizedBounds;
 public:
   friend class ASTDeclReader;
@@ -829,12 +832,7 @@ public:
   /// \brief Set the bounds expression for this declaration. For function
   /// declarations, this is the return bounds of the function.
   void setBoundsExpr(ASTContext &Context, BoundsExpr *E) {
-     // If E is null and we have no annotations, do nothing.
-    if (!E && !Annotations)
-      return;
-    if (!Annotations)
-      Annotations = new (Context) BoundsAnnotations();
-    Annotations->setBoundsExpr(E);
+    setBoundsAnnotations(Context, BoundsAnnotations(E, getInteropTypeExpr()));
   }
 
   // \brief The bounds expression for this declaration, expanded to a
@@ -890,18 +888,10 @@ public:
   /// \brief Set the Checked C interop type for this declaration.  For function
   /// declarations, this is the return interop type of the function.
   void setInteropTypeExpr(ASTContext &Context, InteropTypeExpr *IT) {
-    // If IT is null and we have no annotations, do nothing.
-    if (!IT && !Annotations)
-      return;
-    if (!Annotations)
-      Annotations = new (Context) BoundsAnnotations();
-    Annotations->setInteropTypeExpr(IT);
+    setBoundsAnnotations(Context, BoundsAnnotations(getBoundsExpr(), IT));
   }
 
-  void setBoundsAnnotations(ASTContext &Context, BoundsAnnotations BA) {
-    setBoundsExpr(Context, BA.getBoundsExpr());
-    setInteropTypeExpr(Context, BA.getInteropTypeExpr());
-  }
+  void setBoundsAnnotations(ASTContext &Context, BoundsAnnotations BA);
 
   BoundsAnnotations getBoundsAnnotations() const {
     if (Annotations)
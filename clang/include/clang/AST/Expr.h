@@ -2192,6 +2192,8 @@ protected:
       : Expr(UnaryOperatorClass, Empty) {
     UnaryOperatorBits.Opc = UO_AddrOf;
     UnaryOperatorBits.HasFPFeatures = HasFPFeatures;
+    UnaryOperatorBits.BoundsCheckProvenSafe = false;
+    UnaryOperatorBits.BoundsCheckLowerProven = false;
   }
 
 public:
@@ -2367,6 +2369,32 @@ public:
   void setBoundsCheckKind(BoundsCheckKind Kind) {
     UnaryOperatorBits.BoundsCheckKind = Kind;
   }
+
+  /// \brief Return true if the compiler proved statically that the bounds
+  /// check of this expression always succeeds, so that it need not be
+  /// emitted.
+  bool isBoundsCheckProvenSafe() const {
+    return UnaryOperatorBits.BoundsCheckProvenSafe;
+  }
+
+  /// \brief Record whether the bounds check of this expression was proved
+  /// to always succeed.
+  void setBoundsCheckProvenSafe(bool ProvenSafe) {
+    UnaryOperatorBits.BoundsCheckProvenSafe = ProvenSafe;
+  }
+
+  /// \brief Return true if the compiler proved statically that the lower
+  /// bound comparison of the bounds check of this expression always
+  /// succeeds, so that only the upper bound needs to be checked.
+  bool isBoundsCheckLowerProven() const {
+    return UnaryOperatorBits.BoundsCheckLowerProven;
+  }
+
+  /// \brief Record whether the lower bound comparison of the bounds check
+  /// of this expression was proved to always succeed.
+  void setBoundsCheckLowerProven(bool LowerProven) {
+    UnaryOperatorBits.BoundsCheckLowerProven = LowerProven;
+  }
 };
 
 /// Helper class for OffsetOfExpr.
@@ -2692,12 +2720,17 @@ public:
     SubExprs[LHS] = lhs;
     SubExprs[RHS] = rhs;
     ArrayOrMatrixSubscriptExprBits.RBracketLoc = rbracketloc;
+    ArraySubscriptExprBits.BoundsCheckProvenSafe = false;
+    ArraySubscriptExprBits.BoundsCheckLowerProven = false;
     setDependence(computeDependence(this));
   }
 
   /// Create an empty array subscript expression.
   explicit ArraySubscriptExpr(EmptyShell Shell)
-    : Expr(ArraySubscriptExprClass, Shell), Bounds(nullptr) { }
+    : Expr(ArraySubscriptExprClass, Shell), Bounds(nullptr) {
+    ArraySubscriptExprBits.BoundsCheckProvenSafe = false;
+    ArraySubscriptExprBits.BoundsCheckLowerProven = false;
+  }
 
   /// An array access can be written A[4] or 4[A] (both are equivalent).
   /// - getBase() and getIdx() always present the normalized view: A[4].
@@ -2781,6 +2814,32 @@ public:
   void setBoundsCheckKind(BoundsCheckKind Kind) {
     ArraySubscriptExprBits.BoundsCheckKind = Kind;
   }
+
+  /// \brief Return true if the compiler proved statically that the bounds
+  /// check of this expression always succeeds, so that it need not be
+  /// emitted.
+  bool isBoundsCheckProvenSafe() const {
+    return ArraySubscriptExprBits.BoundsCheckProvenSafe;
+  }
+
+  /// \brief Record whether the bounds check of this expression was proved
+  /// to always succeed.
+  void setBoundsCheckProvenSafe(bool ProvenSafe) {
+    ArraySubscriptExprBits.BoundsCheckProvenSafe = ProvenSafe;
+  }
+
+  /// \brief Return true if the compiler proved statically that the lower
+  /// bound comparison of the bounds check of this expression always
+  /// succeeds, so that only the upper bound needs to be checked.
+  bool isBoundsCheckLowerProven() const {
+    return ArraySubscriptExprBits.BoundsCheckLowerProven;
+  }
+
+  /// \brief Record whether the lower bound comparison of the bounds check
+  /// of this expression was proved to always succeed.
+  void setBoundsCheckLowerProven(bool LowerProven) {
+    ArraySubscriptExprBits.BoundsCheckLowerProven = LowerProven;
+  }
 };
 
 /// MatrixSubscriptExpr - Matrix subscript expression for the MatrixType
@@ -70,6 +70,13 @@ public:
   static IntegerLiteral *CreateIntegerLiteral(ASTContext &Ctx,
                                               int Value, QualType Ty);
 
+  // Create an integer literal with the value Value and the type Ty.  While
+  // the synthesized expression tables of Ctx are enabled, the same literal is
+  // returned for equal values and types.
+  static IntegerLiteral *CreateSharedIntegerLiteral(ASTContext &Ctx,
+                                                    const llvm::APInt &Value,
+                                                    QualType Ty);
+
   // Determine if the mathemtical value of I (an unsigned integer) fits within
   // the range of Ty, a signed integer type. APInt requires that bitsizes
   // match exactly, so if I does fit, return an APInt via Result with exactly
@@ -153,6 +160,10 @@ public:
   // expression.
   static bool IsReturnValueExpr(Expr *E);
 
+  // ContainsBoundsTemporary returns true if E contains a use of a bounds
+  // temporary.  Such an expression cannot be profiled.
+  static bool ContainsBoundsTemporary(const Expr *E);
+
   // FindLValue returns true if the given lvalue expression occurs in E.
   static bool FindLValue(Sema &S, Expr *LValue, Expr *E);
 
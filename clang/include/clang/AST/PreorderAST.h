@@ -228,6 +228,8 @@ namespace clang {
 
 namespace clang {
   class PreorderAST {
+    friend class LinearForm;
+
   private:
     ASTContext &Ctx;
     Lexicographic Lex;
@@ -290,28 +292,6 @@ namespace clang {
     // @param[in] Parent is the parent of the node to be attached.
     void AttachNode(Node *N, Node *Parent);
 
-    // Get the deref offset from the DerefExpr. The offset represents the
-    // possible amount by which the bounds of an ntptr could be widened.
-    // @param[in] UpperExpr is the upper bounds expr for the ntptr.
-    // @param[in] DerefExpr is the dereferenced expr for the ntptr.
-    // @param[out] Offset is the offset from the base by which the pointer is
-    // dereferenced.
-    // return Returns a boolean indicating whether a valid offset exists. True
-    // means a valid offset was found and is present in the "Offset" parameter.
-    // False means a valid offset was not found.
-    bool GetDerefOffset(Node *UpperExpr, Node *DerefExpr,
-                        llvm::APSInt &Offset);
-
-    // Get the integer difference between expressions.
-    // @param[in] E1 is the first expression.
-    // @param[in] E2 is the second expression.
-    // @param[out] Offset is the integer difference between E1 and E2.
-    // @return Returns a boolean indicating whether the expressions are
-    // comparable. True means the expressions are comparable and their integer
-    // difference is present in the "Offset" parameter.  False means the
-    // expressions are not comparable.
-    bool GetExprIntDiff(Node *E1, Node *E2, llvm::APSInt &Offset);
-
     // Set Error in case an error occurs during transformation of the AST.
     void SetError() { Error = true; }
 
@@ -327,29 +307,6 @@ namespace clang {
     // transformation of the AST.
     void Normalize();
 
-    // Get the offset by which a pointer is dereferenced. This function is
-    // intended to be called from outside this class.
-    // @param[in] this is the first AST.
-    // @param[in] P is the second AST.
-    // @param[out] Offset is the dereference offset.
-    // @return Returns a bool indicating whether a valid dereference offset
-    // exists.
-    bool GetDerefOffset(PreorderAST &P, llvm::APSInt &Offset) {
-      return GetDerefOffset(/*UpperExpr*/ Root, /*DerefExpr*/ P.Root, Offset);
-    }
-
-    // Get the integer difference between two expressions represented as
-    // preorder ASTs. This function is intended to be called from outside this
-    // class.
-    // @param[in] this is the first AST.
-    // @param[in] P is the second AST.
-    // @param[out] Offset is the integer difference.
-    // @return Returns a bool indicating whether the two expressions are
-    // comparable.
-    bool GetExprIntDiff(PreorderAST &P, llvm::APSInt &Offset) {
-      return GetExprIntDiff(Root, P.Root, Offset);
-    }
-
     // Lexicographically compare the two ASTs. This is intended to be called
     // from outside this class and invokes Compare on the root nodes of the two
     // ASTs to recursively compare the AST nodes.
@@ -357,7 +314,7 @@ namespace clang {
     // @param[in] P is the second AST.
     // @return Returns a Lexicographic::Result indicating the comparison between
     // the two ASTs.
-    Result Compare(const PreorderAST P) const {
+    Result Compare(const PreorderAST &P) const {
       return Root->Compare(P.Root, Lex);
     }
 
@@ -374,7 +331,11 @@ namespace clang {
     // Cleanup the memory consumed by the AST. This is intended to be called
     // from outside this class and invokes Cleanup on the root node which
     // recursively deletes the AST.
-    void Cleanup() { Root->Cleanup(); }
+    void Cleanup() {
+      if (Root)
+        Root->Cleanup();
+      Root = nullptr;
+    }
 
     bool operator<(PreorderAST &Other) const {
       return Compare(Other) == Result::LessThan;
@@ -391,5 +352,61 @@ namespace clang {
     }
   };
 
+  // The linear form of an expression E is E normalized to
+  //   c_1 * t_1 + ... + c_n * t_n + k
+  // where the t_i are the distinct non-constant terms of the normalized
+  // preorder AST of E (for example, a pointer p or a variable i), the c_i are
+  // their non-zero integer coefficients and k is an integer constant.  Two
+  // expressions differ by an integer constant if they have the same terms
+  // with the same coefficients, so p + i + 1 and i + p + 3 differ by 2, and
+  // p + 2 * i and p + i + i are equal.
+  class LinearForm {
+  public:
+    struct Term {
+      // The factors of the term, e.g. i for 2 * i, or p for p.
+      llvm::SmallVector<const Node *, 1> Factors;
+      llvm::APSInt Coefficient;
+    };
+
+  private:
+    ASTContext &Ctx;
+    // The normalized preorder AST of the expression, which owns the nodes
+    // that are the factors of Terms.
+    PreorderAST AST;
+    bool Valid;
+    llvm::SmallVector<Term, 4> Terms;
+    llvm::APSInt Constant;
+
+    // Add Coefficient * Factors to the terms of the linear form.
+    // @return Returns false if the coefficient of the term overflows.
+    bool AddTerm(llvm::ArrayRef<Node *> Factors, llvm::APSInt Coefficient);
+
+    // Find the term of this linear form whose factors are equal to Factors.
+    // @return Returns the index of the term, or -1 if there is none.
+    int FindTerm(llvm::ArrayRef<const Node *> Factors) const;
+
+    // Convert the integer constant V to the width of an int.
+    // @return Returns false if V does not fit in an int.
+    bool ToIntWidth(llvm::APSInt &V) const;
+
+  public:
+    LinearForm(ASTContext &Ctx, Expr *E);
+    LinearForm(const LinearForm &) = delete;
+    LinearForm &operator=(const LinearForm &) = delete;
+    ~LinearForm() { AST.Cleanup(); }
+
+    // A linear form is not valid if an error occurred while normalizing the
+    // expression or if a coefficient or the constant overflows.
+    bool IsValid() const { return Valid; }
+
+    // Get the integer difference between this and Other.
+    // @param[in] this is the first linear form.
+    // @param[in] Other is the second linear form.
+    // @param[out] Offset is the integer difference this - Other.
+    // @return Returns a boolean indicating whether the two linear forms have
+    // the same terms, so that their difference is an integer constant.
+    bool GetIntDiff(const LinearForm &Other, llvm::APSInt &Offset) const;
+  };
+
 } // end namespace clang
 #endif
@@ -439,6 +439,8 @@ protected:
     unsigned HasFPFeatures : 1;
 
     unsigned BoundsCheckKind : NumBoundsCheckKindBits;
+    unsigned BoundsCheckProvenSafe : 1;
+    unsigned BoundsCheckLowerProven : 1;
 
     SourceLocation Loc;
   };
@@ -459,6 +461,8 @@ protected:
     unsigned : NumExprBits;
 
     unsigned BoundsCheckKind : NumBoundsCheckKindBits;
+    unsigned BoundsCheckProvenSafe : 1;
+    unsigned BoundsCheckLowerProven : 1;
     SourceLocation RBracketLoc;
   };
 
@@ -468,6 +472,8 @@ protected:
     unsigned : NumExprBits;
 
     unsigned BoundsCheckKind : NumBoundsCheckKindBits;
+    unsigned BoundsCheckProvenSafe : 1;
+    unsigned BoundsCheckLowerProven : 1;
     SourceLocation RBracketLoc;
   };
 
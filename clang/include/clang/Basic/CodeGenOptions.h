@@ -105,6 +105,24 @@ public:
     ProfileCSIRInstr, // IR level PGO context sensitive instrumentation in LLVM.
   };
 
+  enum CheckedCDynamicCheckModeKind {
+    CheckedCCheckTrap,  // Failing dynamic checks trap.
+    CheckedCCheckCount  // Failing dynamic checks are counted per site and
+                        // execution continues.
+  };
+
+  /// The kinds of Checked C dynamic checks, which -fcheckedc-checks= can
+  /// enable separately.
+  enum CheckedCCheckKind {
+    CheckedCCheckNonNull = 1 << 0,       // Non-null checks.
+    CheckedCCheckRange = 1 << 1,         // Bounds checks of memory accesses.
+    CheckedCCheckCast = 1 << 2,          // Bounds cast checks.
+    CheckedCCheckNullTermWrite = 1 << 3, // Checks of writes through
+                                         // null-terminated pointers.
+    CheckedCCheckExplicit = 1 << 4,      // _Dynamic_check(cond).
+    CheckedCCheckAllKinds = (1 << 5) - 1
+  };
+
   enum EmbedBitcodeKind {
     Embed_Off,      // No embedded bitcode.
     Embed_All,      // Embed both bitcode and commandline in the output.
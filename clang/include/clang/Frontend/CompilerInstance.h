@@ -37,6 +37,7 @@ class TimerGroup;
 namespace clang {
 class ASTContext;
 class ASTReader;
+class BoundsCheckReuseCache;
 class CodeCompleteConsumer;
 class DiagnosticsEngine;
 class DiagnosticConsumer;
@@ -110,6 +111,10 @@ class CompilerInstance : public ModuleLoader {
   /// The semantic analysis object.
   std::unique_ptr<Sema> TheSema;
 
+  /// The cache of the Checked C bounds checking diagnostics that Sema reuses
+  /// with -fcheckedc-reuse-bounds-checks.
+  std::shared_ptr<BoundsCheckReuseCache> BoundsCheckReuse;
+
   /// The frontend timer group.
   std::unique_ptr<llvm::TimerGroup> FrontendTimerGroup;
 
@@ -504,6 +509,14 @@ public:
   std::unique_ptr<Sema> takeSema();
   void resetAndLeakSema();
 
+  /// setBoundsCheckReuseCache - Share the cache of the Checked C bounds
+  /// checking diagnostics with other compiler instances, for example ones
+  /// that parse later versions of the same file.  By default, each compiler
+  /// instance has its own cache.
+  void setBoundsCheckReuseCache(std::shared_ptr<BoundsCheckReuseCache> Cache) {
+    BoundsCheckReuse = std::move(Cache);
+  }
+
   /// }
   /// @name Module Management
   /// {
@@ -2103,6 +2103,7 @@ private:
                                       Decl *ThisDecl = nullptr);
   bool ConsumeAndStoreBoundsExpression(CachedTokens &Toks);
   bool ConsumeAndStoreWhereClause(CachedTokens &Toks);
+  bool IsCountOfEarlierParam();
 
   // Delay parse a return bounds expression in Toks.  Used to parse return
   // bounds after the return type has been constructed.  Stores the bounds
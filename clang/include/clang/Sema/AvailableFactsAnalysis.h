@@ -19,10 +19,13 @@
 #ifndef LLVM_AVAILABLE_FACTS_ANALYSIS_H
 #define LLVM_AVAILABLE_FACTS_ANALYSIS_H
 
-#include "clang/Analysis/Analyses/PostOrderCFGView.h"
 #include "clang/Analysis/CFG.h"
 #include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Sema/CheckedCFGContext.h"
 #include "clang/Sema/Sema.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include <queue>
 
 namespace clang {
@@ -36,48 +39,67 @@ namespace clang {
     Sema &S;
     CFG *Cfg;
     std::vector<std::pair<ComparisonSet, ComparisonSet>> Facts;
-    std::vector<int> BlockIDs;
+    // The block ordering of Cfg, set by Analyze.
+    const CheckedCFGContext *CFGCtx;
     std::size_t CurrentIndex;
     bool DumpFacts;
     ElevatedCFGBlock *UnreachableBlock;
+    // The number of block visits by the fixpoint computation.
+    unsigned NumBlockVisits;
 
+    // The dataflow sets of a block are bit vectors indexed by the number
+    // assigned to each distinct comparison in the function.
     class ElevatedCFGBlock {
     private:
       const CFGBlock *Block;
-      ComparisonSet In, OutThen, OutElse;
-      ComparisonSet Kill, GenThen, GenElse;
+      llvm::BitVector In, OutThen, OutElse;
+      llvm::BitVector Kill, GenThen, GenElse;
 
     public:
       ElevatedCFGBlock(const CFGBlock *Block) : Block(Block) {}
 
+      void Resize(unsigned NumComparisons) {
+        for (llvm::BitVector *BV : {&In, &OutThen, &OutElse,
+                                    &Kill, &GenThen, &GenElse})
+          BV->resize(NumComparisons);
+      }
+
       friend class AvailableFactsAnalysis;
     };
 
   public:
-    AvailableFactsAnalysis(Sema &S, CFG *Cfg) : S(S), Cfg(Cfg), CurrentIndex(0),
-      DumpFacts(S.getLangOpts().DumpExtractedComparisonFacts), UnreachableBlock(new ElevatedCFGBlock(nullptr)) {}
+    AvailableFactsAnalysis(Sema &S, CFG *Cfg) : S(S), Cfg(Cfg), CFGCtx(nullptr), CurrentIndex(0),
+      DumpFacts(S.getLangOpts().DumpExtractedComparisonFacts), UnreachableBlock(new ElevatedCFGBlock(nullptr)),
+      NumBlockVisits(0) {}
 
-    void Analyze();
+    // Compute the facts of each block of the CFG. CFGCtx must be the block
+    // ordering of the CFG and must outlive the analysis.
+    void Analyze(const CheckedCFGContext &CFGCtx);
     void Reset();
     void Next();
-    void GetFacts(std::pair<ComparisonSet, ComparisonSet> &Facts);
+    // Get the facts of the current block. The facts are not copied, so they
+    // are only valid until the next call to TakeFacts.
+    const std::pair<ComparisonSet, ComparisonSet> &GetFacts() const;
+    // Move the facts of the current block into Facts.  The facts of the
+    // block cannot be retrieved again.
+    void TakeFacts(std::pair<ComparisonSet, ComparisonSet> &Facts);
     void DumpComparisonFacts(raw_ostream &OS, std::string Title);
+    unsigned GetNumBlockVisits() const { return NumBlockVisits; }
 
   private:
-    ComparisonSet Difference(ComparisonSet& S1, ComparisonSet& S2);
-    ComparisonSet Union(ComparisonSet& S1, ComparisonSet& S2);
-    ComparisonSet Intersect(ComparisonSet& S1, ComparisonSet& S2);
-    bool Differ(ComparisonSet& S1, ComparisonSet& S2);
-    bool ContainsVariable(Comparison& I, const VarDecl *V);
+    void CollectVariables(const Comparison &C, std::set<const VarDecl *> &Vars);
     void ExtractComparisons(const Expr *E, ComparisonSet &ISet);
     void ExtractNegatedComparisons(const Expr *E, ComparisonSet &ISet);
     void CollectExpressions(const Stmt *St, std::set<const Expr *> &AllExprs);
-    void CollectDefinedVars(const Stmt *St, std::set<const VarDecl *> &DefinedVars);
-    void PrintComparisonSet(raw_ostream &OS, ComparisonSet &ISet, std::string Title);
+    void CollectDefinedVars(const Stmt *St,
+                            std::set<const VarDecl *> &DefinedVars,
+                            const llvm::SmallPtrSetImpl<const Stmt *> &Walked);
+    void PrintComparisonSet(raw_ostream &OS, const ComparisonSet &ISet, std::string Title);
     bool ContainsPointerDeref(const Expr *E);
     bool IsPointerDerefLValue(const Expr *E);
-    bool ContainsPointerAssignment(const Expr *E);
-    ElevatedCFGBlock* GetBlock(std::vector<ElevatedCFGBlock *>& Blocks, CFGBlock *I);
+    bool ContainsPointerAssignment(
+        const Expr *E, const llvm::SmallPtrSetImpl<const Stmt *> &Walked);
+    ElevatedCFGBlock* GetBlock(std::vector<ElevatedCFGBlock *>& Blocks, const CFGBlock *I);
     Expr *IgnoreParenNoOpLValueBitCasts(Expr *E);
   };
 }
@@ -0,0 +1,96 @@
+//===--- BoundsCheckReuseCache.h: Reused Checked C bounds diagnostics ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===------------------------------------------------------------------===//
+//
+//  This file defines the cache of the diagnostics issued while checking the
+//  bounds declarations of function bodies with -fcheckedc-reuse-bounds-checks.
+//  A compilation that parses a function whose text and dependencies have not
+//  changed issues the cached diagnostics again instead of checking the
+//  function body.
+//
+//===------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_BOUNDS_CHECK_REUSE_CACHE_H
+#define LLVM_CLANG_BOUNDS_CHECK_REUSE_CACHE_H
+
+#include "clang/Basic/Diagnostic.h"
+#include "llvm/ADT/StringMap.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace clang {
+  // A diagnostic issued while checking a function body, with its location
+  // and ranges stored as offsets from the start of the function, so that it
+  // can be issued again when the same function is parsed again.
+  struct ReusedBoundsDiagnostic {
+    struct Range {
+      unsigned Begin;
+      unsigned End;
+      bool IsTokenRange;
+    };
+    DiagnosticsEngine::Level Level;
+    unsigned ID;
+    std::string Message;
+    unsigned Offset;
+    std::vector<Range> Ranges;
+  };
+
+  // The diagnostics of the function bodies checked with
+  // -fcheckedc-reuse-bounds-checks, keyed on a hash of the text of each
+  // function, of the declarations it depends on and of the options that
+  // affect checking it.  A CompilerInstance owns a cache, which it passes to
+  // its Sema.  A tool that parses the same file repeatedly, such as clangd,
+  // can share one cache between the CompilerInstances that parse it, which
+  // may run on different threads.
+  class BoundsCheckReuseCache {
+  private:
+    // Clear the cache when it grows beyond this many functions, so that the
+    // entries of old versions of functions are eventually dropped.
+    static const unsigned MaxEntries = 16384;
+    std::mutex Mutex;
+    llvm::StringMap<std::vector<ReusedBoundsDiagnostic>> Entries;
+    // The number of lookups that found an entry and that did not.
+    unsigned NumHits = 0;
+    unsigned NumMisses = 0;
+
+  public:
+    bool Lookup(llvm::StringRef Key,
+                std::vector<ReusedBoundsDiagnostic> &Diags) {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      auto It = Entries.find(Key);
+      if (It == Entries.end()) {
+        ++NumMisses;
+        return false;
+      }
+      ++NumHits;
+      Diags = It->second;
+      return true;
+    }
+
+    void Insert(llvm::StringRef Key, std::vector<ReusedBoundsDiagnostic> Diags) {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      if (Entries.size() >= MaxEntries)
+        Entries.clear();
+      Entries[Key] = std::move(Diags);
+    }
+
+    unsigned getNumHits() {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      return NumHits;
+    }
+
+    unsigned getNumMisses() {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      return NumMisses;
+    }
+  };
+} // end namespace clang
+
+#endif
@@ -17,9 +17,9 @@
 #include "clang/AST/CanonBounds.h"
 #include "clang/AST/ExprUtils.h"
 #include "clang/AST/PrettyPrinter.h"
-#include "clang/Analysis/Analyses/PostOrderCFGView.h"
 #include "clang/Sema/BoundsUtils.h"
 #include "clang/Sema/CheckedCAnalysesPrepass.h"
+#include "clang/Sema/CheckedCFGContext.h"
 #include "clang/Sema/Sema.h"
 
 namespace clang {
@@ -63,20 +63,28 @@ namespace clang {
   using InvertibleStmtMapTy = llvm::DenseMap<const Stmt *,
                                              LValuesToReplaceInBoundsTy>;
 
+  // A mapping of an invertible statement and a bounds expression to the
+  // bounds expression obtained by replacing the modified LValue with the
+  // original LValue in it at the statement.
+  using ReplacedBoundsMapTy =
+    llvm::DenseMap<std::pair<const Stmt *, BoundsExpr *>, BoundsExpr *>;
+
   // A struct representing various information about the terminating condition
   // of a block.
   struct TermCondInfoTy {
     // The expression that dereferences a pointer or subscripts an array. For
     // example:
     // if (*(p + i) == 0) ==> DerefExpr = p + i
-    Expr *DerefExpr;
+    // DerefExpr is null if the block has no terminating condition or the
+    // condition does not dereference a pointer.
+    Expr *DerefExpr = nullptr;
 
     // Whether the terminating condition tests for a null value. For example:
     // if (*p == 0)   ==> IsCheckNull = True
     // if (*p != 0)   ==> IsCheckNull = False
     // if (*p == 'a') ==> IsCheckNull = False
     // if (*p != 'a') ==> IsCheckNull = True
-    bool IsCheckNull;
+    bool IsCheckNull = false;
   };
 
 } // end namespace clang
@@ -333,26 +341,57 @@ namespace clang {
       // A mapping of invertible statements to LValuesToReplaceInBoundsTy.
       InvertibleStmtMapTy InvertibleStmts;
 
-      ElevatedCFGBlock(const CFGBlock *B) : Block(B) {}
+      // The bounds computed for the invertible statements so far. The In of
+      // an invertible statement usually does not change between iterations
+      // of the fixpoint computation, so this avoids creating a new bounds
+      // expression for it in every iteration.
+      ReplacedBoundsMapTy ReplacedBounds;
+
+      // The position of the block in the reverse post order of the CFG.
+      unsigned RPONum;
+
+      ElevatedCFGBlock(const CFGBlock *B, unsigned RPONum) :
+        Block(B), RPONum(RPONum) {}
 
     }; // end of ElevatedCFGBlock class.
 
   private:
 
-    // BlockMapTy denotes the mapping from CFGBlocks to ElevatedCFGBlocks.
-    using BlockMapTy = llvm::DenseMap<const CFGBlock *, ElevatedCFGBlock *>;
-
-    // A queue of unique ElevatedCFGBlocks involved in the fixpoint of the
-    // dataflow analysis.
-    using WorkListTy = QueueSet<ElevatedCFGBlock>;
+    // BlockMapTy denotes the mapping from CFGBlocks to ElevatedCFGBlocks. It
+    // is indexed by block ID.
+    using BlockMapTy = std::vector<ElevatedCFGBlock *>;
+
+    // Orders ElevatedCFGBlocks by their position in the reverse post order of
+    // the CFG.
+    struct RPOOrder {
+      bool operator()(const ElevatedCFGBlock *A,
+                      const ElevatedCFGBlock *B) const {
+        return A->RPONum < B->RPONum;
+      }
+    };
+
+    // A set of unique ElevatedCFGBlocks involved in the fixpoint of the
+    // dataflow analysis. Blocks are always removed from the set in reverse
+    // post order so that, barring back edges, all preds of a block are
+    // processed before the block itself.
+    using WorkListTy = std::set<ElevatedCFGBlock *, RPOOrder>;
 
     // BlockMap maps a CFGBlock to an ElevatedCFGBlock. Given a CFGBlock it is
-    // used to lookup an ElevatedCFGBlock.
+    // used to lookup an ElevatedCFGBlock. The entries of the blocks that are
+    // not part of the analysis are null.
     BlockMapTy BlockMap;
 
     // AllNullTermPtrsInFunc denotes all variables in the function that are
     // pointers to null-terminated arrays.
     VarSetTy AllNullTermPtrsInFunc;
+
+    // The set returned by GetStmtIn and GetStmtOut for a block that is not
+    // part of the analysis.
+    const BoundsMapTy EmptyBounds;
+
+    // NumBlockVisits denotes the number of block visits by the fixpoint
+    // computation.
+    unsigned NumBlockVisits = 0;
   
   public:
     // Top is a special bounds expression that denotes the super set of all
@@ -371,7 +410,12 @@ namespace clang {
     // @param[in] FD is the current function.
     // @param[in] NestedStmts is a set of top-level statements that are nested
     // in another top-level statement.
-    void WidenBounds(FunctionDecl *FD, StmtSetTy NestedStmts);
+    // @param[in] CFGCtx is the block ordering of the CFG.
+    void WidenBounds(FunctionDecl *FD, StmtSetTy NestedStmts,
+                     const CheckedCFGContext &CFGCtx);
+
+    // Get the number of block visits by the fixpoint computation.
+    unsigned GetNumBlockVisits() const { return NumBlockVisits; }
 
     // Pretty print the widened bounds for all null-terminated arrays in the
     // current function.
@@ -408,7 +452,10 @@ namespace clang {
     // widened bounds after a statement.
     // @param[in] B is the current block.
     // @param[in] CurrStmt is the current statement.
-    BoundsMapTy GetStmtOut(const CFGBlock *B, const Stmt *CurrStmt) const;
+    // @return The Out set, which is valid until the next query for a
+    // statement of B.
+    const BoundsMapTy &GetStmtOut(const CFGBlock *B,
+                                  const Stmt *CurrStmt) const;
 
     // Get the In set for the statement. This set represents the bounds
     // widened before the statement.
@@ -416,7 +463,10 @@ namespace clang {
     // widened bounds before a statement.
     // @param[in] B is the current block.
     // @param[in] CurrStmt is the current statement.
-    BoundsMapTy GetStmtIn(const CFGBlock *B, const Stmt *CurrStmt) const;
+    // @return The In set, which is valid until the next query for a
+    // statement of B.
+    const BoundsMapTy &GetStmtIn(const CFGBlock *B,
+                                 const Stmt *CurrStmt) const;
 
     // Get the bounds that are widened in the current block before the current
     // statement and that are not killed by the current statement.
@@ -560,6 +610,16 @@ namespace clang {
     void UpdateAdjustedBounds(ElevatedCFGBlock *EB, const Stmt *CurrStmt,
                               BoundsMapTy &StmtOut) const;
 
+    // Get the ElevatedCFGBlock for a CFGBlock.
+    // @param[in] B is a CFGBlock.
+    // @return The ElevatedCFGBlock for B, or null if B is not part of the
+    // analysis.
+    ElevatedCFGBlock *GetElevatedBlock(const CFGBlock *B) const {
+      if (!B || B->getBlockID() >= BlockMap.size())
+        return nullptr;
+      return BlockMap[B->getBlockID()];
+    }
+
     // Order the blocks by block number to get a deterministic iteration order
     // for the blocks.
     // @return Blocks ordered by block number from higher to lower since block
@@ -82,6 +82,12 @@ namespace clang {
     // a deterministic iteration order we must remember to sort the keys as
     // well as the values.
     BoundsSiblingFieldsTy BoundsSiblingFields;
+
+    // HasNullTermPtrs is true if a function declares or uses a variable that
+    // is an _Nt_array_ptr or an _Nt_checked array, or contains a where clause
+    // that declares bounds. If HasNullTermPtrs is false, the bounds widening
+    // analysis cannot widen the bounds of any variable in the function.
+    bool HasNullTermPtrs = false;
   };
 } // end namespace clang
 #endif
@@ -0,0 +1,67 @@
+//===------- CheckedCFGContext.h - CFG ordering shared by Checked C -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines CheckedCFGContext, which holds the block ordering of the
+//  CFG of a function. The available facts analysis, the bounds widening
+//  analysis and bounds declaration checking all visit the blocks of the same
+//  CFG in reverse post order, so the ordering is computed once per function.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_CHECKED_CFG_CONTEXT_H
+#define LLVM_CLANG_CHECKED_CFG_CONTEXT_H
+
+#include "clang/Analysis/Analyses/PostOrderCFGView.h"
+#include "clang/Analysis/CFG.h"
+#include <vector>
+
+namespace clang {
+  class CheckedCFGContext {
+  private:
+    CFG *Cfg;
+
+    // The reachable blocks of Cfg. Iterating over POView visits the blocks in
+    // reverse post order.
+    PostOrderCFGView POView;
+
+    // RPONums[ID] is the position in the reverse post order of the block
+    // whose ID is ID, or -1 if the block is not reachable.
+    std::vector<int> RPONums;
+
+    // The number of reachable blocks.
+    unsigned NumReachableBlocks;
+
+  public:
+    CheckedCFGContext(CFG *Cfg) : Cfg(Cfg), POView(Cfg),
+      RPONums(Cfg->getNumBlockIDs(), -1), NumReachableBlocks(0) {
+      for (const CFGBlock *B : POView)
+        RPONums[B->getBlockID()] = NumReachableBlocks++;
+    }
+
+    CFG *getCFG() const { return Cfg; }
+
+    // Iterate over the reachable blocks in reverse post order.
+    PostOrderCFGView::const_iterator begin() const { return POView.begin(); }
+    PostOrderCFGView::const_iterator end() const { return POView.end(); }
+
+    unsigned getNumBlockIDs() const { return RPONums.size(); }
+    unsigned getNumReachableBlocks() const { return NumReachableBlocks; }
+
+    // Return the position of B in the reverse post order, or -1 if B is null
+    // or not reachable.
+    int getRPONum(const CFGBlock *B) const {
+      return B ? RPONums[B->getBlockID()] : -1;
+    }
+
+    bool isReachable(const CFGBlock *B) const { return getRPONum(B) != -1; }
+  };
+}
+
+#endif
@@ -89,6 +89,7 @@ namespace clang {
   class ParsedAttr;
   class BindingDecl;
   class BlockDecl;
+  class BoundsCheckReuseCache;
   class CapturedDecl;
   class CXXBasePath;
   class CXXBasePaths;
@@ -5868,6 +5869,12 @@ public:
                                NonModifyingContext::NMC_Unknown,
                             NonModifyingMessage = NMM_Error);
 
+  /// Results of CheckIsNonModifying.  The same bounds and argument
+  /// expressions are checked again each time they are used, and the
+  /// expressions live as long as the ASTContext.  A modifying expression is
+  /// still traversed again when diagnostics are requested for it.
+  llvm::DenseMap<const Expr *, bool> NonModifyingExprs;
+
   BoundsExpr *CheckNonModifyingBounds(BoundsExpr *Bounds, Expr *E);
 
   ExprResult ActOnFunctionTypeApplication(ExprResult TypeFunc, SourceLocation Loc, ArrayRef<TypeArgument> Args);
@@ -5914,8 +5921,29 @@ public:
   // Specifically, Partition II, section II.9.2 'Generics and recursive inheritance graphs'.
   bool DiagnoseExpandingCycles(RecordDecl *Base, SourceLocation Loc);
 
+  /// The out-edges of a type parameter in the expanding cycles graph: the type
+  /// parameters it flows into, each with 1 if the edge is expanding and 0
+  /// otherwise.
+  typedef llvm::SmallVector<std::pair<std::pair<const RecordDecl *, int>, char>, 4>
+    ExpandingCycleEdgeList;
+
+  /// Return the out-edges of the type parameter with the given index in the
+  /// given generic record decl. The edges of complete definitions are cached
+  /// across the translation unit; the result is only valid until the next call.
+  const ExpandingCycleEdgeList &
+  GetExpandingCycleEdges(std::pair<const RecordDecl *, int> TypeParam);
+
+  llvm::DenseMap<std::pair<const RecordDecl *, int>, ExpandingCycleEdgeList>
+    ExpandingCycleEdges;
+  ExpandingCycleEdgeList TemporaryExpandingCycleEdges;
+
   QualType SubstituteTypeArgs(QualType QT, ArrayRef<TypeArgument> TypeArgs);
 
+  /// Results of SubstituteTypeArgs, keyed by the opaque pointers of the type
+  /// and of each type argument, in that order. The keys are allocated in the
+  /// ASTContext.
+  llvm::DenseMap<ArrayRef<const void *>, QualType> SubstitutedTypeArgs;
+
   std::vector<const TypedefNameDecl *> FindFreeVariableDecls(QualType T);
 
   bool AbstractForFunctionType(BoundsAnnotations &BA,
@@ -5932,6 +5960,14 @@ public:
   BoundsExpr *ConcretizeFromFunctionTypeWithArgs(BoundsExpr *Bounds, ArrayRef<Expr *> Args,
                                                  NonModifyingContext ErrorKind,
                                                  NonModifyingMessage Message);
+  /// \brief Return the indices of the positional parameters that occur in
+  /// Bounds, in the order in which they are first visited.
+  ArrayRef<unsigned> GetPositionalParams(BoundsExpr *Bounds);
+
+  /// Results of GetPositionalParams.  The bounds expressions come from
+  /// function types, which live as long as the ASTContext.
+  llvm::DenseMap<const BoundsExpr *, SmallVector<unsigned, 4>>
+    BoundsPositionalParams;
 
   /// ConvertToFullyCheckedType: convert an expression E to a fully checked type. This
   /// is used to retype declrefs and member exprs in checked scopes with bounds-safe
@@ -5981,6 +6017,58 @@ public:
   /// body.
   void CheckFunctionBodyBoundsDecls(FunctionDecl *FD, Stmt *Body);
 
+  /// The cache of the diagnostics of the function bodies checked with
+  /// -fcheckedc-reuse-bounds-checks.  The CompilerInstance provides it only
+  /// with -fsyntax-only; without it, every function body is checked.
+  std::shared_ptr<BoundsCheckReuseCache> BoundsCheckReuse;
+
+  /// Function bodies whose bounds checking has been deferred to the end of
+  /// the translation unit (see -fcheckedc-deferred-bounds-checking).  The
+  /// bodies are kept in the order in which they were completed so that
+  /// diagnostics are emitted in source order, unless they are checked in
+  /// call graph order (see -fcheckedc-call-graph-order).
+  SmallVector<std::pair<FunctionDecl *, Stmt *>, 16>
+    DeferredBoundsCheckedFunctions;
+
+  /// Bodies of static inline functions in system headers, such as the Checked
+  /// C checked headers, whose bounds checking has been deferred to the end of
+  /// the translation unit.  Most of these functions are never used, so only
+  /// the bodies of the functions that are used by then are checked.
+  SmallVector<std::pair<FunctionDecl *, Stmt *>, 16>
+    DeferredHeaderInlineFunctions;
+
+  /// CanDeferHeaderInlineBoundsChecking - return true if FD is a static
+  /// inline function in a system header whose bounds checking can wait until
+  /// it is known whether FD is used.
+  bool CanDeferHeaderInlineBoundsChecking(const FunctionDecl *FD);
+
+  /// A top-level variable declaration whose bounds checking has been deferred
+  /// along with the function bodies, the checked scope in which it was
+  /// declared, and the number of function bodies deferred before it.
+  struct DeferredTopLevelBoundsDecl {
+    VarDecl *VD;
+    CheckedScopeSpecifier CSS;
+    unsigned NumFunctionsBefore;
+  };
+
+  /// Top-level variable declarations whose bounds checking has been deferred
+  /// to the end of the translation unit, in source order.  They are checked
+  /// in batches by one checker, between the function bodies that surround
+  /// them.
+  SmallVector<DeferredTopLevelBoundsDecl, 16> DeferredTopLevelBoundsDecls;
+
+  /// CheckDeferredFunctionBodyBoundsDecls - check bounds declarations within
+  /// all function bodies and top-level variable declarations whose checking
+  /// was deferred.  The bodies are checked serially, since checking a body
+  /// modifies the ASTContext and issues diagnostics.
+  void CheckDeferredFunctionBodyBoundsDecls();
+
+  /// OrderDeferredFunctionBodiesByCallGraph - sort the deferred function
+  /// bodies so that the bodies of the functions in each strongly connected
+  /// component of the call graph of the translation unit come after the
+  /// bodies of the functions that they call.
+  void OrderDeferredFunctionBodiesByCallGraph();
+
   /// CheckTopLevelBoundsDecls - check bounds declarations for variable declarations
   /// not within a function body.
   void CheckTopLevelBoundsDecls(VarDecl *VD);
@@ -6017,15 +6105,25 @@ public:
      typedef VarBoundsDecls::iterator VarBoundsIterator;
      typedef llvm::iterator_range<VarBoundsIterator> VarBoundsIteratorRange;
      // mapping from variables to bounds that depend upon the variables.
-     typedef std::map<VarDecl *, VarBoundsDecls> DependentMap;
+     typedef llvm::DenseMap<VarDecl *, VarBoundsDecls> DependentMap;
   private:
      // Map variables to the bounds declarations that are
      // in scope and depend upon them.
      DependentMap Map;
 
-     // Track the bounds that are in scope so that we can remove them from the
-     // dependent map when the scope is exited.
+     // Track the bounds that are in scope, outermost first.
      std::vector<VarDecl *> BoundsInScope;
+
+     // The variables to whose entries in Map a bounds declaration was
+     // appended, in the order of the appends.  Scopes nest, so the
+     // dependences of the innermost scope are always at the end of this
+     // list and at the end of the entries they were appended to.  Exiting a
+     // scope just pops them, without traversing the bounds expressions again.
+     std::vector<VarDecl *> AddedDependences;
+
+     // For each declaration in BoundsInScope, the size of AddedDependences
+     // before its dependences were added.
+     std::vector<unsigned> FirstDependence;
   public:
      BoundsDependencyTracker() {}
 
@@ -6039,6 +6137,9 @@ public:
      // scope.
      void Add(VarDecl *D);
 
+     // The declarations with bounds that are in scope, outermost first.
+     ArrayRef<VarDecl *> BoundsDeclsInScope() const { return BoundsInScope; }
+
     VarBoundsIteratorRange DependentBoundsDecls(VarDecl *D) {
       auto Iter = Map.find(D);
       if (Iter == Map.end())
@@ -6083,13 +6184,30 @@ public:
    DependentBounds Tracker;
   };
 
+  /// \brief The expressions, declaration statements and return statements
+  /// of a function body that are in checked scopes, mapped to the kind of
+  /// checking of the enclosing scope.  Statements in unchecked scopes are
+  /// not recorded.
+  struct CheckedScopeStmts {
+    llvm::DenseMap<const Stmt *, CheckedScopeSpecifier> Specifiers;
+
+    CheckedScopeSpecifier lookup(const Stmt *S) const {
+      auto It = Specifiers.find(S);
+      return It == Specifiers.end() ? CheckedScopeSpecifier::CSS_Unchecked
+                                    : It->second;
+    }
+  };
+
   /// \brief Compute a mapping from statements that modify lvalues to
   /// in-scope bounds declarations that depend on those lvalues.
   /// FD is the function being declared and Body is the body of the
   /// function.   They are passed in separately because Body hasn't
-  /// been attached to FD yet.
+  /// been attached to FD yet.  If CheckedStmts is non-null, the
+  /// statements of Body that are in checked scopes are collected in it
+  /// during the same traversal.
   void ComputeBoundsDependencies(ModifiedBoundsDependencies &Tracker,
-                                 FunctionDecl *FD, Stmt *Body);
+                                 FunctionDecl *FD, Stmt *Body,
+                                 CheckedScopeStmts *CheckedStmts = nullptr);
 
   /// \brief Traverse a function in order to gather information that is
   /// used by different Checked C analyses such as bounds declaration
@@ -6137,6 +6255,11 @@ public:
     // The number of AbstractSets created for MemberExprs when synthesizing
     // members during bounds checking.
     int NumSynthesizedMemberAbstractSets = 0;
+
+    // The number of calls to SubstituteTypeArgs, and the number of them that
+    // were answered from SubstitutedTypeArgs.
+    int NumTypeArgSubstitutions = 0;
+    int NumCachedTypeArgSubstitutions = 0;
   };
 
   struct CheckedCProfileStats CheckedCStats;
@@ -12070,6 +12193,10 @@ public:
   /// apply the rewrite to function types nested within the type.
   QualType RewriteBoundsSafeInterfaceTypes(QualType Ty);
 
+  /// Results of RewriteBoundsSafeInterfaceTypes, keyed by the opaque pointer
+  /// of the type that was rewritten.
+  llvm::DenseMap<void *, QualType> RewrittenBoundsSafeInterfaceTypes;
+
   /// \brief Get the bounds-safe interface type for LHS.
   /// Returns a null QualType if there isn't one.
   QualType GetCheckedCLValueInteropType(ExprResult LHS);
@@ -695,6 +695,18 @@ public:
 
       /// Record code for \#pragma float_control options.
       FLOAT_CONTROL_PRAGMA_OPTIONS = 65,
+
+      /// Record code for the member paths used by Checked C member bounds
+      /// declarations.
+      CHECKED_C_MEMBER_BOUNDS_USES = 66,
+
+      /// Record code for the file-scope variables whose Checked C bounds
+      /// declarations depend on other variables.
+      CHECKED_C_GLOBAL_BOUNDS_DECLS = 67,
+
+      /// Record code for the uses of the fields of records in the Checked C
+      /// bounds declarations of their sibling fields.
+      CHECKED_C_SIBLING_FIELD_BOUNDS_USES = 68,
     };
 
     /// Record types used within a source manager block.
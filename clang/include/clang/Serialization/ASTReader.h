@@ -914,6 +914,26 @@ private:
   /// Sema tracks these to emit deferred diags.
   SmallVector<uint64_t, 4> DeclsToCheckForDeferredDiags;
 
+  /// The member paths used by Checked C member bounds declarations, and the
+  /// members whose bounds use them.
+  ///
+  /// Each entry is the length of a member path, the IDs of the members on
+  /// the path, the number of members whose bounds use the path and their
+  /// IDs.  The entries are added to the ASTContext when Sema is updated.
+  SmallVector<uint64_t, 16> CheckedCMemberBoundsUses;
+
+  /// The IDs of the file-scope variables with Checked C bounds declarations,
+  /// whose dependencies are added to Sema when Sema is updated.
+  SmallVector<uint64_t, 16> CheckedCGlobalBoundsDecls;
+
+  /// The uses of fields in the Checked C bounds declarations of their sibling
+  /// fields.
+  ///
+  /// Each entry is the ID of a record, the number of uses and the IDs of the
+  /// used field and the field with bounds of each use.  The entries are
+  /// added to the ASTContext when Sema is updated.
+  SmallVector<uint64_t, 16> CheckedCSiblingFieldBoundsUses;
+
 
 public:
   struct ImportedSubmodule {
@@ -15,9 +15,14 @@
 #include "clang/3C/ConstraintBuilder.h"
 #include "clang/3C/IntermediateToolHook.h"
 #include "clang/3C/RewriteUtils.h"
+#include "clang/3C/SolutionFile.h"
 #include "clang/Frontend/VerifyDiagnosticConsumer.h"
 #include "clang/Tooling/ArgumentsAdjusters.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/VirtualFileSystem.h"
 
 using namespace clang::driver;
 using namespace clang::tooling;
@@ -36,37 +41,20 @@ static cl::opt<bool>
                    cl::desc("Dump array bounds inference graph"),
                    cl::init(false), cl::cat(ArrBoundsInferCat));
 
-bool DumpIntermediate;
-bool Verbose;
-std::string OutputPostfix;
-std::string OutputDir;
-std::string ConstraintOutputJson;
-std::vector<std::string> AllocatorFunctions;
-bool DumpStats;
-bool HandleVARARGS;
-bool EnablePropThruIType;
-bool ConsiderAllocUnsafe;
-std::string StatsOutputJson;
-std::string WildPtrInfoJson;
-std::string PerWildPtrInfoJson;
-bool AllTypes;
-std::string BaseDir;
-bool AddCheckedRegions;
-bool EnableCCTypeChecker;
-bool WarnRootCause;
-bool WarnAllRootCause;
-std::set<std::string> FilePaths;
-bool DumpUnwritableChanges;
-bool AllowUnwritableChanges;
-bool AllowRewriteFailures;
+// The options of the conversion that is running on this thread.
+static thread_local const _3CGlobalOptions *CurrentOptions = nullptr;
 
-#ifdef FIVE_C
-bool RemoveItypes;
-bool ForceItypes;
-#endif
+const _3CGlobalOptions &get3COptions() {
+  static const _3CGlobalOptions DefaultOptions;
+  return CurrentOptions ? *CurrentOptions : DefaultOptions;
+}
 
-static CompilationDatabase *CurrCompDB = nullptr;
-static tooling::CommandLineArguments SourceFiles;
+_3COptionsScope::_3COptionsScope(const _3CGlobalOptions &Opts)
+    : Saved(CurrentOptions) {
+  CurrentOptions = &Opts;
+}
+
+_3COptionsScope::~_3COptionsScope() { CurrentOptions = Saved; }
 
 // _3CDiagnosticConsumer is a wrapper DiagnosticConsumer that delays the
 // EndSourceFile callback until 3C's analysis is complete, making it possible to
@@ -180,6 +168,17 @@ public:
 class _3CASTBuilderAction : public ToolAction {
   std::vector<std::unique_ptr<ASTUnit>> &ASTs;
 
+  // Make Path absolute relative to the working directory of the compilation.
+  // When the source files are parsed in parallel, each ClangTool has its own
+  // file system with its own working directory, which may differ from the
+  // working directory of the process.
+  static std::string makeAbsolute(FileManager &Files, StringRef Path) {
+    SmallString<255> AbsPath(Path);
+    if (Files.getVirtualFileSystem().makeAbsolute(AbsPath))
+      return std::string(Path);
+    return std::string(AbsPath.str());
+  }
+
 public:
   _3CASTBuilderAction(std::vector<std::unique_ptr<ASTUnit>> &ASTs)
       : ASTs(ASTs) {}
@@ -193,7 +192,7 @@ public:
     // a LibTooling ArgumentsAdjuster, but we access the options in their parsed
     // data structure rather than as strings, so it is much more robust.
 
-    if (!EnableCCTypeChecker)
+    if (!get3COptions().EnableCCTypeChecker)
       // Corresponds to the -f3c-tool compiler option.
       Invocation->LangOpts->_3C = true;
 
@@ -215,7 +214,7 @@ public:
       FrontendInputFile &OldInput = *Iter;
       // getFile will assert that the input is a file, which should be true for
       // 3C.
-      std::string OldPath = std::string(OldInput.getFile()), NewPath;
+      std::string OldPath = makeAbsolute(*Files, OldInput.getFile()), NewPath;
       std::error_code EC = tryGetCanonicalFilePath(OldPath, NewPath);
       if (EC) {
         // If the compilation database specifies a bogus, inaccessible file,
@@ -240,7 +239,7 @@ public:
     for (auto It = HeaderOpts.UserEntries.begin();
          It != HeaderOpts.UserEntries.end();) {
       HeaderSearchOptions::Entry &Entry = *It;
-      std::string OldPath = Entry.Path, NewPath;
+      std::string OldPath = makeAbsolute(*Files, Entry.Path), NewPath;
       std::error_code EC = tryGetCanonicalFilePath(OldPath, NewPath);
       if (EC) {
         // Normally, if an -I directory isn't accessible, Clang seems to ignore
@@ -280,10 +279,38 @@ public:
   }
 };
 
+// A compilation database that only has the first compile command of each file
+// of another database. A build that compiles a source file for several
+// targets lists it once for each of them, but 3C only needs one AST of the
+// file, since ProgramInfo::link merges the declarations of the others anyway.
+class FirstCompileCommandDatabase : public CompilationDatabase {
+  CompilationDatabase &Base;
+
+public:
+  FirstCompileCommandDatabase(CompilationDatabase &Base) : Base(Base) {}
+
+  std::vector<CompileCommand>
+  getCompileCommands(StringRef FilePath) const override {
+    std::vector<CompileCommand> Commands = Base.getCompileCommands(FilePath);
+    if (Commands.size() > 1) {
+      if (get3COptions().Verbose)
+        errs() << "Ignoring " << Commands.size() - 1
+               << " more compile commands for " << FilePath << "\n";
+      Commands.resize(1);
+    }
+    return Commands;
+  }
+
+  std::vector<std::string> getAllFiles() const override {
+    return Base.getAllFiles();
+  }
+};
+
 void dumpConstraintOutputJson(const std::string &PostfixStr,
                               ProgramInfo &Info) {
-  if (DumpIntermediate) {
-    std::string FilePath = ConstraintOutputJson + PostfixStr + ".json";
+  if (get3COptions().DumpIntermediate) {
+    std::string FilePath =
+        get3COptions().ConstraintOutputJson + PostfixStr + ".json";
     errs() << "Writing json output to:" << FilePath << "\n";
     std::error_code Ec;
     llvm::raw_fd_ostream OutputJson(FilePath, Ec);
@@ -299,7 +326,7 @@ void dumpConstraintOutputJson(const std::string &PostfixStr,
 void runSolver(ProgramInfo &Info, std::set<std::string> &SourceFiles) {
   Constraints &CS = Info.getConstraints();
 
-  if (Verbose) {
+  if (get3COptions().Verbose) {
     errs() << "Trying to capture Constraint Variables for all functions\n";
   }
 
@@ -310,7 +337,8 @@ void runSolver(ProgramInfo &Info, std::set<std::string> &SourceFiles) {
 
   clock_t StartTime = clock();
   CS.solve();
-  if (Verbose) {
+  Info.getPerfStats().SolverComponents = CS.getComponentStats();
+  if (get3COptions().Verbose) {
     errs() << "Solver time:" << getTimeSpentInSeconds(StartTime) << "\n";
   }
 }
@@ -331,33 +359,41 @@ _3CInterface::create(const struct _3COptions &CCopt,
 
 _3CInterface::_3CInterface(const struct _3COptions &CCopt,
                            const std::vector<std::string> &SourceFileList,
-                           CompilationDatabase *CompDB) {
-
-  DumpIntermediate = CCopt.DumpIntermediate;
-  Verbose = CCopt.Verbose;
-  OutputPostfix = CCopt.OutputPostfix;
-  OutputDir = CCopt.OutputDir;
-  ConstraintOutputJson = CCopt.ConstraintOutputJson;
-  StatsOutputJson = CCopt.StatsOutputJson;
-  WildPtrInfoJson = CCopt.WildPtrInfoJson;
-  PerWildPtrInfoJson = CCopt.PerPtrInfoJson;
-  DumpStats = CCopt.DumpStats;
-  HandleVARARGS = CCopt.HandleVARARGS;
-  EnablePropThruIType = CCopt.EnablePropThruIType;
-  BaseDir = CCopt.BaseDir;
-  AllTypes = CCopt.EnableAllTypes;
-  AddCheckedRegions = CCopt.AddCheckedRegions;
-  EnableCCTypeChecker = CCopt.EnableCCTypeChecker;
-  AllocatorFunctions = CCopt.AllocatorFunctions;
-  WarnRootCause = CCopt.WarnRootCause || CCopt.WarnAllRootCause;
-  WarnAllRootCause = CCopt.WarnAllRootCause;
-  DumpUnwritableChanges = CCopt.DumpUnwritableChanges;
-  AllowUnwritableChanges = CCopt.AllowUnwritableChanges;
-  AllowRewriteFailures = CCopt.AllowRewriteFailures;
+                           CompilationDatabase *CompDB)
+    : CompDB(CompDB) {
+
+  Opts.DumpIntermediate = CCopt.DumpIntermediate;
+  Opts.Verbose = CCopt.Verbose;
+  Opts.OutputPostfix = CCopt.OutputPostfix;
+  Opts.OutputDir = CCopt.OutputDir;
+  Opts.OutputPatch = CCopt.OutputPatch;
+  Opts.ConstraintOutputJson = CCopt.ConstraintOutputJson;
+  Opts.StatsOutputJson = CCopt.StatsOutputJson;
+  Opts.WildPtrInfoJson = CCopt.WildPtrInfoJson;
+  Opts.PerWildPtrInfoJson = CCopt.PerPtrInfoJson;
+  Opts.DumpStats = CCopt.DumpStats;
+  Opts.DumpMemoryStats = CCopt.DumpMemoryStats;
+  Opts.DumpConstraintGraphStats = CCopt.DumpConstraintGraphStats;
+  Opts.HandleVARARGS = CCopt.HandleVARARGS;
+  Opts.EnablePropThruIType = CCopt.EnablePropThruIType;
+  Opts.BaseDir = CCopt.BaseDir;
+  Opts.AllTypes = CCopt.EnableAllTypes;
+  Opts.AddCheckedRegions = CCopt.AddCheckedRegions;
+  Opts.EnableCCTypeChecker = CCopt.EnableCCTypeChecker;
+  Opts.AllocatorFunctions = CCopt.AllocatorFunctions;
+  Opts.WarnRootCause = CCopt.WarnRootCause || CCopt.WarnAllRootCause;
+  Opts.WarnAllRootCause = CCopt.WarnAllRootCause;
+  Opts.DumpUnwritableChanges = CCopt.DumpUnwritableChanges;
+  Opts.AllowUnwritableChanges = CCopt.AllowUnwritableChanges;
+  Opts.AllowRewriteFailures = CCopt.AllowRewriteFailures;
+  Opts.ParseThreads = CCopt.ParseThreads;
+  Opts.SolveThreads = CCopt.SolveThreads;
+  Opts.SummaryOutput = CCopt.SummaryOutput;
+  Opts.SolutionOutput = CCopt.SolutionOutput;
 
 #ifdef FIVE_C
-  RemoveItypes = CCopt.RemoveItypes;
-  ForceItypes = CCopt.ForceItypes;
+  Opts.RemoveItypes = CCopt.RemoveItypes;
+  Opts.ForceItypes = CCopt.ForceItypes;
 #endif
 
   llvm::InitializeAllTargets();
@@ -367,13 +403,21 @@ _3CInterface::_3CInterface(const struct _3COptions &CCopt,
 
   ConstraintsBuilt = false;
 
-  if (OutputPostfix != "-" && !OutputDir.empty()) {
+  if (Opts.OutputPostfix != "-" && !Opts.OutputDir.empty()) {
     errs() << "3C initialization error: Cannot use both -output-postfix and "
               "-output-dir\n";
     ConstructionFailed = true;
     return;
   }
-  if (OutputPostfix == "-" && OutputDir.empty() && SourceFileList.size() > 1) {
+  if (!Opts.OutputPatch.empty() &&
+      (Opts.OutputPostfix != "-" || !Opts.OutputDir.empty())) {
+    errs() << "3C initialization error: Cannot use -output-patch with "
+              "-output-postfix or -output-dir\n";
+    ConstructionFailed = true;
+    return;
+  }
+  if (Opts.OutputPostfix == "-" && Opts.OutputDir.empty() &&
+      Opts.OutputPatch.empty() && SourceFileList.size() > 1) {
     errs() << "3C initialization error: Cannot specify more than one input "
               "file when output is to stdout\n";
     ConstructionFailed = true;
@@ -383,43 +427,48 @@ _3CInterface::_3CInterface(const struct _3COptions &CCopt,
   std::string TmpPath;
   std::error_code EC;
 
-  if (BaseDir.empty()) {
-    BaseDir = ".";
+  if (Opts.BaseDir.empty()) {
+    Opts.BaseDir = ".";
   }
 
   // Get the canonical path of the base directory.
-  TmpPath = BaseDir;
-  EC = tryGetCanonicalFilePath(BaseDir, TmpPath);
+  TmpPath = Opts.BaseDir;
+  EC = tryGetCanonicalFilePath(Opts.BaseDir, TmpPath);
   if (EC) {
     errs() << "3C initialization error: Failed to canonicalize base directory "
-           << "\"" << BaseDir << "\": " << EC.message() << "\n";
+           << "\"" << Opts.BaseDir << "\": " << EC.message() << "\n";
     ConstructionFailed = true;
     return;
   }
-  BaseDir = TmpPath;
+  Opts.BaseDir = TmpPath;
 
-  if (!OutputDir.empty()) {
+  if (!Opts.OutputDir.empty()) {
     // tryGetCanonicalFilePath will fail if the output dir doesn't exist yet, so
     // create it first.
-    EC = llvm::sys::fs::create_directories(OutputDir);
+    EC = llvm::sys::fs::create_directories(Opts.OutputDir);
     if (EC) {
       errs() << "3C initialization error: Failed to create output directory \""
-             << OutputDir << "\": " << EC.message() << "\n";
+             << Opts.OutputDir << "\": " << EC.message() << "\n";
       ConstructionFailed = true;
       return;
     }
-    TmpPath = OutputDir;
-    EC = tryGetCanonicalFilePath(OutputDir, TmpPath);
+    TmpPath = Opts.OutputDir;
+    EC = tryGetCanonicalFilePath(Opts.OutputDir, TmpPath);
     if (EC) {
       errs() << "3C initialization error: Failed to canonicalize output "
-             << "directory \"" << OutputDir << "\": " << EC.message() << "\n";
+             << "directory \"" << Opts.OutputDir << "\": " << EC.message()
+             << "\n";
       ConstructionFailed = true;
       return;
     }
-    OutputDir = TmpPath;
+    Opts.OutputDir = TmpPath;
   }
 
   SourceFiles = SourceFileList;
+  if (CCopt.FirstCompileCommandOnly) {
+    FirstCommandCompDB = std::make_unique<FirstCompileCommandDatabase>(*CompDB);
+    this->CompDB = FirstCommandCompDB.get();
+  }
 
   bool SawInputOutsideBaseDir = false;
   for (const auto &S : SourceFiles) {
@@ -431,21 +480,22 @@ _3CInterface::_3CInterface(const struct _3COptions &CCopt,
       ConstructionFailed = true;
       continue;
     }
-    FilePaths.insert(AbsPath);
-    if (!filePathStartsWith(AbsPath, BaseDir)) {
+    Opts.FilePaths.insert(AbsPath);
+    if (!filePathStartsWith(AbsPath, Opts.BaseDir)) {
       errs()
           << "3C initialization "
-          << (OutputDir != "" || !CCopt.AllowSourcesOutsideBaseDir ? "error"
-                                                                   : "warning")
+          << (Opts.OutputDir != "" || !CCopt.AllowSourcesOutsideBaseDir
+                  ? "error"
+                  : "warning")
           << ": File \"" << AbsPath
           << "\" specified on the command line is outside the base directory\n";
       SawInputOutsideBaseDir = true;
     }
   }
   if (SawInputOutsideBaseDir) {
-    errs() << "The base directory is currently \"" << BaseDir
+    errs() << "The base directory is currently \"" << Opts.BaseDir
            << "\" and can be changed with the -base-dir option.\n";
-    if (OutputDir != "") {
+    if (Opts.OutputDir != "") {
       ConstructionFailed = true;
       errs() << "When using -output-dir, input files outside the base "
                 "directory cannot be handled because there is no way to "
@@ -457,7 +507,15 @@ _3CInterface::_3CInterface(const struct _3COptions &CCopt,
     }
   }
 
-  CurrCompDB = CompDB;
+  _3COptionsScope OptionsScope(Opts);
+  for (const auto &SummaryFile : CCopt.SummaryFiles) {
+    std::string Error;
+    if (!GlobalProgramInfo.loadSummary(SummaryFile, Error)) {
+      errs() << "3C initialization error: Failed to load the 3C summary \""
+             << SummaryFile << "\": " << Error << "\n";
+      ConstructionFailed = true;
+    }
+  }
 
   GlobalProgramInfo.getPerfStats().startTotalTime();
 }
@@ -500,35 +558,102 @@ int _3CInterface::determineExitCode() {
 
 bool _3CInterface::parseASTs() {
 
-  std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  std::lock_guard<std::shared_timed_mutex> Lock(InterfaceMutex);
+  _3COptionsScope OptionsScope(Opts);
+  llvm::TimeTraceScope TimeScope("3CParse");
+
+  if (Opts.ParseThreads == 1 || SourceFiles.size() <= 1) {
+    auto *Tool = new ClangTool(*CompDB, SourceFiles);
+
+    // load the ASTs
+    _3CASTBuilderAction Action(ASTs);
+    int ToolExitStatus = Tool->run(&Action);
+    HadNonDiagnosticError |= (ToolExitStatus != 0);
 
-  auto *Tool = new ClangTool(*CurrCompDB, SourceFiles);
+    return isSuccessfulSoFar();
+  }
+
+  // Parse the source files in parallel, with one ClangTool per source file.
+  // As in AllTUsToolExecutor, each tool gets an independent copy of the
+  // physical file system to allow different concurrent working directories.
+  // The ASTs of each source file are collected separately and then appended
+  // to ASTs in the order of SourceFiles, so the later stages see the
+  // translation units in the same order as after a serial parse.
+  std::vector<std::vector<std::unique_ptr<ASTUnit>>> FileASTs(
+      SourceFiles.size());
+  std::vector<int> ToolExitStatuses(SourceFiles.size(), 0);
+  {
+    llvm::ThreadPool Pool(llvm::hardware_concurrency(Opts.ParseThreads));
+    for (size_t I = 0; I != SourceFiles.size(); ++I)
+      Pool.async([&, I]() {
+        _3COptionsScope OptionsScope(Opts);
+        ClangTool Tool(*CompDB, {SourceFiles[I]},
+                       std::make_shared<PCHContainerOperations>(),
+                       llvm::vfs::createPhysicalFileSystem());
+        _3CASTBuilderAction Action(FileASTs[I]);
+        ToolExitStatuses[I] = Tool.run(&Action);
+      });
+    Pool.wait();
+  }
 
-  // load the ASTs
-  _3CASTBuilderAction Action(ASTs);
-  int ToolExitStatus = Tool->run(&Action);
-  HadNonDiagnosticError |= (ToolExitStatus != 0);
+  for (size_t I = 0; I != SourceFiles.size(); ++I) {
+    HadNonDiagnosticError |= (ToolExitStatuses[I] != 0);
+    for (auto &AST : FileASTs[I])
+      ASTs.push_back(std::move(AST));
+  }
 
   return isSuccessfulSoFar();
 }
 
 bool _3CInterface::addVariables() {
 
-  std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  std::lock_guard<std::shared_timed_mutex> Lock(InterfaceMutex);
+  _3COptionsScope OptionsScope(Opts);
 
   // 1. Add Variables.
   VariableAdderConsumer VA = VariableAdderConsumer(GlobalProgramInfo, nullptr);
-  for (auto &TU : ASTs)
-    VA.HandleTranslationUnit(TU->getASTContext());
+  if (Opts.ParseThreads == 1 || ASTs.size() <= 1) {
+    for (auto &TU : ASTs) {
+      llvm::TimeTraceScope TimeScope("3CVariableAdder", TU->getMainFileName());
+      VA.HandleTranslationUnit(TU->getASTContext());
+    }
+    return isSuccessfulSoFar();
+  }
+
+  // The creation of the constraint variables shares the constraint graph and
+  // the numbering of the atoms, so only the traversals of the ASTs run in
+  // parallel. The variables are then added in the order of the ASTs.
+  std::vector<RecordedVariables> Recorded(ASTs.size());
+  {
+    llvm::TimeTraceScope TimeScope("3CVariableRecorder");
+    llvm::ThreadPool Pool(llvm::hardware_concurrency(Opts.ParseThreads));
+    for (size_t I = 0; I != ASTs.size(); ++I)
+      Pool.async([&, I]() {
+        _3COptionsScope OptionsScope(Opts);
+        Recorded[I].record(ASTs[I]->getASTContext());
+      });
+    Pool.wait();
+  }
+  for (size_t I = 0; I != ASTs.size(); ++I) {
+    llvm::TimeTraceScope TimeScope("3CVariableAdder",
+                                   ASTs[I]->getMainFileName());
+    VA.addRecordedVariables(ASTs[I]->getASTContext(), Recorded[I]);
+  }
 
   return isSuccessfulSoFar();
 }
 
 bool _3CInterface::buildInitialConstraints() {
 
-  std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  std::lock_guard<std::shared_timed_mutex> Lock(InterfaceMutex);
+  _3COptionsScope OptionsScope(Opts);
 
-  if (!GlobalProgramInfo.link()) {
+  bool Linked;
+  {
+    llvm::TimeTraceScope TimeScope("3CLink");
+    Linked = GlobalProgramInfo.link();
+  }
+  if (!Linked) {
     errs() << "Linking failed!\n";
     HadNonDiagnosticError = true;
     return isSuccessfulSoFar(); // False, of course, but follow the pattern.
@@ -537,8 +662,11 @@ bool _3CInterface::buildInitialConstraints() {
   // 2. Gather constraints.
   ConstraintBuilderConsumer CB =
       ConstraintBuilderConsumer(GlobalProgramInfo, nullptr);
-  for (auto &TU : ASTs)
+  for (auto &TU : ASTs) {
+    llvm::TimeTraceScope TimeScope("3CConstraintBuilder",
+                                   TU->getMainFileName());
     CB.HandleTranslationUnit(TU->getASTContext());
+  }
   if (!isSuccessfulSoFar())
     return false;
 
@@ -548,32 +676,52 @@ bool _3CInterface::buildInitialConstraints() {
 }
 
 bool _3CInterface::solveConstraints() {
-  std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  std::lock_guard<std::shared_timed_mutex> Lock(InterfaceMutex);
+  _3COptionsScope OptionsScope(Opts);
   assert(ConstraintsBuilt && "Constraints not yet built. We need to call "
                              "build constraint before trying to solve them.");
   // 3. Solve constraints.
-  if (Verbose)
+  if (Opts.Verbose)
     errs() << "Solving constraints\n";
 
-  if (DumpIntermediate)
+  if (Opts.DumpIntermediate)
     GlobalProgramInfo.dump();
 
   auto &PStats = GlobalProgramInfo.getPerfStats();
 
   PStats.startConstraintSolverTime();
-  runSolver(GlobalProgramInfo, FilePaths);
+  {
+    llvm::TimeTraceScope TimeScope("3CSolve", [&]() {
+      return std::to_string(
+                 GlobalProgramInfo.getConstraints().getConstraints().size()) +
+             " constraints";
+    });
+    runSolver(GlobalProgramInfo, Opts.FilePaths);
+  }
   PStats.endConstraintSolverTime();
 
-  if (Verbose)
+  if (Opts.Verbose)
     errs() << "Constraints solved\n";
 
-  if (WarnRootCause)
-    GlobalProgramInfo.computeInterimConstraintState(FilePaths);
+  if (Opts.WarnRootCause)
+    GlobalProgramInfo.computeInterimConstraintState(Opts.FilePaths);
 
-  if (DumpIntermediate)
+  if (Opts.DumpIntermediate)
     dumpConstraintOutputJson(FINAL_OUTPUT_SUFFIX, GlobalProgramInfo);
 
-  if (AllTypes) {
+  if (!Opts.SummaryOutput.empty()) {
+    std::error_code EC;
+    llvm::raw_fd_ostream SummaryStream(Opts.SummaryOutput, EC);
+    if (EC) {
+      errs() << "3C error: Failed to write the 3C summary \""
+             << Opts.SummaryOutput << "\": " << EC.message() << "\n";
+      HadNonDiagnosticError = true;
+    } else {
+      GlobalProgramInfo.writeSummary(SummaryStream);
+    }
+  }
+
+  if (Opts.AllTypes) {
     if (DebugArrSolver)
       GlobalProgramInfo.getABoundsInfo().dumpAVarGraph(
           "arr_bounds_initial.dot");
@@ -585,8 +733,11 @@ bool _3CInterface::solveConstraints() {
     // 4. Infer the bounds based on calls to malloc and calloc
     AllocBasedBoundsInference ABBI =
         AllocBasedBoundsInference(GlobalProgramInfo, nullptr);
-    for (auto &TU : ASTs)
+    for (auto &TU : ASTs) {
+      llvm::TimeTraceScope TimeScope("3CAllocBasedBoundsInference",
+                                     TU->getMainFileName());
       ABBI.HandleTranslationUnit(TU->getASTContext());
+    }
     if (!isSuccessfulSoFar())
       return false;
 
@@ -597,12 +748,15 @@ bool _3CInterface::solveConstraints() {
   // 5. Run intermediate tool hook to run visitors that need to be executed
   // after constraint solving but before rewriting.
   IntermediateToolHook ITH = IntermediateToolHook(GlobalProgramInfo, nullptr);
-  for (auto &TU : ASTs)
+  for (auto &TU : ASTs) {
+    llvm::TimeTraceScope TimeScope("3CIntermediateToolHook",
+                                   TU->getMainFileName());
     ITH.HandleTranslationUnit(TU->getASTContext());
+  }
   if (!isSuccessfulSoFar())
     return false;
 
-  if (AllTypes) {
+  if (Opts.AllTypes) {
     // Propagate data-flow information for Array pointers.
     GlobalProgramInfo.getABoundsInfo().performFlowAnalysis(&GlobalProgramInfo);
 
@@ -641,56 +795,117 @@ bool _3CInterface::solveConstraints() {
     }
   }*/
 
+  // The solution file is written after bounds inference so that it has the
+  // final bounds.
+  if (!Opts.SolutionOutput.empty()) {
+    std::error_code EC;
+    llvm::raw_fd_ostream SolutionStream(Opts.SolutionOutput, EC,
+                                        llvm::sys::fs::OF_None);
+    if (EC) {
+      errs() << "3C error: Failed to write the 3C solution file \""
+             << Opts.SolutionOutput << "\": " << EC.message() << "\n";
+      HadNonDiagnosticError = true;
+    } else {
+      SolutionFile::write(GlobalProgramInfo, SolutionStream);
+    }
+  }
+
   return isSuccessfulSoFar();
 }
 
 bool _3CInterface::writeAllConvertedFilesToDisk() {
-  std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  std::lock_guard<std::shared_timed_mutex> Lock(InterfaceMutex);
+  _3COptionsScope OptionsScope(Opts);
 
   // 6. Rewrite the input files.
-  RewriteConsumer RC = RewriteConsumer(GlobalProgramInfo);
-  for (auto &TU : ASTs)
+  std::unique_ptr<llvm::raw_fd_ostream> PatchOut;
+  if (!Opts.OutputPatch.empty()) {
+    std::error_code EC;
+    PatchOut = std::make_unique<llvm::raw_fd_ostream>(Opts.OutputPatch, EC,
+                                                      llvm::sys::fs::F_None);
+    if (EC) {
+      errs() << "3C error: Failed to open patch file \"" << Opts.OutputPatch
+             << "\": " << EC.message() << "\n";
+      return false;
+    }
+  }
+  RewriteConsumer RC =
+      RewriteConsumer(GlobalProgramInfo, nullptr, PatchOut.get());
+  for (auto &TU : ASTs) {
+    llvm::TimeTraceScope TimeScope("3CRewrite", TU->getMainFileName());
     RC.HandleTranslationUnit(TU->getASTContext());
+  }
 
   GlobalProgramInfo.getPerfStats().endTotalTime();
   GlobalProgramInfo.getPerfStats().startTotalTime();
   return isSuccessfulSoFar();
 }
 
+bool _3CInterface::previewConvertedFiles(
+    const std::vector<std::string> &FileNames,
+    std::map<std::string, std::string> &NewContents) {
+  std::lock_guard<std::shared_timed_mutex> Lock(InterfaceMutex);
+  _3COptionsScope OptionsScope(Opts);
+
+  NewContents.clear();
+  for (const auto &FileName : FileNames) {
+    std::string AbsPath;
+    if (tryGetCanonicalFilePath(FileName, AbsPath))
+      return false;
+    NewContents[AbsPath];
+  }
+
+  RewriteConsumer RC = RewriteConsumer(GlobalProgramInfo, &NewContents);
+  for (auto &TU : ASTs) {
+    if (RC.getPreviewedFiles().size() == NewContents.size())
+      break;
+    llvm::TimeTraceScope TimeScope("3CRewritePreview", TU->getMainFileName());
+    RC.HandleTranslationUnit(TU->getASTContext());
+  }
+  return RC.getPreviewedFiles().size() == NewContents.size() &&
+         isSuccessfulSoFar();
+}
+
 bool _3CInterface::dumpStats() {
-  if (AllTypes && DebugArrSolver) {
+  _3COptionsScope OptionsScope(Opts);
+  if (Opts.AllTypes && DebugArrSolver) {
     GlobalProgramInfo.getABoundsInfo().dumpAVarGraph("arr_bounds_final.dot");
   }
 
-  if (DumpStats) {
-    GlobalProgramInfo.printStats(FilePaths, llvm::errs(), true);
-    GlobalProgramInfo.computeInterimConstraintState(FilePaths);
+  if (Opts.DumpStats) {
+    GlobalProgramInfo.printStats(Opts.FilePaths, llvm::errs(), true);
+    GlobalProgramInfo.computeInterimConstraintState(Opts.FilePaths);
     std::error_code Ec;
-    llvm::raw_fd_ostream OutputJson(StatsOutputJson, Ec);
+    llvm::raw_fd_ostream OutputJson(Opts.StatsOutputJson, Ec);
     if (!OutputJson.has_error()) {
-      GlobalProgramInfo.printStats(FilePaths, OutputJson, false, true);
+      GlobalProgramInfo.printStats(Opts.FilePaths, OutputJson, false, true);
       OutputJson.close();
     }
-    std::string AggregateStats = StatsOutputJson + ".aggregate.json";
+    std::string AggregateStats = Opts.StatsOutputJson + ".aggregate.json";
     llvm::raw_fd_ostream AggrJson(AggregateStats, Ec);
     if (!AggrJson.has_error()) {
-      GlobalProgramInfo.printAggregateStats(FilePaths, AggrJson);
+      GlobalProgramInfo.printAggregateStats(Opts.FilePaths, AggrJson);
       AggrJson.close();
     }
 
-    llvm::raw_fd_ostream WildPtrInfo(WildPtrInfoJson, Ec);
+    llvm::raw_fd_ostream WildPtrInfo(Opts.WildPtrInfoJson, Ec);
     if (!WildPtrInfo.has_error()) {
       GlobalProgramInfo.getInterimConstraintState().printStats(WildPtrInfo);
       WildPtrInfo.close();
     }
 
-    llvm::raw_fd_ostream PerWildPtrInfo(PerWildPtrInfoJson, Ec);
+    llvm::raw_fd_ostream PerWildPtrInfo(Opts.PerWildPtrInfoJson, Ec);
     if (!PerWildPtrInfo.has_error()) {
       GlobalProgramInfo.getInterimConstraintState().printRootCauseStats(
           PerWildPtrInfo, GlobalProgramInfo.getConstraints());
       PerWildPtrInfo.close();
     }
   }
+
+  if (Opts.DumpMemoryStats)
+    GlobalProgramInfo.printMemoryStats(llvm::errs());
+  if (Opts.DumpConstraintGraphStats)
+    GlobalProgramInfo.printConstraintGraphStats(llvm::errs());
   return isSuccessfulSoFar();
 }
 
@@ -698,8 +913,61 @@ ConstraintsInfo &_3CInterface::getWildPtrsInfo() {
   return GlobalProgramInfo.getInterimConstraintState();
 }
 
+CVars _3CInterface::getRootCauses(ConstraintKey PtrKey) {
+  std::shared_lock<std::shared_timed_mutex> Lock(InterfaceMutex);
+  std::lock_guard<std::mutex> CacheLock(QueryCacheMutex);
+  _3COptionsScope OptionsScope(Opts);
+  return GlobalProgramInfo.getRootCausesOf(PtrKey);
+}
+
+CVars _3CInterface::getPtrsAffectedByRootCause(ConstraintKey RootKey) {
+  std::shared_lock<std::shared_timed_mutex> Lock(InterfaceMutex);
+  std::lock_guard<std::mutex> CacheLock(QueryCacheMutex);
+  _3COptionsScope OptionsScope(Opts);
+  return GlobalProgramInfo.getWildAffectedAtomsOf(RootKey);
+}
+
+CVars _3CInterface::getRootCausesInFile(const std::string &FileName) {
+  std::shared_lock<std::shared_timed_mutex> Lock(InterfaceMutex);
+  std::lock_guard<std::mutex> CacheLock(QueryCacheMutex);
+  _3COptionsScope OptionsScope(Opts);
+  // The locations of the pointers hold canonical paths, so a client may
+  // name the file by any path to it.
+  std::string CanonicalName;
+  if (tryGetCanonicalFilePath(FileName, CanonicalName))
+    CanonicalName = FileName;
+  return GlobalProgramInfo.getRootCausesInFile(CanonicalName);
+}
+
+const Constraint *_3CInterface::getRootCauseConstraint(ConstraintKey RootKey) {
+  std::shared_lock<std::shared_timed_mutex> Lock(InterfaceMutex);
+  _3COptionsScope OptionsScope(Opts);
+  auto &CS = GlobalProgramInfo.getConstraints();
+  VarAtom *VA = CS.getVar(RootKey);
+  if (VA == nullptr)
+    return nullptr;
+  Geq NewE(VA, CS.getWild());
+  auto It = CS.getConstraints().find(&NewE);
+  return It != CS.getConstraints().end() ? *It : nullptr;
+}
+
+std::vector<SolutionFile::NewWildPtr>
+_3CInterface::findNewWildPtrs(const SolutionFile &Baseline) {
+  std::shared_lock<std::shared_timed_mutex> Lock(InterfaceMutex);
+  std::lock_guard<std::mutex> CacheLock(QueryCacheMutex);
+  _3COptionsScope OptionsScope(Opts);
+  return Baseline.findNewWildPtrs(GlobalProgramInfo);
+}
+
+void _3CInterface::computeWildPtrsInfo() {
+  std::lock_guard<std::shared_timed_mutex> Lock(InterfaceMutex);
+  _3COptionsScope OptionsScope(Opts);
+  GlobalProgramInfo.computeInterimConstraintState(Opts.FilePaths);
+}
+
 bool _3CInterface::makeSinglePtrNonWild(ConstraintKey TargetPtr) {
-  std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  std::lock_guard<std::shared_timed_mutex> Lock(InterfaceMutex);
+  _3COptionsScope OptionsScope(Opts);
   CVars RemovePtrs;
   RemovePtrs.clear();
 
@@ -709,23 +977,31 @@ bool _3CInterface::makeSinglePtrNonWild(ConstraintKey TargetPtr) {
   // Get all the current WILD pointers.
   CVars OldWildPtrs = PtrDisjointSet.AllWildAtoms;
 
-  // Delete the constraint that make the provided targetPtr WILD.
-  VarAtom *VA = CS.getOrCreateVar(TargetPtr, "q", VarAtom::V_Other);
+  // Delete the constraint that make the provided targetPtr WILD. A key that
+  // names no atom is not a root cause; it must not create one.
+  VarAtom *VA = CS.getVar(TargetPtr);
+  if (VA == nullptr)
+    return false;
   Geq NewE(VA, CS.getWild());
-  Constraint *OriginalConstraint = *CS.getConstraints().find(&NewE);
+  auto ConstraintI = CS.getConstraints().find(&NewE);
+  // Only a root cause has a constraint that makes it WILD.
+  if (ConstraintI == CS.getConstraints().end())
+    return false;
+  Constraint *OriginalConstraint = *ConstraintI;
   CS.removeConstraint(OriginalConstraint);
   VA->getAllConstraints().erase(OriginalConstraint);
   delete (OriginalConstraint);
+  GlobalProgramInfo.invalidateRootCauseQueries();
 
   // Reset the constraint system.
   CS.resetEnvironment();
 
   // Solve the constraints.
   //assert (CS == GlobalProgramInfo.getConstraints());
-  runSolver(GlobalProgramInfo, FilePaths);
+  runSolver(GlobalProgramInfo, Opts.FilePaths);
 
-  // Compute new disjoint set.
-  GlobalProgramInfo.computeInterimConstraintState(FilePaths);
+  // Update the disjoint set for the removed root cause.
+  GlobalProgramInfo.updateInterimConstraintState(Opts.FilePaths);
 
   // Get new WILD pointers.
   CVars &NewWildPtrs = PtrDisjointSet.AllWildAtoms;
@@ -738,7 +1014,7 @@ bool _3CInterface::makeSinglePtrNonWild(ConstraintKey TargetPtr) {
   return !RemovePtrs.empty();
 }
 
-void _3CInterface::invalidateAllConstraintsWithReason(
+bool _3CInterface::invalidateAllConstraintsWithReason(
     Constraint *ConstraintToRemove) {
   // Get the reason for the current constraint.
   std::string ConstraintRsn = ConstraintToRemove->getReason();
@@ -748,19 +1024,25 @@ void _3CInterface::invalidateAllConstraintsWithReason(
   CS.removeAllConstraintsOnReason(ConstraintRsn, ToRemoveConstraints);
 
   // Free up memory by deleting all the removed constraints.
+  bool OnlyWildEdges = true;
   for (auto *ToDelCons : ToRemoveConstraints) {
     assert(dyn_cast<Geq>(ToDelCons) && "We can only delete Geq constraints.");
     Geq *TCons = dyn_cast<Geq>(ToDelCons);
     auto *Vatom = dyn_cast<VarAtom>(TCons->getLHS());
     assert(Vatom != nullptr && "Equality constraint with out VarAtom as LHS");
+    // Unchecked constraints are not part of the checked graph.
+    OnlyWildEdges &=
+        !TCons->constraintIsChecked() || isa<WildAtom>(TCons->getRHS());
     VarAtom *VS = CS.getOrCreateVar(Vatom->getLoc(), "q", VarAtom::V_Other);
     VS->getAllConstraints().erase(TCons);
     delete (ToDelCons);
   }
+  return OnlyWildEdges;
 }
 
 bool _3CInterface::invalidateWildReasonGlobally(ConstraintKey PtrKey) {
-  std::lock_guard<std::mutex> Lock(InterfaceMutex);
+  std::lock_guard<std::shared_timed_mutex> Lock(InterfaceMutex);
+  _3COptionsScope OptionsScope(Opts);
 
   CVars RemovePtrs;
   RemovePtrs.clear();
@@ -771,19 +1053,29 @@ bool _3CInterface::invalidateWildReasonGlobally(ConstraintKey PtrKey) {
   CVars OldWildPtrs = PtrDisjointSet.AllWildAtoms;
 
   // Delete ALL the constraints that have the same given reason.
-  VarAtom *VA = CS.getOrCreateVar(PtrKey, "q", VarAtom::V_Other);
+  VarAtom *VA = CS.getVar(PtrKey);
+  if (VA == nullptr)
+    return false;
   Geq NewE(VA, CS.getWild());
-  Constraint *OriginalConstraint = *CS.getConstraints().find(&NewE);
-  invalidateAllConstraintsWithReason(OriginalConstraint);
+  auto ConstraintI = CS.getConstraints().find(&NewE);
+  if (ConstraintI == CS.getConstraints().end())
+    return false;
+  Constraint *OriginalConstraint = *ConstraintI;
+  bool OnlyWildEdges = invalidateAllConstraintsWithReason(OriginalConstraint);
+  GlobalProgramInfo.invalidateRootCauseQueries();
 
   // Reset constraint solver.
   CS.resetEnvironment();
 
   // Solve the constraints.
-  runSolver(GlobalProgramInfo, FilePaths);
-
-  // Recompute the WILD pointer disjoint sets.
-  GlobalProgramInfo.computeInterimConstraintState(FilePaths);
+  runSolver(GlobalProgramInfo, Opts.FilePaths);
+
+  // Update the WILD pointer disjoint sets. They have to be recomputed if
+  // other edges of the checked graph were removed too.
+  if (OnlyWildEdges)
+    GlobalProgramInfo.updateInterimConstraintState(Opts.FilePaths);
+  else
+    GlobalProgramInfo.computeInterimConstraintState(Opts.FilePaths);
 
   // Computed the number of removed pointers.
   CVars &NewWildPtrs = PtrDisjointSet.AllWildAtoms;
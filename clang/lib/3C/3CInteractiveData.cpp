@@ -55,82 +55,80 @@ float ConstraintsInfo::getPtrAffectedScore(
 }
 
 void ConstraintsInfo::printStats(llvm::raw_ostream &O) {
-  O << "{\"WildPtrInfo\":{";
-  O << "\"InDirectWildPtrNum\":" << TotalNonDirectWildAtoms.size() << ",";
-  O << "\"InSrcInDirectWildPtrNum\":" << InSrcNonDirectWildAtoms.size() << ",";
-  O << "\"DirectWildPtrs\":{";
-  O << "\"Num\":" << AllWildAtoms.size() << ",";
-  O << "\"InSrcNum\":" << InSrcWildAtoms.size() << ",";
-  O << "\"Reasons\":[";
-
   std::map<std::string, std::set<ConstraintKey>> RsnBasedWildCKeys;
   for (auto &PtrR : RootWildAtomsWithReason) {
     if (AllWildAtoms.find(PtrR.first) != AllWildAtoms.end()) {
       RsnBasedWildCKeys[PtrR.second.getWildPtrReason()].insert(PtrR.first);
     }
   }
-  bool AddComma = false;
-  for (auto &T : RsnBasedWildCKeys) {
-    if (AddComma) {
-      O << ",\n";
-    }
-    O << "{\"" << T.first << "\":{";
-    O << "\"Num\":" << T.second.size() << ",";
-    CVars TmpKeys;
-    findIntersection(InSrcWildAtoms, T.second, TmpKeys);
-    O << "\"InSrcNum\":" << TmpKeys.size() << ",";
-    CVars InDWild, Tmp;
-    InDWild = getWildAffectedCKeys(T.second);
-    findIntersection(InDWild, InSrcNonDirectWildAtoms, Tmp);
-    O << "\"TotalIndirect\":" << InDWild.size() << ",";
-    O << "\"InSrcIndirect\":" << Tmp.size() << ",";
-    O << "\"InSrcScore\":" << getAtomAffectedScore(Tmp);
-    O << "}}";
-    AddComma = true;
-  }
-  O << "]";
-  O << "}";
-  O << "}}";
+
+  llvm::json::OStream J(O);
+  J.object([&] {
+    J.attributeObject("WildPtrInfo", [&] {
+      J.attribute("InDirectWildPtrNum",
+                  int64_t(TotalNonDirectWildAtoms.size()));
+      J.attribute("InSrcInDirectWildPtrNum",
+                  int64_t(InSrcNonDirectWildAtoms.size()));
+      J.attributeObject("DirectWildPtrs", [&] {
+        J.attribute("Num", int64_t(AllWildAtoms.size()));
+        J.attribute("InSrcNum", int64_t(InSrcWildAtoms.size()));
+        J.attributeArray("Reasons", [&] {
+          for (auto &T : RsnBasedWildCKeys) {
+            J.object([&] {
+              J.attributeObject(T.first, [&] {
+                J.attribute("Num", int64_t(T.second.size()));
+                CVars TmpKeys;
+                findIntersection(InSrcWildAtoms, T.second, TmpKeys);
+                J.attribute("InSrcNum", int64_t(TmpKeys.size()));
+                CVars InDWild, Tmp;
+                InDWild = getWildAffectedCKeys(T.second);
+                findIntersection(InDWild, InSrcNonDirectWildAtoms, Tmp);
+                J.attribute("TotalIndirect", int64_t(InDWild.size()));
+                J.attribute("InSrcIndirect", int64_t(Tmp.size()));
+                J.attribute("InSrcScore", getAtomAffectedScore(Tmp));
+              });
+            });
+          }
+        });
+      });
+    });
+  });
 }
 
 void ConstraintsInfo::printRootCauseStats(llvm::raw_ostream &O,
                                           Constraints &CS) {
-  O << "{\"RootCauseStats\":[";
-  bool AddComma = false;
-  for (auto &T : AllWildAtoms) {
-    if (AddComma)
-      O << ",\n";
-    printConstraintStats(O, CS, T);
-    AddComma = true;
-  }
-  O << "]}";
+  llvm::json::OStream J(O);
+  J.object([&] {
+    J.attributeArray("RootCauseStats", [&] {
+      for (auto &T : AllWildAtoms)
+        printConstraintStats(J, CS, T);
+    });
+  });
 }
 
-void ConstraintsInfo::printConstraintStats(llvm::raw_ostream &O,
+void ConstraintsInfo::printConstraintStats(llvm::json::OStream &J,
                                            Constraints &CS,
                                            ConstraintKey Cause) {
-  O << "{\"ConstraintKey\":" << Cause << ", ";
-  O << "\"Name\":\"" << CS.getVar(Cause)->getStr() << "\", ";
-  WildPointerInferenceInfo PtrInfo = RootWildAtomsWithReason.at(Cause);
-  O << "\"Reason\":\"" << PtrInfo.getWildPtrReason() << "\", ";
-  O << "\"InSrc\":" << (InSrcWildAtoms.find(Cause) != InSrcWildAtoms.end())
-    << ", ";
-  O << "\"Location\":";
-  const PersistentSourceLoc &PSL = PtrInfo.getLocation();
-  if (PSL.valid())
-    O << llvm::json::Value(PSL.toString());
-  else
-    O << "null";
-  O << ", ";
+  J.object([&] {
+    J.attribute("ConstraintKey", int64_t(Cause));
+    J.attribute("Name", CS.getVar(Cause)->getStr());
+    WildPointerInferenceInfo PtrInfo = RootWildAtomsWithReason.at(Cause);
+    J.attribute("Reason", PtrInfo.getWildPtrReason());
+    J.attribute("InSrc", int64_t(InSrcWildAtoms.count(Cause)));
+    const PersistentSourceLoc &PSL = PtrInfo.getLocation();
+    if (PSL.valid())
+      J.attribute("Location", PSL.toString());
+    else
+      J.attribute("Location", nullptr);
 
-  std::set<ConstraintKey> AtomsAffected = getWildAffectedCKeys({Cause});
-  O << "\"AtomsAffected\":" << AtomsAffected.size() << ", ";
-  O << "\"AtomsScore\":" << getAtomAffectedScore(AtomsAffected) << ", ";
+    std::set<ConstraintKey> AtomsAffected = getWildAffectedCKeys({Cause});
+    J.attribute("AtomsAffected", int64_t(AtomsAffected.size()));
+    J.attribute("AtomsScore", getAtomAffectedScore(AtomsAffected));
 
-  std::set<ConstraintVariable *> PtrsAffected = PtrSrcWMap[Cause];
-  O << "\"PtrsAffected\":" << PtrsAffected.size() << ",";
-  O << "\"PtrsScore\":" << getPtrAffectedScore(PtrsAffected);
-  O << "}";
+    std::set<ConstraintVariable *> PtrsAffected = PtrSrcWMap[Cause];
+    J.attribute("PtrsAffected", int64_t(PtrsAffected.size()));
+    J.attribute("PtrsScore", getPtrAffectedScore(PtrsAffected));
+  });
 }
 
 int ConstraintsInfo::getNumPtrsAffected(ConstraintKey CK) {
@@ -88,6 +88,16 @@ void PerformanceStats::printPerformanceStats(llvm::raw_ostream &O,
     O << ", \"NumITypes\":" << NumITypes;
     O << ", \"NumCheckedRegions\":" << NumCheckedRegions;
     O << ", \"NumUnCheckedRegions\":" << NumUnCheckedRegions;
+    O << "}},\n";
+
+    O << "{\"SolverStats\":{";
+    O << "\"NumComponents\":" << SolverComponents.NumComponents;
+    O << ", \"NumDirtyComponents\":" << SolverComponents.NumDirtyComponents;
+    O << ", \"NumDirtyVars\":" << SolverComponents.NumDirtyVars;
+    O << ", \"LargestComponent\":" << SolverComponents.LargestComponent;
+    O << ", \"LargestDirtyComponent\":"
+      << SolverComponents.LargestDirtyComponent;
+    O << ", \"ComponentSolveTime\":" << SolverComponents.ComponentSolveTime;
     O << "}}";
 
     O << "]";
@@ -107,6 +117,15 @@ void PerformanceStats::printPerformanceStats(llvm::raw_ostream &O,
     O << "NumITypes:" << NumITypes << "\n";
     O << "NumCheckedRegions:" << NumCheckedRegions << "\n";
     O << "NumUnCheckedRegions:" << NumUnCheckedRegions << "\n";
+
+    O << "SolverStats\n";
+    O << "NumComponents:" << SolverComponents.NumComponents << "\n";
+    O << "NumDirtyComponents:" << SolverComponents.NumDirtyComponents << "\n";
+    O << "NumDirtyVars:" << SolverComponents.NumDirtyVars << "\n";
+    O << "LargestComponent:" << SolverComponents.LargestComponent << "\n";
+    O << "LargestDirtyComponent:" << SolverComponents.LargestDirtyComponent
+      << "\n";
+    O << "ComponentSolveTime:" << SolverComponents.ComponentSolveTime << "\n";
   }
 }
 
@@ -115,7 +134,7 @@ bool StatsRecorder::VisitCompoundStmt(clang::CompoundStmt *S) {
   auto &PStats = Info->getPerfStats();
   if (S != nullptr) {
     auto PSL = PersistentSourceLoc::mkPSL(S, *Context);
-    if (PSL.valid() && canWrite(PSL.getFileName())) {
+    if (PSL.valid() && canWrite(PSL)) {
       switch (S->getWrittenCheckedSpecifier()) {
       case CSS_None:
         // Do nothing
@@ -138,7 +157,7 @@ bool StatsRecorder::VisitDecl(clang::Decl *D) {
   auto &PStats = Info->getPerfStats();
   if (D != nullptr) {
     auto PSL = PersistentSourceLoc::mkPSL(D, *Context);
-    if (PSL.valid() && canWrite(PSL.getFileName())) {
+    if (PSL.valid() && canWrite(PSL)) {
       if (DeclaratorDecl *DD = dyn_cast<DeclaratorDecl>(D)) {
         if (DD->hasInteropTypeExpr()) {
           PStats.incrementNumITypes();
@@ -154,7 +173,7 @@ bool StatsRecorder::VisitCStyleCastExpr(clang::CStyleCastExpr *C) {
   auto &PStats = Info->getPerfStats();
   if (C != nullptr) {
     auto PSL = PersistentSourceLoc::mkPSL(C, *Context);
-    if (PSL.valid() && canWrite(PSL.getFileName())) {
+    if (PSL.valid() && canWrite(PSL)) {
       QualType SrcT = C->getSubExpr()->getType();
       QualType DstT = C->getType();
       if (SrcT->isCheckedPointerType() && !DstT->isCheckedPointerType())
@@ -169,7 +188,7 @@ bool StatsRecorder::VisitBoundsCastExpr(clang::BoundsCastExpr *B) {
   auto &PStats = Info->getPerfStats();
   if (B != nullptr) {
     auto PSL = PersistentSourceLoc::mkPSL(B, *Context);
-    if (PSL.valid() && canWrite(PSL.getFileName()))
+    if (PSL.valid() && canWrite(PSL))
       PStats.incrementNumAssumeBounds();
   }
   return true;
@@ -13,14 +13,6 @@
 #include "clang/3C/ABounds.h"
 #include "clang/3C/AVarBoundsInfo.h"
 
-std::set<BoundsKey> ABounds::KeysUsedInBounds;
-
-void ABounds::addBoundsUsedKey(BoundsKey BK) { KeysUsedInBounds.insert(BK); }
-
-bool ABounds::isKeyUsedInBounds(BoundsKey ToCheck) {
-  return KeysUsedInBounds.find(ToCheck) != KeysUsedInBounds.end();
-}
-
 ABounds *ABounds::getBoundsInfo(AVarBoundsInfo *ABInfo, BoundsExpr *BExpr,
                                 const ASTContext &C) {
   ABounds *Ret = nullptr;
@@ -45,6 +45,7 @@ void AVarBoundsStats::print(llvm::raw_ostream &O,
     O << "Declared:" << Tmp.size() << "\n";
     findIntersection(DeclaredButNotHandled, *InSrcArrs, Tmp);
     O << "DeclaredButNotHandled:" << Tmp.size() << "\n";
+    O << "ContextSensitiveKeys:" << NumCtxSensKeys << "\n";
   } else {
     O << "\"ArrayBoundsInferenceStats\":{";
     findIntersection(NamePrefixMatch, *InSrcArrs, Tmp);
@@ -60,7 +61,8 @@ void AVarBoundsStats::print(llvm::raw_ostream &O,
     findIntersection(DeclaredBounds, *InSrcArrs, Tmp);
     O << "\"Declared\":" << Tmp.size() << ",\n";
     findIntersection(DeclaredButNotHandled, *InSrcArrs, Tmp);
-    O << "\"DeclaredButNotHandled\":" << Tmp.size() << "\n";
+    O << "\"DeclaredButNotHandled\":" << Tmp.size() << ",\n";
+    O << "\"ContextSensitiveKeys\":" << NumCtxSensKeys << "\n";
     O << "}";
   }
 }
@@ -99,13 +101,13 @@ bool isInSrcArray(ConstraintVariable *CK, Constraints &CS) {
 class ScopeVisitor {
 public:
   ScopeVisitor(const ProgramVarScope *S, std::set<BoundsKey> &R,
-               std::set<BoundsKey> &VK, std::map<BoundsKey, ProgramVar *> &VarM,
+               std::set<BoundsKey> &VK, std::vector<ProgramVar *> &VarM,
                std::set<BoundsKey> &P)
       : TS(S), Res(R), VisibleKeys(VK), VM(VarM), PtrAtoms(P) {}
   void visitBoundsKey(BoundsKey V) const {
     // If the variable is non-pointer?
-    if (VM.find(V) != VM.end() && PtrAtoms.find(V) == PtrAtoms.end()) {
-      auto *S = VM[V];
+    auto *S = V < VM.size() ? VM[V] : nullptr;
+    if (S != nullptr && PtrAtoms.find(V) == PtrAtoms.end()) {
       // If the variable is constant or in the same scope?
       if (S->isNumConstant() || (*(TS) == *(S->getScope()))) {
         Res.insert(V);
@@ -119,7 +121,7 @@ public:
   const ProgramVarScope *TS;
   std::set<BoundsKey> &Res;
   std::set<BoundsKey> &VisibleKeys;
-  std::map<BoundsKey, ProgramVar *> &VM;
+  std::vector<ProgramVar *> &VM;
   std::set<BoundsKey> &PtrAtoms;
 };
 
@@ -217,18 +219,21 @@ bool AvarBoundsInference::convergeInferredBounds() {
       for (auto &TySet : BTypeMap) {
         mergeReachableProgramVars(CInfABnds.first, TySet.second);
       }
+      // Return the only bounds key of kind K, or null if there is none.
+      auto GetBKey = [&BTypeMap](ABounds::BoundsKind K) -> const BoundsKey * {
+        auto I = BTypeMap.find(K);
+        if (I == BTypeMap.end() || I->second.empty())
+          return nullptr;
+        return &*I->second.begin();
+      };
       // Order of preference: Count and Byte
-      if (BTypeMap.find(ABounds::CountBoundKind) != BTypeMap.end() &&
-          !BTypeMap[ABounds::CountBoundKind].empty()) {
-        AB = new CountBound(*BTypeMap[ABounds::CountBoundKind].begin());
-      } else if (BTypeMap.find(ABounds::ByteBoundKind) != BTypeMap.end() &&
-                 !BTypeMap[ABounds::ByteBoundKind].empty()) {
-        AB = new ByteBound(*BTypeMap[ABounds::ByteBoundKind].begin());
-      } else if (BTypeMap.find(ABounds::CountPlusOneBoundKind) !=
-                     BTypeMap.end() &&
-                 !BTypeMap[ABounds::CountPlusOneBoundKind].empty()) {
-        AB = new CountPlusOneBound(
-            *BTypeMap[ABounds::CountPlusOneBoundKind].begin());
+      if (const BoundsKey *BK = GetBKey(ABounds::CountBoundKind)) {
+        AB = new CountBound(*BK);
+      } else if (const BoundsKey *BK = GetBKey(ABounds::ByteBoundKind)) {
+        AB = new ByteBound(*BK);
+      } else if (const BoundsKey *BK =
+                     GetBKey(ABounds::CountPlusOneBoundKind)) {
+        AB = new CountPlusOneBound(*BK);
       }
 
       // If we found any bounds?
@@ -246,8 +251,7 @@ bool AvarBoundsInference::convergeInferredBounds() {
 }
 
 bool AvarBoundsInference::hasImpossibleBounds(BoundsKey BK) {
-  return this->BI->PointersWithImpossibleBounds.find(BK) !=
-         this->BI->PointersWithImpossibleBounds.end();
+  return this->BI->PointersWithImpossibleBounds.count(BK);
 }
 
 void AvarBoundsInference::setImpossibleBounds(BoundsKey BK) {
@@ -334,9 +338,10 @@ bool AvarBoundsInference::getRelevantBounds(BoundsKey BK,
   // If this pointer is used in pointer arithmetic then there
   // are no relevant bounds for this pointer.
   if (!BI->hasPointerArithmetic(BK)) {
-    if (CurrIterInferBounds.find(BK) != CurrIterInferBounds.end()) {
+    auto I = CurrIterInferBounds.find(BK);
+    if (I != CurrIterInferBounds.end()) {
       // get the bounds inferred from the current iteration
-      ResBounds = CurrIterInferBounds[BK];
+      ResBounds = I->second;
       HasBounds = true;
     } else {
       auto *PrevBounds = BI->getBounds(BK);
@@ -406,8 +411,7 @@ bool AvarBoundsInference::predictBounds(BoundsKey K,
           }
         }
       }
-    } else if (IsFuncRet || (BKsFailedFlowInference.find(NBK) !=
-                             BKsFailedFlowInference.end())) {
+    } else if (IsFuncRet || BKsFailedFlowInference.count(NBK)) {
 
       // If this is a function return we should have bounds from all
       // neighbours.
@@ -1014,15 +1018,11 @@ void AVarBoundsInfo::recordArithmeticOperation(clang::Expr *E,
 }
 
 bool AVarBoundsInfo::hasPointerArithmetic(BoundsKey BK) {
-  return ArrPointersWithArithmetic.find(BK) != ArrPointersWithArithmetic.end();
+  return ArrPointersWithArithmetic.count(BK);
 }
 
 ProgramVar *AVarBoundsInfo::getProgramVar(BoundsKey VK) {
-  ProgramVar *Ret = nullptr;
-  if (PVarInfo.find(VK) != PVarInfo.end()) {
-    Ret = PVarInfo[VK];
-  }
-  return Ret;
+  return VK < PVarInfo.size() ? PVarInfo[VK] : nullptr;
 }
 
 bool AVarBoundsInfo::hasVarKey(PersistentSourceLoc &PSL) {
@@ -1060,6 +1060,8 @@ void AVarBoundsInfo::insertParamKey(AVarBoundsInfo::ParamDeclType ParamDecl,
 }
 
 void AVarBoundsInfo::insertProgramVar(BoundsKey NK, ProgramVar *PV) {
+  if (NK >= PVarInfo.size())
+    PVarInfo.resize(NK + 1, nullptr);
   PVarInfo[NK] = PV;
 }
 
@@ -1071,6 +1073,8 @@ bool AVarBoundsInfo::performWorkListInference(
   std::set<BoundsKey> NextIterArrs;
   WorkList.clear();
   WorkList.insert(ArrNeededBounds.begin(), ArrNeededBounds.end());
+  // Inference only reads the graph.
+  BKGraph.freeze();
   bool Changed = true;
   while (Changed) {
     Changed = false;
@@ -1079,7 +1083,7 @@ bool AVarBoundsInfo::performWorkListInference(
     while (!WorkList.empty()) {
       BoundsKey CurrArrKey = *WorkList.begin();
       // Remove the bounds key from the worklist.
-      WorkList.erase(CurrArrKey);
+      WorkList.erase(WorkList.begin());
       // Can we find bounds for this Arr?
       if (BI.inferBounds(CurrArrKey, BKGraph, FromPB)) {
         RetVal = true;
@@ -1238,8 +1242,8 @@ void AVarBoundsInfo::getBoundsNeededArrPointers(
   // Also add arrays with invalid bounds.
   ArrWithBounds.insert(InvalidBounds.begin(), InvalidBounds.end());
   // Also, add arrays with impossible bounds.
-  ArrWithBounds.insert(PointersWithImpossibleBounds.begin(),
-                       PointersWithImpossibleBounds.end());
+  for (BoundsKey BK : PointersWithImpossibleBounds)
+    ArrWithBounds.insert(BK);
 
   // This are the array atoms that need bounds.
   // i.e., AB = ArrPtrs - ArrPtrsWithBounds.
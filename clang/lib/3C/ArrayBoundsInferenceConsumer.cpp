@@ -76,13 +76,14 @@ static bool hasLengthKeyword(std::string VarName) {
   std::transform(VarName.begin(), VarName.end(), VarName.begin(),
                  [](unsigned char C) { return std::tolower(C); });
 
-  std::set<std::string> LengthKeywords(LengthVarNamesPrefixes);
-  LengthKeywords.insert(LengthVarNamesSubstring.begin(),
-                        LengthVarNamesSubstring.end());
-  for (auto &PName : LengthKeywords) {
+  for (auto &PName : LengthVarNamesPrefixes) {
     if (VarName.find(PName) != std::string::npos)
       return true;
   }
+  for (auto &TmpName : LengthVarNamesSubstring) {
+    if (VarName.find(TmpName) != std::string::npos)
+      return true;
+  }
   return false;
 }
 
@@ -404,21 +405,27 @@ bool GlobalABVisitor::VisitRecordDecl(RecordDecl *RD) {
     }
 
     if (IdentifiedArrVars.size() > 0 && PotLenFields.size() > 0) {
-      // First check for variable name match.
+      // First check for variable name match. PotLenFields is ordered by
+      // name, so the fields whose names start with the name of the pointer
+      // are the ones from the first name that is not less than it, up to the
+      // first name that does not start with it.
       for (auto &PtrField : IdentifiedArrVars) {
-        for (auto &LenField : PotLenFields) {
-          if (hasNameMatch(PtrField.first, LenField.first)) {
-            ABounds *FldBounds = new CountBound(LenField.second);
-            // If we find a field which matches both the pointer name and
-            // variable name heuristic lets use it.
-            if (hasLengthKeyword(LenField.first)) {
-              ABStats.NamePrefixMatch.insert(PtrField.second);
-              ABInfo.replaceBounds(PtrField.second, Heuristics, FldBounds);
-              break;
-            }
-            ABStats.VariableNameMatch.insert(PtrField.second);
+        for (auto LenIt = PotLenFields.lower_bound(
+                 std::make_pair(PtrField.first, BoundsKey(0)));
+             LenIt != PotLenFields.end() &&
+             hasNameMatch(PtrField.first, LenIt->first);
+             ++LenIt) {
+          auto &LenField = *LenIt;
+          ABounds *FldBounds = new CountBound(LenField.second);
+          // If we find a field which matches both the pointer name and
+          // variable name heuristic lets use it.
+          if (hasLengthKeyword(LenField.first)) {
+            ABStats.NamePrefixMatch.insert(PtrField.second);
             ABInfo.replaceBounds(PtrField.second, Heuristics, FldBounds);
+            break;
           }
+          ABStats.VariableNameMatch.insert(PtrField.second);
+          ABInfo.replaceBounds(PtrField.second, Heuristics, FldBounds);
         }
         // If the name-correspondence heuristics failed.
         // Then use the named based heuristics.
@@ -475,6 +482,13 @@ bool GlobalABVisitor::VisitFunctionDecl(FunctionDecl *FD) {
         }
       }
       if (!ParamArrays.empty() && !LengthParams.empty()) {
+        // Whether the name of each length parameter matches our heuristics,
+        // which does not depend on the array parameter.
+        std::set<unsigned> NamedLengthParams;
+        for (auto &LenParamPair : LengthParams)
+          if (fieldNameMatch(LenParamPair.second.first))
+            NamedLengthParams.insert(LenParamPair.first);
+
         // We have multiple parameters that are arrays and multiple params
         // that could be potentially length fields.
         for (auto &ArrParamPair : ParamArrays) {
@@ -515,7 +529,7 @@ bool GlobalABVisitor::VisitFunctionDecl(FunctionDecl *FD) {
           if (!FoundLen) {
             for (auto &CurrLenParamPair : LengthParams) {
               // Check if the length parameter name matches our heuristics.
-              if (fieldNameMatch(CurrLenParamPair.second.first)) {
+              if (NamedLengthParams.count(CurrLenParamPair.first)) {
                 FoundLen = true;
                 ABounds *PBounds =
                     new CountBound(CurrLenParamPair.second.second);
@@ -894,13 +908,18 @@ void LengthVarInference::VisitArraySubscriptExpr(ArraySubscriptExpr *ASE) {
 void handleArrayVariablesBoundsDetection(ASTContext *C, ProgramInfo &I,
                                          bool UseHeuristics) {
   // Run array bounds
-  for (auto FuncName : AllocatorFunctions) {
+  for (auto FuncName : get3COptions().AllocatorFunctions) {
     AllocatorSizeAssoc[FuncName] = {0};
   }
   GlobalABVisitor GlobABV(C, I);
   TranslationUnitDecl *TUD = C->getTranslationUnitDecl();
   LocalVarABVisitor LFV = LocalVarABVisitor(C, I);
   bool GlobalTraversed;
+  // The functions are visited one after the other on purpose. The visitors
+  // record bounds directly in the AVarBoundsInfo and the constraints of I,
+  // neither of which is thread-safe, LFV keeps the facts of the functions
+  // already visited for the following ones, and the CFGs and parent maps built
+  // along the way are allocated in the ASTContext.
   // First visit all the structure members.
   for (const auto &D : TUD->decls()) {
     GlobalTraversed = false;
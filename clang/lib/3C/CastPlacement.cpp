@@ -114,7 +114,7 @@ CastPlacementVisitor::CastNeeded CastPlacementVisitor::needCasting(
     if (auto *DstPVC = dyn_cast<PVConstraint>(DstExt)) {
       if (!DstPVC->getCvars().empty()) {
         ConstAtom *CA =
-            Info.getConstraints().getAssignment(DstPVC->getCvars().at(0));
+            Info.getConstraints().getAssignment(DstPVC->getCvars()[0]);
         if (isa<NTArrAtom>(CA))
           return CAST_NT_ARRAY;
       }
@@ -163,7 +163,7 @@ CastPlacementVisitor::getCastString(ConstraintVariable *Dst,
     if (const auto *DstPVC = dyn_cast<PVConstraint>(Dst)) {
       assert("Checked cast not to a pointer" && !DstPVC->getCvars().empty());
       ConstAtom *CA =
-          Info.getConstraints().getAssignment(DstPVC->getCvars().at(0));
+          Info.getConstraints().getAssignment(DstPVC->getCvars()[0]);
 
       // Writing an _Assume_bounds_cast to an array type requires inserting
       // the bounds for destination array. These can come from the source
@@ -194,7 +194,7 @@ CastPlacementVisitor::getCastString(ConstraintVariable *Dst,
 void CastPlacementVisitor::surroundByCast(ConstraintVariable *Dst,
                                           CastNeeded CastKind, Expr *E) {
   PersistentSourceLoc PSL = PersistentSourceLoc::mkPSL(E, *Context);
-  if (!canWrite(PSL.getFileName())) {
+  if (!canWrite(PSL)) {
     // 3C has known bugs that can cause attempted cast insertion in
     // unwritable files in common use cases. Until they are fixed, report a
     // warning rather than letting the main "unwritable change" error trigger
@@ -288,7 +288,7 @@ void CastPlacementVisitor::updateRewriteStats(CastNeeded CastKind) {
   }
 }
 
-bool CastLocatorVisitor::VisitCastExpr(CastExpr *C) {
+bool CastPlacementVisitor::VisitCastExpr(CastExpr *C) {
   ExprsWithCast.insert(C);
   if (!isa<ImplicitCastExpr>(C)) {
     Expr *Sub = ignoreCheckedCImplicit(C->getSubExpr());
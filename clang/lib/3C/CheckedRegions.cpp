@@ -16,8 +16,6 @@
 #include "clang/3C/MappingVisitor.h"
 #include "clang/3C/RewriteUtils.h"
 #include "clang/3C/Utils.h"
-#include "clang/AST/ASTTypeTraits.h"
-#include "clang/AST/ParentMapContext.h"
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/Tooling/Transformer/SourceCode.h"
 #include "llvm/Support/raw_ostream.h"
@@ -27,34 +25,26 @@
 using namespace llvm;
 using namespace clang;
 
-// If S is a function body, then return the FunctionDecl, otherwise return null.
-// Used in both visitors so abstracted to a function.
-FunctionDecl *getFunctionDeclOfBody(ASTContext *Context, CompoundStmt *S) {
-  const auto &Parents = Context->getParents(*S);
-  if (Parents.empty()) {
-    return nullptr;
-  }
-  return const_cast<FunctionDecl *>(Parents[0].get<FunctionDecl>());
-}
-
 // CheckedRegionAdder
 
-bool CheckedRegionAdder::VisitCompoundStmt(CompoundStmt *S) {
+bool CheckedRegionAdder::TraverseCompoundStmt(CompoundStmt *S) {
   llvm::FoldingSetNodeID Id;
-  DynTypedNode DTN = DynTypedNode::create(*S);
 
   auto &PState = Info.getPerfStats();
   S->Profile(Id, *Context, true);
-  switch (Map[Id]) {
+  AnnotationNeeded Annotation = Map[Id];
+  // A function body has no enclosing compound statement, so it is never
+  // marked _Unchecked.
+  switch (Annotation) {
   case IS_UNCHECKED:
-    if (isParentChecked(DTN) && getFunctionDeclOfBody(Context, S) == nullptr) {
+    if (isParentChecked()) {
       auto Loc = S->getBeginLoc();
       Writer.InsertTextBefore(Loc, "_Unchecked ");
       PState.incrementNumUnCheckedRegions();
     }
     break;
   case IS_CHECKED:
-    if (!isParentChecked(DTN)) {
+    if (!isParentChecked()) {
       auto Loc = S->getBeginLoc();
       Writer.InsertTextBefore(Loc, "_Checked ");
       PState.incrementNumCheckedRegions();
@@ -64,18 +54,23 @@ bool CheckedRegionAdder::VisitCompoundStmt(CompoundStmt *S) {
     llvm_unreachable("Bad flag in CheckedRegionAdder");
   }
 
-  return true;
+  CheckedStack.push_back(Annotation == IS_CHECKED || isWrittenChecked(S));
+  bool Continue = true;
+  for (Stmt *SubStmt : S->children())
+    if (!(Continue = TraverseStmt(SubStmt)))
+      break;
+  CheckedStack.pop_back();
+  return Continue;
 }
 
 bool CheckedRegionAdder::VisitCallExpr(CallExpr *C) {
   auto *FD = C->getDirectCallee();
   FoldingSetNodeID ID;
-  DynTypedNode DTN = DynTypedNode::create(*C);
   auto &PState = Info.getPerfStats();
 
   C->Profile(ID, *Context, true);
   if (FD && FD->isVariadic() && Map[ID] == IS_CONTAINED &&
-      isParentChecked(DTN)) {
+      isParentChecked()) {
     auto Begin = C->getBeginLoc();
     Writer.InsertTextBefore(Begin, "_Unchecked { ");
     auto End = C->getEndLoc();
@@ -86,35 +81,8 @@ bool CheckedRegionAdder::VisitCallExpr(CallExpr *C) {
   return true;
 }
 
-typedef std::pair<const CompoundStmt *, int> StmtPair;
-
-StmtPair
-CheckedRegionAdder::findParentCompound(const DynTypedNode &N,
-                                       int Distance = 1) {
-  auto Parents = Context->getParents(N);
-  if (Parents.empty())
-    return std::make_pair(nullptr, INT_MAX);
-  std::vector<StmtPair> Results;
-  Results.reserve(Parents.size());
-  for (auto Parent : Parents)
-    if (const auto *S = Parent.get<CompoundStmt>())
-      Results.push_back(std::make_pair(S, Distance));
-    else
-      Results.push_back(findParentCompound(Parent, Distance + 1));
-
-  auto Min = min_element(
-      Results.begin(), Results.end(),
-      [](const StmtPair &A, const StmtPair &B) { return A.second < B.second; });
-  return *Min;
-}
-
-bool CheckedRegionAdder::isParentChecked(const DynTypedNode &DTN) {
-  if (const auto *Parent = findParentCompound(DTN).first) {
-    llvm::FoldingSetNodeID ID;
-    Parent->Profile(ID, *Context, true);
-    return Map[ID] == IS_CHECKED || isWrittenChecked(Parent);
-  }
-  return false;
+bool CheckedRegionAdder::isParentChecked() {
+  return !CheckedStack.empty() && CheckedStack.back();
 }
 
 bool CheckedRegionAdder::isWrittenChecked(const clang::CompoundStmt *S) {
@@ -134,6 +102,14 @@ bool CheckedRegionAdder::isWrittenChecked(const clang::CompoundStmt *S) {
 
 // CheckedRegionFinder
 
+bool CheckedRegionFinder::TraverseFunctionDecl(FunctionDecl *FD) {
+  FunctionDecl *EnclosingFunction = CurrentFunction;
+  CurrentFunction = FD;
+  bool Continue = RecursiveASTVisitor::TraverseFunctionDecl(FD);
+  CurrentFunction = EnclosingFunction;
+  return Continue;
+}
+
 bool CheckedRegionFinder::VisitForStmt(ForStmt *S) {
   handleChildren(S->children());
   return false;
@@ -163,10 +139,10 @@ bool CheckedRegionFinder::VisitCompoundStmt(CompoundStmt *S) {
   bool Localwild = false;
 
   // Is this compound statement the body of a function?
-  FunctionDecl *FD = getFunctionDeclOfBody(Context, S);
+  FunctionDecl *FD = getFunctionDeclOfBody(S);
   if (FD != nullptr) {
     auto PSL = PersistentSourceLoc::mkPSL(FD, *Context);
-    if (!canWrite(PSL.getFileName())) {
+    if (!canWrite(PSL)) {
       // The "location" of the function is in an unwritable file. Processing it
       // might result in modifying an unwritable file, so skip it completely.
       // This check could have both false positives and false negatives if the
@@ -190,12 +166,15 @@ bool CheckedRegionFinder::VisitCompoundStmt(CompoundStmt *S) {
 
   // Visit all subblocks, find all unchecked types.
   for (const auto &SubStmt : S->children()) {
-    CheckedRegionFinder Sub(Context, Writer, Info, Seen, Map, EmitWarnings);
+    CheckedRegionFinder Sub(Context, Writer, Info, Seen, Map, Summary,
+                            EmitWarnings);
+    Sub.StmtInCompound = SubStmt;
+    Sub.ParentCompound = S;
     Sub.TraverseStmt(SubStmt);
     Localwild |= Sub.Wild;
   }
 
-  markChecked(S, Localwild);
+  markChecked(S, FD, Localwild);
 
   Wild = false;
 
@@ -234,9 +213,7 @@ bool CheckedRegionFinder::VisitCallExpr(CallExpr *C) {
       auto Type = FD->getReturnType();
       Wild |= (!(FD->hasPrototype() || FD->doesThisDeclarationHaveABody())) ||
               containsUncheckedPtr(Type);
-      auto *FV = Info.getFuncConstraint(FD, Context);
-      for (unsigned I = 0; I < FV->numParams(); I++)
-        Wild |= isWild(*FV->getExternalParam(I));
+      Wild |= hasWildParams(FD);
     }
     handleChildren(C->children());
     Map[ID] = Wild ? IS_UNCHECKED : IS_CHECKED;
@@ -280,11 +257,8 @@ bool CheckedRegionFinder::VisitDeclRefExpr(DeclRefExpr *DR) {
 
   if (auto *FD = dyn_cast<FunctionDecl>(D)) {
     auto *FV = Info.getFuncConstraint(FD, Context);
-    IW |= FV->hasWild(Info.getConstraints().getVariables());
-    for (unsigned I = 0; I < FV->numParams(); I++) {
-      PVConstraint *ParamCV = FV->getExternalParam(I);
-      IW |= isWild(*ParamCV);
-    }
+    IW |= FV->hasWild(Info.getConstraints().getVariables()) ||
+          hasWildParams(FD);
   }
 
   Wild |= IW;
@@ -293,28 +267,33 @@ bool CheckedRegionFinder::VisitDeclRefExpr(DeclRefExpr *DR) {
 
 void CheckedRegionFinder::handleChildren(const Stmt::child_range &Stmts) {
   for (const auto &SubStmt : Stmts) {
-    CheckedRegionFinder Sub(Context, Writer, Info, Seen, Map, EmitWarnings);
+    CheckedRegionFinder Sub(Context, Writer, Info, Seen, Map, Summary,
+                            EmitWarnings);
     Sub.TraverseStmt(SubStmt);
     Wild |= Sub.Wild;
   }
 }
 
-// Check if this compound statement is the body
-// to a function with unsafe parameters.
-bool CheckedRegionFinder::hasUncheckedParameters(CompoundStmt *S) {
-  const auto &Parents = Context->getParents(*S);
-  if (Parents.empty()) {
-    return false;
-  }
+// If S is the body of the function being traversed, then return the
+// FunctionDecl, otherwise return null.
+FunctionDecl *CheckedRegionFinder::getFunctionDeclOfBody(CompoundStmt *S) {
+  if (CurrentFunction && CurrentFunction->doesThisDeclarationHaveABody() &&
+      CurrentFunction->getBody() == S)
+    return CurrentFunction;
+  return nullptr;
+}
 
-  const auto *Parent = Parents[0].get<FunctionDecl>();
+// Check if Parent, the function of a compound statement that is a function
+// body, has unsafe parameters.
+bool CheckedRegionFinder::hasUncheckedParameters(FunctionDecl *Parent) {
   if (!Parent) {
     return false;
   }
 
   int Localwild = false;
   for (auto *Child : Parent->parameters()) {
-    CheckedRegionFinder Sub(Context, Writer, Info, Seen, Map, EmitWarnings);
+    CheckedRegionFinder Sub(Context, Writer, Info, Seen, Map, Summary,
+                            EmitWarnings);
     Sub.TraverseParmVarDecl(Child);
     Localwild |= Sub.Wild;
   }
@@ -322,19 +301,27 @@ bool CheckedRegionFinder::hasUncheckedParameters(CompoundStmt *S) {
   return Localwild || Parent->isVariadic();
 }
 
+// Check if a parameter of FD, a function that is called or referred to, is
+// wild. A function is usually referred to many times, so the result is kept
+// in the summary.
+bool CheckedRegionFinder::hasWildParams(FunctionDecl *FD) {
+  auto It = Summary.WildParams.find(FD);
+  if (It != Summary.WildParams.end())
+    return It->second;
+
+  bool ParamsWild = false;
+  auto *FV = Info.getFuncConstraint(FD, Context);
+  for (unsigned I = 0; I < FV->numParams() && !ParamsWild; I++)
+    ParamsWild = isWild(*FV->getExternalParam(I));
+  Summary.WildParams[FD] = ParamsWild;
+  return ParamsWild;
+}
+
 bool CheckedRegionFinder::isInStatementPosition(CallExpr *C) {
   // First check if our parent is a compound statement
-  const auto &Parents = Context->getParents(*C);
-  if (Parents.empty()) {
-    return false; // This case shouldn't happen,
-                  // but if it does play it safe and mark WILD.
-  }
-  const auto *Parent = Parents[0].get<CompoundStmt>();
-  if (Parent) {
+  if (C == StmtInCompound) {
     //Check if we are the only child
-    auto Childs = Parent->children();
-    int NumChilds = std::distance(Childs.begin(), Childs.end());
-    return NumChilds > 1;
+    return ParentCompound->size() > 1;
   }
   //TODO there are other statement positions
   //     besides child of compound stmt
@@ -351,9 +338,18 @@ bool CheckedRegionFinder::isWild(CVarOption Cv) {
 }
 
 bool CheckedRegionFinder::containsUncheckedPtr(QualType Qt) {
-  // TODO does a more efficient representation exist?
+  // The result only depends on the canonical type, which is usually shared by
+  // many declarations and expressions, so it is looked up in the summary
+  // before the fields of the structs it refers to are walked.
+  const clang::Type *Ty = Qt.getCanonicalType().getTypePtr();
+  auto It = Summary.UncheckedTypes.find(Ty);
+  if (It != Summary.UncheckedTypes.end())
+    return It->second;
+
   std::set<std::string> Seen;
-  return containsUncheckedPtrAcc(Qt, Seen);
+  bool Unchecked = containsUncheckedPtrAcc(Qt, Seen);
+  Summary.UncheckedTypes[Ty] = Unchecked;
+  return Unchecked;
 }
 
 // Recursively determine if a type is unchecked.
@@ -419,12 +415,13 @@ bool CheckedRegionFinder::isUncheckedStruct(QualType Qt,
 
 // Mark the given compound statement with
 // whether or not it is checked
-void CheckedRegionFinder::markChecked(CompoundStmt *S, int Localwild) {
+void CheckedRegionFinder::markChecked(CompoundStmt *S, FunctionDecl *FD,
+                                      int Localwild) {
   auto Cur = S->getWrittenCheckedSpecifier();
   llvm::FoldingSetNodeID Id;
   S->Profile(Id, *Context, true);
 
-  bool IsChecked = !hasUncheckedParameters(S) &&
+  bool IsChecked = !hasUncheckedParameters(FD) &&
                    Cur == CheckedScopeSpecifier::CSS_None && Localwild == 0;
 
   Map[Id] = IsChecked ? IS_CHECKED : IS_UNCHECKED;
@@ -95,7 +95,7 @@ public:
       bool IsNamedInLineStruct =
           IsInLineStruct && LastRecordDecl->getNameAsString() != "";
       if (IsInLineStruct && !IsNamedInLineStruct) {
-        if (!AllTypes) {
+        if (!get3COptions().AllTypes) {
           CVarOption CV = Info.getVariable(VD, Context);
           CB.constraintCVarToWild(CV, "Inline struct encountered.");
         } else {
@@ -273,7 +273,8 @@ public:
               constrainConsVarGeq(ParameterDC, ArgumentConstraints.first, CS,
                                   &PL, CA, false, &Info, false);
 
-              if (AllTypes && TFD != nullptr && I < TFD->getNumParams()) {
+              if (get3COptions().AllTypes && TFD != nullptr &&
+                  I < TFD->getNumParams()) {
                 auto *PVD = TFD->getParamDecl(I);
                 auto &CSBI = Info.getABoundsInfo().getCtxSensBoundsHandler();
                 // Here, we need to handle context-sensitive assignment.
@@ -283,7 +284,7 @@ public:
               }
             } else {
               // The argument passed to a function ith varargs; make it wild
-              if (HandleVARARGS) {
+              if (get3COptions().HandleVARARGS) {
                 CB.constraintAllCVarsToWild(ArgumentConstraints.first,
                                             "Passing argument to a function "
                                             "accepting var args.",
@@ -296,7 +297,7 @@ public:
                   // (https://github.com/correctcomputation/checkedc-clang/issues/549).
                   constrainVarsTo(ArgumentConstraints.first, CS.getNTArr());
                 }
-                if (Verbose) {
+                if (get3COptions().Verbose) {
                   std::string FuncName = TargetFV->getName();
                   errs() << "Ignoring function as it contains varargs:"
                          << FuncName << "\n";
@@ -520,7 +521,7 @@ public:
   bool VisitFunctionDecl(FunctionDecl *D) {
     FullSourceLoc FL = Context->getFullLoc(D->getBeginLoc());
 
-    if (Verbose)
+    if (get3COptions().Verbose)
       errs() << "Analyzing function " << D->getName() << "\n";
 
     if (FL.isValid()) { // TODO: When would this ever be false?
@@ -528,7 +529,7 @@ public:
         Stmt *Body = D->getBody();
         FunctionVisitor FV = FunctionVisitor(Context, Info, D, TVInfo);
         FV.TraverseStmt(Body);
-        if (AllTypes) {
+        if (get3COptions().AllTypes) {
           // Only do this, if all types is enabled.
           LengthVarInference LVI(Info, Context, D);
           LVI.Visit(Body);
@@ -536,7 +537,7 @@ public:
       }
     }
 
-    if (Verbose)
+    if (get3COptions().Verbose)
       errs() << "Done analyzing function\n";
 
     return true;
@@ -623,9 +624,68 @@ private:
   }
 };
 
-void VariableAdderConsumer::HandleTranslationUnit(ASTContext &C) {
+bool HeaderFunctionDeduplicator::isDuplicate(FunctionDecl *FD, ASTContext &C) {
+  SourceManager &SM = C.getSourceManager();
+  SourceLocation Loc = SM.getExpansionLoc(FD->getLocation());
+  if (Loc.isInvalid() || SM.isInMainFile(Loc))
+    return false;
+  PersistentSourceLoc PSL = PersistentSourceLoc::mkPSL(FD, C);
+  if (!PSL.valid())
+    return false;
+  // Two functions generated by one macro expansion share a location, but
+  // they differ in name and so in ODR hash.
+  const FileEntry *MainFE = SM.getFileEntryForID(SM.getMainFileID());
+  std::string TU = MainFE ? MainFE->getName().str() : "";
+  auto Inserted = Seen.insert({{PSL, FD->getODRHash()}, TU});
+  return !Inserted.second && Inserted.first->second != TU;
+}
+
+// A ProgramVariableAdder that only records what the VariableAdderVisitor
+// would add to ProgramInfo, for RecordedVariables. Whether a typedef has been
+// seen depends on the translation units before, so that is decided when the
+// typedef is added.
+class VariableRecorder : public ProgramVariableAdder {
+public:
+  VariableRecorder() : Entries(nullptr) {}
+
+  // Record the following entries in E.
+  void setEntries(std::vector<RecordedVariables::Entry> &E) { Entries = &E; }
+
+  void addVariable(DeclaratorDecl *D, ASTContext *AstContext) override {
+    Entries->push_back({RecordedVariables::Variable, D,
+                        PersistentSourceLoc::mkPSL(D, *AstContext), false});
+  }
+
+  void addABoundsVariable(Decl *D) override {
+    Entries->push_back(
+        {RecordedVariables::ABoundsVariable, D, PersistentSourceLoc(), false});
+  }
+
+  bool seenTypedef(PersistentSourceLoc PSL) override { return false; }
+
+  void addTypedef(PersistentSourceLoc PSL, bool CanRewriteDef, TypedefDecl *TD,
+                  ASTContext &C) override {
+    Entries->push_back({RecordedVariables::Typedef, TD, PSL, CanRewriteDef});
+  }
+
+private:
+  std::vector<RecordedVariables::Entry> *Entries;
+};
+
+void RecordedVariables::record(ASTContext &C) {
+  TopLevelDecls.clear();
+  VariableRecorder Recorder;
+  VariableAdderVisitor VAV = VariableAdderVisitor(&C, Recorder);
+  for (const auto &D : C.getTranslationUnitDecl()->decls()) {
+    TopLevelDecls.emplace_back(D, std::vector<Entry>());
+    Recorder.setEntries(TopLevelDecls.back().second);
+    VAV.TraverseDecl(D);
+  }
+}
+
+void VariableAdderConsumer::enterTranslationUnit(ASTContext &C) {
   Info.enterCompilationUnit(C);
-  if (Verbose) {
+  if (get3COptions().Verbose) {
     SourceManager &SM = C.getSourceManager();
     FileID MainFileId = SM.getMainFileID();
     const FileEntry *FE = SM.getFileEntryForID(MainFileId);
@@ -634,24 +694,92 @@ void VariableAdderConsumer::HandleTranslationUnit(ASTContext &C) {
     else
       errs() << "Analyzing\n";
   }
+}
+
+void VariableAdderConsumer::exitTranslationUnit() {
+  if (get3COptions().Verbose)
+    errs() << "Done analyzing\n";
+
+  Info.exitCompilationUnit();
+}
+
+bool VariableAdderConsumer::isDuplicateFunction(Decl *D, ASTContext &C) {
+  // The variables of a function that an earlier translation unit added are
+  // keyed by the same source locations, so addVariable would only find
+  // them again. A function without an entry in the function maps still
+  // needs the visit to add one.
+  auto *FD = dyn_cast<FunctionDecl>(D);
+  return FD && Info.getFuncConstraint(FD, &C) &&
+         HeaderFunctions.isDuplicate(FD, C);
+}
+
+void VariableAdderConsumer::HandleTranslationUnit(ASTContext &C) {
+  enterTranslationUnit(C);
 
   VariableAdderVisitor VAV = VariableAdderVisitor(&C, Info);
   TranslationUnitDecl *TUD = C.getTranslationUnitDecl();
   // Collect Variables.
   for (const auto &D : TUD->decls()) {
+    if (isDuplicateFunction(D, C))
+      continue;
     VAV.TraverseDecl(D);
   }
 
-  if (Verbose)
-    errs() << "Done analyzing\n";
+  exitTranslationUnit();
+}
 
-  Info.exitCompilationUnit();
-  return;
+void VariableAdderConsumer::addRecordedVariables(ASTContext &C,
+                                                 const RecordedVariables &R) {
+  enterTranslationUnit(C);
+
+  for (const auto &TopLevel : R.TopLevelDecls) {
+    if (isDuplicateFunction(TopLevel.first, C))
+      continue;
+    for (const RecordedVariables::Entry &E : TopLevel.second) {
+      switch (E.Kind) {
+      case RecordedVariables::Variable:
+        Info.addVariableAt(cast<DeclaratorDecl>(E.D), &C, E.PSL);
+        break;
+      case RecordedVariables::ABoundsVariable:
+        Info.addABoundsVariable(E.D);
+        break;
+      case RecordedVariables::Typedef:
+        if (!Info.seenTypedef(E.PSL))
+          Info.addTypedef(E.PSL, E.CanRewriteDef, cast<TypedefDecl>(E.D), C);
+        break;
+      }
+    }
+  }
+
+  exitTranslationUnit();
+}
+
+// Is D a function prototype or a variable declaration without an initializer
+// that comes from a system header that 3C cannot write, and that nothing in
+// the translation unit refers to? Such a declaration, like most of the ones
+// in the standard headers, has no expressions to generate constraints from,
+// and no expression of the program reaches its constraint variables.
+static bool isUnreferencedSystemHeaderDecl(Decl *D, ASTContext &C) {
+  if (D->isReferenced() || D->isUsed(/*CheckUsedAttr=*/false))
+    return false;
+  if (auto *FD = dyn_cast<FunctionDecl>(D)) {
+    if (FD->hasBody())
+      return false;
+  } else if (auto *VD = dyn_cast<VarDecl>(D)) {
+    if (VD->hasInit())
+      return false;
+  } else {
+    return false;
+  }
+  SourceManager &SM = C.getSourceManager();
+  SourceLocation Loc = SM.getExpansionLoc(D->getLocation());
+  return Loc.isValid() && SM.isInSystemHeader(Loc) &&
+         !canWrite(PersistentSourceLoc::mkPSL(D, C));
 }
 
 void ConstraintBuilderConsumer::HandleTranslationUnit(ASTContext &C) {
   Info.enterCompilationUnit(C);
-  if (Verbose) {
+  if (get3COptions().Verbose) {
     SourceManager &SM = C.getSourceManager();
     FileID MainFileId = SM.getMainFileID();
     const FileEntry *FE = SM.getFileEntryForID(MainFileId);
@@ -675,6 +803,21 @@ void ConstraintBuilderConsumer::HandleTranslationUnit(ASTContext &C) {
 
   // Generate constraints.
   for (const auto &D : TUD->decls()) {
+    // The constraint variables of an unreferenced system header declaration
+    // are still added, so a later translation unit that uses the declaration
+    // finds them, but there is nothing to constrain them with here.
+    if (isUnreferencedSystemHeaderDecl(D, C))
+      continue;
+
+    // A function prototype has no expressions to build constraints from, so
+    // the copies of a header prototype are skipped after the first one. The
+    // constraints of the expressions in a body are recorded per translation
+    // unit for rewriting, so definitions are always visited.
+    auto *FD = dyn_cast<FunctionDecl>(D);
+    if (FD && !FD->doesThisDeclarationHaveABody() &&
+        HeaderFunctions.isDuplicate(FD, C))
+      continue;
+
     // The order of these traversals CANNOT be changed because the constraint
     // gen visitor requires the type variable information gathered in the type
     // variable traversal.
@@ -688,7 +831,7 @@ void ConstraintBuilderConsumer::HandleTranslationUnit(ASTContext &C) {
   // Store type variable information for use in rewriting
   TV.setProgramInfoTypeVars();
 
-  if (Verbose)
+  if (get3COptions().Verbose)
     errs() << "Done analyzing\n";
 
   PStats.endConstraintBuilderTime();
@@ -51,7 +51,7 @@ void ConstraintResolver::constraintCVarToWild(CVarOption CVar,
 
 // Return a set of PVConstraints equivalent to the set given,
 // but dereferenced one level down
-CVarSet ConstraintResolver::handleDeref(CVarSet T) {
+CVarSet ConstraintResolver::handleDeref(const CVarSet &T) {
   CVarSet DerefVars;
   for (ConstraintVariable *CV : T) {
     PVConstraint *PVC = cast<PVConstraint>(CV);
@@ -64,7 +64,7 @@ CVarSet ConstraintResolver::handleDeref(CVarSet T) {
 // For each constraint variable either invoke addAtom to add an additional level
 // of indirection (when the constraint is PVConstraint), or return the
 // constraint unchanged (when the constraint is a function constraint).
-CVarSet ConstraintResolver::addAtomAll(CVarSet CVS, ConstAtom *PtrTyp,
+CVarSet ConstraintResolver::addAtomAll(const CVarSet &CVS, ConstAtom *PtrTyp,
                                        Constraints &CS) {
   CVarSet Result;
   for (auto *CV : CVS) {
@@ -106,8 +106,10 @@ static ConstAtom *analyzeAllocExpr(CallExpr *CE, Constraints &CS,
 
   ConstAtom *Ret = CS.getPtr();
   Expr *E;
-  if (std::find(AllocatorFunctions.begin(), AllocatorFunctions.end(),
-                FuncName) != AllocatorFunctions.end() ||
+  const std::vector<std::string> &Allocators =
+      get3COptions().AllocatorFunctions;
+  if (std::find(Allocators.begin(), Allocators.end(), FuncName) !=
+          Allocators.end() ||
       FuncName.compare("malloc") == 0)
     E = CE->getArg(0);
   else {
@@ -145,10 +147,8 @@ CVarSet ConstraintResolver::getInvalidCastPVCons(CastExpr *E) {
   return {P};
 }
 
-inline CSetBkeyPair pairWithEmptyBkey(const CVarSet &Vars) {
-  BKeySet EmptyBSet;
-  EmptyBSet.clear();
-  return std::make_pair(Vars, EmptyBSet);
+inline CSetBkeyPair pairWithEmptyBkey(CVarSet Vars) {
+  return std::make_pair(std::move(Vars), BKeySet());
 }
 
 // Returns a pair of set of ConstraintVariables and set of BoundsKey
@@ -203,8 +203,9 @@ CSetBkeyPair ConstraintResolver::getExprConstraintVars(Expr *E) {
     // Apart from the above expressions constraints for all the other
     // expressions can be cached.
     // First, check if the expression has constraints that are cached?
-    if (Info.hasPersistentConstraints(E, Context))
-      return Info.getPersistentConstraints(E, Context);
+    if (const CSetBkeyPair *Cached =
+            Info.findPersistentConstraints(E, Context))
+      return *Cached;
 
     CSetBkeyPair Ret = EmptyCSBKeySet;
     // Implicit cast, e.g., T* from T[] or int (*)(int) from int (int),
@@ -224,10 +225,10 @@ CSetBkeyPair ConstraintResolver::getExprConstraintVars(Expr *E) {
         CVarSet WildCVar = getInvalidCastPVCons(IE);
         constrainConsVarGeq(CVs.first, WildCVar, CS, nullptr, Safe_to_Wild,
                             false, &Info);
-        Ret = std::make_pair(WildCVar, CVs.second);
+        Ret = std::make_pair(std::move(WildCVar), std::move(CVs.second));
       } else {
         // Else, return sub-expression's result.
-        Ret = CVs;
+        Ret = std::move(CVs);
       }
     } else if (ExplicitCastExpr *ECE = dyn_cast<ExplicitCastExpr>(E)) {
       assert(ECE->getType() == TypE);
@@ -321,7 +322,7 @@ CSetBkeyPair ConstraintResolver::getExprConstraintVars(Expr *E) {
       CSetBkeyPair T = getExprConstraintVars(ASE->getBase());
       CVarSet Tmp = handleDeref(T.first);
       T.first.swap(Tmp);
-      Ret = T;
+      Ret = std::move(T);
     }
     // ++e, &e, *e, etc.
     else if (UnaryOperator *UO = dyn_cast<UnaryOperator>(E)) {
@@ -362,7 +363,8 @@ CSetBkeyPair ConstraintResolver::getExprConstraintVars(Expr *E) {
               if (!PCV->getArrPresent())
                 PCV->constrainOuterTo(CS, CS.getPtr(), true);
           // Add a VarAtom to UOExpr's PVConstraint, for &.
-          Ret = std::make_pair(addAtomAll(T.first, CS.getPtr(), CS), T.second);
+          Ret = std::make_pair(addAtomAll(T.first, CS.getPtr(), CS),
+                               std::move(T.second));
         }
         break;
       }
@@ -370,7 +372,7 @@ CSetBkeyPair ConstraintResolver::getExprConstraintVars(Expr *E) {
       case UO_Deref: {
         // We are dereferencing, so don't assign to LHS
         CSetBkeyPair T = getExprConstraintVars(UOExpr);
-        Ret = std::make_pair(handleDeref(T.first), T.second);
+        Ret = std::make_pair(handleDeref(T.first), std::move(T.second));
         break;
       }
         /* Operations on lval; if pointer, just process that */
@@ -550,7 +552,7 @@ CSetBkeyPair ConstraintResolver::getExprConstraintVars(Expr *E) {
         // Array initialization is similar AddrOf, so the same pattern is
         // used where a new indirection is added to constraint variables.
         Ret = std::make_pair(addAtomAll(CVars.first, CS.getArr(), CS),
-                             CVars.second);
+                             std::move(CVars.second));
       } else {
         // This branch should only be taken on compound literal expressions
         // with pointer type (e.g. int *a = (int*){(int*) 1}).
@@ -560,7 +562,7 @@ CSetBkeyPair ConstraintResolver::getExprConstraintVars(Expr *E) {
         assert("InitlistExpr of type other than array or pointer in "
                "getExprConstraintVars" &&
                ILE->getType()->isPointerType());
-        Ret = CVars;
+        Ret = std::move(CVars);
       }
     }
     // (int[]){e1, e2, e3, ... }
@@ -574,7 +576,7 @@ CSetBkeyPair ConstraintResolver::getExprConstraintVars(Expr *E) {
                           Same_to_Same, false, &Info);
 
       CVarSet T = {P};
-      Ret = std::make_pair(T, Vars.second);
+      Ret = std::make_pair(std::move(T), std::move(Vars.second));
     }
     // "foo"
     else if (clang::StringLiteral *Str = dyn_cast<clang::StringLiteral>(E)) {
@@ -614,7 +616,7 @@ CSetBkeyPair ConstraintResolver::getExprConstraintVars(Expr *E) {
       P->constrainToWild(Info.getConstraints(), Rsn, &PL);
       Ret = pairWithEmptyBkey({P});
     } else {
-      if (Verbose) {
+      if (get3COptions().Verbose) {
         llvm::errs() << "WARNING! Initialization expression ignored: ";
         E->dump(llvm::errs(), *Context);
         llvm::errs() << "\n";
@@ -637,13 +639,19 @@ ConstraintResolver::getAllSubExprConstraintVars(std::vector<Expr *> &Exprs) {
   CVarSet AggregateCons;
   BKeySet AggregateBKeys;
   for (const auto &E : Exprs) {
-    CSetBkeyPair ECons;
-    ECons = getExprConstraintVars(E);
-    AggregateCons.insert(ECons.first.begin(), ECons.first.end());
-    AggregateBKeys.insert(ECons.second.begin(), ECons.second.end());
+    CSetBkeyPair ECons = getExprConstraintVars(E);
+    // Take over the sets of the first expression instead of copying them.
+    if (AggregateCons.empty())
+      AggregateCons.swap(ECons.first);
+    else
+      AggregateCons.insert(ECons.first.begin(), ECons.first.end());
+    if (AggregateBKeys.empty())
+      AggregateBKeys.swap(ECons.second);
+    else
+      AggregateBKeys.insert(ECons.second.begin(), ECons.second.end());
   }
 
-  return std::make_pair(AggregateCons, AggregateBKeys);
+  return std::make_pair(std::move(AggregateCons), std::move(AggregateBKeys));
 }
 
 void ConstraintResolver::constrainLocalAssign(Stmt *TSt, Expr *LHS, Expr *RHS,
@@ -661,7 +669,7 @@ void ConstraintResolver::constrainLocalAssign(Stmt *TSt, Expr *LHS, Expr *RHS,
 
   // Only if all types are enabled and these are not pointers, then track
   // the assignment.
-  if (AllTypes) {
+  if (get3COptions().AllTypes) {
     if ((!containsValidCons(L.first) && !containsValidCons(R.first)) ||
         !HandleBoundsKey) {
       ABI.handleAssignment(LHS, L.first, L.second, RHS, R.first, R.second,
@@ -686,7 +694,7 @@ void ConstraintResolver::constrainLocalAssign(Stmt *TSt, DeclaratorDecl *D,
   if (V.hasValue())
     constrainConsVarGeq(&V.getValue(), RHSCons.first, Info.getConstraints(),
                         PLPtr, CAction, false, &Info, HandleBoundsKey);
-  if (AllTypes && !IgnoreBnds) {
+  if (get3COptions().AllTypes && !IgnoreBnds) {
     if (!HandleBoundsKey || (!(V.hasValue() && isValidCons(&V.getValue())) &&
                              !containsValidCons(RHSCons.first))) {
       auto &ABI = Info.getABoundsInfo();
@@ -708,8 +716,9 @@ CVarSet ConstraintResolver::pvConstraintFromType(QualType TypE) {
 }
 
 CVarSet ConstraintResolver::getBaseVarPVConstraint(DeclRefExpr *Decl) {
-  if (Info.hasPersistentConstraints(Decl, Context))
-    return Info.getPersistentConstraintsSet(Decl, Context);
+  if (const CSetBkeyPair *Cached =
+          Info.findPersistentConstraints(Decl, Context))
+    return Cached->first;
 
   assert(Decl->getType()->isRecordType() ||
          Decl->getType()->isArithmeticType());
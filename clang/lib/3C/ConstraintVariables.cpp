@@ -13,8 +13,10 @@
 #include "clang/3C/3CGlobalOptions.h"
 #include "clang/3C/ProgramInfo.h"
 #include "clang/Lex/Lexer.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/CommandLine.h"
+#include <mutex>
 #include <sstream>
 
 using namespace clang;
@@ -32,6 +34,51 @@ static llvm::cl::opt<bool> DisableFunctionEdges(
     llvm::cl::desc("Disable reverse edges for external functions."),
     llvm::cl::init(false), llvm::cl::cat(OptimizationCategory));
 
+// The strings interned by ConstraintVariable::internString. They are never
+// freed, since the constraint variables are not either.
+static llvm::StringSet<llvm::BumpPtrAllocator> &getInternedStrings() {
+  static llvm::StringSet<llvm::BumpPtrAllocator> InternedStrings;
+  return InternedStrings;
+}
+static std::mutex InternedStringsMutex;
+
+llvm::StringRef ConstraintVariable::internString(llvm::StringRef S) {
+  if (S.empty())
+    return llvm::StringRef();
+  std::lock_guard<std::mutex> Lock(InternedStringsMutex);
+  return getInternedStrings().insert(S).first->getKey();
+}
+
+void ConstraintVariable::getInternedStringStats(size_t &NumStrings,
+                                                size_t &Bytes) {
+  std::lock_guard<std::mutex> Lock(InternedStringsMutex);
+  auto &Strings = getInternedStrings();
+  NumStrings = Strings.size();
+  Bytes = Strings.getAllocator().getTotalMemory() +
+          Strings.getNumBuckets() * (sizeof(void *) + sizeof(unsigned));
+}
+
+size_t ConstraintVariable::getStringHeapBytes(const std::string &S) {
+  // Short strings are stored in the std::string itself.
+  const char *Data = S.data();
+  const char *Obj = reinterpret_cast<const char *>(&S);
+  if (Data >= Obj && Data < Obj + sizeof(S))
+    return 0;
+  return S.capacity() + 1;
+}
+
+// The approximate size of a node of a std::set or std::map holding T: the
+// value, the three links and the color.
+template <typename T> static size_t treeNodeBytes() {
+  return sizeof(T) + 4 * sizeof(void *);
+}
+
+// The heap memory used by V once it has outgrown its inline elements.
+template <typename T, unsigned N>
+static size_t smallVectorHeapBytes(const llvm::SmallVector<T, N> &V) {
+  return V.capacity() > N ? V.capacity() * sizeof(T) : 0;
+}
+
 std::string ConstraintVariable::getRewritableOriginalTy() const {
   std::string OrigTyString = getOriginalTy();
   std::string SpaceStr = " ";
@@ -73,8 +120,8 @@ PointerVariableConstraint::getNamedNonPtrPVConstraint(StringRef Name,
 
 PointerVariableConstraint *
 PointerVariableConstraint::derefPVConstraint(PointerVariableConstraint *PVC) {
-  std::vector<Atom *> Vars = PVC->Vars;
-  std::vector<ConstAtom *> SrcVars = PVC->SrcVars;
+  CAtoms Vars = PVC->Vars;
+  auto SrcVars = PVC->SrcVars;
   assert(!PVC->Vars.empty() && !SrcVars.empty());
   Vars.erase(Vars.begin());
   SrcVars.erase(SrcVars.begin());
@@ -87,8 +134,8 @@ PointerVariableConstraint *PointerVariableConstraint::addAtomPVConstraint(
     PointerVariableConstraint *PVC, ConstAtom *PtrTyp, Constraints &CS) {
   VarAtom *NewA = CS.getFreshVar("&" + PVC->Name, VarAtom::V_Other);
   CS.addConstraint(CS.createGeq(NewA, PtrTyp, false));
-  std::vector<Atom *> Vars = PVC->Vars;
-  std::vector<ConstAtom *> SrcVars = PVC->SrcVars;
+  CAtoms Vars = PVC->Vars;
+  auto SrcVars = PVC->SrcVars;
   if (!Vars.empty()) {
     if (auto *VA = dyn_cast<VarAtom>(*Vars.begin())) {
       // If PVC is already a pointer, add implication forcing outermost one to
@@ -109,9 +156,12 @@ PointerVariableConstraint::PointerVariableConstraint(
     PointerVariableConstraint *Ot, Constraints &CS)
     : ConstraintVariable(ConstraintVariable::PointerVariable, Ot->OriginalType,
                          Ot->Name),
-      FV(nullptr), PartOfFuncPrototype(Ot->PartOfFuncPrototype) {
+      FV(nullptr), PartOfFuncPrototype(Ot->PartOfFuncPrototype),
+      IsTypedef(false) {
   this->ArrSizes = Ot->ArrSizes;
   this->ArrSizeStrs = Ot->ArrSizeStrs;
+  this->Vars.reserve(Ot->Vars.size());
+  this->SrcVars.reserve(Ot->SrcVars.size());
   this->HasEqArgumentConstraints = Ot->HasEqArgumentConstraints;
   this->ValidBoundsKey = Ot->ValidBoundsKey;
   this->BKey = Ot->BKey;
@@ -215,11 +265,15 @@ PointerVariableConstraint::PointerVariableConstraint(
     bool VarAtomForChecked, TypeSourceInfo *TSInfo, const QualType &ITypeT)
     : ConstraintVariable(ConstraintVariable::PointerVariable,
                          tyToStr(QT.getTypePtr()), N),
-      FV(nullptr), SrcHasItype(false), PartOfFuncPrototype(InFunc != nullptr),
-      Parent(nullptr) {
+      FV(nullptr), Parent(nullptr), SrcHasItype(false),
+      PartOfFuncPrototype(InFunc != nullptr), IsTypedef(false) {
   QualType QTy = QT;
   const Type *Ty = QTy.getTypePtr();
   auto &CS = I.getConstraints();
+  auto Sizes = std::make_shared<ArrSizesMap>();
+  auto SizeStrs = std::make_shared<ArrSizeStrsMap>();
+  ArrSizes = Sizes;
+  ArrSizeStrs = SizeStrs;
   // If the type is a decayed type, then maybe this is the result of
   // decaying an array to a pointer. If the original type is some
   // kind of array type, we want to use that instead.
@@ -248,7 +302,7 @@ PointerVariableConstraint::PointerVariableConstraint(
       if (BExpr != nullptr) {
         SourceRange R = BExpr->getSourceRange();
         if (R.isValid()) {
-          BoundsAnnotationStr = getSourceText(R, C);
+          BoundsAnnotationStr = internString(getSourceText(R, C));
         }
         if (D->hasBoundsAnnotations() && ABInfo.isValidBoundVariable(D)) {
           assert(ABInfo.tryGetVariable(D, BKey) &&
@@ -287,7 +341,7 @@ PointerVariableConstraint::PointerVariableConstraint(
 
         SourceRange R = ITE->getSourceRange();
         if (R.isValid()) {
-          ItypeStr = getSourceText(R, C);
+          ItypeStr = internString(getSourceText(R, C));
           assert(ItypeStr.size() > 0);
         }
       }
@@ -426,7 +480,7 @@ PointerVariableConstraint::PointerVariableConstraint(
 
       // See if there is a constant size to this array type at this position.
       if (const ConstantArrayType *CAT = dyn_cast<ConstantArrayType>(Ty)) {
-        ArrSizes[TypeIdx] = std::pair<OriginalArrType, uint64_t>(
+        (*Sizes)[TypeIdx] = std::pair<OriginalArrType, uint64_t>(
             O_SizedArray, CAT->getSize().getZExtValue());
 
         if (!TLoc.isNull()) {
@@ -434,7 +488,7 @@ PointerVariableConstraint::PointerVariableConstraint(
           if (!ArrTLoc.isNull()) {
             std::string SizeStr = getSourceText(ArrTLoc.getBracketsRange(), C);
             if (!SizeStr.empty())
-              ArrSizeStrs[TypeIdx] = SizeStr;
+              (*SizeStrs)[TypeIdx] = SizeStr;
           }
         }
 
@@ -445,7 +499,7 @@ PointerVariableConstraint::PointerVariableConstraint(
           ABInfo.insertDeclaredBounds(D, NB);
         }
       } else {
-        ArrSizes[TypeIdx] =
+        (*Sizes)[TypeIdx] =
             std::pair<OriginalArrType, uint64_t>(O_UnSizedArray, 0);
       }
 
@@ -462,7 +516,7 @@ PointerVariableConstraint::PointerVariableConstraint(
       // indexes K to the qualification of QTy, if any.
       insertQualType(TypeIdx, QTy);
 
-      ArrSizes[TypeIdx] = std::pair<OriginalArrType, uint64_t>(O_Pointer, 0);
+      (*Sizes)[TypeIdx] = std::pair<OriginalArrType, uint64_t>(O_Pointer, 0);
 
       // Iterate.
       QTy = QTy.getSingleStepDesugaredType(C);
@@ -514,10 +568,10 @@ PointerVariableConstraint::PointerVariableConstraint(
                           TSInfo);
 
   // Get a string representing the type without pointer and array indirection.
-  BaseType = extractBaseType(D, TSInfo, QT, Ty, C);
+  BaseType = internString(extractBaseType(D, TSInfo, QT, Ty, C));
 
   IsVoidPtr = isTypeHasVoid(QT);
-  bool IsWild = !getIsGeneric() && (isVarArgType(BaseType) || IsVoidPtr);
+  bool IsWild = !getIsGeneric() && (isVarArgType(BaseType.str()) || IsVoidPtr);
   if (IsWild) {
     std::string Rsn =
         IsVoidPtr ? "Default void* type" : "Default Var arg list type";
@@ -530,7 +584,7 @@ PointerVariableConstraint::PointerVariableConstraint(
   // Add qualifiers.
   std::ostringstream QualStr;
   getQualString(TypeIdx, QualStr);
-  BaseType = QualStr.str() + BaseType;
+  BaseType = internString(QualStr.str() + BaseType.str());
 
   // Here lets add implication that if outer pointer is WILD
   // then make the inner pointers WILD too.
@@ -644,32 +698,31 @@ void PointerVariableConstraint::dumpJson(llvm::raw_ostream &O) const {
 
 void PointerVariableConstraint::getQualString(uint32_t TypeIdx,
                                               std::ostringstream &Ss) const {
-  auto QIter = QualMap.find(TypeIdx);
-  if (QIter != QualMap.end()) {
-    for (Qualification Q : QIter->second) {
-      switch (Q) {
-      case ConstQualification:
-        Ss << "const ";
-        break;
-      case VolatileQualification:
-        Ss << "volatile ";
-        break;
-      case RestrictQualification:
-        Ss << "restrict ";
-        break;
-      }
-    }
-  }
+  if (TypeIdx >= QualFlags.size())
+    return;
+  uint8_t Quals = QualFlags[TypeIdx];
+  if (Quals & (1 << ConstQualification))
+    Ss << "const ";
+  if (Quals & (1 << VolatileQualification))
+    Ss << "volatile ";
+  if (Quals & (1 << RestrictQualification))
+    Ss << "restrict ";
 }
 
 void PointerVariableConstraint::insertQualType(uint32_t TypeIdx,
                                                QualType &QTy) {
+  uint8_t Quals = 0;
   if (QTy.isConstQualified())
-    QualMap[TypeIdx].insert(ConstQualification);
+    Quals |= 1 << ConstQualification;
   if (QTy.isVolatileQualified())
-    QualMap[TypeIdx].insert(VolatileQualification);
+    Quals |= 1 << VolatileQualification;
   if (QTy.isRestrictQualified())
-    QualMap[TypeIdx].insert(RestrictQualification);
+    Quals |= 1 << RestrictQualification;
+  if (Quals == 0)
+    return;
+  if (TypeIdx >= QualFlags.size())
+    QualFlags.resize(TypeIdx + 1, 0);
+  QualFlags[TypeIdx] |= Quals;
 }
 
 // Take an array or nt_array variable, determines if it is a constant array,
@@ -677,8 +730,8 @@ void PointerVariableConstraint::insertQualType(uint32_t TypeIdx,
 bool PointerVariableConstraint::emitArraySize(
     std::stack<std::string> &ConstSizeArrs, uint32_t TypeIdx,
     Atom::AtomKind Kind) const {
-  auto I = ArrSizes.find(TypeIdx);
-  assert(I != ArrSizes.end());
+  auto I = getArrSizes().find(TypeIdx);
+  assert(I != getArrSizes().end());
   OriginalArrType Oat = I->second.first;
   uint64_t Oas = I->second.second;
 
@@ -686,8 +739,9 @@ bool PointerVariableConstraint::emitArraySize(
     std::ostringstream SizeStr;
     if (Kind != Atom::A_Wild)
       SizeStr << (Kind == Atom::A_NTArr ? " _Nt_checked" : " _Checked");
-    if (ArrSizeStrs.find(TypeIdx) != ArrSizeStrs.end()) {
-      std::string SrcSizeStr = ArrSizeStrs.find(TypeIdx)->second;
+    auto StrI = getArrSizeStrs().find(TypeIdx);
+    if (StrI != getArrSizeStrs().end()) {
+      std::string SrcSizeStr = StrI->second;
       assert(!SrcSizeStr.empty());
       // In some weird edge cases the size of the array is defined by a macro
       // where the macro also includes the brackets. We need to add a space
@@ -724,7 +778,7 @@ bool PointerVariableConstraint::isTypedef(void) { return IsTypedef; }
 void PointerVariableConstraint::setTypedef(TypedefNameDecl *T, std::string S) {
   IsTypedef = true;
   TDT = T;
-  TypedefString = S;
+  TypedefString = internString(S);
 }
 
 // Mesh resolved constraints with the PointerVariableConstraints set of
@@ -737,6 +791,36 @@ std::string PointerVariableConstraint::gatherQualStrings(void) const {
   return S.str();
 }
 
+// The types generated by mkString, keyed by getTypeStrCacheKey. Declarations
+// that have the same type and solution are common, and generating the string
+// is comparatively slow.
+static llvm::StringMap<std::string> TypeStrCache;
+static std::mutex TypeStrCacheMutex;
+
+std::string PointerVariableConstraint::getTypeStrCacheKey(
+    Constraints &CS, bool ForItype, bool EmitPointee) const {
+  if (FV != nullptr || TypedefLevelInfo.HasTypedef ||
+      (EmitPointee && Vars.empty()))
+    return "";
+  // The base type is interned, so its address identifies it.
+  const char *Base = BaseType.data();
+  std::string Key(reinterpret_cast<const char *>(&Base), sizeof(Base));
+  Key += ForItype ? 'i' : 't';
+  uint32_t TypeIdx = 0;
+  for (auto It = Vars.begin() + (EmitPointee ? 1 : 0); It < Vars.end();
+       ++It, ++TypeIdx) {
+    if (getArrSizes().at(TypeIdx).first == O_SizedArray)
+      return "";
+    const ConstAtom *C = dyn_cast<ConstAtom>(*It);
+    if (C == nullptr)
+      C = CS.getVariables().at(cast<VarAtom>(*It)).first;
+    Key += static_cast<char>(C->getKind());
+    Key += static_cast<char>(TypeIdx < QualFlags.size() ? QualFlags[TypeIdx]
+                                                        : 0);
+  }
+  return Key;
+}
+
 std::string PointerVariableConstraint::mkString(Constraints &CS, bool EmitName,
                                                 bool ForItype, bool EmitPointee,
                                                 bool UnmaskTypedef,
@@ -750,10 +834,33 @@ std::string PointerVariableConstraint::mkString(Constraints &CS, bool EmitName,
     UseName = getName();
 
   if (IsTypedef && !UnmaskTypedef) {
-    return gatherQualStrings() + TypedefString +
+    return gatherQualStrings() + TypedefString.str() +
            (EmitName && !IsReturn ? (" " + UseName) : " ");
   }
 
+  // A cached type is followed by the name as at the end of this function;
+  // without arrays, the name is never emitted inside the type.
+  std::string CacheKey = getTypeStrCacheKey(CS, ForItype, EmitPointee);
+  if (!CacheKey.empty()) {
+    std::string Cached;
+    bool Found = false;
+    {
+      std::lock_guard<std::mutex> Lock(TypeStrCacheMutex);
+      auto CacheI = TypeStrCache.find(CacheKey);
+      if (CacheI != TypeStrCache.end()) {
+        Cached = CacheI->second;
+        Found = true;
+      }
+    }
+    if (Found) {
+      if (EmitName && !IsReturn && !UseName.empty())
+        Cached += " " + UseName;
+      if (IsReturn && !ForItype)
+        Cached += " ";
+      return Cached;
+    }
+  }
+
   std::ostringstream Ss;
   // Annotations that will need to be placed on the identifier of an unchecked
   // function pointer.
@@ -808,12 +915,13 @@ std::string PointerVariableConstraint::mkString(Constraints &CS, bool EmitName,
     if (!ForItype && BaseType == "void")
       K = Atom::A_Wild;
 
-    if (PrevArr && ArrSizes.at(TypeIdx).first != O_SizedArray && !EmittedName) {
+    if (PrevArr && getArrSizes().at(TypeIdx).first != O_SizedArray &&
+        !EmittedName) {
       EmittedName = true;
       addArrayAnnotations(ConstArrs, EndStrs);
       EndStrs.push_front(" " + UseName);
     }
-    PrevArr = ArrSizes.at(TypeIdx).first == O_SizedArray;
+    PrevArr = getArrSizes().at(TypeIdx).first == O_SizedArray;
 
     switch (K) {
     case Atom::A_Ptr:
@@ -875,7 +983,7 @@ std::string PointerVariableConstraint::mkString(Constraints &CS, bool EmitName,
         if (!EmittedBase) {
           assert(!BaseType.empty());
           EmittedBase = true;
-          Ss << BaseType << " ";
+          Ss << BaseType.str() << " ";
         }
         Ss << "*";
         getQualString(TypeIdx, Ss);
@@ -927,7 +1035,7 @@ std::string PointerVariableConstraint::mkString(Constraints &CS, bool EmitName,
       auto Name = TypedefLevelInfo.TypedefName;
       Ss << Buf.str() << Name;
     } else {
-      Ss << BaseType;
+      Ss << BaseType.str();
     }
   }
 
@@ -936,6 +1044,11 @@ std::string PointerVariableConstraint::mkString(Constraints &CS, bool EmitName,
     Ss << Str;
   }
 
+  if (!CacheKey.empty()) {
+    std::lock_guard<std::mutex> Lock(TypeStrCacheMutex);
+    TypeStrCache[CacheKey] = Ss.str();
+  }
+
   // No space after itype.
   if (!EmittedName && !UseName.empty())
     Ss << " " << UseName;
@@ -1165,6 +1278,19 @@ FVConstraint *FunctionVariableConstraint::getCopy(Constraints &CS) {
   return new FVConstraint(this, CS);
 }
 
+size_t FunctionVariableConstraint::getOwnedBytes() const {
+  // The internal and external constraint variables of the return and the
+  // parameters are constraint variables of their own.
+  size_t Bytes = sizeof(*this) + getStringHeapBytes(Name) +
+                 getStringHeapBytes(FileName);
+  Bytes += ConstrainedVars.size() * treeNodeBytes<ConstraintKey>();
+  Bytes += ParamVars.capacity() * sizeof(FVComponentVariable);
+  Bytes += getStringHeapBytes(ReturnVar.SourceDeclaration);
+  for (const FVComponentVariable &Param : ParamVars)
+    Bytes += getStringHeapBytes(Param.SourceDeclaration);
+  return Bytes;
+}
+
 void PVConstraint::equateArgumentConstraints(ProgramInfo &Info) {
   if (HasEqArgumentConstraints) {
     return;
@@ -1318,6 +1444,26 @@ PVConstraint *PointerVariableConstraint::getCopy(Constraints &CS) {
   return new PointerVariableConstraint(this, CS);
 }
 
+size_t PointerVariableConstraint::getOwnedBytes() const {
+  size_t Bytes = sizeof(*this) + getStringHeapBytes(Name);
+  Bytes += ConstrainedVars.size() * treeNodeBytes<ConstraintKey>();
+  Bytes += ArgumentConstraints.size() * treeNodeBytes<ConstraintVariable *>();
+  Bytes += smallVectorHeapBytes(Vars) + smallVectorHeapBytes(SrcVars) +
+           smallVectorHeapBytes(QualFlags);
+  Bytes += getStringHeapBytes(TypedefLevelInfo.TypedefName);
+  // The array sizes are shared with the copies of this variable, which have a
+  // parent, so they are only counted once.
+  if (Parent == nullptr) {
+    if (ArrSizes)
+      Bytes += ArrSizes->size() * treeNodeBytes<ArrSizesMap::value_type>();
+    if (ArrSizeStrs)
+      for (const auto &SizeStr : *ArrSizeStrs)
+        Bytes += treeNodeBytes<ArrSizeStrsMap::value_type>() +
+                 getStringHeapBytes(SizeStr.second);
+  }
+  return Bytes;
+}
+
 const ConstAtom *
 PointerVariableConstraint::getSolution(const Atom *A,
                                        const EnvironmentMap &E) const {
@@ -1386,20 +1532,33 @@ bool PointerVariableConstraint::hasNtArr(const EnvironmentMap &E,
   return false;
 }
 
+const PointerVariableConstraint::ArrSizesMap &
+PointerVariableConstraint::getArrSizes() const {
+  static const ArrSizesMap Empty;
+  return ArrSizes ? *ArrSizes : Empty;
+}
+
+const PointerVariableConstraint::ArrSizeStrsMap &
+PointerVariableConstraint::getArrSizeStrs() const {
+  static const ArrSizeStrsMap Empty;
+  return ArrSizeStrs ? *ArrSizeStrs : Empty;
+}
+
 bool PointerVariableConstraint::getArrPresent() const {
-  return llvm::any_of(ArrSizes,
+  return llvm::any_of(getArrSizes(),
                       [](auto E) { return E.second.first != O_Pointer; });
 }
 
 bool PointerVariableConstraint::isTopCvarUnsizedArr() const {
-  if (ArrSizes.find(0) != ArrSizes.end()) {
-    return ArrSizes.at(0).first != O_SizedArray;
+  auto I = getArrSizes().find(0);
+  if (I != getArrSizes().end()) {
+    return I->second.first != O_SizedArray;
   }
   return true;
 }
 
 bool PointerVariableConstraint::hasSomeSizedArr() const {
-  for (auto &AS : ArrSizes) {
+  for (auto &AS : getArrSizes()) {
     if (AS.second.first == O_SizedArray || AS.second.second == O_UnSizedArray) {
       return true;
     }
@@ -1876,8 +2035,8 @@ void PointerVariableConstraint::mergeDeclaration(ConstraintVariable *FromCV,
                                                  ProgramInfo &Info,
                                                  std::string &ReasonFailed) {
   PVConstraint *From = dyn_cast<PVConstraint>(FromCV);
-  std::vector<Atom *> NewVAtoms;
-  std::vector<ConstAtom *> NewSrcAtoms;
+  CAtoms NewVAtoms;
+  llvm::SmallVector<ConstAtom *, 2> NewSrcAtoms;
   CAtoms CFrom = From->getCvars();
   if (CFrom.size() != Vars.size()) {
     ReasonFailed = "transplanting between pointers with different depths";
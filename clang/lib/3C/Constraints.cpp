@@ -13,8 +13,14 @@
 #include "clang/3C/3CGlobalOptions.h"
 #include "clang/3C/ConstraintVariables.h"
 #include "clang/3C/ConstraintsGraph.h"
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ThreadPool.h"
+#include <chrono>
+#include <deque>
 #include <iostream>
+#include <mutex>
 #include <set>
 
 using namespace llvm;
@@ -33,6 +39,15 @@ static cl::opt<bool>
                  cl::desc("Perform only least solution for Pty Constrains."),
                  cl::init(false), cl::cat(SolverCategory));
 
+StringRef Constraint::internReason(const std::string &Rsn) {
+  // The table lives as long as the process, like the constraints that point
+  // into it.
+  static llvm::StringSet<> Reasons;
+  static std::mutex ReasonsMutex;
+  std::lock_guard<std::mutex> Lock(ReasonsMutex);
+  return Reasons.insert(Rsn).first->getKey();
+}
+
 Constraint::Constraint(ConstraintKind K, const std::string &Rsn,
                        PersistentSourceLoc *PL)
     : Constraint(K, Rsn) {
@@ -44,27 +59,45 @@ Constraint::Constraint(ConstraintKind K, const std::string &Rsn,
 
 // Remove the constraint from the global constraint set.
 bool Constraints::removeConstraint(Constraint *C) {
-  bool RetVal = false;
-  Geq *GE = dyn_cast<Geq>(C);
-  assert(GE != nullptr && "Invalid constrains requested to be removed.");
-  // We can only remove constraints from ConstAtoms.
-  if (isa<ConstAtom>(GE->getRHS()) && isa<VarAtom>(GE->getLHS())) {
-    removeReasonBasedConstraint(C);
-    RetVal = TheConstraints.erase(C) != 0;
-    // Delete from graph.
-    ConstraintsGraph *TG = nullptr;
-    TG = GE->constraintIsChecked() ? ChkCG : PtrTypCG;
-    RetVal = true;
+  ConstraintSet Removed;
+  removeConstraints({C}, Removed);
+  return !Removed.empty();
+}
+
+void Constraints::removeConstraints(const ConstraintSet &ToRemove,
+                                    ConstraintSet &Removed) {
+  std::vector<std::pair<Atom *, Atom *>> ChkEdges;
+  std::vector<std::pair<Atom *, Atom *>> PtrTypEdges;
+  // The constraints of a batch usually share their reason, so remember the
+  // last one looked up.
+  auto ReasonI = ConstraintsByReason.end();
+  for (Constraint *C : ToRemove) {
+    Geq *GE = dyn_cast<Geq>(C);
+    assert(GE != nullptr && "Invalid constrains requested to be removed.");
+    // We can only remove constraints from ConstAtoms.
+    if (!isa<ConstAtom>(GE->getRHS()) || !isa<VarAtom>(GE->getLHS()))
+      continue;
+    if (ReasonI == ConstraintsByReason.end() ||
+        ReasonI->first != GE->getReason())
+      ReasonI = ConstraintsByReason.find(GE->getReason());
+    if (ReasonI != ConstraintsByReason.end())
+      ReasonI->second.erase(GE);
+    TheConstraints.erase(C);
     // Remove the edge form the corresponding constraint graph.
-    TG->removeEdge(GE->getRHS(), GE->getLHS());
+    (GE->constraintIsChecked() ? ChkEdges : PtrTypEdges)
+        .push_back(std::make_pair(GE->getRHS(), GE->getLHS()));
+    Removed.insert(C);
   }
-  return RetVal;
+  if (!ChkEdges.empty())
+    ChkCG->removeEdges(ChkEdges);
+  if (!PtrTypEdges.empty())
+    PtrTypCG->removeEdges(PtrTypEdges);
 }
 
 // Check if we can add this constraint. This provides a global switch to
 // control what constraints we can add to our system.
 void Constraints::editConstraintHook(Constraint *C) {
-  if (!AllTypes) {
+  if (!get3COptions().AllTypes) {
     // Invalidate any pointer-type constraints.
     if (Geq *E = dyn_cast<Geq>(C)) {
       if (!E->constraintIsChecked()) {
@@ -143,16 +176,6 @@ bool Constraints::addReasonBasedConstraint(Constraint *C) {
   return false;
 }
 
-bool Constraints::removeReasonBasedConstraint(Constraint *C) {
-  if (Geq *E = dyn_cast<Geq>(C)) {
-    // Remove if the constraint is present.
-    if (this->ConstraintsByReason.find(E->getReason()) !=
-        this->ConstraintsByReason.end())
-      return this->ConstraintsByReason[E->getReason()].erase(E) > 0;
-  }
-  return false;
-}
-
 // Checks to see if the constraint is of a form that we expect.
 // The expected forms are the following:
 // EQ : (q_i = q_k)
@@ -192,6 +215,18 @@ bool Constraints::check(Constraint *C) {
 //---- set sol(k) := (sol(k) JOIN Q)
 //---- for all edges (k --> q) in G, confirm that sol(k) <: q; else fail
 //---- add k to W
+//
+// The saved implications are all checked once the first propagation is
+// done. After that, a premise (q_i >= A) can only start to hold when sol(q_i)
+// changes, so the implications of q_i are checked as soon as it changes, and
+// the conclusion of an implication that fires is propagated by the same
+// worklist. Implications are only solved for the least solution, in which
+// solutions only grow, so a premise that holds keeps holding.
+//
+// Strongly connected components of the graph are not collapsed: a variable
+// that is not reset before a solve and is not a starting point keeps its
+// solution and does not propagate it, so the variables of a component do not
+// always end up with the same solution.
 
 static bool
 doSolve(ConstraintsGraph &CG,
@@ -199,22 +234,43 @@ doSolve(ConstraintsGraph &CG,
         ConstraintsEnv &Env, Constraints *CS, bool DoLeastSolution,
         std::set<VarAtom *> *InitVs, std::set<VarAtom *> &Conflicts) {
 
-  std::vector<Atom *> WorkList;
-  std::set<Implies *> FiredImplies;
+  std::deque<Atom *> WorkList;
+
+  // Index the implications by the variable of their premise.
+  std::map<VarAtom *, std::vector<Implies *>> ImpliesByPremise;
+  for (auto *Imp : SavedImplies)
+    if (auto *VA = dyn_cast<VarAtom>(Imp->getPremise()->getLHS()))
+      ImpliesByPremise[VA].push_back(Imp);
+  bool CheckedAllImplies = false;
+
+  // Check if the premise of Imp holds. If yes then fire the conclusion and
+  // propagate from its atoms.
+  auto FireIfHolds = [&](Implies *Imp) {
+    Geq *Pre = Imp->getPremise();
+    ConstAtom *Cca = Env.getAssignment(Pre->getRHS());
+    ConstAtom *Cva = Env.getAssignment(Pre->getLHS());
+    if (!(*Cca < *Cva || *Cca == *Cva))
+      return;
+    Geq *Con = Imp->getConclusion();
+    CG.addConstraint(Con, *CS);
+    SavedImplies.erase(Imp);
+    WorkList.push_back(Con->getLHS());
+    WorkList.push_back(Con->getRHS());
+  };
 
   // Initialize with seeded VarAtom set (pre-solved).
   if (InitVs != nullptr)
     WorkList.insert(WorkList.begin(), InitVs->begin(), InitVs->end());
 
-  do {
-    // Initialize work list with ConstAtoms.
-    auto &InitC = CG.getAllConstAtoms();
-    WorkList.insert(WorkList.begin(), InitC.begin(), InitC.end());
+  // Initialize work list with ConstAtoms.
+  auto &InitC = CG.getAllConstAtoms();
+  WorkList.insert(WorkList.begin(), InitC.begin(), InitC.end());
 
+  while (true) {
     while (!WorkList.empty()) {
-      auto *Curr = *(WorkList.begin());
+      auto *Curr = WorkList.front();
       // Remove the first element, get its solution.
-      WorkList.erase(WorkList.begin());
+      WorkList.pop_front();
       ConstAtom *CurrSol = Env.getAssignment(Curr);
 
       // get its neighbors.
@@ -234,34 +290,30 @@ doSolve(ConstraintsGraph &CG,
             Changed = Env.assign(Neighbor, CurrSol);
             assert(Changed);
             WorkList.push_back(Neighbor);
+            if (!CheckedAllImplies || SavedImplies.empty())
+              continue;
+            auto I = ImpliesByPremise.find(Neighbor);
+            if (I == ImpliesByPremise.end())
+              continue;
+            for (auto *Imp : I->second)
+              if (SavedImplies.count(Imp))
+                FireIfHolds(Imp);
           }
         } // ignore ConstAtoms for now; will confirm solution below
       }
     }
-    FiredImplies.clear();
-
-    // If there are some implications that we saved? Propagate them.
-    if (!SavedImplies.empty()) {
-      // Check if Premise holds. If yes then fire the conclusion.
-      for (auto *Imp : SavedImplies) {
-        Geq *Pre = Imp->getPremise();
-        Geq *Con = Imp->getConclusion();
-        ConstAtom *Cca = Env.getAssignment(Pre->getRHS());
-        ConstAtom *Cva = Env.getAssignment(Pre->getLHS());
-        // Premise is true, so fire the conclusion.
-        if (*Cca < *Cva || *Cca == *Cva) {
-          CG.addConstraint(Con, *CS);
-          // Keep track of fired constraints, so that we can delete them.
-          FiredImplies.insert(Imp);
-        }
-      }
-      // Erase all the fired implies.
-      for (auto *ToDel : FiredImplies) {
-        SavedImplies.erase(ToDel);
-      }
-    }
-    // Lets repeat if there are some fired constraints.
-  } while (!FiredImplies.empty());
+
+    // Once the first propagation is done, check all of the implications that
+    // we saved. The ones that fire are propagated by another pass over the
+    // worklist.
+    if (CheckedAllImplies || SavedImplies.empty())
+      break;
+    CheckedAllImplies = true;
+    std::vector<Implies *> Candidates(SavedImplies.begin(),
+                                      SavedImplies.end());
+    for (auto *Imp : Candidates)
+      FireIfHolds(Imp);
+  }
 
   // Check Upper/lower bounds hold; collect failures in conflicts set.
   std::set<Atom *> Neighbors;
@@ -282,7 +334,7 @@ doSolve(ConstraintsGraph &CG,
           // new WILD-ness.
           Conflicts.insert(VA);
           // Failure case.
-          if (Verbose) {
+          if (get3COptions().Verbose) {
             errs() << "Unsolvable constraints: ";
             VA->print(errs());
             errs() << "=";
@@ -299,6 +351,196 @@ doSolve(ConstraintsGraph &CG,
   return Ok;
 }
 
+namespace {
+// The weakly connected components of a constraint graph, each with a graph of
+// its own, so that doSolve can solve them separately. Constant atoms do not
+// join components, and the premise and the conclusion of an implication are
+// in the same component. doSolve only propagates along edges and fires an
+// implication when its premise variable changes, so the solution of a
+// variable only depends on its component, and solving the components one by
+// one gives the same solution and conflicts as solving the whole graph.
+//
+// If CleanAtom is not null, it is the solution that every variable has at the
+// start of the first solve. A component whose only constant is CleanAtom and
+// that has no implications already holds its solution then, so it is skipped
+// unless a solve is seeded with one of its variables. Most components of the
+// checked graph of a large program never reach WILD and are clean.
+class ComponentSolver {
+public:
+  ComponentSolver(const std::vector<Geq *> &Geqs,
+                  const std::set<Implies *> &Imps, const Constraints &CS,
+                  ConstAtom *CleanAtom, bool Freeze);
+
+  // Add a constraint to the component of its variable, as for the whole
+  // graph.
+  void addConstraint(Geq *C, const Constraints &CS);
+
+  bool solve(ConstraintsEnv &Env, Constraints *CS, bool DoLeastSolution,
+             std::set<VarAtom *> *InitVs, std::set<VarAtom *> &Conflicts);
+
+  void getStats(SolverComponentStats &Stats) const;
+
+private:
+  struct Component {
+    ConstraintsGraph CG;
+    std::set<Implies *> SavedImplies;
+    unsigned long NumVars = 0;
+    bool Dirty = false;
+  };
+  std::vector<std::unique_ptr<Component>> Components;
+  std::map<VarAtom *, unsigned> ComponentOf;
+  ConstAtom *CleanAtom;
+  double SolveTime = 0;
+
+  unsigned getOrCreateComponentOf(VarAtom *VA);
+};
+} // namespace
+
+ComponentSolver::ComponentSolver(const std::vector<Geq *> &Geqs,
+                                 const std::set<Implies *> &Imps,
+                                 const Constraints &CS, ConstAtom *CleanAtom,
+                                 bool Freeze)
+    : CleanAtom(CleanAtom) {
+  EquivalenceClasses<VarAtom *> Classes;
+  auto Join = [&](Atom *A1, Atom *A2) {
+    auto *VA1 = dyn_cast<VarAtom>(A1);
+    auto *VA2 = dyn_cast<VarAtom>(A2);
+    if (VA1 && VA2)
+      Classes.unionSets(VA1, VA2);
+    else if (VA1 || VA2)
+      Classes.insert(VA1 ? VA1 : VA2);
+  };
+  for (Geq *G : Geqs)
+    Join(G->getLHS(), G->getRHS());
+  for (Implies *Imp : Imps)
+    Join(Imp->getPremise()->getLHS(), Imp->getConclusion()->getLHS());
+
+  for (auto I = Classes.begin(), E = Classes.end(); I != E; ++I) {
+    if (!I->isLeader())
+      continue;
+    unsigned Index = Components.size();
+    Components.push_back(std::make_unique<Component>());
+    for (auto MI = Classes.member_begin(I); MI != Classes.member_end(); ++MI) {
+      ComponentOf[*MI] = Index;
+      ++Components[Index]->NumVars;
+    }
+  }
+
+  for (Geq *G : Geqs)
+    addConstraint(G, CS);
+  for (Implies *Imp : Imps) {
+    auto *VA = cast<VarAtom>(Imp->getPremise()->getLHS());
+    Component &C = *Components[ComponentOf[VA]];
+    C.SavedImplies.insert(Imp);
+    C.Dirty = true;
+  }
+  if (Freeze)
+    for (auto &C : Components)
+      C->CG.freeze();
+}
+
+unsigned ComponentSolver::getOrCreateComponentOf(VarAtom *VA) {
+  auto It = ComponentOf.find(VA);
+  if (It != ComponentOf.end())
+    return It->second;
+  Components.push_back(std::make_unique<Component>());
+  Components.back()->NumVars = 1;
+  return ComponentOf[VA] = Components.size() - 1;
+}
+
+void ComponentSolver::addConstraint(Geq *C, const Constraints &CS) {
+  auto *VA = dyn_cast<VarAtom>(C->getLHS());
+  auto *Con = dyn_cast<ConstAtom>(C->getRHS());
+  if (!VA) {
+    VA = dyn_cast<VarAtom>(C->getRHS());
+    Con = dyn_cast<ConstAtom>(C->getLHS());
+  }
+  // A constraint between two constants does not change the solution.
+  if (!VA)
+    return;
+  Component &Comp = *Components[getOrCreateComponentOf(VA)];
+  Comp.CG.addConstraint(C, CS);
+  if (Con && Con != CleanAtom)
+    Comp.Dirty = true;
+}
+
+bool ComponentSolver::solve(ConstraintsEnv &Env, Constraints *CS,
+                            bool DoLeastSolution, std::set<VarAtom *> *InitVs,
+                            std::set<VarAtom *> &Conflicts) {
+  auto StartTime = std::chrono::steady_clock::now();
+
+  // A seeded variable without constraints has no neighbors to propagate to.
+  std::vector<std::set<VarAtom *>> ComponentInitVs(Components.size());
+  if (InitVs != nullptr)
+    for (VarAtom *VA : *InitVs) {
+      auto It = ComponentOf.find(VA);
+      if (It != ComponentOf.end())
+        ComponentInitVs[It->second].insert(VA);
+    }
+
+  std::vector<size_t> ToSolve;
+  for (size_t I = 0; I != Components.size(); ++I)
+    if (!CleanAtom || Components[I]->Dirty || !ComponentInitVs[I].empty())
+      ToSolve.push_back(I);
+
+  auto SolveOne = [&](size_t I, std::set<VarAtom *> &ComponentConflicts) {
+    Component &C = *Components[I];
+    std::set<VarAtom *> *Init =
+        InitVs != nullptr ? &ComponentInitVs[I] : nullptr;
+    return doSolve(C.CG, C.SavedImplies, Env, CS, DoLeastSolution, Init,
+                   ComponentConflicts);
+  };
+
+  bool Ok = true;
+  if (get3COptions().SolveThreads == 1) {
+    for (size_t I : ToSolve)
+      Ok &= SolveOne(I, Conflicts);
+  } else {
+    // Most components are tiny, so each task solves every NumTasks-th
+    // component rather than one component. The tasks only write the
+    // assignments of the variables of their own components.
+    const _3CGlobalOptions &Opts = get3COptions();
+    ThreadPool Pool(hardware_concurrency(Opts.SolveThreads));
+    unsigned NumTasks = std::min<size_t>(Pool.getThreadCount() * 4,
+                                         std::max<size_t>(ToSolve.size(), 1));
+    std::vector<std::set<VarAtom *>> TaskConflicts(NumTasks);
+    std::vector<char> TaskOk(NumTasks, true);
+    for (unsigned T = 0; T != NumTasks; ++T)
+      Pool.async([&, T]() {
+        _3COptionsScope OptionsScope(Opts);
+        for (size_t J = T; J < ToSolve.size(); J += NumTasks)
+          if (!SolveOne(ToSolve[J], TaskConflicts[T]))
+            TaskOk[T] = false;
+      });
+    Pool.wait();
+
+    for (unsigned T = 0; T != NumTasks; ++T) {
+      Ok &= TaskOk[T] != 0;
+      Conflicts.insert(TaskConflicts[T].begin(), TaskConflicts[T].end());
+    }
+  }
+
+  SolveTime += std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - StartTime)
+                   .count();
+  return Ok;
+}
+
+void ComponentSolver::getStats(SolverComponentStats &Stats) const {
+  Stats = SolverComponentStats();
+  for (const auto &C : Components) {
+    ++Stats.NumComponents;
+    Stats.LargestComponent = std::max(Stats.LargestComponent, C->NumVars);
+    if (!C->Dirty)
+      continue;
+    ++Stats.NumDirtyComponents;
+    Stats.NumDirtyVars += C->NumVars;
+    Stats.LargestDirtyComponent =
+        std::max(Stats.LargestDirtyComponent, C->NumVars);
+  }
+  Stats.ComponentSolveTime = SolveTime;
+}
+
 VarAtomPred IsReturn = [](VarAtom *VA) -> bool {
   return VA->getVarKind() == VarAtom::V_Return;
 };
@@ -331,43 +573,44 @@ static std::set<VarAtom *> findBounded(ConstraintsGraph &CG,
                                        std::set<VarAtom *> *Concrete,
                                        bool Succs, bool UseConstAtoms = true) {
   std::set<VarAtom *> Bounded;
-  std::set<Atom *> Open;
+  std::vector<Atom *> Sources;
 
-  // Initialize the open set of atoms with the provided set of fixed atoms.
-  // These are the start points for a traversal of the constraint graph.
+  // The provided set of fixed atoms are the start points for a traversal of
+  // the constraint graph.
   if (Concrete != nullptr) {
-    Open.insert(Concrete->begin(), Concrete->end());
+    Sources.insert(Sources.end(), Concrete->begin(), Concrete->end());
     Bounded.insert(Concrete->begin(), Concrete->end());
   }
 
   // We often, but not always, want to consider constant atoms as concrete.
   if (UseConstAtoms) {
     auto &ConstA = CG.getAllConstAtoms();
-    Open.insert(ConstA.begin(), ConstA.end());
+    Sources.insert(Sources.end(), ConstA.begin(), ConstA.end());
   }
 
   // Traversal of the constraint graph. An atom is bounded in a direction by
   // one of the Concrete atoms if it is reachable from one of the atoms taking
   // only edges in that direction. The particular atom bounding it does not
-  // matter.
-  while (!Open.empty()) {
-    auto *Curr = *(Open.begin());
-    Open.erase(Open.begin());
-
-    std::set<Atom *> Neighbors;
-    CG.getNeighbors(Curr, Neighbors, Succs, false, true);
-    for (Atom *A : Neighbors) {
-      VarAtom *VA = dyn_cast<VarAtom>(A);
-      if (VA && Bounded.find(VA) == Bounded.end()) {
-        Open.insert(VA);
-        Bounded.insert(VA);
-      }
-    }
-  }
+  // matter. The traversal only continues through VarAtoms.
+  CG.visitReachableFrom(Sources, Succs, /*IgnoreSoftEdges=*/true,
+                        [&](Atom *A) {
+                          VarAtom *VA = dyn_cast<VarAtom>(A);
+                          if (VA)
+                            Bounded.insert(VA);
+                          return VA != nullptr;
+                        });
 
   return Bounded;
 }
 
+// The graphs are rebuilt on every call. That includes the calls made by
+// _3CInterface::makeSinglePtrNonWild and invalidateWildReasonGlobally, which
+// remove constraints and reset the environment to the default solution
+// before solving again. The checked graph is split into components (see
+// ComponentSolver), and the clean components are skipped. The pointer type
+// solution is still recomputed in full by resetting and re-solving most of
+// the atoms (steps 2 and 3 below). The conflict constraints added for a bad
+// pointer type solution stay in the constraint set.
 bool Constraints::graphBasedSolve() {
   std::set<VarAtom *> Conflicts;
   ConstraintsGraph SolChkCG;
@@ -379,14 +622,30 @@ bool Constraints::graphBasedSolve() {
   // Checked well-formedness.
   Environment.checkAssignment(getDefaultSolution());
 
+  // The components of the checked graph are solved separately, which skips
+  // the clean ones, and with more than one thread the components of both
+  // graphs are solved concurrently. The graph dumps and the messages about
+  // unsolvable constraints need the solve of the whole graphs.
+  bool SolveComponents = !get3COptions().Verbose && !DebugSolver;
+  bool SolvePtrTypComponents =
+      SolveComponents && get3COptions().SolveThreads != 1;
+  std::vector<Geq *> ChkGeqs;
+  std::vector<Geq *> PtrTypGeqs;
+
   // Setup the Checked Constraint Graph.
   for (const auto &C : TheConstraints) {
     if (Geq *G = dyn_cast<Geq>(C)) {
-      if (G->constraintIsChecked())
-        SolChkCG.addConstraint(G, *this);
-      else
+      if (G->constraintIsChecked()) {
+        if (SolveComponents)
+          ChkGeqs.push_back(G);
+        else
+          SolChkCG.addConstraint(G, *this);
+      } else {
         // Need to copy whether or not this constraint into the new graph
         SolPtrTypCG.addConstraint(G, *this);
+        if (SolvePtrTypComponents)
+          PtrTypGeqs.push_back(G);
+      }
     }
     // Save the implies to solve them later.
     else if (Implies *Imp = dyn_cast<Implies>(C)) {
@@ -395,19 +654,43 @@ bool Constraints::graphBasedSolve() {
       SavedImplies.insert(Imp);
     }
   }
+  // Solving never adds edges to the pointer type graph, so a frozen copy of
+  // it serves all of the queries below.
+  SolPtrTypCG.freeze();
 
   if (DebugSolver)
     GraphVizOutputGraph::dumpConstraintGraphs("initial_constraints_graph.dot",
                                               SolChkCG, SolPtrTypCG);
 
+  // The pointer type graph is still needed as a whole by findBounded below.
+  std::unique_ptr<ComponentSolver> ChkComponents;
+  std::unique_ptr<ComponentSolver> PtrTypComponents;
+  if (SolveComponents)
+    ChkComponents = std::make_unique<ComponentSolver>(
+        ChkGeqs, SavedImplies, *this, getDefaultSolution().first, false);
+  if (SolvePtrTypComponents && get3COptions().AllTypes)
+    PtrTypComponents = std::make_unique<ComponentSolver>(PtrTypGeqs, Empty,
+                                                         *this, nullptr, true);
+  auto SolveChk = [&](std::set<VarAtom *> *InitVs) {
+    if (SolveComponents)
+      return ChkComponents->solve(Env, this, true, InitVs, Conflicts);
+    return doSolve(SolChkCG, SavedImplies, Env, this, true, InitVs, Conflicts);
+  };
+  auto SolvePtrTyp = [&](bool DoLeastSolution, std::set<VarAtom *> *InitVs) {
+    if (SolvePtrTypComponents)
+      return PtrTypComponents->solve(Env, this, DoLeastSolution, InitVs,
+                                     Conflicts);
+    return doSolve(SolPtrTypCG, Empty, Env, this, DoLeastSolution, InitVs,
+                   Conflicts);
+  };
+
   // Solve Checked/unchecked constraints first.
   Env.doCheckedSolve(true);
 
-  bool Res =
-      doSolve(SolChkCG, SavedImplies, Env, this, true, nullptr, Conflicts);
+  bool Res = SolveChk(nullptr);
 
   // Now solve PtrType constraints
-  if (Res && AllTypes) {
+  if (Res && get3COptions().AllTypes) {
     Env.doCheckedSolve(false);
     bool RegularSolve = !(OnlyGreatestSol || OnlyLeastSol);
 
@@ -420,14 +703,14 @@ bool Constraints::graphBasedSolve() {
             return true;
           },
           getNTArr());
-      Res = doSolve(SolPtrTypCG, Empty, Env, this, true, nullptr, Conflicts);
+      Res = SolvePtrTyp(true, nullptr);
     } else if (OnlyGreatestSol) {
       // Do only greatest solution
-      Res = doSolve(SolPtrTypCG, Empty, Env, this, false, nullptr, Conflicts);
+      Res = SolvePtrTyp(false, nullptr);
     } else {
       // Regular solve
       // Step 1: Greatest solution
-      Res = doSolve(SolPtrTypCG, Empty, Env, this, false, nullptr, Conflicts);
+      Res = SolvePtrTyp(false, nullptr);
     }
 
     // Step 2: Reset all solutions but for function params,
@@ -464,7 +747,7 @@ bool Constraints::graphBasedSolve() {
 
       // 5. Reset var to NTArr if not a param var and not in the previous set.
       std::set<VarAtom *> Rest = Env.resetSolution(
-          [Diff](VarAtom *VA) -> bool {
+          [&Diff](VarAtom *VA) -> bool {
             return !(IsParam(VA) || Diff.find(VA) != Diff.end());
           },
           getNTArr());
@@ -473,20 +756,20 @@ bool Constraints::graphBasedSolve() {
       // a lower bound will be resolved in the final greatest solution.
       std::set<VarAtom *> LowerBounded = findBounded(SolPtrTypCG, &Rest, true);
 
-      Res = doSolve(SolPtrTypCG, Empty, Env, this, true, &Rest, Conflicts);
+      Res = SolvePtrTyp(true, &Rest);
 
       // Step 3: Reset local variable solutions, compute greatest
       if (Res) {
         Rest.clear();
 
         Rest = Env.resetSolution(
-            [LowerBounded](VarAtom *VA) -> bool {
+            [&LowerBounded](VarAtom *VA) -> bool {
               return IsNonParamReturn(VA) ||
                      LowerBounded.find(VA) == LowerBounded.end();
             },
             getPtr());
 
-        Res = doSolve(SolPtrTypCG, Empty, Env, this, false, &Rest, Conflicts);
+        Res = SolvePtrTyp(false, &Rest);
       }
     }
     // If PtrType solving (partly) failed, make the affected VarAtoms wild.
@@ -498,12 +781,15 @@ bool Constraints::graphBasedSolve() {
         std::string Rsn = "Bad pointer type solution";
         Geq *ConflictConstraint = createGeq(VA, getWild(), Rsn);
         addConstraint(ConflictConstraint);
-        SolChkCG.addConstraint(ConflictConstraint, *this);
+        if (SolveComponents)
+          ChkComponents->addConstraint(ConflictConstraint, *this);
+        else
+          SolChkCG.addConstraint(ConflictConstraint, *this);
         Rest.insert(VA);
       }
       Conflicts.clear();
       /* FIXME: Should we propagate the old res? */
-      Res = doSolve(SolChkCG, SavedImplies, Env, this, true, &Rest, Conflicts);
+      Res = SolveChk(&Rest);
     }
     // Final Step: Merge ptyp solution with checked solution.
     Env.mergePtrTypes();
@@ -513,6 +799,10 @@ bool Constraints::graphBasedSolve() {
     GraphVizOutputGraph::dumpConstraintGraphs(
         "implication_constraints_graph.dot", SolChkCG, SolPtrTypCG);
 
+  ComponentStats = SolverComponentStats();
+  if (ChkComponents)
+    ChkComponents->getStats(ComponentStats);
+
   return Res;
 }
 
@@ -545,34 +835,31 @@ void Constraints::print(raw_ostream &O) const {
 void Constraints::dump(void) const { print(errs()); }
 
 void Constraints::dumpJson(llvm::raw_ostream &O) const {
-  O << "{\"Constraints\":[";
-  bool AddComma = false;
-  for (const auto &C : TheConstraints) {
-    if (AddComma) {
-      O << ",\n";
-    }
-    C->dumpJson(O);
-    AddComma = true;
-  }
-  O << "],\n";
-
-  Environment.dumpJson(O);
+  llvm::json::OStream J(O);
+  J.object([&] {
+    J.attributeArray("Constraints", [&] {
+      for (const auto &C : TheConstraints)
+        J.rawValue([&](llvm::raw_ostream &OS) { C->dumpJson(OS); });
+    });
+    J.attributeBegin("Environment");
+    J.rawValue([&](llvm::raw_ostream &OS) { Environment.dumpJson(OS); });
+    J.attributeEnd();
+  });
 }
 
 bool Constraints::removeAllConstraintsOnReason(std::string &Reason,
                                                ConstraintSet &RemovedCons) {
   // Are there any constraints with this reason?
-  bool Removed = false;
-  if (this->ConstraintsByReason.find(Reason) !=
-      this->ConstraintsByReason.end()) {
-    RemovedCons.insert(this->ConstraintsByReason[Reason].begin(),
-                       this->ConstraintsByReason[Reason].end());
-    for (auto *CToDel : RemovedCons) {
-      Removed = this->removeConstraint(CToDel) || Removed;
-    }
-    return Removed;
-  }
-  return Removed;
+  auto ReasonI = this->ConstraintsByReason.find(Reason);
+  if (ReasonI == this->ConstraintsByReason.end())
+    return false;
+  // Only the constraints that are actually removed are returned, since the
+  // caller frees them. The copy is needed because the removal erases them
+  // from the reason index.
+  ConstraintSet ToRemove = ReasonI->second;
+  size_t OldSize = RemovedCons.size();
+  removeConstraints(ToRemove, RemovedCons);
+  return RemovedCons.size() != OldSize;
 }
 
 VarAtom *Constraints::getOrCreateVar(ConstraintKey V, std::string Name,
@@ -678,6 +965,39 @@ Constraints::~Constraints() {
     delete (PtrTypCG);
 }
 
+/* EnvironmentMap methods */
+
+EnvironmentMap::iterator EnvironmentMap::find(const VarAtom *V) {
+  return find(V->getLoc());
+}
+
+EnvironmentMap::const_iterator EnvironmentMap::find(const VarAtom *V) const {
+  return find(V->getLoc());
+}
+
+VarSolTy &EnvironmentMap::at(const VarAtom *V) {
+  ConstraintKey K = V->getLoc();
+  assert(K < Slots.size() && Slots[K].first != nullptr &&
+         "VarAtom is not in the environment");
+  return Slots[K].second;
+}
+
+const VarSolTy &EnvironmentMap::at(const VarAtom *V) const {
+  ConstraintKey K = V->getLoc();
+  assert(K < Slots.size() && Slots[K].first != nullptr &&
+         "VarAtom is not in the environment");
+  return Slots[K].second;
+}
+
+void EnvironmentMap::insert(VarAtom *V, VarSolTy Sol) {
+  ConstraintKey K = V->getLoc();
+  if (K >= Slots.size())
+    Slots.resize(K + 1, value_type(nullptr, VarSolTy(nullptr, nullptr)));
+  assert(Slots[K].first == nullptr && "VarAtom is already in the environment");
+  Slots[K] = value_type(V, Sol);
+  ++NumVars;
+}
+
 /* ConstraintsEnv methods */
 
 void ConstraintsEnv::dump(void) const { print(errs()); }
@@ -697,26 +1017,34 @@ void ConstraintsEnv::print(raw_ostream &O) const {
 }
 
 void ConstraintsEnv::dumpJson(llvm::raw_ostream &O) const {
-  bool AddComma = false;
-  O << "\"Environment\":[";
-  for (const auto &V : Environment) {
-    if (AddComma) {
-      O << ",\n";
+  llvm::json::OStream J(O);
+  J.array([&] {
+    for (const auto &V : Environment) {
+      J.object([&] {
+        J.attributeBegin("var");
+        J.rawValue([&](llvm::raw_ostream &OS) { V.first->dumpJson(OS); });
+        J.attributeEnd();
+        J.attributeObject("value:", [&] {
+          J.attributeBegin("checked");
+          J.rawValue(
+              [&](llvm::raw_ostream &OS) { V.second.first->dumpJson(OS); });
+          J.attributeEnd();
+          J.attributeBegin("PtrType");
+          J.rawValue(
+              [&](llvm::raw_ostream &OS) { V.second.second->dumpJson(OS); });
+          J.attributeEnd();
+        });
+      });
     }
-    O << "{\"var\":";
-    V.first->dumpJson(O);
-    O << ", \"value:\":{\"checked\":";
-    V.second.first->dumpJson(O);
-    O << ", \"PtrType\":";
-    V.second.second->dumpJson(O);
-    O << "}}";
-    AddComma = true;
-  }
-  O << "]}";
+  });
 }
 
 VarAtom *ConstraintsEnv::getFreshVar(VarSolTy InitC, std::string Name,
                                      VarAtom::VarKind VK) {
+  if (KeyThread == std::thread::id())
+    KeyThread = std::this_thread::get_id();
+  assert(KeyThread == std::this_thread::get_id() &&
+         "Constraint keys allocated on several threads");
   VarAtom *NewVA = getOrCreateVar(ConsFreeKey, InitC, Name, VK);
   ConsFreeKey++;
   return NewVA;
@@ -724,19 +1052,17 @@ VarAtom *ConstraintsEnv::getFreshVar(VarSolTy InitC, std::string Name,
 
 VarAtom *ConstraintsEnv::getOrCreateVar(ConstraintKey V, VarSolTy InitC,
                                         std::string Name, VarAtom::VarKind VK) {
-  VarAtom Tv(V, Name, VK);
-  EnvironmentMap::iterator I = Environment.find(&Tv);
+  EnvironmentMap::iterator I = Environment.find(V);
 
   if (I != Environment.end())
     return I->first;
-  VarAtom *VA = new VarAtom(Tv);
-  Environment[VA] = InitC;
+  VarAtom *VA = new VarAtom(V, Name, VK);
+  Environment.insert(VA, InitC);
   return VA;
 }
 
 VarAtom *ConstraintsEnv::getVar(ConstraintKey V) const {
-  VarAtom Tv(V);
-  EnvironmentMap::const_iterator I = Environment.find(&Tv);
+  EnvironmentMap::const_iterator I = Environment.find(V);
 
   if (I != Environment.end())
     return I->first;
@@ -746,9 +1072,9 @@ VarAtom *ConstraintsEnv::getVar(ConstraintKey V) const {
 ConstAtom *ConstraintsEnv::getAssignment(Atom *A) {
   if (VarAtom *VA = dyn_cast<VarAtom>(A)) {
     if (UseChecked) {
-      return Environment[VA].first;
+      return Environment.at(VA).first;
     }
-    return Environment[VA].second;
+    return Environment.at(VA).second;
   }
   assert(dyn_cast<ConstAtom>(A) != nullptr &&
          "This is not a VarAtom or ConstAtom");
@@ -766,11 +1092,11 @@ bool ConstraintsEnv::checkAssignment(VarSolTy Sol) {
 }
 
 bool ConstraintsEnv::assign(VarAtom *V, ConstAtom *C) {
-  auto VI = Environment.find(V);
+  VarSolTy &Sol = Environment.at(V);
   if (UseChecked) {
-    VI->second.first = C;
+    Sol.first = C;
   } else {
-    VI->second.second = C;
+    Sol.second = C;
   }
   return true;
 }
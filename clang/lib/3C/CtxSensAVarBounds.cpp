@@ -20,7 +20,8 @@
 // This visitor computes a string representation of a structure member access
 // which can be used as key for context sensitive access.
 // For example: for this: arr[i]->st1->st, we will get "arr","st1", "st".
-// We will ignore array indexing.
+// We will ignore array indexing. The names are visited from the outermost
+// access inwards, so StructAccessStr holds them in reverse order.
 class StructAccessVisitor : public RecursiveASTVisitor<StructAccessVisitor> {
 public:
   std::vector<std::string> StructAccessStr;
@@ -35,7 +36,7 @@ public:
     if (VD != nullptr &&
         (VD->getType()->isPointerType() || VD->getType()->isStructureType())) {
       IsGlobal = !VD->isLocalVarDecl();
-      StructAccessStr.insert(StructAccessStr.begin(), VD->getNameAsString());
+      StructAccessStr.push_back(VD->getNameAsString());
     }
   }
 
@@ -43,7 +44,7 @@ public:
     ParmVarDecl *PD = dyn_cast_or_null<ParmVarDecl>(DRE->getDecl());
     if (PD != nullptr &&
         (PD->getType()->isPointerType() || PD->getType()->isStructureType())) {
-      StructAccessStr.insert(StructAccessStr.begin(), PD->getNameAsString());
+      StructAccessStr.push_back(PD->getNameAsString());
     } else {
       VarDecl *VD = dyn_cast_or_null<VarDecl>(DRE->getDecl());
       processVarDecl(VD);
@@ -54,15 +55,16 @@ public:
   bool VisitMemberExpr(MemberExpr *ME) {
     std::string MAccess =
         getSourceText(ME->getMemberDecl()->getSourceRange(), *C);
-    StructAccessStr.insert(StructAccessStr.begin(), MAccess);
+    StructAccessStr.push_back(MAccess);
     return true;
   }
 
   // This gives us a string serves as a key for a struct member access.
   std::string getStructAccessKey() {
     std::string Ret = "";
-    for (auto CurrStr : StructAccessStr) {
-      Ret = CurrStr + ":" + Ret;
+    for (const auto &CurrStr : StructAccessStr) {
+      Ret += CurrStr;
+      Ret += ":";
     }
     return Ret;
   }
@@ -76,6 +78,7 @@ void CtxSensitiveBoundsKeyHandler::insertCtxSensBoundsKey(
   ProgramVar *NKVar = OldPV->makeCopy(NK);
   NKVar->setScope(NPS);
   ABI->insertProgramVar(NK, NKVar);
+  ++ABI->getBStats().NumCtxSensKeys;
   ABI->RevCtxSensProgVarGraph.addUniqueEdge(OldPV->getKey(), NKVar->getKey());
   ABI->CtxSensProgVarGraph.addUniqueEdge(NKVar->getKey(), OldPV->getKey());
 }
@@ -124,17 +127,16 @@ void CtxSensitiveBoundsKeyHandler::contextualizeCVar(CallExpr *CE,
       if (PV->hasBoundsKey()) {
         // First duplicate the bounds key.
         BoundsKey CK = PV->getBoundsKey();
-        PersistentSourceLoc CEPSL = PersistentSourceLoc::mkPSL(CE, *C);
+        auto PSL = PersistentSourceLoc::mkPSL(CE, *C);
         ProgramVar *CKVar = ABI->getProgramVar(CK);
 
         // Create a context sensitive scope.
         const CtxFunctionArgScope *CFAS = nullptr;
         if (auto *FPS =
                 dyn_cast_or_null<FunctionParamScope>(CKVar->getScope())) {
-          CFAS = CtxFunctionArgScope::getCtxFunctionParamScope(FPS, CEPSL);
+          CFAS = CtxFunctionArgScope::getCtxFunctionParamScope(FPS, PSL);
         }
 
-        auto PSL = PersistentSourceLoc::mkPSL(CE, *C);
         auto &BKeyMap = CSBoundsKey[PSL];
         createCtxSensBoundsKey(CK, CFAS, BKeyMap);
       }
@@ -142,14 +144,6 @@ void CtxSensitiveBoundsKeyHandler::contextualizeCVar(CallExpr *CE,
   }
 }
 
-CtxStKeyMap *CtxSensitiveBoundsKeyHandler::getCtxStKeyMap(MemberExpr *ME,
-                                                          ASTContext *C) {
-  StructAccessVisitor SKV(C);
-  SKV.TraverseStmt(ME->getBase()->getExprStmt());
-  CtxStKeyMap *MECSMap = getCtxStKeyMap(SKV.IsGlobal);
-  return MECSMap;
-}
-
 CtxStKeyMap *CtxSensitiveBoundsKeyHandler::getCtxStKeyMap(bool IsGlobal) {
   CtxStKeyMap *MECSMap = nullptr;
   if (IsGlobal) {
@@ -160,17 +154,12 @@ CtxStKeyMap *CtxSensitiveBoundsKeyHandler::getCtxStKeyMap(bool IsGlobal) {
   return MECSMap;
 }
 
-std::string CtxSensitiveBoundsKeyHandler::getCtxStructKey(MemberExpr *ME,
-                                                          ASTContext *C) {
-  StructAccessVisitor SKV(C);
-  SKV.TraverseStmt(ME->getBase()->getExprStmt());
-  return SKV.getStructAccessKey();
-}
 bool CtxSensitiveBoundsKeyHandler::tryGetFieldCSKey(
     FieldDecl *FD, CtxStKeyMap *CSK, const std::string &AK, ASTContext *C,
     ProgramInfo &I, BoundsKey &CSKey) {
   bool RetVal = false;
-  if (CSK->find(AK) != CSK->end()) {
+  auto AKI = CSK->find(AK);
+  if (AKI != CSK->end()) {
     CVarOption CV = I.getVariable(FD, C);
     BoundsKey OrigK;
     if (CV.hasValue() && CV.getValue().hasBoundsKey()) {
@@ -178,9 +167,10 @@ bool CtxSensitiveBoundsKeyHandler::tryGetFieldCSKey(
     } else {
       OrigK = ABI->getVariable(FD);
     }
-    auto &BKeyMap = (*CSK)[AK];
-    if (BKeyMap.find(OrigK) != BKeyMap.end()) {
-      CSKey = BKeyMap[OrigK];
+    auto &BKeyMap = AKI->second;
+    auto BKI = BKeyMap.find(OrigK);
+    if (BKI != BKeyMap.end()) {
+      CSKey = BKI->second;
       RetVal = true;
     }
   }
@@ -193,10 +183,13 @@ bool CtxSensitiveBoundsKeyHandler::tryGetMECSKey(MemberExpr *ME, ASTContext *C,
   bool RetVal = false;
   FieldDecl *FD = dyn_cast_or_null<FieldDecl>(ME->getMemberDecl());
   if (FD != nullptr) {
-    // Check which map to insert?
-    CtxStKeyMap *MECSMap = getCtxStKeyMap(ME, C);
-    std::string AK = getCtxStructKey(ME, C);
-    RetVal = tryGetFieldCSKey(FD, MECSMap, AK, C, I, CSKey);
+    // Check which map to insert? One traversal of the base gives both the
+    // map and the access key.
+    StructAccessVisitor SKV(C);
+    SKV.TraverseStmt(ME->getBase()->getExprStmt());
+    CtxStKeyMap *MECSMap = getCtxStKeyMap(SKV.IsGlobal);
+    RetVal = tryGetFieldCSKey(FD, MECSMap, SKV.getStructAccessKey(), C, I,
+                              CSKey);
   }
   return RetVal;
 }
@@ -268,11 +261,11 @@ void CtxSensitiveBoundsKeyHandler::contextualizeCVar(VarDecl *VD, ASTContext *C,
 
 BoundsKey CtxSensitiveBoundsKeyHandler::getCtxSensCEBoundsKey(
     const PersistentSourceLoc &PSL, BoundsKey BK) {
-  if (CSBoundsKey.find(PSL) != CSBoundsKey.end()) {
-    auto &TmpMap = CSBoundsKey[PSL];
-    if (TmpMap.find(BK) != TmpMap.end()) {
-      return TmpMap[BK];
-    }
+  auto PSLI = CSBoundsKey.find(PSL);
+  if (PSLI != CSBoundsKey.end()) {
+    auto I = PSLI->second.find(BK);
+    if (I != PSLI->second.end())
+      return I->second;
   }
   return BK;
 }
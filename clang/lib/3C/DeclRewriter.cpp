@@ -45,11 +45,9 @@ void DeclRewriter::rewriteDecls(ASTContext &Context, ProgramInfo &Info,
   auto TRV3C = FunctionDeclBuilder(&Context, Info, RewriteThese, ABRewriter);
   TRV = &TRV3C;
 #endif
-  StructVariableInitializer SVI =
-      StructVariableInitializer(&Context, Info, RewriteThese);
   for (const auto &D : Context.getTranslationUnitDecl()->decls()) {
+    // This also adds the initializers of struct variables.
     TRV->TraverseDecl(D);
-    SVI.TraverseDecl(D);
     if (const auto &TD = dyn_cast<TypedefDecl>(D)) {
       auto PSL = PersistentSourceLoc::mkPSL(TD, Context);
       // Don't rewrite base types like int
@@ -76,14 +74,15 @@ void DeclRewriter::rewriteDecls(ASTContext &Context, ProgramInfo &Info,
   for (const auto &I : Info.getVarMap())
     Keys.insert(I.first);
   MappingVisitor MV(Keys, Context);
-  LastRecordDecl = nullptr;
+  GlobalVariableGroups GVG(R.getSourceMgr());
+  DeclRewriter DeclR(R, Context, GVG);
   for (const auto &D : TUD->decls()) {
     MV.TraverseDecl(D);
-    detectInlineStruct(D, Context.getSourceManager());
+    DeclR.detectInlineStruct(D, Context.getSourceManager());
     if (FunctionDecl *FD = dyn_cast<FunctionDecl>(D)) {
       if (FD->hasBody() && FD->isThisDeclarationADefinition()) {
         for (auto &D : FD->decls()) {
-          detectInlineStruct(D, Context.getSourceManager());
+          DeclR.detectInlineStruct(D, Context.getSourceManager());
         }
       }
     }
@@ -131,7 +130,6 @@ void DeclRewriter::rewriteDecls(ASTContext &Context, ProgramInfo &Info,
 
   // Build sets of variables that are declared in the same statement so we can
   // rewrite things like int x, *y, **z;
-  GlobalVariableGroups GVG(R.getSourceMgr());
   for (const auto &D : TUD->decls()) {
     GVG.addGlobalDecl(dyn_cast<VarDecl>(D));
     //Search through the AST for fields that occur on the same line
@@ -139,7 +137,6 @@ void DeclRewriter::rewriteDecls(ASTContext &Context, ProgramInfo &Info,
   }
 
   // Do the declaration rewriting
-  DeclRewriter DeclR(R, Context, GVG);
   DeclR.rewrite(RewriteThese);
 
   for (const auto *R : RewriteThese)
@@ -150,7 +147,7 @@ void DeclRewriter::rewrite(RSet &ToRewrite) {
   for (auto *const N : ToRewrite) {
     assert(N->getDecl() != nullptr);
 
-    if (Verbose) {
+    if (get3COptions().Verbose) {
       errs() << "Replacing type of decl:\n";
       N->getDecl()->dump();
       errs() << "with " << N->getReplacement() << "\n";
@@ -204,7 +201,7 @@ void DeclRewriter::rewriteTypedefDecl(TypedefDeclReplacement *TDR,
 // SourceLocations will be generated incorrectly if we rewrite it as a
 // normal multidecl.
 bool isInlineStruct(std::vector<Decl *> &InlineDecls) {
-  if (InlineDecls.size() >= 2 && AllTypes)
+  if (InlineDecls.size() >= 2 && get3COptions().AllTypes)
     return isa<RecordDecl>(InlineDecls[0]) &&
            std::all_of(InlineDecls.begin() + 1, InlineDecls.end(),
                        [](Decl *D) { return isa<VarDecl>(D); });
@@ -414,12 +411,6 @@ void DeclRewriter::rewriteFunctionDecl(FunctionDeclReplacement *N) {
 // A function to detect the presence of inline struct declarations
 // by tracking VarDecls and RecordDecls and populating data structures
 // later used in rewriting.
-
-// These variables are duplicated in the header file and here because static
-// vars need to be initialized in the cpp file where the class is defined.
-/*static*/ RecordDecl *DeclRewriter::LastRecordDecl = nullptr;
-/*static*/ std::map<Decl *, Decl *> DeclRewriter::VDToRDMap;
-/*static*/ std::set<Decl *> DeclRewriter::InlineVarDecls;
 void DeclRewriter::detectInlineStruct(Decl *D, SourceManager &SM) {
   RecordDecl *RD = dyn_cast<RecordDecl>(D);
   if (RD != nullptr &&
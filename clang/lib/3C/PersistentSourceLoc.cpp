@@ -10,10 +10,20 @@
 
 #include "clang/3C/PersistentSourceLoc.h"
 #include "clang/3C/Utils.h"
+#include "llvm/ADT/StringSet.h"
+#include <mutex>
 
 using namespace clang;
 using namespace llvm;
 
+StringRef PersistentSourceLoc::internFileName(const std::string &F) {
+  // Locations may be created while the ASTs are parsed in parallel.
+  static std::mutex TableMutex;
+  static StringSet<> FileNames;
+  std::lock_guard<std::mutex> Lock(TableMutex);
+  return FileNames.insert(F).first->getKey();
+}
+
 // Given a Decl, look up the source location for that Decl and create a
 // PersistentSourceLoc that represents the location of the Decl.
 // This currently the expansion location for the declarations source location.
@@ -36,11 +46,61 @@ PersistentSourceLoc PersistentSourceLoc::mkPSL(const clang::Expr *E,
   return mkPSL(E->getSourceRange(), E->getBeginLoc(), Context);
 }
 
-// Use the PresumedLoc infrastructure to get a file name and expansion
-// line and column numbers for a SourceLocation.
+namespace {
+// The locations that mkPSL created for one ASTContext. Most AST nodes that
+// 3C visits are looked up several times, and the nodes of a file all share
+// its absolute file name.
+struct PSLCache {
+  std::mutex Mutex;
+  DenseMap<FileID, StringRef> FileNames;
+  // Keyed by the raw encodings of SL and of the begin and end of SR.
+  DenseMap<std::tuple<unsigned, unsigned, unsigned>, PersistentSourceLoc>
+      Locs;
+};
+} // namespace
+
+static std::mutex CachesMutex;
+static DenseMap<const ASTContext *, std::unique_ptr<PSLCache>> Caches;
+
+// Called when the ASTContext is destroyed, so a new context at the same
+// address does not see the locations of the old one.
+static void forgetPSLCache(void *Context) {
+  std::lock_guard<std::mutex> Lock(CachesMutex);
+  Caches.erase(static_cast<const ASTContext *>(Context));
+}
+
+static PSLCache &getPSLCache(ASTContext &Context) {
+  std::lock_guard<std::mutex> Lock(CachesMutex);
+  std::unique_ptr<PSLCache> &Cache = Caches[&Context];
+  if (!Cache) {
+    Cache = std::make_unique<PSLCache>();
+    Context.AddDeallocation(forgetPSLCache, &Context);
+  }
+  return *Cache;
+}
+
 PersistentSourceLoc PersistentSourceLoc::mkPSL(clang::SourceRange SR,
                                                SourceLocation SL,
                                                ASTContext &Context) {
+  PSLCache &Cache = getPSLCache(Context);
+  std::lock_guard<std::mutex> Lock(Cache.Mutex);
+  auto Key = std::make_tuple(SL.getRawEncoding(),
+                             SR.getBegin().getRawEncoding(),
+                             SR.getEnd().getRawEncoding());
+  auto It = Cache.Locs.find(Key);
+  if (It != Cache.Locs.end())
+    return It->second;
+  PersistentSourceLoc PSL = computePSL(SR, SL, Context, Cache.FileNames);
+  Cache.Locs.insert(std::make_pair(Key, PSL));
+  return PSL;
+}
+
+// Use the PresumedLoc infrastructure to get a file name and expansion
+// line and column numbers for a SourceLocation.
+PersistentSourceLoc
+PersistentSourceLoc::computePSL(clang::SourceRange SR, SourceLocation SL,
+                                ASTContext &Context,
+                                DenseMap<FileID, StringRef> &FileNames) {
   SourceManager &SM = Context.getSourceManager();
   PresumedLoc PL = SM.getPresumedLoc(SL);
 
@@ -60,13 +120,18 @@ PersistentSourceLoc PersistentSourceLoc::mkPSL(clang::SourceRange SR,
       EndCol = EFESL.getExpansionColumnNumber();
     }
   }
-  std::string Fn = PL.getFilename();
 
   // Get the absolute filename of the file.
   FullSourceLoc TFSL(SR.getBegin(), SM);
   if (TFSL.isValid()) {
-    const FileEntry *Fe = SM.getFileEntryForID(TFSL.getFileID());
-    std::string FeAbsS = Fn;
+    FileID FID = TFSL.getFileID();
+    auto It = FileNames.find(FID);
+    if (It != FileNames.end())
+      return PersistentSourceLoc(It->second, FESL.getExpansionLineNumber(),
+                                 FESL.getExpansionColumnNumber(), EndCol,
+                                 true);
+    const FileEntry *Fe = SM.getFileEntryForID(FID);
+    std::string FeAbsS = PL.getFilename();
     if (Fe != nullptr) {
       // Unlike in `emit` in RewriteUtils.cpp, we don't re-canonicalize the file
       // path because of the potential performance cost (mkPSL is called on many
@@ -75,9 +140,16 @@ PersistentSourceLoc PersistentSourceLoc::mkPSL(clang::SourceRange SR,
       // before we actually write a file.
       FeAbsS = Fe->tryGetRealPathName().str();
     }
-    Fn = std::string(sys::path::remove_leading_dotslash(FeAbsS));
+    StringRef Fn =
+        internFileName(std::string(sys::path::remove_leading_dotslash(FeAbsS)));
+    // Without a file entry, the name comes from the presumed location of SL
+    // and is not a property of the FileID.
+    if (Fe != nullptr)
+      FileNames[FID] = Fn;
+    return PersistentSourceLoc(Fn, FESL.getExpansionLineNumber(),
+                               FESL.getExpansionColumnNumber(), EndCol, true);
   }
-  PersistentSourceLoc PSL(Fn, FESL.getExpansionLineNumber(),
+  PersistentSourceLoc PSL(PL.getFilename(), FESL.getExpansionLineNumber(),
                           FESL.getExpansionColumnNumber(), EndCol);
 
   return PSL;
@@ -14,6 +14,7 @@
 #include "clang/3C/MappingVisitor.h"
 #include "clang/3C/Utils.h"
 #include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include <sstream>
 
 using namespace clang;
@@ -46,42 +47,35 @@ void dumpStaticFuncMap(const ProgramInfo::StaticFunctionMapType &EMap,
 }
 
 void dumpExtFuncMapJson(const ProgramInfo::ExternalFunctionMapType &EMap,
-                        raw_ostream &O) {
-  bool AddComma = false;
+                        llvm::json::OStream &J) {
   for (const auto &DefM : EMap) {
-    if (AddComma) {
-      O << ",\n";
-    }
-    O << "{\"FuncName\":\"" << DefM.first << "\", \"Constraints\":[";
-    DefM.second->dumpJson(O);
-    O << "]}";
-    AddComma = true;
+    J.object([&] {
+      J.attribute("FuncName", DefM.first);
+      J.attributeArray("Constraints", [&] {
+        J.rawValue([&](raw_ostream &OS) { DefM.second->dumpJson(OS); });
+      });
+    });
   }
 }
 
 void dumpStaticFuncMapJson(const ProgramInfo::StaticFunctionMapType &EMap,
-                           raw_ostream &O) {
-  bool AddComma = false;
+                           llvm::json::OStream &J) {
   for (const auto &DefM : EMap) {
-    if (AddComma) {
-      O << ",\n";
-    }
-    // The `FuncName` and `FileName` field names are backwards: this is actually
-    // the file name, hence the need to defend against special characters.
-    O << "{\"FuncName\":" << llvm::json::Value(DefM.first)
-      << ", \"Constraints\":[";
-    bool AddComma1 = false;
-    for (const auto &J : DefM.second) {
-      if (AddComma1) {
-        O << ",";
-      }
-      O << "{\"FileName\":\"" << J.first << "\", \"FVConstraints\":[";
-      J.second->dumpJson(O);
-      O << "]}\n";
-      AddComma1 = true;
-    }
-    O << "]}";
-    AddComma = true;
+    J.object([&] {
+      // The `FuncName` and `FileName` field names are backwards: this is
+      // actually the file name and the inner one is the function name.
+      J.attribute("FuncName", DefM.first);
+      J.attributeArray("Constraints", [&] {
+        for (const auto &FV : DefM.second) {
+          J.object([&] {
+            J.attribute("FileName", FV.first);
+            J.attributeArray("FVConstraints", [&] {
+              J.rawValue([&](raw_ostream &OS) { FV.second->dumpJson(OS); });
+            });
+          });
+        }
+      });
+    });
   }
 }
 
@@ -105,30 +99,29 @@ void ProgramInfo::print(raw_ostream &O) const {
 }
 
 void ProgramInfo::dumpJson(llvm::raw_ostream &O) const {
-  O << "{\"Setup\":";
-  CS.dumpJson(O);
-  // Dump the constraint variables.
-  O << ", \"ConstraintVariables\":[";
-  bool AddComma = false;
-  for (const auto &I : Variables) {
-    if (AddComma) {
-      O << ",\n";
-    }
-    PersistentSourceLoc L = I.first;
-
-    O << "{\"line\":";
-    O << llvm::json::Value(L.toString());
-    O << ",\"Variables\":[";
-    I.second->dumpJson(O);
-    O << "]}";
-    AddComma = true;
-  }
-  O << "]";
-  O << ", \"ExternalFunctionDefinitions\":[";
-  dumpExtFuncMapJson(ExternalFunctionFVCons, O);
-  O << "], \"StaticFunctionDefinitions\":[";
-  dumpStaticFuncMapJson(StaticFunctionFVCons, O);
-  O << "]}";
+  // The constraint dump of a large program can run to gigabytes, so it is
+  // streamed rather than built as an llvm::json::Value.
+  llvm::json::OStream J(O);
+  J.object([&] {
+    J.attributeBegin("Setup");
+    J.rawValue([&](raw_ostream &OS) { CS.dumpJson(OS); });
+    J.attributeEnd();
+    // Dump the constraint variables.
+    J.attributeArray("ConstraintVariables", [&] {
+      for (const auto &I : Variables) {
+        J.object([&] {
+          J.attribute("line", I.first.toString());
+          J.attributeArray("Variables", [&] {
+            J.rawValue([&](raw_ostream &OS) { I.second->dumpJson(OS); });
+          });
+        });
+      }
+    });
+    J.attributeArray("ExternalFunctionDefinitions",
+                     [&] { dumpExtFuncMapJson(ExternalFunctionFVCons, J); });
+    J.attributeArray("StaticFunctionDefinitions",
+                     [&] { dumpStaticFuncMapJson(StaticFunctionFVCons, J); });
+  });
 }
 
 // Given a ConstraintVariable V, retrieve all of the unique
@@ -169,7 +162,8 @@ void ProgramInfo::printAggregateStats(const std::set<std::string> &F,
   for (auto &I : Variables) {
     ConstraintVariable *C = I.second;
     std::string FileName = I.first.getFileName();
-    if (F.count(FileName) || FileName.find(BaseDir) != std::string::npos) {
+    if (F.count(FileName) ||
+        FileName.find(get3COptions().BaseDir) != std::string::npos) {
       if (C->isForValidDecl()) {
         FoundVars.clear();
         getVarsFromConstraint(C, FoundVars, Visited);
@@ -232,12 +226,185 @@ void ProgramInfo::printAggregateStats(const std::set<std::string> &F,
   O << "]}";
 }
 
+// Add CV and the constraint variables nested in it to Visited.
+static void collectConstraintVariables(ConstraintVariable *CV,
+                                       CVarSet &Visited) {
+  if (CV == nullptr || !Visited.insert(CV).second)
+    return;
+  if (auto *PV = dyn_cast<PVConstraint>(CV)) {
+    collectConstraintVariables(PV->getFV(), Visited);
+    for (ConstraintVariable *Arg : PV->getArgumentConstraints())
+      collectConstraintVariables(Arg, Visited);
+  } else if (auto *FV = dyn_cast<FVConstraint>(CV)) {
+    collectConstraintVariables(FV->getInternalReturn(), Visited);
+    collectConstraintVariables(FV->getExternalReturn(), Visited);
+    for (unsigned I = 0; I < FV->numParams(); I++) {
+      collectConstraintVariables(FV->getInternalParam(I), Visited);
+      collectConstraintVariables(FV->getExternalParam(I), Visited);
+    }
+  }
+}
+
+void ProgramInfo::printMemoryStats(llvm::raw_ostream &O) const {
+  CVarSet Visited;
+  for (const auto &V : Variables)
+    collectConstraintVariables(V.second, Visited);
+  for (const auto &T : TypedefVars)
+    if (T.second.hasValue())
+      collectConstraintVariables(&T.second.getValue(), Visited);
+  for (const auto &E : ExprConstraintVars)
+    for (ConstraintVariable *CV : E.second.first)
+      collectConstraintVariables(CV, Visited);
+  for (const auto &G : GlobalVariableSymbols)
+    for (PVConstraint *PV : G.second)
+      collectConstraintVariables(PV, Visited);
+  for (const auto &F : ExternalFunctionFVCons)
+    collectConstraintVariables(F.second, Visited);
+  for (const auto &S : StaticFunctionFVCons)
+    for (const auto &F : S.second)
+      collectConstraintVariables(F.second, Visited);
+  for (const auto &Call : TypeParamBindings)
+    for (const auto &Binding : Call.second)
+      collectConstraintVariables(Binding.second, Visited);
+
+  size_t NumPV = 0, NumFV = 0, PVBytes = 0, FVBytes = 0;
+  for (ConstraintVariable *CV : Visited) {
+    if (isa<PVConstraint>(CV)) {
+      NumPV++;
+      PVBytes += CV->getOwnedBytes();
+    } else {
+      NumFV++;
+      FVBytes += CV->getOwnedBytes();
+    }
+  }
+  size_t NumStrings, StringBytes;
+  ConstraintVariable::getInternedStringStats(NumStrings, StringBytes);
+
+  auto PrintKind = [&O](const char *Kind, size_t Num, size_t Bytes) {
+    O << Kind << ": " << Num << " variables, " << Bytes << " bytes";
+    if (Num != 0)
+      O << " (" << Bytes / Num << " bytes per variable)";
+    O << "\n";
+  };
+  O << "Constraint variable memory:\n";
+  PrintKind("  Pointer variables", NumPV, PVBytes);
+  PrintKind("  Function variables", NumFV, FVBytes);
+  O << "  Interned type strings: " << NumStrings << " strings, "
+    << StringBytes << " bytes\n";
+  O << "  Total: " << PVBytes + FVBytes + StringBytes << " bytes\n";
+}
+
+void ProgramInfo::printConstraintGraphStats(llvm::raw_ostream &O,
+                                            unsigned TopN) {
+  typedef ConstraintsGraph::GraphStats GraphStats;
+  GraphStats Chk = CS.getChkCG().computeStats(TopN);
+  GraphStats Ptyp = CS.getPtrTypCG().computeStats(TopN);
+
+  // Find the declarations of the pointers of the busiest atoms.
+  std::map<ConstraintKey, PersistentSourceLoc> AtomLocs;
+  for (const GraphStats *S : {&Chk, &Ptyp})
+    for (const auto *Top : {&S->TopFanIn, &S->TopFanOut})
+      for (const auto &AN : *Top)
+        if (auto *VA = dyn_cast<VarAtom>(AN.first))
+          AtomLocs[VA->getLoc()];
+  auto FindAtoms = [&AtomLocs](const PersistentSourceLoc &PSL,
+                               ConstraintVariable *CV) {
+    auto *PV = dyn_cast<PVConstraint>(CV);
+    if (!PV)
+      return;
+    for (Atom *A : PV->getCvars()) {
+      auto *VA = dyn_cast<VarAtom>(A);
+      auto I = VA ? AtomLocs.find(VA->getLoc()) : AtomLocs.end();
+      if (I != AtomLocs.end() && !I->second.valid())
+        I->second = PSL;
+    }
+  };
+  for (const auto &V : Variables) {
+    FindAtoms(V.first, V.second);
+    if (auto *FV = dyn_cast<FVConstraint>(V.second)) {
+      FindAtoms(V.first, FV->getExternalReturn());
+      for (unsigned I = 0; I < FV->numParams(); I++)
+        FindAtoms(V.first, FV->getExternalParam(I));
+    }
+  }
+
+  auto PrintDegrees = [&O](const char *Kind,
+                           const std::vector<unsigned long> &Buckets) {
+    O << "    " << Kind << ":";
+    for (unsigned B = 0; B < Buckets.size(); B++) {
+      if (Buckets[B] == 0)
+        continue;
+      O << " ";
+      if (B <= 1)
+        O << B;
+      else
+        O << (1U << (B - 1)) << "-" << (1U << B) - 1;
+      O << ": " << Buckets[B];
+    }
+    O << "\n";
+  };
+  auto PrintSizes = [&O](const char *Kind, unsigned long Num,
+                         const std::vector<unsigned long> &Largest) {
+    O << "    " << Kind << ": " << Num;
+    if (!Largest.empty()) {
+      O << ", largest:";
+      for (unsigned long Size : Largest)
+        O << " " << Size;
+    }
+    O << "\n";
+  };
+  auto PrintTop = [&O, &AtomLocs](const char *Kind,
+                                  const decltype(GraphStats::TopFanIn) &Top) {
+    O << "    " << Kind << ":\n";
+    for (const auto &AN : Top) {
+      O << "      " << AN.second << " " << AN.first->getStr();
+      if (auto *VA = dyn_cast<VarAtom>(AN.first)) {
+        const PersistentSourceLoc &PSL = AtomLocs[VA->getLoc()];
+        if (PSL.valid())
+          O << " (" << PSL.toString() << ")";
+      }
+      O << "\n";
+    }
+  };
+  auto PrintGraph = [&](const char *Name, const GraphStats &S) {
+    O << "  " << Name << ": " << S.NumNodes << " nodes, " << S.NumEdges
+      << " edges (" << S.NumSoftEdges << " soft)\n";
+    PrintDegrees("In-degrees", S.InDegrees);
+    PrintDegrees("Out-degrees", S.OutDegrees);
+    PrintSizes("Strongly connected components", S.NumSCCs, S.LargestSCCs);
+    PrintSizes("Weakly connected components", S.NumWCCs, S.LargestWCCs);
+    PrintTop("Most incoming edges", S.TopFanIn);
+    PrintTop("Most outgoing edges", S.TopFanOut);
+  };
+
+  O << "Constraint graphs:\n";
+  PrintGraph("Checked graph", Chk);
+  PrintGraph("Pointer type graph", Ptyp);
+
+  std::vector<std::pair<size_t, const std::string *>> Reasons;
+  for (const auto &R : CS.getConstraintsByReason())
+    Reasons.push_back({R.second.size(), &R.first});
+  std::sort(Reasons.begin(), Reasons.end(),
+            [](const std::pair<size_t, const std::string *> &A,
+               const std::pair<size_t, const std::string *> &B) {
+              return A.first > B.first ||
+                     (A.first == B.first && *A.second < *B.second);
+            });
+  if (Reasons.size() > TopN)
+    Reasons.resize(TopN);
+  O << "  Reasons with the most constraints:\n";
+  for (const auto &R : Reasons)
+    O << "    " << R.first << " " << *R.second << "\n";
+}
+
 // Print out statistics of constraint variables on a per-file basis.
 void ProgramInfo::printStats(const std::set<std::string> &F, raw_ostream &O,
                              bool OnlySummary, bool JsonFormat) {
   if (!OnlySummary && !JsonFormat) {
-    O << "Enable itype propagation:" << EnablePropThruIType << "\n";
-    O << "Sound handling of var args functions:" << HandleVARARGS << "\n";
+    O << "Enable itype propagation:" << get3COptions().EnablePropThruIType
+      << "\n";
+    O << "Sound handling of var args functions:"
+      << get3COptions().HandleVARARGS << "\n";
   }
   std::map<std::string, std::tuple<int, int, int, int, int>> FilesToVars;
   CVarSet InSrcCVars, Visited;
@@ -247,7 +414,8 @@ void ProgramInfo::printStats(const std::set<std::string> &F, raw_ostream &O,
   // First, build the map and perform the aggregation.
   for (auto &I : Variables) {
     std::string FileName = I.first.getFileName();
-    if (F.count(FileName) || FileName.find(BaseDir) != std::string::npos) {
+    if (F.count(FileName) ||
+        FileName.find(get3COptions().BaseDir) != std::string::npos) {
       int VarC = 0;
       int PC = 0;
       int NtaC = 0;
@@ -352,7 +520,7 @@ void ProgramInfo::printStats(const std::set<std::string> &F, raw_ostream &O,
     O << "}},\n";
   }
 
-  if (AllTypes) {
+  if (get3COptions().AllTypes) {
     if (JsonFormat) {
       O << "\"BoundsStats\":";
     }
@@ -372,10 +540,220 @@ void ProgramInfo::printStats(const std::set<std::string> &F, raw_ostream &O,
   }
 }
 
+bool ProgramInfo::loadSummary(const std::string &FileName,
+                              std::string &Error) {
+  auto Buffer = llvm::MemoryBuffer::getFile(FileName);
+  if (!Buffer) {
+    Error = Buffer.getError().message();
+    return false;
+  }
+  llvm::Expected<llvm::json::Value> Summary =
+      llvm::json::parse((*Buffer)->getBuffer());
+  if (!Summary) {
+    Error = llvm::toString(Summary.takeError());
+    return false;
+  }
+  const llvm::json::Object *Root = Summary->getAsObject();
+  const llvm::json::Object *Functions =
+      Root ? Root->getObject("Functions") : nullptr;
+  if (!Functions) {
+    Error = "expected an object with a \"Functions\" object";
+    return false;
+  }
+
+  auto ReadAtoms = [](const llvm::json::Value *V,
+                      std::vector<std::string> &Sols) {
+    const llvm::json::Array *Atoms = V ? V->getAsArray() : nullptr;
+    if (!Atoms)
+      return false;
+    for (const llvm::json::Value &A : *Atoms) {
+      llvm::Optional<StringRef> Sol = A.getAsString();
+      if (!Sol || (*Sol != "WILD" && *Sol != "PTR" && *Sol != "ARR" &&
+                   *Sol != "NTARR"))
+        return false;
+      Sols.push_back(Sol->str());
+    }
+    return true;
+  };
+  auto ReadBounds = [](const llvm::json::Value &V,
+                       llvm::Optional<SummaryBounds> &B) {
+    if (V.getAsNull())
+      return true;
+    const llvm::json::Object *Obj = V.getAsObject();
+    llvm::Optional<StringRef> Kind = Obj ? Obj->getString("Kind") : llvm::None;
+    if (!Kind)
+      return false;
+    SummaryBounds SB{ABounds::InvalidKind, -1, 0};
+    if (*Kind == "count")
+      SB.Kind = ABounds::CountBoundKind;
+    else if (*Kind == "count+1")
+      SB.Kind = ABounds::CountPlusOneBoundKind;
+    else if (*Kind == "byte")
+      SB.Kind = ABounds::ByteBoundKind;
+    else
+      return false;
+    if (llvm::Optional<int64_t> Param = Obj->getInteger("Param")) {
+      if (*Param < 0)
+        return false;
+      SB.Param = *Param;
+    }
+    else if (llvm::Optional<int64_t> Const = Obj->getInteger("Const"))
+      SB.Const = *Const;
+    else
+      return false;
+    B = SB;
+    return true;
+  };
+  for (const auto &F : *Functions) {
+    const llvm::json::Object *Func = F.second.getAsObject();
+    const llvm::json::Array *Params = Func ? Func->getArray("Params") : nullptr;
+    FunctionSummary Sum;
+    Sum.Solutions.resize(1);
+    bool Ok = Params && ReadAtoms(Func->get("Return"), Sum.Solutions[0]);
+    for (unsigned I = 0; Ok && I < Params->size(); I++) {
+      Sum.Solutions.emplace_back();
+      Ok = ReadAtoms(&(*Params)[I], Sum.Solutions.back());
+    }
+    // Summaries of version 1 have no bounds.
+    Sum.Bounds.resize(Sum.Solutions.size());
+    const llvm::json::Array *Bounds = Ok ? Func->getArray("Bounds") : nullptr;
+    if (Bounds) {
+      Ok = Bounds->size() == Sum.Bounds.size();
+      for (unsigned I = 0; Ok && I < Bounds->size(); I++)
+        Ok = ReadBounds((*Bounds)[I], Sum.Bounds[I]) &&
+             (!Sum.Bounds[I] ||
+              Sum.Bounds[I]->Param < static_cast<int>(Params->size()));
+    }
+    if (!Ok) {
+      Error = "malformed summary of function " + F.first.str();
+      return false;
+    }
+    Summaries[F.first.str()] = std::move(Sum);
+  }
+  return true;
+}
+
+void ProgramInfo::writeSummary(raw_ostream &O) {
+  auto AtomsJson = [&](const FVComponentVariable *C) {
+    llvm::json::Array Atoms;
+    for (Atom *A : C->getExternal()->getCvars())
+      Atoms.push_back(CS.getAssignment(A)->getStr());
+    return Atoms;
+  };
+  // Only the bounds whose length is a parameter or a constant can be
+  // described outside of this run.
+  auto BoundsJson = [&](const FVComponentVariable *C) -> llvm::json::Value {
+    PVConstraint *External = C->getExternal();
+    ABounds *B = External->hasBoundsKey()
+                     ? ArrBInfo.getBounds(External->getBoundsKey())
+                     : nullptr;
+    const char *Kind = nullptr;
+    if (B && B->getKind() == ABounds::CountBoundKind)
+      Kind = "count";
+    else if (B && B->getKind() == ABounds::CountPlusOneBoundKind)
+      Kind = "count+1";
+    else if (B && B->getKind() == ABounds::ByteBoundKind)
+      Kind = "byte";
+    if (!Kind)
+      return nullptr;
+    unsigned PIdx = 0;
+    ProgramVar *PV = ArrBInfo.getProgramVar(B->getBKey());
+    if (ArrBInfo.isFuncParamBoundsKey(B->getBKey(), PIdx))
+      return llvm::json::Object{{"Kind", Kind}, {"Param", PIdx}};
+    if (PV && PV->isNumConstant())
+      return llvm::json::Object{
+          {"Kind", Kind}, {"Const", std::stoll(PV->getVarName())}};
+    return nullptr;
+  };
+  llvm::json::Object Functions;
+  for (const auto &U : ExternalFunctionFVCons) {
+    FVConstraint *G = U.second;
+    if (!G->hasBody())
+      continue;
+    llvm::json::Array Params;
+    llvm::json::Array Bounds;
+    Bounds.push_back(BoundsJson(G->getCombineReturn()));
+    for (unsigned I = 0; I < G->numParams(); I++) {
+      Params.push_back(AtomsJson(G->getCombineParam(I)));
+      Bounds.push_back(BoundsJson(G->getCombineParam(I)));
+    }
+    Functions[U.first] = llvm::json::Object{
+        {"Return", AtomsJson(G->getCombineReturn())},
+        {"Params", std::move(Params)},
+        {"Bounds", std::move(Bounds)}};
+  }
+  llvm::json::Value Summary = llvm::json::Object{
+      {"Version", 2}, {"Functions", std::move(Functions)}};
+  O << llvm::formatv("{0:2}", Summary) << "\n";
+}
+
+bool ProgramInfo::applySummary(
+    const FunctionSummary &Sum,
+    const std::vector<const FVComponentVariable *> &Components,
+    const std::string &Rsn) {
+  // A summary only applies if it has the same shape as this declaration.
+  // It does not describe the parameters of function pointers.
+  if (Sum.Solutions.size() != Components.size())
+    return false;
+  for (unsigned I = 0; I < Components.size(); I++) {
+    PVConstraint *External = Components[I]->getExternal();
+    if (External->getCvars().size() != Sum.Solutions[I].size() ||
+        External->getFV() != nullptr)
+      return false;
+  }
+
+  std::string SummaryRsn = Rsn + " in 3C summary";
+  for (unsigned I = 0; I < Components.size(); I++) {
+    PVConstraint *External = Components[I]->getExternal();
+    if (External->srcHasItype() || External->getIsGeneric())
+      continue;
+    const CAtoms &Atoms = External->getCvars();
+    for (unsigned A = 0; A < Atoms.size(); A++) {
+      const std::string &Sol = Sum.Solutions[I][A];
+      auto *VA = dyn_cast<VarAtom>(Atoms[A]);
+      if (Sol == "WILD") {
+        if (VA)
+          CS.addConstraint(CS.createGeq(VA, CS.getWild(), SummaryRsn));
+      } else if (get3COptions().AllTypes) {
+        ConstAtom *C = CS.getNTArr();
+        if (Sol == "PTR")
+          C = CS.getPtr();
+        else if (Sol == "ARR")
+          C = CS.getArr();
+        External->constrainIdxTo(CS, C, A);
+      }
+    }
+
+    // Declared bounds of this declaration take precedence over the summary.
+    const llvm::Optional<SummaryBounds> &SB = Sum.Bounds[I];
+    if (!get3COptions().AllTypes || !SB || !External->hasBoundsKey() ||
+        ArrBInfo.getBounds(External->getBoundsKey()) != nullptr)
+      continue;
+    BoundsKey LenKey;
+    if (SB->Param < 0) {
+      LenKey = ArrBInfo.getConstKey(SB->Const);
+    } else {
+      PVConstraint *Len = Components[SB->Param + 1]->getExternal();
+      if (!Len->hasBoundsKey())
+        continue;
+      LenKey = Len->getBoundsKey();
+    }
+    ABounds *B = nullptr;
+    if (SB->Kind == ABounds::CountBoundKind)
+      B = new CountBound(LenKey);
+    else if (SB->Kind == ABounds::CountPlusOneBoundKind)
+      B = new CountPlusOneBound(LenKey);
+    else
+      B = new ByteBound(LenKey);
+    ArrBInfo.mergeBounds(External->getBoundsKey(), Declared, B);
+  }
+  return true;
+}
+
 bool ProgramInfo::link() {
   // For every global symbol in all the global symbols that we have found
   // go through and apply rules for whether they are functions or variables.
-  if (Verbose)
+  if (get3COptions().Verbose)
     llvm::errs() << "Linking!\n";
 
   // Equate the constraints for all global variables.
@@ -387,7 +765,7 @@ bool ProgramInfo::link() {
       std::set<PVConstraint *>::iterator I = C.begin();
       std::set<PVConstraint *>::iterator J = C.begin();
       ++J;
-      if (Verbose)
+      if (get3COptions().Verbose)
         llvm::errs() << "Global variables:" << V.first << "\n";
       while (J != C.end()) {
         constrainConsVarGeq(*I, *J, CS, nullptr, Same_to_Same, true, this);
@@ -437,18 +815,20 @@ bool ProgramInfo::link() {
     // Some global symbols we don't need to constrain to wild, like
     // malloc and free. Check those here and skip if we find them.
     if (!G->hasBody()) {
-      const FVComponentVariable *Ret = G->getCombineReturn();
-      Ret->getInternal()->constrainToWild(CS, Rsn);
-      if (!Ret->getExternal()->srcHasItype() &&
-          !Ret->getExternal()->getIsGeneric())
-        Ret->getExternal()->constrainToWild(CS, Rsn);
-
-      for (unsigned I = 0; I < G->numParams(); I++) {
-        const FVComponentVariable *Param = G->getCombineParam(I);
-        Param->getInternal()->constrainToWild(CS, Rsn);
-        if (!Param->getExternal()->srcHasItype() &&
-            !Param->getExternal()->getIsGeneric())
-          Param->getExternal()->constrainToWild(CS, Rsn);
+      std::vector<const FVComponentVariable *> Components;
+      Components.push_back(G->getCombineReturn());
+      for (unsigned I = 0; I < G->numParams(); I++)
+        Components.push_back(G->getCombineParam(I));
+
+      auto SumI = Summaries.find(FuncName);
+      bool UseSummary = SumI != Summaries.end() &&
+                        applySummary(SumI->second, Components, Rsn);
+      for (const FVComponentVariable *C : Components) {
+        C->getInternal()->constrainToWild(CS, Rsn);
+        PVConstraint *External = C->getExternal();
+        if (!UseSummary && !External->srcHasItype() &&
+            !External->getIsGeneric())
+          External->constrainToWild(CS, Rsn);
       }
     }
   }
@@ -521,33 +901,45 @@ FunctionVariableConstraint *
 ProgramInfo::insertNewFVConstraint(FunctionDecl *FD, FVConstraint *NewC,
                                    ASTContext *C) {
   std::string FuncName = FD->getNameAsString();
+  auto Psl = PersistentSourceLoc::mkPSL(FD, *C);
+  std::string FileName = Psl.getFileName();
 
   // Choose a storage location
 
   // assume a global function, but change to a static if not
   ExternalFunctionMapType *Map = &ExternalFunctionFVCons;
   if (!FD->isGlobal()) {
-    // if the filename has not yet been seen, just insert and we're done
-    auto Psl = PersistentSourceLoc::mkPSL(FD, *C);
-    std::string FileName = Psl.getFileName();
-    if (StaticFunctionFVCons.find(FileName) == StaticFunctionFVCons.end()) {
-      StaticFunctionFVCons[FileName][FuncName] = NewC;
-      return NewC;
-    }
-
     // store in static map
     Map = &StaticFunctionFVCons[FileName];
   }
 
+  // The signature of a declaration is its name, its file, its type as
+  // written (which includes the bounds annotations and itypes) and the names
+  // of its parameters. The bounds keys of the parameters are determined by
+  // the name and the file of the function, so merging a second prototype with
+  // the signature of one that was already merged changes nothing: the atoms,
+  // annotations and bounds keys it would bring in are already there. This is
+  // common for prototypes that are repeated in several headers or in a header
+  // that is included under different paths.
+  size_t Signature = llvm::hash_combine(FuncName, FileName, FD->isGlobal(),
+                                        FD->getType().getAsString());
+  for (const ParmVarDecl *PVD : FD->parameters())
+    Signature = llvm::hash_combine(Signature, PVD->getName());
+  bool SeenSignature = !MergedFVSignatures.insert(Signature).second;
+
   // if the function has not yet been seen, just insert and we're done
-  if (Map->find(FuncName) == Map->end()) {
-    (*Map)[FuncName] = NewC;
+  auto Ins = Map->insert({FuncName, NewC});
+  if (Ins.second)
     return NewC;
-  }
+  FVConstraint *&MapC = Ins.first->second;
+
+  // A definition is always merged since it brings in the body.
+  if (SeenSignature && !NewC->hasBody())
+    return MapC;
 
   // Resolve conflicts
 
-  auto *OldC = (*Map)[FuncName];
+  auto *OldC = MapC;
   std::string ReasonFailed = "";
   int OldCount = OldC->numParams();
   int NewCount = NewC->numParams();
@@ -557,14 +949,14 @@ ProgramInfo::insertNewFVConstraint(FunctionDecl *FD, FVConstraint *NewC,
   if ((OldCount < NewCount) ||
       (OldCount == NewCount && !OldC->hasBody() && NewC->hasBody())) {
     NewC->mergeDeclaration(OldC, *this, ReasonFailed);
-    (*Map)[FuncName] = NewC;
+    MapC = NewC;
   } else {
     OldC->mergeDeclaration(NewC, *this, ReasonFailed);
   }
 
   // If successful, we're done and can skip error reporting
   if (ReasonFailed == "")
-    return (*Map)[FuncName];
+    return MapC;
 
   // Error reporting
   { // block to force DiagBuilder destructor and emit message
@@ -579,7 +971,7 @@ ProgramInfo::insertNewFVConstraint(FunctionDecl *FD, FVConstraint *NewC,
   }
   // A failed merge will provide poor data, but the diagnostic error report
   // will cause the program to terminate after the variable adder step.
-  return (*Map)[FuncName];
+  return MapC;
 }
 
 void ProgramInfo::specialCaseVarIntros(ValueDecl *D, ASTContext *Context) {
@@ -611,9 +1003,13 @@ void ProgramInfo::specialCaseVarIntros(ValueDecl *D, ASTContext *Context) {
 // constraint system for that pointer type.
 void ProgramInfo::addVariable(clang::DeclaratorDecl *D,
                               clang::ASTContext *AstContext) {
-  assert(!Persisted);
+  addVariableAt(D, AstContext, PersistentSourceLoc::mkPSL(D, *AstContext));
+}
 
-  PersistentSourceLoc PLoc = PersistentSourceLoc::mkPSL(D, *AstContext);
+void ProgramInfo::addVariableAt(clang::DeclaratorDecl *D,
+                                clang::ASTContext *AstContext,
+                                PersistentSourceLoc PLoc) {
+  assert(!Persisted);
   assert(PLoc.valid());
 
   // We only add a PVConstraint if Variables[PLoc] does not exist.
@@ -639,27 +1035,27 @@ void ProgramInfo::addVariable(clang::DeclaratorDecl *D,
   if (FunctionDecl *FD = dyn_cast<FunctionDecl>(D)) {
     // Function Decls have FVConstraints.
     std::string FuncName = FD->getNameAsString();
+    bool PLocSeen = Variables.find(PLoc) != Variables.end();
+    // A function with the same name exists in the same source location. This
+    // happens when a function is defined in a header file which is included
+    // in multiple translation units. getFuncConstraint returned non-null, so
+    // we know that the definition has been processed already, and there is no
+    // more work to do, not even creating an FVConstraint for it.
+    if (PLocSeen && getFuncConstraint(FD, AstContext))
+      return;
+
     FVConstraint *F = new FVConstraint(D, *this, *AstContext);
     F->setValidDecl();
 
     // Handling of PSL collision for functions is different since we need to
     // consider the static and extern function maps.
-    if (Variables.find(PLoc) != Variables.end()) {
-      // Try to find a previous definition based on function name
-      if (!getFuncConstraint(FD, AstContext)) {
-        // No function with the same name exists. It's concerning that
-        // something already exists at this source location, but we add the
-        // function to the function map anyways. The function map indexes by
-        // function name, so there's no collision.
-        insertNewFVConstraint(FD, F, AstContext);
-        constrainWildIfMacro(F, FD->getLocation());
-      } else {
-        // A function with the same name exists in the same source location.
-        // This happens when a function is defined in a header file which is
-        // included in multiple translation units. getFuncConstraint returned
-        // non-null, so we know that the definition has been processed already,
-        // and there is no more work to do.
-      }
+    if (PLocSeen) {
+      // No function with the same name exists. It's concerning that something
+      // already exists at this source location, but we add the function to
+      // the function map anyways. The function map indexes by function name,
+      // so there's no collision.
+      insertNewFVConstraint(FD, F, AstContext);
+      constrainWildIfMacro(F, FD->getLocation());
       return;
     }
 
@@ -693,7 +1089,8 @@ void ProgramInfo::addVariable(clang::DeclaratorDecl *D,
       constrainWildIfMacro(PVExternal, PVD->getLocation());
       specialCaseVarIntros(PVD, AstContext);
       // If this is "main", constrain its argv parameter to a nested arr
-      if (AllTypes && FuncName == "main" && FD->isGlobal() && I == 1) {
+      if (get3COptions().AllTypes && FuncName == "main" && FD->isGlobal() &&
+          I == 1) {
         PVInternal->constrainOuterTo(CS, CS.getArr());
         PVInternal->constrainIdxTo(CS, CS.getNTArr(), 1);
       }
@@ -743,7 +1140,7 @@ void ProgramInfo::addVariable(clang::DeclaratorDecl *D,
     llvm_unreachable("unknown decl type");
 
   assert("We shouldn't be adding a null CV to Variables map." && NewCV);
-  if (!canWrite(PLoc.getFileName())) {
+  if (!canWrite(PLoc)) {
     NewCV->equateWithItype(*this, "Declaration in non-writable file", &PLoc);
     NewCV->constrainToWild(CS, "Declaration in non-writable file", &PLoc);
   }
@@ -753,7 +1150,7 @@ void ProgramInfo::addVariable(clang::DeclaratorDecl *D,
 
 void ProgramInfo::ensureNtCorrect(const QualType &QT, const ASTContext &C,
                                   PointerVariableConstraint *PV) {
-  if (AllTypes && !canBeNtArray(QT)) {
+  if (get3COptions().AllTypes && !canBeNtArray(QT)) {
     PV->constrainOuterTo(CS, CS.getArr(), true, true);
   }
 }
@@ -809,23 +1206,31 @@ void ProgramInfo::storePersistentConstraints(clang::Expr *E,
 // correct cast insertion.
 const CSetBkeyPair &ProgramInfo::getPersistentConstraints(Expr *E,
                                                           ASTContext *C) const {
-  assert(hasPersistentConstraints(E, C) &&
-         "Persistent constraints not present.");
-  return ExprConstraintVars.at(getExprKey(E, C));
+  const CSetBkeyPair *Vars = findPersistentConstraints(E, C);
+  assert(Vars != nullptr && "Persistent constraints not present.");
+  return *Vars;
+}
+
+const CSetBkeyPair *
+ProgramInfo::findPersistentConstraints(Expr *E, ASTContext *C) const {
+  auto I = ExprConstraintVars.find(getExprKey(E, C));
+  if (I == ExprConstraintVars.end())
+    return nullptr;
+  return &I->second;
 }
 
 void ProgramInfo::storePersistentConstraints(Expr *E, const CSetBkeyPair &Vars,
                                              ASTContext *C) {
-  assert(!hasPersistentConstraints(E, C) &&
+  IDAndTranslationUnit Key = getExprKey(E, C);
+  assert(ExprConstraintVars.find(Key) == ExprConstraintVars.end() &&
          "Persistent constraints already present.");
 
   auto PSL = PersistentSourceLoc::mkPSL(E, *C);
-  if (PSL.valid() && !canWrite(PSL.getFileName()))
+  if (PSL.valid() && !canWrite(PSL))
     for (ConstraintVariable *CVar : Vars.first)
       CVar->constrainToWild(CS, "Expression in non-writable file", &PSL);
 
-  IDAndTranslationUnit Key = getExprKey(E, C);
-  ExprConstraintVars[Key] = Vars;
+  ExprConstraintVars.insert({Key, Vars});
   ExprLocations[Key] = PSL;
 }
 
@@ -837,9 +1242,11 @@ void ProgramInfo::storePersistentConstraints(Expr *E, const CSetBkeyPair &Vars,
 void ProgramInfo::constrainWildIfMacro(ConstraintVariable *CV,
                                        SourceLocation Location,
                                        PersistentSourceLoc *PSL) {
-  std::string Rsn = "Pointer in Macro declaration.";
+  // A location can be rewritten if it is not a macro location, which is a
+  // bit of the encoded SourceLocation, so this check needs no lookup. Only
+  // build the reason for the variables in macros.
   if (!Rewriter::isRewritable(Location))
-    CV->constrainToWild(CS, Rsn, PSL);
+    CV->constrainToWild(CS, "Pointer in Macro declaration.", PSL);
 }
 
 //std::string ProgramInfo::getUniqueDeclKey(Decl *D, ASTContext *C) {
@@ -893,7 +1300,7 @@ FVConstraint *ProgramInfo::getFuncFVConstraint(FunctionDecl *FD,
              ExternalFunctionFVCons.find(FuncName) ==
                  ExternalFunctionFVCons.end());
       ExternalFunctionFVCons[FuncName] = F;
-      FunFVar = ExternalFunctionFVCons[FuncName];
+      FunFVar = F;
     }
   } else {
     auto Psl = PersistentSourceLoc::mkPSL(FD, *C);
@@ -937,20 +1344,22 @@ CVarOption ProgramInfo::getVariable(clang::Decl *D, clang::ASTContext *C) {
 }
 
 FVConstraint *
-ProgramInfo::getExtFuncDefnConstraint(std::string FuncName) const {
-  if (ExternalFunctionFVCons.find(FuncName) != ExternalFunctionFVCons.end()) {
-    return ExternalFunctionFVCons.at(FuncName);
-  }
+ProgramInfo::getExtFuncDefnConstraint(const std::string &FuncName) const {
+  auto I = ExternalFunctionFVCons.find(FuncName);
+  if (I != ExternalFunctionFVCons.end())
+    return I->second;
   return nullptr;
 }
 
-FVConstraint *ProgramInfo::getStaticFuncConstraint(std::string FuncName,
-                                                   std::string FileName) const {
-  if (StaticFunctionFVCons.find(FileName) != StaticFunctionFVCons.end() &&
-      StaticFunctionFVCons.at(FileName).find(FuncName) !=
-          StaticFunctionFVCons.at(FileName).end()) {
-    return StaticFunctionFVCons.at(FileName).at(FuncName);
-  }
+FVConstraint *
+ProgramInfo::getStaticFuncConstraint(const std::string &FuncName,
+                                     const std::string &FileName) const {
+  auto FileI = StaticFunctionFVCons.find(FileName);
+  if (FileI == StaticFunctionFVCons.end())
+    return nullptr;
+  auto I = FileI->second.find(FuncName);
+  if (I != FileI->second.end())
+    return I->second;
   return nullptr;
 }
 
@@ -963,26 +1372,21 @@ bool ProgramInfo::computeInterimConstraintState(
 
   // Get all the valid vars of interest i.e., all the Vars that are present
   // in one of the files being compiled.
-  CAtoms ValidVarsVec;
+  std::set<Atom *> ValidVarsS;
   std::set<Atom *> AllValidVars;
   CVarSet Visited;
   CAtoms Tmp;
   for (const auto &I : Variables) {
-    std::string FileName = I.first.getFileName();
     ConstraintVariable *C = I.second;
     if (C->isForValidDecl()) {
       Tmp.clear();
       getVarsFromConstraint(C, Tmp, Visited);
       AllValidVars.insert(Tmp.begin(), Tmp.end());
-      if (canWrite(FileName))
-        ValidVarsVec.insert(ValidVarsVec.begin(), Tmp.begin(), Tmp.end());
+      if (canWrite(I.first))
+        ValidVarsS.insert(Tmp.begin(), Tmp.end());
     }
   }
 
-  // Make that into set, for efficiency.
-  std::set<Atom *> ValidVarsS;
-  ValidVarsS.insert(ValidVarsVec.begin(), ValidVarsVec.end());
-
   auto GetLocOrZero = [](const Atom *Val) {
     if (const auto *VA = dyn_cast<VarAtom>(Val))
       return VA->getLoc();
@@ -997,6 +1401,8 @@ bool ProgramInfo::computeInterimConstraintState(
                  GetLocOrZero);
 
   CState.clear();
+  // The checked graph is only read from here on.
+  CS.getChkCG().freeze();
   std::set<Atom *> DirectWildVarAtoms;
   CS.getChkCG().getSuccessors(CS.getWild(), DirectWildVarAtoms);
 
@@ -1014,42 +1420,50 @@ bool ProgramInfo::computeInterimConstraintState(
       ImpMap[Pre->getLHS()].insert(Con->getLHS());
     }
 
-  CVars TmpCGrp;
-  CVars OnlyIndirect;
+  // Each atom directly constrained to WILD is a root cause, identified by its
+  // index in RootCauses. The atoms made WILD by a root cause are the atoms
+  // reachable from it, or from the conclusions of the implications whose
+  // premise it is, in the checked graph. The atoms reachable from all the
+  // root causes are found together, labeled with their root causes.
+  std::vector<ConstraintKey> RootCauses;
+  std::vector<std::pair<Atom *, unsigned>> Sources;
   for (auto *A : DirectWildVarAtoms) {
     auto *VA = dyn_cast<VarAtom>(A);
     if (VA == nullptr)
       continue;
 
-    TmpCGrp.clear();
-    OnlyIndirect.clear();
-
-    auto BFSVisitor = [&](Atom *SearchAtom) {
-      auto *SearchVA = dyn_cast<VarAtom>(SearchAtom);
-      if (SearchVA && AllValidVars.find(SearchVA) != AllValidVars.end()) {
-        CState.RCMap[SearchVA->getLoc()].insert(VA->getLoc());
-
-        if (ValidVarsKey.find(SearchVA->getLoc()) != ValidVarsKey.end())
-          TmpCGrp.insert(SearchVA->getLoc());
-        if (DirectWildVarAtoms.find(SearchVA) == DirectWildVarAtoms.end()) {
-          OnlyIndirect.insert(SearchVA->getLoc());
-        }
-      }
-    };
-    CS.getChkCG().visitBreadthFirst(VA, BFSVisitor);
-    if (ImpMap.find(A) != ImpMap.end())
-      for (Atom *ImpA : ImpMap[A])
+    unsigned Label = RootCauses.size();
+    RootCauses.push_back(VA->getLoc());
+    Sources.push_back({VA, Label});
+    auto ImpI = ImpMap.find(A);
+    if (ImpI != ImpMap.end())
+      for (Atom *ImpA : ImpI->second)
         if (isa<VarAtom>(ImpA))
-          CS.getChkCG().visitBreadthFirst(ImpA, BFSVisitor);
+          Sources.push_back({ImpA, Label});
 
-    CState.TotalNonDirectWildAtoms.insert(OnlyIndirect.begin(),
-                                          OnlyIndirect.end());
     // Should we consider only pointers which with in the source files or
     // external pointers that affected pointers within the source files.
     CState.AllWildAtoms.insert(VA->getLoc());
-    CVars &CGrp = CState.SrcWMap[VA->getLoc()];
-    CGrp.insert(TmpCGrp.begin(), TmpCGrp.end());
+    CState.SrcWMap[VA->getLoc()];
   }
+
+  CS.getChkCG().visitReachableLabeled(
+      Sources, [&](Atom *SearchAtom, const llvm::SparseBitVector<> &Causes) {
+        auto *SearchVA = dyn_cast<VarAtom>(SearchAtom);
+        if (!SearchVA || AllValidVars.find(SearchVA) == AllValidVars.end())
+          return;
+
+        ConstraintKey SearchKey = SearchVA->getLoc();
+        CVars &RCs = CState.RCMap[SearchKey];
+        bool InSrc = ValidVarsKey.find(SearchKey) != ValidVarsKey.end();
+        for (unsigned Label : Causes) {
+          RCs.insert(RootCauses[Label]);
+          if (InSrc)
+            CState.SrcWMap[RootCauses[Label]].insert(SearchKey);
+        }
+        if (DirectWildVarAtoms.find(SearchVA) == DirectWildVarAtoms.end())
+          CState.TotalNonDirectWildAtoms.insert(SearchKey);
+      });
   findIntersection(CState.AllWildAtoms, ValidVarsKey, CState.InSrcWildAtoms);
   findIntersection(CState.TotalNonDirectWildAtoms, ValidVarsKey,
                    CState.InSrcNonDirectWildAtoms);
@@ -1087,11 +1501,74 @@ bool ProgramInfo::computeInterimConstraintState(
   return true;
 }
 
+bool ProgramInfo::updateInterimConstraintState(
+    const std::set<std::string> &FilePaths) {
+  std::set<Atom *> DirectWildAtoms;
+  CS.getChkCG().getSuccessors(CS.getWild(), DirectWildAtoms);
+  CVars NewRoots;
+  for (Atom *A : DirectWildAtoms)
+    if (auto *VA = dyn_cast<VarAtom>(A))
+      NewRoots.insert(VA->getLoc());
+
+  // Only the edges from WILD have changed, so the atoms reachable from each
+  // remaining root cause are the same as before.
+  CVars RemovedRoots;
+  for (ConstraintKey Root : CState.AllWildAtoms)
+    if (!NewRoots.count(Root))
+      RemovedRoots.insert(Root);
+  if (NewRoots.size() + RemovedRoots.size() != CState.AllWildAtoms.size())
+    return computeInterimConstraintState(FilePaths);
+  if (RemovedRoots.empty())
+    return true;
+
+  for (auto It = CState.RCMap.begin(); It != CState.RCMap.end();) {
+    CVars &RCs = It->second;
+    bool Affected = false;
+    for (ConstraintKey Root : RemovedRoots)
+      Affected |= RCs.erase(Root) != 0;
+    ConstraintKey Key = It->first;
+    if (!Affected) {
+      ++It;
+      continue;
+    }
+    if (RCs.empty()) {
+      CState.TotalNonDirectWildAtoms.erase(Key);
+      CState.InSrcNonDirectWildAtoms.erase(Key);
+      It = CState.RCMap.erase(It);
+      continue;
+    }
+    // A former root cause that another root cause still makes WILD.
+    if (RemovedRoots.count(Key)) {
+      CState.TotalNonDirectWildAtoms.insert(Key);
+      auto SrcI = CState.SrcWMap.find(*RCs.begin());
+      if (SrcI != CState.SrcWMap.end() && SrcI->second.count(Key))
+        CState.InSrcNonDirectWildAtoms.insert(Key);
+    }
+    ++It;
+  }
+
+  for (ConstraintKey Root : RemovedRoots) {
+    CState.AllWildAtoms.erase(Root);
+    CState.InSrcWildAtoms.erase(Root);
+    CState.SrcWMap.erase(Root);
+    CState.PtrSrcWMap.erase(Root);
+    CState.RootWildAtomsWithReason.erase(Root);
+  }
+  for (auto It = CState.PtrRCMap.begin(); It != CState.PtrRCMap.end();) {
+    for (ConstraintKey Root : RemovedRoots)
+      It->second.erase(Root);
+    if (It->second.empty())
+      It = CState.PtrRCMap.erase(It);
+    else
+      ++It;
+  }
+  return true;
+}
+
 void ProgramInfo::insertIntoPtrSourceMap(const PersistentSourceLoc *PSL,
                                          ConstraintVariable *CV) {
-  std::string FilePath = PSL->getFileName();
-  if (canWrite(FilePath))
-    CState.ValidSourceFiles.insert(FilePath);
+  if (canWrite(*PSL))
+    CState.ValidSourceFiles.insert(PSL->getFileName());
 
   if (auto *PV = dyn_cast<PVConstraint>(CV)) {
     for (auto *A : PV->getCvars())
@@ -1111,6 +1588,101 @@ void ProgramInfo::insertIntoPtrSourceMap(const PersistentSourceLoc *PSL,
   }
 }
 
+void ProgramInfo::invalidateRootCauseQueries() {
+  RootCauseQueries.clear();
+  WildAffectedQueries.clear();
+  QueryDirectWildAtoms.clear();
+  QueryImpByPremise.clear();
+  QueryImpByConclusion.clear();
+  RootCauseQueryStateBuilt = false;
+}
+
+void ProgramInfo::buildRootCauseQueryState() {
+  if (RootCauseQueryStateBuilt)
+    return;
+  RootCauseQueryStateBuilt = true;
+  CS.getChkCG().getSuccessors(CS.getWild(), QueryDirectWildAtoms);
+  // See the comment on ImpMap in computeInterimConstraintState.
+  for (auto *C : getConstraints().getConstraints())
+    if (auto *Imp = dyn_cast<Implies>(C)) {
+      Atom *Pre = Imp->getPremise()->getLHS();
+      Atom *Con = Imp->getConclusion()->getLHS();
+      if (!isa<VarAtom>(Con))
+        continue;
+      QueryImpByPremise[Pre].insert(Con);
+      QueryImpByConclusion[Con].insert(Pre);
+    }
+}
+
+const CVars &ProgramInfo::getRootCausesOf(ConstraintKey Key) {
+  auto It = RootCauseQueries.find(Key);
+  if (It != RootCauseQueries.end())
+    return It->second;
+
+  buildRootCauseQueryState();
+  CVars &Causes = RootCauseQueries[Key];
+  VarAtom *VA = CS.getVar(Key);
+  if (VA == nullptr)
+    return Causes;
+
+  // A root cause makes the atom WILD if the atom can be reached from it, or
+  // from the conclusion of an implication whose premise it is.
+  auto AddIfRoot = [&](Atom *A) {
+    auto *RootVA = dyn_cast<VarAtom>(A);
+    if (RootVA && QueryDirectWildAtoms.count(RootVA))
+      Causes.insert(RootVA->getLoc());
+  };
+  CS.getChkCG().visitBreadthFirstBackward(VA, [&](Atom *A) {
+    AddIfRoot(A);
+    auto ImpI = QueryImpByConclusion.find(A);
+    if (ImpI != QueryImpByConclusion.end())
+      for (Atom *Pre : ImpI->second)
+        AddIfRoot(Pre);
+  });
+  return Causes;
+}
+
+const CVars &ProgramInfo::getWildAffectedAtomsOf(ConstraintKey RootKey) {
+  auto It = WildAffectedQueries.find(RootKey);
+  if (It != WildAffectedQueries.end())
+    return It->second;
+
+  buildRootCauseQueryState();
+  CVars &Affected = WildAffectedQueries[RootKey];
+  VarAtom *VA = CS.getVar(RootKey);
+  if (VA == nullptr || !QueryDirectWildAtoms.count(VA))
+    return Affected;
+
+  auto Visitor = [&](Atom *A) {
+    if (auto *AffectedVA = dyn_cast<VarAtom>(A))
+      Affected.insert(AffectedVA->getLoc());
+  };
+  CS.getChkCG().visitBreadthFirst(VA, Visitor);
+  auto ImpI = QueryImpByPremise.find(VA);
+  if (ImpI != QueryImpByPremise.end())
+    for (Atom *Con : ImpI->second)
+      CS.getChkCG().visitBreadthFirst(Con, Visitor);
+  return Affected;
+}
+
+CVars ProgramInfo::getRootCausesInFile(const std::string &FileName) {
+  CVars Causes;
+  CVarSet Visited;
+  CAtoms Atoms;
+  for (const auto &I : Variables) {
+    if (I.first.getFileName() != FileName || !I.second->isForValidDecl())
+      continue;
+    Atoms.clear();
+    getVarsFromConstraint(I.second, Atoms, Visited);
+    for (Atom *A : Atoms)
+      if (auto *VA = dyn_cast<VarAtom>(A)) {
+        const CVars &AtomCauses = getRootCausesOf(VA->getLoc());
+        Causes.insert(AtomCauses.begin(), AtomCauses.end());
+      }
+  }
+  return Causes;
+}
+
 void ProgramInfo::insertCVAtoms(
     ConstraintVariable *CV,
     std::map<ConstraintKey, ConstraintVariable *> &AtomMap) {
@@ -1202,7 +1774,7 @@ void ProgramInfo::addTypedef(PersistentSourceLoc PSL, bool CanRewriteDef,
   auto *const Rsn = !CanRewriteDef
                         ? "Unable to rewrite a typedef with multiple names"
                         : "Declaration in non-writable file";
-  if (!(CanRewriteDef && canWrite(PSL.getFileName()))) {
+  if (!(CanRewriteDef && canWrite(PSL))) {
     V->constrainToWild(this->getConstraints(), Rsn, &PSL);
   }
   constrainWildIfMacro(V, TD->getLocation(), &PSL);
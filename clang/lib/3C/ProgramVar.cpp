@@ -11,6 +11,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/3C/ProgramVar.h"
+#include <mutex>
+
+// The scopes and program variables are shared by all the conversions of the
+// process, which can run concurrently.
+static std::mutex ScopesMutex;
 
 GlobalScope *GlobalScope::ProgScope = nullptr;
 std::set<StructScope, PVSComp> StructScope::AllStScopes;
@@ -20,6 +25,7 @@ std::set<FunctionScope, PVSComp> FunctionScope::AllFnScopes;
 std::set<CtxFunctionArgScope, PVSComp> CtxFunctionArgScope::AllCtxFnArgScopes;
 
 GlobalScope *GlobalScope::getGlobalScope() {
+  std::lock_guard<std::mutex> Lock(ScopesMutex);
   if (ProgScope == nullptr) {
     ProgScope = new GlobalScope();
   }
@@ -28,6 +34,7 @@ GlobalScope *GlobalScope::getGlobalScope() {
 
 const StructScope *StructScope::getStructScope(std::string StName) {
   StructScope TmpS(StName);
+  std::lock_guard<std::mutex> Lock(ScopesMutex);
   if (AllStScopes.find(TmpS) == AllStScopes.end()) {
     AllStScopes.insert(TmpS);
   }
@@ -39,6 +46,7 @@ const CtxStructScope *CtxStructScope::getCtxStructScope(const StructScope *SS,
                                                         std::string AS,
                                                         bool IsGlobal) {
   CtxStructScope TmpCSS(SS->getSName(), AS, IsGlobal);
+  std::lock_guard<std::mutex> Lock(ScopesMutex);
   if (AllCtxStScopes.find(TmpCSS) == AllCtxStScopes.end()) {
     AllCtxStScopes.insert(TmpCSS);
   }
@@ -49,6 +57,7 @@ const CtxStructScope *CtxStructScope::getCtxStructScope(const StructScope *SS,
 const FunctionParamScope *
 FunctionParamScope::getFunctionParamScope(std::string FnName, bool IsSt) {
   FunctionParamScope TmpFPS(FnName, IsSt);
+  std::lock_guard<std::mutex> Lock(ScopesMutex);
   if (AllFnParamScopes.find(TmpFPS) == AllFnParamScopes.end()) {
     AllFnParamScopes.insert(TmpFPS);
   }
@@ -77,6 +86,7 @@ CtxFunctionArgScope::getCtxFunctionParamScope(const FunctionParamScope *FPS,
                                               const PersistentSourceLoc &PSL) {
   CtxFunctionArgScope TmpAS(std::string(FPS->getFName()), FPS->getIsStatic(),
                             PSL);
+  std::lock_guard<std::mutex> Lock(ScopesMutex);
   if (AllCtxFnArgScopes.find(TmpAS) == AllCtxFnArgScopes.end()) {
     AllCtxFnArgScopes.insert(TmpAS);
   }
@@ -87,6 +97,7 @@ CtxFunctionArgScope::getCtxFunctionParamScope(const FunctionParamScope *FPS,
 const FunctionScope *FunctionScope::getFunctionScope(std::string FnName,
                                                      bool IsSt) {
   FunctionScope TmpFS(FnName, IsSt);
+  std::lock_guard<std::mutex> Lock(ScopesMutex);
   if (AllFnScopes.find(TmpFS) == AllFnScopes.end()) {
     AllFnScopes.insert(TmpFS);
   }
@@ -123,6 +134,7 @@ ProgramVar *ProgramVar::createNewProgramVar(BoundsKey VK, std::string VName,
                                             const ProgramVarScope *PVS,
                                             bool IsCons) {
   ProgramVar *NewPV = new ProgramVar(VK, VName, PVS, IsCons);
+  std::lock_guard<std::mutex> Lock(ScopesMutex);
   AllProgramVars.insert(NewPV);
   return NewPV;
 }
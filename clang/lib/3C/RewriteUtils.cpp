@@ -163,7 +163,7 @@ void rewriteSourceRange(Rewriter &R, const CharSourceRange &Range,
   // crashing with an assert fail.
   if (!RewriteSuccess) {
     clang::DiagnosticsEngine &DE = R.getSourceMgr().getDiagnostics();
-    bool ReportError = ErrFail && !AllowRewriteFailures;
+    bool ReportError = ErrFail && !get3COptions().AllowRewriteFailures;
     {
       // Put this in a block because Clang only allows one DiagnosticBuilder to
       // exist at a time.
@@ -187,11 +187,163 @@ void rewriteSourceRange(Rewriter &R, const CharSourceRange &Range,
   }
 }
 
-static void emit(Rewriter &R, ASTContext &C) {
-  if (Verbose)
+// Split Text into lines, keeping the newline at the end of each line so that
+// a missing newline at the end of the file shows up as a difference.
+static std::vector<StringRef> splitLines(StringRef Text) {
+  std::vector<StringRef> Lines;
+  while (!Text.empty()) {
+    size_t End = Text.find('\n');
+    End = End == StringRef::npos ? Text.size() : End + 1;
+    Lines.push_back(Text.substr(0, End));
+    Text = Text.substr(End);
+  }
+  return Lines;
+}
+
+// Compute a shortest edit script between the lines A and B with Myers'
+// algorithm. Each entry of the result is ' ' for a line kept from A, '-' for a
+// line removed from A or '+' for a line added from B. 3C usually changes a few
+// declarations of a large file, so the lines common to the start and the end
+// of both files are matched up front and the search only spends time on the
+// lines in between.
+static std::string diffLines(ArrayRef<StringRef> A, ArrayRef<StringRef> B) {
+  size_t Prefix = 0;
+  while (Prefix < A.size() && Prefix < B.size() && A[Prefix] == B[Prefix])
+    ++Prefix;
+  size_t Suffix = 0;
+  while (Suffix < A.size() - Prefix && Suffix < B.size() - Prefix &&
+         A[A.size() - 1 - Suffix] == B[B.size() - 1 - Suffix])
+    ++Suffix;
+  ArrayRef<StringRef> MidA = A.slice(Prefix, A.size() - Prefix - Suffix);
+  ArrayRef<StringRef> MidB = B.slice(Prefix, B.size() - Prefix - Suffix);
+  int N = MidA.size(), M = MidB.size();
+
+  // V[Max + K] is the furthest X reached on diagonal K = X - Y. Trace[D] holds
+  // the entries of V for the diagonals -D..D after D edits, which is all that
+  // is needed to walk the edit script back from the end.
+  int Max = N + M;
+  std::vector<int> V(2 * Max + 2, 0);
+  std::vector<std::vector<int>> Trace;
+  for (int D = 0; D <= Max; ++D) {
+    bool Done = false;
+    for (int K = -D; K <= D; K += 2) {
+      int X = (K == -D || (K != D && V[Max + K - 1] < V[Max + K + 1]))
+                  ? V[Max + K + 1]
+                  : V[Max + K - 1] + 1;
+      int Y = X - K;
+      while (X < N && Y < M && MidA[X] == MidB[Y])
+        ++X, ++Y;
+      V[Max + K] = X;
+      if (X >= N && Y >= M)
+        Done = true;
+    }
+    Trace.emplace_back(V.begin() + Max - D, V.begin() + Max + D + 1);
+    if (Done)
+      break;
+  }
+
+  std::string Script;
+  int X = N, Y = M;
+  for (int D = Trace.size() - 1; D > 0; --D) {
+    const std::vector<int> &Prev = Trace[D - 1];
+    int K = X - Y;
+    // Prev is indexed by K + D - 1.
+    bool Down = K == -D || (K != D && Prev[K - 1 + D - 1] < Prev[K + 1 + D - 1]);
+    int PrevK = Down ? K + 1 : K - 1;
+    int PrevX = Prev[PrevK + D - 1];
+    int PrevY = PrevX - PrevK;
+    for (; X > PrevX + !Down; --X, --Y)
+      Script.push_back(' ');
+    Script.push_back(Down ? '+' : '-');
+    X = PrevX;
+    Y = PrevY;
+  }
+  Script.append(X, ' ');
+  std::reverse(Script.begin(), Script.end());
+  return std::string(Prefix, ' ') + Script + std::string(Suffix, ' ');
+}
+
+// Write the differences between OldText and NewText to OS as a unified diff
+// from OldName to NewName, with three lines of context around each hunk.
+static void writeUnifiedDiff(raw_ostream &OS, StringRef OldName,
+                             StringRef NewName, StringRef OldText,
+                             StringRef NewText) {
+  const size_t Context = 3;
+  std::vector<StringRef> A = splitLines(OldText);
+  std::vector<StringRef> B = splitLines(NewText);
+  std::string Script = diffLines(A, B);
+
+  auto WriteLine = [&OS](char Kind, StringRef Line) {
+    OS << Kind << Line;
+    if (!Line.endswith("\n"))
+      OS << "\n\\ No newline at end of file\n";
+  };
+
+  OS << "--- " << OldName << "\n+++ " << NewName << "\n";
+  // I is the position in Script, and AI and BI the lines of A and B it is at.
+  size_t I = 0, AI = 0, BI = 0;
+  while (true) {
+    // Find the next change.
+    size_t Change = Script.find_first_not_of(' ', I);
+    if (Change == std::string::npos)
+      break;
+    AI += Change - I;
+    BI += Change - I;
+    I = Change;
+
+    // Extend the hunk until the next change is more than two contexts away.
+    size_t End = I;
+    while (true) {
+      size_t Kept = Script.find_first_not_of("+-", End);
+      if (Kept == std::string::npos) {
+        End = Script.size();
+        break;
+      }
+      size_t Next = Script.find_first_not_of(' ', Kept);
+      End = Kept;
+      if (Next == std::string::npos || Next - Kept > 2 * Context)
+        break;
+      End = Next;
+    }
+
+    size_t Before = std::min(Context, AI);
+    size_t After = std::min(Context, Script.size() - End);
+    size_t HunkBegin = I - Before, HunkEnd = End + After;
+    size_t OldCount = 0, NewCount = 0;
+    for (size_t J = HunkBegin; J < HunkEnd; ++J) {
+      OldCount += Script[J] != '+';
+      NewCount += Script[J] != '-';
+    }
+    size_t OldStart = AI - Before, NewStart = BI - Before;
+    // An empty range is numbered by the line before it.
+    OS << "@@ -" << (OldCount ? OldStart + 1 : OldStart) << "," << OldCount
+       << " +" << (NewCount ? NewStart + 1 : NewStart) << "," << NewCount
+       << " @@\n";
+    size_t HA = OldStart, HB = NewStart;
+    for (size_t J = HunkBegin; J < HunkEnd; ++J) {
+      if (Script[J] == '+')
+        WriteLine('+', B[HB++]);
+      else if (Script[J] == '-')
+        WriteLine('-', A[HA++]);
+      else {
+        WriteLine(' ', A[HA++]);
+        ++HB;
+      }
+    }
+    I = HunkEnd;
+    AI = HA;
+    BI = HB;
+  }
+}
+
+static void emit(Rewriter &R, ASTContext &C, raw_ostream *PatchOut,
+                 std::set<std::string> &EmittedFiles) {
+  const _3CGlobalOptions &Opts = get3COptions();
+  if (Opts.Verbose)
     errs() << "Writing files out\n";
 
-  bool StdoutMode = (OutputPostfix == "-" && OutputDir.empty());
+  bool StdoutMode = (Opts.OutputPostfix == "-" && Opts.OutputDir.empty() &&
+                     !PatchOut);
   bool StdoutModeSawMainFile = false;
   SourceManager &SM = C.getSourceManager();
   // Iterate over each modified rewrite buffer.
@@ -201,26 +353,26 @@ static void emit(Rewriter &R, ASTContext &C) {
 
       DiagnosticsEngine &DE = C.getDiagnostics();
       DiagnosticsEngine::Level UnwritableChangeDiagnosticLevel =
-          AllowUnwritableChanges ? DiagnosticsEngine::Warning
-                                 : DiagnosticsEngine::Error;
+          Opts.AllowUnwritableChanges ? DiagnosticsEngine::Warning
+                                      : DiagnosticsEngine::Error;
       auto PrintExtraUnwritableChangeInfo = [&]() {
         // With -dump-unwritable-changes and not -allow-unwritable-changes, we
         // want the -allow-unwritable-changes note before the dump.
-        if (!DumpUnwritableChanges) {
+        if (!Opts.DumpUnwritableChanges) {
           unsigned DumpNoteId = DE.getCustomDiagID(
               DiagnosticsEngine::Note,
               "use the -dump-unwritable-changes option to see the new version "
               "of the file");
           DE.Report(DumpNoteId);
         }
-        if (!AllowUnwritableChanges) {
+        if (!Opts.AllowUnwritableChanges) {
           unsigned AllowNoteId = DE.getCustomDiagID(
               DiagnosticsEngine::Note,
               "you can use the -allow-unwritable-changes option to temporarily "
               "downgrade this error to a warning");
           DE.Report(AllowNoteId);
         }
-        if (DumpUnwritableChanges) {
+        if (Opts.DumpUnwritableChanges) {
           errs() << "=== Beginning of new version of " << FE->getName()
                  << " ===\n";
           Buffer->second.write(errs());
@@ -291,6 +443,35 @@ static void emit(Rewriter &R, ASTContext &C) {
         continue;
       }
 
+      // An earlier translation unit already wrote out this file. The visitors
+      // of HandleTranslationUnit skip its declarations, but rewriteDecls still
+      // makes the same changes to it as in the earlier translation unit.
+      if (EmittedFiles.count(FeAbsS))
+        continue;
+
+      if (PatchOut) {
+        EmittedFiles.insert(FeAbsS);
+        // Name the file relative to the base directory, in the a/ and b/
+        // style that `patch -p1` and `git apply` expect, when it is under it.
+        std::string OldName = FeAbsS, NewName = FeAbsS;
+        StringRef BaseDir = Opts.BaseDir;
+        if (filePathStartsWith(FeAbsS, Opts.BaseDir) && FeAbsS != BaseDir) {
+          StringRef Rel = StringRef(FeAbsS).drop_front(BaseDir.size());
+          Rel = Rel.ltrim(sys::path::get_separator());
+          OldName = ("a/" + Rel).str();
+          NewName = ("b/" + Rel).str();
+        }
+        std::string NewContents;
+        raw_string_ostream NewContentsStream(NewContents);
+        Buffer->second.write(NewContentsStream);
+        NewContentsStream.flush();
+        if (Opts.Verbose)
+          errs() << "writing the changes to " << FeAbsS << " to the patch\n";
+        writeUnifiedDiff(*PatchOut, OldName, NewName,
+                         SM.getBufferData(Buffer->first), NewContents);
+        continue;
+      }
+
       if (StdoutMode) {
         if (Buffer->first == SM.getMainFileID()) {
           // This is the new version of the main file. Print it to stdout.
@@ -314,7 +495,7 @@ static void emit(Rewriter &R, ASTContext &C) {
       // because stdout mode is handled above. OutputPostfix defaults to "-"
       // when it's not provided, so any other value means that we should use
       // OutputPostfix. Otherwise, we must be in OutputDir mode.
-      if (OutputPostfix != "-") {
+      if (Opts.OutputPostfix != "-") {
         // That path should be the same as the old one, with a
         // suffix added between the file name and the extension.
         // For example \foo\bar\a.c should become \foo\bar\a.checked.c
@@ -324,19 +505,20 @@ static void emit(Rewriter &R, ASTContext &C) {
         std::string FileName = sys::path::remove_leading_dotslash(PfName).str();
         std::string Ext = sys::path::extension(FileName).str();
         std::string Stem = sys::path::stem(FileName).str();
-        NFile = Stem + "." + OutputPostfix + Ext;
+        NFile = Stem + "." + Opts.OutputPostfix + Ext;
         if (!DirName.empty())
           NFile = DirName + sys::path::get_separator().str() + NFile;
       } else {
-        assert(!OutputDir.empty());
+        assert(!Opts.OutputDir.empty());
         // If this does not hold when OutputDir is set, it should have been a
         // fatal error in the _3CInterface constructor.
-        assert(filePathStartsWith(FeAbsS, BaseDir));
+        assert(filePathStartsWith(FeAbsS, Opts.BaseDir));
         // replace_path_prefix is not smart about separators, but this should be
         // OK because tryGetCanonicalFilePath should ensure that neither BaseDir
         // nor OutputDir has a trailing separator.
         SmallString<255> Tmp(FeAbsS);
-        llvm::sys::path::replace_path_prefix(Tmp, BaseDir, OutputDir);
+        llvm::sys::path::replace_path_prefix(Tmp, Opts.BaseDir,
+                                             Opts.OutputDir);
         NFile = std::string(Tmp.str());
         EC = llvm::sys::fs::create_directories(sys::path::parent_path(NFile));
         if (EC) {
@@ -349,12 +531,34 @@ static void emit(Rewriter &R, ASTContext &C) {
         }
       }
 
+      // Leave the output file alone if it already has the new contents, for
+      // example because an earlier translation unit that includes the same
+      // header or an earlier run of 3C wrote it. This avoids rewriting files
+      // and updating their modification times for nothing.
+      std::string NewContents;
+      raw_string_ostream NewContentsStream(NewContents);
+      Buffer->second.write(NewContentsStream);
+      NewContentsStream.flush();
+      bool UpToDate = false;
+      {
+        // Close the old file before it is overwritten below.
+        auto OldContents = MemoryBuffer::getFile(NFile);
+        UpToDate = OldContents && (*OldContents)->getBuffer() == NewContents;
+      }
+      if (UpToDate) {
+        if (Opts.Verbose)
+          errs() << "output file " << NFile << " is up to date\n";
+        EmittedFiles.insert(FeAbsS);
+        continue;
+      }
+
       raw_fd_ostream Out(NFile, EC, sys::fs::F_None);
 
       if (!EC) {
-        if (Verbose)
+        if (Opts.Verbose)
           errs() << "writing out " << NFile << "\n";
-        Buffer->second.write(Out);
+        Out << NewContents;
+        EmittedFiles.insert(FeAbsS);
       } else {
         unsigned ID = DE.getCustomDiagID(DiagnosticsEngine::Error,
                                          "failed to write output file \"%0\"");
@@ -403,9 +607,10 @@ private:
 
   void rewriteType(Expr *E, SourceRange &Range) {
     auto &PState = Info.getPerfStats();
-    if (!Info.hasPersistentConstraints(E, Context))
+    const CSetBkeyPair *Cached = Info.findPersistentConstraints(E, Context);
+    if (Cached == nullptr)
       return;
-    const CVarSet &CVSingleton = Info.getPersistentConstraintsSet(E, Context);
+    const CVarSet &CVSingleton = Cached->first;
     if (CVSingleton.empty())
       return;
 
@@ -615,7 +820,6 @@ bool ArrayBoundsRewriter::hasNewBoundsString(const PVConstraint *PV, Decl *D,
   return !BStr.empty() && !PV->srcHasBounds();
 }
 
-std::set<PersistentSourceLoc> RewriteConsumer::EmittedDiagnostics;
 void RewriteConsumer::emitRootCauseDiagnostics(ASTContext &Context) {
   clang::DiagnosticsEngine &DE = Context.getDiagnostics();
   unsigned ID = DE.getCustomDiagID(
@@ -640,7 +844,8 @@ void RewriteConsumer::emitRootCauseDiagnostics(ASTContext &Context) {
         // or are in the main file of the TU. Alternatively, don't filter causes
         // if -warn-all-root-cause is passed.
         int PtrCount = I.getNumPtrsAffected(WReason.first);
-        if (WarnAllRootCause || SM.isInMainFile(SL) || PtrCount > 1) {
+        if (get3COptions().WarnAllRootCause || SM.isInMainFile(SL) ||
+            PtrCount > 1) {
           // SL is invalid when the File is not in the current translation unit.
           if (SL.isValid()) {
             EmittedDiagnostics.insert(PSL);
@@ -656,11 +861,48 @@ void RewriteConsumer::emitRootCauseDiagnostics(ASTContext &Context) {
 }
 
 void RewriteConsumer::HandleTranslationUnit(ASTContext &Context) {
+  // When previewing, find the requested files in this translation unit that
+  // have not been previewed yet.
+  SourceManager &SM = Context.getSourceManager();
+  std::map<FileID, std::string> PreviewFIDs;
+  if (Previews) {
+    for (auto I = SM.fileinfo_begin(), E = SM.fileinfo_end(); I != E; ++I) {
+      std::string FeAbsS;
+      if (tryGetCanonicalFilePath(I->first->tryGetRealPathName().str(),
+                                  FeAbsS))
+        continue;
+      if (!Previews->count(FeAbsS) || PreviewedFiles.count(FeAbsS))
+        continue;
+      FileID FID = SM.translateFile(I->first);
+      if (FID.isValid())
+        PreviewFIDs[FID] = FeAbsS;
+    }
+    if (PreviewFIDs.empty())
+      return;
+  }
+
+  // Find the files of this translation unit that an earlier translation unit
+  // already wrote out, usually headers.
+  std::set<FileID> EmittedFIDs;
+  if (!Previews && !EmittedFiles.empty()) {
+    for (auto I = SM.fileinfo_begin(), E = SM.fileinfo_end(); I != E; ++I) {
+      std::string FeAbsS;
+      if (tryGetCanonicalFilePath(I->first->tryGetRealPathName().str(),
+                                  FeAbsS))
+        continue;
+      if (!EmittedFiles.count(FeAbsS))
+        continue;
+      FileID FID = SM.translateFile(I->first);
+      if (FID.isValid())
+        EmittedFIDs.insert(FID);
+    }
+  }
+
   Info.enterCompilationUnit(Context);
 
   Info.getPerfStats().startRewritingTime();
 
-  if (WarnRootCause)
+  if (get3COptions().WarnRootCause && !Previews)
     emitRootCauseDiagnostics(Context);
 
   // Rewrite Variable declarations
@@ -668,17 +910,30 @@ void RewriteConsumer::HandleTranslationUnit(ASTContext &Context) {
   DeclRewriter::rewriteDecls(Context, Info, R);
 
   // Take care of some other rewriting tasks
+  //
+  // These visitors stay separate traversals that edit R directly: several of
+  // them read edits made by the ones before (see the note about cast placement
+  // below), and the Rewriter already merges the edits of each file into one
+  // rewrite buffer that emit writes out once per translation unit.
   std::set<llvm::FoldingSetNodeID> Seen;
   std::map<llvm::FoldingSetNodeID, AnnotationNeeded> NodeMap;
-  CheckedRegionFinder CRF(&Context, R, Info, Seen, NodeMap, WarnRootCause);
+  WildnessSummary Summary;
+  CheckedRegionFinder CRF(&Context, R, Info, Seen, NodeMap, Summary,
+                          get3COptions().WarnRootCause);
   CheckedRegionAdder CRA(&Context, R, NodeMap, Info);
-  CastLocatorVisitor CLV(&Context);
-  CastPlacementVisitor ECPV(&Context, Info, R, CLV.getExprsWithCast());
+  CastPlacementVisitor ECPV(&Context, Info, R);
   TypeExprRewriter TER(&Context, Info, R);
   TypeArgumentAdder TPA(&Context, Info, R);
   TranslationUnitDecl *TUD = Context.getTranslationUnitDecl();
   for (const auto &D : TUD->decls()) {
-    if (AddCheckedRegions) {
+    // The other visitors only edit the text of the declaration they traverse,
+    // so a preview can skip the declarations outside the previewed files.
+    // Likewise, the declarations of files that were already written out by an
+    // earlier translation unit are skipped.
+    FileID DeclFID = SM.getFileID(SM.getExpansionLoc(D->getBeginLoc()));
+    if (Previews ? !PreviewFIDs.count(DeclFID) : EmittedFIDs.count(DeclFID))
+      continue;
+    if (get3COptions().AddCheckedRegions) {
       // Adding checked regions enabled?
       // TODO: Should checked region finding happen somewhere else? This is
       //       supposed to be rewriting.
@@ -689,15 +944,26 @@ void RewriteConsumer::HandleTranslationUnit(ASTContext &Context) {
     // Cast placement must happen after type expression rewriting (i.e. cast and
     // compound literal) so that casts to unchecked pointer on itype function
     // calls can override rewritings of casts to checked types.
-    // The cast locator must also run before the cast placement visitor so that
-    // the cast placement visitor is aware of all existing cast expressions.
-    CLV.TraverseDecl(D);
     ECPV.TraverseDecl(D);
     TPA.TraverseDecl(D);
   }
 
   // Output files.
-  emit(R, Context);
+  if (Previews) {
+    for (const auto &FIDAndName : PreviewFIDs) {
+      std::string &NewContents = (*Previews)[FIDAndName.second];
+      if (const RewriteBuffer *RB = R.getRewriteBufferFor(FIDAndName.first)) {
+        NewContents.clear();
+        raw_string_ostream OS(NewContents);
+        RB->write(OS);
+      } else {
+        NewContents = SM.getBufferData(FIDAndName.first).str();
+      }
+      PreviewedFiles.insert(FIDAndName.second);
+    }
+  } else {
+    emit(R, Context, PatchOut, EmittedFiles);
+  }
 
   Info.getPerfStats().endRewritingTime();
 
@@ -0,0 +1,275 @@
+//=--SolutionFile.cpp---------------------------------------------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+// Implementation of the 3C solution file. See SolutionFile.h for the format.
+//===----------------------------------------------------------------------===//
+
+#include "clang/3C/SolutionFile.h"
+#include "clang/3C/Utils.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+
+using namespace llvm;
+
+static const char Magic[4] = {'3', 'C', 'S', 'F'};
+static const unsigned HeaderSize = 20;
+static const unsigned FileFields = 3;
+static const unsigned EntryFields = 10;
+
+static SolutionFile::PtrKind getPtrKind(ConstAtom *CA) {
+  switch (CA->getKind()) {
+  case Atom::A_Ptr:
+    return SolutionFile::Ptr;
+  case Atom::A_Arr:
+    return SolutionFile::Arr;
+  case Atom::A_NTArr:
+    return SolutionFile::NTArr;
+  case Atom::A_Wild:
+    return SolutionFile::Wild;
+  default:
+    return SolutionFile::Unknown;
+  }
+}
+
+// Get the pointer that the solution file records for the variable map entry
+// of CV at PSL, which is the return of a function, or null if none is
+// recorded.
+static PVConstraint *getRecordedPtr(const PersistentSourceLoc &PSL,
+                                    ConstraintVariable *CV) {
+  PVConstraint *PV = dyn_cast<PVConstraint>(CV);
+  if (auto *FV = dyn_cast<FVConstraint>(CV))
+    PV = FV->getExternalReturn();
+  if (!PSL.valid() || !CV->isForValidDecl() || !PV || PV->getCvars().empty())
+    return nullptr;
+  return PV;
+}
+
+// Get the constraint that makes the first root cause of the WILD pointer VA
+// WILD, or null if there is none, and set NumRootCauses.
+static Constraint *getFirstRootCause(ProgramInfo &Info, VarAtom *VA,
+                                     uint32_t &NumRootCauses) {
+  Constraints &CS = Info.getConstraints();
+  const CVars &Causes = Info.getRootCausesOf(VA->getLoc());
+  NumRootCauses = Causes.size();
+  VarAtom *Root = Causes.empty() ? nullptr : CS.getVar(*Causes.begin());
+  if (!Root)
+    return nullptr;
+  Geq RootConstraint(Root, CS.getWild());
+  auto It = CS.getConstraints().find(&RootConstraint);
+  return It != CS.getConstraints().end() ? *It : nullptr;
+}
+
+void SolutionFile::write(ProgramInfo &Info, raw_ostream &O) {
+  Constraints &CS = Info.getConstraints();
+  AVarBoundsInfo &ABInfo = Info.getABoundsInfo();
+
+  std::string Strings;
+  std::map<std::string, uint32_t> StringOffsets;
+  auto AddString = [&](const std::string &S) {
+    auto It = StringOffsets.find(S);
+    if (It != StringOffsets.end())
+      return It->second;
+    uint32_t Offset = Strings.size();
+    Strings += S;
+    Strings += '\0';
+    StringOffsets[S] = Offset;
+    return Offset;
+  };
+
+  // The variable map is ordered by file name, line and column, so the
+  // entries of each file are contiguous and sorted.
+  std::vector<uint32_t> Files;
+  std::vector<uint32_t> Entries;
+  uint32_t NumEntries = 0;
+  std::string CurrentFile;
+  for (const auto &I : Info.getVarMap()) {
+    const PersistentSourceLoc &PSL = I.first;
+    PVConstraint *PV = getRecordedPtr(PSL, I.second);
+    if (!PV)
+      continue;
+
+    std::string FileName = PSL.getFileName();
+    if (Files.empty() || FileName != CurrentFile) {
+      Files.insert(Files.end(), {AddString(FileName), NumEntries, 0});
+      CurrentFile = FileName;
+    }
+    ++Files.back();
+    ++NumEntries;
+
+    Atom *A = PV->getCvars()[0];
+    auto *VA = dyn_cast<VarAtom>(A);
+    ConstAtom *Solution = VA ? CS.getAssignment(VA) : cast<ConstAtom>(A);
+    PtrKind Kind = getPtrKind(Solution);
+    uint32_t Bounds = NoString;
+    if (PV->hasBoundsKey())
+      if (ABounds *B = ABInfo.getBounds(PV->getBoundsKey()))
+        Bounds = AddString(B->mkString(&ABInfo));
+
+    uint32_t NumRootCauses = 0, Reason = NoString, RootFile = NoString;
+    uint32_t RootLine = 0;
+    if (VA && Kind == Wild) {
+      if (Constraint *Root = getFirstRootCause(Info, VA, NumRootCauses)) {
+        Reason = AddString(Root->getReason());
+        const PersistentSourceLoc &RootPSL = Root->getLocation();
+        if (RootPSL.valid()) {
+          RootFile = AddString(RootPSL.getFileName());
+          RootLine = RootPSL.getLineNo();
+        }
+      }
+    }
+
+    Entries.insert(Entries.end(),
+                   {PSL.getLineNo(), PSL.getColSNo(), PSL.getColENo(),
+                    static_cast<uint32_t>(Kind),
+                    VA ? VA->getLoc() : 0, Bounds, NumRootCauses, Reason,
+                    RootFile, RootLine});
+  }
+
+  support::endian::Writer W(O, support::little);
+  O.write(Magic, sizeof(Magic));
+  W.write<uint32_t>(Version);
+  W.write<uint32_t>(Files.size() / FileFields);
+  W.write<uint32_t>(NumEntries);
+  W.write<uint32_t>(Strings.size());
+  for (uint32_t V : Files)
+    W.write<uint32_t>(V);
+  for (uint32_t V : Entries)
+    W.write<uint32_t>(V);
+  O.write(Strings.data(), Strings.size());
+}
+
+std::unique_ptr<SolutionFile> SolutionFile::open(const std::string &FileName,
+                                                 std::string &Error) {
+  // A large file that is not open for writing is mapped rather than read.
+  auto BufferOrErr = MemoryBuffer::getFile(FileName, /*FileSize=*/-1,
+                                           /*RequiresNullTerminator=*/false);
+  if (std::error_code EC = BufferOrErr.getError()) {
+    Error = EC.message();
+    return nullptr;
+  }
+  std::unique_ptr<SolutionFile> SF(
+      new SolutionFile(std::move(BufferOrErr.get())));
+  StringRef Data = SF->Buffer->getBuffer();
+  if (Data.size() < HeaderSize || !Data.startswith(StringRef(Magic, 4))) {
+    Error = "not a 3C solution file";
+    return nullptr;
+  }
+  if (SF->read(Data.data(), 1) != Version) {
+    Error = "unsupported 3C solution file version";
+    return nullptr;
+  }
+  SF->NumFiles = SF->read(Data.data(), 2);
+  SF->NumEntries = SF->read(Data.data(), 3);
+  uint64_t StringsSize = SF->read(Data.data(), 4);
+  uint64_t EntriesOffset = HeaderSize + 4ULL * FileFields * SF->NumFiles;
+  uint64_t StringsOffset =
+      EntriesOffset + 4ULL * EntryFields * SF->NumEntries;
+  if (StringsOffset + StringsSize != Data.size()) {
+    Error = "truncated 3C solution file";
+    return nullptr;
+  }
+  SF->FilesStart = Data.data() + HeaderSize;
+  SF->EntriesStart = Data.data() + EntriesOffset;
+  SF->Strings = Data.substr(StringsOffset);
+  for (uint32_t I = 0; I < SF->NumFiles; I++) {
+    const char *File = SF->FilesStart + 4 * FileFields * I;
+    if (uint64_t(SF->read(File, 1)) + SF->read(File, 2) > SF->NumEntries) {
+      Error = "invalid file table in 3C solution file";
+      return nullptr;
+    }
+  }
+  return SF;
+}
+
+uint32_t SolutionFile::read(const char *Record, unsigned Field) const {
+  return support::endian::read32le(Record + 4 * Field);
+}
+
+StringRef SolutionFile::getString(uint32_t Offset) const {
+  if (Offset >= Strings.size())
+    return StringRef();
+  StringRef S = Strings.substr(Offset);
+  return S.substr(0, S.find('\0'));
+}
+
+std::vector<SolutionFile::Entry>
+SolutionFile::lookup(StringRef FileName, uint32_t Line) const {
+  std::vector<Entry> Result;
+  // Binary search the file table, then the entries of the file.
+  uint32_t Lo = 0, Hi = NumFiles;
+  while (Lo < Hi) {
+    uint32_t Mid = Lo + (Hi - Lo) / 2;
+    if (getString(read(FilesStart + 4 * FileFields * Mid, 0)) < FileName)
+      Lo = Mid + 1;
+    else
+      Hi = Mid;
+  }
+  if (Lo == NumFiles)
+    return Result;
+  const char *File = FilesStart + 4 * FileFields * Lo;
+  if (getString(read(File, 0)) != FileName)
+    return Result;
+
+  auto EntryAt = [&](uint32_t I) { return EntriesStart + 4 * EntryFields * I; };
+  uint32_t End = read(File, 1) + read(File, 2);
+  Lo = read(File, 1);
+  Hi = End;
+  while (Lo < Hi) {
+    uint32_t Mid = Lo + (Hi - Lo) / 2;
+    if (read(EntryAt(Mid), 0) < Line)
+      Lo = Mid + 1;
+    else
+      Hi = Mid;
+  }
+  for (uint32_t I = Lo; I < End && read(EntryAt(I), 0) == Line; I++) {
+    const char *E = EntryAt(I);
+    uint32_t Kind = read(E, 3);
+    Result.push_back(
+        {read(E, 0), read(E, 1), read(E, 2),
+         Kind < Unknown ? static_cast<PtrKind>(Kind) : Unknown, read(E, 4),
+         getString(read(E, 5)), read(E, 6), getString(read(E, 7)),
+         getString(read(E, 8)), read(E, 9)});
+  }
+  return Result;
+}
+
+std::vector<StringRef> SolutionFile::files() const {
+  std::vector<StringRef> Result;
+  for (uint32_t I = 0; I < NumFiles; I++)
+    Result.push_back(getString(read(FilesStart + 4 * FileFields * I, 0)));
+  return Result;
+}
+
+std::vector<SolutionFile::NewWildPtr>
+SolutionFile::findNewWildPtrs(ProgramInfo &Info) const {
+  Constraints &CS = Info.getConstraints();
+  std::vector<NewWildPtr> Result;
+  for (const auto &I : Info.getVarMap()) {
+    const PersistentSourceLoc &PSL = I.first;
+    PVConstraint *PV = getRecordedPtr(PSL, I.second);
+    if (!PV || !canWrite(PSL))
+      continue;
+    auto *VA = dyn_cast<VarAtom>(PV->getCvars()[0]);
+    if (!VA || getPtrKind(CS.getAssignment(VA)) != Wild)
+      continue;
+
+    bool WasWild = false;
+    for (const Entry &E : lookup(PSL.getFileName(), PSL.getLineNo()))
+      if (E.ColStart == PSL.getColSNo() && E.Kind == Wild)
+        WasWild = true;
+    if (WasWild)
+      continue;
+
+    NewWildPtr New{PSL, VA->getLoc(), 0, "", PersistentSourceLoc()};
+    if (Constraint *Root = getFirstRootCause(Info, VA, New.NumRootCauses)) {
+      New.RootCauseReason = Root->getReason();
+      New.RootCauseLoc = Root->getLocation();
+    }
+    Result.push_back(New);
+  }
+  return Result;
+}
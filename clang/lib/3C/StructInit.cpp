@@ -69,7 +69,7 @@ void StructVariableInitializer::insertVarDecl(VarDecl *VD, DeclStmt *S) {
 }
 
 // Check to see if this variable require an initialization.
-bool StructVariableInitializer::VisitDeclStmt(DeclStmt *S) {
+void StructVariableInitializer::addInitializers(DeclStmt *S) {
   if (S->isSingleDecl()) {
     if (VarDecl *VD = dyn_cast<VarDecl>(S->getSingleDecl()))
       insertVarDecl(VD, S);
@@ -78,5 +78,4 @@ bool StructVariableInitializer::VisitDeclStmt(DeclStmt *S) {
       if (VarDecl *VD = dyn_cast<VarDecl>(D))
         insertVarDecl(VD, S);
   }
-  return true;
 }
@@ -13,13 +13,19 @@
 using namespace llvm;
 using namespace clang;
 
-std::set<ConstraintVariable *> &TypeVariableEntry::getConstraintVariables() {
-  return ArgConsVars;
+llvm::ArrayRef<ConstraintVariable *>
+TypeVariableEntry::takeNewConstraintVariables() {
+  llvm::ArrayRef<ConstraintVariable *> New =
+      llvm::makeArrayRef(ArgConsVars).drop_front(NumUnifiedConsVars);
+  NumUnifiedConsVars = ArgConsVars.size();
+  return New;
 }
 
 void TypeVariableEntry::insertConstraintVariables(
-    std::set<ConstraintVariable *> &CVs) {
-  ArgConsVars.insert(CVs.begin(), CVs.end());
+    const std::set<ConstraintVariable *> &CVs) {
+  for (ConstraintVariable *CV : CVs)
+    if (!llvm::is_contained(ArgConsVars, CV))
+      ArgConsVars.push_back(CV);
 }
 
 void TypeVariableEntry::setTypeParamConsVar(ConstraintVariable *CV) {
@@ -31,7 +37,8 @@ void TypeVariableEntry::setTypeParamConsVar(ConstraintVariable *CV) {
   TypeParamConsVar = CV;
 }
 
-void TypeVariableEntry::updateEntry(QualType Ty, CVarSet &CVs) {
+void TypeVariableEntry::updateEntry(QualType Ty, const CVarSet &CVs) {
+  bool WasConsistent = IsConsistent;
   if (!(Ty->isArrayType() || Ty->isPointerType())) {
     // We need to have a pointer or an array type for an instantiation to make
     // sense. Anything else is treated as inconsistent.
@@ -45,6 +52,10 @@ void TypeVariableEntry::updateEntry(QualType Ty, CVarSet &CVs) {
                          getType()->getPointeeOrArrayElementType() != PtrTy))
       IsConsistent = false;
   }
+  // The constraint variables unified with the type variable so far have to be
+  // made WILD as well once it is inconsistent.
+  if (WasConsistent && !IsConsistent)
+    NumUnifiedConsVars = 0;
   // Record new constraints for the entry. These are used even when the variable
   // is not consistent.
   insertConstraintVariables(CVs);
@@ -100,7 +111,7 @@ bool TypeVarVisitor::VisitCallExpr(CallExpr *CE) {
       bool ForcedInconsistent =
           !typeArgsProvided(CE) &&
           (!Rewriter::isRewritable(CE->getExprLoc()) ||
-           !canWrite(PersistentSourceLoc::mkPSL(CE, *Context).getFileName()));
+           !canWrite(PersistentSourceLoc::mkPSL(CE, *Context)));
       // Visit each function argument, and if it use a type variable, insert it
       // into the type variable binding map.
       unsigned int I = 0;
@@ -120,28 +131,37 @@ bool TypeVarVisitor::VisitCallExpr(CallExpr *CE) {
     }
 
     // For each type variable added above, make a new constraint variable to
-    // remember the solved pointer type.
-    for (auto &TVEntry : TVMap[CE])
-      if (TVEntry.second.getIsConsistent()) {
-        std::string Name =
-            FD->getNameAsString() + "_tyarg_" + std::to_string(TVEntry.first);
-        PVConstraint *P =
-            new PVConstraint(TVEntry.second.getType(), nullptr, Name, Info,
-                             *Context, nullptr, TVEntry.first);
+    // remember the solved pointer type. If this call has been visited before,
+    // the existing entries are only extended with the new uses.
+    auto CallI = TVMap.find(CE);
+    if (CallI == TVMap.end())
+      return true;
+    for (auto &TVEntry : CallI->second) {
+      TypeVariableEntry &Entry = TVEntry.second;
+      llvm::ArrayRef<ConstraintVariable *> NewCVs =
+          Entry.takeNewConstraintVariables();
+      if (Entry.getIsConsistent()) {
+        if (!Entry.hasTypeParamConsVar()) {
+          std::string Name =
+              FD->getNameAsString() + "_tyarg_" + std::to_string(TVEntry.first);
+          Entry.setTypeParamConsVar(new PVConstraint(Entry.getType(), nullptr,
+                                                     Name, Info, *Context,
+                                                     nullptr, TVEntry.first));
+        }
 
         // Constrain this variable GEQ the function arguments using the type
         // variable so if any of them are wild, the type argument will also be
         // an unchecked pointer.
-        constrainConsVarGeq(P, TVEntry.second.getConstraintVariables(),
-                            Info.getConstraints(), nullptr, Safe_to_Wild, false,
-                            &Info);
-
-        TVEntry.second.setTypeParamConsVar(P);
-      } else {
+        for (ConstraintVariable *CV : NewCVs)
+          constrainConsVarGeq(Entry.getTypeParamConsVar(), CV,
+                              Info.getConstraints(), nullptr, Safe_to_Wild,
+                              false, &Info);
+      } else if (!NewCVs.empty()) {
         // TODO: This might be too cautious.
-        CR.constraintAllCVarsToWild(TVEntry.second.getConstraintVariables(),
+        CR.constraintAllCVarsToWild(CVarSet(NewCVs.begin(), NewCVs.end()),
                                     "Used with inconsistent type variable.");
       }
+    }
   }
   return true;
 }
@@ -171,8 +191,10 @@ void TypeVarVisitor::insertBinding(CallExpr *CE, const int TyIdx,
 void TypeVarVisitor::getConsistentTypeParams(CallExpr *CE,
                                              std::set<unsigned int> &Types) {
   // Gather consistent TypeVariables into output set
-  auto &CallTypeVarBindings = TVMap[CE];
-  for (const auto &TVEntry : CallTypeVarBindings)
+  auto CallI = TVMap.find(CE);
+  if (CallI == TVMap.end())
+    return;
+  for (const auto &TVEntry : CallI->second)
     if (TVEntry.second.getIsConsistent())
       Types.insert(TVEntry.first);
 }
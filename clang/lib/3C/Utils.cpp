@@ -200,8 +200,10 @@ bool functionHasVarArgs(clang::FunctionDecl *FD) {
 }
 
 bool isFunctionAllocator(std::string FuncName) {
-  return std::find(AllocatorFunctions.begin(), AllocatorFunctions.end(),
-                   FuncName) != AllocatorFunctions.end() ||
+  const std::vector<std::string> &Allocators =
+      get3COptions().AllocatorFunctions;
+  return std::find(Allocators.begin(), Allocators.end(), FuncName) !=
+             Allocators.end() ||
          llvm::StringSwitch<bool>(FuncName)
              .Cases("malloc", "calloc", "realloc", true)
              .Default(false);
@@ -389,11 +391,23 @@ bool isCastSafe(clang::QualType DstType, clang::QualType SrcType) {
 
 bool canWrite(const std::string &FilePath) {
   // Was this file explicitly provided on the command line?
-  if (FilePaths.count(FilePath) > 0)
+  if (get3COptions().FilePaths.count(FilePath) > 0)
     return true;
   // Get the absolute path of the file and check that
   // the file path starts with the base directory.
-  return filePathStartsWith(FilePath, BaseDir);
+  return filePathStartsWith(FilePath, get3COptions().BaseDir);
+}
+
+bool canWrite(const PersistentSourceLoc &PSL) {
+  const _3CGlobalOptions &Opts = get3COptions();
+  StringRef FileName = PSL.getInternedFileName();
+  std::lock_guard<std::mutex> Lock(Opts.CanWriteMutex);
+  auto It = Opts.CanWriteCache.find(FileName.data());
+  if (It != Opts.CanWriteCache.end())
+    return It->second;
+  bool Result = canWrite(FileName.str());
+  Opts.CanWriteCache[FileName.data()] = Result;
+  return Result;
 }
 
 bool isInSysHeader(clang::Decl *D) {
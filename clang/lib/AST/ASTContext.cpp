@@ -34,11 +34,13 @@
 #include "clang/AST/Expr.h"
 #include "clang/AST/ExprCXX.h"
 #include "clang/AST/ExprConcepts.h"
+#include "clang/AST/ExprUtils.h"
 #include "clang/AST/ExternalASTSource.h"
 #include "clang/AST/Mangle.h"
 #include "clang/AST/MangleNumberingContext.h"
 #include "clang/AST/NestedNameSpecifier.h"
 #include "clang/AST/ParentMapContext.h"
+#include "clang/AST/PreorderAST.h"
 #include "clang/AST/RawCommentList.h"
 #include "clang/AST/RecordLayout.h"
 #include "clang/AST/Stmt.h"
@@ -1080,6 +1082,9 @@ void ASTContext::PrintStats() const {
                << NumImplicitDestructors
                << " implicit destructors created\n";
 
+  if (getLangOpts().CheckedC)
+    PrintCheckedCStats();
+
   if (ExternalSource) {
     llvm::errs() << "\n";
     ExternalSource->PrintStats();
@@ -1088,6 +1093,67 @@ void ASTContext::PrintStats() const {
   BumpAlloc.PrintStats();
 }
 
+// The bytes of the elements of V that are not stored in V itself.
+template <typename T, unsigned N>
+static size_t getOutOfLineBytes(const SmallVector<T, N> &V) {
+  return V.capacity() > N ? V.capacity_in_bytes() : 0;
+}
+
+void ASTContext::PrintCheckedCStats() const {
+  llvm::errs() << "\n*** Checked C Stats:\n";
+  size_t TotalBytes = 0;
+  auto PrintTable = [&TotalBytes](unsigned Entries, StringRef Name,
+                                  size_t Bytes) {
+    llvm::errs() << "  " << Entries << " " << Name << " (" << Bytes
+                 << " bytes)\n";
+    TotalBytes += Bytes;
+  };
+
+  // The shared bounds expressions and annotations live in the ASTContext's
+  // allocator, so they are counted with the tables that own them.
+  PrintTable(StringLiteralCountBounds.size(), "string literal count bounds",
+             StringLiteralCountBounds.getMemorySize() +
+                 StringLiteralCountBounds.size() *
+                     (sizeof(CountBoundsExpr) + sizeof(IntegerLiteral)));
+  PrintTable(UniquedBoundsAnnotations.size(), "uniqued bounds annotations",
+             UniquedBoundsAnnotations.getMemorySize() +
+                 UniquedBoundsAnnotations.size() * sizeof(BoundsAnnotations));
+
+  size_t SiblingBytes = SiblingFieldBoundsUses.getMemorySize();
+  for (const auto &RecordAndUses : SiblingFieldBoundsUses)
+    SiblingBytes += getOutOfLineBytes(RecordAndUses.second);
+  PrintTable(SiblingFieldBoundsUses.size(),
+             "records with sibling field bounds uses", SiblingBytes);
+
+  // A node of a std::map holds the value and three pointers and a color.
+  size_t MemberBytes = 0;
+  for (const auto &PathAndFields : UsingBounds)
+    MemberBytes += sizeof(PathAndFields) + 4 * sizeof(void *) +
+                   getOutOfLineBytes(PathAndFields.first);
+  PrintTable(UsingBounds.size(), "member paths used by member bounds",
+             MemberBytes);
+
+  // The caches of the function bodies are empty between function bodies,
+  // but keep the memory of their largest function body.
+  PrintTable(LexicographicCache.size(), "cached expression comparisons",
+             LexicographicCache.getMemorySize());
+  PrintTable(LinearFormCache.size(), "cached linear forms",
+             LinearFormCache.getMemorySize());
+  PrintTable(VariableOccurrenceCache.size(), "cached variable occurrences",
+             VariableOccurrenceCache.getMemorySize());
+  PrintTable(SynthesizedExprs.IntegerLiterals.size() +
+                 SynthesizedExprs.ImplicitCasts.size() +
+                 SynthesizedExprs.BinaryOperators.size() +
+                 SynthesizedExprs.ConcreteMemberBounds.size(),
+             "shared synthesized expressions",
+             SynthesizedExprs.IntegerLiterals.getMemorySize() +
+                 SynthesizedExprs.ImplicitCasts.getMemorySize() +
+                 SynthesizedExprs.BinaryOperators.getMemorySize() +
+                 SynthesizedExprs.ConcreteMemberBounds.getMemorySize());
+
+  llvm::errs() << "Total Checked C bytes = " << TotalBytes << "\n";
+}
+
 void ASTContext::mergeDefinitionIntoModule(NamedDecl *ND, Module *M,
                                            bool NotifyListeners) {
   if (NotifyListeners)
@@ -10573,6 +10639,12 @@ bool ASTContext::isNotAllowedForNoPrototypeFunction(QualType QT) const {
 
 bool ASTContext::EquivalentBounds(const BoundsExpr *Expr1, const BoundsExpr *Expr2,
                                   EquivExprSets *EquivExprs) {
+  // The annotations of a merged function type are shared with the type (and
+  // the declarations) that they came from, so redeclarations often compare
+  // a bounds expression with itself.
+  if (Expr1 == Expr2)
+    return true;
+
   if (Expr1 && Expr2) {
     Lexicographic::Result Cmp = Lexicographic(*this, EquivExprs).CompareExpr(Expr1, Expr2);
     return Cmp == Lexicographic::Result::Equal;
@@ -10665,6 +10737,38 @@ BoundsExpr *ASTContext::getPrebuiltBoundsUnknown() {
   return PrebuiltBoundsUnknown;
 }
 
+BoundsExpr *ASTContext::getStringLiteralCountBounds(uint64_t Length) {
+  BoundsExpr *&Bounds = StringLiteralCountBounds[Length];
+  if (!Bounds) {
+    IntegerLiteral *Size =
+      ExprCreatorUtil::CreateIntegerLiteral(*this, llvm::APInt(64, Length));
+    Bounds = new (*this) CountBoundsExpr(BoundsExpr::Kind::ElementCount,
+                                         Size, SourceLocation(),
+                                         SourceLocation());
+  }
+  return Bounds;
+}
+
+const BoundsAnnotations *
+ASTContext::getUniquedBoundsAnnotations(BoundsExpr *Bounds,
+                                        InteropTypeExpr *IType) {
+  if (!Bounds && !IType)
+    return nullptr;
+  BoundsAnnotations *&Annots = UniquedBoundsAnnotations[{Bounds, IType}];
+  if (!Annots)
+    Annots = new (*this) BoundsAnnotations(Bounds, IType);
+  return Annots;
+}
+
+void ASTContext::enableLexicographicCache(bool Enable) {
+  LexicographicCacheEnabled = Enable;
+  if (!Enable) {
+    LexicographicCache.clear();
+    LinearFormCache.clear();
+    VariableOccurrenceCache.clear();
+  }
+}
+
  QualType ASTContext::getInteropTypeAndAdjust(const InteropTypeExpr *BA, bool IsParam) const {
   if (!BA) return QualType();
   QualType ResultType = BA->getType();
@@ -10709,7 +10813,53 @@ ASTContext::using_member_bounds(const MemberPath &Path) const {
 
 void ASTContext::addMemberBoundsUse(const MemberPath &Path,
                                     const FieldDecl *Bounds) {
-  UsingBounds[Path].push_back(Bounds);
+  MemberDeclVector &Uses = UsingBounds[Path];
+  // A use may be added again when it is read from more than one AST file.
+  if (llvm::find(Uses, Bounds) == Uses.end())
+    Uses.push_back(Bounds);
+}
+
+const ASTContext::SiblingFieldBoundsUsesTy &
+ASTContext::getSiblingFieldBoundsUses(const RecordDecl *RD) {
+  static const SiblingFieldBoundsUsesTy NoUses;
+  if (!RD->isCompleteDefinition())
+    return NoUses;
+  auto It = SiblingFieldBoundsUses.find(RD);
+  if (It != SiblingFieldBoundsUses.end())
+    return It->second;
+
+  SiblingFieldBoundsUsesTy Uses;
+  auto AddUse = [&Uses](const FieldDecl *F, const FieldDecl *WithBounds) {
+    std::pair<const FieldDecl *, const FieldDecl *> Use(F, WithBounds);
+    if (llvm::find(Uses, Use) == Uses.end())
+      Uses.push_back(Use);
+  };
+  for (const FieldDecl *Field : RD->fields()) {
+    const BoundsExpr *Bounds = Field->getBoundsExpr();
+    if (!Bounds)
+      continue;
+    if (isa<CountBoundsExpr>(Bounds))
+      AddUse(Field, Field);
+    SmallVector<const Stmt *, 8> Worklist;
+    Worklist.push_back(Bounds);
+    while (!Worklist.empty()) {
+      const Stmt *S = Worklist.pop_back_val();
+      if (const auto *DR = dyn_cast<DeclRefExpr>(S)) {
+        const auto *F = dyn_cast_or_null<FieldDecl>(DR->getDecl());
+        if (F && !F->isInvalidDecl())
+          AddUse(F, Field);
+      }
+      for (const Stmt *Child : S->children())
+        if (Child)
+          Worklist.push_back(Child);
+    }
+  }
+  return SiblingFieldBoundsUses[RD] = std::move(Uses);
+}
+
+void ASTContext::addSiblingFieldBoundsUses(const RecordDecl *RD,
+                                           SiblingFieldBoundsUsesTy Uses) {
+  SiblingFieldBoundsUses.insert({RD, std::move(Uses)});
 }
 
 //===----------------------------------------------------------------------===//
@@ -12195,15 +12345,10 @@ RecordDecl *ASTContext::getCachedTypeApp(const RecordDecl *Base, ArrayRef<const
   return it->second;
 }
 
-std::vector<const RecordDecl *> ASTContext::getTypeAppsWithBase(const RecordDecl *Base) {
-  std::vector<const RecordDecl *> TypeApps;
-  for (const auto Iter : CachedTypeApps) {
-    auto Key = Iter.getFirst();
-    // The key is a pair (generic base, type application).
-    // The value ('Iter.getSecond()') is the corresponding (instantiated) RecordDecl.
-    if (Key.first == Base) TypeApps.push_back(Iter.getSecond());
-  }
-  return TypeApps;
+ArrayRef<const RecordDecl *> ASTContext::getTypeAppsWithBase(const RecordDecl *Base) const {
+  const auto Iter = CachedTypeAppsByBase.find(Base);
+  if (Iter == CachedTypeAppsByBase.end()) return ArrayRef<const RecordDecl *>();
+  return Iter->second;
 }
 
 void ASTContext::addCachedTypeApp(const RecordDecl *Base, ArrayRef<const Type *> TypeArgs, RecordDecl *Inst) {
@@ -12214,8 +12359,11 @@ void ASTContext::addCachedTypeApp(const RecordDecl *Base, ArrayRef<const Type *>
   assert((getCachedTypeApp(Base, TypeArgs) == nullptr) && "Type application is already cached");
   // Copy the storage backing up the type arguments, since we'll potentially continue to query the map
   // after `TypeArgs` has been de-allocated (e.g. if `TypeArgs` was allocated on the stack).
-  auto TypeArgsCopy = new (*this) llvm::SmallVector<const Type *, 4>(TypeArgs.begin(), TypeArgs.end());
-  CachedTypeApps.insert(std::make_pair(std::make_pair(Base, ArrayRef<const Type *>(*TypeArgsCopy)), Inst));
+  // The copy lives as long as the ASTContext, so a plain array is enough.
+  auto TypeArgsCopy = new (*this) const Type *[TypeArgs.size()];
+  std::copy(TypeArgs.begin(), TypeArgs.end(), TypeArgsCopy);
+  CachedTypeApps.insert(std::make_pair(std::make_pair(Base, ArrayRef<const Type *>(TypeArgsCopy, TypeArgs.size())), Inst));
+  CachedTypeAppsByBase[Base].push_back(Inst);
 }
 
 ArrayRef<RecordDecl *> ASTContext::getDelayedTypeApps(RecordDecl *Base) {
@@ -19,31 +19,30 @@
 using namespace clang;
 
 const AbstractSet *AbstractSetManager::GetOrCreateAbstractSet(Expr *E) {
+  // If E has been looked up before, return the AbstractSet found then.
+  const AbstractSet *&Cached = ExprAbstractSetMap[E];
+  if (Cached)
+    return Cached;
+
   // Create a canonical form for E.
-  PreorderAST *P = new PreorderAST(S.getASTContext(), E);
-  P->Normalize();
+  PreorderAST P(S.getASTContext(), E);
+  P.Normalize();
 
-  // Search for an existing PreorderAST that is equivalent to the canonical
-  // form for E.
-  auto I = SortedPreorderASTs.find(P);
-  if (I != SortedPreorderASTs.end()) {
-    PreorderAST *ExistingCanonicalForm = *I;
-    // If an AbstractSet exists in PreorderASTAbstractSetMap whose CanonicalForm
-    // is equivalent to ExistingCanonicalForm, then that AbstractSet is the
-    // one that contains E.
-    auto It = PreorderASTAbstractSetMap.find(ExistingCanonicalForm);
-    if (It != PreorderASTAbstractSetMap.end()) {
-      P->Cleanup();
-      delete P;
-      return It->second;
-    }
+  // Search for an existing AbstractSet whose CanonicalForm is equivalent to
+  // the canonical form for E. If one exists, it is the AbstractSet that
+  // contains E.
+  auto I = SortedAbstractSets.find(P);
+  if (I != SortedAbstractSets.end()) {
+    P.Cleanup();
+    Cached = *I;
+    return Cached;
   }
 
   // If there is no existing AbstractSet that contains E, create a new
   // AbstractSet that contains E.
-  const AbstractSet *A = new AbstractSet(*P, E);
-  SortedPreorderASTs.emplace(P);
-  PreorderASTAbstractSetMap[P] = A;
+  AbstractSet *A = new (AbstractSetAllocator.Allocate()) AbstractSet(P, E);
+  SortedAbstractSets.insert(A);
+  Cached = A;
   return A;
 }
 
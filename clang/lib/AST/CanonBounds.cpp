@@ -294,55 +294,31 @@ bool Lexicographic::CompareExprSemantically(const Expr *Arg1,
   return Res;
 }
 
+// Get the linear form of E.  If the linear form cache of Ctx is enabled, the
+// linear form is cached there.  Otherwise it is owned by Temp.
+static const LinearForm &GetLinearForm(ASTContext &Ctx, const Expr *E,
+                                       std::unique_ptr<LinearForm> &Temp) {
+  ASTContext::LinearFormCacheTy *Cache = Ctx.getLinearFormCache();
+  std::unique_ptr<LinearForm> *Slot = Cache ? &(*Cache)[E] : &Temp;
+  if (!*Slot)
+    *Slot = std::make_unique<LinearForm>(Ctx, const_cast<Expr *>(E));
+  return **Slot;
+}
+
 bool Lexicographic::GetDerefOffset(const Expr *UpperExpr,
                                    const Expr *DerefExpr,
                                    llvm::APSInt &Offset) const {
-  Expr *E1 = const_cast<Expr *>(UpperExpr);
-  Expr *E2 = const_cast<Expr *>(DerefExpr);
-
-  PreorderAST P1(Context, E1);
-  P1.Normalize();
-  if (P1.GetError()) {
-    P1.Cleanup();
-    return false;
-  }
-
-  PreorderAST P2(Context, E2);
-  P2.Normalize();
-  if (P2.GetError()) {
-    P2.Cleanup();
-    return false;
-  }
-
-  bool Res = P1.GetDerefOffset(P2, Offset);
-  P1.Cleanup();
-  P2.Cleanup();
-  return Res;
+  // The offset is (deref expr - declared upper bound expr), which exists if
+  // the two exprs have the same non-integer parts.
+  return GetExprIntDiff(DerefExpr, UpperExpr, Offset);
 }
 
 bool Lexicographic::GetExprIntDiff(const Expr *Arg1, const Expr *Arg2,
                                    llvm::APSInt &Offset) const {
-  Expr *E1 = const_cast<Expr *>(Arg1);
-  Expr *E2 = const_cast<Expr *>(Arg2);
-
-  PreorderAST P1(Context, E1);
-  P1.Normalize();
-  if (P1.GetError()) {
-    P1.Cleanup();
-    return false;
-  }
-
-  PreorderAST P2(Context, E2);
-  P2.Normalize();
-  if (P2.GetError()) {
-    P2.Cleanup();
-    return false;
-  }
-
-  bool Res = P1.GetExprIntDiff(P2, Offset);
-  P1.Cleanup();
-  P2.Cleanup();
-  return Res;
+  std::unique_ptr<LinearForm> Temp1, Temp2;
+  const LinearForm &F1 = GetLinearForm(Context, Arg1, Temp1);
+  const LinearForm &F2 = GetLinearForm(Context, Arg2, Temp2);
+  return F1.GetIntDiff(F2, Offset);
 }
 
 Result Lexicographic::CompareExpr(const Expr *Arg1, const Expr *Arg2) const {
@@ -364,6 +340,30 @@ Result Lexicographic::CompareExpr(const Expr *Arg1, const Expr *Arg2) const {
   if (E1 == E2)
     return Result::Equal;
 
+  // Look up the result of a structural comparison of E1 and E2 (one that
+  // does not use equality facts).  If E1 and E2 are structurally equal, they
+  // are equal regardless of EquivExprs.  Otherwise, the structural result is
+  // the final result only if there are no equality facts.
+  ASTContext::LexicographicCacheTy *Cache = Context.getLexicographicCache();
+  if (Cache) {
+    auto It = Cache->find(ASTContext::ExprPairTy(E1, E2));
+    if (It != Cache->end()) {
+      if (It->second == Result::Equal || !EquivExprs)
+        return It->second;
+    }
+  }
+
+  Result Cmp = CompareExprImpl(E1, E2);
+
+  // Only results computed without equality facts can be cached.  A result
+  // of Equal computed with equality facts may not hold without them.
+  if (Cache && !EquivExprs)
+    (*Cache)[ASTContext::ExprPairTy(E1, E2)] = Cmp;
+  return Cmp;
+}
+
+Result
+Lexicographic::CompareExprImpl(Expr *E1, Expr *E2) const {
   // The use of an expression temporary is equal to the
   // value of the binding expression.
   if (BoundsValueExpr *BV1 = dyn_cast<BoundsValueExpr>(E1)) {
@@ -539,46 +539,49 @@ Result Lexicographic::CompareExpr(const Expr *Arg1, const Expr *Arg2) const {
 
 // See if the expressions are considered equivalent using the list of lists
 // of equivalent expressions.
-Result Lexicographic::CheckEquivExprs(Result Current, const Expr *E1, const Expr *E2) const {
-  if (!EquivExprs)
-    return Current;
+const Lexicographic::EquivClassIndices &
+Lexicographic::GetEquivClasses(const Expr *E) const {
+  auto It = EquivClasses.find(E);
+  if (It != EquivClasses.end())
+    return It->second;
 
   // Important: compare expressions for equivalence without using equality facts.
   // This keep the asymptotic complexity of this method linear in the number of AST nodes
-  // for E1, E2, and EquivExprs.  It also avoid the complexities of having to avoid
+  // for E and EquivExprs.  It also avoid the complexities of having to avoid
   // infinite recursions.
   Lexicographic SimpleComparer = Lexicographic(Context, nullptr);
-  // Iterate over the list of sets.
-  for (auto OuterList = EquivExprs->begin(); OuterList != EquivExprs->end();
-       ++OuterList) {
-    bool LHSAppears = false;
-    bool RHSAppears = false;
-    // See if the LHS expression appears in the set.
-    SmallVector<Expr *, 4> ExprList = *OuterList;
-    for (auto InnerList = ExprList.begin(); InnerList != ExprList.end(); ++InnerList) {
-      if (SimpleComparer.CompareExpr(E1, *InnerList)  == Result::Equal) {
-        LHSAppears = true;
+  EquivClassIndices Classes;
+  for (unsigned I = 0, N = EquivExprs->size(); I != N; ++I) {
+    for (Expr *InnerE : (*EquivExprs)[I]) {
+      if (SimpleComparer.CompareExpr(E, InnerE) == Result::Equal) {
+        Classes.push_back(I);
         break;
       }
     }
-    if (!LHSAppears)
-      continue;
+  }
+  return EquivClasses[E] = std::move(Classes);
+}
 
-    // See if the RHS expression appears in the set.
-    for (auto InnerList = ExprList.begin(); InnerList != ExprList.end(); ++InnerList) {
-      if (SimpleComparer.CompareExpr(E2, *InnerList)  == Result::Equal) {
-        RHSAppears = true;
-        break;
-      }
-    }
+Result Lexicographic::CheckEquivExprs(Result Current, const Expr *E1, const Expr *E2) const {
+  if (!EquivExprs || EquivExprs->empty())
+    return Current;
 
-    // If both appear, consider them equivalent.
-    if (RHSAppears)
+  // The class indices of each expression are computed once and cached, so
+  // that the repeated checks made while comparing the subexpressions of E1
+  // and E2 do not rescan EquivExprs.  Note that the reference returned for
+  // E1 may be invalidated by the lookup for E2, so copy it first.
+  EquivClassIndices Classes1 = GetEquivClasses(E1);
+  if (Classes1.empty())
+    return Current;
+  const EquivClassIndices &Classes2 = GetEquivClasses(E2);
+
+  // If both appear in the same set, consider them equivalent.
+  for (unsigned I : Classes1)
+    if (llvm::is_contained(Classes2, I))
       return Result::Equal;
-  }
 
   return Current;
- }
+}
 
 
 Result
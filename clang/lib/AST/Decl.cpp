@@ -1978,6 +1978,17 @@ bool DeclaratorDecl::hasBoundsSafeInterface(const ASTContext &Ctx) const {
   return getBoundsExpr() != nullptr && !hasBoundsDeclaration(Ctx);
 }
 
+void DeclaratorDecl::setBoundsAnnotations(ASTContext &Context,
+                                          BoundsAnnotations BA) {
+  // The normalized bounds are computed lazily from the declared bounds,
+  // so they are stale if the declared bounds change (for example, when a
+  // redeclaration is merged).
+  if (getBoundsExpr() != BA.getBoundsExpr())
+    NormalizedBounds = nullptr;
+  Annotations = Context.getUniquedBoundsAnnotations(BA.getBoundsExpr(),
+                                                    BA.getInteropTypeExpr());
+}
+
 QualType DeclaratorDecl::getInteropType() {
   InteropTypeExpr *BA = getInteropTypeExpr();
   if (BA)
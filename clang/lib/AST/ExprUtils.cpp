@@ -26,25 +26,56 @@ BinaryOperator *ExprCreatorUtil::CreateBinaryOperator(Sema &SemaRef,
   RHS = EnsureRValue(SemaRef, RHS);
   if (BinaryOperator::isCompoundAssignmentOp(Op))
     Op = BinaryOperator::getOpForCompoundAssignment(Op);
-  return BinaryOperator::Create(SemaRef.Context, LHS, RHS, Op,
-                                LHS->getType(), LHS->getValueKind(),
-                                LHS->getObjectKind(), SourceLocation(),
-                                FPOptionsOverride());
+
+  // Share the operators that are built more than once while checking a
+  // function body.
+  BinaryOperator **Slot = nullptr;
+  if (ASTContext::SynthesizedExprTables *Tables =
+        SemaRef.Context.getSynthesizedExprTables()) {
+    Slot = &Tables->BinaryOperators[std::make_tuple(Op, LHS, RHS)];
+    if (*Slot)
+      return *Slot;
+  }
+
+  BinaryOperator *Result =
+    BinaryOperator::Create(SemaRef.Context, LHS, RHS, Op,
+                           LHS->getType(), LHS->getValueKind(),
+                           LHS->getObjectKind(), SourceLocation(),
+                           FPOptionsOverride());
+  if (Slot)
+    *Slot = Result;
+  return Result;
 }
 
 IntegerLiteral *ExprCreatorUtil::CreateUnsignedInt(Sema &SemaRef,
                                                    unsigned Value) {
   QualType T = SemaRef.Context.UnsignedIntTy;
   llvm::APInt Val(SemaRef.Context.getIntWidth(T), Value);
-  return IntegerLiteral::Create(SemaRef.Context, Val,
-                                T, SourceLocation());
+  return CreateSharedIntegerLiteral(SemaRef.Context, Val, T);
 }
 
 ImplicitCastExpr *ExprCreatorUtil::CreateImplicitCast(Sema &SemaRef, Expr *E,
                                                       CastKind CK,
                                                       QualType T) {
-  return ImplicitCastExpr::Create(SemaRef.Context, T, CK, E, nullptr,
-                                  ExprValueKind::VK_RValue, FPOptionsOverride());
+  // Only the casts that read a variable or decay an array variable are
+  // shared.  They are never given bounds themselves, unlike casts of
+  // arbitrary subexpressions.
+  ImplicitCastExpr **Slot = nullptr;
+  ASTContext::SynthesizedExprTables *Tables =
+    SemaRef.Context.getSynthesizedExprTables();
+  if (Tables && isa<DeclRefExpr>(E) &&
+      (CK == CK_LValueToRValue || CK == CK_ArrayToPointerDecay)) {
+    Slot = &Tables->ImplicitCasts[std::make_tuple(CK, E, T)];
+    if (*Slot)
+      return *Slot;
+  }
+
+  ImplicitCastExpr *Result =
+    ImplicitCastExpr::Create(SemaRef.Context, T, CK, E, nullptr,
+                             ExprValueKind::VK_RValue, FPOptionsOverride());
+  if (Slot)
+    *Slot = Result;
+  return Result;
 }
 
 Expr *ExprCreatorUtil::CreateExplicitCast(Sema &SemaRef, QualType Target,
@@ -128,9 +159,7 @@ IntegerLiteral *ExprCreatorUtil::CreateIntegerLiteral(ASTContext &Ctx,
     ResultVal = I;
     Ty = Ctx.UnsignedLongLongTy;
   }
-  IntegerLiteral *Lit = IntegerLiteral::Create(Ctx, ResultVal, Ty,
-                                               SourceLocation());
-  return Lit;
+  return CreateSharedIntegerLiteral(Ctx, ResultVal, Ty);
 }
 
 IntegerLiteral *ExprCreatorUtil::CreateIntegerLiteral(ASTContext &Ctx,
@@ -150,7 +179,19 @@ IntegerLiteral *ExprCreatorUtil::CreateIntegerLiteral(ASTContext &Ctx,
     return nullptr;
 
   const llvm::APInt ResultVal(BitSize, Value);
-  return IntegerLiteral::Create(Ctx, ResultVal, Ty, SourceLocation());
+  return CreateSharedIntegerLiteral(Ctx, ResultVal, Ty);
+}
+
+IntegerLiteral *ExprCreatorUtil::CreateSharedIntegerLiteral(
+    ASTContext &Ctx, const llvm::APInt &Value, QualType Ty) {
+  ASTContext::SynthesizedExprTables *Tables = Ctx.getSynthesizedExprTables();
+  if (!Tables)
+    return IntegerLiteral::Create(Ctx, Value, Ty, SourceLocation());
+
+  IntegerLiteral *&Lit = Tables->IntegerLiterals[std::make_pair(Ty, Value)];
+  if (!Lit)
+    Lit = IntegerLiteral::Create(Ctx, Value, Ty, SourceLocation());
+  return Lit;
 }
 
 bool ExprCreatorUtil::Fits(ASTContext &Ctx, QualType Ty,
@@ -325,6 +366,17 @@ bool ExprUtil::IsReturnValueExpr(Expr *E) {
   return BVE->getKind() == BoundsValueExpr::Kind::Return;
 }
 
+bool ExprUtil::ContainsBoundsTemporary(const Expr *E) {
+  if (!E)
+    return false;
+  if (const auto *BVE = dyn_cast<BoundsValueExpr>(E))
+    return BVE->getKind() == BoundsValueExpr::Kind::Temporary;
+  for (const Stmt *Child : E->children())
+    if (ContainsBoundsTemporary(dyn_cast_or_null<Expr>(Child)))
+      return true;
+  return false;
+}
+
 namespace {
   class FindLValueHelper : public RecursiveASTVisitor<FindLValueHelper> {
     private:
@@ -394,12 +446,6 @@ namespace {
   };
 }
 
-bool ExprUtil::FindLValue(Sema &S, Expr *LValue, Expr *E) {
-  FindLValueHelper Finder(S, LValue);
-  Finder.TraverseStmt(E);
-  return Finder.IsFound();
-}
-
 std::pair<Expr *, Expr *> ExprUtil::SplitByLValueCount(Sema &S, Expr *LValue,
                                                        Expr *E1, Expr *E2) {
   std::pair<Expr *, Expr *> Pair;
@@ -493,18 +539,104 @@ namespace {
   };
 }
 
+namespace {
+  // Collect the variables that occur in an expression, with the number of
+  // occurrences of each.  Like LValueCountHelper, this does not count the
+  // variables that occur in the child of a BoundsValueExpr.
+  class VariableOccurrencesHelper :
+    public RecursiveASTVisitor<VariableOccurrencesHelper> {
+    private:
+      ASTContext::VariableOccurrencesTy &Occurrences;
+
+    public:
+      VariableOccurrencesHelper(
+          ASTContext::VariableOccurrencesTy &Occurrences) :
+        Occurrences(Occurrences) {}
+
+      bool VisitDeclRefExpr(DeclRefExpr *E) {
+        ValueDecl *D = E->getDecl();
+        if (!D)
+          return true;
+        const ValueDecl *Canon = cast<ValueDecl>(D->getCanonicalDecl());
+        for (auto &Pair : Occurrences) {
+          if (Pair.first == Canon) {
+            ++Pair.second;
+            return true;
+          }
+        }
+        Occurrences.push_back(std::make_pair(Canon, 1u));
+        return true;
+      }
+
+      bool TraverseBoundsValueExpr(BoundsValueExpr *E) {
+        return true;
+      }
+  };
+}
+
+// Return the number of occurrences of variables in E whose declarations are
+// equivalent to V.  The variables that occur in E are collected once per
+// expression while the variable occurrence cache of the ASTContext is
+// enabled, so repeated queries for the same expression do not traverse it.
+static unsigned int CountVariableOccurrences(Sema &S, const ValueDecl *V,
+                                             Expr *E) {
+  ASTContext::VariableOccurrencesTy Temp;
+  ASTContext::VariableOccurrencesTy *Occurrences = &Temp;
+  ASTContext::VariableOccurrenceCacheTy *Cache =
+    S.Context.getVariableOccurrenceCache();
+  if (Cache) {
+    auto It = Cache->find(E);
+    if (It != Cache->end())
+      Occurrences = &It->second;
+  }
+  if (Occurrences == &Temp) {
+    VariableOccurrencesHelper Collector(Temp);
+    Collector.TraverseStmt(E);
+    if (Cache)
+      Occurrences = &((*Cache)[E] = std::move(Temp));
+  }
+
+  Lexicographic Lex(S.Context, nullptr);
+  unsigned int Count = 0;
+  for (const auto &Pair : *Occurrences)
+    if (Lex.CompareDecl(Pair.first, V) == Lexicographic::Result::Equal)
+      Count += Pair.second;
+  return Count;
+}
+
+bool ExprUtil::FindLValue(Sema &S, Expr *LValue, Expr *E) {
+  // Every assignment looks for its lvalue in all the observed bounds, so
+  // the occurrences of a variable are looked up in the cached variables of
+  // each bounds expression.
+  if (DeclRefExpr *Var = dyn_cast_or_null<DeclRefExpr>(LValue)) {
+    if (!E)
+      return false;
+    return CountVariableOccurrences(S, Var->getDecl(), E) > 0;
+  }
+
+  FindLValueHelper Finder(S, LValue);
+  Finder.TraverseStmt(E);
+  return Finder.IsFound();
+}
+
 unsigned int ExprUtil::LValueOccurrenceCount(Sema &S, Expr *LValue, Expr *E) {
+  // Two variables are equal if their declarations are equal, so an occurrence
+  // of a variable LValue can be counted from the variables that occur in E.
+  if (DeclRefExpr *Var = dyn_cast_or_null<DeclRefExpr>(LValue)) {
+    if (!E)
+      return 0;
+    return CountVariableOccurrences(S, Var->getDecl(), E);
+  }
+
   LValueCountHelper Counter(S, LValue, nullptr);
   Counter.TraverseStmt(E);
   return Counter.GetCount();
 }
 
 unsigned int ExprUtil::VariableOccurrenceCount(Sema &S, ValueDecl *V, Expr *E) {
-  if (!V)
+  if (!V || !E)
     return 0;
-  LValueCountHelper Counter(S, nullptr, V);
-  Counter.TraverseStmt(E);
-  return Counter.GetCount();
+  return CountVariableOccurrences(S, V, E);
 }
 
 unsigned int ExprUtil::VariableOccurrenceCount(Sema &S, DeclRefExpr *Target,
@@ -559,14 +691,17 @@ bool InverseUtil::IsUnaryOperatorInvertible(Sema &S, Expr *LValue,
     else if (ArraySubscriptExpr *ArraySubExpr = dyn_cast<ArraySubscriptExpr>(SubExpr)) {
       Expr *Base = ArraySubExpr->getBase();
       Expr *Index = ArraySubExpr->getIdx();
-      BinaryOperator Sum(S.Context, Base, Index,
-                         BinaryOperatorKind::BO_Add,
-                         Base->getType(),
-                         Base->getValueKind(),
-                         Base->getObjectKind(),
-                         SourceLocation(),
-                         FPOptionsOverride());
-      return IsInvertible(S, LValue, &Sum);
+      // Sum is allocated in the ASTContext rather than on the stack, since
+      // expression comparisons may be cached by address.
+      BinaryOperator *Sum =
+        BinaryOperator::Create(S.Context, Base, Index,
+                               BinaryOperatorKind::BO_Add,
+                               Base->getType(),
+                               Base->getValueKind(),
+                               Base->getObjectKind(),
+                               SourceLocation(),
+                               FPOptionsOverride());
+      return IsInvertible(S, LValue, Sum);
     }
   }
 
@@ -721,14 +856,17 @@ Expr *InverseUtil::UnaryOperatorInverse(Sema &S, Expr *LValue, Expr *F,
     else if (ArraySubscriptExpr *ArraySubExpr = dyn_cast<ArraySubscriptExpr>(SubExpr)) {
       Expr *Base = ArraySubExpr->getBase();
       Expr *Index = ArraySubExpr->getIdx();
-      BinaryOperator Sum(S.Context, Base, Index,
-                         BinaryOperatorKind::BO_Add,
-                         Base->getType(),
-                         Base->getValueKind(),
-                         Base->getObjectKind(),
-                         SourceLocation(),
-                         FPOptionsOverride());
-      return Inverse(S, LValue, F, &Sum);
+      // Sum is allocated in the ASTContext rather than on the stack, since
+      // expression comparisons may be cached by address.
+      BinaryOperator *Sum =
+        BinaryOperator::Create(S.Context, Base, Index,
+                               BinaryOperatorKind::BO_Add,
+                               Base->getType(),
+                               Base->getValueKind(),
+                               Base->getObjectKind(),
+                               SourceLocation(),
+                               FPOptionsOverride());
+      return Inverse(S, LValue, F, Sum);
     }
   }
 
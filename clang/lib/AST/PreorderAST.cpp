@@ -492,166 +492,6 @@ bool LeafExprNode::ConstantFold(bool &Error, ASTContext &Ctx) {
   return false;
 }
 
-// TODO: Remove this method after the updated implementation of the bounds
-// widening analysis merges. This method will be replaced by
-// PreorderAST::GetExprIntDiff. See issue
-// https://github.com/microsoft/checkedc-clang/issues/1078.
-bool PreorderAST::GetDerefOffset(Node *UpperNode, Node *DerefNode,
-				 llvm::APSInt &Offset) {
-  // Extract the offset by which a pointer is dereferenced. For the pointer we
-  // compare the dereference expr with the declared upper bound expr. If the
-  // non-integer parts of the two exprs are not equal we say that a valid
-  // offset does not exist and return false. If the non-integer parts of the
-  // two exprs are equal the offset is calculated as:
-  // (integer part of deref expr - integer part of upper bound expr).
-
-  // Since we have already normalized exprs like "*p" to "*(p + 0)" we require
-  // that the root of the preorder AST is a BinaryOperatorNode.
-  auto *B1 = dyn_cast_or_null<BinaryOperatorNode>(UpperNode);
-  auto *B2 = dyn_cast_or_null<BinaryOperatorNode>(DerefNode);
-
-  if (!B1 || !B2)
-    return false;
-
-  // If the opcodes mismatch we cannot have a valid offset.
-  if (B1->Opc != B2->Opc)
-    return false;
-
-  // We have already constant folded the constants. So return false if the
-  // number of children mismatch.
-  if (B1->Children.size() != B2->Children.size())
-    return false;
-
-  // Check if the children are equivalent.
-  for (size_t I = 0; I != B1->Children.size(); ++I) {
-    auto *Child1 = B1->Children[I];
-    auto *Child2 = B2->Children[I];
-
-    if (Child1->Compare(Child2, Lex) == Result::Equal)
-      continue;
-
-    // If the children are not equal we require that they be integer constant
-    // leaf nodes. Otherwise we cannot have a valid offset.
-    auto *L1 = dyn_cast_or_null<LeafExprNode>(Child1);
-    auto *L2 = dyn_cast_or_null<LeafExprNode>(Child2);
-
-    if (!L1 || !L2)
-      return false;
-
-    // Return false if either of the leaf nodes is not an integer constant.
-    Optional<llvm::APSInt> OptUpperOffset =
-                           L1->E->getIntegerConstantExpr(Ctx);
-    if (!OptUpperOffset)
-      return false;
-
-    Optional<llvm::APSInt> OptDerefOffset =
-                           L2->E->getIntegerConstantExpr(Ctx);
-    if (!OptDerefOffset)
-      return false;
-
-    // Offset should always be of the form (ptr + offset). So we check for
-    // addition.
-    // Note: We have already converted (ptr - offset) to (ptr + -offset). So
-    // it is okay to only check for addition.
-    if (B1->Opc != BO_Add)
-      return false;
-
-    // This guards us from a case where the constants were not folded for
-    // some reason. In theory this should never happen. But we are adding this
-    // check just in case.
-    llvm::APSInt Zero(Ctx.getTargetInfo().getIntWidth(), 0);
-    if (llvm::APSInt::compareValues(Offset, Zero) != 0)
-      return false;
-
-    // offset = deref offset - declared upper bound offset.
-    // Return false if we encounter an overflow.
-    bool Overflow;
-    Offset = (*OptDerefOffset).ssub_ov(*OptUpperOffset, Overflow);
-    if (Overflow)
-      return false;
-  }
-
-  return true;
-}
-
-bool PreorderAST::GetExprIntDiff(Node *E1, Node *E2, llvm::APSInt &Offset) {
-  // Get the integer difference between expressions.
-
-  // If E1 and E2 are not comparable, return false.
-  // Else perform E1 - E2, store the integer result in Offset and return true.
-
-  // E1 and E2 are not comparable if their non-integer parts are not equal.
-
-  // Since we have already normalized exprs like "*p" to "*(p + 0)" we require
-  // that the root of the preorder AST is a BinaryOperatorNode.
-  auto *B1 = dyn_cast_or_null<BinaryOperatorNode>(E1);
-  auto *B2 = dyn_cast_or_null<BinaryOperatorNode>(E2);
-
-  if (!B1 || !B2)
-    return false;
-
-  // If the opcodes mismatch we cannot have a valid offset.
-  if (B1->Opc != B2->Opc)
-    return false;
-
-  // Offset should always be of the form (ptr + offset). So we check for
-  // addition.
-  // Note: We have already converted (ptr - offset) to (ptr + -offset). So
-  // it is okay to only check for addition.
-  if (B1->Opc != BO_Add)
-    return false;
-
-  // We have already constant folded the constants. So return false if the
-  // number of children mismatch.
-  if (B1->Children.size() != B2->Children.size())
-      return false;
-
-  llvm::APSInt Zero(Ctx.getTargetInfo().getIntWidth(), 0);
-  // Initialize Offset to 0.
-  Offset = Zero;
-
-  // Check if the children are equivalent.
-  for (size_t I = 0; I != B1->Children.size(); ++I) {
-    auto *Child1 = B1->Children[I];
-    auto *Child2 = B2->Children[I];
-
-    if (Child1->Compare(Child2, Lex) == Result::Equal)
-      continue;
-
-    // If the children are not equal we require that they be integer constant
-    // leaf nodes. Otherwise we cannot have a valid offset.
-    auto *L1 = dyn_cast_or_null<LeafExprNode>(Child1);
-    auto *L2 = dyn_cast_or_null<LeafExprNode>(Child2);
-
-    if (!L1 || !L2)
-      return false;
-
-    // Return false if either of the leaf nodes is not an integer constant.
-    Optional<llvm::APSInt> OptIntegerPart1;
-    if (!(OptIntegerPart1 = L1->E->getIntegerConstantExpr(Ctx)))
-      return false;
-
-    Optional<llvm::APSInt> OptIntegerPart2;
-    if (!(OptIntegerPart2 = L2->E->getIntegerConstantExpr(Ctx)))
-      return false;
-
-    // This guards us from a case where the constants were not folded for
-    // some reason. In theory this should never happen. But we are adding this
-    // check just in case.
-    if (llvm::APSInt::compareValues(Offset, Zero) != 0)
-      return false;
-
-    // Offset = IntegerPart1 - IntegerPart2.
-    // Return false if we encounter an overflow.
-    bool Overflow;
-    Offset = (*OptIntegerPart1).ssub_ov(*OptIntegerPart2, Overflow);
-    if (Overflow)
-      return false;
-  }
-
-  return true;
-}
-
 Result BinaryOperatorNode::Compare(const Node *Other, Lexicographic Lex) const {
   Result KindComparison = CompareKinds(Other);
   if (KindComparison != Result::Equal)
@@ -849,3 +689,125 @@ void ImplicitCastNode::Cleanup() {
   Child->Cleanup();
   delete this;
 }
+
+LinearForm::LinearForm(ASTContext &Ctx, Expr *E) :
+  Ctx(Ctx), AST(Ctx, E), Valid(false) {
+  unsigned IntWidth = Ctx.getTargetInfo().getIntWidth();
+  Constant = llvm::APSInt(IntWidth, /*isUnsigned*/ false);
+
+  AST.Normalize();
+  auto *Root = dyn_cast_or_null<BinaryOperatorNode>(AST.Root);
+  if (AST.GetError() || !Root || Root->Opc != BO_Add)
+    return;
+
+  // The children of the root are the terms of the expression, at most one of
+  // which is an integer constant since the root has been constant folded.  A
+  // product of factors and an integer constant has that constant as its
+  // coefficient.
+  for (Node *Child : Root->Children) {
+    if (auto *L = dyn_cast<LeafExprNode>(Child)) {
+      if (Optional<llvm::APSInt> OptVal = L->E->getIntegerConstantExpr(Ctx)) {
+        llvm::APSInt Val = *OptVal;
+        bool Overflow;
+        if (!ToIntWidth(Val))
+          return;
+        Constant = Constant.sadd_ov(Val, Overflow);
+        if (Overflow)
+          return;
+        continue;
+      }
+    }
+
+    llvm::APSInt Coefficient(IntWidth, /*isUnsigned*/ false);
+    Coefficient = 1;
+    llvm::ArrayRef<Node *> Factors(Child);
+    auto *B = dyn_cast<BinaryOperatorNode>(Child);
+    if (B && B->Opc == BO_Mul && B->Children.size() > 1) {
+      if (auto *L = dyn_cast<LeafExprNode>(B->Children.back())) {
+        if (Optional<llvm::APSInt> OptVal =
+              L->E->getIntegerConstantExpr(Ctx)) {
+          Coefficient = *OptVal;
+          if (!ToIntWidth(Coefficient))
+            return;
+          Factors = llvm::makeArrayRef(B->Children).drop_back();
+        }
+      }
+    }
+
+    if (!AddTerm(Factors, Coefficient))
+      return;
+  }
+
+  // Terms whose coefficients add up to 0 cancel out.
+  Terms.erase(std::remove_if(Terms.begin(), Terms.end(),
+                             [](const Term &T) {
+                               return T.Coefficient.isNullValue();
+                             }),
+              Terms.end());
+  Valid = true;
+}
+
+bool LinearForm::ToIntWidth(llvm::APSInt &V) const {
+  unsigned IntWidth = Ctx.getTargetInfo().getIntWidth();
+  if (V.getBitWidth() == IntWidth && !V.isUnsigned())
+    return true;
+  llvm::APSInt Res = V.extOrTrunc(IntWidth);
+  Res.setIsSigned(true);
+  if (llvm::APSInt::compareValues(Res, V) != 0)
+    return false;
+  V = Res;
+  return true;
+}
+
+int LinearForm::FindTerm(llvm::ArrayRef<const Node *> Factors) const {
+  for (size_t I = 0; I != Terms.size(); ++I) {
+    const Term &T = Terms[I];
+    if (T.Factors.size() != Factors.size())
+      continue;
+    bool Equal = true;
+    for (size_t J = 0; Equal && J != Factors.size(); ++J)
+      Equal = T.Factors[J]->Compare(Factors[J], AST.Lex) == Result::Equal;
+    if (Equal)
+      return I;
+  }
+  return -1;
+}
+
+bool LinearForm::AddTerm(llvm::ArrayRef<Node *> Factors,
+                         llvm::APSInt Coefficient) {
+  llvm::SmallVector<const Node *, 1> ConstFactors(Factors.begin(),
+                                                  Factors.end());
+  int I = FindTerm(ConstFactors);
+  if (I < 0) {
+    Terms.push_back({std::move(ConstFactors), Coefficient});
+    return true;
+  }
+
+  bool Overflow;
+  Terms[I].Coefficient = Terms[I].Coefficient.sadd_ov(Coefficient, Overflow);
+  return !Overflow;
+}
+
+bool LinearForm::GetIntDiff(const LinearForm &Other,
+                            llvm::APSInt &Offset) const {
+  if (!Valid || !Other.Valid)
+    return false;
+
+  // The terms of a linear form are distinct, so the two linear forms have
+  // the same terms if each term of this is a term of Other.
+  if (Terms.size() != Other.Terms.size())
+    return false;
+  for (const Term &T : Terms) {
+    int I = Other.FindTerm(T.Factors);
+    if (I < 0 ||
+        llvm::APSInt::compareValues(T.Coefficient,
+                                    Other.Terms[I].Coefficient) != 0)
+      return false;
+  }
+
+  // Offset = Constant - Other.Constant.
+  // Return false if we encounter an overflow.
+  bool Overflow;
+  Offset = Constant.ssub_ov(Other.Constant, Overflow);
+  return !Overflow;
+}
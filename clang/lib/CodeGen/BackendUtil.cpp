@@ -76,6 +76,7 @@
 #include "llvm/Transforms/Instrumentation/ThreadSanitizer.h"
 #include "llvm/Transforms/ObjCARC.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Scalar/CheckedCBoundsCheckOpt.h"
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "llvm/Transforms/Scalar/LowerMatrixIntrinsics.h"
 #include "llvm/Transforms/Utils.h"
@@ -209,6 +210,16 @@ static void addAddDiscriminatorsPass(const PassManagerBuilder &Builder,
   PM.add(createAddDiscriminatorsPass());
 }
 
+static void addCheckedCBoundsCheckOptPass(const PassManagerBuilder &Builder,
+                                          legacy::PassManagerBase &PM) {
+  PM.add(createCheckedCBoundsCheckOptPass());
+}
+
+static void addCheckedCIPBoundsCheckOptPass(const PassManagerBuilder &Builder,
+                                            legacy::PassManagerBase &PM) {
+  PM.add(createCheckedCIPBoundsCheckOptPass());
+}
+
 static void addBoundsCheckingPass(const PassManagerBuilder &Builder,
                                   legacy::PassManagerBase &PM) {
   PM.add(createBoundsCheckingLegacyPass());
@@ -709,6 +720,13 @@ void EmitAssemblyHelper::CreatePasses(legacy::PassManager &MPM,
                            addMemProfilerPasses);
   }
 
+  if (LangOpts.CheckedC && CodeGenOpts.CheckedCHoistBoundsChecks) {
+    PMBuilder.addExtension(PassManagerBuilder::EP_ScalarOptimizerLate,
+                           addCheckedCBoundsCheckOptPass);
+    PMBuilder.addExtension(PassManagerBuilder::EP_OptimizerLast,
+                           addCheckedCIPBoundsCheckOptPass);
+  }
+
   if (LangOpts.Sanitize.has(SanitizerKind::LocalBounds)) {
     PMBuilder.addExtension(PassManagerBuilder::EP_ScalarOptimizerLate,
                            addBoundsCheckingPass);
@@ -1241,6 +1259,17 @@ void EmitAssemblyHelper::EmitAssemblyWithNewPassManager(
           });
     }
 
+    if (LangOpts.CheckedC && CodeGenOpts.CheckedCHoistBoundsChecks) {
+      PB.registerScalarOptimizerLateEPCallback(
+          [](FunctionPassManager &FPM, PassBuilder::OptimizationLevel Level) {
+            FPM.addPass(CheckedCBoundsCheckOptPass());
+          });
+      PB.registerOptimizerLastEPCallback(
+          [](ModulePassManager &MPM, PassBuilder::OptimizationLevel Level) {
+            MPM.addPass(CheckedCIPBoundsCheckOptPass());
+          });
+    }
+
     // Register callbacks to schedule sanitizer passes at the appropriate part
     // of the pipeline.
     if (LangOpts.Sanitize.has(SanitizerKind::LocalBounds))
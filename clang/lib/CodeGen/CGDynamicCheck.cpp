@@ -13,7 +13,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "CodeGenFunction.h"
+#include "clang/AST/CanonBounds.h"
+#include "clang/Basic/DiagnosticFrontend.h"
+#include "clang/Basic/SourceManager.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/InlineCost.h"
+#include "llvm/Transforms/Scalar/CheckedCBoundsCheckOpt.h"
 
 using namespace clang;
 using namespace CodeGen;
@@ -23,7 +28,8 @@ using namespace llvm;
 
 namespace {
   STATISTIC(NumDynamicChecksElided,
-              "The # of dynamic checks elided (due to constant folding)");
+              "The # of dynamic checks elided (due to constant folding or "
+              "static proofs)");
   STATISTIC(NumDynamicChecksInserted,
               "The # of dynamic checks inserted");
   STATISTIC(NumDynamicChecksExplicit,
@@ -34,8 +40,242 @@ namespace {
               "The # of dynamic overflow checks found");
   STATISTIC(NumDynamicChecksRange,
               "The # of dynamic bounds checks found");
+  STATISTIC(NumDynamicChecksUnchecked,
+              "The # of dynamic bounds checks of unchecked pointers found "
+              "(with -funchecked-pointers-dynamic-check)");
+  STATISTIC(NumDynamicChecksNullTermWrite,
+              "The # of dynamic checks of writes through null-terminated "
+              "pointers found");
   STATISTIC(NumDynamicChecksCast,
               "The # of dynamic cast checks found");
+  STATISTIC(NumDynamicChecksDisabled,
+              "The # of dynamic checks found but not emitted because their "
+              "kind is not enabled by -fcheckedc-checks=");
+  STATISTIC(NumDynamicChecksFused,
+              "The # of dynamic bounds and cast checks emitted as a single "
+              "unsigned compare");
+  STATISTIC(NumDynamicChecksAssumed,
+              "The # of elided dynamic bounds checks emitted as assumptions");
+  STATISTIC(NumDynamicChecksUpperOnly,
+              "The # of dynamic bounds checks emitted without their lower "
+              "bound comparison (due to static proofs)");
+  STATISTIC(NumDynamicChecksNullTermFolded,
+              "The # of dynamic checks of writes through null-terminated "
+              "pointers whose value is a constant");
+  STATISTIC(NumDynamicChecksNonNullFused,
+              "The # of dynamic non-null checks combined with a bounds check");
+  STATISTIC(NumDynamicChecksNonNullPropagated,
+              "The # of dynamic non-null checks of pointer arithmetic emitted "
+              "as a select of a null result");
+  STATISTIC(NumDynamicChecksCastReused,
+              "The # of dynamic cast checks left out because an identical "
+              "check dominates them");
+}
+
+// Why a dynamic check was left out, in the order of the %select of
+// remark_checkedc_dynamic_check_elided.
+enum ElidedCheckReason {
+  ECR_ConstantCondition,
+  ECR_ProvedStatically,
+  ECR_Dominated
+};
+
+// Report an inserted or an elided dynamic check of the given kind with
+// -Rcheckedc-dynamic-checks.
+static void remarkCheckInserted(CodeGenModule &CGM, SourceLocation Loc,
+                                StringRef Kind) {
+  CGM.getDiags().Report(Loc, diag::remark_checkedc_dynamic_check_inserted)
+      << Kind;
+}
+
+static void remarkCheckElided(CodeGenModule &CGM, SourceLocation Loc,
+                              StringRef Kind, ElidedCheckReason Reason) {
+  CGM.getDiags().Report(Loc, diag::remark_checkedc_dynamic_check_elided)
+      << Kind << Reason;
+}
+
+// If the upper bound of R is its lower bound plus a count that is known not
+// to be negative, which is how count bounds are expanded to ranges, return
+// the count and set ElemSize to the size of the elements that it counts.
+static const Expr *getNonNegativeRangeCount(ASTContext &Ctx,
+                                            const RangeBoundsExpr *R,
+                                            CharUnits &ElemSize) {
+  const auto *Add =
+      dyn_cast<clang::BinaryOperator>(R->getUpperExpr()->IgnoreParens());
+  if (!Add || Add->getOpcode() != BO_Add ||
+      !Add->getType()->isPointerType())
+    return nullptr;
+
+  const Expr *Count = Add->getRHS();
+  if (!Count->getType()->isIntegerType())
+    return nullptr;
+
+  if (Lexicographic(Ctx, nullptr).CompareExpr(Add->getLHS(),
+                                              R->getLowerExpr()) !=
+      Lexicographic::Result::Equal)
+    return nullptr;
+
+  QualType ElemTy = Add->getType()->getPointeeType();
+  if (ElemTy->isIncompleteType() || !ElemTy->isConstantSizeType())
+    return nullptr;
+
+  if (!Count->getType()->isUnsignedIntegerOrEnumerationType()) {
+    Expr::EvalResult Result;
+    if (!Count->EvaluateAsInt(Result, Ctx) || Result.Val.getInt().isNegative())
+      return nullptr;
+  }
+
+  ElemSize = Ctx.getTypeSizeInChars(ElemTy);
+  return Count;
+}
+
+// Return true if the range of CastRange is known to be within the range of
+// SubRange because their bounds differ by constants, as for
+// bounds(p + 1, p + 3) and bounds(p, p + 4). The constant differences are
+// in numbers of elements, so only bounds of the same type are compared.
+static bool isCastRangeSubsumed(ASTContext &Ctx,
+                                const RangeBoundsExpr *SubRange,
+                                const RangeBoundsExpr *CastRange) {
+  Lexicographic Lex(Ctx, nullptr);
+  auto IsAtLeast = [&](const Expr *E1, const Expr *E2) {
+    llvm::APSInt Offset;
+    return Ctx.hasSameType(E1->getType(), E2->getType()) &&
+           Lex.GetExprIntDiff(E1, E2, Offset) && !Offset.isNegative();
+  };
+  return IsAtLeast(CastRange->getLowerExpr(), SubRange->getLowerExpr()) &&
+         IsAtLeast(SubRange->getUpperExpr(), CastRange->getUpperExpr());
+}
+
+// Emit the size in bytes of a range whose upper bound is its lower bound plus
+// Count elements of size ElemSize.
+static Value *emitRangeSize(CodeGenFunction &CGF, const Expr *Count,
+                            CharUnits ElemSize) {
+  Value *Size = CGF.EmitScalarExpr(Count);
+  Size = CGF.Builder.CreateIntCast(
+      Size, CGF.IntPtrTy, Count->getType()->isSignedIntegerOrEnumerationType(),
+      "_Dynamic_check.count");
+  if (!ElemSize.isOne())
+    Size = CGF.Builder.CreateMul(
+        Size, llvm::ConstantInt::get(CGF.IntPtrTy, ElemSize.getQuantity()),
+        "_Dynamic_check.size");
+  return Size;
+}
+
+//
+// Reuse of bounds values across dynamic checks
+//
+
+void CodeGenFunction::resetBoundsValueCache() {
+  BoundsValueCache.clear();
+  BoundsCastCheckCache.clear();
+  BoundsValueCacheBlock = Builder.GetInsertBlock();
+  BoundsValueCacheHasLast =
+      BoundsValueCacheBlock && !BoundsValueCacheBlock->empty();
+  BoundsValueCacheLast =
+      BoundsValueCacheHasLast ? &BoundsValueCacheBlock->back() : nullptr;
+}
+
+void CodeGenFunction::validateBoundsValueCache() {
+  BasicBlock *BB = Builder.GetInsertBlock();
+  if (!BB || BB != BoundsValueCacheBlock ||
+      Builder.GetInsertPoint() != BB->end()) {
+    resetBoundsValueCache();
+    return;
+  }
+
+  BasicBlock::iterator It = BB->begin();
+  if (BoundsValueCacheHasLast) {
+    auto *Last = cast_or_null<Instruction>(BoundsValueCacheLast);
+    if (!Last || Last->getParent() != BB) {
+      resetBoundsValueCache();
+      return;
+    }
+    It = std::next(Last->getIterator());
+  }
+
+  // The bounds of a check may depend on any memory, since variables whose
+  // address is taken can be written through pointers, so any write ends the
+  // reuse of the values emitted so far.
+  for (; It != BB->end(); ++It) {
+    if (It->mayWriteToMemory()) {
+      resetBoundsValueCache();
+      return;
+    }
+  }
+  BoundsValueCacheHasLast = !BB->empty();
+  BoundsValueCacheLast = BoundsValueCacheHasLast ? &BB->back() : nullptr;
+}
+
+void CodeGenFunction::continueBoundsValueCache(BasicBlock *Succeeded) {
+  if (!CGM.getCodeGenOpts().CheckedCReuseBoundsValues)
+    return;
+  validateBoundsValueCache();
+  // The block of the check dominates the block it branches to on success,
+  // so the values stay usable there.
+  BoundsValueCacheBlock = Succeeded;
+  BoundsValueCacheHasLast = false;
+  BoundsValueCacheLast = nullptr;
+}
+
+void CodeGenFunction::markCheckedCGuardedPointer(Address PtrAddr) {
+  if (!CGM.getCodeGenOpts().CheckedCSanitizeUncheckedOnly ||
+      !SanOpts.hasOneOf(SanitizerKind::Address | SanitizerKind::KernelAddress |
+                        SanitizerKind::HWAddress |
+                        SanitizerKind::KernelHWAddress))
+    return;
+  Value *Ptr = PtrAddr.getPointer();
+  CheckedCGuardedPointers[Ptr] = Ptr;
+}
+
+void CodeGenFunction::skipSanitizerForCheckedCAccess(llvm::Instruction *I,
+                                                     Address Addr) {
+  if (CheckedCGuardedPointers.empty())
+    return;
+  Value *Ptr = Addr.getPointer();
+  auto It = CheckedCGuardedPointers.find(Ptr);
+  if (It == CheckedCGuardedPointers.end() || It->second != Ptr)
+    return;
+  // The sanitizers skip the instructions that are marked with nosanitize
+  // metadata.
+  CGM.getSanitizerMetadata()->disableSanitizerForInstruction(I);
+}
+
+Address CodeGenFunction::EmitBoundsPointer(const Expr *E) {
+  if (!CGM.getCodeGenOpts().CheckedCReuseBoundsValues)
+    return EmitPointerWithAlignment(E);
+
+  validateBoundsValueCache();
+  for (const CachedBoundsValue &Entry : BoundsValueCache) {
+    if (Entry.Scale.isZero() && Entry.Value &&
+        Lexicographic(getContext(), nullptr).CompareExpr(E, Entry.E) ==
+            Lexicographic::Result::Equal)
+      return Address(Entry.Value, Entry.Alignment);
+  }
+
+  Address Result = EmitPointerWithAlignment(E);
+  validateBoundsValueCache();
+  BoundsValueCache.push_back(
+      {E, Result.getPointer(), Result.getAlignment(), CharUnits::Zero()});
+  return Result;
+}
+
+Value *CodeGenFunction::EmitBoundsRangeSize(const Expr *Count,
+                                            CharUnits ElemSize) {
+  if (!CGM.getCodeGenOpts().CheckedCReuseBoundsValues)
+    return emitRangeSize(*this, Count, ElemSize);
+
+  validateBoundsValueCache();
+  for (const CachedBoundsValue &Entry : BoundsValueCache) {
+    if (Entry.Scale == ElemSize && Entry.Value &&
+        Lexicographic(getContext(), nullptr).CompareExpr(Count, Entry.E) ==
+            Lexicographic::Result::Equal)
+      return Entry.Value;
+  }
+
+  Value *Size = emitRangeSize(*this, Count, ElemSize);
+  validateBoundsValueCache();
+  BoundsValueCache.push_back({Count, Size, CharUnits::One(), ElemSize});
+  return Size;
 }
 
 //
@@ -48,15 +288,43 @@ void CodeGenFunction::EmitExplicitDynamicCheck(const Expr *Condition) {
 
   ++NumDynamicChecksExplicit;
 
+  // Like an assert with NDEBUG, a disabled check only keeps the side effects
+  // of its condition.
+  if (!isCheckKindEnabled(CodeGenOptions::CheckedCCheckExplicit)) {
+    ++NumDynamicChecksDisabled;
+    if (Condition->HasSideEffects(getContext()))
+      EmitIgnoredExpr(Condition);
+    return;
+  }
+
+  // A condition that the constant evaluator can decide to be true needs no
+  // check. IRBuilder folds operations on constants, but not the loads that
+  // are emitted for reads of string literals or compound literals, which the
+  // constant evaluator can see through.  A condition with side effects is
+  // not folded, so it is still evaluated.
+  bool ConditionConstant;
+  if (ConstantFoldsToSimpleInteger(Condition, ConditionConstant) &&
+      ConditionConstant) {
+    ++NumDynamicChecksElided;
+    remarkCheckElided(CGM, Condition->getExprLoc(), "explicit",
+                      ECR_ConstantCondition);
+    return;
+  }
+
   // Emit Check
   Value *ConditionVal = EvaluateExprAsBool(Condition);
-  EmitDynamicCheckBlocks(ConditionVal);
+  EmitDynamicCheckBlocks(ConditionVal, Condition->getExprLoc(), "explicit");
 }
 
 //
 // General Functions for inserting dynamic checks
 //
 
+bool CodeGenFunction::isCheckKindEnabled(
+    CodeGenOptions::CheckedCCheckKind Kind) const {
+  return CGM.getCodeGenOpts().CheckedCEnabledChecks & Kind;
+}
+
 static bool shouldEmitNonNullCheck(const CodeGenModule &CGM,
                                    const QualType BaseTy) {
   if (!CGM.getLangOpts().CheckedC)
@@ -69,45 +337,91 @@ static bool shouldEmitNonNullCheck(const CodeGenModule &CGM,
 }
 
 void CodeGenFunction::EmitDynamicNonNullCheck(const Address BaseAddr,
-                                              const QualType BaseTy) {
+                                              const QualType BaseTy,
+                                              SourceLocation Loc) {
   if (!shouldEmitNonNullCheck(CGM, BaseTy))
     return;
 
   ++NumDynamicChecksNonNull;
+  if (!isCheckKindEnabled(CodeGenOptions::CheckedCCheckNonNull)) {
+    ++NumDynamicChecksDisabled;
+    return;
+  }
 
   Value *ConditionVal = Builder.CreateIsNotNull(BaseAddr.getPointer(),
                                                 "_Dynamic_check.non_null");
-  EmitDynamicCheckBlocks(ConditionVal);
+  EmitDynamicCheckBlocks(ConditionVal, Loc, "non-null");
 }
 
 void CodeGenFunction::EmitDynamicNonNullCheck(Value *Val,
-                                              const QualType BaseTy) {
+                                              const QualType BaseTy,
+                                              SourceLocation Loc) {
   if (!shouldEmitNonNullCheck(CGM, BaseTy))
     return;
 
   ++NumDynamicChecksNonNull;
+  if (!isCheckKindEnabled(CodeGenOptions::CheckedCCheckNonNull)) {
+    ++NumDynamicChecksDisabled;
+    return;
+  }
 
   Value *ConditionVal = Builder.CreateIsNotNull(Val,
                                                 "_Dynamic_check.non_null");
-  EmitDynamicCheckBlocks(ConditionVal);
+  EmitDynamicCheckBlocks(ConditionVal, Loc, "non-null");
+}
+
+Value *CodeGenFunction::EmitDynamicNonNullArith(Value *Base, Value *Result,
+                                                const QualType BaseTy) {
+  if (!shouldEmitNonNullCheck(CGM, BaseTy))
+    return Result;
+
+  ++NumDynamicChecksNonNull;
+  if (!isCheckKindEnabled(CodeGenOptions::CheckedCCheckNonNull)) {
+    ++NumDynamicChecksDisabled;
+    return Result;
+  }
+
+  // Arithmetic on a null pointer gives a null pointer, so any dereference of
+  // the result fails its own non-null check. The select has no branch, and
+  // the optimizer removes it when it knows that Base is not null.
+  ++NumDynamicChecksNonNullPropagated;
+  Value *IsNull = Builder.CreateIsNull(Base, "_Dynamic_check.null_arith");
+  return Builder.CreateSelect(IsNull,
+                              llvm::Constant::getNullValue(Result->getType()),
+                              Result, "_Dynamic_check.arith");
 }
 
-// TODO: This is currently unused. It may never be used.
-void CodeGenFunction::EmitDynamicOverflowCheck(const Address BaseAddr,
+void CodeGenFunction::EmitDynamicOverflowCheck(Value *Base, Value *Overflows,
                                                const QualType BaseTy,
-                                               const Address PtrAddr) {
+                                               SourceLocation Loc) {
   if (!getLangOpts().CheckedC)
     return;
 
   ++NumDynamicChecksOverflow;
 
-  // EmitDynamicCheckBlocks(Condition);
+  Value *ConditionVal =
+      Builder.CreateNot(Overflows, "_Dynamic_check.no_overflow");
+  // Both checks of the arithmetic share a single branch.
+  if (CGM.getCodeGenOpts().CheckedCNullPtrArith &&
+      shouldEmitNonNullCheck(CGM, BaseTy) &&
+      isCheckKindEnabled(CodeGenOptions::CheckedCCheckNonNull)) {
+    ++NumDynamicChecksNonNull;
+    Value *NonNull = Builder.CreateIsNotNull(Base, "_Dynamic_check.non_null");
+    ConditionVal = Builder.CreateAnd(NonNull, ConditionVal,
+                                     "_Dynamic_check.pointer_arith");
+  }
+  EmitDynamicCheckBlocks(ConditionVal, Loc, "pointer arithmetic");
 }
 
 void CodeGenFunction::EmitDynamicBoundsCheck(const Address PtrAddr,
                                              const BoundsExpr *Bounds,
                                              BoundsCheckKind CheckKind,
-                                             llvm::Value *Val) {
+                                             llvm::Value *Val,
+                                             SourceLocation Loc,
+                                             bool ProvenSafe,
+                                             bool LowerProven,
+                                             Value *NonNullCheck,
+                                             bool UncheckedPtr) {
   if (!getLangOpts().CheckedC)
     return;
 
@@ -132,18 +446,120 @@ void CodeGenFunction::EmitDynamicBoundsCheck(const Address PtrAddr,
   const RangeBoundsExpr *BoundsRange = dyn_cast<RangeBoundsExpr>(Bounds);
 
   ++NumDynamicChecksRange;
+  if (UncheckedPtr)
+    ++NumDynamicChecksUnchecked;
+  if (CheckKind == BCK_NullTermWriteAssign)
+    ++NumDynamicChecksNullTermWrite;
+  if (!isCheckKindEnabled(CheckKind == BCK_NullTermWriteAssign
+                              ? CodeGenOptions::CheckedCCheckNullTermWrite
+                              : CodeGenOptions::CheckedCCheckRange)) {
+    ++NumDynamicChecksDisabled;
+    return;
+  }
+
+  // From here on the access is either proved to be in bounds or checked.
+  markCheckedCGuardedPointer(PtrAddr);
+
+  StringRef Kind = CheckKind == BCK_NullTermWriteAssign
+                       ? "null-terminated write"
+                       : "bounds";
+  if (ProvenSafe) {
+    ++NumDynamicChecksElided;
+    remarkCheckElided(CGM, Loc, Kind, ECR_ProvedStatically);
+    // Tell the optimizer what was proved, which can make it easier to remove
+    // other checks and to analyze the loops around the access. The check
+    // for a write through a null-terminated pointer may also succeed for a
+    // pointer at the upper bound, so there is no single range to assume.
+    if (CGM.getCodeGenOpts().CheckedCAssumeProvenBounds &&
+        CheckKind != BCK_NullTermWriteAssign) {
+      ++NumDynamicChecksAssumed;
+      Address Lower = EmitBoundsPointer(BoundsRange->getLowerExpr());
+      Address Upper = EmitBoundsPointer(BoundsRange->getUpperExpr());
+      Value *Ptr = PtrAddr.getPointer();
+      Value *LowerPtr = Builder.CreateBitCast(Lower.getPointer(),
+                                              Ptr->getType());
+      Value *UpperPtr = Builder.CreateBitCast(Upper.getPointer(),
+                                              Ptr->getType());
+      Value *LowerChk =
+          Builder.CreateICmpULE(LowerPtr, Ptr, "_Dynamic_check.lower");
+      Value *UpperChk =
+          CheckKind != BCK_NullTermRead
+              ? Builder.CreateICmpULT(Ptr, UpperPtr, "_Dynamic_check.upper")
+              : Builder.CreateICmpULE(Ptr, UpperPtr, "_Dynamic_check.upper");
+      Value *Condition =
+          Builder.CreateAnd(LowerChk, UpperChk, "_Dynamic_check.range");
+      if (!isa<ConstantInt>(Condition))
+        Builder.CreateAssumption(Condition);
+    }
+    return;
+  }
+
+  // When the range is lower + count, as for count bounds, the check
+  // lower <= ptr < upper becomes the single unsigned compare
+  // ptr - lower < count * size, which also wraps around for ptr < lower.
+  // The check for a write through a null-terminated pointer needs the lower
+  // check on its own, and the bounds check optimizations only recognize
+  // checks with two compares, so neither is fused.
+  CharUnits ElemSize;
+  const Expr *Count = nullptr;
+  if (CheckKind != BCK_NullTermWriteAssign &&
+      !CGM.getCodeGenOpts().CheckedCHoistBoundsChecks)
+    Count = getNonNegativeRangeCount(getContext(), BoundsRange, ElemSize);
+
+  // A lower bound comparison that was proved to succeed is left out, unless
+  // the check may be hoisted out of a loop, which needs both comparisons.
+  if (CheckKind == BCK_NullTermWriteAssign ||
+      CGM.getCodeGenOpts().CheckedCHoistBoundsChecks)
+    LowerProven = false;
 
   // Emit the code to generate the pointer values
-  Address Lower = EmitPointerWithAlignment(BoundsRange->getLowerExpr());
+  Address Lower = Address::invalid();
+  if (Count || !LowerProven) {
+    Lower = EmitBoundsPointer(BoundsRange->getLowerExpr());
+
+    // We don't infer an expression with the correct cast for
+    // multidimensional array access, but icmp requires that
+    // its operands are of the same type, so we bitcast Lower to
+    // match the type of PtrAddr at the LLVM IR Level.
+    if (Lower.getType() != PtrAddr.getType())
+      Lower = Builder.CreateBitCast(Lower, PtrAddr.getType());
+  }
 
-  // We don't infer an expression with the correct cast for
-  // multidimensional array access, but icmp requires that
-  // its operands are of the same type, so we bitcast Lower to
-  // match the type of PtrAddr at the LLVM IR Level.
-  if (Lower.getType() != PtrAddr.getType())
-    Lower = Builder.CreateBitCast(Lower, PtrAddr.getType());
+  if (Count) {
+    ++NumDynamicChecksFused;
+    Value *Offset = Builder.CreateSub(
+        Builder.CreatePtrToInt(PtrAddr.getPointer(), IntPtrTy),
+        Builder.CreatePtrToInt(Lower.getPointer(), IntPtrTy),
+        "_Dynamic_check.offset");
+    Value *Size = EmitBoundsRangeSize(Count, ElemSize);
+    // For reads of null-terminated pointers, we allow the element exactly
+    // at the upper bound to be read.
+    Value *Condition =
+        CheckKind != BCK_NullTermRead
+            ? Builder.CreateICmpULT(Offset, Size, "_Dynamic_check.range")
+            : Builder.CreateICmpULE(Offset, Size, "_Dynamic_check.range");
+    if (NonNullCheck)
+      Condition = Builder.CreateAnd(NonNullCheck, Condition,
+                                    "_Dynamic_check.non_null_range");
+    if (const auto *ConditionConstant = dyn_cast<ConstantInt>(Condition)) {
+      if (ConditionConstant->isOne()) {
+        remarkCheckElided(CGM, Loc, Kind, ECR_ConstantCondition);
+        return;
+      }
+    }
+    remarkCheckInserted(CGM, Loc, Kind);
+    DynamicCheckSite Site = EmitDynamicCheckSite(Loc, "bounds");
+    BasicBlock *DyCkSuccess = createBasicBlock("_Dynamic_check.succeeded");
+    BasicBlock *DyCkFailure = EmitDynamicCheckFailedBlock(Site, DyCkSuccess);
+    EmitDynamicCheckBranch(Condition, DyCkSuccess, DyCkFailure);
+    continueBoundsValueCache(DyCkSuccess);
+    // This ensures the success block comes directly after the branch
+    EmitBlock(DyCkSuccess);
+    Builder.SetInsertPoint(DyCkSuccess);
+    return;
+  }
 
-  Address Upper = EmitPointerWithAlignment(BoundsRange->getUpperExpr());
+  Address Upper = EmitBoundsPointer(BoundsRange->getUpperExpr());
 
   // As above, we may need to bitcast Upper to match the type
   // of PtrAddr at the LLVM IR Level.
@@ -151,8 +567,25 @@ void CodeGenFunction::EmitDynamicBoundsCheck(const Address PtrAddr,
     Upper = Builder.CreateBitCast(Upper, PtrAddr.getType());
 
   // Make the lower check
-  Value *LowerChk = Builder.CreateICmpULE(
-      Lower.getPointer(), PtrAddr.getPointer(), "_Dynamic_check.lower");
+  Value *LowerChk = nullptr;
+  if (!LowerProven)
+    LowerChk = Builder.CreateICmpULE(
+        Lower.getPointer(), PtrAddr.getPointer(), "_Dynamic_check.lower");
+
+  // A write through a null-terminated pointer may also store a zero exactly
+  // at the upper bound. If the value written is a constant, that case is
+  // known now: a zero may be written anywhere up to the upper bound, and a
+  // non-zero value needs a plain range check. Otherwise, when optimizing,
+  // the whole condition is emitted without the branch to the additional
+  // check.
+  bool NullTermWriteInline = false;
+  if (CheckKind == BCK_NullTermWriteAssign) {
+    if (const auto *ConstVal = dyn_cast<llvm::Constant>(Val)) {
+      CheckKind = ConstVal->isNullValue() ? BCK_NullTermRead : BCK_Normal;
+      ++NumDynamicChecksNullTermFolded;
+    } else if (CGM.getCodeGenOpts().OptimizationLevel > 0)
+      NullTermWriteInline = true;
+  }
 
   // Make the upper check
   Value *UpperChk;
@@ -165,29 +598,115 @@ void CodeGenFunction::EmitDynamicBoundsCheck(const Address PtrAddr,
     // at the upper bound to be read.
     UpperChk = Builder.CreateICmpULE(PtrAddr.getPointer(), Upper.getPointer(),
                                      "_Dynamic_check.upper");
+  if (NullTermWriteInline) {
+    Value *AtUpper = Builder.CreateICmpEQ(
+        PtrAddr.getPointer(), Upper.getPointer(), "_Dynamic_check.at_upper");
+    Value *IsZero = Builder.CreateIsNull(Val, "_Dynamic_check.write_nul");
+    UpperChk = Builder.CreateSelect(
+        UpperChk, Builder.getTrue(),
+        Builder.CreateAnd(AtUpper, IsZero, "_Dynamic_check.nt_upper_bound"),
+        "_Dynamic_check.allowed_write");
+    CheckKind = BCK_Normal;
+  }
   llvm::Value *Condition =
-    Builder.CreateAnd(LowerChk, UpperChk, "_Dynamic_check.range");
+    LowerProven ? UpperChk
+                : Builder.CreateAnd(LowerChk, UpperChk, "_Dynamic_check.range");
+  if (LowerProven)
+    ++NumDynamicChecksUpperOnly;
+  if (NonNullCheck)
+    Condition = Builder.CreateAnd(NonNullCheck, Condition,
+                                  "_Dynamic_check.non_null_range");
+  // A write through a null-terminated pointer whose value is known is checked
+  // as a read or an ordinary access.
+  Kind = CheckKind == BCK_NullTermWriteAssign ? "null-terminated write"
+                                              : "bounds";
   if (const ConstantInt *ConditionConstant = dyn_cast<ConstantInt>(Condition)) {
-    if (ConditionConstant->isOne())
+    if (ConditionConstant->isOne()) {
+      remarkCheckElided(CGM, Loc, Kind, ECR_ConstantCondition);
       return;
+    }
   }
+  remarkCheckInserted(CGM, Loc, Kind);
+  DynamicCheckSite Site = EmitDynamicCheckSite(Loc, Kind);
   BasicBlock *DyCkSuccess = createBasicBlock("_Dynamic_check.succeeded");
   BasicBlock *DyCkFailure;
   if (CheckKind == BCK_NullTermWriteAssign)
     DyCkFailure = EmitNulltermWriteAdditionalCheck(PtrAddr, Upper, LowerChk,
-                                                   Val, DyCkSuccess);
+                                                   Val, DyCkSuccess, Site);
   else
-    DyCkFailure = EmitDynamicCheckFailedBlock();
-  Builder.CreateCondBr(Condition, DyCkSuccess, DyCkFailure);
+    DyCkFailure = EmitDynamicCheckFailedBlock(Site, DyCkSuccess);
+  BranchInst *Br = EmitDynamicCheckBranch(Condition, DyCkSuccess, DyCkFailure);
+
+  // Mark the range check so that the optimizer can hoist it out of loops.
+  // The check for a write through a null-terminated pointer has a second
+  // chance to succeed, so it is not a plain range check. A check of an
+  // unchecked pointer is marked as such, so that the optimizer can count it
+  // separately.
+  if (CGM.getCodeGenOpts().CheckedCHoistBoundsChecks &&
+      CheckKind != BCK_NullTermWriteAssign) {
+    llvm::LLVMContext &Ctx = getLLVMContext();
+    llvm::MDNode *MD =
+        UncheckedPtr
+            ? llvm::MDNode::get(
+                  Ctx, llvm::MDString::get(Ctx, CheckedCUncheckedPointerMDKind))
+            : llvm::MDNode::get(Ctx, None);
+    Br->setMetadata(CheckedCBoundsCheckMDName, MD);
+  }
+  // The check for a write through a null-terminated pointer reaches the
+  // success block through its additional check as well.
+  if (CheckKind != BCK_NullTermWriteAssign)
+    continueBoundsValueCache(DyCkSuccess);
   // This ensures the success block comes directly after the branch
   EmitBlock(DyCkSuccess);
   Builder.SetInsertPoint(DyCkSuccess);
 }
 
+void CodeGenFunction::EmitDynamicNonNullAndBoundsCheck(
+    const Address BaseAddr, const QualType BaseTy, const Address PtrAddr,
+    const BoundsExpr *Bounds, BoundsCheckKind CheckKind, SourceLocation Loc,
+    bool ProvenSafe, bool LowerProven) {
+  // With -funchecked-pointers-dynamic-check, accesses through unchecked
+  // pointers have bounds checks too.
+  bool UncheckedPtr = !BaseTy->isCheckedPointerType() &&
+                      !BaseTy->isCheckedArrayType();
+
+  // The non-null check is folded only into an ordinary range check. The
+  // check for a write through a null-terminated pointer has a second chance
+  // to succeed, and the bounds check optimizations only recognize range
+  // checks on their own. A failure of the combined check is reported as a
+  // bounds check failure.
+  bool Fuse = CGM.getCodeGenOpts().CheckedCFuseNullChecks &&
+              !CGM.getCodeGenOpts().CheckedCHoistBoundsChecks &&
+              shouldEmitNonNullCheck(CGM, BaseTy) &&
+              isCheckKindEnabled(CodeGenOptions::CheckedCCheckNonNull) &&
+              isCheckKindEnabled(CodeGenOptions::CheckedCCheckRange) &&
+              !ProvenSafe && Bounds &&
+              isa<RangeBoundsExpr>(Bounds) && !Bounds->isInvalid() &&
+              CheckKind != BCK_NullTermWriteAssign;
+  if (!Fuse) {
+    EmitDynamicNonNullCheck(BaseAddr, BaseTy, Loc);
+    EmitDynamicBoundsCheck(PtrAddr, Bounds, CheckKind, nullptr, Loc,
+                           ProvenSafe, LowerProven, /*NonNullCheck=*/nullptr,
+                           UncheckedPtr);
+    return;
+  }
+
+  ++NumDynamicChecksNonNull;
+  ++NumDynamicChecksNonNullFused;
+
+  Value *NonNullCheck = Builder.CreateIsNotNull(BaseAddr.getPointer(),
+                                                "_Dynamic_check.non_null");
+  EmitDynamicBoundsCheck(PtrAddr, Bounds, CheckKind, nullptr, Loc,
+                         /*ProvenSafe=*/false, LowerProven, NonNullCheck,
+                         UncheckedPtr);
+}
+
 void
 CodeGenFunction::EmitDynamicBoundsCastCheck(const Address BaseAddr,
                                             const BoundsExpr *CastBounds,
-                                            const BoundsExpr *SubExprBounds) {
+                                            const BoundsExpr *SubExprBounds,
+                                            SourceLocation Loc,
+                                            const Expr *Base) {
   if (!getLangOpts().CheckedC)
     return;
 
@@ -214,6 +733,44 @@ CodeGenFunction::EmitDynamicBoundsCastCheck(const Address BaseAddr,
   const RangeBoundsExpr *CastRange = dyn_cast<RangeBoundsExpr>(CastBounds);
 
   ++NumDynamicChecksCast;
+  if (!isCheckKindEnabled(CodeGenOptions::CheckedCCheckCast)) {
+    ++NumDynamicChecksDisabled;
+    return;
+  }
+
+  // A cast whose range is within the range of the base by constant offsets
+  // always succeeds.
+  if (isCastRangeSubsumed(getContext(), SubRange, CastRange)) {
+    ++NumDynamicChecksElided;
+    remarkCheckElided(CGM, Loc, "bounds cast", ECR_ProvedStatically);
+    return;
+  }
+
+  // An identical check of the same base that dominates this one has already
+  // succeeded if nothing can have changed the base or the bounds since.
+  bool ReuseCheck = CGM.getCodeGenOpts().CheckedCReuseBoundsValues && Base &&
+                    !Base->HasSideEffects(getContext());
+  if (ReuseCheck) {
+    validateBoundsValueCache();
+    Lexicographic Lex(getContext(), nullptr);
+    auto IsEqual = [&](const Expr *E1, const Expr *E2) {
+      return Lex.CompareExpr(E1, E2) == Lexicographic::Result::Equal;
+    };
+    for (const CachedBoundsCastCheck &Entry : BoundsCastCheckCache) {
+      if (IsEqual(Base, Entry.Base) &&
+          IsEqual(SubRange->getLowerExpr(), Entry.SubRange->getLowerExpr()) &&
+          IsEqual(SubRange->getUpperExpr(), Entry.SubRange->getUpperExpr()) &&
+          IsEqual(CastRange->getLowerExpr(),
+                  Entry.CastRange->getLowerExpr()) &&
+          IsEqual(CastRange->getUpperExpr(),
+                  Entry.CastRange->getUpperExpr())) {
+        ++NumDynamicChecksCastReused;
+        ++NumDynamicChecksElided;
+        remarkCheckElided(CGM, Loc, "bounds cast", ECR_Dominated);
+        return;
+      }
+    }
+  }
 
   // Emits code as follows:
   //
@@ -239,6 +796,7 @@ CodeGenFunction::EmitDynamicBoundsCastCheck(const Address BaseAddr,
   if (const ConstantInt *IsNullConstant = dyn_cast<ConstantInt>(IsNull)) {
     if (IsNullConstant->isOne()) {
       ++NumDynamicChecksElided;
+      remarkCheckElided(CGM, Loc, "bounds cast", ECR_ConstantCondition);
 
       // We have not emitted any blocks or any branches so far,
       // so we can just return here, which leaves the Builder
@@ -256,6 +814,7 @@ CodeGenFunction::EmitDynamicBoundsCastCheck(const Address BaseAddr,
     }
   }
 
+  DynamicCheckSite Site = EmitDynamicCheckSite(Loc, "bounds cast");
   BasicBlock *DyCkSubsumption = createBasicBlock("_Dynamic_check.subsumption");
   BasicBlock *DyCkSuccess = createBasicBlock("_Dynamic_check.success");
 
@@ -272,35 +831,64 @@ CodeGenFunction::EmitDynamicBoundsCastCheck(const Address BaseAddr,
   // If required, we will be bitcasting castlb and castub at the
   // LLVM IR level to match the types of lb and ub respectively.
 
-  // Emit the code to generate pointers for SubRange, lb and ub
-  Address Lower = EmitPointerWithAlignment(SubRange->getLowerExpr());
-  Address Upper = EmitPointerWithAlignment(SubRange->getUpperExpr());
-
-  // Emit the code to generate pointers for CastRange, castlb and castub
-
-  Address CastLower = EmitPointerWithAlignment(CastRange->getLowerExpr());
-  // We will be comparing CastLower to Lower. Their types may not match,
-  // so we're going to bitcast CastLower to match the type of Lower if needed.
-  if (CastLower.getType() != Lower.getType())
-    CastLower = Builder.CreateBitCast(CastLower, Lower.getType());
-
-  Address CastUpper = EmitPointerWithAlignment(CastRange->getUpperExpr());
-  // Again we're going to bitcast CastUpper to match the type of Upper
-  // if needed.
-  if (CastUpper.getType() != Upper.getType())
-    CastUpper = Builder.CreateBitCast(CastUpper, Upper.getType());
-
-  // Make the lower check (Lower <= CastLower)
-  Value *LowerChk = Builder.CreateICmpULE(
-      Lower.getPointer(), CastLower.getPointer(), "_Dynamic_check.lower");
-
-  // Make the upper check (CastUpper <= Upper)
-  Value *UpperChk = Builder.CreateICmpULE(
-      CastUpper.getPointer(), Upper.getPointer(), "_Dynamic_check.upper");
+  // When lb and castlb are the same expression, as for a cast that only
+  // changes the count, the lower check always succeeds and is left out. If
+  // both ranges are also lower + count, the upper check becomes
+  // castcount * castsize <= count * size.
+  bool SameLower =
+      Lexicographic(getContext(), nullptr)
+          .CompareExpr(SubRange->getLowerExpr(), CastRange->getLowerExpr()) ==
+      Lexicographic::Result::Equal;
+  CharUnits ElemSize, CastElemSize;
+  const Expr *Count = nullptr, *CastCount = nullptr;
+  if (SameLower) {
+    Count = getNonNegativeRangeCount(getContext(), SubRange, ElemSize);
+    if (Count)
+      CastCount =
+          getNonNegativeRangeCount(getContext(), CastRange, CastElemSize);
+  }
 
-  // Make Both Checks
-  Value *CastCond =
-      Builder.CreateAnd(LowerChk, UpperChk, "_Dynamic_check.cast");
+  Value *CastCond;
+  if (CastCount) {
+    ++NumDynamicChecksFused;
+    Value *CastSize = emitRangeSize(*this, CastCount, CastElemSize);
+    Value *Size = emitRangeSize(*this, Count, ElemSize);
+    CastCond = Builder.CreateICmpULE(CastSize, Size, "_Dynamic_check.cast");
+  } else {
+    // Emit the code to generate pointers for SubRange, lb and ub
+    Address Upper = EmitPointerWithAlignment(SubRange->getUpperExpr());
+
+    // Emit the code to generate pointers for CastRange, castlb and castub
+
+    Address CastUpper = EmitPointerWithAlignment(CastRange->getUpperExpr());
+    // We're going to bitcast CastUpper to match the type of Upper if needed.
+    if (CastUpper.getType() != Upper.getType())
+      CastUpper = Builder.CreateBitCast(CastUpper, Upper.getType());
+
+    // Make the upper check (CastUpper <= Upper)
+    Value *UpperChk = Builder.CreateICmpULE(
+        CastUpper.getPointer(), Upper.getPointer(), "_Dynamic_check.upper");
+
+    if (SameLower) {
+      ++NumDynamicChecksFused;
+      CastCond = UpperChk;
+    } else {
+      Address Lower = EmitPointerWithAlignment(SubRange->getLowerExpr());
+      Address CastLower = EmitPointerWithAlignment(CastRange->getLowerExpr());
+      // We will be comparing CastLower to Lower. Their types may not match,
+      // so we're going to bitcast CastLower to match the type of Lower if
+      // needed.
+      if (CastLower.getType() != Lower.getType())
+        CastLower = Builder.CreateBitCast(CastLower, Lower.getType());
+
+      // Make the lower check (Lower <= CastLower)
+      Value *LowerChk = Builder.CreateICmpULE(
+          Lower.getPointer(), CastLower.getPointer(), "_Dynamic_check.lower");
+
+      // Make Both Checks
+      CastCond = Builder.CreateAnd(LowerChk, UpperChk, "_Dynamic_check.cast");
+    }
+  }
 
   // Constant Folding:
   // If CastCond is true (one), then we need to insert a direct branch
@@ -309,6 +897,7 @@ CodeGenFunction::EmitDynamicBoundsCastCheck(const Address BaseAddr,
   if (const ConstantInt *CastCondConstant = dyn_cast<ConstantInt>(CastCond)) {
     if (CastCondConstant->isOne()) {
       ++NumDynamicChecksElided;
+      remarkCheckElided(CGM, Loc, "bounds cast", ECR_ConstantCondition);
 
       // We have emitted a branch to the failure block, along with the
       // failure block, so we have to emit a direct branch to success,
@@ -338,18 +927,25 @@ CodeGenFunction::EmitDynamicBoundsCastCheck(const Address BaseAddr,
   }
 
   ++NumDynamicChecksInserted;
+  remarkCheckInserted(CGM, Loc, "bounds cast");
 
-  BasicBlock *DyCkFail = EmitDynamicCheckFailedBlock();
+  BasicBlock *DyCkFail = EmitDynamicCheckFailedBlock(Site, DyCkSuccess);
 
   // Insert the CastCond Branch
-  Builder.CreateCondBr(CastCond, DyCkSuccess, DyCkFail);
+  EmitDynamicCheckBranch(CastCond, DyCkSuccess, DyCkFail);
+  if (ReuseCheck) {
+    continueBoundsValueCache(DyCkSuccess);
+    BoundsCastCheckCache.push_back({Base, SubRange, CastRange});
+  }
 
   // This ensures the success block comes directly after the subsumption branch
   EmitBlock(DyCkSuccess);
   Builder.SetInsertPoint(DyCkSuccess);
 }
 
-void CodeGenFunction::EmitDynamicCheckBlocks(Value *Condition) {
+void CodeGenFunction::EmitDynamicCheckBlocks(Value *Condition,
+                                             SourceLocation Loc,
+                                             StringRef Kind) {
   assert(Condition->getType()->isIntegerTy(1) &&
          "May only dynamic check boolean conditions");
 
@@ -359,27 +955,113 @@ void CodeGenFunction::EmitDynamicCheckBlocks(Value *Condition) {
   if (const ConstantInt *ConditionConstant = dyn_cast<ConstantInt>(Condition)) {
     if (ConditionConstant->isOne()) {
       ++NumDynamicChecksElided;
+      remarkCheckElided(CGM, Loc, Kind, ECR_ConstantCondition);
       return;
     }
   }
 
   ++NumDynamicChecksInserted;
+  remarkCheckInserted(CGM, Loc, Kind);
 
+  DynamicCheckSite Site = EmitDynamicCheckSite(Loc, Kind);
   BasicBlock *DyCkSuccess = createBasicBlock("_Dynamic_check.succeeded");
-  BasicBlock *DyCkFail = EmitDynamicCheckFailedBlock();
+  BasicBlock *DyCkFail = EmitDynamicCheckFailedBlock(Site, DyCkSuccess);
 
-  Builder.CreateCondBr(Condition, DyCkSuccess, DyCkFail);
+  EmitDynamicCheckBranch(Condition, DyCkSuccess, DyCkFail);
+  continueBoundsValueCache(DyCkSuccess);
   // This ensures the success block comes directly after the branch
   EmitBlock(DyCkSuccess);
   Builder.SetInsertPoint(DyCkSuccess);
 }
 
-BasicBlock *CodeGenFunction::EmitDynamicCheckFailedBlock() {
+BranchInst *CodeGenFunction::EmitDynamicCheckBranch(Value *Condition,
+                                                   BasicBlock *Succeeded,
+                                                   BasicBlock *Failed) {
+  // Tell the optimizer that the check is expected to succeed, so that the
+  // failure path is laid out out of line. The checks have no profile
+  // counters of their own, so these weights are kept with profile-guided
+  // optimization too.
+  llvm::MDNode *Weights = nullptr;
+  if (CGM.getCodeGenOpts().CheckedCColdCheckFailure)
+    Weights = createBranchWeights(Stmt::LH_Likely);
+  return Builder.CreateCondBr(Condition, Succeeded, Failed, Weights);
+}
+
+BasicBlock *CodeGenFunction::createDynamicCheckFailedBlock(const Twine &Name) {
+  BasicBlock *FailBlock = createBasicBlock(Name);
+  DynamicCheckFailedBlocks.push_back(FailBlock);
+  return FailBlock;
+}
+
+CodeGenFunction::DynamicCheckSite
+CodeGenFunction::EmitDynamicCheckSite(SourceLocation Loc, StringRef Kind) {
+  const CodeGenOptions &CGOpts = CGM.getCodeGenOpts();
+  if (CGOpts.CheckedCCheckSiteTable)
+    CGM.EmitCheckedCCheckSiteTableEntry(Loc, Kind, CurFn->getName());
+
+  DynamicCheckSite Site;
+  bool CountFailures = CGOpts.getCheckedCDynamicCheckMode() ==
+                       CodeGenOptions::CheckedCCheckCount;
+  // A counted failure continues after the check, so it never reaches the
+  // handler.
+  if (CGOpts.CheckedCCheckFailureHandler && !CountFailures)
+    Site.FailureID = CGM.getCheckedCCheckFailureID(Loc, Kind);
+  if (!CountFailures && !CGOpts.CheckedCDynamicCheckProfile)
+    return Site;
+
+  Site.Counters = CGM.EmitCheckedCCheckSite(Loc, Kind);
+  if (CGOpts.CheckedCDynamicCheckProfile)
+    EmitDynamicCheckCounterIncrement(Site.Counters, 1);
+  return Site;
+}
+
+void CodeGenFunction::EmitDynamicCheckCounterIncrement(
+    llvm::GlobalVariable *Site, unsigned Field) {
+  Address Counter = Builder.CreateStructGEP(
+      Address(Site, CharUnits::fromQuantity(Site->getAlignment())), Field,
+      "_Dynamic_check.counter");
+  // The counters are only approximate when several threads update them at
+  // the same time, which keeps the cost of an update to a plain load and
+  // store.
+  llvm::LoadInst *Count = Builder.CreateLoad(Counter);
+  Count->setAtomic(llvm::AtomicOrdering::Monotonic);
+  Value *NewCount = Builder.CreateAdd(Count, Builder.getInt64(1));
+  llvm::StoreInst *Store = Builder.CreateStore(NewCount, Counter);
+  Store->setAtomic(llvm::AtomicOrdering::Monotonic);
+}
+
+BasicBlock *
+CodeGenFunction::EmitDynamicCheckFailedBlock(DynamicCheckSite Site,
+                                             BasicBlock *Continue) {
   // Save current insert point
   BasicBlock *Begin = Builder.GetInsertBlock();
 
+  // When failed checks are counted, the failure block bumps the failure
+  // counter of this check and continues after the check.
+  if (CGM.getCodeGenOpts().getCheckedCDynamicCheckMode() ==
+      CodeGenOptions::CheckedCCheckCount) {
+    BasicBlock *FailBlock =
+        createDynamicCheckFailedBlock("_Dynamic_check.failed");
+    Builder.SetInsertPoint(FailBlock);
+    EmitDynamicCheckCounterIncrement(Site.Counters, 0);
+    Builder.CreateBr(Continue);
+    Builder.SetInsertPoint(Begin);
+    return FailBlock;
+  }
+
+  // If all checks in the function share a failure block, reuse the one we
+  // have already emitted. A call to the check failure handler passes the
+  // identifier of the check, so it cannot be shared.
+  bool ShareFailBlock = CGM.getCodeGenOpts().CheckedCSharedCheckFailure &&
+                        !Site.FailureID;
+  if (ShareFailBlock && DynamicCheckFailedBlock)
+    return DynamicCheckFailedBlock;
+
   // Add a "failed block", which will be inserted at the end of CurFn
-  BasicBlock *FailBlock = createBasicBlock("_Dynamic_check.failed", CurFn);
+  BasicBlock *FailBlock =
+      createDynamicCheckFailedBlock("_Dynamic_check.failed");
+  if (ShareFailBlock)
+    DynamicCheckFailedBlock = FailBlock;
   Builder.SetInsertPoint(FailBlock);
   if (getLangOpts().InjectVerifierCalls) {
     llvm::Module &module = CGM.getModule();
@@ -391,10 +1073,21 @@ BasicBlock *CodeGenFunction::EmitDynamicCheckFailedBlock() {
     CallInst *VerifierError = Builder.CreateCall(verr);
     VerifierError->setDoesNotReturn();
     VerifierError->setDoesNotThrow();
+    VerifierError->addAttribute(llvm::AttributeList::FunctionIndex,
+                                llvm::Attribute::Cold);
   }
-  CallInst *TrapCall = Builder.CreateCall(CGM.getIntrinsic(Intrinsic::trap));
-  TrapCall->setDoesNotReturn();
-  TrapCall->setDoesNotThrow();
+  CallInst *FailCall =
+      Site.FailureID
+          ? Builder.CreateCall(CGM.getCheckedCCheckFailureHandler(),
+                               Site.FailureID)
+          : Builder.CreateCall(CGM.getIntrinsic(Intrinsic::trap));
+  FailCall->setDoesNotReturn();
+  FailCall->setDoesNotThrow();
+  FailCall->addAttribute(llvm::AttributeList::FunctionIndex,
+                         llvm::Attribute::Cold);
+  // Tag the failure so that the inliner does not count the block.
+  FailCall->setMetadata(CheckedCCheckFailureMDName,
+                        llvm::MDNode::get(getLLVMContext(), None));
   Builder.CreateUnreachable();
 
   // Return the insert point back to the saved insert point
@@ -408,24 +1101,25 @@ BasicBlock *CodeGenFunction::EmitNulltermWriteAdditionalCheck(
    const Address Upper,
    llvm::Value *LowerChk,
    llvm::Value *Val,
-   BasicBlock *Succeeded) {
+   BasicBlock *Succeeded,
+   DynamicCheckSite Site) {
   // Save current insert point
   BasicBlock *Begin = Builder.GetInsertBlock();
 
   // Add a "failed block", which will be inserted at the end of CurFn
   BasicBlock *FailBlock =
-    createBasicBlock("_Nullterm_range_check.failed", CurFn);
+    createDynamicCheckFailedBlock("_Nullterm_range_check.failed");
   Builder.SetInsertPoint(FailBlock);
   Value *AtUpper =
     Builder.CreateICmpEQ(PtrAddr.getPointer(), Upper.getPointer(),
                                         "_Dynamic_check.at_upper");
-  BasicBlock *OnFailure = EmitDynamicCheckFailedBlock();
+  BasicBlock *OnFailure = EmitDynamicCheckFailedBlock(Site, Succeeded);
   llvm::Value *Condition1 =
     Builder.CreateAnd(LowerChk, AtUpper, "_Dynamic_check.nt_upper_bound");
   Value *IsZero = Builder.CreateIsNull(Val, "_Dynamic_check.write_nul");
   llvm::Value *Condition2 =
     Builder.CreateAnd(Condition1, IsZero, "_Dynamic_check.allowed_write");
-  Builder.CreateCondBr(Condition2, Succeeded, OnFailure);
+  EmitDynamicCheckBranch(Condition2, Succeeded, OnFailure);
   // Return the insert point back to the saved insert point
   Builder.SetInsertPoint(Begin);
 
@@ -452,3 +1146,288 @@ BoundsExpr *CodeGenFunction::GetNullTermBoundsCheck(Expr *E) {
   }
   return nullptr;
 }
+
+//
+// Counting failed dynamic checks
+//
+
+// The section holding the sites of counted dynamic checks. Its name is a C
+// identifier, so ELF linkers define __start_ and __stop_ symbols for it.
+static const char CheckSiteSection[] = "checkedc_check_sites";
+
+llvm::GlobalVariable *CodeGenModule::EmitCheckedCCheckSite(SourceLocation Loc,
+                                                           StringRef Kind) {
+  if (!CheckedCCheckSiteTy)
+    CheckedCCheckSiteTy =
+        llvm::StructType::create("struct._Checkedc_check_site", Int64Ty,
+                                 Int64Ty, Int8PtrTy, Int32Ty, Int32Ty,
+                                 Int8PtrTy);
+
+  PresumedLoc PLoc = getContext().getSourceManager().getPresumedLoc(Loc);
+  StringRef FileName = PLoc.isValid() ? PLoc.getFilename() : "<unknown>";
+  llvm::Constant *Fields[] = {
+      llvm::ConstantInt::get(Int64Ty, 0),
+      llvm::ConstantInt::get(Int64Ty, 0),
+      llvm::ConstantExpr::getBitCast(
+          GetAddrOfConstantCString(FileName.str()).getPointer(), Int8PtrTy),
+      llvm::ConstantInt::get(Int32Ty, PLoc.isValid() ? PLoc.getLine() : 0),
+      llvm::ConstantInt::get(Int32Ty, PLoc.isValid() ? PLoc.getColumn() : 0),
+      llvm::ConstantExpr::getBitCast(
+          GetAddrOfConstantCString(Kind.str()).getPointer(), Int8PtrTy)};
+
+  auto *Site = new llvm::GlobalVariable(
+      getModule(), CheckedCCheckSiteTy, /*isConstant=*/false,
+      llvm::GlobalValue::PrivateLinkage,
+      llvm::ConstantStruct::get(CheckedCCheckSiteTy, Fields),
+      "_Dynamic_check.site");
+  // The sites are laid out as an array, so they must not be padded.
+  Site->setAlignment(getDataLayout().getABITypeAlign(CheckedCCheckSiteTy));
+
+  // Only ELF linkers provide the bounds of the section, which the dump of the
+  // counts needs.
+  if (getTriple().isOSBinFormatELF()) {
+    Site->setSection(CheckSiteSection);
+    HasCheckedCCheckSites = true;
+  }
+  return Site;
+}
+
+// The section holding the table of all dynamic check sites, which is only
+// read by tools, never by the program.
+static const char CheckSiteTableSection[] = "checkedc_check_site_table";
+
+void CodeGenModule::EmitCheckedCCheckSiteTableEntry(SourceLocation Loc,
+                                                    StringRef Kind,
+                                                    StringRef FnName) {
+  // Tools find the table by the name of its section, which is only
+  // meaningful for ELF object files.
+  if (!getTriple().isOSBinFormatELF())
+    return;
+
+  if (!CheckedCCheckSiteTableTy)
+    CheckedCCheckSiteTableTy =
+        llvm::StructType::create("struct._Checkedc_check_site_entry",
+                                 Int8PtrTy, Int32Ty, Int32Ty, Int8PtrTy,
+                                 Int8PtrTy, Int32Ty);
+
+  PresumedLoc PLoc = getContext().getSourceManager().getPresumedLoc(Loc);
+  StringRef FileName = PLoc.isValid() ? PLoc.getFilename() : "<unknown>";
+  auto CString = [&](StringRef S) {
+    return llvm::ConstantExpr::getBitCast(
+        GetAddrOfConstantCString(S.str()).getPointer(), Int8PtrTy);
+  };
+  llvm::Constant *Fields[] = {
+      CString(FileName),
+      llvm::ConstantInt::get(Int32Ty, PLoc.isValid() ? PLoc.getLine() : 0),
+      llvm::ConstantInt::get(Int32Ty, PLoc.isValid() ? PLoc.getColumn() : 0),
+      CString(Kind), CString(FnName),
+      llvm::ConstantInt::get(Int32Ty, NumCheckedCCheckSiteTableEntries++)};
+
+  auto *Entry = new llvm::GlobalVariable(
+      getModule(), CheckedCCheckSiteTableTy, /*isConstant=*/true,
+      llvm::GlobalValue::PrivateLinkage,
+      llvm::ConstantStruct::get(CheckedCCheckSiteTableTy, Fields),
+      "_Dynamic_check.site_entry");
+  // The entries are laid out as an array, so they must not be padded.
+  Entry->setAlignment(
+      getDataLayout().getABITypeAlign(CheckedCCheckSiteTableTy));
+  Entry->setSection(CheckSiteTableSection);
+  // Nothing in the program refers to the entries.
+  addUsedGlobal(Entry);
+}
+
+//
+// Reporting failed dynamic checks
+//
+
+llvm::ConstantInt *
+CodeGenModule::getCheckedCCheckFailureID(SourceLocation Loc, StringRef Kind) {
+  if (!CheckedCCheckFailureSiteTy)
+    CheckedCCheckFailureSiteTy =
+        llvm::StructType::create("struct._Checkedc_check_failure_site",
+                                 Int8PtrTy, Int32Ty, Int32Ty, Int8PtrTy);
+
+  PresumedLoc PLoc = getContext().getSourceManager().getPresumedLoc(Loc);
+  StringRef FileName = PLoc.isValid() ? PLoc.getFilename() : "<unknown>";
+  auto CString = [&](StringRef S) {
+    return llvm::ConstantExpr::getBitCast(
+        GetAddrOfConstantCString(S.str()).getPointer(), Int8PtrTy);
+  };
+  llvm::Constant *Fields[] = {
+      CString(FileName),
+      llvm::ConstantInt::get(Int32Ty, PLoc.isValid() ? PLoc.getLine() : 0),
+      llvm::ConstantInt::get(Int32Ty, PLoc.isValid() ? PLoc.getColumn() : 0),
+      CString(Kind)};
+  CheckedCCheckFailureSites.push_back(
+      llvm::ConstantStruct::get(CheckedCCheckFailureSiteTy, Fields));
+  return llvm::ConstantInt::get(Int32Ty, CheckedCCheckFailureSites.size() - 1);
+}
+
+llvm::Function *CodeGenModule::getCheckedCCheckFailureHandler() {
+  if (CheckedCCheckFailureHandler)
+    return CheckedCCheckFailureHandler;
+
+  // The handler is kept out of line and out of the hot code, so that a check
+  // costs only a comparison and a branch in the functions it is in.
+  llvm::Function *Handler = llvm::Function::Create(
+      llvm::FunctionType::get(VoidTy, {Int32Ty}, /*isVarArg=*/false),
+      llvm::GlobalValue::InternalLinkage, CheckedCFailureHandlerName,
+      &getModule());
+  Handler->addFnAttr(llvm::Attribute::NoInline);
+  Handler->addFnAttr(llvm::Attribute::Cold);
+  Handler->setDoesNotReturn();
+  Handler->setDoesNotThrow();
+  CheckedCCheckFailureHandler = Handler;
+  return Handler;
+}
+
+void CodeGenModule::EmitCheckedCCheckFailureHandler() {
+  // The sites are only complete once all the functions of the module have
+  // been emitted.
+  auto *SitesTy = llvm::ArrayType::get(CheckedCCheckFailureSiteTy,
+                                       CheckedCCheckFailureSites.size());
+  auto *Sites = new llvm::GlobalVariable(
+      getModule(), SitesTy, /*isConstant=*/true,
+      llvm::GlobalValue::PrivateLinkage,
+      llvm::ConstantArray::get(SitesTy, CheckedCCheckFailureSites),
+      "_Dynamic_check.failure_sites");
+
+  // void handler(unsigned ID) {
+  //   dprintf(2, "...", Sites[ID].File, Sites[ID].Line, Sites[ID].Column,
+  //           Sites[ID].Kind);
+  //   __builtin_trap();
+  // }
+  llvm::Function *Handler = CheckedCCheckFailureHandler;
+  CGBuilderTy B(*this, llvm::BasicBlock::Create(getLLVMContext(), "entry",
+                                                Handler));
+  // Windows does not provide dprintf, so the handler only traps there.
+  if (!getTriple().isOSWindows()) {
+    llvm::Value *Indices[] = {B.getInt32(0), Handler->getArg(0)};
+    Address SiteAddr(B.CreateInBoundsGEP(SitesTy, Sites, Indices),
+                     CharUnits::fromQuantity(
+                         getDataLayout()
+                             .getABITypeAlign(CheckedCCheckFailureSiteTy)
+                             .value()));
+    llvm::FunctionCallee Print = CreateRuntimeFunction(
+        llvm::FunctionType::get(IntTy, {IntTy, Int8PtrTy}, /*isVarArg=*/true),
+        "dprintf");
+    llvm::Constant *Format = llvm::ConstantExpr::getBitCast(
+        GetAddrOfConstantCString("%s:%u:%u: %s check failed\n").getPointer(),
+        Int8PtrTy);
+    llvm::Value *Args[] = {B.getInt32(2),
+                           Format,
+                           B.CreateLoad(B.CreateStructGEP(SiteAddr, 0)),
+                           B.CreateLoad(B.CreateStructGEP(SiteAddr, 1)),
+                           B.CreateLoad(B.CreateStructGEP(SiteAddr, 2)),
+                           B.CreateLoad(B.CreateStructGEP(SiteAddr, 3))};
+    B.CreateCall(Print, Args);
+  }
+  llvm::CallInst *TrapCall = B.CreateCall(getIntrinsic(llvm::Intrinsic::trap));
+  TrapCall->setDoesNotReturn();
+  TrapCall->setDoesNotThrow();
+  B.CreateUnreachable();
+}
+
+void CodeGenModule::EmitCheckedCCheckCountDump() {
+  // The dump and its registration are shared by all modules linked into the
+  // same image.
+  auto CreateSharedFunction = [&](StringRef Name) {
+    llvm::Function *Fn =
+        llvm::Function::Create(llvm::FunctionType::get(VoidTy, false),
+                               llvm::GlobalValue::LinkOnceODRLinkage, Name,
+                               &getModule());
+    Fn->setVisibility(llvm::GlobalValue::HiddenVisibility);
+    Fn->setComdat(getModule().getOrInsertComdat(Name));
+    Fn->setDoesNotThrow();
+    return Fn;
+  };
+  auto GetSectionBound = [&](StringRef Name) {
+    auto *Bound = new llvm::GlobalVariable(
+        getModule(), CheckedCCheckSiteTy, /*isConstant=*/false,
+        llvm::GlobalValue::ExternalWeakLinkage, nullptr, Name);
+    Bound->setVisibility(llvm::GlobalValue::HiddenVisibility);
+    return Bound;
+  };
+
+  // void __checkedc_dump_check_counts() {
+  //   for (Site = __start_checkedc_check_sites;
+  //        Site != __stop_checkedc_check_sites; ++Site)
+  //     if (Site->Failures || Site->Executions)
+  //       dprintf(2, "...", Site->File, Site->Line, Site->Column, Site->Kind,
+  //               Site->Executions, Site->Failures);
+  // }
+  // dprintf is not async-signal-safe, so neither is the dump: it runs at
+  // exit, or when the program calls it, but not from a signal handler.
+  llvm::Function *Dump = CreateSharedFunction("__checkedc_dump_check_counts");
+  llvm::Value *Start = GetSectionBound(std::string("__start_") +
+                                       CheckSiteSection);
+  llvm::Value *Stop = GetSectionBound(std::string("__stop_") +
+                                      CheckSiteSection);
+  llvm::FunctionCallee Print = CreateRuntimeFunction(
+      llvm::FunctionType::get(IntTy, {IntTy, Int8PtrTy}, /*isVarArg=*/true),
+      "dprintf");
+  llvm::Constant *Format = llvm::ConstantExpr::getBitCast(
+      GetAddrOfConstantCString(
+          "%s:%u:%u: %s check executed %llu times, failed %llu times\n")
+          .getPointer(),
+      Int8PtrTy);
+
+  llvm::LLVMContext &Ctx = getLLVMContext();
+  llvm::BasicBlock *Entry = llvm::BasicBlock::Create(Ctx, "entry", Dump);
+  llvm::BasicBlock *Cond = llvm::BasicBlock::Create(Ctx, "cond", Dump);
+  llvm::BasicBlock *Body = llvm::BasicBlock::Create(Ctx, "body", Dump);
+  llvm::BasicBlock *Report = llvm::BasicBlock::Create(Ctx, "report", Dump);
+  llvm::BasicBlock *Next = llvm::BasicBlock::Create(Ctx, "next", Dump);
+  llvm::BasicBlock *Exit = llvm::BasicBlock::Create(Ctx, "exit", Dump);
+
+  CGBuilderTy B(*this, Entry);
+  B.CreateBr(Cond);
+
+  B.SetInsertPoint(Cond);
+  llvm::PHINode *Site = B.CreatePHI(Start->getType(), 2, "site");
+  Site->addIncoming(Start, Entry);
+  B.CreateCondBr(B.CreateICmpEQ(Site, Stop), Exit, Body);
+
+  B.SetInsertPoint(Body);
+  Address SiteAddr(Site, CharUnits::fromQuantity(
+                             getDataLayout()
+                                 .getABITypeAlign(CheckedCCheckSiteTy)
+                                 .value()));
+  llvm::LoadInst *Failures = B.CreateLoad(B.CreateStructGEP(SiteAddr, 0));
+  Failures->setAtomic(llvm::AtomicOrdering::Monotonic);
+  llvm::LoadInst *Executions = B.CreateLoad(B.CreateStructGEP(SiteAddr, 1));
+  Executions->setAtomic(llvm::AtomicOrdering::Monotonic);
+  B.CreateCondBr(B.CreateIsNotNull(B.CreateOr(Failures, Executions)), Report,
+                 Next);
+
+  B.SetInsertPoint(Report);
+  llvm::Value *Args[] = {B.getInt32(2),
+                         Format,
+                         B.CreateLoad(B.CreateStructGEP(SiteAddr, 2)),
+                         B.CreateLoad(B.CreateStructGEP(SiteAddr, 3)),
+                         B.CreateLoad(B.CreateStructGEP(SiteAddr, 4)),
+                         B.CreateLoad(B.CreateStructGEP(SiteAddr, 5)),
+                         Executions,
+                         Failures};
+  B.CreateCall(Print, Args);
+  B.CreateBr(Next);
+
+  B.SetInsertPoint(Next);
+  Site->addIncoming(B.CreateConstGEP1_32(CheckedCCheckSiteTy, Site, 1), Next);
+  B.CreateBr(Cond);
+
+  B.SetInsertPoint(Exit);
+  B.CreateRetVoid();
+
+  // Register the dump with atexit from a constructor that is also shared, so
+  // that the counts are dumped once.
+  llvm::Function *Register =
+      CreateSharedFunction("__checkedc_register_check_count_dump");
+  llvm::FunctionCallee AtExit = CreateRuntimeFunction(
+      llvm::FunctionType::get(IntTy, {Dump->getType()}, /*isVarArg=*/false),
+      "atexit");
+  B.SetInsertPoint(llvm::BasicBlock::Create(Ctx, "entry", Register));
+  B.CreateCall(AtExit, {Dump});
+  B.CreateRetVoid();
+  AddGlobalCtor(Register, 65535, Register);
+}
@@ -1754,6 +1754,7 @@ llvm::Value *CodeGenFunction::EmitLoadOfScalar(Address Addr, bool Volatile,
         Load->getContext(), llvm::ConstantAsMetadata::get(Builder.getInt32(1)));
     Load->setMetadata(CGM.getModule().getMDKindID("nontemporal"), Node);
   }
+  skipSanitizerForCheckedCAccess(Load, Addr);
 
   CGM.DecorateInstructionWithTBAA(Load, TBAAInfo);
 
@@ -1869,6 +1870,7 @@ void CodeGenFunction::EmitStoreOfScalar(llvm::Value *Value, Address Addr,
                           llvm::ConstantAsMetadata::get(Builder.getInt32(1)));
     Store->setMetadata(CGM.getModule().getMDKindID("nontemporal"), Node);
   }
+  skipSanitizerForCheckedCAccess(Store, Addr);
 
   CGM.DecorateInstructionWithTBAA(Store, TBAAInfo);
 }
@@ -2880,9 +2882,10 @@ LValue CodeGenFunction::EmitUnaryOpLValue(const UnaryOperator *E) {
     LValue LV = MakeAddrLValue(Addr, T, BaseInfo, TBAAInfo);
     LV.getQuals().setAddressSpace(ExprTy.getAddressSpace());
 
-    EmitDynamicNonNullCheck(Addr, BaseTy);
-    EmitDynamicBoundsCheck(Addr, E->getBoundsExpr(), E->getBoundsCheckKind(),
-                           nullptr);
+    EmitDynamicNonNullAndBoundsCheck(Addr, BaseTy, Addr, E->getBoundsExpr(),
+                                     E->getBoundsCheckKind(), E->getExprLoc(),
+                                     E->isBoundsCheckProvenSafe(),
+                                     E->isBoundsCheckLowerProven());
     // We should not generate __weak write barrier on indirect reference
     // of a pointer to object; as in void foo (__weak id *param); *param = 0;
     // But, we continue to generate __strong write barrier on indirect write
@@ -3739,13 +3742,14 @@ LValue CodeGenFunction::EmitArraySubscriptExpr(const ArraySubscriptExpr *E,
     LValue LHS = EmitLValue(E->getBase());
     auto *Idx = EmitIdxAfterBase(/*Promote*/false);
     assert(LHS.isSimple() && "Can only subscript lvalue vectors here!");
-    EmitDynamicNonNullCheck(LHS.getAddress(*this), BaseTy);
+    EmitDynamicNonNullCheck(LHS.getAddress(*this), BaseTy, E->getExprLoc());
 
     LValue LV = LValue::MakeVectorElt(LHS.getAddress(*this), Idx,
       E->getBase()->getType(), LHS.getBaseInfo(), TBAAAccessInfo());
 
     EmitDynamicBoundsCheck(LV.getVectorAddress(), E->getBoundsExpr(),
-                            E->getBoundsCheckKind(), nullptr);
+                            E->getBoundsCheckKind(), nullptr,
+                            E->getExprLoc(), E->isBoundsCheckProvenSafe());
 
     return LV;
   }
@@ -3757,7 +3761,7 @@ LValue CodeGenFunction::EmitArraySubscriptExpr(const ArraySubscriptExpr *E,
     LValue LV = EmitLValue(E->getBase());
     auto *Idx = EmitIdxAfterBase(/*Promote*/true);
     Address Addr = EmitExtVectorElementLValue(LV);
-    EmitDynamicNonNullCheck(Addr, BaseTy);
+    EmitDynamicNonNullCheck(Addr, BaseTy, E->getExprLoc());
 
     QualType EltType = LV.getType()->castAs<VectorType>()->getElementType();
     Addr = emitArraySubscriptGEP(*this, Addr, Idx, EltType, /*inbounds*/ true,
@@ -3765,7 +3769,7 @@ LValue CodeGenFunction::EmitArraySubscriptExpr(const ArraySubscriptExpr *E,
     LValue AddrLV = MakeAddrLValue(Addr, EltType, LV.getBaseInfo(),
                                    CGM.getTBAAInfoForSubobject(LV, EltType));
     EmitDynamicBoundsCheck(Addr, E->getBoundsExpr(), E->getBoundsCheckKind(),
-      nullptr);
+      nullptr, E->getExprLoc(), E->isBoundsCheckProvenSafe());
 
     return AddrLV;
   }
@@ -3773,6 +3777,7 @@ LValue CodeGenFunction::EmitArraySubscriptExpr(const ArraySubscriptExpr *E,
   LValueBaseInfo EltBaseInfo;
   TBAAAccessInfo EltTBAAInfo;
   Address Addr = Address::invalid();
+  Address NonNullBase = Address::invalid();
   if (const VariableArrayType *vla =
            getContext().getAsVariableArrayType(E->getType())) {
     // The base must be a pointer, which is not an aggregate.  Emit
@@ -3780,7 +3785,7 @@ LValue CodeGenFunction::EmitArraySubscriptExpr(const ArraySubscriptExpr *E,
     // the VLA bounds.
     Addr = EmitPointerWithAlignment(E->getBase(), &EltBaseInfo, &EltTBAAInfo);
     auto *Idx = EmitIdxAfterBase(/*Promote*/true);
-    EmitDynamicNonNullCheck(Addr, BaseTy);
+    EmitDynamicNonNullCheck(Addr, BaseTy, E->getExprLoc());
 
     // The element count here is the total number of non-VLA elements.
     llvm::Value *numElements = getVLASize(vla).NumElts;
@@ -3811,7 +3816,7 @@ LValue CodeGenFunction::EmitArraySubscriptExpr(const ArraySubscriptExpr *E,
         llvm::ConstantInt::get(Idx->getType(), InterfaceSize.getQuantity());
 
     llvm::Value *ScaledIdx = Builder.CreateMul(Idx, InterfaceSizeVal);
-    EmitDynamicNonNullCheck(Addr, BaseTy);
+    EmitDynamicNonNullCheck(Addr, BaseTy, E->getExprLoc());
 
     // We don't necessarily build correct LLVM struct types for ObjC
     // interfaces, so we can't rely on GEP to do this scaling
@@ -3846,7 +3851,8 @@ LValue CodeGenFunction::EmitArraySubscriptExpr(const ArraySubscriptExpr *E,
       ArrayLV = EmitLValue(Array);
     auto *Idx = EmitIdxAfterBase(/*Promote*/true);
 
-    EmitDynamicNonNullCheck(ArrayLV.getAddress(*this), BaseTy);
+    EmitDynamicNonNullCheck(ArrayLV.getAddress(*this), BaseTy,
+                            E->getExprLoc());
 
     // Propagate the alignment from the array itself to the result.
     QualType arrayType = Array->getType();
@@ -3861,7 +3867,12 @@ LValue CodeGenFunction::EmitArraySubscriptExpr(const ArraySubscriptExpr *E,
     Addr = EmitPointerWithAlignment(E->getBase(), &EltBaseInfo, &EltTBAAInfo);
     auto *Idx = EmitIdxAfterBase(/*Promote*/true);
     QualType ptrType = E->getBase()->getType();
-    EmitDynamicNonNullCheck(Addr, BaseTy);
+    // With -fcheckedc-fuse-null-checks, the base is checked for null together
+    // with the bounds check of the element below.
+    if (CGM.getCodeGenOpts().CheckedCFuseNullChecks)
+      NonNullBase = Addr;
+    else
+      EmitDynamicNonNullCheck(Addr, BaseTy, E->getExprLoc());
     Addr = emitArraySubscriptGEP(*this, Addr, Idx, E->getType(),
                                  !getLangOpts().isSignedOverflowDefined(),
                                  SignedIndices, E->getExprLoc(), &ptrType,
@@ -3870,8 +3881,20 @@ LValue CodeGenFunction::EmitArraySubscriptExpr(const ArraySubscriptExpr *E,
 
   LValue LV = MakeAddrLValue(Addr, E->getType(), EltBaseInfo, EltTBAAInfo);
 
-  EmitDynamicBoundsCheck(Addr, E->getBoundsExpr(), E->getBoundsCheckKind(),
-                         nullptr);
+  if (NonNullBase.isValid())
+    EmitDynamicNonNullAndBoundsCheck(NonNullBase, BaseTy, Addr,
+                                     E->getBoundsExpr(),
+                                     E->getBoundsCheckKind(), E->getExprLoc(),
+                                     E->isBoundsCheckProvenSafe(),
+                                     E->isBoundsCheckLowerProven());
+  else
+    EmitDynamicBoundsCheck(Addr, E->getBoundsExpr(), E->getBoundsCheckKind(),
+                           nullptr, E->getExprLoc(),
+                           E->isBoundsCheckProvenSafe(),
+                           E->isBoundsCheckLowerProven(),
+                           /*NonNullCheck=*/nullptr,
+                           !BaseTy->isCheckedPointerType() &&
+                               !BaseTy->isCheckedArrayType());
 
   if (getLangOpts().ObjC &&
       getLangOpts().getGC() != LangOptions::NonGC) {
@@ -4178,14 +4201,14 @@ LValue CodeGenFunction::EmitMemberExpr(const MemberExpr *E) {
 
     BaseLV = MakeAddrLValue(Addr, PtrTy, BaseInfo, TBAAInfo);
 
-    EmitDynamicNonNullCheck(Addr, BaseTy);
     // We only check the Base LValue, as we assume that any field is definitely
     // within the size of the struct. This may not be the case with a "flexible
     // array member" (6.7.2.1.18), but this member is an array, so is either
     // unchecked, or is a checked array with its own bounds.
     // A second reason for always checking the BaseLV is that it is the same for
     // all the fields in the struct, so more of the checks should optimize away.
-    EmitDynamicBoundsCheck(Addr, E->getBoundsExpr(), BCK_Normal, nullptr);
+    EmitDynamicNonNullAndBoundsCheck(Addr, BaseTy, Addr, E->getBoundsExpr(),
+                                     BCK_Normal, E->getExprLoc());
   } else
     BaseLV = EmitCheckedLValue(BaseExpr, TCK_MemberAccess);
 
@@ -5524,7 +5547,8 @@ llvm::Value *CodeGenFunction::EmitBoundsCast(CastExpr *CE) {
     BoundsCastExpr *BCE = cast<BoundsCastExpr>(CE);
     EmitDynamicBoundsCastCheck(Addr,
                                BCE->getNormalizedBoundsExpr(),
-                               BCE->getSubExprBoundsExpr());
+                               BCE->getSubExprBoundsExpr(),
+                               CE->getExprLoc(), E);
   }
   return Addr.getPointer();
 }
@@ -2394,13 +2394,46 @@ static BinOpInfo createBinOpInfoFromIncDec(const UnaryOperator *E,
 }
 
 static void emitDynamicNonNullCheck(CodeGenFunction &CGF,
-                                    Value *Val, QualType Ty) {
-  if (!CGF.CGM.getCodeGenOpts().CheckedCNullPtrArith)
+                                    Value *Val, QualType Ty,
+                                    SourceLocation Loc) {
+  if (!CGF.CGM.getCodeGenOpts().CheckedCNullPtrArith ||
+      CGF.CGM.getCodeGenOpts().CheckedCPropagateNullPtrArith)
     return;
 
-  CGF.EmitDynamicNonNullCheck(Val, Ty);
+  CGF.EmitDynamicNonNullCheck(Val, Ty, Loc);
 }
 
+// Return Result, the result of arithmetic on the checked pointer Val of type
+// Ty. With -fcheckedc-propagate-null-ptr-arith, the arithmetic is not checked
+// by emitDynamicNonNullCheck, and a null pointer is returned instead if Val
+// is null.
+static Value *emitDynamicNonNullArith(CodeGenFunction &CGF, Value *Val,
+                                      Value *Result, QualType Ty) {
+  if (!CGF.CGM.getCodeGenOpts().CheckedCNullPtrArith ||
+      !CGF.CGM.getCodeGenOpts().CheckedCPropagateNullPtrArith)
+    return Result;
+
+  return CGF.EmitDynamicNonNullArith(Val, Result, Ty);
+}
+
+// Return true if arithmetic on a pointer of type Ty is checked for overflow.
+// Only the inbounds GEPs of pointers to complete, fixed-size types are
+// checked, which covers the arithmetic allowed on checked pointers.
+static bool shouldEmitPointerOverflowCheck(CodeGenFunction &CGF, QualType Ty) {
+  if (!CGF.CGM.getCodeGenOpts().CheckedCPointerOverflowChecks ||
+      !CGF.getLangOpts().CheckedC || !Ty->isCheckedPointerType() ||
+      CGF.getLangOpts().isSignedOverflowDefined())
+    return false;
+
+  QualType ElemTy = Ty->getPointeeType();
+  return !CGF.getContext().getAsVariableArrayType(ElemTy) &&
+         !ElemTy->isVoidType() && !ElemTy->isFunctionType();
+}
+
+static void emitDynamicPointerOverflowCheck(CodeGenFunction &CGF, Value *Ptr,
+                                            Value *GEPVal, QualType Ty,
+                                            SourceLocation Loc);
+
 llvm::Value *ScalarExprEmitter::EmitIncDecConsiderOverflowBehavior(
     const UnaryOperator *E, llvm::Value *InVal, bool IsInc) {
   llvm::Value *Amount =
@@ -2572,8 +2605,13 @@ ScalarExprEmitter::EmitScalarPrePostIncDec(const UnaryOperator *E, LValue LV,
 
   // Next most common: pointer increment.
   } else if (const PointerType *ptr = type->getAs<PointerType>()) {
-    // Insert a dynamic check for arithmetic on null checked pointers.
-    emitDynamicNonNullCheck(CGF, value, type);
+    // Insert a dynamic check for arithmetic on null checked pointers. When
+    // the arithmetic is checked for overflow, that check includes it.
+    QualType ptrType = type;
+    bool CheckOverflow = shouldEmitPointerOverflowCheck(CGF, ptrType);
+    if (!CheckOverflow)
+      emitDynamicNonNullCheck(CGF, value, ptrType, E->getExprLoc());
+    llvm::Value *ptrValue = value;
 
     QualType type = ptr->getPointeeType();
 
@@ -2607,12 +2645,20 @@ ScalarExprEmitter::EmitScalarPrePostIncDec(const UnaryOperator *E, LValue LV,
       llvm::Value *amt = Builder.getInt32(amount);
       if (CGF.getLangOpts().isSignedOverflowDefined())
         value = Builder.CreateGEP(value, amt, "incdec.ptr");
-      else
+      else {
+        llvm::Value *base = value;
         value = CGF.EmitCheckedInBoundsGEP(value, amt, /*SignedIndices=*/false,
                                            isSubtraction, E->getExprLoc(),
                                            "incdec.ptr");
+        if (CheckOverflow)
+          emitDynamicPointerOverflowCheck(CGF, base, value, ptrType,
+                                          E->getExprLoc());
+      }
     }
 
+    if (!CheckOverflow)
+      value = emitDynamicNonNullArith(CGF, ptrValue, value, ptrType);
+
   // Vector increment/decrement.
   } else if (type->isVectorType()) {
     if (type->hasIntegerRepresentation()) {
@@ -3366,8 +3412,13 @@ static Value *emitPointerArithmetic(CodeGenFunction &CGF,
     std::swap(pointerOperand, indexOperand);
   }
 
-  // Insert a dynamic check for arithmetic on null checked pointers.
-  emitDynamicNonNullCheck(CGF, pointer, pointerOperand->getType());
+  // Insert a dynamic check for arithmetic on null checked pointers. When
+  // the arithmetic is checked for overflow, that check includes it.
+  bool CheckOverflow =
+      shouldEmitPointerOverflowCheck(CGF, pointerOperand->getType());
+  if (!CheckOverflow)
+    emitDynamicNonNullCheck(CGF, pointer, pointerOperand->getType(),
+                            op.E->getExprLoc());
 
   bool isSigned = indexOperand->getType()->isSignedIntegerOrEnumerationType();
 
@@ -3395,8 +3446,14 @@ static Value *emitPointerArithmetic(CodeGenFunction &CGF,
   if (BinaryOperator::isNullPointerArithmeticExtension(CGF.getContext(),
                                                        op.Opcode,
                                                        expr->getLHS(),
-                                                       expr->getRHS()))
-    return CGF.Builder.CreateIntToPtr(index, pointer->getType());
+                                                       expr->getRHS())) {
+    if (CheckOverflow)
+      emitDynamicNonNullCheck(CGF, pointer, pointerOperand->getType(),
+                              op.E->getExprLoc());
+    return emitDynamicNonNullArith(
+        CGF, pointer, CGF.Builder.CreateIntToPtr(index, pointer->getType()),
+        pointerOperand->getType());
+  }
 
   if (width != DL.getIndexTypeSizeInBits(PtrTy)) {
     // Zero-extend or sign-extend the pointer value according to
@@ -3439,16 +3496,18 @@ static Value *emitPointerArithmetic(CodeGenFunction &CGF,
     // GEP indexes are signed, and scaling an index isn't permitted to
     // signed-overflow, so we use the same semantics for our explicit
     // multiply.  We suppress this if overflow is not undefined behavior.
+    Value *result;
     if (CGF.getLangOpts().isSignedOverflowDefined()) {
       index = CGF.Builder.CreateMul(index, numElements, "vla.index");
-      pointer = CGF.Builder.CreateGEP(pointer, index, "add.ptr");
+      result = CGF.Builder.CreateGEP(pointer, index, "add.ptr");
     } else {
       index = CGF.Builder.CreateNSWMul(index, numElements, "vla.index");
-      pointer =
+      result =
           CGF.EmitCheckedInBoundsGEP(pointer, index, isSigned, isSubtraction,
                                      op.E->getExprLoc(), "add.ptr");
     }
-    return pointer;
+    return emitDynamicNonNullArith(CGF, pointer, result,
+                                   pointerOperand->getType());
   }
 
   // Explicitly handle GNU void* and function pointer arithmetic extensions. The
@@ -3457,14 +3516,27 @@ static Value *emitPointerArithmetic(CodeGenFunction &CGF,
   if (elementType->isVoidType() || elementType->isFunctionType()) {
     Value *result = CGF.EmitCastToVoidPtr(pointer);
     result = CGF.Builder.CreateGEP(result, index, "add.ptr");
-    return CGF.Builder.CreateBitCast(result, pointer->getType());
+    result = CGF.Builder.CreateBitCast(result, pointer->getType());
+    return emitDynamicNonNullArith(CGF, pointer, result,
+                                   pointerOperand->getType());
   }
 
   if (CGF.getLangOpts().isSignedOverflowDefined())
-    return CGF.Builder.CreateGEP(pointer, index, "add.ptr");
-
-  return CGF.EmitCheckedInBoundsGEP(pointer, index, isSigned, isSubtraction,
-                                    op.E->getExprLoc(), "add.ptr");
+    return emitDynamicNonNullArith(
+        CGF, pointer, CGF.Builder.CreateGEP(pointer, index, "add.ptr"),
+        pointerOperand->getType());
+
+  Value *result =
+      CGF.EmitCheckedInBoundsGEP(pointer, index, isSigned, isSubtraction,
+                                 op.E->getExprLoc(), "add.ptr");
+  if (CheckOverflow)
+    emitDynamicPointerOverflowCheck(CGF, pointer, result,
+                                    pointerOperand->getType(),
+                                    op.E->getExprLoc());
+  else
+    result = emitDynamicNonNullArith(CGF, pointer, result,
+                                     pointerOperand->getType());
+  return result;
 }
 
 // Construct an fmuladd intrinsic to represent a fused mul-add of MulOp and
@@ -4198,7 +4270,7 @@ Value *ScalarExprEmitter::VisitBinAssign(const BinaryOperator *E) {
       if (BoundsCheck)
         CGF.EmitDynamicBoundsCheck(LHS.getAddress(CGF), BoundsCheck,
                                    BoundsCheckKind::BCK_NullTermWriteAssign,
-                                   RHS);
+                                   RHS, E->getLHS()->getExprLoc());
     }
 
     // Store the value into the LHS.  Bit-fields are handled specially
@@ -4994,6 +5066,37 @@ static GEPOffsetAndOverflow EmitGEPOffsetInBytes(Value *BasePtr, Value *GEPVal,
   return {TotalOffset, OffsetOverflows};
 }
 
+/// Emit the Checked C dynamic check that GEPVal, an inbounds GEP of the
+/// checked pointer Ptr of type Ty, does not wrap around the address space.
+static void emitDynamicPointerOverflowCheck(CodeGenFunction &CGF, Value *Ptr,
+                                            Value *GEPVal, QualType Ty,
+                                            SourceLocation Loc) {
+  CGBuilderTy &Builder = CGF.Builder;
+  GEPOffsetAndOverflow EvaluatedGEP = EmitGEPOffsetInBytes(
+      Ptr, GEPVal, CGF.getLLVMContext(), CGF.CGM, Builder);
+  llvm::Value *Overflows = EvaluatedGEP.OffsetOverflows;
+
+  // The result is the base plus a signed offset, computed as an unsigned
+  // addition. It wraps around if and only if the carry of the addition
+  // differs from the sign of the offset.
+  llvm::Value *Offset = EvaluatedGEP.TotalOffset;
+  auto *OffsetCI = dyn_cast<llvm::ConstantInt>(Offset);
+  if (!OffsetCI || !OffsetCI->isZero()) {
+    llvm::Type *IntPtrTy = Offset->getType();
+    llvm::Value *IntPtr = Builder.CreatePtrToInt(Ptr, IntPtrTy);
+    llvm::Value *Sum = Builder.CreateCall(
+        CGF.CGM.getIntrinsic(llvm::Intrinsic::uadd_with_overflow, IntPtrTy),
+        {IntPtr, Offset});
+    llvm::Value *Carry = Builder.CreateExtractValue(Sum, 1);
+    llvm::Value *IsNegative = Builder.CreateICmpSLT(
+        Offset, llvm::ConstantInt::getNullValue(IntPtrTy));
+    Overflows = Builder.CreateOr(Overflows,
+                                 Builder.CreateXor(Carry, IsNegative),
+                                 "_Dynamic_check.overflow");
+  }
+  CGF.EmitDynamicOverflowCheck(Ptr, Overflows, Ty, Loc);
+}
+
 Value *
 CodeGenFunction::EmitCheckedInBoundsGEP(Value *Ptr, ArrayRef<Value *> IdxList,
                                         bool SignedIndices, bool IsSubtraction,
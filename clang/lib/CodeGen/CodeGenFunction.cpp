@@ -454,6 +454,14 @@ void CodeGenFunction::FinishFunction(SourceLocation EndLoc) {
   for (const auto &FuncletAndParent : TerminateFunclets)
     EmitIfUsed(*this, FuncletAndParent.second);
 
+  for (llvm::BasicBlock *FailBlock : DynamicCheckFailedBlocks)
+    EmitIfUsed(*this, FailBlock);
+  DynamicCheckFailedBlocks.clear();
+  DynamicCheckFailedBlock = nullptr;
+  BoundsValueCache.clear();
+  BoundsCastCheckCache.clear();
+  BoundsValueCacheBlock = nullptr;
+
   if (CGM.getCodeGenOpts().EmitDeclMetadata)
     EmitDeclMetadata();
 
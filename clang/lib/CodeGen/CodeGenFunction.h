@@ -2389,6 +2389,74 @@ private:
   llvm::DenseMap<const CHKCBindTemporaryExpr *, LValue> BoundsTemporaryLValues;
   llvm::DenseMap<const CHKCBindTemporaryExpr *, RValue> BoundsTemporaryRValues;
 
+  /// DynamicCheckFailedBlock - The failure block shared by all dynamic checks
+  /// in the function, if -fcheckedc-shared-check-failure is enabled.
+  llvm::BasicBlock *DynamicCheckFailedBlock = nullptr;
+
+  /// DynamicCheckFailedBlocks - The failure blocks of the dynamic checks in
+  /// the function. They are added to the end of the function when it is
+  /// finished, so that they do not split up the code on the hot path.
+  SmallVector<llvm::BasicBlock *, 8> DynamicCheckFailedBlocks;
+
+  /// CachedBoundsValue - The value emitted for the bounds expression E of a
+  /// dynamic bounds check. For a pointer, Scale is zero. For a count, Value
+  /// is the count times Scale, as an integer of pointer width.
+  struct CachedBoundsValue {
+    const Expr *E;
+    llvm::WeakTrackingVH Value;
+    CharUnits Alignment;
+    CharUnits Scale;
+  };
+
+  /// BoundsValueCache - The bounds values emitted by dynamic bounds checks
+  /// that can be reused at the current insertion point, if
+  /// -fcheckedc-reuse-bounds-values is enabled. The values are defined in
+  /// BoundsValueCacheBlock or in the blocks of the dynamic checks that
+  /// branch to it, and no instruction since may have written to memory.
+  SmallVector<CachedBoundsValue, 4> BoundsValueCache;
+  llvm::BasicBlock *BoundsValueCacheBlock = nullptr;
+  /// BoundsValueCacheLast - The last instruction of BoundsValueCacheBlock
+  /// that has been checked for writes to memory, or null if the block was
+  /// empty.
+  llvm::WeakTrackingVH BoundsValueCacheLast;
+  bool BoundsValueCacheHasLast = false;
+
+  /// CachedBoundsCastCheck - A dynamic bounds cast check of Base from
+  /// SubRange to CastRange.
+  struct CachedBoundsCastCheck {
+    const Expr *Base;
+    const RangeBoundsExpr *SubRange;
+    const RangeBoundsExpr *CastRange;
+  };
+
+  /// BoundsCastCheckCache - The dynamic bounds cast checks that have
+  /// succeeded at the current insertion point, valid under the same
+  /// conditions as BoundsValueCache.
+  SmallVector<CachedBoundsCastCheck, 2> BoundsCastCheckCache;
+
+  /// CheckedCGuardedPointers - The pointers of the memory accesses that a
+  /// dynamic range check or a bounds proof guards, if
+  /// -fcheckedc-sanitize-unchecked-only is enabled. Each pointer maps to a
+  /// handle on itself, so that a pointer that was deleted is not mistaken
+  /// for a later value at the same address.
+  llvm::DenseMap<llvm::Value *, llvm::WeakVH> CheckedCGuardedPointers;
+
+  /// Record that the memory access through PtrAddr is guarded by a dynamic
+  /// range check or a bounds proof.
+  void markCheckedCGuardedPointer(Address PtrAddr);
+  /// Keep the sanitizers from instrumenting the memory access I through
+  /// Addr if its pointer is guarded.
+  void skipSanitizerForCheckedCAccess(llvm::Instruction *I, Address Addr);
+
+  /// Drop the entries of BoundsValueCache that cannot be reused at the
+  /// current insertion point.
+  void validateBoundsValueCache();
+  void resetBoundsValueCache();
+  /// Keep the entries of BoundsValueCache for Succeeded, the block that the
+  /// dynamic check at the current insertion point branches to when it
+  /// succeeds.
+  void continueBoundsValueCache(llvm::BasicBlock *Succeeded);
+
 public:
   /// getBoundsTemporaryLValueMapping - Given a bounds temporary (which
   /// must be mapped to an l-value), return its mapping.
@@ -3196,29 +3264,104 @@ public:
   void EmitAsmStmt(const AsmStmt &S);
 
   void EmitExplicitDynamicCheck(const Expr *Condition);
-  void EmitDynamicNonNullCheck(const Address BaseAddr, const QualType BaseTy);
-  void EmitDynamicNonNullCheck(llvm::Value *Val, const QualType BaseTy);
-  void EmitDynamicOverflowCheck(const Address BaseAddr, const QualType BaseTy,
-                                const Address PtrAddr);
+  void EmitDynamicNonNullCheck(const Address BaseAddr, const QualType BaseTy,
+                               SourceLocation Loc);
+  void EmitDynamicNonNullCheck(llvm::Value *Val, const QualType BaseTy,
+                               SourceLocation Loc);
+  /// \brief Return Result, the result of arithmetic on the checked pointer
+  /// Base of type BaseTy, or a null pointer if Base is null. This replaces the
+  /// non-null check of the arithmetic with
+  /// -fcheckedc-propagate-null-ptr-arith.
+  llvm::Value *EmitDynamicNonNullArith(llvm::Value *Base, llvm::Value *Result,
+                                       const QualType BaseTy);
+  /// \brief Emit a dynamic check that the arithmetic on the checked pointer
+  /// Base of type BaseTy did not overflow, given the i1 value Overflows. The
+  /// null check of the arithmetic, if enabled, is part of the same check.
+  void EmitDynamicOverflowCheck(llvm::Value *Base, llvm::Value *Overflows,
+                                const QualType BaseTy, SourceLocation Loc);
   /// \brief Emit a dynamic bounds check.
   // - PtrAddress is the value that is being checked to see if it is in bounds.
   // - Bounds are the required bounds for PtrAddress.
   // - ValueToStore is optional and is used for bounds checking writes to
   //   NUL-terminated pointers.
+  // - Loc is the location of the memory access.
+  // - ProvenSafe is true if the bounds check was proved to succeed during
+  //   semantic analysis. No check is emitted in this case.
+  // - LowerProven is true if the lower bound comparison was proved to
+  //   succeed during semantic analysis.
+  // - NonNullCheck is optional and is a condition that is checked together
+  //   with the bounds, in the same branch.
   void EmitDynamicBoundsCheck(const Address PtrAddr,
                               const BoundsExpr *Bounds,
                               BoundsCheckKind Kind,
-                              llvm::Value *ValueToStore);
+                              llvm::Value *ValueToStore,
+                              SourceLocation Loc,
+                              bool ProvenSafe = false,
+                              bool LowerProven = false,
+                              llvm::Value *NonNullCheck = nullptr,
+                              bool UncheckedPtr = false);
+  /// \brief Emit the non-null check of BaseAddr, the base of a memory access
+  /// of type BaseTy, and the bounds check of PtrAddr. With
+  /// -fcheckedc-fuse-null-checks, both are checked by a single branch when
+  /// the bounds check is an ordinary range check.
+  void EmitDynamicNonNullAndBoundsCheck(const Address BaseAddr,
+                                        const QualType BaseTy,
+                                        const Address PtrAddr,
+                                        const BoundsExpr *Bounds,
+                                        BoundsCheckKind Kind,
+                                        SourceLocation Loc,
+                                        bool ProvenSafe = false,
+                                        bool LowerProven = false);
+  /// \brief Emit the pointer value of the bounds expression E of a dynamic
+  /// bounds check, reusing the value emitted by an earlier check for an
+  /// equivalent expression if nothing can have changed it since.
+  Address EmitBoundsPointer(const Expr *E);
+  /// \brief Emit the size in bytes of Count elements of size ElemSize, as an
+  /// integer of pointer width, reusing earlier values as EmitBoundsPointer
+  /// does.
+  llvm::Value *EmitBoundsRangeSize(const Expr *Count, CharUnits ElemSize);
   void EmitDynamicBoundsCastCheck(const Address BaseAddr,
                                   const BoundsExpr *CastBounds,
-                                  const BoundsExpr *SubExprBounds);
-  void EmitDynamicCheckBlocks(llvm::Value *Condition);
-  llvm::BasicBlock *EmitDynamicCheckFailedBlock();
+                                  const BoundsExpr *SubExprBounds,
+                                  SourceLocation Loc,
+                                  const Expr *Base = nullptr);
+  void EmitDynamicCheckBlocks(llvm::Value *Condition, SourceLocation Loc,
+                              StringRef Kind);
+  /// \brief Return true if dynamic checks of kind Kind are emitted.
+  bool isCheckKindEnabled(CodeGenOptions::CheckedCCheckKind Kind) const;
+  /// \brief Emit the conditional branch for a dynamic check, branching to
+  /// Succeeded if Condition is true and to Failed otherwise.
+  llvm::BranchInst *EmitDynamicCheckBranch(llvm::Value *Condition,
+                                           llvm::BasicBlock *Succeeded,
+                                           llvm::BasicBlock *Failed);
+  /// \brief The site of a dynamic check: the record of its counters, if
+  /// failed checks are counted or check executions are profiled, and its
+  /// identifier for the check failure handler, if failures call the handler.
+  struct DynamicCheckSite {
+    llvm::GlobalVariable *Counters = nullptr;
+    llvm::ConstantInt *FailureID = nullptr;
+  };
+  /// \brief Emit the site of a dynamic check of kind Kind at Loc, and count
+  /// the execution of the check if check executions are profiled.
+  DynamicCheckSite EmitDynamicCheckSite(SourceLocation Loc, StringRef Kind);
+  /// \brief Increment the counter at index Field of the dynamic check record
+  /// Site.
+  void EmitDynamicCheckCounterIncrement(llvm::GlobalVariable *Site,
+                                        unsigned Field);
+  /// \brief Create a failure block for a dynamic check. The block is added to
+  /// the end of the function by FinishFunction.
+  llvm::BasicBlock *createDynamicCheckFailedBlock(const Twine &Name);
+  /// \brief Emit the block a dynamic check at Site branches to when it fails.
+  /// The block traps, or calls the check failure handler, unless failed
+  /// checks are counted, in which case it continues at Continue.
+  llvm::BasicBlock *EmitDynamicCheckFailedBlock(DynamicCheckSite Site,
+                                                llvm::BasicBlock *Continue);
   llvm::BasicBlock *EmitNulltermWriteAdditionalCheck(const Address PtrAddr,
                                                      const Address Upper,
                                                      llvm::Value *LowerChk,
                                                      llvm::Value *Val,
-                                                     llvm::BasicBlock *Suceeded);
+                                                     llvm::BasicBlock *Suceeded,
+                                                     DynamicCheckSite Site);
   BoundsExpr *GetNullTermBoundsCheck(Expr *LHS);
 
   llvm::Value *EmitBoundsCast(CastExpr *CE);
@@ -456,6 +456,10 @@ void CodeGenModule::Release() {
   EmitCXXGlobalCleanUpFunc();
   registerGlobalDtorsWithAtExit();
   EmitCXXThreadLocalInitFunc();
+  if (HasCheckedCCheckSites)
+    EmitCheckedCCheckCountDump();
+  if (CheckedCCheckFailureHandler)
+    EmitCheckedCCheckFailureHandler();
   if (ObjCRuntime)
     if (llvm::Function *ObjCInitFunction = ObjCRuntime->ModuleInitFunction())
       AddGlobalCtor(ObjCInitFunction);
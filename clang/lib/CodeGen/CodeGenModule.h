@@ -418,6 +418,25 @@ private:
 
   llvm::StringMap<llvm::GlobalVariable *> CFConstantStringMap;
 
+  /// The type of the records for the sites of counted Checked C dynamic
+  /// checks.
+  llvm::StructType *CheckedCCheckSiteTy = nullptr;
+
+  /// The type of the entries of the table of Checked C dynamic check sites,
+  /// and the number of entries emitted so far.
+  llvm::StructType *CheckedCCheckSiteTableTy = nullptr;
+  unsigned NumCheckedCCheckSiteTableEntries = 0;
+
+  /// Whether the module contains sites of counted Checked C dynamic checks
+  /// whose counts must be dumped when the program exits.
+  bool HasCheckedCCheckSites = false;
+
+  /// The handler that failing Checked C dynamic checks call, if any, and the
+  /// sites of the checks, indexed by the identifiers passed to the handler.
+  llvm::Function *CheckedCCheckFailureHandler = nullptr;
+  llvm::StructType *CheckedCCheckFailureSiteTy = nullptr;
+  std::vector<llvm::Constant *> CheckedCCheckFailureSites;
+
   llvm::DenseMap<llvm::Constant *, llvm::GlobalVariable *> ConstantStringMap;
   llvm::DenseMap<const Decl*, llvm::Constant *> StaticLocalDeclMap;
   llvm::DenseMap<const Decl*, llvm::GlobalVariable*> StaticLocalDeclGuardMap;
@@ -1260,6 +1279,32 @@ public:
                                    const AnnotateAttr *AA,
                                    SourceLocation L);
 
+  /// Emit the record for a counted or profiled Checked C dynamic check of
+  /// kind Kind at Loc. The record is {i64, i64, i8 *, i32, i32, i8 *}: the
+  /// number of times the check failed and was executed, the file name, line
+  /// and column of the check, and its kind.
+  llvm::GlobalVariable *EmitCheckedCCheckSite(SourceLocation Loc,
+                                              StringRef Kind);
+
+  /// Add a Checked C dynamic check of kind Kind at Loc in the function
+  /// FnName to the table of check sites of the object file. An entry is
+  /// {i8 *, i32, i32, i8 *, i8 *, i32}: the file name, line and column of the
+  /// check, its kind, the name of its function and the identifier of the
+  /// site. The identifiers number the entries of the module from 0, in the
+  /// order in which the checks are emitted, which is also the order of the
+  /// identifiers passed to the check failure handler.
+  void EmitCheckedCCheckSiteTableEntry(SourceLocation Loc, StringRef Kind,
+                                       StringRef FnName);
+
+  /// Get the identifier of a Checked C dynamic check of kind Kind at Loc,
+  /// which a failure of the check passes to the check failure handler.
+  llvm::ConstantInt *getCheckedCCheckFailureID(SourceLocation Loc,
+                                               StringRef Kind);
+
+  /// Get the check failure handler of the module, void (i32), which is
+  /// emitted at the end of the module.
+  llvm::Function *getCheckedCCheckFailureHandler();
+
   /// Add global annotations that are set on D, for the global GV. Those
   /// annotations are emitted during finalization of the LLVM code.
   void AddGlobalAnnotations(const ValueDecl *D, llvm::GlobalValue *GV);
@@ -1493,6 +1538,16 @@ private:
   /// suitable for use as a LLVM constructor or destructor array. Clears Fns.
   void EmitCtorList(CtorList &Fns, const char *GlobalName);
 
+  /// Emit a function that prints the counts of the counted or profiled
+  /// Checked C dynamic checks and register it to run when the program exits.
+  /// The function prints with dprintf, so it must not be called from a
+  /// signal handler.
+  void EmitCheckedCCheckCountDump();
+
+  /// Emit the body of the check failure handler, which prints the site of
+  /// the failed check and traps.
+  void EmitCheckedCCheckFailureHandler();
+
   /// Emit any needed decls for which code generation was deferred.
   void EmitDeferred();
 
@@ -5880,12 +5880,39 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_extension);
   Args.AddLastArg(CmdArgs, options::OPT_fno_checkedc_extension);
   Args.AddLastArg(CmdArgs, options::OPT_fdump_inferred_bounds);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_bounds_proof_budget_EQ);
   Args.AddLastArg(CmdArgs, options::OPT_f3c_tool);
   Args.AddLastArg(CmdArgs, options::OPT_finject_verifier_calls);
   Args.AddLastArg(CmdArgs, options::OPT_funchecked_pointers_dynamic_check);
 
   Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_null_ptr_arith,
                            options::OPT_fno_checkedc_null_ptr_arith);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_propagate_null_ptr_arith,
+                           options::OPT_fno_checkedc_propagate_null_ptr_arith);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_pointer_overflow_checks,
+                           options::OPT_fno_checkedc_pointer_overflow_checks);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_shared_check_failure,
+                           options::OPT_fno_checkedc_shared_check_failure);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_cold_check_failure,
+                           options::OPT_fno_checkedc_cold_check_failure);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_hoist_bounds_checks,
+                           options::OPT_fno_checkedc_hoist_bounds_checks);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_fuse_null_checks,
+                           options::OPT_fno_checkedc_fuse_null_checks);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_reuse_bounds_values,
+                           options::OPT_fno_checkedc_reuse_bounds_values);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_assume_proven_bounds,
+                           options::OPT_fno_checkedc_assume_proven_bounds);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_dynamic_check_mode_EQ);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_dynamic_check_profile,
+                           options::OPT_fno_checkedc_dynamic_check_profile);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_check_site_table,
+                           options::OPT_fno_checkedc_check_site_table);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_checks_EQ);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_check_failure_handler,
+                           options::OPT_fno_checkedc_check_failure_handler);
+  Args.AddLastArg(CmdArgs, options::OPT_fcheckedc_sanitize_unchecked_only,
+                           options::OPT_fno_checkedc_sanitize_unchecked_only);
 
   // -fno-declspec is default, except for PS4.
   if (Args.hasFlag(options::OPT_fdeclspec, options::OPT_fno_declspec,
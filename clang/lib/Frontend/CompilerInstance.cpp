@@ -31,6 +31,7 @@
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Lex/PreprocessorOptions.h"
+#include "clang/Sema/BoundsCheckReuseCache.h"
 #include "clang/Sema/CodeCompleteConsumer.h"
 #include "clang/Sema/Sema.h"
 #include "clang/Serialization/ASTReader.h"
@@ -637,6 +638,15 @@ void CompilerInstance::createSema(TranslationUnitKind TUKind,
                                   CodeCompleteConsumer *CompletionConsumer) {
   TheSema.reset(new Sema(getPreprocessor(), getASTContext(), getASTConsumer(),
                          TUKind, CompletionConsumer));
+  // Reusing the Checked C bounds checking diagnostics of a function skips
+  // what the checker records in the AST, so only do it when no code is
+  // generated from the AST.
+  if (getLangOpts().CheckedCReuseBoundsChecks &&
+      getFrontendOpts().ProgramAction == frontend::ParseSyntaxOnly) {
+    if (!BoundsCheckReuse)
+      BoundsCheckReuse = std::make_shared<BoundsCheckReuseCache>();
+    TheSema->BoundsCheckReuse = BoundsCheckReuse;
+  }
   // Attach the external sema source if there is any.
   if (ExternalSemaSrc) {
     TheSema->addExternalSource(ExternalSemaSrc.get());
@@ -1325,6 +1325,82 @@ bool CompilerInvocation::ParseCodeGenArgs(CodeGenOptions &Opts, ArgList &Args,
   Opts.EmitVersionIdentMetadata = Args.hasFlag(OPT_Qy, OPT_Qn, true);
 
   Opts.CheckedCNullPtrArith = !Args.hasArg(OPT_fno_checkedc_null_ptr_arith);
+  Opts.CheckedCPropagateNullPtrArith =
+    Args.hasFlag(OPT_fcheckedc_propagate_null_ptr_arith,
+                 OPT_fno_checkedc_propagate_null_ptr_arith, false);
+  Opts.CheckedCPointerOverflowChecks =
+    Args.hasFlag(OPT_fcheckedc_pointer_overflow_checks,
+                 OPT_fno_checkedc_pointer_overflow_checks, false);
+  Opts.CheckedCSharedCheckFailure =
+    Args.hasFlag(OPT_fcheckedc_shared_check_failure,
+                 OPT_fno_checkedc_shared_check_failure, false);
+  Opts.CheckedCColdCheckFailure =
+    Args.hasFlag(OPT_fcheckedc_cold_check_failure,
+                 OPT_fno_checkedc_cold_check_failure, true);
+  Opts.CheckedCHoistBoundsChecks =
+    Args.hasFlag(OPT_fcheckedc_hoist_bounds_checks,
+                 OPT_fno_checkedc_hoist_bounds_checks, false);
+  Opts.CheckedCFuseNullChecks =
+    Args.hasFlag(OPT_fcheckedc_fuse_null_checks,
+                 OPT_fno_checkedc_fuse_null_checks, false);
+  Opts.CheckedCReuseBoundsValues =
+    Args.hasFlag(OPT_fcheckedc_reuse_bounds_values,
+                 OPT_fno_checkedc_reuse_bounds_values, false);
+  Opts.CheckedCAssumeProvenBounds =
+    Args.hasFlag(OPT_fcheckedc_assume_proven_bounds,
+                 OPT_fno_checkedc_assume_proven_bounds, false);
+  Opts.CheckedCDynamicCheckProfile =
+    Args.hasFlag(OPT_fcheckedc_dynamic_check_profile,
+                 OPT_fno_checkedc_dynamic_check_profile, false);
+  Opts.CheckedCCheckSiteTable =
+    Args.hasFlag(OPT_fcheckedc_check_site_table,
+                 OPT_fno_checkedc_check_site_table, false);
+  Opts.CheckedCCheckFailureHandler =
+    Args.hasFlag(OPT_fcheckedc_check_failure_handler,
+                 OPT_fno_checkedc_check_failure_handler, false);
+  Opts.CheckedCSanitizeUncheckedOnly =
+    Args.hasFlag(OPT_fcheckedc_sanitize_unchecked_only,
+                 OPT_fno_checkedc_sanitize_unchecked_only, false);
+  if (Arg *A = Args.getLastArg(OPT_fcheckedc_dynamic_check_mode_EQ)) {
+    StringRef Name = A->getValue();
+    unsigned Mode = llvm::StringSwitch<unsigned>(Name)
+                        .Case("trap", CodeGenOptions::CheckedCCheckTrap)
+                        .Case("count", CodeGenOptions::CheckedCCheckCount)
+                        .Default(~0U);
+    if (Mode == ~0U) {
+      Diags.Report(diag::err_drv_invalid_value)
+          << A->getAsString(Args) << Name;
+      Success = false;
+    } else {
+      Opts.setCheckedCDynamicCheckMode(
+          static_cast<CodeGenOptions::CheckedCDynamicCheckModeKind>(Mode));
+    }
+  }
+  if (Arg *A = Args.getLastArg(OPT_fcheckedc_checks_EQ)) {
+    unsigned Kinds = 0;
+    for (StringRef Name : A->getValues()) {
+      unsigned Kind =
+          llvm::StringSwitch<unsigned>(Name)
+              .Case("all", CodeGenOptions::CheckedCCheckAllKinds)
+              .Case("none", 0)
+              .Case("nonnull", CodeGenOptions::CheckedCCheckNonNull)
+              .Case("range", CodeGenOptions::CheckedCCheckRange)
+              .Case("cast", CodeGenOptions::CheckedCCheckCast)
+              .Case("nt-write", CodeGenOptions::CheckedCCheckNullTermWrite)
+              .Case("explicit", CodeGenOptions::CheckedCCheckExplicit)
+              .Default(~0U);
+      if (Kind == ~0U) {
+        Diags.Report(diag::err_drv_invalid_value)
+            << A->getAsString(Args) << Name;
+        Success = false;
+      } else
+        Kinds |= Kind;
+    }
+    Opts.CheckedCEnabledChecks = Kinds;
+    if (Kinds != CodeGenOptions::CheckedCCheckAllKinds)
+      Diags.Report(diag::warn_drv_checkedc_checks_disabled)
+          << A->getAsString(Args);
+  }
 
   return Success;
 }
@@ -2428,6 +2504,23 @@ void CompilerInvocation::ParseLangArgs(LangOptions &Opts, ArgList &Args,
   if (Args.hasArg(OPT_fdump_synthesized_members))
     Opts.DumpSynthesizedMembers = true;
 
+  if (Args.hasArg(OPT_fdump_checkedc_analysis_stats))
+    Opts.DumpCheckedCAnalysisStats = true;
+
+  if (Args.hasArg(OPT_fcheckedc_deferred_bounds_checking))
+    Opts.CheckedCDeferBoundsChecking = true;
+
+  if (Args.hasArg(OPT_fcheckedc_call_graph_order)) {
+    Opts.CheckedCDeferBoundsChecking = true;
+    Opts.CheckedCCallGraphOrder = true;
+  }
+
+  if (Args.hasArg(OPT_fcheckedc_reuse_bounds_checks))
+    Opts.CheckedCReuseBoundsChecks = true;
+
+  Opts.CheckedCBoundsProofBudget =
+      getLastArgIntValue(Args, OPT_fcheckedc_bounds_proof_budget_EQ, 0, Diags);
+
   // -ffixed-point
   Opts.FixedPoint =
       Args.hasFlag(OPT_ffixed_point, OPT_fno_fixed_point, /*Default=*/false) &&
@@ -2978,6 +3071,15 @@ bool CompilerInvocation::CreateFromArgs(CompilerInvocation &Res,
                   Diags);
     if (Res.getFrontendOpts().ProgramAction == frontend::RewriteObjC)
       LangOpts.ObjCExceptions = 1;
+    // Deferred bounds checking runs the Checked C analyses after the AST
+    // consumer has seen a function, so code generation would not see the
+    // results of the analyses.  Reusing the diagnostics of a function skips
+    // the analyses altogether.  Only honor them when no code is generated.
+    if (Res.getFrontendOpts().ProgramAction != frontend::ParseSyntaxOnly) {
+      LangOpts.CheckedCDeferBoundsChecking = 0;
+      LangOpts.CheckedCCallGraphOrder = 0;
+      LangOpts.CheckedCReuseBoundsChecks = 0;
+    }
     if (T.isOSDarwin() && DashX.isPreprocessed()) {
       // Supress the darwin-specific 'stdlibcxx-not-found' diagnostic for
       // preprocessed input as we don't expect it to be used with -std=libc++
@@ -7358,27 +7358,43 @@ void Parser::ParseParameterDeclarationClause(
             ConsumeToken();
           BoundsAnnotations Annots;
           // Bounds expressions are delay parsed because they can refer to
-          // parameters declared after this one.
-          std::unique_ptr<CachedTokens> DeferredBoundsToks { new CachedTokens };
-          if (ParseBoundsAnnotations(ParmDeclarator, BoundsColonLoc,
-                                     Annots, &DeferredBoundsToks)) {
-            SkipUntil(tok::comma, tok::r_paren, StopAtSemi | StopBeforeMatch);
-            Param->setInvalidDecl();
-          }
-          else {
-            if (!DeferredBoundsToks->empty()) {
-              deferredBoundsExpressions.emplace_back(
-                Param, ParmDeclarator, std::move(DeferredBoundsToks));
-              // If an interop type expression doesn't exist, try synthesizing
-              // one implied by the presence of a bounds expression.
-              if (!Annots.getInteropTypeExpr()) {
-                InteropTypeExpr *IT = Actions.SynthesizeInteropTypeExpr(Param->getType(), true);
-                Annots.setInteropTypeExpr(IT);
+          // parameters declared after this one.  The common 'count(n)' form
+          // whose 'n' is an earlier parameter is parsed right away instead,
+          // in the same order of actions as a delay parsed one.
+          if (IsCountOfEarlierParam()) {
+            bool Error = ParseBoundsAnnotations(ParmDeclarator, BoundsColonLoc,
+                                                Annots, nullptr, false, Param);
+            BoundsAnnotations ITypeAnnots;
+            ITypeAnnots.setInteropTypeExpr(
+              Actions.SynthesizeInteropTypeExpr(Param->getType(), true));
+            if (ITypeAnnots.getInteropTypeExpr())
+              Actions.ActOnBoundsDecl(Param, ITypeAnnots);
+            if (Error)
+              Actions.ActOnInvalidBoundsDecl(Param);
+            else
+              Actions.ActOnBoundsDecl(Param, Annots, true);
+          } else {
+            std::unique_ptr<CachedTokens> DeferredBoundsToks { new CachedTokens };
+            if (ParseBoundsAnnotations(ParmDeclarator, BoundsColonLoc,
+                                       Annots, &DeferredBoundsToks)) {
+              SkipUntil(tok::comma, tok::r_paren, StopAtSemi | StopBeforeMatch);
+              Param->setInvalidDecl();
+            }
+            else {
+              if (!DeferredBoundsToks->empty()) {
+                deferredBoundsExpressions.emplace_back(
+                  Param, ParmDeclarator, std::move(DeferredBoundsToks));
+                // If an interop type expression doesn't exist, try synthesizing
+                // one implied by the presence of a bounds expression.
+                if (!Annots.getInteropTypeExpr()) {
+                  InteropTypeExpr *IT = Actions.SynthesizeInteropTypeExpr(Param->getType(), true);
+                  Annots.setInteropTypeExpr(IT);
+                }
               }
+              // Set the interop type bounds expression, if one exists.
+              if (Annots.getInteropTypeExpr())
+                Actions.ActOnBoundsDecl(Param, Annots);
             }
-            // Set the interop type bounds expression, if one exists.
-            if (Annots.getInteropTypeExpr())
-              Actions.ActOnBoundsDecl(Param, Annots);
           }
         }
       }
@@ -4063,6 +4063,29 @@ bool Parser::ConsumeAndStoreBoundsExpression(CachedTokens &Toks) {
   return result;
 }
 
+/// Return true if the annotation at the current token of a parameter
+/// declaration is just 'count(n)' or 'byte_count(n)', where 'n' is a parameter
+/// declared earlier in the same prototype.  Such bounds can't refer to a later
+/// parameter, so they don't need to be delay parsed.  The tokens are only
+/// looked at, not consumed.
+bool Parser::IsCountOfEarlierParam() {
+  if (!Tok.is(tok::identifier) ||
+      (Tok.getIdentifierInfo() != Ident_count &&
+       Tok.getIdentifierInfo() != Ident_byte_count))
+    return false;
+  if (!NextToken().is(tok::l_paren))
+    return false;
+  const Token &Arg = GetLookAheadToken(2);
+  if (!Arg.is(tok::identifier) || !GetLookAheadToken(3).is(tok::r_paren) ||
+      !GetLookAheadToken(4).isOneOf(tok::comma, tok::r_paren))
+    return false;
+  NamedDecl *ND = Actions.LookupSingleName(getCurScope(),
+                                           Arg.getIdentifierInfo(),
+                                           Arg.getLocation(),
+                                           Sema::LookupOrdinaryName);
+  return ND && isa<ParmVarDecl>(ND) && getCurScope()->isDeclScope(ND);
+}
+
 /// Given a list of tokens that have the same shape as a bounds expression or
 /// a where clause parse them to create a bounds expression or a where clause
 /// respectively. Delete the list of tokens at the end. Return true if there
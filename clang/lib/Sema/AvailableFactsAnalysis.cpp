@@ -16,161 +16,232 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Sema/AvailableFactsAnalysis.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/TimeProfiler.h"
+
+#define DEBUG_TYPE "checkedc-available-facts"
+
+ALWAYS_ENABLED_STATISTIC(NumFactsFunctions,
+                         "Number of functions analyzed for available facts.");
+ALWAYS_ENABLED_STATISTIC(NumFactsComparisons,
+                         "Number of distinct comparisons collected as facts.");
+ALWAYS_ENABLED_STATISTIC(NumFactsBlockVisits,
+                         "Number of block visits by the available facts "
+                         "fixpoint computation.");
+ALWAYS_ENABLED_STATISTIC(NumFactsIterationLimits,
+                         "Number of available facts computations stopped by "
+                         "the iteration limit.");
 
 namespace clang {
 class Sema;
 
-void AvailableFactsAnalysis::Analyze() {
+void AvailableFactsAnalysis::Analyze(const CheckedCFGContext &Ctx) {
   assert(Cfg && "expected CFG to exist");
+  assert(Ctx.getCFG() == Cfg && "expected the block ordering of the CFG");
+  llvm::TimeTraceScope TimeScope("AvailableFactsAnalysis");
+  ++NumFactsFunctions;
 
-  std::vector<Comparison> AllComparisons;
   std::queue<ElevatedCFGBlock *> WorkList;
   std::vector<ElevatedCFGBlock *> Blocks;
 
-  PostOrderCFGView POView = PostOrderCFGView(Cfg);
-  unsigned int MaxBlockID = 0;
-  std::vector<unsigned int> InWorkList;
-  for (const CFGBlock *Block : POView)
-    if (Block->getBlockID() > MaxBlockID)
-      MaxBlockID = Block->getBlockID();
-
-  BlockIDs.clear();
-  BlockIDs.resize(MaxBlockID + 1, -1);
-  for (const CFGBlock *Block : POView) {
+  // Blocks is indexed by the position of each block in the reverse post
+  // order.
+  CFGCtx = &Ctx;
+  llvm::BitVector InWorkList(Ctx.getNumBlockIDs());
+  Blocks.reserve(Ctx.getNumReachableBlocks());
+  for (const CFGBlock *Block : Ctx) {
     auto NewBlock = new ElevatedCFGBlock(Block);
     WorkList.push(NewBlock);
-    InWorkList.push_back(Block->getBlockID());
+    InWorkList.set(Block->getBlockID());
     Blocks.push_back(NewBlock);
-    BlockIDs[Block->getBlockID()] = Blocks.size() - 1;
   }
 
-  // Compute Gen Sets
-  for (auto B : Blocks) {
-    if (const Stmt *Term = B->Block->getTerminatorStmt()) {
+  // Compute Gen Sets. Each distinct comparison is numbered once, and the
+  // dataflow sets are bit vectors indexed by comparison number.
+  //
+  // The operands of comparisons are numbered by their structure, so that
+  // comparisons of the same expressions in different conditions (e.g. `i < n`
+  // tested in several if statements) are the same comparison. A comparison is
+  // then identified by the pair of the numbers of its operands, and the first
+  // comparison seen with those operands represents all of them.
+  std::vector<Comparison> AllComparisons;
+  std::map<llvm::FoldingSetNodeID, unsigned> OperandIndex;
+  llvm::DenseMap<std::pair<unsigned, unsigned>, unsigned> ComparisonIndex;
+  auto GetOperandIndex = [&](const Expr *E) {
+    llvm::FoldingSetNodeID ID;
+    E->Profile(ID, S.Context, /*Canonical=*/true);
+    return OperandIndex.insert({ID, OperandIndex.size()}).first->second;
+  };
+  auto GetComparisonIndex = [&](const Comparison &C) {
+    std::pair<unsigned, unsigned> Key(GetOperandIndex(C.first),
+                                      GetOperandIndex(C.second));
+    auto It = ComparisonIndex.insert({Key, AllComparisons.size()});
+    if (It.second)
+      AllComparisons.push_back(C);
+    return It.first->second;
+  };
+
+  std::vector<std::pair<std::vector<unsigned>, std::vector<unsigned>>>
+    GenIndices(Blocks.size());
+  for (std::size_t Index = 0; Index < Blocks.size(); Index++) {
+    if (const Stmt *Term = Blocks[Index]->Block->getTerminatorStmt()) {
       if(const IfStmt *IS = dyn_cast<IfStmt>(Term)) {
-        ComparisonSet Comparisons;
-        ExtractComparisons(IS->getCond(), Comparisons);
-        B->GenThen.insert(Comparisons.begin(), Comparisons.end());
-
-        ComparisonSet NegatedComparisons;
-        ExtractNegatedComparisons(IS->getCond(), NegatedComparisons);
-        B->GenElse.insert(NegatedComparisons.begin(), NegatedComparisons.end());
+        ComparisonSet GenThen, GenElse;
+        ExtractComparisons(IS->getCond(), GenThen);
+        ExtractNegatedComparisons(IS->getCond(), GenElse);
+        for (const Comparison &C : GenThen)
+          GenIndices[Index].first.push_back(GetComparisonIndex(C));
+        for (const Comparison &C : GenElse)
+          GenIndices[Index].second.push_back(GetComparisonIndex(C));
       }
     }
-    AllComparisons.insert(AllComparisons.end(), B->GenThen.begin(), B->GenThen.end());
-    AllComparisons.insert(AllComparisons.end(), B->GenElse.begin(), B->GenElse.end());
+  }
+
+  unsigned NumComparisons = AllComparisons.size();
+  NumFactsComparisons += NumComparisons;
+  for (ElevatedCFGBlock *B : Blocks)
+    B->Resize(NumComparisons);
+  UnreachableBlock->Resize(NumComparisons);
+
+  for (std::size_t Index = 0; Index < Blocks.size(); Index++) {
+    for (unsigned CompInd : GenIndices[Index].first)
+      Blocks[Index]->GenThen.set(CompInd);
+    for (unsigned CompInd : GenIndices[Index].second)
+      Blocks[Index]->GenElse.set(CompInd);
   }
 
   // Which comparisons contain pointer derefs?
-  std::vector<bool> ComparisonContainsDeref;
-  for (auto C : AllComparisons) {
+  llvm::BitVector ComparisonContainsDeref(NumComparisons);
+  for (unsigned CompInd = 0; CompInd < NumComparisons; CompInd++) {
+    const Comparison &C = AllComparisons[CompInd];
     if (ContainsPointerDeref(C.first) || ContainsPointerDeref(C.second))
-      ComparisonContainsDeref.push_back(true);
-    else
-      ComparisonContainsDeref.push_back(false);
+      ComparisonContainsDeref.set(CompInd);
   }
 
-  // Which blocks contain potential pointer assignments?
-  std::vector<bool> PointerAssignmentInBlocks(Blocks.size(), false);
-  for (unsigned int Index = 0; Index < Blocks.size(); Index++) {
-    for (CFGElement Elem : *(Blocks[Index]->Block)) {
-      if (Elem.getKind() == CFGElement::Statement)
-        if (const Expr *E = dyn_cast<Expr>(Elem.castAs<CFGStmt>().getStmt()))
-          if (ContainsPointerAssignment(E)) {
-            PointerAssignmentInBlocks[Index] = true;
-            break;
-          }
+  // Which comparisons use each variable?
+  llvm::DenseMap<const VarDecl *, llvm::BitVector> ComparisonsUsingVar;
+  for (unsigned CompInd = 0; CompInd < NumComparisons; CompInd++) {
+    std::set<const VarDecl *> UsedVars;
+    CollectVariables(AllComparisons[CompInd], UsedVars);
+    for (const VarDecl *V : UsedVars) {
+      llvm::BitVector &Comparisons = ComparisonsUsingVar[V];
+      Comparisons.resize(NumComparisons);
+      Comparisons.set(CompInd);
     }
   }
 
   // Compute Kill Sets
-  for (auto B : Blocks) {
+  for (ElevatedCFGBlock *B : Blocks) {
     std::set<const VarDecl *> DefinedVars;
-    for (CFGElement Elem : *(B->Block))
-      if (Elem.getKind() == CFGElement::Statement)
-        CollectDefinedVars(Elem.castAs<CFGStmt>().getStmt(), DefinedVars);
-
-    for (auto E : AllComparisons)
-      for (auto V : DefinedVars)
-        if (ContainsVariable(E, V))
-          B->Kill.insert(E);
-  }
+    bool ContainsPointerAssignmentInBlock = false;
+    // A CFG element may be a subexpression of a later element in the same
+    // block. The definitions and pointer assignments in an element are
+    // collected once, and the walk of a later element stops at it.
+    llvm::SmallPtrSet<const Stmt *, 16> WalkedElements;
+    for (CFGElement Elem : *(B->Block)) {
+      if (Elem.getKind() != CFGElement::Statement)
+        continue;
+      const Stmt *St = Elem.castAs<CFGStmt>().getStmt();
+      if (!WalkedElements.insert(St).second)
+        continue;
+      CollectDefinedVars(St, DefinedVars, WalkedElements);
+      if (!ContainsPointerAssignmentInBlock)
+        if (const Expr *E = dyn_cast<Expr>(St))
+          ContainsPointerAssignmentInBlock =
+            ContainsPointerAssignment(E, WalkedElements);
+    }
 
-  // If an expression in a comparison contains a pointer deref, kill the comparison
-  // at any potential pointer assignment expression.
-  for (std::size_t CompInd = 0; CompInd < AllComparisons.size(); CompInd++)
-    if (ComparisonContainsDeref[CompInd])
-      for (std::size_t BlockInd = 0; BlockInd < Blocks.size(); BlockInd++)
-        if (PointerAssignmentInBlocks[BlockInd])
-          Blocks[BlockInd]->Kill.insert(AllComparisons[CompInd]);
+    for (const VarDecl *V : DefinedVars) {
+      auto It = ComparisonsUsingVar.find(V);
+      if (It != ComparisonsUsingVar.end())
+        B->Kill |= It->second;
+    }
+
+    // If an expression in a comparison contains a pointer deref, kill the
+    // comparison at any potential pointer assignment expression.
+    if (ContainsPointerAssignmentInBlock)
+      B->Kill |= ComparisonContainsDeref;
+  }
 
   // Iterative Worklist Algorithm
   unsigned int Iteration = 0;
   while (!WorkList.empty()) {
     ElevatedCFGBlock *CurrentBlock = WorkList.front();
-    InWorkList.erase(std::remove(InWorkList.begin(),
-                                 InWorkList.end(),
-                                 CurrentBlock->Block->getBlockID()),
-                                 InWorkList.end());
+    InWorkList.reset(CurrentBlock->Block->getBlockID());
     WorkList.pop();
+    ++NumFactsBlockVisits;
+    ++NumBlockVisits;
 
     // Update In set
-    ComparisonSet Intersecions;
+    llvm::BitVector Intersections(NumComparisons);
     bool FirstIteration = true;
     for (auto I : CurrentBlock->Block->preds()) {
       if (!I)
         continue;
+      const llvm::BitVector *PredOut = nullptr;
       if (I->succ_size() == 2) {
-        if (*(I->succ_begin()) == CurrentBlock->Block) {
-          if (FirstIteration) {
-            Intersecions = GetBlock(Blocks, I)->OutThen;
-            FirstIteration = false;
-          } else
-            Intersecions = Intersect(Intersecions, GetBlock(Blocks, I)->OutThen);
-        } else {
-          if (FirstIteration) {
-            Intersecions = GetBlock(Blocks, I)->OutElse;
-            FirstIteration = false;
-          } else
-            Intersecions = Intersect(Intersecions, GetBlock(Blocks, I)->OutElse);
-        }
-      } else if (I->succ_size() == 1) {
-        if (FirstIteration) {
-          Intersecions = GetBlock(Blocks, I)->OutThen;
-          FirstIteration = false;
-        } else
-          Intersecions = Intersect(Intersecions, GetBlock(Blocks, I)->OutThen);
-      }
+        if (*(I->succ_begin()) == CurrentBlock->Block)
+          PredOut = &GetBlock(Blocks, I)->OutThen;
+        else
+          PredOut = &GetBlock(Blocks, I)->OutElse;
+      } else if (I->succ_size() == 1)
+        PredOut = &GetBlock(Blocks, I)->OutThen;
+      else
+        continue;
+
+      if (FirstIteration) {
+        Intersections = *PredOut;
+        FirstIteration = false;
+      } else
+        Intersections &= *PredOut;
     }
-    CurrentBlock->In = Intersecions;
+    CurrentBlock->In = std::move(Intersections);
 
     // Update Out Set
-    ComparisonSet OldOutThen = CurrentBlock->OutThen;
-    ComparisonSet OldOutElse = CurrentBlock->OutElse;
-    ComparisonSet Diff = Difference(CurrentBlock->In, CurrentBlock->Kill);
-    CurrentBlock->OutThen = Union(Diff, CurrentBlock->GenThen);
-    CurrentBlock->OutElse = Union(Diff, CurrentBlock->GenElse);
+    llvm::BitVector Diff = CurrentBlock->In;
+    Diff.reset(CurrentBlock->Kill);
+    llvm::BitVector NewOutThen = Diff;
+    NewOutThen |= CurrentBlock->GenThen;
+    llvm::BitVector NewOutElse = std::move(Diff);
+    NewOutElse |= CurrentBlock->GenElse;
+
+    bool Changed = NewOutThen != CurrentBlock->OutThen ||
+                   NewOutElse != CurrentBlock->OutElse;
+    CurrentBlock->OutThen = std::move(NewOutThen);
+    CurrentBlock->OutElse = std::move(NewOutElse);
 
     // Recompute the Affected Blocks and _uniquely_ add them to the worklist
-    if (Differ(OldOutThen, CurrentBlock->OutThen) ||
-        Differ(OldOutElse, CurrentBlock->OutElse))
+    if (Changed)
       for (auto I : CurrentBlock->Block->succs()) {
         if (!I)
           continue;
-        if (std::find(InWorkList.begin(), InWorkList.end(), I->getBlockID()) ==
-            InWorkList.end()) {
-          InWorkList.push_back(I->getBlockID());
+        if (!InWorkList.test(I->getBlockID())) {
+          InWorkList.set(I->getBlockID());
           WorkList.push(GetBlock(Blocks, I));
         }
       }
 
-    if (++Iteration > (2 * Blocks.size()))
+    if (++Iteration > (2 * Blocks.size())) {
+      ++NumFactsIterationLimits;
       break;
+    }
 
   }
 
-  for (auto B : Blocks)
-    Facts.push_back(std::pair<ComparisonSet, ComparisonSet>(B->In, B->Kill));
+  // Materialize the In and Kill sets of each block as sets of comparisons.
+  // The sets are built in place in Facts rather than copied into it.
+  Facts.clear();
+  Facts.resize(Blocks.size());
+  for (std::size_t Index = 0; Index < Blocks.size(); Index++) {
+    ElevatedCFGBlock *B = Blocks[Index];
+    ComparisonSet &In = Facts[Index].first;
+    ComparisonSet &Kill = Facts[Index].second;
+    for (unsigned CompInd : B->In.set_bits())
+      In.insert(AllComparisons[CompInd]);
+    for (unsigned CompInd : B->Kill.set_bits())
+      Kill.insert(AllComparisons[CompInd]);
+  }
 
   while(!Blocks.empty()) {
     delete Blocks.back();
@@ -186,86 +257,47 @@ void AvailableFactsAnalysis::Next() {
   CurrentIndex++;
 }
 
-// This function fills `ComparisonFacts` with pairs (Expr1, Expr2) where
-// Expr1 <= Expr2.
+// This function returns the pairs (Expr1, Expr2) where Expr1 <= Expr2.
 // These comparisons correspond to the current block.
-void AvailableFactsAnalysis::GetFacts(std::pair<ComparisonSet, ComparisonSet> &CFacts) {
-  CFacts = Facts[CurrentIndex];
+const std::pair<ComparisonSet, ComparisonSet> &
+AvailableFactsAnalysis::GetFacts() const {
+  return Facts[CurrentIndex];
+}
+
+// Bounds checking visits each block once, after the facts have been dumped
+// (if they are dumped at all), so it takes the facts of each block rather than
+// copying the sets.
+void AvailableFactsAnalysis::TakeFacts(std::pair<ComparisonSet, ComparisonSet> &CFacts) {
+  CFacts = std::move(Facts[CurrentIndex]);
 }
 
 // Given a vector of `Blocks` and a CFGBlock `I`, this function returns the corresponding
 // `ElevatedCFGBlock`.
 // If it fails to find the object, an `UnreachleBlock` will be returned.
-AvailableFactsAnalysis::ElevatedCFGBlock* AvailableFactsAnalysis::GetBlock(std::vector<ElevatedCFGBlock *>& Blocks, CFGBlock *I) {
-  if (BlockIDs[I->getBlockID()] != -1)
-    return Blocks[BlockIDs[I->getBlockID()]];
+AvailableFactsAnalysis::ElevatedCFGBlock* AvailableFactsAnalysis::GetBlock(std::vector<ElevatedCFGBlock *>& Blocks, const CFGBlock *I) {
+  int RPONum = CFGCtx->getRPONum(I);
+  if (RPONum != -1)
+    return Blocks[RPONum];
   return UnreachableBlock;
 }
 
-// Given two sets S1 and S2, the return value is S1 - S2.
-ComparisonSet AvailableFactsAnalysis::Difference(ComparisonSet &S1, ComparisonSet &S2) {
- if (S2.size() == 0)
-    return S1;
-  ComparisonSet Result;
-  for (auto E1 : S1)
-    if (S2.find(E1) == S2.end())
-      Result.insert(E1);
-  return Result;
-}
-
-// Given two sets S1 and S2, the return value is the union of these sets.
-ComparisonSet AvailableFactsAnalysis::Union(ComparisonSet &S1, ComparisonSet &S2) {
-  if (S1.size() == 0)
-    return S2;
-  if (S2.size() == 0)
-    return S1;
-  ComparisonSet Result(S1);
-  Result.insert(S2.begin(), S2.end());
-  return Result;
-}
-
-// Given two sets S1 and S2, this function returns true if the two sets
-// are not equal.
-// Equality means that their sizes are the same, and every member of S1 is found in
-// S2 and vice versa.
-bool AvailableFactsAnalysis::Differ(ComparisonSet &S1, ComparisonSet &S2) {
-  if (S1.size() != S2.size())
-    return true;
-  for (auto E : S1)
-    if (S2.find(E) == S2.end())
-      return true;
-  return false;
-}
-
-// Given two sets S1 and S2, the return value is the intersection of these sets.
-ComparisonSet AvailableFactsAnalysis::Intersect(ComparisonSet &S1, ComparisonSet &S2) {
-  if (S1.size() == 0)
-    return S1;
-  if (S2.size() == 0)
-    return S2;
-  ComparisonSet Result;
-  for (auto E1 : S1)
-    if (S2.find(E1) != S2.end())
-      Result.insert(E1);
-  return Result;
-}
-
-// This function returns true if variable `V` is used in the comparison `I`.
-bool AvailableFactsAnalysis::ContainsVariable(Comparison& I, const VarDecl *V) {
+// This function collects the variables used in the comparison `C`.
+// The expressions in `C` are visited in order, and the collection stops at
+// the first cast that is not an LValueToRValue cast.
+void AvailableFactsAnalysis::CollectVariables(const Comparison &C,
+                                              std::set<const VarDecl *> &Vars) {
   std::set<const Expr *> Exprs;
-  CollectExpressions(I.first, Exprs);
-  CollectExpressions(I.second, Exprs);
+  CollectExpressions(C.first, Exprs);
+  CollectExpressions(C.second, Exprs);
   for (auto InnerExpr : Exprs) {
     if (const CastExpr *CE = dyn_cast<CastExpr>(InnerExpr)) {
       if (CE->getCastKind() != CK_LValueToRValue)
-        return false;
+        return;
       if (const DeclRefExpr *DRE = dyn_cast<DeclRefExpr>(CE->getSubExpr()))
         if (const VarDecl *VD = dyn_cast<VarDecl>(DRE->getDecl()))
-          if (VD == V)
-            return true;
+          Vars.insert(VD);
     }
   }
-  return false;
 }
 
 // This function returns true only if expression `E` is a pointer deref.
@@ -287,7 +319,8 @@ bool AvailableFactsAnalysis::ContainsPointerDeref(const Expr *E) {
   return false;
 }
 
-bool AvailableFactsAnalysis::ContainsPointerAssignment(const Expr *E) {
+bool AvailableFactsAnalysis::ContainsPointerAssignment(
+    const Expr *E, const llvm::SmallPtrSetImpl<const Stmt *> &Walked) {
   if (E->containsErrors())
     return false;
   if (const BinaryOperator *BO = dyn_cast<BinaryOperator>(E))
@@ -302,7 +335,7 @@ bool AvailableFactsAnalysis::ContainsPointerAssignment(const Expr *E) {
     return true;
   for (auto Child : E->children())
     if (const Expr *EChild = dyn_cast<Expr>(Child))
-      if (ContainsPointerAssignment(EChild))
+      if (!Walked.count(EChild) && ContainsPointerAssignment(EChild, Walked))
         return true;
   return false;
 }
@@ -428,8 +461,11 @@ void AvailableFactsAnalysis::CollectExpressions(const Stmt *St, std::set<const E
 // 1. increment or decrement operator (a++)
 // 2. assignment operator (a += 1, a = 2)
 // Any parenthesis, LValueBitCast or NoOp cast is ignored when searching
-// for defined variables.
-void AvailableFactsAnalysis::CollectDefinedVars(const Stmt *St, std::set<const VarDecl *> &DefinedVars) {
+// for defined variables. The children of `St` in `Walked` are skipped, since
+// their defined variables have already been collected.
+void AvailableFactsAnalysis::CollectDefinedVars(
+    const Stmt *St, std::set<const VarDecl *> &DefinedVars,
+    const llvm::SmallPtrSetImpl<const Stmt *> &Walked) {
   if (!St)
     return;
 
@@ -452,7 +488,8 @@ void AvailableFactsAnalysis::CollectDefinedVars(const Stmt *St, std::set<const V
   }
 
   for (auto I : St->children())
-    CollectDefinedVars(I, DefinedVars);
+    if (!Walked.count(I))
+      CollectDefinedVars(I, DefinedVars, Walked);
 }
 
 // Ignore parenthesis, NoOp, and LValueBitCasts until nothing changes.
@@ -487,7 +524,7 @@ Expr *AvailableFactsAnalysis::IgnoreParenNoOpLValueBitCasts(Expr *E) {
   }
 }
 
-void AvailableFactsAnalysis::PrintComparisonSet(raw_ostream &OS, ComparisonSet &ISet, std::string Title) {
+void AvailableFactsAnalysis::PrintComparisonSet(raw_ostream &OS, const ComparisonSet &ISet, std::string Title) {
   OS << Title << ": ";
   for (auto I : ISet) {
     OS << "(";
@@ -502,12 +539,19 @@ void AvailableFactsAnalysis::PrintComparisonSet(raw_ostream &OS, ComparisonSet &
 void AvailableFactsAnalysis::DumpComparisonFacts(raw_ostream &OS, std::string Title) {
   Reset();
   OS << Title << "\n";
+  // Map the ID of each reachable block to its position in the reverse post
+  // order, up to the largest reachable block ID.
+  unsigned int MaxBlockID = 0;
+  for (const CFGBlock *Block : *CFGCtx)
+    MaxBlockID = std::max(MaxBlockID, Block->getBlockID());
+  std::vector<int> BlockIDs(MaxBlockID + 1, -1);
+  for (const CFGBlock *Block : *CFGCtx)
+    BlockIDs[Block->getBlockID()] = CFGCtx->getRPONum(Block);
   for (unsigned int Index = 0; Index < BlockIDs.size(); Index++) {
     if (BlockIDs[Index] == -1)
       continue;
     OS << "Block #" << (std::find(BlockIDs.begin(), BlockIDs.end(), Index) - BlockIDs.begin()) << ": {\n";
-    std::pair<ComparisonSet, ComparisonSet> Facts;
-    GetFacts(Facts);
+    const std::pair<ComparisonSet, ComparisonSet> &Facts = GetFacts();
     PrintComparisonSet(OS, Facts.first, "In");
     PrintComparisonSet(OS, Facts.second, "Kill");
     OS << "}\n";
@@ -12,6 +12,18 @@
 //===---------------------------------------------------------------------===//
 
 #include "clang/Sema/BoundsWideningAnalysis.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/TimeProfiler.h"
+
+#define DEBUG_TYPE "checkedc-bounds-widening"
+
+ALWAYS_ENABLED_STATISTIC(NumWideningFunctions,
+                         "Number of functions analyzed for bounds widening.");
+ALWAYS_ENABLED_STATISTIC(NumWideningBlocks,
+                         "Number of CFG blocks analyzed for bounds widening.");
+ALWAYS_ENABLED_STATISTIC(NumWideningBlockVisits,
+                         "Number of block visits by the bounds widening "
+                         "fixpoint computation.");
 
 namespace clang {
 
@@ -23,26 +35,33 @@ namespace clang {
 //===---------------------------------------------------------------------===//
 
 void BoundsWideningAnalysis::WidenBounds(FunctionDecl *FD,
-                                         StmtSetTy NestedStmts) {
+                                         StmtSetTy NestedStmts,
+                                         const CheckedCFGContext &CFGCtx) {
   assert(Cfg && "expected CFG to exist");
+  assert(CFGCtx.getCFG() == Cfg && "expected the block ordering of the CFG");
+  llvm::TimeTraceScope TimeScope("BoundsWideningAnalysis",
+                                 [&]() { return FD->getNameAsString(); });
+  ++NumWideningFunctions;
 
   // Initialize the list of variables that are pointers to null-terminated
   // arrays. This list will be initialized with the variables that are passed
   // as parameters to the function.
   InitNullTermPtrsInFunc(FD);
 
-  // Note: By default, PostOrderCFGView iterates in reverse order. So we always
-  // get a reverse post order when we iterate PostOrderCFGView.
-  for (const CFGBlock *B : PostOrderCFGView(Cfg)) {
-    // SkipBlock will skip all null blocks and the exit block. PostOrderCFGView
-    // does not traverse any unreachable blocks. So at the end of this loop
-    // BlockMap only contains reachable blocks.
+  // Note: CFGCtx iterates over the blocks in reverse post order.
+  BlockMap.assign(CFGCtx.getNumBlockIDs(), nullptr);
+  unsigned RPONum = 0;
+  for (const CFGBlock *B : CFGCtx) {
+    // SkipBlock will skip all null blocks and the exit block. CFGCtx does not
+    // traverse any unreachable blocks. So at the end of this loop BlockMap
+    // only contains reachable blocks.
     if (BWUtil.SkipBlock(B))
       continue;
 
     // Create a mapping from CFGBlock to ElevatedCFGBlock.
-    auto EB = new ElevatedCFGBlock(B);
-    BlockMap[B] = EB;
+    auto EB = new ElevatedCFGBlock(B, RPONum++);
+    BlockMap[B->getBlockID()] = EB;
+    ++NumWideningBlocks;
 
     // Compute Gen and Kill sets for the block and statements in the block.
     ComputeGenKillSets(EB, NestedStmts);
@@ -52,8 +71,10 @@ void BoundsWideningAnalysis::WidenBounds(FunctionDecl *FD,
   }
 
   // WorkList store the blocks that remain to be processed for the fixedpoint
-  // computation. WorkList is a queue. So we maintain the reverse post order
-  // when we iterate WorkList.
+  // computation. WorkList is ordered by the reverse post order of the blocks.
+  // So a block is processed only after the changes to the Out sets of its
+  // (forward edge) preds have been propagated, and the blocks of a loop body
+  // are revisited together.
   // We initialize WorkList with the successor blocks of the entry block.
   WorkListTy WorkList;
   AddSuccsToWorkList(&Cfg->getEntry(), WorkList);
@@ -61,8 +82,10 @@ void BoundsWideningAnalysis::WidenBounds(FunctionDecl *FD,
   // Compute the In and Out sets for blocks. This is the fixedpoint computation
   // for the dataflow analysis.
   while (!WorkList.empty()) {
-    ElevatedCFGBlock *EB = WorkList.next();
-    WorkList.remove(EB);
+    ElevatedCFGBlock *EB = *WorkList.begin();
+    WorkList.erase(WorkList.begin());
+    ++NumWideningBlockVisits;
+    ++NumBlockVisits;
 
     bool Changed = false;
     Changed |= ComputeInSet(EB);
@@ -93,33 +116,57 @@ BoundsMapTy BoundsWideningAnalysis::GetOutOfLastStmt(
     if (!CurrStmt)
       continue;
 
-    // The In of the current statement is the value of StmtOut computed so far.
-    BoundsMapTy InOfCurrStmt = StmtOut;
-
     // If this is the last statement of the current block, then at this point
-    // InOfCurrStmt contains the Out set of the second last statement of the
-    // block.  This is equal to the In set for the last statement of this
-    // block. So we set InOfLastStmt to InOfCurrStmt.
+    // StmtOut contains the Out set of the second last statement of the block.
+    // This is equal to the In set for the last statement of this block. So we
+    // set InOfLastStmt to StmtOut.
     if (CurrStmt == EB->LastStmt)
-      EB->InOfLastStmt = InOfCurrStmt;
+      EB->InOfLastStmt = StmtOut;
 
-    // StmtOut = (InOfCurrStmt - StmtKill) u StmtGen.
-    auto Diff = BWUtil.Difference(InOfCurrStmt, EB->StmtKill[CurrStmt]);
-    StmtOut = BWUtil.Union(Diff, EB->StmtGen[CurrStmt]);
+    auto KillIt = EB->StmtKill.find(CurrStmt);
+    auto GenIt = EB->StmtGen.find(CurrStmt);
+    auto InvStmtIt = EB->InvertibleStmts.find(CurrStmt);
+
+    bool HasKill = KillIt != EB->StmtKill.end() && !KillIt->second.empty();
+    bool HasGen = GenIt != EB->StmtGen.end() && !GenIt->second.empty();
+    bool IsInvertible = InvStmtIt != EB->InvertibleStmts.end();
+
+    // Most statements neither generate nor kill any dataflow facts. For such
+    // statements StmtOut is equal to the In of the statement and we simply
+    // carry it over to the next statement.
+    if (!HasKill && !HasGen && !IsInvertible)
+      continue;
+
+    // The In of the current statement is the value of StmtOut computed so far.
+    // We only need a separate copy of it to adjust the bounds for an
+    // invertible statement.
+    BoundsMapTy InOfCurrStmt;
+    if (IsInvertible)
+      InOfCurrStmt = StmtOut;
+
+    // StmtOut = (InOfCurrStmt - StmtKill) u StmtGen. We update StmtOut in
+    // place instead of computing the intermediate sets.
+    if (HasKill)
+      for (const VarDecl *V : KillIt->second)
+        StmtOut.erase(V);
+
+    if (HasGen)
+      for (auto VarBoundsPair : GenIt->second)
+        StmtOut[VarBoundsPair.first] = VarBoundsPair.second;
 
     // Update StmtOut based on the invertibility of CurrStmt.
-    auto InvStmtIt = EB->InvertibleStmts.find(CurrStmt);
-    if (InvStmtIt == EB->InvertibleStmts.end())
+    if (!IsInvertible)
       continue;
 
     // At CurrStmt, we need to replace the ModifiedLValue with the
     // OriginalLValue in the bounds of every null-terminated array occurring in
     // PtrsWithAffectedBounds.
-    auto ValuesToReplaceInBounds = InvStmtIt->second;
+    const auto &ValuesToReplaceInBounds = InvStmtIt->second;
 
     Expr *ModifiedLValue = std::get<0>(ValuesToReplaceInBounds);
     Expr *OriginalLValue = std::get<1>(ValuesToReplaceInBounds);
-    VarSetTy PtrsWithAffectedBounds = std::get<2>(ValuesToReplaceInBounds);
+    const VarSetTy &PtrsWithAffectedBounds =
+      std::get<2>(ValuesToReplaceInBounds);
 
     CheckedScopeSpecifier CSS = CurrStmt->getCheckedScopeSpecifier();
 
@@ -131,10 +178,14 @@ BoundsMapTy BoundsWideningAnalysis::GetOutOfLastStmt(
       BoundsExpr *SrcBounds = StmtInIt->second;
 
       // Replace the modified LValue with the original LValue in the bounds
-      // expression of V.
-      BoundsExpr *AdjustedBounds =
-        BoundsUtil::ReplaceLValueInBounds(SemaRef, SrcBounds, ModifiedLValue,
-                                          OriginalLValue, CSS);
+      // expression of V. We reuse the bounds expression that we created for
+      // SrcBounds at CurrStmt in a previous iteration, if any.
+      BoundsExpr *&AdjustedBounds =
+        EB->ReplacedBounds[std::make_pair(CurrStmt, SrcBounds)];
+      if (!AdjustedBounds)
+        AdjustedBounds =
+          BoundsUtil::ReplaceLValueInBounds(SemaRef, SrcBounds, ModifiedLValue,
+                                            OriginalLValue, CSS);
       RangeBoundsExpr *AdjustedRangeBounds =
         dyn_cast_or_null<RangeBoundsExpr>(AdjustedBounds);
 
@@ -298,16 +349,14 @@ void BoundsWideningAnalysis::ComputeStmtGenKillSets(ElevatedCFGBlock *EB,
 
 bool BoundsWideningAnalysis::ComputeInSet(ElevatedCFGBlock *EB) {
   const CFGBlock *CurrBlock = EB->Block;
-  auto OrigIn = EB->In;
+  BoundsMapTy NewIn = EB->In;
 
   // Iterate through all the predecessor blocks of EB.
   for (const CFGBlock *PredBlock : CurrBlock->preds()) {
-    auto BlockIt = BlockMap.find(PredBlock);
-    if (BlockIt == BlockMap.end())
+    ElevatedCFGBlock *PredEB = GetElevatedBlock(PredBlock);
+    if (!PredEB)
       continue;
 
-    ElevatedCFGBlock *PredEB = BlockIt->second;
-
     // To compute the In set for the block we need to intersect the Out sets of
     // all preds of the current block. In order to simplify the intersection
     // operation we "prune" (or pre-process) the Out sets of preds here
@@ -315,11 +364,13 @@ bool BoundsWideningAnalysis::ComputeInSet(ElevatedCFGBlock *EB) {
     // pruned Out sets.
     BoundsMapTy PrunedOutSet = PruneOutSet(PredEB, EB);
 
-    EB->In = BWUtil.Intersect(EB->In, PrunedOutSet);
+    NewIn = BWUtil.Intersect(NewIn, PrunedOutSet);
   }
 
   // Return true if the In set has changed, false otherwise.
-  return !BWUtil.IsEqual(OrigIn, EB->In);
+  bool Changed = !BWUtil.IsEqual(EB->In, NewIn);
+  EB->In = std::move(NewIn);
+  return Changed;
 }
 
 BoundsMapTy BoundsWideningAnalysis::PruneOutSet(
@@ -356,6 +407,21 @@ BoundsMapTy BoundsWideningAnalysis::PruneOutSet(
   if (BWUtil.IsFallthroughEdge(PredBlock, CurrBlock))
     return PredEB->Out;
 
+  // If the terminating condition of the pred block does not dereference a
+  // pointer then no variable can be widened on the edge from pred to the
+  // current block, whatever kind of edge it is. Each variable in the Out set
+  // of pred is reset to its bounds before the last statement in pred, as
+  // below, without looking at the edge or at the case labels of a switch.
+  if (!PredEB->TermCondInfo.DerefExpr) {
+    BoundsMapTy PrunedOutSet;
+    for (auto VarBoundsPair : PredEB->Out) {
+      auto StmtInIt = PredEB->InOfLastStmt.find(VarBoundsPair.first);
+      if (StmtInIt != PredEB->InOfLastStmt.end())
+        PrunedOutSet[VarBoundsPair.first] = StmtInIt->second;
+    }
+    return PrunedOutSet;
+  }
+
   BoundsMapTy PrunedOutSet = PredEB->Out;
 
   // Check if the edge from pred to the current block is a true edge.
@@ -530,15 +596,15 @@ BoundsMapTy BoundsWideningAnalysis::PruneOutSet(
 }
 
 bool BoundsWideningAnalysis::ComputeOutSet(ElevatedCFGBlock *EB) {
-  auto OrigOut = EB->Out;
-
   // Set the Out set of the block to the Out set for the last statement of the
   // current block. If the current block does not have any statements
   // GetOutOfLastStmt returns the In set of the block.
-  EB->Out = GetOutOfLastStmt(EB);
+  BoundsMapTy NewOut = GetOutOfLastStmt(EB);
 
   // Return true if the Out set has changed, false otherwise.
-  return !BWUtil.IsEqual(OrigOut, EB->Out);
+  bool Changed = !BWUtil.IsEqual(EB->Out, NewOut);
+  EB->Out = std::move(NewOut);
+  return Changed;
 }
 
 void BoundsWideningAnalysis::InitBlockInOutSets(FunctionDecl *FD,
@@ -588,22 +654,21 @@ void BoundsWideningAnalysis::AddSuccsToWorkList(const CFGBlock *CurrBlock,
 
   for (const CFGBlock *SuccBlock : CurrBlock->succs()) {
     if (!BWUtil.SkipBlock(SuccBlock))
-      WorkList.append(BlockMap[SuccBlock]);
+      if (ElevatedCFGBlock *SuccEB = GetElevatedBlock(SuccBlock))
+        WorkList.insert(SuccEB);
   }
 }
 
-BoundsMapTy BoundsWideningAnalysis::GetStmtOut(const CFGBlock *B,
-                                               const Stmt *CurrStmt) const {
+const BoundsMapTy &BoundsWideningAnalysis::GetStmtOut(
+  const CFGBlock *B, const Stmt *CurrStmt) const {
   // Note: This method can be called from outside the BoundsWideningAnalysis
   // class to get the widened bounds after a statement.
   if (!B)
-    return BoundsMapTy();
-
-  auto BlockIt = BlockMap.find(B);
-  if (BlockIt == BlockMap.end())
-    return BoundsMapTy();
+    return EmptyBounds;
 
-  ElevatedCFGBlock *EB = BlockIt->second;
+  ElevatedCFGBlock *EB = GetElevatedBlock(B);
+  if (!EB)
+    return EmptyBounds;
 
   // CurrStmt will be null if:
   // 1. This method is called with a null value for CurrStmt, or
@@ -616,57 +681,70 @@ BoundsMapTy BoundsWideningAnalysis::GetStmtOut(const CFGBlock *B,
   // return it.
   if (!CurrStmt) {
     EB->OutOfPrevStmt = EB->In;
-    return EB->In;
+    return EB->OutOfPrevStmt;
   }
 
   // If we are here it means the client wants the Out set for the first
   // statement of the block (that is the reason PrevStmtMap[CurrStmt] is null).
   // In this case, we set OutOfPrevStmt to the In set of the block and then
   // apply the regular (In - Kill) u Gen computation on it.
-  if (!EB->PrevStmtMap[CurrStmt])
+  auto PrevStmtIt = EB->PrevStmtMap.find(CurrStmt);
+  if (PrevStmtIt == EB->PrevStmtMap.end() || !PrevStmtIt->second)
     EB->OutOfPrevStmt = EB->In;
 
-  auto Diff = BWUtil.Difference(EB->OutOfPrevStmt, EB->StmtKill[CurrStmt]);
-  auto StmtOut = BWUtil.Union(Diff, EB->StmtGen[CurrStmt]);
+  // Clients query the statements of a block in order, so OutOfPrevStmt
+  // contains the Out set of the previous statement. We compute
+  // StmtOut = (OutOfPrevStmt - StmtKill) u StmtGen in place, so that a query
+  // only costs as much as the number of bounds changed by the statement.
+  BoundsMapTy &StmtOut = EB->OutOfPrevStmt;
+
+  auto KillIt = EB->StmtKill.find(CurrStmt);
+  if (KillIt != EB->StmtKill.end())
+    for (const VarDecl *V : KillIt->second)
+      StmtOut.erase(V);
+
+  auto GenIt = EB->StmtGen.find(CurrStmt);
+  if (GenIt != EB->StmtGen.end())
+    for (auto VarBoundsPair : GenIt->second)
+      StmtOut[VarBoundsPair.first] = VarBoundsPair.second;
 
   // Account for bounds which are killed by the current statement but which may
   // have been adjusted using invertibility of the statement. This function
   // modifies StmtOut.
   UpdateAdjustedBounds(EB, CurrStmt, StmtOut);
 
-  EB->OutOfPrevStmt = StmtOut;
   return StmtOut;
 }
 
-BoundsMapTy BoundsWideningAnalysis::GetStmtIn(const CFGBlock *B,
-                                              const Stmt *CurrStmt) const {
+const BoundsMapTy &BoundsWideningAnalysis::GetStmtIn(
+  const CFGBlock *B, const Stmt *CurrStmt) const {
   // Note: This method can be called from outside the BoundsWideningAnalysis
   // class to get the widened bounds before a statement.
   if (!B)
-    return BoundsMapTy();
-
-  auto BlockIt = BlockMap.find(B);
-  if (BlockIt == BlockMap.end())
-    return BoundsMapTy();
+    return EmptyBounds;
 
-  ElevatedCFGBlock *EB = BlockIt->second;
+  ElevatedCFGBlock *EB = GetElevatedBlock(B);
+  if (!EB)
+    return EmptyBounds;
 
   // StmtIn of a statement is equal to the StmtOut of its previous statement.
-  return GetStmtOut(B, EB->PrevStmtMap[CurrStmt]);
+  auto PrevStmtIt = EB->PrevStmtMap.find(CurrStmt);
+  return GetStmtOut(B, PrevStmtIt != EB->PrevStmtMap.end() ?
+                       PrevStmtIt->second : nullptr);
 }
 
 BoundsMapTy BoundsWideningAnalysis::GetBoundsWidenedAndNotKilled(
   const CFGBlock *B, const Stmt *CurrStmt) const {
 
-  auto BlockIt = BlockMap.find(B);
-  if (BlockIt == BlockMap.end())
+  ElevatedCFGBlock *EB = GetElevatedBlock(B);
+  if (!EB)
     return BoundsMapTy();
 
-  ElevatedCFGBlock *EB = BlockIt->second;
-
-  BoundsMapTy InOfCurrStmt = GetStmtIn(B, CurrStmt);
-  auto BoundsWidenedAndNotKilled = BWUtil.Difference(InOfCurrStmt,
-                                                     EB->StmtKill[CurrStmt]);
+  BoundsMapTy BoundsWidenedAndNotKilled = GetStmtIn(B, CurrStmt);
+  auto KillIt = EB->StmtKill.find(CurrStmt);
+  if (KillIt != EB->StmtKill.end())
+    for (const VarDecl *V : KillIt->second)
+      BoundsWidenedAndNotKilled.erase(V);
 
   // Account for bounds which are killed by the current statement but which may
   // have been adjusted using invertibility of the statement. This function
@@ -689,7 +767,11 @@ void BoundsWideningAnalysis::UpdateNullTermPtrsInFunc(ElevatedCFGBlock *EB,
                                                       const Stmt *CurrStmt) {
   // Add variables occurring in StmtGen for the current statement to the list
   // of variables that are pointers to null-terminated arrays.
-  for (auto VarBoundsPair : EB->StmtGen[CurrStmt])
+  auto GenIt = EB->StmtGen.find(CurrStmt);
+  if (GenIt == EB->StmtGen.end())
+    return;
+
+  for (auto VarBoundsPair : GenIt->second)
     AllNullTermPtrsInFunc.insert(VarBoundsPair.first);
 }
 
@@ -1057,7 +1139,7 @@ void BoundsWideningAnalysis::DumpWidenedBounds(FunctionDecl *FD,
         }
     }
 
-    ElevatedCFGBlock *EB = BlockMap[CurrBlock];
+    ElevatedCFGBlock *EB = GetElevatedBlock(CurrBlock);
 
     if (PrintOption == 1) {
       // Print the In set for the block.
@@ -1117,17 +1199,11 @@ void BoundsWideningAnalysis::DumpWidenedBounds(FunctionDecl *FD,
 
 OrderedBlocksTy BoundsWideningAnalysis::GetOrderedBlocks() const {
   // We order the CFG blocks based on block ID. Block IDs decrease from entry
-  // to exit. So we sort in the reverse order.
+  // to exit. BlockMap is indexed by block ID, so we walk it backwards.
   OrderedBlocksTy OrderedBlocks;
-  for (auto BlockEBPair : BlockMap) {
-    const CFGBlock *B = BlockEBPair.first;
-    OrderedBlocks.push_back(B);
-  }
-
-  llvm::sort(OrderedBlocks.begin(), OrderedBlocks.end(),
-    [] (const CFGBlock *A, const CFGBlock *B) {
-        return A->getBlockID() > B->getBlockID();
-    });
+  for (auto It = BlockMap.rbegin(); It != BlockMap.rend(); ++It)
+    if (*It)
+      OrderedBlocks.push_back((*It)->Block);
   return OrderedBlocks;
 }
 // end of methods for the BoundsWideningAnalysis class.
@@ -1379,10 +1455,6 @@ TermCondInfoTy BoundsWideningUtil::GetTermCondInfo(
   const Expr *TermCond) const {
 
   TermCondInfoTy TermCondInfo;
-  // Initialize fields of TermCondInfo.
-  TermCondInfo.DerefExpr = nullptr;
-  TermCondInfo.IsCheckNull = false;
-
   FillTermCondInfo(TermCond, TermCondInfo);
   return TermCondInfo;
 }
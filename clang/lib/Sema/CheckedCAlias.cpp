@@ -22,10 +22,21 @@
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/Sema/Sema.h"
 #include "clang/Sema/SemaDiagnostic.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/TimeProfiler.h"
 
 using namespace clang;
 using namespace sema;
 
+#define DEBUG_TYPE "checkedc-bounds-dependencies"
+
+ALWAYS_ENABLED_STATISTIC(NumBoundsDependencyFunctions,
+                         "Number of functions whose bounds dependencies were "
+                         "computed.");
+ALWAYS_ENABLED_STATISTIC(NumBoundsModifyingExprs,
+                         "Number of expressions that modify lvalues used in "
+                         "bounds.");
+
 //
 // Check that code does not take the address of a member used in a member
 // bounds expression.
@@ -343,68 +354,33 @@ void Sema::TrackMemberBoundsDependences(FieldDecl *FD, BoundsExpr *BE) {
 }
 
 namespace {
-// Update map from variables to bounds expressions that use those variables.
-class UpdateDependences : public RecursiveASTVisitor<UpdateDependences> {
+// Add the dependences of a bounds declaration to the map from variables to
+// bounds expressions that use those variables.
+class AddDependences : public RecursiveASTVisitor<AddDependences> {
 private:
-   bool Add;              // whether to add or remove dependence.
    VarDecl *const BoundsDecl;   // variable with bounds declaration.
    Sema::BoundsDependencyTracker::DependentMap &Map;
-
-   void AddDependence(VarDecl *D) {
-    if (BoundsDecl == D)   // Do not add self-dependences.
-      return;
-    auto I = Map.find(D);
-    if (I == Map.end()) {
-      Map[D].push_back(BoundsDecl);
-      return;
-     }
-
-    auto VecIter = I->second.begin();
-    auto VecEnd = I->second.end();
-
-    for ( ; VecIter != VecEnd; VecIter++)
-      if (*VecIter == BoundsDecl)
-        return;
-
-    I->second.push_back(BoundsDecl);
-  }
-
-   void RemoveDependence(VarDecl *D) {
-     if (D == BoundsDecl)    // Self-dependences aren't allowed.
-       return;
-
-     auto I = Map.find(D);
-     if (I == Map.end())
-       return;
-
-     auto VecIter = I->second.begin();
-     auto VecEnd = I->second.end();
-
-     for ( ; VecIter != VecEnd; VecIter++)
-       if (*VecIter == BoundsDecl) {
-         I->second.erase(VecIter);
-         if (I->second.empty())
-           Map.erase(I);
-         return;
-       }
-
-    return;
-   }
+   std::vector<VarDecl *> &Added;
 
 public:
-  UpdateDependences(VarDecl *BoundsDecl,
-                    Sema::BoundsDependencyTracker::DependentMap &Map,
-                    bool Add) :
-    Add(Add), BoundsDecl(BoundsDecl), Map(Map) {}
+  AddDependences(VarDecl *BoundsDecl,
+                 Sema::BoundsDependencyTracker::DependentMap &Map,
+                 std::vector<VarDecl *> &Added) :
+    BoundsDecl(BoundsDecl), Map(Map), Added(Added) {}
 
   bool VisitDeclRefExpr(DeclRefExpr *DR) {
-    if (VarDecl *D = dyn_cast<VarDecl>(DR->getDecl())) {
-       if (Add)
-         AddDependence(D);
-       else
-         RemoveDependence(D);
-    }
+    VarDecl *D = dyn_cast<VarDecl>(DR->getDecl());
+    if (!D || D == BoundsDecl)   // Do not add self-dependences.
+      return true;
 
+    // A variable that occurs more than once in the bounds expression is
+    // only added once.  The earlier occurrences were the last additions to
+    // its entry.
+    Sema::BoundsDependencyTracker::VarBoundsDecls &Decls = Map[D];
+    if (!Decls.empty() && Decls.back() == BoundsDecl)
+      return true;
+    Decls.push_back(BoundsDecl);
+    Added.push_back(D);
     return true;
   }
 };
@@ -415,7 +391,8 @@ void Sema::BoundsDependencyTracker::Add(VarDecl *D) {
   if (!BE)
     return;
   BoundsInScope.push_back(D);
-  UpdateDependences(D, Map, true).TraverseStmt(BE);
+  FirstDependence.push_back(AddedDependences.size());
+  AddDependences(D, Map, AddedDependences).TraverseStmt(BE);
 }
 
 unsigned Sema::BoundsDependencyTracker::EnterScope() {
@@ -423,12 +400,19 @@ unsigned Sema::BoundsDependencyTracker::EnterScope() {
 }
 
 void Sema::BoundsDependencyTracker::ExitScope(unsigned scopeBegin) {
-  while (BoundsInScope.size() > scopeBegin) {
-    VarDecl *D = BoundsInScope.back();
-    BoundsExpr *BE = D->getBoundsExpr();
-    UpdateDependences(D, Map, false).TraverseStmt(BE);
-    BoundsInScope.pop_back();
+  if (scopeBegin >= BoundsInScope.size())
+    return;
+  unsigned DependenceBegin = FirstDependence[scopeBegin];
+  while (AddedDependences.size() > DependenceBegin) {
+    auto I = Map.find(AddedDependences.back());
+    assert(I != Map.end() && !I->second.empty());
+    I->second.pop_back();
+    if (I->second.empty())
+      Map.erase(I);
+    AddedDependences.pop_back();
   }
+  BoundsInScope.resize(scopeBegin);
+  FirstDependence.resize(scopeBegin);
 }
 
 void Sema::BoundsDependencyTracker::Dump(raw_ostream &OS) {
@@ -500,22 +484,34 @@ namespace {
 // lvalues.
 // Also update a mapping from VarDecls with bounds expressions to the first
 // use of the VarDecl that occurs within a given statement.
+// Optionally, also collect the statements that are in checked scopes.
  class ModifyingExprDependencies {
  private:
    Sema &SemaRef;
    Sema::ModifiedBoundsDependencies &Tracker;
+   Sema::CheckedScopeStmts *CheckedStmts;
 
  public:
  ModifyingExprDependencies(Sema &SemaRef,
-                           Sema::ModifiedBoundsDependencies &Tracker) :
-   SemaRef(SemaRef), Tracker(Tracker) {}
+                           Sema::ModifiedBoundsDependencies &Tracker,
+                           Sema::CheckedScopeStmts *CheckedStmts) :
+   SemaRef(SemaRef), Tracker(Tracker), CheckedStmts(CheckedStmts) {}
 
  // Statement to traverse.  This iterates recursively over a statement
- // and all of its children statements.
- void TraverseStmt(Stmt *S, bool Kind) {
+ // and all of its children statements.  CSS is the checked scope
+ // specifier of the scope enclosing S.
+ void TraverseStmt(Stmt *S, bool Kind, CheckedScopeSpecifier CSS) {
    if (!S)
       return;
 
+   if (CheckedStmts && CSS != CheckedScopeSpecifier::CSS_Unchecked)
+     if (isa<Expr>(S) || isa<DeclStmt>(S) || isa<ReturnStmt>(S)) {
+       // If S is reached from more than one scope, memory checking wins.
+       auto Inserted = CheckedStmts->Specifiers.insert(std::make_pair(S, CSS));
+       if (!Inserted.second && CSS == CheckedScopeSpecifier::CSS_Memory)
+         Inserted.first->second = CSS;
+     }
+
    bool NewScope = false;
 
    switch (S->getStmtClass()) {
@@ -529,6 +525,7 @@ namespace {
      case Stmt::CompoundStmtClass: {
        CompoundStmt *CS = cast<CompoundStmt>(S);
        Kind = CS->isCheckedScope();
+       CSS = CS->getCheckedSpecifier();
        NewScope = true;
        break;
      }
@@ -554,7 +551,7 @@ namespace {
 
     auto Begin = S->child_begin(), End = S->child_end();
     for (auto I = Begin; I != End; ++I) {
-      TraverseStmt(*I, Kind);
+      TraverseStmt(*I, Kind, CSS);
     }
 
     if (NewScope) {
@@ -611,10 +608,15 @@ namespace {
 }
 
 void Sema::ComputeBoundsDependencies(ModifiedBoundsDependencies &Tracker,
-                                     FunctionDecl *FD, Stmt *Body) {
+                                     FunctionDecl *FD, Stmt *Body,
+                                     CheckedScopeStmts *CheckedStmts) {
   if (!Body)
     return;
 
+  llvm::TimeTraceScope TimeScope("ComputeBoundsDependencies",
+                                 [&]() { return FD->getNameAsString(); });
+  ++NumBoundsDependencyFunctions;
+
 #if DEBUG_DEPENDENCES
   llvm::outs() << "Computing bounds dependencies for "
                << FD->getName()
@@ -631,7 +633,9 @@ void Sema::ComputeBoundsDependencies(ModifiedBoundsDependencies &Tracker,
   BoundsDependencies.Dump(llvm::outs());
  #endif
 
-  ModifyingExprDependencies(*this, Tracker).TraverseStmt(Body, false);
+  ModifyingExprDependencies(*this, Tracker, CheckedStmts)
+    .TraverseStmt(Body, false, CheckedScopeSpecifier::CSS_Unchecked);
+  NumBoundsModifyingExprs += Tracker.Tracker.size();
 
   // Stop tracking parameter bounds declaration dependencies.
   BoundsDependencies.ExitScope(CurrentBoundsScope);
@@ -16,9 +16,20 @@
 
 #include "clang/Sema/CheckedCAnalysesPrepass.h"
 #include "clang/Sema/Sema.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/TimeProfiler.h"
 
 using namespace clang;
 
+#define DEBUG_TYPE "checkedc-prepass"
+
+ALWAYS_ENABLED_STATISTIC(NumPrepassFunctions,
+                         "Number of functions traversed by the Checked C "
+                         "analyses prepass.");
+ALWAYS_ENABLED_STATISTIC(NumPrepassVarUses,
+                         "Number of variables with bounds or used in bounds "
+                         "found by the prepass.");
+
 class PrepassHelper : public RecursiveASTVisitor<PrepassHelper> {
   private:
     Sema &SemaRef;
@@ -41,15 +52,6 @@ class PrepassHelper : public RecursiveASTVisitor<PrepassHelper> {
 
     VarDecl *VarWithBounds = nullptr;
 
-    // FieldWithBounds is a field that has a declared bounds expression.
-    // It is used to track the field with which a declared bounds expression
-    // is associated. For example, FieldWithBounds tracks the field "f" in
-    // the following:
-    // struct S {
-    //   _Array_ptr<int> f : bounds(lower, upper);
-    // };
-    FieldDecl *FieldWithBounds = nullptr;
-
     // InBoundsExprLower indicates that we are currently processing the lower
     // bounds expression of a BoundsExpr that has been expanded to a
     // RangeBoundsExpr. This flag is used to determine whether a variable
@@ -67,6 +69,14 @@ class PrepassHelper : public RecursiveASTVisitor<PrepassHelper> {
     // unnecessary duplicate traversals of record fields.
     llvm::SmallPtrSet<const RecordDecl *, 2> ProcessedRecords;
 
+    // NoteNullTermPtr records whether V is a pointer to a null-terminated
+    // array or a null-terminated checked array.
+    void NoteNullTermPtr(const VarDecl *V) {
+      if (V->getType()->isCheckedPointerNtArrayType() ||
+          V->getType()->isNtCheckedArrayType())
+        Info.HasNullTermPtrs = true;
+    }
+
     // GetRecordDecl returns the record declaration, if any, that is
     // associated with the given type. For example, if the given type is
     // struct S, struct S *, _Ptr<struct S>, struct S **, etc.,
@@ -97,8 +107,10 @@ class PrepassHelper : public RecursiveASTVisitor<PrepassHelper> {
     }
 
     // If the type T is associated with a record declaration S,
-    // FillBoundsSiblingFields traverses the fields in S in order to map each
-    // field F in S to the fields in S in whose declared bounds F appears.
+    // FillBoundsSiblingFields maps each field F in S to the fields in S in
+    // whose declared bounds F appears. The uses of the fields of S are
+    // computed once per record by the ASTContext (or read from an AST file)
+    // and shared by all the functions that use S.
     void FillBoundsSiblingFields(const QualType T) {
       RecordDecl *S = GetRecordDecl(T);
       if (!S)
@@ -111,32 +123,20 @@ class PrepassHelper : public RecursiveASTVisitor<PrepassHelper> {
       if (ProcessedRecords.count(S))
         return;
 
-      FieldWithBounds = nullptr;
       ProcessedRecords.insert(S);
-      for (auto It = S->field_begin(), E = S->field_end(); It != E; ++It) {
-        auto *Field = *It;
 
-        // Recursively traverse the record declarations of struct or
-        // union-typed fields.
+      // Fields with count bounds implicitly occur in their own declared
+      // bounds. For example, if a field p has declared bounds count(1),
+      // then p occurs in the declared bounds of p. The other uses are the
+      // DeclRefExprs of sibling fields within the declared bounds.
+      for (const auto &Use :
+           SemaRef.getASTContext().getSiblingFieldBoundsUses(S))
+        AddPtrWithBounds(Info.BoundsSiblingFields, Use.second, Use.first);
+
+      // Recursively traverse the record declarations of struct or
+      // union-typed fields.
+      for (const FieldDecl *Field : S->fields())
         FillBoundsSiblingFields(Field->getType());
-
-        // For fields with declared bounds expressions, get the sibling fields
-        // that implicitly or explicltly appear within the declared bounds.
-        if (BoundsExpr *FieldBounds = Field->getBoundsExpr()) {
-          FieldWithBounds = Field;
-          // Fields with count bounds implicitly occur in their own declared
-          // bounds. For example, if a field p has declared bounds count(1),
-          // then p occurs in the declared bounds of p.
-          if (isa<CountBoundsExpr>(FieldBounds))
-            AddPtrWithBounds(Info.BoundsSiblingFields, FieldWithBounds, Field);
-
-          // Traverse the declared bounds to visit the DeclRefExprs that
-          // explicitly occur in the declared bounds. These DeclRefExprs
-          // are the siblings of Field that appear in its declared bounds.
-          TraverseStmt(FieldBounds);
-          FieldWithBounds = nullptr;
-        }
-      }
     }
 
   public:
@@ -147,6 +147,8 @@ class PrepassHelper : public RecursiveASTVisitor<PrepassHelper> {
       if (!V || V->isInvalidDecl())
         return true;
 
+      NoteNullTermPtr(V);
+
       // If V declares a variable with a struct or union type (e.g. struct S,
       // struct S *, etc.), traverse the fields in the declaration of S in
       // order to map to each field F in S to the fields in S in whose
@@ -184,18 +186,15 @@ class PrepassHelper : public RecursiveASTVisitor<PrepassHelper> {
 
     // We may modify the VarUses map when a DeclRefExpr is visited.
     bool VisitDeclRefExpr(DeclRefExpr *E) {
-      // If E is a use of a field declaration F, then we add FieldWithBounds
-      // to the set of all fields in whose bounds expressions F occurs.
-      if (FieldWithBounds) {
-        const FieldDecl *F = dyn_cast_or_null<FieldDecl>(E->getDecl());
-        if (F && !F->isInvalidDecl())
-          AddPtrWithBounds(Info.BoundsSiblingFields, FieldWithBounds, F);
-        return true;
-      }
-
       const VarDecl *V = dyn_cast_or_null<VarDecl>(E->getDecl());
       if (!V || V->isInvalidDecl())
         return true;
+
+      // A use of a null-terminated array that is not declared in the function
+      // (for example, a global variable) can also generate a dataflow fact
+      // for bounds widening.
+      NoteNullTermPtr(V);
+
       // We only add the V => E pair to the VarUses map if:
       // 1. E is within a declared bounds expression, or:
       // 2. V has a declared bounds expression.
@@ -253,6 +252,7 @@ class PrepassHelper : public RecursiveASTVisitor<PrepassHelper> {
 
       for (WhereClauseFact *Fact : WC->getFacts()) {
         if (BoundsDeclFact *F = dyn_cast<BoundsDeclFact>(Fact)) {
+          Info.HasNullTermPtrs = true;
           if (BoundsExpr *NormalizedBounds = SemaRef.NormalizeBounds(F)) {
             VarDecl *OrigVarWithBounds = VarWithBounds;
             VarWithBounds = F->getVarDecl();
@@ -350,12 +350,16 @@ class PrepassHelper : public RecursiveASTVisitor<PrepassHelper> {
 // Checked C analyses such as bounds declaration checking, bounds widening, etc.
 void Sema::CheckedCAnalysesPrepass(PrepassInfo &Info, FunctionDecl *FD,
                                    Stmt *Body) {
+  llvm::TimeTraceScope TimeScope("CheckedCAnalysesPrepass",
+                                 [&]() { return FD->getNameAsString(); });
+  ++NumPrepassFunctions;
   PrepassHelper Prepass(*this, Info);
   for (auto I = FD->param_begin(); I != FD->param_end(); ++I) {
     ParmVarDecl *Param = *I;
     Prepass.VisitVarDecl(Param);
   }
   Prepass.TraverseStmt(Body);
+  NumPrepassVarUses += Info.VarUses.size();
 
   if (getLangOpts().DumpBoundsVars)
     Prepass.DumpBoundsVars(FD);
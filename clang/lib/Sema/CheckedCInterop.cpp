@@ -304,5 +304,15 @@ public:
 }
 
 QualType Sema::RewriteBoundsSafeInterfaceTypes(QualType Ty) {
-  return TransformFunctionTypeToChecked(*this).TransformType(Ty);
+  // This is called for each use of a declaration with a bounds-safe interface
+  // in a checked scope, so the same few types (e.g. those of the checked libc
+  // functions) are rewritten over and over. The rewrite depends only on the
+  // type, and the resulting function types are uniqued by the ASTContext, so
+  // reuse the earlier result.
+  auto It = RewrittenBoundsSafeInterfaceTypes.find(Ty.getAsOpaquePtr());
+  if (It != RewrittenBoundsSafeInterfaceTypes.end())
+    return It->second;
+  QualType Result = TransformFunctionTypeToChecked(*this).TransformType(Ty);
+  RewrittenBoundsSafeInterfaceTypes[Ty.getAsOpaquePtr()] = Result;
+  return Result;
 }
@@ -139,6 +139,15 @@ RecordDecl* Sema::ActOnRecordTypeApplication(RecordDecl *Base, ArrayRef<TypeArgu
   return Inst;
 }
 
+// The fields of a type application are built eagerly, as soon as the generic
+// definition is complete, instead of on first use as C++ does for templates.
+// In C there is no instantiation point to hook: many clients walk the fields
+// of a record directly without asking Sema to complete it first, e.g.
+// Type::containsCheckedValue and the checked scope checks, record layout,
+// CodeGen, debug info and tools such as 3C that work on the finished AST.
+// Each of these would see an empty struct for an application that hadn't been
+// used yet. The cost is kept down instead by caching the substituted field
+// types (see SubstituteTypeArgs).
 void Sema::CompleteTypeAppFields(RecordDecl *Incomplete) {
   assert(Incomplete->isInstantiated() && "Only instantiated record decls can be completed");
   assert(Incomplete->field_empty() && "Can't complete record decl with non-empty fields");
@@ -245,21 +254,20 @@ namespace {
   /// depending on whether the variable appears at the top level as a type argument.
   ///
   /// The new edges aren't returned; instead, they're added as a side effect to the
-  /// 'Worklist' argument in the constructor.
+  /// 'Edges' argument in the constructor. The 'char' of each edge says whether the
+  /// edge itself is expanding.
   class ExpandingEdgesVisitor : public RecursiveASTVisitor<ExpandingEdgesVisitor> {
-    /// The worklist where the new nodes will be inserted.
-    std::stack<Node> &Worklist;
+    /// The list where the new edges will be inserted.
+    Sema::ExpandingCycleEdgeList &Edges;
     /// The type variable that we're looking for in embedded type applications.
     const TypeVariableType *TypeVar = nullptr;
-    /// Whether the path so far contains at least one expanding edge.
-    char ExpandingSoFar = NON_EXPANDING;
     /// A visitor object to find out whether a type variable is referenced within a given type.
     ContainsTypeVarVisitor ContainsVisitor;
 
   public:
-    /// Note the worklist argument is mutated by this visitor.
-    ExpandingEdgesVisitor(std::stack<Node>& Worklist, const TypeVariableType *TypeVar, char ExpandingSoFar):
-      Worklist(Worklist), TypeVar(TypeVar), ExpandingSoFar(ExpandingSoFar) {}
+    /// Note the edges argument is mutated by this visitor.
+    ExpandingEdgesVisitor(Sema::ExpandingCycleEdgeList &Edges, const TypeVariableType *TypeVar):
+      Edges(Edges), TypeVar(TypeVar) {}
 
     void AddEdges(QualType Type) {
       TraverseType(Type);
@@ -277,12 +285,10 @@ namespace {
         auto DestIndex = DestTypeVar->GetIndex();
         if (TypeArg.getTypePtr() == TypeVar) {
           // Non-expanding edges are created if the type variable appears directly as an argument of the decl.
-          // So in this case the new edge is marked as expanding only if we'd previously seen an expanding edge.
-          Worklist.push(Node(std::make_pair(BaseDecl, DestIndex), ExpandingSoFar));
+          Edges.push_back(Node(std::make_pair(BaseDecl, DestIndex), NON_EXPANDING));
         } else if (ContainsVisitor.ContainsTypeVar(TypeArg, TypeVar)) {
           // Expanding edges are created if the type variable doesn't appear directly, but is contained in the type argument.
-          // In this case we always mark the edge as expanding.
-          Worklist.push(Node(std::make_pair(BaseDecl, DestIndex), EXPANDING));
+          Edges.push_back(Node(std::make_pair(BaseDecl, DestIndex), EXPANDING));
         }
 
         // Now recurse in the type argument to uncover edges that might show up there.
@@ -298,6 +304,39 @@ namespace {
   };
 }
 
+const Sema::ExpandingCycleEdgeList &
+Sema::GetExpandingCycleEdges(std::pair<const RecordDecl *, int> TypeParam) {
+  auto It = ExpandingCycleEdges.find(TypeParam);
+  if (It != ExpandingCycleEdges.end())
+    return It->second;
+
+  auto RDecl = TypeParam.first;
+  auto TVar = GetTypeVar(RDecl->typeParams()[TypeParam.second]);
+  ExpandingCycleEdgeList Edges;
+  // 'EdgesVisitor' mutates 'Edges' by adding new edges to it.
+  ExpandingEdgesVisitor EdgesVisitor(Edges, TVar);
+  auto Defn = RDecl->getDefinition();
+  // There might not be an underlying definition, because 'RDecl' might refer
+  // to a forward-declared struct.
+  if (Defn) {
+    for (auto Field : Defn->fields()) {
+      // Visit the field's type.
+      EdgesVisitor.AddEdges(Field->getType());
+      // Visit the field's interop type, if one exists.
+      auto Itype = Field->getInteropType();
+      if (!Itype.isNull()) EdgesVisitor.AddEdges(Itype);
+    }
+  }
+  // The fields of a complete definition don't change, so its edges can be reused
+  // by the checks of the generic structs that are completed later in the TU.
+  // A struct that is still forward-declared might get its fields later.
+  if (!Defn || !Defn->isCompleteDefinition()) {
+    TemporaryExpandingCycleEdges = std::move(Edges);
+    return TemporaryExpandingCycleEdges;
+  }
+  return ExpandingCycleEdges[TypeParam] = std::move(Edges);
+}
+
 bool Sema::DiagnoseExpandingCycles(RecordDecl *Base, SourceLocation Loc) {
   assert(Base->isGenericOrItypeGeneric() && "Can only check expanding cycles for generic structs");
   assert(Base == Base->getCanonicalDecl() && "Expected canonical base decl");
@@ -317,25 +356,15 @@ bool Sema::DiagnoseExpandingCycles(RecordDecl *Base, SourceLocation Loc) {
     Visited.insert(Curr);
     auto RDecl = Curr.first.first;
     auto TVarIndex = Curr.first.second;
-    auto TVar = GetTypeVar(RDecl->typeParams()[TVarIndex]);
     auto ExpandingSoFar = Curr.second;
     if (ExpandingSoFar == EXPANDING && RDecl == Base) {
       Diag(Loc, diag::err_expanding_cycle);
       return true;
     }
-    // 'EdgesVisitor' mutates the worklist by adding new nodes to it.
-    ExpandingEdgesVisitor EdgesVisitor(Worklist, TVar, ExpandingSoFar);
-    auto Defn = RDecl->getDefinition();
-    // There might not be an underlying definition, because 'RDecl' might refer
-    // to a forward-declared struct.
-    if (!Defn) continue;
-    for (auto Field : Defn->fields()) {
-      // Visit the field's type.
-      EdgesVisitor.AddEdges(Field->getType());
-      // Visit the field's interop type, if one exists.
-      auto Itype = Field->getInteropType();
-      if (!Itype.isNull()) EdgesVisitor.AddEdges(Itype);
-    }
+    // A new edge is expanding if it is expanding itself or if we'd previously
+    // seen an expanding edge.
+    for (const Node &Edge : GetExpandingCycleEdges(Curr.first))
+      Worklist.push(Node(Edge.first, Edge.second == EXPANDING ? EXPANDING : ExpandingSoFar));
   }
 
   return false; // no cycles: can complete decls
@@ -465,12 +494,11 @@ public:
 };
 }
 
-QualType Sema::SubstituteTypeArgs(QualType QT, ArrayRef<TypeArgument> TypeArgs) {
-   if (QT.isNull())
-     return QT;
+static QualType ApplyTypeArgs(Sema &SemaRef, QualType QT, ArrayRef<TypeArgument> TypeArgs) {
+   ASTContext &Context = SemaRef.Context;
 
    // Transform the type and strip off the quantifier.
-   TypeApplication TypeApp(*this, TypeArgs, 0 /* Depth */);
+   TypeApplication TypeApp(SemaRef, TypeArgs, 0 /* Depth */);
    QualType TransformedQT = TypeApp.TransformType(QT);
 
    // Something went wrong in the transformation.
@@ -490,6 +518,35 @@ QualType Sema::SubstituteTypeArgs(QualType QT, ArrayRef<TypeArgument> TypeArgs)
    return TransformedQT;
 }
 
+QualType Sema::SubstituteTypeArgs(QualType QT, ArrayRef<TypeArgument> TypeArgs) {
+   if (QT.isNull())
+     return QT;
+
+   // The substitution depends only on the type and on the type arguments, and
+   // a generic function is usually applied to the same type arguments at many
+   // call sites, so reuse earlier results. The key uses the types as written
+   // rather than their canonical types, because the result preserves typedefs
+   // that aren't substituted.
+   llvm::SmallVector<const void *, 4> Key;
+   Key.push_back(QT.getAsOpaquePtr());
+   for (const TypeArgument &TArg : TypeArgs)
+     Key.push_back(TArg.typeName.getAsOpaquePtr());
+   ++CheckedCStats.NumTypeArgSubstitutions;
+   auto It = SubstitutedTypeArgs.find(Key);
+   if (It != SubstitutedTypeArgs.end()) {
+     ++CheckedCStats.NumCachedTypeArgSubstitutions;
+     return It->second;
+   }
+
+   // Don't hold on to 'It' here: the substitution can call back into
+   // SubstituteTypeArgs for the type arguments of record type applications.
+   QualType Result = ApplyTypeArgs(*this, QT, TypeArgs);
+   auto KeyCopy = new (Context) const void *[Key.size()];
+   std::copy(Key.begin(), Key.end(), KeyCopy);
+   SubstitutedTypeArgs.insert(std::make_pair(ArrayRef<const void *>(KeyCopy, Key.size()), Result));
+   return Result;
+}
+
 namespace {
 /// A `TreeTransform` that computes the list of free `TypeVariableTypes` in a type.
 /// A variable is free if isn't bound.
@@ -508,6 +508,19 @@ void Sema::addExternalSource(ExternalSemaSource *E) {
 void Sema::PrintStats() const {
   llvm::errs() << "\n*** Semantic Analysis Stats:\n";
   llvm::errs() << NumSFINAEErrors << " SFINAE diagnostics trapped.\n";
+  if (getLangOpts().CheckedC) {
+    size_t PositionalBytes = BoundsPositionalParams.getMemorySize();
+    for (const auto &BoundsAndParams : BoundsPositionalParams)
+      if (BoundsAndParams.second.capacity() > 4)
+        PositionalBytes += BoundsAndParams.second.capacity_in_bytes();
+    llvm::errs() << BoundsPositionalParams.size()
+                 << " bounds expressions with positional parameters ("
+                 << PositionalBytes << " bytes).\n";
+    llvm::errs() << RewrittenBoundsSafeInterfaceTypes.size()
+                 << " rewritten bounds-safe interface types ("
+                 << RewrittenBoundsSafeInterfaceTypes.getMemorySize()
+                 << " bytes).\n";
+  }
 
   BumpAlloc.PrintStats();
   AnalysisWarnings.PrintStats();
@@ -1026,6 +1039,9 @@ void Sema::ActOnEndOfTranslationUnit() {
   if (PP.isCodeCompletionEnabled())
     return;
 
+  // Run the Checked C bounds checking that was deferred for function bodies.
+  CheckDeferredFunctionBodyBoundsDecls();
+
   // Complete translation units and modules define vtables and perform implicit
   // instantiations. PCH files do not.
   if (TUKind != TU_Prefix) {
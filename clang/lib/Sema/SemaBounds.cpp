@@ -38,21 +38,36 @@
 //      access expressions.
 //===----------------------------------------------------------------------===//
 
+#include "clang/Analysis/CallGraph.h"
 #include "clang/Analysis/CFG.h"
-#include "clang/Analysis/Analyses/PostOrderCFGView.h"
 #include "clang/AST/AbstractSet.h"
 #include "clang/AST/CanonBounds.h"
 #include "clang/AST/ExprUtils.h"
 #include "clang/AST/NormalizeUtils.h"
 #include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/Preprocessor.h"
 #include "clang/Sema/AvailableFactsAnalysis.h"
+#include "clang/Sema/BoundsCheckReuseCache.h"
 #include "clang/Sema/BoundsUtils.h"
 #include "clang/Sema/BoundsWideningAnalysis.h"
 #include "clang/Sema/CheckedCAnalysesPrepass.h"
+#include "clang/Sema/CheckedCFGContext.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallBitVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/Timer.h"
 #include "TreeTransform.h"
+#include <limits>
+#include <memory>
 #include <queue>
 
 // #define TRACE_CFG 1
@@ -61,6 +76,59 @@
 using namespace clang;
 using namespace sema;
 
+#define DEBUG_TYPE "checkedc-bounds"
+
+ALWAYS_ENABLED_STATISTIC(NumFunctionsBoundsChecked,
+                         "Number of function bodies whose bounds declarations "
+                         "were checked.");
+ALWAYS_ENABLED_STATISTIC(NumFunctionsSkippedBoundsChecking,
+                         "Number of function bodies not bounds checked "
+                         "because they use no Checked C features.");
+ALWAYS_ENABLED_STATISTIC(NumFunctionsReusedBoundsChecks,
+                         "Number of function bodies whose diagnostics were "
+                         "reused from an earlier check of the same body.");
+ALWAYS_ENABLED_STATISTIC(NumFunctionsWithoutCFG,
+                         "Number of function bodies checked without a CFG.");
+ALWAYS_ENABLED_STATISTIC(NumBoundsCheckedCFGBlocks,
+                         "Number of CFG blocks built for bounds checking.");
+ALWAYS_ENABLED_STATISTIC(MaxBoundsCheckedCFGBlocks,
+                         "Maximum number of CFG blocks of a function body.");
+ALWAYS_ENABLED_STATISTIC(NumBoundsCheckedStmts,
+                         "Number of CFG statements checked.");
+ALWAYS_ENABLED_STATISTIC(NumBoundsProofs,
+                         "Number of attempts to prove a bounds declaration "
+                         "valid.");
+ALWAYS_ENABLED_STATISTIC(NumBoundsProofsTrue,
+                         "Number of bounds proofs that succeeded.");
+ALWAYS_ENABLED_STATISTIC(NumBoundsProofsFalse,
+                         "Number of bounds proofs that failed.");
+ALWAYS_ENABLED_STATISTIC(NumBoundsProofsMaybe,
+                         "Number of bounds proofs that were inconclusive.");
+ALWAYS_ENABLED_STATISTIC(NumLowerBoundChecksProven,
+                         "Number of memory accesses whose bounds check only "
+                         "needs to compare the upper bound.");
+ALWAYS_ENABLED_STATISTIC(NumVariableUpperBoundChecksProven,
+                         "Number of memory accesses proved to be in range "
+                         "whose upper bound is a variable offset from the "
+                         "lower bound.");
+ALWAYS_ENABLED_STATISTIC(NumBoundsProofCacheHits,
+                         "Number of bounds proofs whose result was cached.");
+ALWAYS_ENABLED_STATISTIC(NumBoundsProofsSyntactic,
+                         "Number of bounds proofs settled by the syntactic "
+                         "checks alone.");
+ALWAYS_ENABLED_STATISTIC(NumBoundsProofsNotSyntactic,
+                         "Number of bounds proofs that needed more than the "
+                         "syntactic checks.");
+ALWAYS_ENABLED_STATISTIC(NumBoundsProofBudgetsExhausted,
+                         "Number of functions whose bounds proof budget was "
+                         "exhausted.");
+ALWAYS_ENABLED_STATISTIC(MaxEquivExprSets,
+                         "Maximum number of sets of equivalent expressions "
+                         "used in a bounds proof.");
+ALWAYS_ENABLED_STATISTIC(MaxEquivExprSetSize,
+                         "Maximum size of a set of equivalent expressions "
+                         "used in a bounds proof.");
+
 namespace {
   class AbstractBoundsExpr : public TreeTransform<AbstractBoundsExpr> {
     typedef TreeTransform<AbstractBoundsExpr> BaseTransform;
@@ -201,42 +269,38 @@ BoundsExpr *Sema::ConcretizeFromFunctionType(BoundsExpr *Expr,
 }
 
 namespace {
-  class CheckForModifyingArgs : public RecursiveASTVisitor<CheckForModifyingArgs> {
+  // Collect the indices of the positional parameters that occur in a bounds
+  // expression, in the order in which they are first visited.
+  class CollectPositionalParams : public RecursiveASTVisitor<CollectPositionalParams> {
   private:
-    Sema &SemaRef;
-    const ArrayRef<Expr *> Arguments;
-    llvm::SmallBitVector VisitedArgs;
-    Sema::NonModifyingContext ErrorKind;
-    Sema::NonModifyingMessage Message;
-    bool ModifyingArg;
+    SmallVectorImpl<unsigned> &Indices;
+    llvm::SmallBitVector Visited;
   public:
-    CheckForModifyingArgs(Sema &SemaRef, ArrayRef<Expr *> Args,
-                          Sema::NonModifyingContext ErrorKind,
-                          Sema::NonModifyingMessage Message) :
-      SemaRef(SemaRef),
-      Arguments(Args),
-      VisitedArgs(Args.size()),
-      ErrorKind(ErrorKind),
-      Message(Message),
-      ModifyingArg(false) {}
-
-    bool FoundModifyingArg() {
-      return ModifyingArg;
-    }
+    CollectPositionalParams(SmallVectorImpl<unsigned> &Indices) :
+      Indices(Indices) {}
 
     bool VisitPositionalParameterExpr(PositionalParameterExpr *E) {
       unsigned index = E->getIndex();
-      if (index < Arguments.size() && !VisitedArgs[index]) {
-        VisitedArgs.set(index);
-        if (!SemaRef.CheckIsNonModifying(Arguments[index], ErrorKind, Message)) {
-          ModifyingArg = true;
-        }
+      if (index >= Visited.size())
+        Visited.resize(index + 1);
+      if (!Visited[index]) {
+        Visited.set(index);
+        Indices.push_back(index);
       }
       return true;
     }
   };
 }
 
+ArrayRef<unsigned> Sema::GetPositionalParams(BoundsExpr *Bounds) {
+  auto It = BoundsPositionalParams.find(Bounds);
+  if (It != BoundsPositionalParams.end())
+    return It->second;
+  SmallVector<unsigned, 4> Indices;
+  CollectPositionalParams(Indices).TraverseStmt(Bounds);
+  return BoundsPositionalParams[Bounds] = std::move(Indices);
+}
+
 namespace {
   class ConcretizeBoundsExprWithArgs : public TreeTransform<ConcretizeBoundsExprWithArgs> {
     typedef TreeTransform<ConcretizeBoundsExprWithArgs> BaseTransform;
@@ -267,9 +331,23 @@ BoundsExpr *Sema::ConcretizeFromFunctionTypeWithArgs(
   if (!Bounds || Bounds->isInvalid())
     return Bounds;
 
-  auto CheckArgs = CheckForModifyingArgs(*this, Args, ErrorKind, Message);
-  CheckArgs.TraverseStmt(Bounds);
-  if (CheckArgs.FoundModifyingArg())
+  // The positional parameters of the bounds are collected once per bounds
+  // expression from a function type, so the arguments can be checked without
+  // traversing the bounds at every call.
+  // Copy the indices, because checking the arguments can add entries to
+  // BoundsPositionalParams.
+  ArrayRef<unsigned> Cached = GetPositionalParams(Bounds);
+  if (Cached.empty())
+    return Bounds;
+  SmallVector<unsigned, 4> Params(Cached.begin(), Cached.end());
+
+  bool ModifyingArg = false;
+  for (unsigned Index : Params) {
+    if (Index < Args.size() &&
+        !CheckIsNonModifying(Args[Index], ErrorKind, Message))
+      ModifyingArg = true;
+  }
+  if (ModifyingArg)
     return nullptr;
 
   ExprSubstitutionScope Scope(*this); // suppress diagnostics
@@ -346,15 +424,32 @@ BoundsExpr *Sema::MakeMemberBoundsConcrete(
   Expr *Base,
   bool IsArrow,
   BoundsExpr *Bounds) {
-  ExprSubstitutionScope Scope(*this); // suppress diagnostics
-  ExprResult ConcreteBounds =
-    ConcretizeMemberBounds(*this, Base, IsArrow).TransformExpr(Bounds);
-  if (ConcreteBounds.isInvalid())
-    return nullptr;
-  else {
-    BoundsExpr *Result = dyn_cast<BoundsExpr>(ConcreteBounds.get());
-    return Result;
+  // The bounds of a member expression are made concrete each time its
+  // target or lvalue bounds are computed, which can happen after every
+  // statement of a function that uses it.  While the synthesized expression
+  // tables are enabled, the concrete bounds are only computed once.
+  ASTContext::SynthesizedExprTables *Tables =
+    Context.getSynthesizedExprTables();
+  ASTContext::SynthesizedExprTables::MemberBoundsKeyTy Key(Bounds, Base,
+                                                           IsArrow);
+  if (Tables) {
+    auto It = Tables->ConcreteMemberBounds.find(Key);
+    if (It != Tables->ConcreteMemberBounds.end())
+      return It->second;
+  }
+
+  BoundsExpr *Result = nullptr;
+  {
+    ExprSubstitutionScope Scope(*this); // suppress diagnostics
+    ExprResult ConcreteBounds =
+      ConcretizeMemberBounds(*this, Base, IsArrow).TransformExpr(Bounds);
+    if (!ConcreteBounds.isInvalid())
+      Result = dyn_cast<BoundsExpr>(ConcreteBounds.get());
   }
+
+  if (Tables)
+    Tables->ConcreteMemberBounds[Key] = Result;
+  return Result;
 }
 
 #if 0
@@ -412,7 +507,30 @@ namespace {
     }	
   };	
 
+  // Determine whether an expression contains a temporary binding.
+  class FindTemporaryBinding :
+    public RecursiveASTVisitor<FindTemporaryBinding> {
+  private:
+    bool Found = false;
+
+  public:
+    bool IsFound() const { return Found; }
+
+    bool VisitCHKCBindTemporaryExpr(CHKCBindTemporaryExpr *E) {
+      Found = true;
+      return false;
+    }
+  };
+
   Expr *PruneTemporaryBindings(Sema &SemaRef, Expr *E, CheckedScopeSpecifier CSS) {	
+    // Most bounds expressions contain no temporary bindings, and there is
+    // nothing to prune in them.  Finding the bindings is cheaper than
+    // transforming the expression.
+    FindTemporaryBinding Finder;
+    Finder.TraverseStmt(E);
+    if (!Finder.IsFound())
+      return E;
+
     // Account for checked scope information when transforming the expression.
     Sema::CheckedScopeRAII CheckedScope(SemaRef, CSS);
 
@@ -431,11 +549,11 @@ namespace {
 
   // EqualExprsContainsExpr returns true if the set Exprs contains an
   // expression that is equivalent to E.
-  bool EqualExprsContainsExpr(Sema &S, const EqualExprTy Exprs, Expr *E,
+  bool EqualExprsContainsExpr(Sema &S, const EqualExprTy &Exprs, Expr *E,
                               EquivExprSets *EquivExprs) {
+    Lexicographic Lex(S.Context, EquivExprs);
     for (auto I = Exprs.begin(); I != Exprs.end(); ++I) {
-      if (Lexicographic(S.Context, EquivExprs).CompareExpr(*I, E) ==
-        Lexicographic::Result::Equal)
+      if (Lex.CompareExpr(*I, E) == Lexicographic::Result::Equal)
         return true;
     }
     return false;
@@ -485,9 +603,11 @@ namespace {
   // ExprSetTy denotes a set of expressions.
   using ExprSetTy = SmallVector<Expr *, 4>;
 
-  // ExprEqualMapTy denotes a map of an expression e to the set of
-  // expressions that produce the same value as e.
-  using ExprEqualMapTy = llvm::DenseMap<Expr *, ExprSetTy>;
+  // ExprEqualListTy denotes a list of pairs of an expression e and the set
+  // of expressions that produce the same value as e.  It holds the sets for
+  // the subexpressions of one expression, which usually has at most two
+  // subexpressions, so it is a small vector rather than a map.
+  using ExprEqualListTy = SmallVector<std::pair<Expr *, ExprSetTy>, 2>;
 
   // Describes the position of a free variable (FR).
   enum class FreeVariablePosition {
@@ -506,6 +626,21 @@ namespace {
   // AbstractSetSetTy denotes a set of AbstractSets.
   using AbstractSetSetTy = llvm::SmallPtrSet<const AbstractSet *, 4>;
 
+  // BlockExitState is the part of the checking state after a CFG block that
+  // is used to compute the checking states at the beginning of its
+  // successors.  The observed bounds context is shared with the context
+  // at the beginning of the block if checking the block did not change it.
+  struct BlockExitState {
+    std::shared_ptr<const BoundsContextTy> ObservedBounds;
+    EquivExprSets EquivExprs;
+    // The number of successors of the block that have not been checked yet.
+    // The state is freed once every successor has been checked.
+    unsigned PendingSuccs = 0;
+  };
+
+  // BlockExitStatesTy maps the ID of a CFG block to its exit state.
+  using BlockExitStatesTy = llvm::DenseMap<unsigned int, BlockExitState>;
+
   // CheckingState stores the outputs of bounds checking methods.
   // These members represent the state during bounds checking
   // and are updated while checking individual expressions.
@@ -531,6 +666,15 @@ namespace {
       // value.
       //
       // EquivExprs is named UEQ in the Checked C spec.
+      //
+      // Most sets contain expressions other than variables: rvalue casts of
+      // variables, integer constants, member expressions and the temporaries
+      // bound by CHKCBindTemporaryExpr. The equality of two variables can
+      // change within a statement (e.g. after x = y, x = 1). So a per-program-
+      // point partition of the variables, as built by
+      // PartitionRefinement::Partition in VarEquiv.h, could not replace
+      // EquivExprs. It could only answer a subset of the queries that the
+      // lookups cached by Lexicographic::GetEquivClasses already answer.
       EquivExprSets EquivExprs;
 
       // SameValue is a set of expressions that produce the same value as an
@@ -686,6 +830,17 @@ namespace {
     // for bounds inference/checking.
     BoundsWideningAnalysis BoundsWideningAnalyzer;
 
+    // Whether the prepass found any null-terminated arrays or where clauses
+    // in the function. If not, there are no bounds to widen and the bounds
+    // widening analysis is skipped.
+    bool HasNullTermPtrs;
+
+    // The bounds created by the bounds widening analysis for a test of a
+    // dereference.  The dereference was checked against the bounds before
+    // widening, so the accessed address is known to be at or above the
+    // lower bound while the widened bounds are in effect.
+    llvm::SmallPtrSet<const BoundsExpr *, 8> WidenedBoundsExprs;
+
     // Having an AbstractSetManager object here allows us to create
     // AbstractSets for lvalue expressions while checking statements.
     AbstractSetManager AbstractSetMgr;
@@ -699,6 +854,52 @@ namespace {
     // physical sizes during casts to pointers to null-terminated arrays.
     bool IncludeNullTerminator;
 
+    // FactsVersion changes whenever Facts is replaced, so that proof results
+    // that were computed using other facts are not reused.
+    unsigned FactsVersion;
+
+    // The number of bounds proofs attempted while checking this function,
+    // which is limited by -fcheckedc-bounds-proof-budget.
+    unsigned ProofSteps;
+
+    // The costs of checking this function that are printed by
+    // -fdump-checkedc-analysis-stats.
+    struct FunctionStats {
+      unsigned Proofs = 0;
+      unsigned SyntacticProofs = 0;
+      unsigned CachedProofs = 0;
+      unsigned ProofsTrue = 0;
+      unsigned ProofsFalse = 0;
+      unsigned ProofsMaybe = 0;
+      size_t MaxEquivExprSets = 0;
+      size_t MaxEquivExprSetSize = 0;
+      // Wall time in seconds spent in the bounds widening analysis.
+      double WideningTime = 0;
+    } Stats;
+
+    // Use one step of the bounds proof budget for this function.  Returns
+    // false if the budget is exhausted, in which case the caller should not
+    // attempt the proof and should report that it cannot prove the bounds.
+    bool UseProofStep() {
+      unsigned Budget = S.getLangOpts().CheckedCBoundsProofBudget;
+      if (Budget == 0)
+        return true;
+      if (ProofSteps < Budget) {
+        ++ProofSteps;
+        return true;
+      }
+      if (ProofSteps == Budget) {
+        // Record the exhaustion of the budget once per function.
+        ++ProofSteps;
+        ++NumBoundsProofBudgetsExhausted;
+        llvm::TimeTraceScope TimeScope("BoundsProofBudgetExhausted", [&]() {
+          return FunctionDeclaration ? FunctionDeclaration->getNameAsString()
+                                     : std::string();
+        });
+      }
+      return false;
+    }
+
     void DumpAssignmentBounds(raw_ostream &OS, BinaryOperator *E,
                               BoundsExpr *LValueTargetBounds,
                               BoundsExpr *RHSBounds) {
@@ -825,7 +1026,7 @@ namespace {
       }
     }
 
-    void DumpExprsSet(raw_ostream &OS, ExprSetTy Exprs) {
+    void DumpExprsSet(raw_ostream &OS, const ExprSetTy &Exprs) {
       if (Exprs.size() == 0)
         OS << "{ }\n";
       else {
@@ -897,21 +1098,41 @@ namespace {
             Kind = BCK_NullTermWriteAssign;
           // Otherwise, use the default range check for bounds.
         }
+        bool ProvenSafe = false;
         if (LValueBounds->isUnknown()) {
           S.Diag(E->getBeginLoc(), diag::err_expected_bounds) << E->getSourceRange();
           LValueBounds = S.CreateInvalidBoundsExpr();
         } else {
-          CheckBoundsAtMemoryAccess(Deref, LValueBounds, Kind, CSS, EquivExprs);
+          ProvenSafe = CheckBoundsAtMemoryAccess(Deref, LValueBounds, Kind,
+                                                 CSS, EquivExprs);
         }
+        // A write through a null-terminated pointer at its upper bound is
+        // in range but must still check that the value written is zero.
+        if (Kind == BCK_NullTermWriteAssign)
+          ProvenSafe = false;
+        // If the whole check could not be proved, the lower bound
+        // comparison may still be known to succeed. The check for a write
+        // through a null-terminated pointer needs its lower bound comparison
+        // for the additional check at the upper bound.
+        bool LowerProven = false;
+        if (!ProvenSafe && Kind != BCK_NullTermWriteAssign &&
+            !LValueBounds->isInvalid())
+          LowerProven = ProveLowerBoundAtMemoryAccess(Deref, LValueBounds,
+                                                      EquivExprs);
+        if (LowerProven)
+          ++NumLowerBoundChecksProven;
         if (UnaryOperator *UO = dyn_cast<UnaryOperator>(Deref)) {
           assert(!UO->hasBoundsExpr());
           UO->setBoundsExpr(LValueBounds);
           UO->setBoundsCheckKind(Kind);
-
+          UO->setBoundsCheckProvenSafe(ProvenSafe);
+          UO->setBoundsCheckLowerProven(LowerProven);
         } else if (ArraySubscriptExpr *AS = dyn_cast<ArraySubscriptExpr>(Deref)) {
           assert(!AS->hasBoundsExpr());
           AS->setBoundsExpr(LValueBounds);
           AS->setBoundsCheckKind(Kind);
+          AS->setBoundsCheckProvenSafe(ProvenSafe);
+          AS->setBoundsCheckLowerProven(LowerProven);
         } else
           llvm_unreachable("unexpected expression kind");
       }
@@ -991,6 +1212,18 @@ namespace {
       HasFreeVariables = 0x100 // Source or destination has free variables.
     };
 
+    struct CachedProof {
+      ProofResult Result;
+      ProofFailure Cause;
+    };
+
+    // Results of ProveBoundsDeclValidity for this function, keyed on the
+    // profiles of the declared and source bounds, the kind of proof, the
+    // sets of equivalent expressions and FactsVersion.  Proofs that find
+    // free variables are not cached, since the free variables are reported
+    // with the expressions in which they were found.
+    std::map<llvm::FoldingSetNodeID, CachedProof> ProofCache;
+
     enum class DiagnosticNameForTarget {
       Destination = 0x0,
       Target = 0x1
@@ -1907,16 +2140,17 @@ namespace {
     static bool FactExists(ASTContext &Ctx, Expr *E1, Expr *E2, EquivExprSets *EquivExprs,
                            std::pair<ComparisonSet, ComparisonSet>& Facts) {
       bool ExistsIn = false, ExistsKill = false;
-      for (auto InFact : Facts.first) {
-        if (Lexicographic(Ctx, EquivExprs).CompareExpr(E1, InFact.first) == Lexicographic::Result::Equal &&
-            Lexicographic(Ctx, EquivExprs).CompareExpr(E2, InFact.second) == Lexicographic::Result::Equal) {
+      Lexicographic Lex(Ctx, EquivExprs);
+      for (const auto &InFact : Facts.first) {
+        if (Lex.CompareExpr(E1, InFact.first) == Lexicographic::Result::Equal &&
+            Lex.CompareExpr(E2, InFact.second) == Lexicographic::Result::Equal) {
           ExistsIn = true;
           break;
         }
       }
-      for (auto KillFact : Facts.second) {
-        if (Lexicographic(Ctx, EquivExprs).CompareExpr(E1, KillFact.first) == Lexicographic::Result::Equal &&
-            Lexicographic(Ctx, EquivExprs).CompareExpr(E2, KillFact.second) == Lexicographic::Result::Equal) {
+      for (const auto &KillFact : Facts.second) {
+        if (Lex.CompareExpr(E1, KillFact.first) == Lexicographic::Result::Equal &&
+            Lex.CompareExpr(E2, KillFact.second) == Lexicographic::Result::Equal) {
           ExistsKill = true;
           break;
         }
@@ -1984,11 +2218,139 @@ namespace {
     // If any free variable is found in SrcBounds or DeclaredBounds, return
     // False and add the free variables to FreeVariables.
     ProofResult ProveBoundsDeclValidity(
-                const BoundsExpr *DeclaredBounds, 
+                const BoundsExpr *DeclaredBounds,
                 const BoundsExpr *SrcBounds,
                 ProofFailure &Cause, EquivExprSets *EquivExprs,
                 FreeVariableListTy &FreeVariables,
                 ProofStmtKind Kind = ProofStmtKind::BoundsDeclaration) {
+      llvm::TimeTraceScope TimeScope("ProveBoundsDeclValidity");
+      ++NumBoundsProofs;
+      ++Stats.Proofs;
+      if (EquivExprs) {
+        MaxEquivExprSets.updateMax(EquivExprs->size());
+        Stats.MaxEquivExprSets =
+          std::max<size_t>(Stats.MaxEquivExprSets, EquivExprs->size());
+        for (const auto &Set : *EquivExprs) {
+          MaxEquivExprSetSize.updateMax(Set.size());
+          Stats.MaxEquivExprSetSize =
+            std::max<size_t>(Stats.MaxEquivExprSetSize, Set.size());
+        }
+      }
+
+      // Bounds that use bounds temporaries, such as the bounds of a string
+      // literal or of a dynamic bounds cast, cannot be profiled.  They are
+      // not compared by profile and their proofs are not cached.
+      bool Profilable = !ExprUtil::ContainsBoundsTemporary(DeclaredBounds) &&
+                        !ExprUtil::ContainsBoundsTemporary(SrcBounds);
+      llvm::FoldingSetNodeID DeclaredID, SrcID;
+      if (Profilable) {
+        DeclaredBounds->Profile(DeclaredID, S.Context, /*Canonical=*/true);
+        SrcBounds->Profile(SrcID, S.Context, /*Canonical=*/true);
+      }
+      if (ProveBoundsDeclValiditySyntactically(
+              DeclaredBounds, SrcBounds, Profilable && DeclaredID == SrcID)) {
+        ++NumBoundsProofsSyntactic;
+        ++NumBoundsProofsTrue;
+        ++Stats.SyntacticProofs;
+        ++Stats.ProofsTrue;
+        Cause = ProofFailure::None;
+        return ProofResult::True;
+      }
+      ++NumBoundsProofsNotSyntactic;
+
+      llvm::FoldingSetNodeID ID(DeclaredID);
+      if (Profilable) {
+        ID.AddNodeID(SrcID);
+        ID.AddInteger(static_cast<unsigned>(Kind));
+        ID.AddInteger(FactsVersion);
+        ID.AddBoolean(EquivExprs != nullptr);
+        if (EquivExprs) {
+          for (const auto &Set : *EquivExprs) {
+            ID.AddInteger(Set.size());
+            for (const Expr *E : Set)
+              ID.AddPointer(E);
+          }
+        }
+      }
+
+      ProofResult Result;
+      auto It = Profilable ? ProofCache.find(ID) : ProofCache.end();
+      if (It != ProofCache.end()) {
+        ++NumBoundsProofCacheHits;
+        ++Stats.CachedProofs;
+        Result = It->second.Result;
+        Cause = It->second.Cause;
+      } else if (!UseProofStep()) {
+        Result = ProofResult::Maybe;
+        Cause = ProofFailure::None;
+      } else {
+        llvm::TimeTraceScope ImplScope("ProveBoundsDeclValidityImpl");
+        size_t NumFreeVariables = FreeVariables.size();
+        Result = ProveBoundsDeclValidityImpl(
+            DeclaredBounds, SrcBounds, Cause, EquivExprs, FreeVariables, Kind);
+        if (Profilable && FreeVariables.size() == NumFreeVariables)
+          ProofCache[ID] = {Result, Cause};
+      }
+
+      switch (Result) {
+        case ProofResult::True:
+          ++NumBoundsProofsTrue;
+          ++Stats.ProofsTrue;
+          break;
+        case ProofResult::False:
+          ++NumBoundsProofsFalse;
+          ++Stats.ProofsFalse;
+          break;
+        case ProofResult::Maybe:
+          ++NumBoundsProofsMaybe;
+          ++Stats.ProofsMaybe;
+          break;
+      }
+      return Result;
+    }
+
+    // Try to prove that SrcBounds implies the validity of DeclaredBounds
+    // without EquivExprs, facts or free variables.  This is true when
+    // DeclaredBounds or SrcBounds is trivial, when the bounds are identical
+    // (SameProfile means that their canonical profiles are equal), or when
+    // both bounds are constant-sized ranges with the same base and the
+    // source range contains the declared range.  Bounds that use bounds
+    // temporaries have no profile, so SameProfile is false for them and
+    // identical bounds of that kind are proved by EquivalentBounds in
+    // ProveBoundsDeclValidityImpl instead.  These checks are cheap and
+    // settle many proofs before the cache key of the proof is computed from
+    // EquivExprs and before the costlier checks in
+    // ProveBoundsDeclValidityImpl.  If they succeed, so would the full proof.
+    bool ProveBoundsDeclValiditySyntactically(const BoundsExpr *DeclaredBounds,
+                                              const BoundsExpr *SrcBounds,
+                                              bool SameProfile) {
+      llvm::TimeTraceScope TimeScope("ProveBoundsDeclValiditySyntactically");
+      if (SrcBounds->isInvalid() || DeclaredBounds->isInvalid() ||
+          SrcBounds->isAny() || DeclaredBounds->isUnknown())
+        return true;
+
+      if (SameProfile)
+        return true;
+
+      BaseRange DeclaredRange(S);
+      BaseRange SrcRange(S);
+      if (!CreateBaseRange(DeclaredBounds, &DeclaredRange, nullptr) ||
+          !DeclaredRange.IsConstantSizedRange() ||
+          !CreateBaseRange(SrcBounds, &SrcRange, nullptr) ||
+          !SrcRange.IsConstantSizedRange())
+        return false;
+
+      ProofFailure Cause = ProofFailure::None;
+      return SrcRange.InRange(DeclaredRange, Cause, nullptr, Facts) ==
+             ProofResult::True;
+    }
+
+    ProofResult ProveBoundsDeclValidityImpl(
+                const BoundsExpr *DeclaredBounds,
+                const BoundsExpr *SrcBounds,
+                ProofFailure &Cause, EquivExprSets *EquivExprs,
+                FreeVariableListTy &FreeVariables,
+                ProofStmtKind Kind) {
       assert(BoundsUtil::IsStandardForm(DeclaredBounds) &&
         "declared bounds not in standard form");
       assert(BoundsUtil::IsStandardForm(SrcBounds) &&
@@ -2057,8 +2419,8 @@ namespace {
     // (the declared return bounds for the enclosing function).
     ProofResult ProveReturnBoundsValidity(Expr *RetExpr,
                                           BoundsExpr *RetExprBounds,
-                                          const EquivExprSets EQ,
-                                          const EqualExprTy G,
+                                          const EquivExprSets &EQ,
+                                          const EqualExprTy &G,
                                           ProofFailure &Cause,
                                           FreeVariableListTy &FreeVariables) {
       // Check some basic properties of the declared ReturnBounds and the
@@ -2199,6 +2561,12 @@ namespace {
 #endif
       assert(BoundsUtil::IsStandardForm(Bounds) &&
              "bounds not in standard form");
+      // If the proof budget is exhausted, leave the memory access to the
+      // runtime check.
+      if (!UseProofStep()) {
+        Cause = ProofFailure::None;
+        return ProofResult::Maybe;
+      }
       Cause = ProofFailure::None;
       BaseRange ValidRange(S);
 
@@ -2626,7 +2994,9 @@ namespace {
       }
     }
 
-    void CheckBoundsAtMemoryAccess(Expr *Deref, BoundsExpr *ValidRange,
+    // Check that the memory access Deref is within ValidRange.  Returns true
+    // if the access is proved to be within ValidRange.
+    bool CheckBoundsAtMemoryAccess(Expr *Deref, BoundsExpr *ValidRange,
                                    BoundsCheckKind CheckKind,
                                    CheckedScopeSpecifier CSS,
                                    EquivExprSets *EquivExprs) {
@@ -2634,7 +3004,7 @@ namespace {
       // If we are running the 3C (AST only) tool, then disable
       // bounds checking.
       if (S.getLangOpts()._3C)
-        return;
+        return false;
 
       ProofFailure Cause;
       ProofResult Result;
@@ -2660,6 +3030,17 @@ namespace {
         llvm_unreachable("unexpected expression kind");
       }
 
+      // The bounds widened after a test of p[i] have an upper bound p + i + 1
+      // that is not a constant offset from the lower bound p, so they are
+      // not handled by ProveMemoryAccessInRange.
+      if (Result == ProofResult::Maybe && !isa<MemberExpr>(Deref) &&
+          ProveUpperBoundAtMemoryAccess(Deref, ValidRange, CheckKind,
+                                        EquivExprs) &&
+          ProveLowerBoundAtMemoryAccess(Deref, ValidRange, EquivExprs)) {
+        ++NumVariableUpperBoundChecksProven;
+        Result = ProofResult::True;
+      }
+
       if (Result == ProofResult::False) {
         #ifdef TRACE_RANGE
         llvm::outs() << "Memory access Failure Causes:";
@@ -2672,6 +3053,180 @@ namespace {
         ExplainProofFailure(ExprLoc, Cause, ProofKind);
         S.Diag(ExprLoc, diag::note_expanded_inferred_bounds) << ValidRange;
       }
+      return Result == ProofResult::True;
+    }
+
+    // No object ends within this many bytes of the top of the address space,
+    // so p + i does not wrap around for smaller constant byte offsets.
+    static const uint64_t MaxLowerProvenOffset = 4096;
+
+    // Check whether the lower bound of ValidRange is at or below the address
+    // accessed by Deref, which is p[i] or *(p + i) or *p.  This is the case
+    // if the lower bound is p and i is a small non-negative constant.  An
+    // unsigned variable i is not enough: p + i wraps around for large values
+    // of i, so an access below the lower bound would pass the check of the
+    // upper bound alone.  A variable i is accepted only for the bounds
+    // (p, p + i + 1) that bounds widening created for a test of p[i], since
+    // that test compared p + i against the lower bound p.
+    bool ProveLowerBoundAtMemoryAccess(Expr *Deref, BoundsExpr *ValidRange,
+                                       EquivExprSets *EquivExprs) {
+      if (S.getLangOpts()._3C)
+        return false;
+
+      RangeBoundsExpr *Range = dyn_cast<RangeBoundsExpr>(ValidRange);
+      if (!Range)
+        return false;
+
+      Expr *Base = nullptr;
+      Expr *Index = nullptr;
+      if (ArraySubscriptExpr *AS = dyn_cast<ArraySubscriptExpr>(Deref)) {
+        Base = AS->getBase();
+        Index = AS->getIdx();
+      } else if (UnaryOperator *UO = dyn_cast<UnaryOperator>(Deref)) {
+        Base = UO->getSubExpr()->IgnoreParens();
+        if (BinaryOperator *BO = dyn_cast<BinaryOperator>(Base)) {
+          if (BO->getOpcode() == BinaryOperatorKind::BO_Add) {
+            Base = BO->getLHS();
+            Index = BO->getRHS();
+            if (!Base->getType()->isPointerType())
+              std::swap(Base, Index);
+          }
+        }
+      } else
+        return false;
+
+      if (Index) {
+        if (!Index->getType()->isIntegerType())
+          return false;
+        Optional<llvm::APSInt> IndexVal =
+          Index->getIntegerConstantExpr(S.Context);
+        if (!IndexVal)
+          return IsWidenedAtAccess(Range, Base, Index, EquivExprs) &&
+                 ExprUtil::EqualValue(S.Context, Range->getLowerExpr(), Base,
+                                      EquivExprs);
+        if (IndexVal->isNegative())
+          return false;
+        QualType ElemTy = Deref->getType();
+        if (ElemTy->isIncompleteType() || IndexVal->getActiveBits() > 32)
+          return false;
+        uint64_t ElemSize = S.Context.getTypeSizeInChars(ElemTy).getQuantity();
+        if (IndexVal->getZExtValue() * ElemSize >= MaxLowerProvenOffset)
+          return false;
+      }
+
+      return ExprUtil::EqualValue(S.Context, Range->getLowerExpr(), Base,
+                                  EquivExprs);
+    }
+
+    // Check whether Range is widened bounds whose upper bound is Base + Index
+    // + 1, where Base + Index is the address accessed.
+    bool IsWidenedAtAccess(RangeBoundsExpr *Range, Expr *Base, Expr *Index,
+                           EquivExprSets *EquivExprs) {
+      if (!WidenedBoundsExprs.count(Range))
+        return false;
+      BinaryOperator *Upper =
+          dyn_cast<BinaryOperator>(Range->getUpperExpr()->IgnoreParens());
+      if (!Upper || Upper->getOpcode() != BinaryOperatorKind::BO_Add)
+        return false;
+      Optional<llvm::APSInt> One =
+          Upper->getRHS()->getIntegerConstantExpr(S.Context);
+      if (!One || *One != 1)
+        return false;
+      BinaryOperator *Access =
+          dyn_cast<BinaryOperator>(Upper->getLHS()->IgnoreParens());
+      if (!Access || Access->getOpcode() != BinaryOperatorKind::BO_Add)
+        return false;
+      return ExprUtil::EqualValue(S.Context, Access->getLHS(), Base,
+                                  EquivExprs) &&
+             HaveSameReferentSize(Access, Base) &&
+             ExprUtil::EqualValue(S.Context, Access->getRHS(), Index,
+                                  EquivExprs);
+    }
+
+    // Check whether the pointers E1 and E2 point to objects of the same size,
+    // so that adding the same integer to each adds the same byte offset.
+    bool HaveSameReferentSize(Expr *E1, Expr *E2) {
+      llvm::APSInt Size1, Size2;
+      if (!ExprUtil::getReferentSizeInChars(S.Context, E1->getType(), Size1) ||
+          !ExprUtil::getReferentSizeInChars(S.Context, E2->getType(), Size2))
+        return false;
+      return llvm::APSInt::isSameValue(Size1, Size2);
+    }
+
+    // Check whether the address accessed by Deref, which is p[i] or *e, is
+    // below the upper bound of ValidRange.  The upper bound is split into a
+    // base and a constant offset, such as p + i and 1 for the upper bound
+    // p + i + 1, and the memory accessed must start at the same base and end
+    // at or below the offset.  A null-terminated read may also access the
+    // element at the upper bound.  As in ProveLowerBoundAtMemoryAccess, the
+    // addresses are assumed not to wrap around.
+    bool ProveUpperBoundAtMemoryAccess(Expr *Deref, BoundsExpr *ValidRange,
+                                       BoundsCheckKind Kind,
+                                       EquivExprSets *EquivExprs) {
+      RangeBoundsExpr *Range = dyn_cast<RangeBoundsExpr>(ValidRange);
+      if (!Range)
+        return false;
+
+      // Split E into a base and a constant offset.  An expression with a
+      // variable offset, such as p + i, is a base with an offset of 0.
+      auto SplitAddress = [&](Expr *E, Expr *&Base, llvm::APSInt &Offset) {
+        Expr *Variable = nullptr;
+        if (SplitIntoBaseAndOffset(E, Base, Offset, Variable) !=
+            BaseRange::Kind::ConstantSized) {
+          Base = E->IgnoreParens();
+          Offset = llvm::APSInt(PointerWidth, false);
+        }
+      };
+
+      Expr *UpperBase;
+      llvm::APSInt UpperOffset;
+      SplitAddress(Range->getUpperExpr(), UpperBase, UpperOffset);
+
+      Expr *PtrBase;
+      llvm::APSInt AccessOffset;
+      bool SameBase = false;
+      if (UnaryOperator *UO = dyn_cast<UnaryOperator>(Deref)) {
+        PtrBase = UO->getSubExpr();
+        Expr *AccessBase;
+        SplitAddress(PtrBase, AccessBase, AccessOffset);
+        SameBase = ExprUtil::EqualValue(S.Context, UpperBase, AccessBase,
+                                        EquivExprs) &&
+                   HaveSameReferentSize(UpperBase, AccessBase);
+      } else if (ArraySubscriptExpr *AS = dyn_cast<ArraySubscriptExpr>(Deref)) {
+        PtrBase = AS->getBase();
+        // p[i] accesses the upper bound base p + i at offset 0.
+        BinaryOperator *BO =
+            dyn_cast<BinaryOperator>(UpperBase->IgnoreParens());
+        if (!BO || BO->getOpcode() != BinaryOperatorKind::BO_Add)
+          return false;
+        // EqualValue ignores pointer casts, so (array_ptr<char>)p and p are
+        // the same base.  The index is scaled by the referent size of the
+        // cast type, so it must match that of the accessed element.
+        SameBase = ExprUtil::EqualValue(S.Context, BO->getLHS(), PtrBase,
+                                        EquivExprs) &&
+                   HaveSameReferentSize(BO, PtrBase) &&
+                   ExprUtil::EqualValue(S.Context, BO->getRHS(),
+                                        AS->getIdx(), EquivExprs);
+        AccessOffset = llvm::APSInt(PointerWidth, false);
+      } else
+        return false;
+      if (!SameBase)
+        return false;
+
+      llvm::APSInt ElementSize;
+      if (!ExprUtil::getReferentSizeInChars(S.Context, PtrBase->getType(),
+                                            ElementSize))
+        return false;
+      bool Overflow = false;
+      llvm::APSInt AccessEnd = AccessOffset;
+      if (Kind != BoundsCheckKind::BCK_NullTermRead) {
+        ExprUtil::EnsureEqualBitWidths(AccessEnd, ElementSize);
+        AccessEnd = AccessEnd.sadd_ov(ElementSize, Overflow);
+        if (Overflow)
+          return false;
+      }
+      ExprUtil::EnsureEqualBitWidths(AccessEnd, UpperOffset);
+      return AccessEnd <= UpperOffset;
     }
 
 
@@ -2691,9 +3246,12 @@ namespace {
       BoundsWideningAnalyzer(BoundsWideningAnalysis(SemaRef, Cfg,
                                                     Info.BoundsVarsLower,
                                                     Info.BoundsVarsUpper)),
-      AbstractSetMgr(AbstractSetManager(SemaRef, Info.VarUses)),
+      HasNullTermPtrs(Info.HasNullTermPtrs),
+      AbstractSetMgr(SemaRef, Info.VarUses),
       BoundsSiblingFields(Info.BoundsSiblingFields),
-      IncludeNullTerminator(false) {
+      IncludeNullTerminator(false),
+      FactsVersion(0),
+      ProofSteps(0) {
         if (FD) {
           ReturnVal =
             new (S.Context) BoundsValueExpr(SourceLocation(),
@@ -2719,39 +3277,26 @@ namespace {
       BoundsWideningAnalyzer(BoundsWideningAnalysis(SemaRef, nullptr,
                                                     Info.BoundsVarsLower,
                                                     Info.BoundsVarsUpper)),
-      AbstractSetMgr(AbstractSetManager(SemaRef, Info.VarUses)),
+      HasNullTermPtrs(Info.HasNullTermPtrs),
+      AbstractSetMgr(SemaRef, Info.VarUses),
       BoundsSiblingFields(Info.BoundsSiblingFields),
-      IncludeNullTerminator(false) {}
-
-    void IdentifyChecked(Stmt *S, StmtSetTy &MemoryCheckedStmts, StmtSetTy &BoundsCheckedStmts, CheckedScopeSpecifier CSS) {
-      if (!S)
-        return;
-
-      if (CSS == CheckedScopeSpecifier::CSS_Memory)
-        if (isa<Expr>(S) || isa<DeclStmt>(S) || isa<ReturnStmt>(S))
-          MemoryCheckedStmts.insert(S);
-
-      if (CSS == CheckedScopeSpecifier::CSS_Bounds)
-        if (isa<Expr>(S) || isa<DeclStmt>(S) || isa<ReturnStmt>(S))
-          BoundsCheckedStmts.insert(S);
-
-      if (const CompoundStmt *CS = dyn_cast<CompoundStmt>(S))
-        CSS = CS->getCheckedSpecifier();
-
-      auto Begin = S->child_begin(), End = S->child_end();
-      for (auto I = Begin; I != End; ++I)
-        IdentifyChecked(*I, MemoryCheckedStmts, BoundsCheckedStmts, CSS);
-    }
+      IncludeNullTerminator(false),
+      FactsVersion(0),
+      ProofSteps(0) {}
 
     // Add any subexpressions of S that occur in TopLevelElems to NestedExprs.
+    // The subexpressions of a child that occurs in TopLevelElems are not
+    // visited, since they are visited when the child itself is marked.
     void MarkNested(const Stmt *S, StmtSetTy &NestedExprs, StmtSetTy &TopLevelElems) {
       auto Begin = S->child_begin(), End = S->child_end();
       for (auto I = Begin; I != End; ++I) {
         const Stmt *Child = *I;
         if (!Child)
           continue;
-        if (TopLevelElems.find(Child) != TopLevelElems.end())
+        if (TopLevelElems.find(Child) != TopLevelElems.end()) {
           NestedExprs.insert(Child);
+          continue;
+        }
         MarkNested(Child, NestedExprs, TopLevelElems);
       }
    }
@@ -2811,7 +3356,7 @@ namespace {
    void UpdateWidenedBounds(BoundsWideningAnalysis &BA, const CFGBlock *Block,
                             Stmt *CurrStmt, CheckingState &State) {
      // Get the bounds widened before the current statement.
-     BoundsMapTy WidenedBounds = BA.GetStmtIn(Block, CurrStmt);
+     const BoundsMapTy &WidenedBounds = BA.GetStmtIn(Block, CurrStmt);
 
      // BoundsWideningAnalysis currently uses VarDecls as keys in the widened
      // bounds data structure, so we get the AbstractSet for each VarDecl in
@@ -2835,37 +3380,57 @@ namespace {
        auto I = State.ObservedBounds.find(A);
        if (I != State.ObservedBounds.end())
          I->second = Bounds;
+
+       // Killed bounds are reset to the declared bounds, which are not
+       // widened bounds.
+       if (Bounds != S.NormalizeBounds(V))
+         WidenedBoundsExprs.insert(Bounds);
      }
    }
 
-   // When a variable goes out of scope:
-   // 1) it has to be removed from ObservedBounds in the CheckingState
-   //    if it is a checked pointer variable because we no longer want
-   //    to validate its bounds, and
-   // 2) the expressions in EquivExprs that use it have to be removed
+   // When variables go out of scope:
+   // 1) they have to be removed from ObservedBounds in the CheckingState
+   //    if they are checked pointer variables because we no longer want
+   //    to validate their bounds, and
+   // 2) the expressions in EquivExprs that use them have to be removed
    //    because the expressions are now undefined.
-   void UpdateStateForVariableOutOfScope(CheckingState &State, VarDecl *V) {
-     if (V->hasBoundsExpr()) {
+   //
+   // The variables whose lifetimes end at the same point of a block (e.g.
+   // all the variables declared in a scope that is exited) are removed
+   // together, so EquivExprs is walked once for all of them rather than
+   // once per variable.  A set of EquivExprs that uses none of the
+   // variables is left as it is.
+   void UpdateStateForVariablesOutOfScope(CheckingState &State,
+                                          ArrayRef<VarDecl *> Vars) {
+     for (VarDecl *V : Vars) {
+       if (!V->hasBoundsExpr())
+         continue;
        const AbstractSet *A = AbstractSetMgr.GetOrCreateAbstractSet(V);
-       auto I = State.ObservedBounds.find(A);
-       if (I != State.ObservedBounds.end())
-         State.ObservedBounds.erase(A);
+       State.ObservedBounds.erase(A);
      }
 
-     EquivExprSets CrntEquivExprs(State.EquivExprs);
-     State.EquivExprs.clear();
-     for (auto I = CrntEquivExprs.begin(), E = CrntEquivExprs.end();
-                                                         I != E; ++I) {
-       ExprSetTy ExprList;
-       for (auto InnerList = (*I).begin(); InnerList != (*I).end();
-                                                         ++InnerList) {
-         Expr *E = *InnerList;
-         if (!ExprUtil::VariableOccurrenceCount(S, V, E))
-           ExprList.push_back(E);
+     if (State.EquivExprs.empty())
+       return;
+
+     auto UsesOutOfScopeVar = [&](Expr *E) {
+       for (VarDecl *V : Vars)
+         if (ExprUtil::VariableOccurrenceCount(S, V, E))
+           return true;
+       return false;
+     };
+
+     EquivExprSets &EquivExprs = State.EquivExprs;
+     auto Out = EquivExprs.begin();
+     for (auto I = EquivExprs.begin(), E = EquivExprs.end(); I != E; ++I) {
+       ExprSetTy &ExprList = *I;
+       llvm::erase_if(ExprList, UsesOutOfScopeVar);
+       if (ExprList.size() > 1) {
+         if (Out != I)
+           *Out = std::move(ExprList);
+         ++Out;
        }
-       if (ExprList.size() > 1)
-         State.EquivExprs.push_back(ExprList);
      }
+     EquivExprs.erase(Out, EquivExprs.end());
    }
 
    // Return true if Statement S is the first statement in a bundled block.
@@ -2899,11 +3464,48 @@ namespace {
      return false;
    }
 
+   // Print the costs of the Checked C analyses of this function for
+   // -fdump-checkedc-analysis-stats.  PrepassTime, CFGTime, FactsTime and
+   // CheckingTime are the wall times in seconds spent in the prepass, in
+   // building the CFG, in the available facts analysis and in TraverseCFG.
+   // The time spent in the bounds widening analysis is reported separately
+   // from the rest of the checking.
+   void DumpAnalysisStats(raw_ostream &OS, const AvailableFactsAnalysis &AFA,
+                          double PrepassTime, double CFGTime,
+                          double FactsTime, double CheckingTime) {
+     OS << "Checked C analysis stats for " << FunctionDeclaration->getName()
+        << ":\n";
+     OS << "  CFG blocks: " << Cfg->getNumBlockIDs() << "\n";
+     OS << "  Available facts block visits: " << AFA.GetNumBlockVisits()
+        << "\n";
+     OS << "  Bounds widening block visits: "
+        << BoundsWideningAnalyzer.GetNumBlockVisits() << "\n";
+     OS << "  Bounds proofs: " << Stats.Proofs << " (true: "
+        << Stats.ProofsTrue << ", false: " << Stats.ProofsFalse
+        << ", maybe: " << Stats.ProofsMaybe << ", syntactic: "
+        << Stats.SyntacticProofs << ", cached: " << Stats.CachedProofs
+        << ")\n";
+     OS << "  Max EquivExprs sets: " << Stats.MaxEquivExprSets
+        << ", max set size: " << Stats.MaxEquivExprSetSize << "\n";
+     OS << llvm::format("  Time (s): prepass %.6f, CFG %.6f, facts %.6f, "
+                        "widening %.6f, checking %.6f\n",
+                        PrepassTime, CFGTime, FactsTime, Stats.WideningTime,
+                        std::max(CheckingTime - Stats.WideningTime, 0.0));
+   }
+
    // Walk the CFG, traversing basic blocks in reverse post-oder.
    // For each element of a block, check bounds declarations.  Skip
    // CFG elements that are subexpressions of other CFG elements.
-   void TraverseCFG(AvailableFactsAnalysis& AFA, FunctionDecl *FD) {
+   //
+   // CFGCtx is the block ordering of the CFG that the dataflow analyses
+   // share. CheckedStmts are the statements of the body that are in checked
+   // scopes.
+   void TraverseCFG(AvailableFactsAnalysis& AFA, const CheckedCFGContext &CFGCtx,
+                    FunctionDecl *FD,
+                    const Sema::CheckedScopeStmts &CheckedStmts) {
      assert(Cfg && "expected CFG to exist");
+     llvm::TimeTraceScope TimeScope("CheckBoundsDeclarations",
+                                    [&]() { return FD->getNameAsString(); });
 #if TRACE_CFG
      llvm::outs() << "Dumping AST";
      Body->dump(llvm::outs(), Context);
@@ -2931,34 +3533,61 @@ namespace {
        }
      }
 
-     // Store a checking state for each CFG block in order to track
-     // the variables with bounds declarations that are in scope.
-     llvm::DenseMap<unsigned int, CheckingState> BlockStates;
-     BlockStates[Cfg->getEntry().getBlockID()] = ParamsState;
+     // Store the exit state of each CFG block whose successors have not all
+     // been checked yet, in order to track the variables with bounds
+     // declarations that are in scope.
+     llvm::BitVector CheckedBlocks(Cfg->getNumBlockIDs());
+     BlockExitStatesTy BlockStates;
+     BlockExitState &EntryState = BlockStates[Cfg->getEntry().getBlockID()];
+     EntryState.ObservedBounds =
+       std::make_shared<const BoundsContextTy>(ParamsState.ObservedBounds);
+     EntryState.EquivExprs = ParamsState.EquivExprs;
+     EntryState.PendingSuccs = CountPendingSuccs(&Cfg->getEntry(),
+                                                 CheckedBlocks);
 
      StmtSetTy NestedElements;
      FindNestedElements(NestedElements);
-     StmtSetTy MemoryCheckedStmts;
-     StmtSetTy BoundsCheckedStmts;
-     IdentifyChecked(Body, MemoryCheckedStmts, BoundsCheckedStmts, CheckedScopeSpecifier::CSS_Unchecked);
      BoundsContextTy InitialObservedBounds;
      bool InBundledBlock = false;
 
-     // Run the bounds widening analysis on this function.
-     BoundsWideningAnalyzer.WidenBounds(FD, NestedElements);
-     if (S.getLangOpts().DumpWidenedBounds)
-       BoundsWideningAnalyzer.DumpWidenedBounds(FD, 0);
-     if (S.getLangOpts().DumpWidenedBoundsDataflowSets)
-       BoundsWideningAnalyzer.DumpWidenedBounds(FD, 1);
+     // Run the bounds widening analysis on this function. If the function
+     // does not contain any null-terminated arrays there are no bounds to
+     // widen, so we skip the analysis unless its results need to be dumped.
+     // The widened bounds queried during checking are then empty.
+     if (HasNullTermPtrs || S.getLangOpts().DumpWidenedBounds ||
+         S.getLangOpts().DumpWidenedBoundsDataflowSets) {
+       double Start = S.getLangOpts().DumpCheckedCAnalysisStats ?
+         llvm::TimeRecord::getCurrentTime(false).getWallTime() : 0;
+       BoundsWideningAnalyzer.WidenBounds(FD, NestedElements, CFGCtx);
+       if (S.getLangOpts().DumpCheckedCAnalysisStats)
+         Stats.WideningTime =
+           llvm::TimeRecord::getCurrentTime(false).getWallTime() - Start;
+       if (S.getLangOpts().DumpWidenedBounds)
+         BoundsWideningAnalyzer.DumpWidenedBounds(FD, 0);
+       if (S.getLangOpts().DumpWidenedBoundsDataflowSets)
+         BoundsWideningAnalyzer.DumpWidenedBounds(FD, 1);
+     }
 
-     PostOrderCFGView POView = PostOrderCFGView(Cfg);
      ResetFacts();
-     for (const CFGBlock *Block : POView) {
-       AFA.GetFacts(Facts);
-       CheckingState BlockState = GetIncomingBlockState(Block, BlockStates);
+     for (const CFGBlock *Block : CFGCtx) {
+       AFA.TakeFacts(Facts);
+       ++FactsVersion;
+       CheckedBlocks.set(Block->getBlockID());
+       std::shared_ptr<const BoundsContextTy> IncomingBounds;
+       CheckingState BlockState = GetIncomingBlockState(Block, BlockStates,
+                                                        IncomingBounds);
+
+       // The variables whose lifetimes have ended since the last statement
+       // that was checked.
+       SmallVector<VarDecl *, 4> OutOfScopeVars;
 
        for (CFGElement Elem : *Block) {
          if (Elem.getKind() == CFGElement::Statement) {
+           if (!OutOfScopeVars.empty()) {
+             UpdateStateForVariablesOutOfScope(BlockState, OutOfScopeVars);
+             OutOfScopeVars.clear();
+           }
+
            CFGStmt CS = Elem.castAs<CFGStmt>();
            // We may attach a bounds expression to Stmt, so drop the const
            // modifier.
@@ -2968,22 +3597,23 @@ namespace {
            // another top-level element.
            if (NestedElements.find(S) != NestedElements.end())
              continue;
+           ++NumBoundsCheckedStmts;
 
            // Update the observed bounds with the widened bounds computed
            // above.
            UpdateWidenedBounds(BoundsWideningAnalyzer, Block, S, BlockState);
 
            CheckedScopeSpecifier CSS = CheckedScopeSpecifier::CSS_Unchecked;
-           const Stmt *Statement = S;
-           if (DeclStmt *DS = dyn_cast<DeclStmt>(S))
-             // CFG construction will synthesize decl statements so that
-             // each declarator is a separate CFGElem.  To see if we are in
-             // a checked scope, look at the original decl statement.
-             Statement = Cfg->getSourceDeclStmt(DS);
-           if (MemoryCheckedStmts.find(Statement) != MemoryCheckedStmts.end())
-             CSS = CheckedScopeSpecifier::CSS_Memory;
-           else if (BoundsCheckedStmts.find(Statement) != BoundsCheckedStmts.end())
-             CSS = CheckedScopeSpecifier::CSS_Bounds;
+           // A function with no checked scopes has nothing to look up.
+           if (!CheckedStmts.Specifiers.empty()) {
+             const Stmt *Statement = S;
+             if (DeclStmt *DS = dyn_cast<DeclStmt>(S))
+               // CFG construction will synthesize decl statements so that
+               // each declarator is a separate CFGElem.  To see if we are in
+               // a checked scope, look at the original decl statement.
+               Statement = Cfg->getSourceDeclStmt(DS);
+             CSS = CheckedStmts.lookup(Statement);
+           }
 
 #if TRACE_CFG
             llvm::outs() << "Visiting ";
@@ -3025,21 +3655,36 @@ namespace {
               // the declared variable bounds.  After checking the observed and
               // declared bounds, the observed bounds for each AbstractSet should
               // be reset to their observed bounds from before checking S.
-              BlockState.ObservedBounds = InitialObservedBounds;
+              BlockState.ObservedBounds = std::move(InitialObservedBounds);
             }
          }
          else if (Elem.getKind() == CFGElement::LifetimeEnds) {
             // Every variable going out of scope is indicated by a LifetimeEnds
             // CFGElement. When a variable goes out of scope, ObservedBounds and
-            // EquivExprs in the CheckingState have to be updated.
+            // EquivExprs in the CheckingState have to be updated.  This is
+            // done for consecutive LifetimeEnds elements all at once, before
+            // the next statement is checked or at the end of the block.
             CFGLifetimeEnds LE = Elem.castAs<CFGLifetimeEnds>();
             VarDecl *V = const_cast<VarDecl *>(LE.getVarDecl());
             if (V)
-              UpdateStateForVariableOutOfScope(BlockState, V);
+              OutOfScopeVars.push_back(V);
+         }
+       }
+       if (!OutOfScopeVars.empty())
+         UpdateStateForVariablesOutOfScope(BlockState, OutOfScopeVars);
+       if (Block->getBlockID() != Cfg->getEntry().getBlockID()) {
+         unsigned PendingSuccs = CountPendingSuccs(Block, CheckedBlocks);
+         if (PendingSuccs > 0) {
+           BlockExitState &ExitState = BlockStates[Block->getBlockID()];
+           if (IncomingBounds && *IncomingBounds == BlockState.ObservedBounds)
+             ExitState.ObservedBounds = std::move(IncomingBounds);
+           else
+             ExitState.ObservedBounds = std::make_shared<const BoundsContextTy>(
+                 std::move(BlockState.ObservedBounds));
+           ExitState.EquivExprs = std::move(BlockState.EquivExprs);
+           ExitState.PendingSuccs = PendingSuccs;
          }
        }
-       if (Block->getBlockID() != Cfg->getEntry().getBlockID())
-         BlockStates[Block->getBlockID()] = BlockState;
        AFA.Next();
      }
     }
@@ -3109,6 +3754,22 @@ namespace {
       if (!S)
         return CreateBoundsEmpty();
 
+      // Check recurses once for each level of nesting of S, and generated
+      // code can nest expressions very deeply (for example, long chains of
+      // additions or nested conditional operators).  Make sure that there is
+      // enough stack space for the next level, as template instantiation
+      // does.
+      BoundsExpr *ResultBounds = nullptr;
+      this->S.runWithSufficientStackSpace(S->getBeginLoc(), [&] {
+        ResultBounds = CheckStmt(S, CSS, State);
+      });
+      return ResultBounds;
+    }
+
+  private:
+    // CheckStmt implements Check for a non-null statement S.
+    BoundsExpr *CheckStmt(Stmt *S, CheckedScopeSpecifier CSS,
+                          CheckingState &State) {
       if (Expr *E = dyn_cast<Expr>(S)) {
         if (E->containsErrors())
           return CreateBoundsEmpty();
@@ -3198,6 +3859,7 @@ namespace {
       return ResultBounds;
     }
 
+  public:
     // Infer the bounds for an lvalue.
     //
     // The lvalue bounds determine whether it is valid to access memory
@@ -3286,7 +3948,7 @@ namespace {
     // bounds.
     void CheckChildren(Stmt *S, CheckedScopeSpecifier CSS,
                        CheckingState &State) {
-      ExprEqualMapTy SubExprSameValueSets;
+      ExprEqualListTy SubExprSameValueSets;
       auto Begin = S->child_begin(), End = S->child_end();
 
       for (auto I = Begin; I != End; ++I) {
@@ -3298,7 +3960,7 @@ namespace {
 
         // Store the set SameValue_i for each subexpression S_i.
         if (Expr *SubExpr = dyn_cast<Expr>(Child))
-          SubExprSameValueSets[SubExpr] = State.SameValue;
+          SubExprSameValueSets.emplace_back(SubExpr, State.SameValue);
       }
 
       // Use the stored sets SameValue_i for each subexpression S_i
@@ -3318,6 +3980,7 @@ namespace {
     void ResetFacts() {
       std::pair<ComparisonSet, ComparisonSet> EmptyFacts;
       Facts = EmptyFacts;
+      ++FactsVersion;
     }
 
     bool IsBoundsSafeInterfaceAssignment(QualType DestTy, Expr *E) {
@@ -3340,7 +4003,7 @@ namespace {
                                     CheckingState &State) {
       Expr *LHS = E->getLHS();
       Expr *RHS = E->getRHS();
-      ExprEqualMapTy SubExprSameValueSets;
+      ExprEqualListTy SubExprSameValueSets;
 
       // Infer the bounds for the target of the LHS.
       BoundsExpr *LHSTargetBounds = GetLValueTargetBounds(LHS, CSS);
@@ -3349,12 +4012,12 @@ namespace {
       // SameValue of expressions that produce the same value as the LHS.
       BoundsExpr *LHSLValueBounds, *LHSBounds;
       InferBounds(LHS, CSS, LHSLValueBounds, LHSBounds, State);
-      SubExprSameValueSets[LHS] = State.SameValue;
+      SubExprSameValueSets.emplace_back(LHS, State.SameValue);
 
       // Infer the rvalue bounds of the RHS, saving the set SameValue
       // of expressions that produce the same value as the RHS.
       BoundsExpr *RHSBounds = Check(RHS, CSS, State);
-      SubExprSameValueSets[RHS] = State.SameValue;
+      SubExprSameValueSets.emplace_back(RHS, State.SameValue);
 
       BinaryOperatorKind Op = E->getOpcode();
 
@@ -4283,6 +4946,9 @@ namespace {
 
         // Declared bounds override the bounds based on the array type.
         if (B) {
+          if (Context.hasSameType(E->getType(), VD->getType()))
+            if (BoundsExpr *NormalizedBounds = S.NormalizeBounds(VD))
+              return NormalizedBounds;
           Expr *Base = ExprCreatorUtil::CreateImplicitCast(S, E,
                          CastKind::CK_ArrayToPointerDecay,
                          Context.getDecayedType(E->getType()));
@@ -4462,35 +5128,18 @@ namespace {
     // ValidateBoundsContext checks that, after checking a top-level CFG
     // statement S, for each variable v in the checking state observed bounds
     // context, the observed bounds of v imply the declared bounds of v.
-    void ValidateBoundsContext(Stmt *S, CheckingState State,
+    void ValidateBoundsContext(Stmt *S, const CheckingState &State,
                                CheckedScopeSpecifier CSS,
                                const CFGBlock *Block = nullptr) {
-      // Construct a set of sets of equivalent expressions that contains all
-      // the equality facts in State.EquivExprs, as well as any equality facts
-      // implied by State.TargetSrcEquality.  These equality facts will only
-      // be used to validate the bounds context and will not persist across
-      // CFG statements.  The source expressions in State.TargetSrcEquality
-      // do not meet the criteria for persistent inclusion in State.EquivExprs:
-      // for example, they may create new objects or read memory via pointers.
-      EquivExprSets EquivExprs = State.EquivExprs;
-      for (auto const &Pair : State.TargetSrcEquality) {
-        Expr *Target = Pair.first;
-        Expr *Src = Pair.second;
-        bool FoundTarget = false;
-        for (auto I = EquivExprs.begin(); I != EquivExprs.end(); ++I) {
-          if (EqualExprsContainsExpr(*I, Target)) {
-            FoundTarget = true;
-            I->push_back(Src);
-            break;
-          }
-        }
-        if (!FoundTarget)
-          EquivExprs.push_back({Target, Src});
-      }
-
       BoundsMapTy BoundsWidenedAndNotKilled =
         BoundsWideningAnalyzer.GetBoundsWidenedAndNotKilled(Block, S);
 
+      // The equality facts are only needed to prove the observed bounds of
+      // the AbstractSets that S may have invalidated, so they are built the
+      // first time such an AbstractSet is found.
+      EquivExprSets EquivExprs;
+      bool BuiltEquivExprs = false;
+
       for (auto const &Pair : State.ObservedBounds) {
         const AbstractSet *A = Pair.first;
         BoundsExpr *ObservedBounds = Pair.second;
@@ -4498,25 +5147,76 @@ namespace {
           this->S.GetLValueDeclaredBounds(A->GetRepresentative(), CSS);
         if (!DeclaredBounds || DeclaredBounds->isUnknown())
           continue;
+        // The observed bounds of most AbstractSets are still their declared
+        // bounds after S, since S does not modify any lvalue expression in A
+        // or any variable used in the bounds of A.  These bounds trivially
+        // imply themselves.
+        if (ObservedBounds == DeclaredBounds)
+          continue;
         if (SkipBoundsValidation(A, CSS, State))
           continue;
-        if (ObservedBounds->isUnknown())
+        if (ObservedBounds->isUnknown()) {
           DiagnoseUnknownObservedBounds(S, A, DeclaredBounds, State);
-        else {
-          // If the lvalue expressions in A are variables represented by a
-          // declaration Var, we should issue diagnostics for observed bounds
-          // if Var is not in the set BoundsWidenedAndKilled which represents
-          // variables whose bounds are widened in this block before statement
-          // S and not killed by statement S.
-          bool DiagnoseObservedBounds = true;
-          if (const NamedDecl *V = A->GetDecl()) {
-            if (const VarDecl *Var = dyn_cast<VarDecl>(V))
-              DiagnoseObservedBounds = BoundsWidenedAndNotKilled.find(Var) ==
-                                        BoundsWidenedAndNotKilled.end();
+          continue;
+        }
+
+        // If the lvalue expressions in A are variables represented by a
+        // declaration Var, we should issue diagnostics for observed bounds
+        // if Var is not in the set BoundsWidenedAndKilled which represents
+        // variables whose bounds are widened in this block before statement
+        // S and not killed by statement S.  The proof is only used to issue
+        // diagnostics, so it is skipped for these variables.
+        //
+        // If A currently has widened bounds and the widened bounds of A are
+        // not killed by S, then a proof failure is caused by not being able
+        // to prove the widened bounds of A imply the declared bounds of A.
+        // Otherwise, statements that make no changes to A or any expressions
+        // used in the bounds of A would cause diagnostics to be emitted.
+        // For example, the widened bounds (p, (p + 0) + 1) do not provably
+        // imply the declared bounds (p, p + 0) due to the left-associativity
+        // of the observed upper bound (p + 0) + 1.
+        // TODO: checkedc-clang issue #867: the widened bounds of a variable
+        // should provably imply the declared bounds of a variable.
+        if (const NamedDecl *V = A->GetDecl()) {
+          if (const VarDecl *Var = dyn_cast<VarDecl>(V))
+            if (BoundsWidenedAndNotKilled.find(Var) !=
+                BoundsWidenedAndNotKilled.end())
+              continue;
+        }
+
+        if (!BuiltEquivExprs) {
+          BuildValidationEquivExprs(State, EquivExprs);
+          BuiltEquivExprs = true;
+        }
+        CheckObservedBounds(S, A, DeclaredBounds, ObservedBounds, State,
+                            &EquivExprs, CSS, Block);
+      }
+    }
+
+    // BuildValidationEquivExprs constructs a set of sets of equivalent
+    // expressions that contains all the equality facts in State.EquivExprs,
+    // as well as any equality facts implied by State.TargetSrcEquality.
+    // These equality facts will only be used to validate the bounds context
+    // and will not persist across CFG statements.  The source expressions in
+    // State.TargetSrcEquality do not meet the criteria for persistent
+    // inclusion in State.EquivExprs: for example, they may create new objects
+    // or read memory via pointers.
+    void BuildValidationEquivExprs(const CheckingState &State,
+                                   EquivExprSets &EquivExprs) {
+      EquivExprs = State.EquivExprs;
+      for (auto const &Pair : State.TargetSrcEquality) {
+        Expr *Target = Pair.first;
+        Expr *Src = Pair.second;
+        bool FoundTarget = false;
+        for (auto I = EquivExprs.begin(); I != EquivExprs.end(); ++I) {
+          if (EqualExprsContainsExpr(*I, Target)) {
+            FoundTarget = true;
+            I->push_back(Src);
+            break;
           }
-          CheckObservedBounds(S, A, DeclaredBounds, ObservedBounds, State,
-                              &EquivExprs, CSS, Block, DiagnoseObservedBounds);
         }
+        if (!FoundTarget)
+          EquivExprs.push_back({Target, Src});
       }
     }
 
@@ -4530,7 +5230,7 @@ namespace {
     // 2. Were not assigned a checked pointer at any point in the current
     //    top-level statement.
     bool SkipBoundsValidation(const AbstractSet *A, CheckedScopeSpecifier CSS,
-                              CheckingState State) {
+                              const CheckingState &State) {
       if (CSS != CheckedScopeSpecifier::CSS_Unchecked)
         return false;
 
@@ -4555,7 +5255,7 @@ namespace {
     // the diagnostic messages.
     void DiagnoseUnknownObservedBounds(Stmt *St, const AbstractSet *A,
                                        BoundsExpr *DeclaredBounds,
-                                       CheckingState State) {
+                                       const CheckingState &State) {
 
       SourceLocation Loc = BlameAssignmentWithinStmt(St, A, State,
                             diag::err_unknown_inferred_bounds);
@@ -4595,11 +5295,11 @@ namespace {
     // as well as any equality facts implied by State.TargetSrcEquality.
     void CheckObservedBounds(Stmt *St, const AbstractSet *A,
                              BoundsExpr *DeclaredBounds,
-                             BoundsExpr *ObservedBounds, CheckingState State,
+                             BoundsExpr *ObservedBounds,
+                             const CheckingState &State,
                              EquivExprSets *EquivExprs,
                              CheckedScopeSpecifier CSS,
-                             const CFGBlock *Block,
-                             bool DiagnoseObservedBounds) {
+                             const CFGBlock *Block) {
       ProofFailure Cause;
       FreeVariableListTy FreeVars;
       ProofResult Result = ProveBoundsDeclValidity(
@@ -4607,20 +5307,6 @@ namespace {
       if (Result == ProofResult::True)
         return;
 
-      // If A currently has widened bounds and the widened bounds of A are not
-      // killed by the statement St, then the proof failure was caused by not
-      // being able to prove the widened bounds of A imply the declared bounds
-      // of A. Diagnostics should not be emitted in this case. Otherwise,
-      // statements that make no changes to A or any expressions used in the
-      // bounds of A would cause diagnostics to be emitted.
-      // For example, the widened bounds (p, (p + 0) + 1) do not provably imply
-      // the declared bounds (p, p + 0) due to the left-associativity of the
-      // observed upper bound (p + 0) + 1.
-      // TODO: checkedc-clang issue #867: the widened bounds of a variable
-      // should provably imply the declared bounds of a variable.
-      if (!DiagnoseObservedBounds)
-        return;
-      
       // Which diagnostic message to print?
       unsigned DiagId =
           (Result == ProofResult::False)
@@ -4651,7 +5337,7 @@ namespace {
     // BlameAssignmentWithinStmt returns the source location of the blamed
     // assignment.
     SourceLocation BlameAssignmentWithinStmt(Stmt *St, const AbstractSet *A,
-                                             CheckingState State,
+                                             const CheckingState &State,
                                              unsigned DiagId) const {
       assert(St);
       const NamedDecl *V = A->GetDecl();
@@ -4720,8 +5406,8 @@ namespace {
     // value RetExpr imply the declared bounds for the enclosing function.
     void ValidateReturnBounds(ReturnStmt *RS, Expr *RetExpr,
                               BoundsExpr *RetExprBounds,
-                              const EquivExprSets EquivExprs,
-                              const EqualExprTy RetSameValue,
+                              const EquivExprSets &EquivExprs,
+                              const EqualExprTy &RetSameValue,
                               CheckedScopeSpecifier CSS) {
       // In an unchecked scope, if the enclosing function has a bounds-safe
       // interface, and the return value has not been implicitly converted
@@ -4999,25 +5685,29 @@ namespace {
       }
 
       // Adjust ObservedBounds to account for any uses of LValue in the bounds.
-      for (auto const &Pair : State.ObservedBounds) {
+      // In most functions, LValue is used in few of the observed bounds (or
+      // none of them), so only the bounds that are adjusted are updated.
+      for (auto &Pair : State.ObservedBounds) {
         const AbstractSet *A = Pair.first;
         BoundsExpr *Bounds = Pair.second;
         BoundsExpr *AdjustedBounds =
           BoundsUtil::ReplaceLValueInBounds(S, Bounds, LValue,
                                             OriginalValue, CSS);
-        State.ObservedBounds[A] = AdjustedBounds;
+        // We can check whether E modifies the bounds of A cheaply by
+        // comparing the pointer values of AdjustedBounds and Bounds because
+        // ReplaceLValueInBounds returns Bounds as AdjustedBounds if Bounds is
+        // not adjusted.
+        if (AdjustedBounds == Bounds)
+          continue;
+        Pair.second = AdjustedBounds;
 
         // If the assignment to LValue caused the observed bounds of A
         // to be bounds(unknown), add the pair to LostLValues.
         if (!Bounds->isUnknown() && AdjustedBounds->isUnknown())
           State.LostLValues[A] = std::make_pair(Bounds, LValue);
 
-        // If E modifies the bounds of A, add the pair to BlameAssignments.
-        // We can check this cheaply by comparing the pointer values of
-        // AdjustedBounds and Bounds because ReplaceLValueInBounds returns
-        // Bounds as AdjustedBounds if Bounds is not adjusted.
-        if (AdjustedBounds != Bounds)
-          State.BlameAssignments[A] = E;
+        // E modifies the bounds of A, so add the pair to BlameAssignments.
+        State.BlameAssignments[A] = E;
       }
 
       // Adjust SrcBounds to account for any uses of LValue.
@@ -5232,12 +5922,12 @@ namespace {
     // Val is an optional expression that may be contained in the updated
     // SameValue set. If Val is not provided, e is used instead.  If Val
     // and e are null, SameValue is not updated.
-    void UpdateSameValue(Expr *E, const ExprSetTy SubExprSameValue,
+    void UpdateSameValue(Expr *E, const ExprSetTy &SubExprSameValue,
                          ExprSetTy &SameValue, Expr *Val = nullptr) {
       Expr *SubExpr = dyn_cast<Expr>(*(E->child_begin()));
       assert(SubExpr);
-      ExprEqualMapTy SubExprSameValueSets;
-      SubExprSameValueSets[SubExpr] = SubExprSameValue;
+      ExprEqualListTy SubExprSameValueSets;
+      SubExprSameValueSets.emplace_back(SubExpr, SubExprSameValue);
       UpdateSameValue(E, SubExprSameValueSets, SameValue, Val);
     }
 
@@ -5256,7 +5946,7 @@ namespace {
     // Val is an optional expression that may be contained in the updated
     // SameValue set. If Val is not provided, e is used instead.  If Val
     // and e are null, SameValue is not updated.
-    void UpdateSameValue(Expr *E, ExprEqualMapTy SubExprSameValueSets,
+    void UpdateSameValue(Expr *E, const ExprEqualListTy &SubExprSameValueSets,
                          ExprSetTy &SameValue, Expr *Val = nullptr) {
       SameValue.clear();
 
@@ -5291,13 +5981,13 @@ namespace {
       // the same value as Val.
       else {
         Expr *ValPrime = nullptr;
-        for (llvm::detail::DenseMapPair<Expr *, ExprSetTy> Pair : SubExprSameValueSets) {
+        for (const auto &Pair : SubExprSameValueSets) {
           Expr *SubExpr_i = Pair.first;
           // For any modifying subexpression SubExpr_i of e, try to set
           // ValPrime to a nonmodifying expression from the set SameValue_i
           // of expressions that produce the same value as SubExpr_i.
           if (!ExprUtil::CheckIsNonModifying(S, SubExpr_i)) {
-            ExprSetTy SameValue_i = Pair.second;
+            const ExprSetTy &SameValue_i = Pair.second;
             for (auto I = SameValue_i.begin(); I != SameValue_i.end(); ++I) {
               Expr *E_i = *I;
               if (ExprUtil::CheckIsNonModifying(S, E_i)) {
@@ -5336,7 +6026,7 @@ namespace {
     // count while trying to construct the inverse expression of the source
     // with respect to LValue.
     Expr *GetOriginalValue(Expr *LValue, Expr *Target, Expr *Src,
-                           const EquivExprSets EQ,
+                           const EquivExprSets &EQ,
                            bool &OriginalValueUsesLValue) {
       // Check if Src has an inverse expression with respect to LValue.
       Expr *IV = nullptr;
@@ -5402,38 +6092,92 @@ namespace {
     // the block's observed bounds context contains only variables with bounds
     // that are in scope at S.  At the beginning of the block, each variable in
     // scope is mapped to its normalized declared bounds.
+    //
+    // IncomingBounds is set to the incoming observed bounds context, which
+    // is shared with the exit state of the predecessor if the block has only
+    // one checked predecessor.  The exit state of a predecessor is freed
+    // once all of its successors have been checked.
+    //
+    // A block that ends a switch statement or joins many cases can have
+    // hundreds of predecessors.  Most of them share the observed bounds
+    // context of the block that they were reached from, and intersecting
+    // with the same context a second time does not change the intersection,
+    // so each distinct context is only intersected once.  Once the
+    // intersection of the sets of equivalent expressions is empty, it stays
+    // empty.
     CheckingState GetIncomingBlockState(const CFGBlock *Block,
-                                        llvm::DenseMap<unsigned int, CheckingState> BlockStates) {
+                                        BlockExitStatesTy &BlockStates,
+                                        std::shared_ptr<const BoundsContextTy> &IncomingBounds) {
       CheckingState BlockState;
       bool IntersectionEmpty = true;
+      bool Intersected = false;
+      llvm::SmallPtrSet<const BoundsContextTy *, 4> IntersectedContexts;
       for (const CFGBlock *PredBlock : Block->preds()) {
         // Prevent null or non-traversed (e.g. unreachable) blocks from causing
         // the incoming bounds context and EquivExprs set for a block to be empty.
         if (!PredBlock)
           continue;
-        if (BlockStates.find(PredBlock->getBlockID()) == BlockStates.end())
+        auto PredStateIt = BlockStates.find(PredBlock->getBlockID());
+        if (PredStateIt == BlockStates.end())
           continue;
-        CheckingState PredState = BlockStates[PredBlock->getBlockID()];
+        BlockExitState &PredState = PredStateIt->second;
+        bool LastUse = PredState.PendingSuccs <= 1;
         if (IntersectionEmpty) {
-          BlockState.ObservedBounds = PredState.ObservedBounds;
-          BlockState.EquivExprs = PredState.EquivExprs;
+          IncomingBounds = PredState.ObservedBounds;
+          IntersectedContexts.insert(IncomingBounds.get());
+          if (LastUse)
+            BlockState.EquivExprs = std::move(PredState.EquivExprs);
+          else
+            BlockState.EquivExprs = PredState.EquivExprs;
           IntersectionEmpty = false;
         }
         else {
-          BlockState.ObservedBounds =
-            IntersectBoundsContexts(PredState.ObservedBounds,
-                                    BlockState.ObservedBounds);
-          BlockState.EquivExprs = IntersectEquivExprs(PredState.EquivExprs,
-                                                      BlockState.EquivExprs);
+          // The first intersection also resets the observed bounds to the
+          // declared bounds, so it is done even if both predecessors share
+          // the same context.
+          if (!Intersected) {
+            BlockState.ObservedBounds = *IncomingBounds;
+            Intersected = true;
+            IntersectBoundsContexts(BlockState.ObservedBounds,
+                                    *PredState.ObservedBounds);
+            IntersectedContexts.insert(PredState.ObservedBounds.get());
+          } else if (IntersectedContexts.insert(
+                         PredState.ObservedBounds.get()).second)
+            IntersectBoundsContexts(BlockState.ObservedBounds,
+                                    *PredState.ObservedBounds);
+          if (!BlockState.EquivExprs.empty())
+            BlockState.EquivExprs =
+              IntersectEquivExprs(PredState.EquivExprs, BlockState.EquivExprs);
         }
+        if (LastUse)
+          BlockStates.erase(PredStateIt);
+        else
+          --PredState.PendingSuccs;
       }
+
+      if (Intersected)
+        IncomingBounds =
+          std::make_shared<const BoundsContextTy>(BlockState.ObservedBounds);
+      else if (IncomingBounds)
+        BlockState.ObservedBounds = *IncomingBounds;
       return BlockState;
     }
 
+    // CountPendingSuccs returns the number of successors of Block that have
+    // not been checked yet, i.e. that will use the exit state of Block.
+    unsigned CountPendingSuccs(const CFGBlock *Block,
+                               const llvm::BitVector &CheckedBlocks) {
+      unsigned Count = 0;
+      for (const CFGBlock *SuccBlock : Block->succs())
+        if (SuccBlock && !CheckedBlocks.test(SuccBlock->getBlockID()))
+          ++Count;
+      return Count;
+    }
+
     // ContextDifference returns a bounds context containing all AbstractSets
     // A in Context1 where Context1[A] != Context2[A].
-    BoundsContextTy ContextDifference(BoundsContextTy Context1,
-                                      BoundsContextTy Context2) {
+    BoundsContextTy ContextDifference(const BoundsContextTy &Context1,
+                                      const BoundsContextTy &Context2) {
       BoundsContextTy Difference;
       for (const auto &Pair : Context1) {
         const AbstractSet *A = Pair.first;
@@ -5449,7 +6193,8 @@ namespace {
     // EqualContexts returns true if Context1 and Context2 contain the same
     // sets of AbstractSets as keys, and for each key AbstractSet A,
     // Context1[A] == Context2[A].
-    bool EqualContexts(BoundsContextTy Context1, BoundsContextTy Context2) {
+    bool EqualContexts(const BoundsContextTy &Context1,
+                       const BoundsContextTy &Context2) {
       if (Context1.size() != Context2.size())
         return false;
 
@@ -5464,48 +6209,51 @@ namespace {
       return true;
     }
 
-    // IntersectBoundsContexts returns a bounds context resulting from taking
-    // the intersection of the contexts Context1 and Context2.
+    // IntersectBoundsContexts sets Context to the intersection of the
+    // contexts Context and Other, updating Context in place.
     //
-    // For each AbstractSet A that is in both Context1 and Context2, the
+    // For each AbstractSet A that is in both Context and Other, the
     // intersected context maps A to its normalized declared bounds.
-    // Context1 or Context2 may map A to widened bounds, but those bounds
+    // Context or Other may map A to widened bounds, but those bounds
     // should not persist across CFG blocks.  The observed bounds for each
     // in-scope AbstractSet should be reset to its normalized declared bounds
     // at the beginning of a block, before widening the bounds in the block.
-    BoundsContextTy IntersectBoundsContexts(BoundsContextTy Context1,
-                                            BoundsContextTy Context2) {
-      BoundsContextTy IntersectedContext;
-      for (auto const &Pair : Context1) {
-        const AbstractSet *A = Pair.first;
-        if (!Pair.second || !Context2.count(A))
-          continue;
-        if (BoundsExpr *B = S.GetLValueDeclaredBounds(A->GetRepresentative()))
-          IntersectedContext[A] = B;
+    void IntersectBoundsContexts(BoundsContextTy &Context,
+                                 const BoundsContextTy &Other) {
+      for (auto It = Context.begin(), End = Context.end(); It != End;) {
+        auto Current = It++;
+        const AbstractSet *A = Current->first;
+        auto OtherIt = Other.find(A);
+        BoundsExpr *B = nullptr;
+        if (OtherIt != Other.end() && OtherIt->second)
+          B = S.GetLValueDeclaredBounds(A->GetRepresentative());
+        if (B)
+          Current->second = B;
+        else
+          Context.erase(Current);
       }
-      return IntersectedContext;
     }
 
     // IntersectEquivExprs returns the intersection of two sets of sets of
     // equivalent expressions, where each set in EQ1 is intersected with
     // each set in EQ2 to produce an element of the result.
-    EquivExprSets IntersectEquivExprs(const EquivExprSets EQ1,
-                                      const EquivExprSets EQ2) {
+    EquivExprSets IntersectEquivExprs(const EquivExprSets &EQ1,
+                                      const EquivExprSets &EQ2) {
       EquivExprSets IntersectedEQ;
       for (auto I1 = EQ1.begin(); I1 != EQ1.end(); ++I1) {
-        ExprSetTy Set1 = *I1;
+        const ExprSetTy &Set1 = *I1;
         for (auto I2 = EQ2.begin(); I2 != EQ2.end(); ++I2) {
-          ExprSetTy Set2 = *I2;
+          const ExprSetTy &Set2 = *I2;
           ExprSetTy IntersectedExprSet = IntersectExprSets(Set1, Set2);
           if (IntersectedExprSet.size() > 1)
-            IntersectedEQ.push_back(IntersectedExprSet);
+            IntersectedEQ.push_back(std::move(IntersectedExprSet));
         }
       }
       return IntersectedEQ;
     }
 
     // IntersectExprSets returns the intersection of two sets of expressions.
-    ExprSetTy IntersectExprSets(const ExprSetTy Set1, const ExprSetTy Set2) {
+    ExprSetTy IntersectExprSets(const ExprSetTy &Set1, const ExprSetTy &Set2) {
       ExprSetTy IntersectedSet;
       for (auto I = Set1.begin(); I != Set1.end(); ++I) {
         Expr *E1 = *I;
@@ -5516,7 +6264,7 @@ namespace {
     }
 
     // IntersectDeclSets returns the intersection of Set1 and Set2.
-    DeclSetTy IntersectDeclSets(DeclSetTy Set1, DeclSetTy Set2) {
+    DeclSetTy IntersectDeclSets(const DeclSetTy &Set1, const DeclSetTy &Set2) {
       DeclSetTy Intersection;
       for (auto I = Set1.begin(), E = Set1.end(); I != E; ++I) {
         const VarDecl *V = *I;
@@ -5535,11 +6283,11 @@ namespace {
     // e1 may include value-preserving operations.  For example, if a set F
     // in EQ contains (T)e, where (T) is a value-preserving cast,
     // ValuePreservingE will be set to (T)e.
-    ExprSetTy GetEqualExprSetContainingExpr(Expr *E, EquivExprSets EQ,
+    ExprSetTy GetEqualExprSetContainingExpr(Expr *E, const EquivExprSets &EQ,
                                             Expr *&ValuePreservingE) {
       ValuePreservingE = nullptr;
       for (auto OuterList = EQ.begin(); OuterList != EQ.end(); ++OuterList) {
-        ExprSetTy F = *OuterList;
+        const ExprSetTy &F = *OuterList;
         for (auto InnerList = F.begin(); InnerList != F.end(); ++InnerList) {
           Expr *E1 = *InnerList;
           if (ExprUtil::EqualValue(S.Context, E, E1, nullptr)) {
@@ -5553,9 +6301,9 @@ namespace {
 
     // If e appears in a set F in EQ, GetEqualExprSetContainingExpr
     // returns F.  Otherwise, it returns an empty set.
-    ExprSetTy GetEqualExprSetContainingExpr(Expr *E, EquivExprSets EQ) {
+    ExprSetTy GetEqualExprSetContainingExpr(Expr *E, const EquivExprSets &EQ) {
       for (auto OuterList = EQ.begin(); OuterList != EQ.end(); ++OuterList) {
-        ExprSetTy F = *OuterList;
+        const ExprSetTy &F = *OuterList;
         if (::EqualExprsContainsExpr(S, F, E, nullptr))
           return F;
       }
@@ -5563,7 +6311,7 @@ namespace {
     }
 
     // IsEqualExprsSubset returns true if Exprs1 is a subset of Exprs2.
-    bool IsEqualExprsSubset(const ExprSetTy Exprs1, const ExprSetTy Exprs2) {
+    bool IsEqualExprsSubset(const ExprSetTy &Exprs1, const ExprSetTy &Exprs2) {
       for (auto I = Exprs1.begin(); I != Exprs1.end(); ++I) {
         Expr *E = *I;
         if (!EqualExprsContainsExpr(Exprs2, E))
@@ -5574,7 +6322,7 @@ namespace {
 
     // DoExprSetsIntersect returns true if the intersection of Exprs1 and
     // Exprs2 is nonempty.
-    bool DoExprSetsIntersect(const ExprSetTy Exprs1, const ExprSetTy Exprs2) {
+    bool DoExprSetsIntersect(const ExprSetTy &Exprs1, const ExprSetTy &Exprs2) {
       for (auto I = Exprs1.begin(); I != Exprs1.end(); ++I) {
         Expr *E = *I;
         if (EqualExprsContainsExpr(Exprs2, E))
@@ -5584,7 +6332,7 @@ namespace {
     }
 
     // EqualExprsContainsExpr returns true if the set Exprs contains E.
-    bool EqualExprsContainsExpr(const ExprSetTy Exprs, Expr *E) {
+    bool EqualExprsContainsExpr(const ExprSetTy &Exprs, Expr *E) {
       return ::EqualExprsContainsExpr(S, Exprs, E, nullptr);
     }
 
@@ -5804,13 +6552,9 @@ namespace {
       // size includes the null terminator.  It converts to an ArrayPtr that
       // could be used to overwrite the null terminator.  We need to prevent
       // this because literal strings may be shared and writeable, depending on
-      // the C implementation.
-      auto *Size = ExprCreatorUtil::CreateIntegerLiteral(Context,
-                     llvm::APInt(64, SL->getLength()));
-      auto *CBE =
-        new (Context) CountBoundsExpr(BoundsExpr::Kind::ElementCount,
-                                      Size, SourceLocation(),
-                                      SourceLocation());
+      // the C implementation.  The count bounds only depend on the length,
+      // so literals of the same length share them.
+      BoundsExpr *CBE = Context.getStringLiteralCountBounds(SL->getLength());
 
       auto PtrType = Context.getDecayedType(E->getType());
 
@@ -5913,6 +6657,13 @@ namespace {
       if (!B || B->isUnknown())
         return BoundsUtil::CreateBoundsAlwaysUnknown(S);
 
+      // Use the normalized bounds of VD, which are computed once per
+      // declaration, unless the type of DRE has been adjusted (for example,
+      // to a bounds-safe interface type in a checked scope).
+      if (S.Context.hasSameType(DRE->getType(), VD->getType()))
+        if (BoundsExpr *NormalizedBounds = S.NormalizeBounds(VD))
+          return NormalizedBounds;
+
       Expr *Base = ExprCreatorUtil::CreateImplicitCast(S, DRE,
                                       CastKind::CK_LValueToRValue,
                                       DRE->getType());
@@ -6086,7 +6837,7 @@ namespace {
                                  BoundsExpr *TargetBounds,
                                  BoundsExpr *LValueBounds,
                                  BoundsExpr *RValueBounds,
-                                 CheckingState State) {
+                                 const CheckingState &State) {
       switch (E->getCastKind()) {
         case CastKind::CK_BitCast:
         case CastKind::CK_NoOp:
@@ -6135,7 +6886,8 @@ namespace {
     // in State.ObservedBounds, GetLValueObservedBounds returns the observed
     // bounds for the rvalue expression produced by LValue as recorded in
     // State.ObservedBounds. Otherwise, GetLValueObservedBounds returns null.
-    BoundsExpr *GetLValueObservedBounds(Expr *LValue, CheckingState State) {
+    BoundsExpr *GetLValueObservedBounds(Expr *LValue,
+                                        const CheckingState &State) {
       Lexicographic Lex(S.Context, nullptr);
       LValue = Lex.IgnoreValuePreservingOperations(S.Context, LValue);
 
@@ -6587,59 +7339,714 @@ Expr *Sema::MakeAssignmentImplicitCastExplicit(Expr *E) {
                                              ICE->isBoundsSafeInterface());
 }
 
+namespace {
+  // Determine whether a function body uses anything that bounds checking
+  // looks at: checked pointer or array types, types with bounds-safe
+  // interfaces, declarations with bounds or interop types, variables that
+  // global bounds depend on, members whose siblings have bounds, checked
+  // scopes, bundled blocks, where clauses or bounds casts.  If it doesn't,
+  // checking the body can't issue diagnostics or attach bounds to it.
+  class CheckedCUsesFinder : public RecursiveASTVisitor<CheckedCUsesFinder> {
+  private:
+    Sema &S;
+    bool Found = false;
+    // Whether a record type, or one of its members, is relevant.
+    llvm::DenseMap<const RecordDecl *, bool> RelevantRecords;
+
+    bool IsRelevantDecl(DeclaratorDecl *D) {
+      return D->hasBoundsExpr() || D->getInteropTypeExpr() ||
+             IsRelevantType(D->getType());
+    }
+
+    bool IsRelevantRecord(const RecordDecl *RD) {
+      auto It = RelevantRecords.find(RD);
+      if (It != RelevantRecords.end())
+        return It->second;
+      // Guard against a record that contains itself through an array.
+      RelevantRecords[RD] = false;
+      bool Relevant = false;
+      for (FieldDecl *F : RD->fields())
+        if (IsRelevantDecl(F)) {
+          Relevant = true;
+          break;
+        }
+      return RelevantRecords[RD] = Relevant;
+    }
+
+    bool IsRelevantType(QualType QT) {
+      if (QT.isNull())
+        return false;
+      const Type *T = QT.getCanonicalType().getTypePtr();
+      if (const PointerType *PT = dyn_cast<PointerType>(T)) {
+        if (PT->isChecked())
+          return true;
+        // The records that an unchecked pointer points to are looked at
+        // when they are accessed.
+        QualType Pointee = PT->getPointeeType();
+        return !Pointee->isRecordType() && IsRelevantType(Pointee);
+      }
+      if (const ArrayType *AT = dyn_cast<ArrayType>(T))
+        return AT->isChecked() || IsRelevantType(AT->getElementType());
+      if (const FunctionProtoType *FPT = dyn_cast<FunctionProtoType>(T)) {
+        if (FPT->hasParamAnnots() || FPT->hasReturnAnnots() ||
+            IsRelevantType(FPT->getReturnType()))
+          return true;
+        for (QualType Param : FPT->getParamTypes())
+          if (IsRelevantType(Param))
+            return true;
+        return false;
+      }
+      if (const RecordType *RT = dyn_cast<RecordType>(T))
+        return IsRelevantRecord(RT->getDecl());
+      return false;
+    }
+
+  public:
+    CheckedCUsesFinder(Sema &S) : S(S) {}
+
+    bool Find(FunctionDecl *FD, Stmt *Body) {
+      if (FD) {
+        if (IsRelevantType(FD->getType()))
+          return true;
+        for (ParmVarDecl *Param : FD->parameters())
+          if (IsRelevantDecl(Param))
+            return true;
+      }
+      TraverseStmt(Body);
+      return Found;
+    }
+
+    bool VisitStmt(Stmt *St) {
+      if (CompoundStmt *CS = dyn_cast<CompoundStmt>(St))
+        Found = CS->getCheckedSpecifier() != CSS_Unchecked ||
+                CS->isBundledStmt();
+      else if (NullStmt *NS = dyn_cast<NullStmt>(St))
+        Found = NS->getWhereClause() != nullptr;
+      else if (ValueStmt *VS = dyn_cast<ValueStmt>(St))
+        Found = VS->getWhereClause() != nullptr;
+      return !Found;
+    }
+
+    bool VisitExpr(Expr *E) {
+      Found = isa<BoundsCastExpr>(E) || IsRelevantType(E->getType());
+      return !Found;
+    }
+
+    bool VisitDeclRefExpr(DeclRefExpr *E) {
+      if (VarDecl *V = dyn_cast<VarDecl>(E->getDecl())) {
+        auto Dependents = S.BoundsDependencies.DependentBoundsDecls(V);
+        Found = IsRelevantDecl(V) || Dependents.begin() != Dependents.end();
+      }
+      return !Found;
+    }
+
+    bool VisitMemberExpr(MemberExpr *E) {
+      if (FieldDecl *F = dyn_cast<FieldDecl>(E->getMemberDecl()))
+        Found = IsRelevantRecord(F->getParent());
+      return !Found;
+    }
+
+    bool VisitDeclaratorDecl(DeclaratorDecl *D) {
+      Found = IsRelevantDecl(D);
+      return !Found;
+    }
+  };
+}
+
+namespace {
+  // Collect the declarations outside of a function that checking its body
+  // depends on: the variables, functions and enumerators it refers to, the
+  // records whose members it accesses and the typedefs and tags it names,
+  // and transitively the declarations used in their types and bounds.
+  class BoundsCheckDependencyFinder
+    : public RecursiveASTVisitor<BoundsCheckDependencyFinder> {
+  private:
+    Sema &S;
+    FunctionDecl *FD;
+
+  public:
+    // A function that depends on too many declarations is not worth
+    // caching.
+    static const unsigned MaxDependencies = 4096;
+    llvm::SetVector<const Decl *> Dependencies;
+
+    BoundsCheckDependencyFinder(Sema &S, FunctionDecl *FD) : S(S), FD(FD) {}
+
+    void Add(const Decl *D) {
+      // The parameters of other functions are described by the types of
+      // those functions.
+      if (!D || isa<ParmVarDecl>(D) || D->getParentFunctionOrMethod() == FD)
+        return;
+      if (const RecordDecl *RD = dyn_cast<RecordDecl>(D))
+        if (const RecordDecl *Def = RD->getDefinition())
+          D = Def;
+      Dependencies.insert(D);
+    }
+
+    bool VisitDeclRefExpr(DeclRefExpr *E) {
+      Add(E->getDecl());
+      return true;
+    }
+
+    bool VisitMemberExpr(MemberExpr *E) {
+      // The bounds of the sibling members of a member can depend on it.
+      if (FieldDecl *F = dyn_cast<FieldDecl>(E->getMemberDecl()))
+        Add(F->getParent());
+      return true;
+    }
+
+    bool VisitTypedefTypeLoc(TypedefTypeLoc TL) {
+      Add(TL.getTypedefNameDecl());
+      return true;
+    }
+
+    bool VisitRecordTypeLoc(RecordTypeLoc TL) {
+      Add(TL.getDecl());
+      return true;
+    }
+
+    bool VisitEnumTypeLoc(EnumTypeLoc TL) {
+      Add(TL.getDecl());
+      return true;
+    }
+
+    void AddDeclarator(const DeclaratorDecl *DD, raw_ostream &OS) {
+      const PrintingPolicy &Policy = S.Context.getPrintingPolicy();
+      OS << DD->getNameAsString() << ' ' << DD->getType().getAsString();
+      if (const BoundsExpr *B = DD->getBoundsExpr()) {
+        OS << " : ";
+        B->printPretty(OS, nullptr, Policy);
+      }
+      if (const InteropTypeExpr *IT = DD->getInteropTypeExpr()) {
+        OS << " itype ";
+        IT->printPretty(OS, nullptr, Policy);
+      }
+      OS << '\n';
+      if (TypeSourceInfo *TSI = DD->getTypeSourceInfo())
+        TraverseTypeLoc(TSI->getTypeLoc());
+      TraverseStmt(const_cast<BoundsExpr *>(DD->getBoundsExpr()));
+    }
+
+    // Describe the dependencies of FD in OS.  Returns false if there are too
+    // many of them.
+    bool Describe(raw_ostream &OS) {
+      for (const FunctionDecl *R : FD->redecls())
+        if (R != FD)
+          Add(R);
+      for (unsigned I = 0; I < Dependencies.size(); I++) {
+        if (Dependencies.size() > MaxDependencies)
+          return false;
+        const Decl *D = Dependencies[I];
+        OS << D->getDeclKindName() << ' ';
+        if (const FunctionDecl *F = dyn_cast<FunctionDecl>(D)) {
+          AddDeclarator(F, OS);
+          for (const ParmVarDecl *P : F->parameters())
+            AddDeclarator(P, OS);
+        } else if (const VarDecl *V = dyn_cast<VarDecl>(D)) {
+          AddDeclarator(V, OS);
+          // Modifying V can invalidate the bounds that depend on it.
+          for (VarDecl *Dependent :
+               S.BoundsDependencies.DependentBoundsDecls(
+                   const_cast<VarDecl *>(V)))
+            Add(Dependent);
+        } else if (const EnumConstantDecl *E = dyn_cast<EnumConstantDecl>(D)) {
+          OS << E->getNameAsString() << ' ' << E->getInitVal() << '\n';
+        } else if (const TypedefNameDecl *T = dyn_cast<TypedefNameDecl>(D)) {
+          OS << T->getNameAsString() << ' '
+             << T->getUnderlyingType().getAsString() << '\n';
+          if (TypeSourceInfo *TSI = T->getTypeSourceInfo())
+            TraverseTypeLoc(TSI->getTypeLoc());
+        } else if (const RecordDecl *RD = dyn_cast<RecordDecl>(D)) {
+          OS << RD->getNameAsString() << ' ' << RD->isCompleteDefinition()
+             << '\n';
+          for (const FieldDecl *F : RD->fields())
+            AddDeclarator(F, OS);
+        } else if (const EnumDecl *ED = dyn_cast<EnumDecl>(D)) {
+          OS << ED->getNameAsString() << '\n';
+          for (const EnumConstantDecl *E : ED->enumerators())
+            OS << E->getNameAsString() << ' ' << E->getInitVal() << '\n';
+        } else if (const NamedDecl *ND = dyn_cast<NamedDecl>(D)) {
+          OS << ND->getNameAsString() << '\n';
+        }
+      }
+      return true;
+    }
+  };
+
+  // Records the diagnostics issued while a function body is checked with
+  // -fcheckedc-reuse-bounds-checks, passing them on to the diagnostic
+  // consumer that it replaces for the duration of the check.
+  class BoundsCheckDiagRecorder : public DiagnosticConsumer {
+  private:
+    DiagnosticsEngine &Diags;
+    DiagnosticConsumer *Inner;
+    std::unique_ptr<DiagnosticConsumer> InnerOwner;
+
+  public:
+    SmallVector<StoredDiagnostic, 4> Recorded;
+
+    BoundsCheckDiagRecorder(DiagnosticsEngine &Diags)
+      : Diags(Diags), Inner(Diags.getClient()), InnerOwner(Diags.takeClient()) {
+      Diags.setClient(this, /*ShouldOwnClient=*/false);
+    }
+
+    ~BoundsCheckDiagRecorder() {
+      bool OwnsInner = InnerOwner != nullptr;
+      InnerOwner.release();
+      Diags.setClient(Inner, OwnsInner);
+    }
+
+    bool IncludeInDiagnosticCounts() const override {
+      return Inner->IncludeInDiagnosticCounts();
+    }
+
+    void HandleDiagnostic(DiagnosticsEngine::Level Level,
+                          const Diagnostic &Info) override {
+      Recorded.push_back(StoredDiagnostic(Level, Info));
+      Inner->HandleDiagnostic(Level, Info);
+    }
+  };
+
+  // The text of a function definition whose bounds checks may be reused.
+  struct ReusableFunction {
+    FileID FID;
+    SourceLocation Begin;
+    unsigned BeginOffset;
+    unsigned EndOffset;
+    std::string Key;
+  };
+}
+
+// Compute the key under which the diagnostics of checking the body of FD are
+// cached.  Returns false if the diagnostics cannot be reused: the text of the
+// function must come from one file and must not use macros, since the
+// expansions of the macros are not part of the key.
+static bool GetReusableFunction(Sema &S, FunctionDecl *FD, Stmt *Body,
+                                ReusableFunction &RF) {
+  SourceManager &SM = S.getSourceManager();
+  SourceRange Range = FD->getSourceRange();
+  if (Range.getBegin().isInvalid() || Range.getBegin().isMacroID() ||
+      Range.getEnd().isMacroID())
+    return false;
+  RF.FID = SM.getFileID(Range.getBegin());
+  SourceLocation End =
+    Lexer::getLocForEndOfToken(Range.getEnd(), 0, SM, S.getLangOpts());
+  if (End.isInvalid() || SM.getFileID(End) != RF.FID)
+    return false;
+  RF.Begin = Range.getBegin();
+  RF.BeginOffset = SM.getFileOffset(RF.Begin);
+  RF.EndOffset = SM.getFileOffset(End);
+  bool Invalid = false;
+  StringRef Buffer = SM.getBufferData(RF.FID, &Invalid);
+  if (Invalid || RF.EndOffset < RF.BeginOffset || RF.EndOffset > Buffer.size())
+    return false;
+  StringRef Text = Buffer.slice(RF.BeginOffset, RF.EndOffset);
+
+  Lexer RawLexer(SM.getLocForStartOfFile(RF.FID), S.getLangOpts(),
+                 Buffer.begin(), Text.begin(), Buffer.end());
+  Token Tok;
+  bool AtEOF = false;
+  while (!AtEOF) {
+    AtEOF = RawLexer.LexFromRawLexer(Tok);
+    if (SM.getFileOffset(Tok.getLocation()) >= RF.EndOffset)
+      break;
+    if (Tok.is(tok::raw_identifier) &&
+        S.PP.getIdentifierInfo(Tok.getRawIdentifier())->hasMacroDefinition())
+      return false;
+  }
+
+  std::string Description;
+  llvm::raw_string_ostream OS(Description);
+  OS << Text << '\n';
+  // The options that change the checking of the body or the diagnostics that
+  // it issues.  The severity of each cached diagnostic is checked again when
+  // it is reused, but a warning that was disabled when the body was checked
+  // was not recorded at all.
+  const LangOptions &LO = S.getLangOpts();
+  OS << LO.CheckedCBoundsProofBudget << ' ' << LO.UncheckedPointersDynamicCheck
+     << ' ' << LO.CheckedCDeferBoundsChecking << ' '
+     << LO.CheckedCCallGraphOrder << ' ' << LO.InjectVerifierCalls << ' '
+     << LO._3C << ' ' << S.Context.getTargetInfo().getPointerWidth(0) << '\n';
+  const DiagnosticsEngine &DE = S.getDiagnostics();
+  OS << DE.getIgnoreAllWarnings() << ' ' << DE.getEnableAllWarnings() << ' '
+     << DE.getWarningsAsErrors() << ' ' << DE.getErrorsAsFatal() << ' '
+     << DE.getSuppressSystemWarnings() << '\n';
+  for (const std::string &W : DE.getDiagnosticOptions().Warnings)
+    OS << "-W" << W << '\n';
+  for (const std::string &R : DE.getDiagnosticOptions().Remarks)
+    OS << "-R" << R << '\n';
+  // A checked scope pragma sets the checked scope of the body without
+  // changing its text.
+  if (CompoundStmt *CS = dyn_cast<CompoundStmt>(Body))
+    OS << CS->getCheckedSpecifier() << '\n';
+  BoundsCheckDependencyFinder Finder(S, FD);
+  if (TypeSourceInfo *TSI = FD->getTypeSourceInfo())
+    Finder.TraverseTypeLoc(TSI->getTypeLoc());
+  Finder.TraverseStmt(Body);
+  if (!Finder.Describe(OS))
+    return false;
+  OS.flush();
+  auto Hash = llvm::SHA1::hash(llvm::arrayRefFromStringRef(Description));
+  RF.Key.assign(Hash.begin(), Hash.end());
+  return true;
+}
+
+// Convert the location L of a diagnostic to an offset from the start of RF.
+// Returns false if L is not in the text of RF.
+static bool GetReusedOffset(const SourceManager &SM,
+                            const ReusableFunction &RF, SourceLocation L,
+                            unsigned &Offset) {
+  if (L.isInvalid() || L.isMacroID() || SM.getFileID(L) != RF.FID)
+    return false;
+  unsigned FileOffset = SM.getFileOffset(L);
+  if (FileOffset < RF.BeginOffset || FileOffset > RF.EndOffset)
+    return false;
+  Offset = FileOffset - RF.BeginOffset;
+  return true;
+}
+
+// Cache the diagnostics that Recorder recorded while checking RF.  They are
+// only cached if they can be issued again exactly: functions with errors are
+// checked again, so that the error state of the compilation is the same,
+// and so are functions with fix-its or with diagnostics outside of the
+// function.
+static void CacheReusedDiagnostics(Sema &S, const ReusableFunction &RF,
+                                   const BoundsCheckDiagRecorder &Recorder) {
+  const SourceManager &SM = S.getSourceManager();
+  std::vector<ReusedBoundsDiagnostic> Diags;
+  for (const StoredDiagnostic &SD : Recorder.Recorded) {
+    if (SD.getLevel() >= DiagnosticsEngine::Error || !SD.getFixIts().empty())
+      return;
+    ReusedBoundsDiagnostic RD;
+    RD.Level = SD.getLevel();
+    RD.ID = SD.getID();
+    RD.Message = SD.getMessage().str();
+    if (!GetReusedOffset(SM, RF, SD.getLocation(), RD.Offset))
+      return;
+    for (const CharSourceRange &R : SD.getRanges()) {
+      ReusedBoundsDiagnostic::Range Offsets;
+      Offsets.IsTokenRange = R.isTokenRange();
+      if (!GetReusedOffset(SM, RF, R.getBegin(), Offsets.Begin) ||
+          !GetReusedOffset(SM, RF, R.getEnd(), Offsets.End))
+        return;
+      RD.Ranges.push_back(Offsets);
+    }
+    Diags.push_back(std::move(RD));
+  }
+  S.BoundsCheckReuse->Insert(RF.Key, std::move(Diags));
+}
+
+// Issue the cached diagnostics of RF again.  Returns false, without issuing
+// any diagnostic, if there are none or if the severity of one of them has
+// changed, for example because of a diagnostic pragma.
+static bool ReuseCachedDiagnostics(Sema &S, const ReusableFunction &RF) {
+  std::vector<ReusedBoundsDiagnostic> Diags;
+  if (!S.BoundsCheckReuse->Lookup(RF.Key, Diags))
+    return false;
+  DiagnosticsEngine &DE = S.getDiagnostics();
+  for (const ReusedBoundsDiagnostic &RD : Diags)
+    if (RD.Level != DiagnosticsEngine::Note &&
+        DE.getDiagnosticLevel(RD.ID, RF.Begin.getLocWithOffset(RD.Offset)) !=
+          RD.Level)
+      return false;
+  for (const ReusedBoundsDiagnostic &RD : Diags) {
+    SmallVector<CharSourceRange, 2> Ranges;
+    for (const ReusedBoundsDiagnostic::Range &R : RD.Ranges)
+      Ranges.push_back(CharSourceRange(
+          SourceRange(RF.Begin.getLocWithOffset(R.Begin),
+                      RF.Begin.getLocWithOffset(R.End)),
+          R.IsTokenRange));
+    FullSourceLoc Loc(RF.Begin.getLocWithOffset(RD.Offset),
+                      S.getSourceManager());
+    DE.Report(StoredDiagnostic(RD.Level, RD.ID, RD.Message, Loc, Ranges,
+                               None));
+  }
+  return true;
+}
+
 void Sema::CheckFunctionBodyBoundsDecls(FunctionDecl *FD, Stmt *Body) {
   if (Body == nullptr)
     return;
+  // Most of the functions of legacy code compiled with the Checked C
+  // extension use no Checked C features at all.  Skip building a CFG and
+  // running the analyses for them, unless their analysis results are being
+  // dumped.  With -funchecked-pointers-dynamic-check, the accesses through
+  // unchecked pointers and arrays get bounds checks too, so no body is
+  // skipped.
+  const LangOptions &LO = getLangOpts();
+  if (!LO.UncheckedPointersDynamicCheck &&
+      !LO.DumpInferredBounds && !LO.DumpExtractedComparisonFacts &&
+      !LO.DumpWidenedBounds && !LO.DumpWidenedBoundsDataflowSets &&
+      !LO.DumpBoundsVars && !LO.DumpBoundsSiblingFields &&
+      !LO.DumpPreorderAST && !LO.DumpCheckingState &&
+      !LO.DumpSynthesizedMembers &&
+      !CheckedCUsesFinder(*this).Find(FD, Body)) {
+    ++NumFunctionsSkippedBoundsChecking;
+    return;
+  }
+
+  // With -fcheckedc-reuse-bounds-checks, a function whose text, dependencies
+  // and options are the same as those of a function checked earlier with the
+  // same cache is not checked again; its diagnostics are issued again
+  // instead.  The CompilerInstance only provides a cache when nothing after
+  // Sema needs what the checker records in the AST, that is, with
+  // -fsyntax-only.  A precompiled header or preamble is written out with the
+  // AST, so its functions are always checked.
+  ReusableFunction RF;
+  bool Reusable = LO.CheckedCReuseBoundsChecks && BoundsCheckReuse &&
+      TUKind == TU_Complete && !LO.DumpInferredBounds &&
+      !LO.DumpExtractedComparisonFacts && !LO.DumpWidenedBounds &&
+      !LO.DumpWidenedBoundsDataflowSets && !LO.DumpBoundsVars &&
+      !LO.DumpBoundsSiblingFields && !LO.DumpPreorderAST &&
+      !LO.DumpCheckingState && !LO.DumpSynthesizedMembers &&
+      !LO.DumpCheckedCAnalysisStats && GetReusableFunction(*this, FD, Body, RF);
+  if (Reusable && ReuseCachedDiagnostics(*this, RF)) {
+    ++NumFunctionsReusedBoundsChecks;
+    return;
+  }
+  Optional<BoundsCheckDiagRecorder> Recorder;
+  if (Reusable)
+    Recorder.emplace(Diags);
 #if TRACE_CFG
   llvm::outs() << "Checking " << FD->getName() << "\n";
 #endif
+  llvm::TimeTraceScope TimeScope("CheckFunctionBodyBoundsDecls",
+                                 [&]() { return FD->getNameAsString(); });
+  ++NumFunctionsBoundsChecked;
+  // Cache the results of structural expression comparisons while checking
+  // this function body.  The expressions compared during checking are not
+  // modified until checking is complete.
+  Context.enableLexicographicCache(true);
+  // Share the expressions that are synthesized while checking this function
+  // body.
+  Context.enableSynthesizedExprTables(true);
+
   ModifiedBoundsDependencies Tracker;
   // Compute a mapping from expressions that modify lvalues to in-scope bounds
   // declarations that depend upon those expressions.  We plan to change
   // CheckBoundsDeclaration to traverse a function body in an order determined
   // by control flow.   The modification information depends on lexically-scoped
   // information that can't be computed easily when doing a control-flow
-  // based traversal.
-  ComputeBoundsDependencies(Tracker, FD, Body);
+  // based traversal.  The same traversal collects the statements that are in
+  // checked scopes, which the CFG-based traversal uses.
+  CheckedScopeStmts CheckedStmts;
+  ComputeBoundsDependencies(Tracker, FD, Body, &CheckedStmts);
 
   // Run a prepass traversal over the function before running bounds checking.
   // This traversal gathers information that is used during bounds checking,
   // as well as in other Checked C analyses.
+  // Record the time spent in each stage for -fdump-checkedc-analysis-stats.
+  auto Now = [&LO]() {
+    return LO.DumpCheckedCAnalysisStats ?
+      llvm::TimeRecord::getCurrentTime(false).getWallTime() : 0;
+  };
+  double StageStart = Now();
+
   PrepassInfo Info;
   CheckedCAnalysesPrepass(Info, FD, Body);
+  double PrepassTime = Now() - StageStart;
 
   std::pair<ComparisonSet, ComparisonSet> EmptyFacts;
+  // This CFG is not shared with the one that AnalysisBasedWarnings builds
+  // for the same body.  Lifetime markers and null statements would change
+  // the results of the warnings (for example, null statements would be
+  // reported as unreachable code), and the always-added statement classes
+  // that the warnings use would split the elements this checker traverses.
   CFG::BuildOptions BO;
   BO.AddLifetime = true;
   BO.AddNullStmt = true;
+  StageStart = Now();
   std::unique_ptr<CFG> Cfg = CFG::buildCFG(nullptr, Body, &getASTContext(), BO);
+  double CFGTime = Now() - StageStart;
   CheckBoundsDeclarations Checker(*this, Info, Body, Cfg.get(), FD, EmptyFacts);
   if (Cfg != nullptr) {
+    NumBoundsCheckedCFGBlocks += Cfg->getNumBlockIDs();
+    MaxBoundsCheckedCFGBlocks.updateMax(Cfg->getNumBlockIDs());
+    // The dataflow analyses run here, before the checker consumes their
+    // results, rather than on other threads.  The bounds widening analysis
+    // allocates expressions in the ASTContext and updates the normalized
+    // bounds of declarations.  Function bodies are checked one at a time,
+    // either as they are parsed or, with -fcheckedc-deferred-bounds-checking,
+    // at the end of the translation unit in their completion order (or in
+    // call graph order with -fcheckedc-call-graph-order).
+    StageStart = Now();
+    // The reverse post order of the blocks is computed once and shared by
+    // the dataflow analyses and the checker.
+    CheckedCFGContext CFGCtx(Cfg.get());
     AvailableFactsAnalysis Collector(*this, Cfg.get());
-    Collector.Analyze();
+    Collector.Analyze(CFGCtx);
+    double FactsTime = Now() - StageStart;
     if (getLangOpts().DumpExtractedComparisonFacts)
       Collector.DumpComparisonFacts(llvm::outs(), FD->getNameInfo().getName().getAsString());
-    Checker.TraverseCFG(Collector, FD);
+    StageStart = Now();
+    Checker.TraverseCFG(Collector, CFGCtx, FD, CheckedStmts);
+    double CheckingTime = Now() - StageStart;
+    if (LO.DumpCheckedCAnalysisStats)
+      Checker.DumpAnalysisStats(llvm::outs(), Collector, PrepassTime, CFGTime,
+                                FactsTime, CheckingTime);
   }
   else {
     // A CFG couldn't be constructed.  CFG construction doesn't support
     // __finally or may encounter a malformed AST.  Fall back on to non-flow 
     // based analysis.  The CSS parameter is ignored because the checked
     // scope information is obtained from Body, which is a compound statement.
+    ++NumFunctionsWithoutCFG;
     Checker.Check(Body, CheckedScopeSpecifier::CSS_Unchecked);
   }
 
+  Context.enableLexicographicCache(false);
+  Context.enableSynthesizedExprTables(false);
+
+  if (Recorder)
+    CacheReusedDiagnostics(*this, RF, *Recorder);
+
 #if TRACE_CFG
   llvm::outs() << "Done " << FD->getName() << "\n";
 #endif
 }
 
+// Check the bounds declaration of D, a variable declaration that is not within
+// a function body, using Checker.  Checker does not depend on D, so it can be
+// shared by a batch of top-level declarations.
+static void CheckTopLevelVarDecl(Sema &S, CheckBoundsDeclarations &Checker,
+                                 VarDecl *D, CheckedScopeSpecifier CSS) {
+  Checker.TraverseTopLevelVarDecl(D, CSS);
+
+  // When building a PCH or a module, normalize the bounds of D now so
+  // that they are written to the AST file along with D.  Declarations in
+  // headers (e.g. extern variables with count bounds in the checked
+  // headers) are usually not definitions, so checking them above does
+  // not normalize their bounds, and every TU that uses the AST file
+  // would otherwise expand them again.
+  BoundsExpr *Bounds = D->getBoundsExpr();
+  if (S.TUKind != TU_Complete && Bounds && !Bounds->isInvalid())
+    S.NormalizeBounds(D);
+}
+
+bool Sema::CanDeferHeaderInlineBoundsChecking(const FunctionDecl *FD) {
+  if (FD->getStorageClass() != SC_Static || !FD->isInlineSpecified())
+    return false;
+  if (!SourceMgr.isInSystemHeader(FD->getLocation()))
+    return false;
+
+  // Code generation emits an unused static function only at the end of the
+  // translation unit, unless it must be emitted anyway.  A PCH or a module
+  // does not know whether its users use the function, so the function is
+  // checked before it is written out.
+  return TUKind == TU_Complete && !PP.isIncrementalProcessingEnabled() &&
+         !getLangOpts().EmitAllDecls && !Context.DeclMustBeEmitted(FD);
+}
+
+void Sema::CheckDeferredFunctionBodyBoundsDecls() {
+  // Each function body is checked independently: the CFG, the facts and the
+  // AbstractSets are all per-function.  The bodies are checked one at a time
+  // on this thread, in the order in which they were completed, which keeps
+  // the diagnostics in source order.  Checking a body synthesizes expressions
+  // in the ASTContext and issues diagnostics through Sema, so the bodies
+  // cannot be checked concurrently.
+  // The static inline functions of the system headers that have not been used
+  // are never emitted, so their bounds declarations are not checked.  The
+  // headers come first, so their bodies are checked before the other bodies.
+  auto HeaderInlines = std::move(DeferredHeaderInlineFunctions);
+  DeferredHeaderInlineFunctions.clear();
+  for (const auto &FuncBody : HeaderInlines) {
+    if (!FuncBody.first->isUsed(/*CheckUsedAttr=*/false) &&
+        !FuncBody.first->isReferenced())
+      continue;
+    ContextRAII SavedContext(*this, FuncBody.first);
+    CheckFunctionBodyBoundsDecls(FuncBody.first, FuncBody.second);
+  }
+
+  if (getLangOpts().CheckedCCallGraphOrder)
+    OrderDeferredFunctionBodiesByCallGraph();
+  auto Pending = std::move(DeferredBoundsCheckedFunctions);
+  DeferredBoundsCheckedFunctions.clear();
+  auto Globals = std::move(DeferredTopLevelBoundsDecls);
+  DeferredTopLevelBoundsDecls.clear();
+
+  // The top-level declarations carry no facts and no CFG, so a single checker
+  // is shared by all of them.  Unless the bodies are reordered, each
+  // declaration is checked just before the first body that follows it.
+  PrepassInfo Info;
+  std::pair<ComparisonSet, ComparisonSet> EmptyFacts;
+  CheckBoundsDeclarations Checker(*this, Info, EmptyFacts);
+  unsigned NextGlobal = 0;
+  auto CheckGlobalsBefore = [&](unsigned NumFunctions) {
+    for (; NextGlobal < Globals.size() &&
+           Globals[NextGlobal].NumFunctionsBefore <= NumFunctions;
+         ++NextGlobal)
+      CheckTopLevelVarDecl(*this, Checker, Globals[NextGlobal].VD,
+                           Globals[NextGlobal].CSS);
+  };
+
+  for (unsigned I = 0; I != Pending.size(); ++I) {
+    if (!getLangOpts().CheckedCCallGraphOrder)
+      CheckGlobalsBefore(I);
+    // Expressions synthesized during checking refer to locals of the function,
+    // so check the body with the function as the current context.
+    ContextRAII SavedContext(*this, Pending[I].first);
+    CheckFunctionBodyBoundsDecls(Pending[I].first, Pending[I].second);
+  }
+  CheckGlobalsBefore(std::numeric_limits<unsigned>::max());
+}
+
+void Sema::OrderDeferredFunctionBodiesByCallGraph() {
+  // Number the bodies by their completion order, which is used to order the
+  // functions within a strongly connected component and the functions that
+  // are not in the call graph.
+  unsigned NumDeferred = DeferredBoundsCheckedFunctions.size();
+  llvm::DenseMap<const Decl *, unsigned> CompletionIndex;
+  for (unsigned I = 0; I != NumDeferred; ++I) {
+    FunctionDecl *FD = DeferredBoundsCheckedFunctions[I].first;
+    CompletionIndex[FD->getCanonicalDecl()] = I;
+  }
+
+  CallGraph CG;
+  CG.addToCallGraph(Context.getTranslationUnitDecl());
+
+  // The root of the call graph calls every function in it, so the SCCs
+  // reachable from the root are all of the SCCs.  scc_iterator visits the
+  // SCCs in post order, so callees are visited before their callers.
+  SmallVector<unsigned, 16> Order;
+  llvm::SmallBitVector Ordered(NumDeferred);
+  for (auto SCCI = llvm::scc_begin(&CG); !SCCI.isAtEnd(); ++SCCI) {
+    SmallVector<unsigned, 4> SCC;
+    for (const CallGraphNode *N : *SCCI) {
+      const Decl *D = N->getDecl();
+      auto It = D ? CompletionIndex.find(D) : CompletionIndex.end();
+      if (It != CompletionIndex.end() && !Ordered.test(It->second)) {
+        SCC.push_back(It->second);
+        Ordered.set(It->second);
+      }
+    }
+    llvm::sort(SCC);
+    Order.append(SCC.begin(), SCC.end());
+  }
+  for (unsigned I = 0; I != NumDeferred; ++I)
+    if (!Ordered.test(I))
+      Order.push_back(I);
+
+  SmallVector<std::pair<FunctionDecl *, Stmt *>, 16> Sorted;
+  for (unsigned I : Order)
+    Sorted.push_back(DeferredBoundsCheckedFunctions[I]);
+  DeferredBoundsCheckedFunctions = std::move(Sorted);
+}
+
 void Sema::CheckTopLevelBoundsDecls(VarDecl *D) {
   if (!D->isLocalVarDeclOrParm()) {
+    // Defer the declaration along with the function bodies, so that it is
+    // checked in a batch instead of by a checker of its own.
+    if (getLangOpts().CheckedCDeferBoundsChecking) {
+      DeferredTopLevelBoundsDecls.push_back(
+          {D, GetCheckedScopeInfo(),
+           static_cast<unsigned>(DeferredBoundsCheckedFunctions.size())});
+      return;
+    }
+
     PrepassInfo Info;
     std::pair<ComparisonSet, ComparisonSet> EmptyFacts;
     CheckBoundsDeclarations Checker(*this, Info, nullptr, nullptr, nullptr, EmptyFacts);
-    Checker.TraverseTopLevelVarDecl(D, GetCheckedScopeInfo());
+    CheckTopLevelVarDecl(*this, Checker, D, GetCheckedScopeInfo());
   }
 }
 
@@ -6760,10 +8167,18 @@ namespace {
 
 bool Sema::CheckIsNonModifying(Expr *E, NonModifyingContext Req,
                                NonModifyingMessage Message) {
+  auto It = NonModifyingExprs.find(E);
+  if (It != NonModifyingExprs.end() &&
+      (It->second || Message == NonModifyingMessage::NMM_None))
+    return It->second;
+
   NonModifiyingExprSema Checker(*this, Req, Message);
   Checker.TraverseStmt(E);
 
-  return Checker.isNonModifyingExpr();
+  bool Result = Checker.isNonModifyingExpr();
+  if (E)
+    NonModifyingExprs[E] = Result;
+  return Result;
 }
 
 /* Will uncomment this in a future pull request.
@@ -6871,4 +8286,7 @@ void Sema::PrintCheckedCStats() {
                << " MemberExprs created while synthesizing members.\n";
   llvm::errs() << "  " << CheckedCStats.NumSynthesizedMemberAbstractSets
                << " AbstractSets created while synthesizing members.\n";
+  llvm::errs() << "  " << CheckedCStats.NumCachedTypeArgSubstitutions << "/"
+               << CheckedCStats.NumTypeArgSubstitutions
+               << " type argument substitutions found in the cache.\n";
 }
@@ -15630,8 +15630,14 @@ Decl *Sema::ActOnFinishFunctionBody(Decl *dcl, Stmt *Body,
   // meant to pop the context added in ActOnStartOfFunctionDef().
   ExitFunctionBodyRAII ExitRAII(*this, isLambdaCallOperator(FD));
 
-  if (getLangOpts().CheckedC && !getLangOpts()._3C)
-    CheckFunctionBodyBoundsDecls(FD, Body);
+  if (getLangOpts().CheckedC && !getLangOpts()._3C) {
+    if (FD && Body && CanDeferHeaderInlineBoundsChecking(FD))
+      DeferredHeaderInlineFunctions.push_back({FD, Body});
+    else if (getLangOpts().CheckedCDeferBoundsChecking && FD && Body)
+      DeferredBoundsCheckedFunctions.push_back({FD, Body});
+    else
+      CheckFunctionBodyBoundsDecls(FD, Body);
+  }
 
   if (FD) {
     FD->setBody(Body);
@@ -311,7 +311,7 @@ static bool checkLanguageOptions(const LangOptions &LangOpts,
 
 #define BENIGN_LANGOPT(Name, Bits, Default, Description)
 #define BENIGN_ENUM_LANGOPT(Name, Type, Bits, Default, Description)
-#define BENIGN_VALUE_LANGOPT(Name, Type, Bits, Default, Description)
+#define BENIGN_VALUE_LANGOPT(Name, Bits, Default, Description)
 #include "clang/Basic/LangOptions.def"
 
   if (ExistingLangOpts.ModuleFeatures != LangOpts.ModuleFeatures) {
@@ -3818,6 +3818,36 @@ ASTReader::ReadASTBlock(ModuleFile &F, unsigned ClientLoadCapabilities) {
       for (unsigned I = 0, N = Record.size(); I != N; ++I)
         DeclsToCheckForDeferredDiags.push_back(getGlobalDeclID(F, Record[I]));
       break;
+
+    case CHECKED_C_MEMBER_BOUNDS_USES:
+      for (unsigned I = 0, N = Record.size(); I != N; /* in loop */) {
+        // The member path and then the members whose bounds use it.
+        for (unsigned J = 0; J != 2; ++J) {
+          unsigned Count = Record[I++];
+          CheckedCMemberBoundsUses.push_back(Count);
+          for (unsigned K = 0; K != Count; ++K)
+            CheckedCMemberBoundsUses.push_back(
+                getGlobalDeclID(F, Record[I++]));
+        }
+      }
+      break;
+
+    case CHECKED_C_GLOBAL_BOUNDS_DECLS:
+      for (unsigned I = 0, N = Record.size(); I != N; ++I)
+        CheckedCGlobalBoundsDecls.push_back(getGlobalDeclID(F, Record[I]));
+      break;
+
+    case CHECKED_C_SIBLING_FIELD_BOUNDS_USES:
+      for (unsigned I = 0, N = Record.size(); I != N; /* in loop */) {
+        CheckedCSiblingFieldBoundsUses.push_back(
+            getGlobalDeclID(F, Record[I++]));
+        unsigned Count = Record[I++];
+        CheckedCSiblingFieldBoundsUses.push_back(Count);
+        for (unsigned K = 0; K != 2 * Count; ++K)
+          CheckedCSiblingFieldBoundsUses.push_back(
+              getGlobalDeclID(F, Record[I++]));
+      }
+      break;
     }
   }
 }
@@ -7916,6 +7946,43 @@ void ASTReader::UpdateSema() {
   }
   SemaObj->ForceCUDAHostDeviceDepth = ForceCUDAHostDeviceDepth;
 
+  // Add the uses of member paths by Checked C member bounds declarations,
+  // which Sema computes when it checks a struct definition.
+  for (unsigned I = 0, N = CheckedCMemberBoundsUses.size(); I != N;
+       /* in loop */) {
+    ASTContext::MemberPath Path;
+    for (unsigned Count = CheckedCMemberBoundsUses[I++]; Count; --Count)
+      Path.push_back(cast<FieldDecl>(GetDecl(CheckedCMemberBoundsUses[I++])));
+    for (unsigned Count = CheckedCMemberBoundsUses[I++]; Count; --Count)
+      getContext().addMemberBoundsUse(
+          Path, cast<FieldDecl>(GetDecl(CheckedCMemberBoundsUses[I++])));
+  }
+  CheckedCMemberBoundsUses.clear();
+
+  // Track the variables that the bounds of file-scope variables depend on,
+  // which Sema does when it acts on the bounds declarations.
+  for (uint64_t ID : CheckedCGlobalBoundsDecls)
+    SemaObj->BoundsDependencies.Add(cast<VarDecl>(GetDecl(ID)));
+  CheckedCGlobalBoundsDecls.clear();
+
+  // Add the uses of fields in the bounds of their sibling fields, which the
+  // Checked C analyses prepass computes for the records that it sees.
+  for (unsigned I = 0, N = CheckedCSiblingFieldBoundsUses.size(); I != N;
+       /* in loop */) {
+    auto *RD = cast<RecordDecl>(GetDecl(CheckedCSiblingFieldBoundsUses[I++]));
+    ASTContext::SiblingFieldBoundsUsesTy Uses;
+    for (unsigned Count = CheckedCSiblingFieldBoundsUses[I++]; Count;
+         --Count) {
+      auto *Used =
+          cast<FieldDecl>(GetDecl(CheckedCSiblingFieldBoundsUses[I++]));
+      auto *WithBounds =
+          cast<FieldDecl>(GetDecl(CheckedCSiblingFieldBoundsUses[I++]));
+      Uses.push_back({Used, WithBounds});
+    }
+    getContext().addSiblingFieldBoundsUses(RD, std::move(Uses));
+  }
+  CheckedCSiblingFieldBoundsUses.clear();
+
   if (PragmaAlignPackCurrentValue) {
     // The bottom of the stack might have a default value. It must be adjusted
     // to the current value to ensure that the packing state is preserved after
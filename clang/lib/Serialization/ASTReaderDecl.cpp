@@ -832,6 +832,7 @@ void ASTDeclReader::VisitDeclaratorDecl(DeclaratorDecl *DD) {
   if (Record.readInt()) { // hasBoundsAnotations.
     BoundsAnnotations BA = Record.readBoundsAnnotations();
     DD->setBoundsAnnotations(Reader.getContext(), BA);
+    DD->setNormalizedBounds(cast_or_null<BoundsExpr>(Record.readExpr()));
   }
 
   if (Record.readInt()) { // hasExtInfo
@@ -797,6 +797,9 @@ void ASTWriter::WriteBlockInfoBlock() {
   RECORD(CUDA_PRAGMA_FORCE_HOST_DEVICE_DEPTH);
   RECORD(PP_CONDITIONAL_STACK);
   RECORD(DECLS_TO_CHECK_FOR_DEFERRED_DIAGS);
+  RECORD(CHECKED_C_MEMBER_BOUNDS_USES);
+  RECORD(CHECKED_C_GLOBAL_BOUNDS_DECLS);
+  RECORD(CHECKED_C_SIBLING_FIELD_BOUNDS_USES);
 
   // SourceManager Block.
   BLOCK(SOURCE_MANAGER_BLOCK);
@@ -4763,6 +4766,49 @@ ASTFileSignature ASTWriter::WriteASTCore(Sema &SemaRef, StringRef isysroot,
   for (auto *D : SemaRef.DeclsToCheckForDeferredDiags)
     AddDeclRef(D, DeclsToCheckForDeferredDiags);
 
+  // Build a record containing the member paths used by Checked C member
+  // bounds declarations, so that TUs that use the structs do not depend on
+  // Sema having checked their definitions.
+  RecordData CheckedCMemberBoundsUses;
+  for (const auto &Uses : Context.getMemberBoundsUses()) {
+    CheckedCMemberBoundsUses.push_back(Uses.first.size());
+    for (const FieldDecl *FD : Uses.first)
+      AddDeclRef(FD, CheckedCMemberBoundsUses);
+    CheckedCMemberBoundsUses.push_back(Uses.second.size());
+    for (const FieldDecl *FD : Uses.second)
+      AddDeclRef(FD, CheckedCMemberBoundsUses);
+  }
+
+  // Build a record containing the file-scope variables with bounds
+  // declarations, so that TUs that use them know which variables their
+  // bounds depend on.  The variables from other AST files are written by
+  // those files.
+  RecordData CheckedCGlobalBoundsDecls;
+  for (VarDecl *VD : SemaRef.BoundsDependencies.BoundsDeclsInScope())
+    if (!VD->isLocalVarDeclOrParm() && !VD->isFromASTFile())
+      AddDeclRef(VD, CheckedCGlobalBoundsDecls);
+
+  // Build a record containing the uses of fields in the bounds of their
+  // sibling fields, so that TUs that use the records do not compute them
+  // again.  The uses are computed here for the records whose member bounds
+  // use other members, even if no function of this AST file uses them.  The
+  // records from other AST files are written by those files.
+  for (const auto &Uses : Context.getMemberBoundsUses())
+    for (const FieldDecl *FD : Uses.second)
+      if (!FD->getParent()->isFromASTFile())
+        Context.getSiblingFieldBoundsUses(FD->getParent());
+  RecordData CheckedCSiblingFieldBoundsUses;
+  for (const auto &Uses : Context.getAllSiblingFieldBoundsUses()) {
+    if (Uses.first->isFromASTFile())
+      continue;
+    AddDeclRef(Uses.first, CheckedCSiblingFieldBoundsUses);
+    CheckedCSiblingFieldBoundsUses.push_back(Uses.second.size());
+    for (const auto &Use : Uses.second) {
+      AddDeclRef(Use.first, CheckedCSiblingFieldBoundsUses);
+      AddDeclRef(Use.second, CheckedCSiblingFieldBoundsUses);
+    }
+  }
+
   RecordData DeclUpdatesOffsetsRecord;
 
   // Keep writing types, declarations, and declaration update records
@@ -4860,6 +4906,19 @@ ASTFileSignature ASTWriter::WriteASTCore(Sema &SemaRef, StringRef isysroot,
     Stream.EmitRecord(DECLS_TO_CHECK_FOR_DEFERRED_DIAGS,
         DeclsToCheckForDeferredDiags);
 
+  // Write the record containing Checked C member bounds uses.
+  if (!CheckedCMemberBoundsUses.empty())
+    Stream.EmitRecord(CHECKED_C_MEMBER_BOUNDS_USES, CheckedCMemberBoundsUses);
+
+  // Write the record containing Checked C file-scope bounds declarations.
+  if (!CheckedCGlobalBoundsDecls.empty())
+    Stream.EmitRecord(CHECKED_C_GLOBAL_BOUNDS_DECLS, CheckedCGlobalBoundsDecls);
+
+  // Write the record containing Checked C sibling field bounds uses.
+  if (!CheckedCSiblingFieldBoundsUses.empty())
+    Stream.EmitRecord(CHECKED_C_SIBLING_FIELD_BOUNDS_USES,
+                      CheckedCSiblingFieldBoundsUses);
+
   // Write the record containing CUDA-specific declaration references.
   if (!CUDASpecialDeclRefs.empty())
     Stream.EmitRecord(CUDA_SPECIAL_DECL_REFS, CUDASpecialDeclRefs);
@@ -528,8 +528,12 @@ void ASTDeclWriter::VisitDeclaratorDecl(DeclaratorDecl *D) {
 
   bool hasBoundsAnnotations = D->hasBoundsAnnotations();
   Record.push_back(hasBoundsAnnotations);
-  if (hasBoundsAnnotations)
+  if (hasBoundsAnnotations) {
     Record.AddBoundsAnnotations(D->getBoundsAnnotations());
+    // Write the normalized bounds computed by Sema, so that TUs that use
+    // this declaration do not have to expand its bounds again.
+    Record.AddStmt(D->getNormalizedBounds());
+  }
 
   Record.push_back(D->hasExtInfo());
   if (D->hasExtInfo()) {
@@ -0,0 +1,32 @@
+// Tests the statistics of the constraint graphs printed by
+// -dump-constraint-graph-stats, and that they are not printed by default.
+//
+// RUN: rm -rf %t*
+// RUN: 3c -base-dir=%S -dump-constraint-graph-stats -output-dir=%t.checked \
+// RUN:   %s -- 2>&1 | FileCheck %s
+// RUN: 3c -base-dir=%S -output-dir=%t.default %s -- 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=DEFAULT --allow-empty
+
+// hub has an edge to or from each of the other pointers.
+void f(int *a, int *b, int *c, char *d) {
+  int *hub = a;
+  hub = b;
+  hub = c;
+  hub = (int *)d;
+}
+
+// CHECK: Constraint graphs:
+// CHECK-NEXT:   Checked graph: {{[1-9][0-9]*}} nodes, {{[1-9][0-9]*}} edges ({{[0-9]+}} soft)
+// CHECK-NEXT:     In-degrees:{{( [0-9]+(-[0-9]+)?: [1-9][0-9]*)+}}
+// CHECK-NEXT:     Out-degrees:{{( [0-9]+(-[0-9]+)?: [1-9][0-9]*)+}}
+// CHECK-NEXT:     Strongly connected components: {{[1-9][0-9]*}}, largest:{{( [0-9]+)+}}
+// CHECK-NEXT:     Weakly connected components: {{[1-9][0-9]*}}, largest:{{( [0-9]+)+}}
+// CHECK-NEXT:     Most incoming edges:
+// CHECK:      {{[0-9]+}} {{.*}}hub{{.*}} ({{.*}}constraint_graph_stats.c:12:{{[0-9]+}}:{{[0-9]+}})
+// CHECK:     Most outgoing edges:
+// CHECK:   Pointer type graph: {{[0-9]+}} nodes, {{[0-9]+}} edges ({{[0-9]+}} soft)
+// CHECK:   Reasons with the most constraints:
+// CHECK-NEXT:     {{[1-9][0-9]*}} {{.+}}
+// CHECK:     {{[1-9][0-9]*}} Cast from char * to int *
+
+// DEFAULT-NOT: Constraint graphs:
@@ -0,0 +1,28 @@
+// Tests that with -first-compile-command-only, a file that the compilation
+// database lists twice is only parsed with its first compile command, so the
+// pointer made WILD by the code of the second one stays checked.
+//
+// RUN: rm -rf %t*
+// RUN: mkdir -p %t
+// RUN: cp %s %t/first_compile_command.c
+// RUN: echo '[{"directory": "%/t", "command": "clang -c -DFIRST first_compile_command.c", "file": "first_compile_command.c"}, {"directory": "%/t", "command": "clang -c first_compile_command.c", "file": "first_compile_command.c"}]' > %t/compile_commands.json
+// RUN: 3c -p %t -base-dir=%t -first-compile-command-only -output-dir=%t/first \
+// RUN:   %t/first_compile_command.c
+// RUN: FileCheck -match-full-lines --check-prefix=FIRST \
+// RUN:   --input-file %t/first/first_compile_command.c %s
+// RUN: 3c -p %t -base-dir=%t -output-dir=%t/all %t/first_compile_command.c
+// RUN: FileCheck -match-full-lines --check-prefix=ALL \
+// RUN:   --input-file %t/all/first_compile_command.c %s
+
+int *p;
+// FIRST: _Ptr<int> p = ((void *)0);
+// ALL: int *p;
+
+// q is checked in both runs, so both of them write the file.
+int *q;
+// FIRST: _Ptr<int> q = ((void *)0);
+// ALL: _Ptr<int> q = ((void *)0);
+
+#ifndef FIRST
+void g(void) { p = (int *)1; }
+#endif
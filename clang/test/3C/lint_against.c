@@ -0,0 +1,32 @@
+// Tests that -lint-against reports the pointers that are WILD now but were
+// not WILD in the solution file of an earlier run, with their first root
+// cause, exits with a non-zero status only if there are any, and does not
+// rewrite any file.
+//
+// RUN: rm -rf %t*
+// RUN: 3c -base-dir=%S -solution-output=%t.sf -output-dir=%t.checked %s \
+// RUN:   -- -DOLD
+// RUN: 3c -base-dir=%S -lint-against=%t.sf %s -- -DOLD \
+// RUN:   | FileCheck %s --check-prefix=SAME --allow-empty
+// RUN: not 3c -base-dir=%S -lint-against=%t.sf -output-dir=%t.lint %s -- \
+// RUN:   | FileCheck %s
+// RUN: test ! -e %t.lint/lint_against.c
+// RUN: not 3c -base-dir=%S -lint-against=%t.missing %s -- 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=MISSING
+
+void f(char *b, int *q) {
+#ifdef OLD
+  int *p = q;
+#else
+  int *p = (int *)b;
+#endif
+  int *r = q;
+}
+
+// SAME-NOT: new WILD pointer
+
+// CHECK-NOT: lint_against.c:23:
+// CHECK: {{.*}}lint_against.c:21:3: new WILD pointer: Cast from char * to int * ({{.*}}lint_against.c:21)
+// CHECK-NOT: lint_against.c:23:
+
+// MISSING: 3c: Error: Failed to open the solution file "{{.*}}.missing": {{.+}}
@@ -0,0 +1,31 @@
+// Test that -output-patch writes the changes as a unified diff that applies to
+// the original file and gives the same result as stdout mode.
+
+// RUN: rm -rf %t*
+// RUN: mkdir %t.base && cp %s %t.base/output_patch.c
+// RUN: cd %t.base && 3c -base-dir=%t.base -output-patch=%t.patch output_patch.c --
+// RUN: FileCheck -match-full-lines -input-file %t.patch %s
+// RUN: 3c -base-dir=%t.base %t.base/output_patch.c -- > %t.stdout
+// RUN: cd %t.base && patch -p1 -i %t.patch
+// RUN: diff %t.stdout %t.base/output_patch.c
+
+// -output-patch is a separate output mode.
+// RUN: not 3c -base-dir=%S -output-patch=%t.patch -output-dir=%t.out %s -- 2>%t.stderr
+// RUN: grep -q 'Cannot use -output-patch with -output-postfix or -output-dir' %t.stderr
+
+// CHECK: --- a/output_patch.c
+// CHECK-NEXT: +++ b/output_patch.c
+
+int *f(int *p) {
+  // CHECK: -int *f(int *p) {
+  // CHECK-NEXT: +_Ptr<int> f(_Ptr<int> p) {
+  return p;
+}
+
+void g(void) {
+  int x = 0;
+  int *q = &x;
+  // CHECK: -  int *q = &x;
+  // CHECK-NEXT: +  _Ptr<int> q = &x;
+  f(q);
+}
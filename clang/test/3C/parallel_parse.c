@@ -0,0 +1,18 @@
+// Test that parsing the source files in parallel with -j gives the same
+// conversion as parsing them one at a time, also when the source files are
+// given relative to the working directory.
+//
+// RUN: rm -rf %t*
+// RUN: 3c -base-dir=%S -addcr -alltypes -output-dir=%t.serial %S/multidef1a.c %S/multidef1b.c --
+// RUN: 3c -base-dir=%S -addcr -alltypes -j 2 -output-dir=%t.j2 %S/multidef1a.c %S/multidef1b.c --
+// RUN: diff -r %t.serial %t.j2
+// RUN: 3c -base-dir=%S -addcr -alltypes -j 0 -output-dir=%t.j0 %S/multidef1a.c %S/multidef1b.c --
+// RUN: diff -r %t.serial %t.j0
+// RUN: FileCheck -match-full-lines -check-prefixes="CHECK_ALL","CHECK" --input-file %t.j2/multidef1a.c %S/multidef1a.c
+// RUN: FileCheck -match-full-lines -check-prefixes="CHECK_ALL","CHECK" --input-file %t.j2/multidef1b.c %S/multidef1b.c
+// RUN: %clang -working-directory=%t.j2 -c multidef1a.c multidef1b.c
+// RUN: cd %S && 3c -base-dir=. -addcr -alltypes -j 2 -output-dir=%t.relative multidef1a.c multidef1b.c --
+// RUN: diff -r %t.serial %t.relative
+
+// This file only holds the RUN lines; the sources and the expected output are
+// in multidef1a.c and multidef1b.c.
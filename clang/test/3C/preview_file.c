@@ -0,0 +1,37 @@
+// Tests that -preview-file prints the new version of only the requested
+// files, without writing any files, and that a file that is not part of any
+// translation unit is an error.
+//
+// RUN: rm -rf %t.checked
+// RUN: 3c -base-dir=%S -output-dir=%t.checked -preview-file=%s %s -- \
+// RUN:   | FileCheck -match-full-lines -check-prefixes=CHECK,MAIN %s
+// RUN: test ! -e %t.checked/preview_file.c
+// RUN: 3c -base-dir=%S -preview-file=%S/preview_file.h %s -- \
+// RUN:   | FileCheck -match-full-lines -check-prefix=HEADER %s
+// RUN: 3c -base-dir=%S -preview-file=%s -preview-file=%S/preview_file.h %s -- \
+// RUN:   | FileCheck -match-full-lines -check-prefixes=CHECK,BOTH %s
+// RUN: not 3c -base-dir=%S -preview-file=%S/preview_file_missing.c %s -- 2>&1 \
+// RUN:   | FileCheck -check-prefix=MISSING %s
+
+// MAIN-NOT: === New version of {{.*}}
+// BOTH: === New version of {{.*}}preview_file.c ===
+#include "preview_file.h"
+
+int *get(int *p) { return p; }
+// CHECK: _Ptr<int> get(_Ptr<int> p) { return p; }
+
+void use(void) {
+  int x;
+  int *q = get(&x);
+  // CHECK: _Ptr<int> q = get(&x);
+}
+
+// MAIN-NOT: === New version of {{.*}}
+
+// HEADER: _Ptr<int> get(_Ptr<int> p);
+// HEADER-NOT: {{.+}}
+
+// BOTH: === New version of {{.*}}preview_file.h ===
+// BOTH-NEXT: _Ptr<int> get(_Ptr<int> p);
+
+// MISSING: Failure occurred while trying to preview the converted files.
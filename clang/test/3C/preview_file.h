@@ -0,0 +1 @@
+int *get(int *p);
@@ -0,0 +1,34 @@
+// Tests the on-demand root cause queries through 3c -server: the root causes
+// in a file, the pointers affected by a root cause, the root causes of each
+// of those pointers, and that invalidating the root cause removes it. The
+// keys found by one run are used by the requests of the next one.
+//
+// RUN: echo '{"jsonrpc":"2.0","id":1,"method":"rootCausesInFile","params":{"file":"%s"}}' > %t.req1
+// RUN: 3c -base-dir=%S -server %s -- < %t.req1 > %t.out1
+// RUN: sed -E 's|.*"key":([0-9]+).*|{"jsonrpc":"2.0","id":2,"method":"affectedPointers","params":{"key":\1}}|' %t.out1 > %t.req2
+// RUN: 3c -base-dir=%S -server %s -- < %t.req2 > %t.out2
+// RUN: sed -E 's|.*"result":\[([0-9,]*)\].*|\1|' %t.out2 | tr ',' '\n' \
+// RUN:   | sed -E 's|^([0-9]+)$|{"jsonrpc":"2.0","id":\1,"method":"rootCauses","params":{"key":\1}}|' > %t.req3
+// RUN: sed -E 's|.*"key":([0-9]+).*|{"jsonrpc":"2.0","id":"invalidate","method":"invalidateRootCause","params":{"key":\1}}|' %t.out1 >> %t.req3
+// RUN: echo '{"jsonrpc":"2.0","id":"after","method":"rootCausesInFile","params":{"file":"%s"}}' >> %t.req3
+// RUN: 3c -base-dir=%S -server %s -- < %t.req3 > %t.out3
+// RUN: cat %t.out1 %t.out2 %t.out3 | FileCheck %s
+
+int *f(int x) {
+  int *p = (int *)x;
+  return p;
+}
+
+// The cast in f is the only root cause in the file.
+// CHECK: {"id":1,"jsonrpc":"2.0","result":[{"key":[[KEY:[0-9]+]],"location":"{{.*}}root_cause_queries.c:18:{{[0-9]+}}:{{[0-9]+}}","reason":"{{.+}}"}]}
+
+// It makes p and the return value of f WILD.
+// CHECK-NEXT: {"id":2,"jsonrpc":"2.0","result":[{{[0-9]+}},{{[0-9]+(,[0-9]+)*}}]}
+
+// The return value of f has the cast as its root cause.
+// CHECK: "result":[{"key":[[KEY]],
+
+// Invalidating the cast makes the pointers non-WILD and removes the root
+// cause.
+// CHECK: {"id":"invalidate","jsonrpc":"2.0","result":true}
+// CHECK-NEXT: {"id":"after","jsonrpc":"2.0","result":[]}
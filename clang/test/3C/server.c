@@ -0,0 +1,33 @@
+// Tests the JSON-RPC requests that 3c -server answers on stdin, and that a
+// request about a key that is not a constraint variable does not create one.
+//
+// RUN: echo '{"jsonrpc":"2.0","id":1,"method":"makeNonWild","params":{"key":999999}}' > %t.requests
+// RUN: echo '{"jsonrpc":"2.0","id":2,"method":"invalidateRootCause","params":{"key":999999}}' >> %t.requests
+// RUN: echo '{"jsonrpc":"2.0","id":3,"method":"rootCauses","params":{"key":999999}}' >> %t.requests
+// RUN: echo '{"jsonrpc":"2.0","id":4,"method":"affectedPointers","params":{"key":999999}}' >> %t.requests
+// RUN: echo '{"jsonrpc":"2.0","id":5,"method":"rootCausesInFile","params":{"file":"nonexistent.c"}}' >> %t.requests
+// RUN: echo '{"jsonrpc":"2.0","id":6,"method":"makeNonWild","params":{}}' >> %t.requests
+// RUN: echo '{"jsonrpc":"2.0","id":7,"method":"unknownMethod"}' >> %t.requests
+// RUN: echo '{"jsonrpc":"2.0","id":8}' >> %t.requests
+// RUN: echo 'not json' >> %t.requests
+// RUN: echo '' >> %t.requests
+// RUN: echo '{"jsonrpc":"2.0","id":9,"method":"shutdown"}' >> %t.requests
+// RUN: echo '{"jsonrpc":"2.0","id":10,"method":"writeFiles"}' >> %t.requests
+// RUN: 3c -base-dir=%S -server %s -- < %t.requests | FileCheck %s
+
+int *f(int x) {
+  int *p = (int *)x;
+  return p;
+}
+
+// CHECK: {"id":1,"jsonrpc":"2.0","result":false}
+// CHECK-NEXT: {"id":2,"jsonrpc":"2.0","result":false}
+// CHECK-NEXT: {"id":3,"jsonrpc":"2.0","result":[]}
+// CHECK-NEXT: {"id":4,"jsonrpc":"2.0","result":[]}
+// CHECK-NEXT: {"id":5,"jsonrpc":"2.0","result":[]}
+// CHECK-NEXT: {"error":{"code":-32602,"message":"expected an integer \"key\" parameter"},"id":6,"jsonrpc":"2.0"}
+// CHECK-NEXT: {"error":{"code":-32601,"message":"unknown method \"unknownMethod\""},"id":7,"jsonrpc":"2.0"}
+// CHECK-NEXT: {"error":{"code":-32600,"message":"expected an object with a string \"method\""},"id":8,"jsonrpc":"2.0"}
+// CHECK-NEXT: {"error":{"code":-32700,"message":"{{.*}}"},"id":null,"jsonrpc":"2.0"}
+// CHECK-NEXT: {"id":9,"jsonrpc":"2.0","result":null}
+// CHECK-NOT: "id":10
@@ -0,0 +1,36 @@
+// Tests that -solution-output writes a solution file with the names of the
+// files, the bounds of the checked pointers and the root causes of the WILD
+// ones, that 3c can read it back, and that a file that is not a solution
+// file is rejected.
+//
+// RUN: rm -rf %t*
+// RUN: 3c -base-dir=%S -alltypes -solution-output=%t.sf \
+// RUN:   -output-dir=%t.checked %s --
+// RUN: tr -c '[:print:]' '\n' < %t.sf | FileCheck %s
+// RUN: 3c -base-dir=%S -alltypes -lint-against=%t.sf %s -- \
+// RUN:   | FileCheck %s --check-prefix=SAME --allow-empty
+// RUN: echo 'not a solution file' > %t.bad
+// RUN: not 3c -base-dir=%S -alltypes -lint-against=%t.bad %s -- 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=BAD
+
+void fill(int *arr, unsigned len) {
+  unsigned i;
+  for (i = 0; i < len; i++)
+    arr[i] = 0;
+}
+
+void cast(char *b) {
+  int *p = (int *)b;
+}
+
+// The header, followed by the strings table, in which the strings are in the
+// order of the pointers that first use them.
+// CHECK: 3CSF
+// CHECK: {{.*}}solution_file.c
+// CHECK-NEXT: count(len)
+// CHECK-NEXT: Cast from char * to int *
+
+// A solution is the same as itself.
+// SAME-NOT: new WILD pointer
+
+// BAD: 3c: Error: Failed to open the solution file "{{.*}}.bad": not a 3C solution file
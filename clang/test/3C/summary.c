@@ -0,0 +1,51 @@
+// Tests that -write-3c-summary records the solution of the external functions
+// defined in a run, and that a later run that loads the summary with
+// -3c-summary constrains only the WILD pointers of those functions, which
+// have no body in it, instead of all of them.
+//
+// RUN: rm -rf %t*
+// RUN: 3c -base-dir=%S -write-3c-summary=%t.summary %s -- -DLIB > %t.lib.c
+// RUN: tr -d ' \n' < %t.summary | FileCheck %s --check-prefix=SUMMARY
+// RUN: 3c -base-dir=%S -3c-summary=%t.summary %s -- \
+// RUN:   | FileCheck -match-full-lines %s --check-prefixes=CHECK,USE
+// RUN: 3c -base-dir=%S %s -- \
+// RUN:   | FileCheck -match-full-lines %s --check-prefixes=CHECK,NOSUM
+// RUN: echo '{"Version":2}' > %t.bad
+// RUN: not 3c -base-dir=%S -3c-summary=%t.bad %s -- 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=BAD
+
+#ifdef LIB
+int *lib_ptr(int *p) { return p; }
+void lib_take(int *p) {}
+int *lib_wild(int x) {
+  int *p = (int *)x;
+  return p;
+}
+#else
+int *lib_ptr(int *p);
+void lib_take(int *p);
+int *lib_wild(int x);
+
+void use(int x) {
+  int *a = lib_ptr(&x);
+  int *b = lib_wild(x);
+  int *c = &x;
+  lib_take(c);
+}
+#endif
+
+// SUMMARY: {"Functions":{"lib_ptr":{"Bounds":[null,null],"Params":[["PTR"]],"Return":["PTR"]},"lib_take":{"Bounds":[null],"Params":[["PTR"]],"Return":[]},"lib_wild":{"Bounds":[null,null],"Params":[[]],"Return":["WILD"]}},"Version":2}
+
+// The declarations of external functions are not rewritten.
+// CHECK: int *lib_ptr(int *p);
+// CHECK: void lib_take(int *p);
+
+// USE: _Ptr<int> a = lib_ptr(&x);
+// USE-NEXT: int *b = lib_wild(x);
+// USE-NEXT: _Ptr<int> c = &x;
+
+// NOSUM: int *a = lib_ptr(&x);
+// NOSUM-NEXT: int *b = lib_wild(x);
+// NOSUM-NEXT: int *c = &x;
+
+// BAD: 3C initialization error: Failed to load the 3C summary "{{.*}}.bad": expected an object with a "Functions" object
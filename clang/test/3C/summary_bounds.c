@@ -0,0 +1,38 @@
+// Tests that under -alltypes, a 3C summary records the checked kind and the
+// count bounds of the parameters of the functions it describes, and that a
+// run that loads it infers the bounds of the arguments from them, as if the
+// function had been defined in that run. A summary of version 1, which has no
+// bounds, still loads.
+//
+// RUN: rm -rf %t*
+// RUN: 3c -base-dir=%S -alltypes -write-3c-summary=%t.summary %s -- -DLIB \
+// RUN:   > %t.lib.c
+// RUN: tr -d ' \n' < %t.summary | FileCheck %s --check-prefix=SUMMARY
+// RUN: 3c -base-dir=%S -alltypes -3c-summary=%t.summary %s -- \
+// RUN:   | FileCheck -match-full-lines %s --check-prefix=USE
+// RUN: 3c -base-dir=%S -alltypes %s -- \
+// RUN:   | FileCheck -match-full-lines %s --check-prefix=NOSUM
+// RUN: echo '{"Version":1,"Functions":{"lib_fill":{"Return":[],"Params":[["ARR"],[]]}}}' > %t.v1
+// RUN: 3c -base-dir=%S -alltypes -3c-summary=%t.v1 %s -- \
+// RUN:   | FileCheck -match-full-lines %s --check-prefix=V1
+
+#ifdef LIB
+void lib_fill(int *arr, unsigned len) {
+  unsigned i;
+  for (i = 0; i < len; i++)
+    arr[i] = 0;
+}
+#else
+void lib_fill(int *arr, unsigned len);
+
+void use(unsigned n) {
+  int *arr1;
+  lib_fill(arr1, n);
+}
+#endif
+
+// SUMMARY: {"Functions":{"lib_fill":{"Bounds":[null,{"Kind":"count","Param":1},null],"Params":[["ARR"],[]],"Return":[]}},"Version":2}
+
+// USE: _Array_ptr<int> arr1 : count(n) = ((void *)0);
+// NOSUM: int *arr1;
+// V1: _Array_ptr<int> arr1{{.*}} = ((void *)0);
@@ -0,0 +1,44 @@
+// Tests that with -fcheckedc-assume-proven-bounds, a bounds check that was
+// proved during semantic analysis is emitted as an llvm.assume of its range
+// condition instead of being dropped, and that checks that were not proved
+// are emitted as usual.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-assume-proven-bounds -emit-llvm -o - %s \
+// RUN:   | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=NOASSUME
+
+#include <stdchecked.h>
+
+int proven(array_ptr<int> p : count(4)) {
+  return p[1];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @proven(
+// CHECK: %_Dynamic_check.lower = icmp ule i32*
+// CHECK: %_Dynamic_check.upper = icmp ult i32*
+// CHECK: %_Dynamic_check.range = and i1 %_Dynamic_check.lower, %_Dynamic_check.upper
+// CHECK-NEXT: call void @llvm.assume(i1 %_Dynamic_check.range)
+// CHECK-NOT: br i1 %_Dynamic_check.range
+// CHECK: ret i32
+
+int unproven(int n, array_ptr<int> p : count(n), int i) {
+  return p[i];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @unproven(
+// CHECK-NOT: @llvm.assume
+// CHECK: br i1 %_Dynamic_check.{{[a-z_]*}}range, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed
+// CHECK: ret i32
+
+// A write through a null-terminated pointer is never assumed.
+void nt_write(nt_array_ptr<char> s : count(4)) {
+  s[1] = 'a';
+}
+
+// CHECK-LABEL: define {{.*}}void @nt_write(
+// CHECK-NOT: @llvm.assume
+// CHECK: ret void
+
+// NOASSUME-NOT: @llvm.assume
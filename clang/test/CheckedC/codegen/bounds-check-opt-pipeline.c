@@ -0,0 +1,35 @@
+// Tests that -fcheckedc-hoist-bounds-checks adds the Checked C bounds check
+// optimizations to the pipeline: the function pass late in the scalar
+// optimizer, and the interprocedural pass at the end of the optimizer.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -O2 \
+// RUN:   -fno-experimental-new-pass-manager -fcheckedc-hoist-bounds-checks \
+// RUN:   -mllvm -debug-pass=Structure -emit-llvm -o /dev/null %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=LEGACY
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -O2 \
+// RUN:   -fexperimental-new-pass-manager -fcheckedc-hoist-bounds-checks \
+// RUN:   -fdebug-pass-manager -emit-llvm -o /dev/null %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=NEWPM
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -O2 \
+// RUN:   -fno-experimental-new-pass-manager \
+// RUN:   -mllvm -debug-pass=Structure -emit-llvm -o /dev/null %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=LEGACY-OFF
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -O2 \
+// RUN:   -fexperimental-new-pass-manager \
+// RUN:   -fdebug-pass-manager -emit-llvm -o /dev/null %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=NEWPM-OFF
+
+// LEGACY: Optimize Checked C bounds checks
+// LEGACY: Remove Checked C bounds checks made by all callers
+
+// NEWPM: Running pass: CheckedCBoundsCheckOptPass
+// NEWPM: Running pass: CheckedCIPBoundsCheckOptPass
+
+// LEGACY-OFF-NOT: Checked C bounds checks
+// NEWPM-OFF-NOT: CheckedC{{(IP)?}}BoundsCheckOptPass
+
+#include <stdchecked.h>
+
+int f(int n, array_ptr<int> p : count(n), int i) {
+  return p[i];
+}
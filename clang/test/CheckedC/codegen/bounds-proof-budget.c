@@ -0,0 +1,40 @@
+// Tests that once the bounds proof budget of a function is exhausted, the
+// remaining bounds declarations cannot be proved and the remaining memory
+// accesses keep their dynamic checks, and that the next function has a
+// budget of its own.
+//
+// RUN: %clang_cc1 -fsyntax-only -fcheckedc-bounds-proof-budget=1 -verify %s
+// RUN: %clang_cc1 -fsyntax-only -verify=nobudget %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-bounds-proof-budget=1 -emit-llvm -o - %s 2>/dev/null \
+// RUN:   | FileCheck %s --check-prefix=BUDGET
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=NOBUDGET
+
+// nobudget-no-diagnostics
+
+#include <stdchecked.h>
+
+void declarations(array_ptr<int> p : count(n), int n) {
+  array_ptr<int> q : count(n) = p;
+  array_ptr<int> r : count(n) = p; // expected-warning {{cannot prove declared bounds for 'r' are valid after initialization}}
+}
+
+// The budget is per function, and the proof that was cut short above is
+// attempted again.
+void next_function(array_ptr<int> p : count(n), int n) {
+  array_ptr<int> r : count(n) = p;
+}
+
+int accesses(array_ptr<int> p : count(4)) {
+  return p[1] + p[2];
+}
+
+// BUDGET-LABEL: define {{.*}}i32 @accesses(
+// BUDGET: br i1 %_Dynamic_check.{{[a-z_.0-9]*}}, label %_Dynamic_check.succeeded
+// BUDGET-NOT: br i1 %_Dynamic_check.
+// BUDGET: ret i32
+
+// NOBUDGET-LABEL: define {{.*}}i32 @accesses(
+// NOBUDGET-NOT: _Dynamic_check.succeeded
+// NOBUDGET: ret i32
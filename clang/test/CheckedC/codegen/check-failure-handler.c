@@ -0,0 +1,56 @@
+// Tests that with -fcheckedc-check-failure-handler, a failing dynamic check
+// calls the failure handler of the module with the ID of its site instead of
+// trapping in place, and that the handler reports the site and traps.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-check-failure-handler -emit-llvm -o - %s \
+// RUN:   | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-check-failure-handler -fcheckedc-shared-check-failure \
+// RUN:   -emit-llvm -o - %s | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-pc-windows-msvc \
+// RUN:   -fcheckedc-check-failure-handler -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=WINDOWS
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-check-failure-handler -fcheckedc-dynamic-check-mode=count \
+// RUN:   -emit-llvm -o - %s | FileCheck %s --check-prefix=COUNT
+
+#include <stdchecked.h>
+
+int f(ptr<int> p) {
+  return *p;
+}
+
+int g(ptr<int> p, ptr<int> q) {
+  return *p + *q;
+}
+
+// CHECK: @_Dynamic_check.failure_sites = private constant [3 x %struct._Checkedc_check_failure_site] [%struct._Checkedc_check_failure_site { i8* {{.*}}, i32 21, i32 {{[0-9]+}}, i8* {{.*}} }, %struct._Checkedc_check_failure_site { i8* {{.*}}, i32 25, i32 {{[0-9]+}}, i8* {{.*}} }, %struct._Checkedc_check_failure_site { i8* {{.*}}, i32 25, i32 {{[0-9]+}}, i8* {{.*}} }]
+
+// CHECK-LABEL: define {{.*}}i32 @f(
+// CHECK: br i1 %_Dynamic_check.non_null, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed
+// CHECK: _Dynamic_check.failed{{[0-9]*}}:
+// CHECK-NEXT: call void @_Dynamic_check.failure_handler(i32 0) #[[COLD:[0-9]+]]
+// CHECK-NEXT: unreachable
+
+// Each check has a failure block of its own, which passes the ID of the check.
+// CHECK-LABEL: define {{.*}}i32 @g(
+// CHECK: _Dynamic_check.failed{{[0-9]*}}:
+// CHECK-NEXT: call void @_Dynamic_check.failure_handler(i32 1) #[[COLD]]
+// CHECK: _Dynamic_check.failed{{[0-9]*}}:
+// CHECK-NEXT: call void @_Dynamic_check.failure_handler(i32 2) #[[COLD]]
+
+// CHECK: define internal void @_Dynamic_check.failure_handler(i32 %0) #[[HANDLER:[0-9]+]]
+// CHECK: getelementptr inbounds [3 x %struct._Checkedc_check_failure_site], [3 x %struct._Checkedc_check_failure_site]* @_Dynamic_check.failure_sites, i32 0, i32 %0
+// CHECK: call i32 (i32, i8*, ...) @dprintf(i32 2,
+// CHECK: call void @llvm.trap()
+// CHECK-NEXT: unreachable
+
+// CHECK: attributes #[[HANDLER]] = { cold noinline noreturn nounwind }
+
+// WINDOWS: define internal void @_Dynamic_check.failure_handler(i32 %0)
+// WINDOWS-NOT: dprintf
+// WINDOWS: call void @llvm.trap()
+
+// Counted failures continue after the check, so they never use the handler.
+// COUNT-NOT: _Dynamic_check.failure_handler
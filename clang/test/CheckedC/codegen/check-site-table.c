@@ -0,0 +1,51 @@
+// Tests that with -fcheckedc-check-site-table, each dynamic check adds an
+// entry with its file, line, column, kind, function and site ID to the
+// checkedc_check_site_table section, that the site IDs are the IDs passed to
+// the check failure handler, and that no table is emitted by default or for
+// object files other than ELF.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-check-site-table -emit-llvm -o - %s | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-check-site-table -fcheckedc-check-failure-handler \
+// RUN:   -emit-llvm -o - %s | FileCheck %s --check-prefixes=CHECK,HANDLER
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=NOTABLE
+// RUN: %clang_cc1 -triple x86_64-apple-darwin \
+// RUN:   -fcheckedc-check-site-table -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=NOTABLE
+
+#include <stdchecked.h>
+
+int f(array_ptr<int> p : count(n), int n, int i) {
+  return p[i];
+}
+
+int g(ptr<int> q) {
+  return *q;
+}
+
+// CHECK: %struct._Checkedc_check_site_entry = type { i8*, i32, i32, i8*, i8*, i32 }
+
+// The non-null check and the bounds check of p[i] in f, then the non-null
+// check of *q in g.
+// CHECK: @[[FILE:.str[.0-9]*]] = private unnamed_addr constant [{{[0-9]+}} x i8] c"{{.*}}check-site-table.c\00"
+// CHECK: @[[NONNULL:.str[.0-9]*]] = private unnamed_addr constant [9 x i8] c"non-null\00"
+// CHECK: @[[F:.str[.0-9]*]] = private unnamed_addr constant [2 x i8] c"f\00"
+// CHECK: @_Dynamic_check.site_entry = private constant %struct._Checkedc_check_site_entry { i8* getelementptr inbounds ({{.*}}@[[FILE]]{{[^)]*}}), i32 21, i32 10, i8* getelementptr inbounds ({{.*}}@[[NONNULL]]{{[^)]*}}), i8* getelementptr inbounds ({{.*}}@[[F]]{{[^)]*}}), i32 0 }, section "checkedc_check_site_table", align 8
+// CHECK: @[[BOUNDS:.str[.0-9]*]] = private unnamed_addr constant [7 x i8] c"bounds\00"
+// CHECK: @_Dynamic_check.site_entry.{{[0-9]+}} = private constant %struct._Checkedc_check_site_entry { i8* getelementptr inbounds ({{.*}}@[[FILE]]{{[^)]*}}), i32 21, i32 10, i8* getelementptr inbounds ({{.*}}@[[BOUNDS]]{{[^)]*}}), i8* getelementptr inbounds ({{.*}}@[[F]]{{[^)]*}}), i32 1 }, section "checkedc_check_site_table", align 8
+// CHECK: @[[G:.str[.0-9]*]] = private unnamed_addr constant [2 x i8] c"g\00"
+// CHECK: @_Dynamic_check.site_entry.{{[0-9]+}} = private constant %struct._Checkedc_check_site_entry { i8* getelementptr inbounds ({{.*}}@[[FILE]]{{[^)]*}}), i32 25, i32 10, i8* getelementptr inbounds ({{.*}}@[[NONNULL]]{{[^)]*}}), i8* getelementptr inbounds ({{.*}}@[[G]]{{[^)]*}}), i32 2 }, section "checkedc_check_site_table", align 8
+// CHECK-NOT: section "checkedc_check_site_table"
+
+// Nothing refers to the entries, so they are kept by llvm.used.
+// CHECK: @llvm.used = appending global [3 x i8*] [i8* bitcast (%struct._Checkedc_check_site_entry* @_Dynamic_check.site_entry to i8*), i8* bitcast (%struct._Checkedc_check_site_entry* @_Dynamic_check.site_entry.{{[0-9]+}} to i8*), i8* bitcast (%struct._Checkedc_check_site_entry* @_Dynamic_check.site_entry.{{[0-9]+}} to i8*)], section "llvm.metadata"
+
+// HANDLER-LABEL: define {{.*}}i32 @f(
+// HANDLER: call void @_Dynamic_check.failure_handler(i32 0)
+// HANDLER: call void @_Dynamic_check.failure_handler(i32 1)
+// HANDLER-LABEL: define {{.*}}i32 @g(
+// HANDLER: call void @_Dynamic_check.failure_handler(i32 2)
+
+// NOTABLE-NOT: checkedc_check_site_table
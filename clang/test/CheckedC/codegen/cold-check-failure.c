@@ -0,0 +1,34 @@
+// Tests that dynamic check branches are weighted towards success and that
+// the failure blocks are marked cold and placed at the end of the function,
+// unless -fno-checkedc-cold-check-failure is given.  The call in a failure
+// block is tagged for the inliner.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-llvm -o - %s \
+// RUN:   | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fno-checkedc-cold-check-failure -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=NOCOLD
+
+#include <stdchecked.h>
+
+int f(ptr<int> p, int n, array_ptr<int> q : count(n), int i) {
+  return *p + q[i];
+}
+
+// The failure blocks come after the code on the success path.
+// CHECK-LABEL: define {{.*}}i32 @f(
+// CHECK: br i1 %_Dynamic_check.non_null, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed{{[0-9]*}}, !prof ![[WEIGHTS:[0-9]+]]
+// CHECK-NOT: call void @llvm.trap()
+// CHECK: br i1 %{{.*}}, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed{{[0-9]*}}, !prof ![[WEIGHTS]]
+// CHECK-NOT: call void @llvm.trap()
+// CHECK: ret i32
+// CHECK: _Dynamic_check.failed{{[0-9]*}}:
+// CHECK-NEXT: call void @llvm.trap() #[[COLD:[0-9]+]], !checkedc.check_failure ![[TAG:[0-9]+]]
+// CHECK-NEXT: unreachable
+// CHECK: attributes #[[COLD]] = { cold noreturn nounwind }
+// CHECK: ![[WEIGHTS]] = !{!"branch_weights", i32 2000, i32 1}
+
+// NOCOLD-LABEL: define {{.*}}i32 @f(
+// NOCOLD: br i1 %_Dynamic_check.non_null, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed{{[0-9]*}}{{$}}
+// NOCOLD-NOT: !prof
+// NOCOLD: ret i32
@@ -0,0 +1,58 @@
+// Tests that with -fcheckedc-dynamic-check-mode=count, a failing dynamic
+// check bumps the failure counter of its site record and continues, and that
+// on ELF targets the site records are placed in the checkedc_check_sites
+// section, which a shared function dumps at exit.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-dynamic-check-mode=count -emit-llvm -o - %s \
+// RUN:   | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-pc-windows-msvc \
+// RUN:   -fcheckedc-dynamic-check-mode=count -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=NONELF
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=TRAP
+
+#include <stdchecked.h>
+
+int f(int n, array_ptr<int> p : count(n), int i) {
+  return p[i];
+}
+
+// CHECK-DAG: $__checkedc_dump_check_counts = comdat any
+// CHECK-DAG: $__checkedc_register_check_count_dump = comdat any
+// CHECK-DAG: %struct._Checkedc_check_site = type { i64, i64, i8*, i32, i32, i8* }
+// CHECK-DAG: @_Dynamic_check.site{{(\.[0-9]+)?}} = private global %struct._Checkedc_check_site { i64 0, i64 0, {{.*}}, i32 18, i32 {{[0-9]+}}, {{.*}} }, section "checkedc_check_sites", align 8
+// CHECK-DAG: @__start_checkedc_check_sites = extern_weak hidden global %struct._Checkedc_check_site
+// CHECK-DAG: @__stop_checkedc_check_sites = extern_weak hidden global %struct._Checkedc_check_site
+// CHECK-DAG: @llvm.global_ctors = appending global {{.*}}@__checkedc_register_check_count_dump
+
+// CHECK-LABEL: define {{.*}}i32 @f(
+// CHECK: br i1 %_Dynamic_check.{{[a-z_.0-9]+}}, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed
+// CHECK: _Dynamic_check.failed{{[0-9]*}}:
+// CHECK-NEXT: [[OLD:%.*]] = load atomic i64, i64* {{.*}}@_Dynamic_check.site{{.*}} monotonic
+// CHECK-NEXT: [[NEW:%.*]] = add i64 [[OLD]], 1
+// CHECK-NEXT: store atomic i64 [[NEW]], i64* {{.*}}@_Dynamic_check.site{{.*}} monotonic
+// CHECK-NEXT: br label %_Dynamic_check.succeeded
+// CHECK-NOT: llvm.trap
+
+// CHECK-LABEL: define linkonce_odr hidden void @__checkedc_dump_check_counts()
+// CHECK-SAME: comdat
+// CHECK: icmp eq %struct._Checkedc_check_site* %site, @__stop_checkedc_check_sites
+// CHECK: call i32 (i32, i8*, ...) @dprintf(i32 2
+
+// CHECK-LABEL: define linkonce_odr hidden void @__checkedc_register_check_count_dump()
+// CHECK: call i32 @atexit(void ()* @__checkedc_dump_check_counts)
+
+// Without the section bounds, failures are counted but never dumped.
+// NONELF: @_Dynamic_check.site{{(\.[0-9]+)?}} = private global %struct._Checkedc_check_site
+// NONELF-NOT: section "checkedc_check_sites"
+// NONELF-LABEL: define {{.*}}i32 @f(
+// NONELF: _Dynamic_check.failed{{[0-9]*}}:
+// NONELF-NEXT: load atomic i64
+// NONELF-NOT: __checkedc_dump_check_counts
+
+// TRAP-NOT: _Dynamic_check.site
+// TRAP-LABEL: define {{.*}}i32 @f(
+// TRAP: _Dynamic_check.failed{{[0-9]*}}:
+// TRAP-NEXT: call void @llvm.trap()
+// TRAP-NOT: __checkedc_dump_check_counts
@@ -0,0 +1,47 @@
+// Tests that with -fcheckedc-dynamic-check-profile, every emitted dynamic
+// check bumps the execution counter of its site record before the check is
+// evaluated, and that failing checks still trap unless they are counted too.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-dynamic-check-profile -emit-llvm -o - %s \
+// RUN:   | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-dynamic-check-profile -fcheckedc-dynamic-check-mode=count \
+// RUN:   -emit-llvm -o - %s | FileCheck %s --check-prefix=COUNT
+
+#include <stdchecked.h>
+
+int f(int n, array_ptr<int> p : count(n), int i) {
+  return p[i];
+}
+
+// A check that is proved at compile time is not emitted, so it is not
+// profiled.
+int g(void) {
+  int a checked[4] = {0};
+  return a[1];
+}
+
+// CHECK-DAG: @_Dynamic_check.site{{(\.[0-9]+)?}} = private global %struct._Checkedc_check_site { i64 0, i64 0, {{.*}}, i32 15, i32 {{[0-9]+}}, {{.*}} }, section "checkedc_check_sites", align 8
+// CHECK-DAG: @llvm.global_ctors = appending global {{.*}}@__checkedc_register_check_count_dump
+
+// CHECK-LABEL: define {{.*}}i32 @f(
+// CHECK: [[OLD:%.*]] = load atomic i64, i64* getelementptr inbounds (%struct._Checkedc_check_site, %struct._Checkedc_check_site* @_Dynamic_check.site{{(\.[0-9]+)?}}, i32 0, i32 1) monotonic
+// CHECK-NEXT: [[NEW:%.*]] = add i64 [[OLD]], 1
+// CHECK-NEXT: store atomic i64 [[NEW]], i64* getelementptr inbounds (%struct._Checkedc_check_site, %struct._Checkedc_check_site* @_Dynamic_check.site{{(\.[0-9]+)?}}, i32 0, i32 1) monotonic
+// CHECK: br i1 %_Dynamic_check.{{[a-z_.0-9]+}}, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed
+// CHECK: _Dynamic_check.failed{{[0-9]*}}:
+// CHECK-NEXT: call void @llvm.trap()
+
+// CHECK-LABEL: define {{.*}}i32 @g(
+// CHECK-NOT: _Dynamic_check.site
+// CHECK: ret i32
+
+// CHECK-LABEL: define linkonce_odr hidden void @__checkedc_dump_check_counts()
+
+// COUNT-LABEL: define {{.*}}i32 @f(
+// COUNT: load atomic i64, i64* getelementptr inbounds (%struct._Checkedc_check_site, %struct._Checkedc_check_site* @_Dynamic_check.site{{(\.[0-9]+)?}}, i32 0, i32 1) monotonic
+// COUNT: _Dynamic_check.failed{{[0-9]*}}:
+// COUNT-NEXT: load atomic i64, i64* {{.*}}@_Dynamic_check.site{{.*}} monotonic
+// COUNT-NOT: llvm.trap
+// COUNT: br label %_Dynamic_check.succeeded
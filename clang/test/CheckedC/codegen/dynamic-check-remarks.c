@@ -0,0 +1,40 @@
+// Tests that -Rcheckedc-dynamic-checks reports the dynamic checks that are
+// inserted and the ones that are left out, and that the remarks do not change
+// the generated code.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -Rcheckedc-dynamic-checks \
+// RUN:   -emit-llvm -o %t.remarks.ll %s 2>&1 | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-llvm -o %t.ll %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=NOREMARKS --allow-empty
+// RUN: diff %t.remarks.ll %t.ll
+
+// NOREMARKS-NOT: remark:
+
+#include <stdchecked.h>
+
+void explicit_checks(int x) {
+  _Dynamic_check(x > 0);
+  // CHECK: dynamic-check-remarks.c:[[@LINE-1]]:{{[0-9]+}}: remark: inserted explicit dynamic check [-Rcheckedc-dynamic-checks]
+  _Dynamic_check(1);
+  // CHECK: dynamic-check-remarks.c:[[@LINE-1]]:{{[0-9]+}}: remark: elided explicit dynamic check whose condition is a constant [-Rcheckedc-dynamic-checks]
+}
+
+int deref(ptr<int> p) {
+  return *p;
+  // CHECK: dynamic-check-remarks.c:[[@LINE-1]]:{{[0-9]+}}: remark: inserted non-null dynamic check [-Rcheckedc-dynamic-checks]
+}
+
+int subscript(int n, array_ptr<int> q : count(n), int i) {
+  return q[i];
+  // CHECK: dynamic-check-remarks.c:[[@LINE-1]]:{{[0-9]+}}: remark: inserted bounds dynamic check [-Rcheckedc-dynamic-checks]
+}
+
+int proven(array_ptr<int> q : count(4)) {
+  return q[1];
+  // CHECK: dynamic-check-remarks.c:[[@LINE-1]]:{{[0-9]+}}: remark: elided bounds dynamic check that is proved statically [-Rcheckedc-dynamic-checks]
+}
+
+array_ptr<int> cast(array_ptr<int> q : count(4)) : count(2) {
+  return _Dynamic_bounds_cast<array_ptr<int>>(q, count(2));
+  // CHECK: dynamic-check-remarks.c:[[@LINE-1]]:{{[0-9]+}}: remark: {{inserted|elided}} bounds cast dynamic check
+}
@@ -0,0 +1,68 @@
+// Tests that -fcheckedc-checks= emits only the listed kinds of dynamic
+// checks, and that leaving out any kind is diagnosed.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-checks=nonnull -emit-llvm -o - %s 2>%t.nonnull.err \
+// RUN:   | FileCheck %s --check-prefix=NONNULL
+// RUN: FileCheck %s --input-file=%t.nonnull.err --check-prefix=WARN-NONNULL
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-checks=none -emit-llvm -o - %s 2>%t.none.err \
+// RUN:   | FileCheck %s --check-prefix=NONE
+// RUN: FileCheck %s --input-file=%t.none.err --check-prefix=WARN-NONE
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-checks=range,all -Werror -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=ALL
+// RUN: not %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-checks=range,bogus -emit-llvm -o /dev/null %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=INVALID
+
+// WARN-NONNULL: warning: '-fcheckedc-checks=nonnull' leaves out Checked C runtime checks
+// WARN-NONE: warning: '-fcheckedc-checks=none' leaves out Checked C runtime checks
+// INVALID: error: invalid value 'bogus' in '-fcheckedc-checks=range,bogus'
+
+#include <stdchecked.h>
+
+int side_effect(void);
+
+int deref(ptr<int> p) {
+  return *p;
+}
+
+int subscript(int n, array_ptr<int> q : count(n), int i) {
+  return q[i];
+}
+
+void explicit_check(int x) {
+  _Dynamic_check(x > 0);
+  _Dynamic_check(side_effect() > 0);
+}
+
+// NONNULL-LABEL: define {{.*}}i32 @deref(
+// NONNULL: br i1 %_Dynamic_check.non_null
+// NONNULL-LABEL: define {{.*}}i32 @subscript(
+// NONNULL: br i1 %_Dynamic_check.non_null
+// NONNULL-NOT: _Dynamic_check.upper
+// NONNULL-NOT: _Dynamic_check.range
+// NONNULL-LABEL: define {{.*}}void @explicit_check(
+// NONNULL-NOT: br i1
+// NONNULL: call i32 @side_effect()
+// NONNULL-NOT: br i1
+// NONNULL: ret void
+
+// A disabled _Dynamic_check still evaluates a condition with side effects.
+// NONE-NOT: _Dynamic_check.failed
+// NONE-LABEL: define {{.*}}void @explicit_check(
+// NONE-NOT: br i1
+// NONE: call i32 @side_effect()
+// NONE-NOT: br i1
+// NONE: ret void
+// NONE-NOT: _Dynamic_check.failed
+
+// ALL-LABEL: define {{.*}}i32 @deref(
+// ALL: br i1 %_Dynamic_check.non_null
+// ALL-LABEL: define {{.*}}i32 @subscript(
+// ALL: br i1 %_Dynamic_check.{{[a-z_]*}}range
+// ALL-LABEL: define {{.*}}void @explicit_check(
+// ALL: br i1
+// ALL: call i32 @side_effect()
+// ALL: br i1
@@ -0,0 +1,47 @@
+// Tests that an explicit dynamic check whose condition the constant evaluator
+// decides to be true is left out, including when the condition reads a string
+// literal or a compound literal, which is emitted as a load from memory that
+// IRBuilder cannot fold, and that a condition with side effects is still
+// evaluated.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-llvm -o - %s \
+// RUN:   | FileCheck %s
+
+#include <stdchecked.h>
+
+void string_literal(void) {
+  _Dynamic_check("abc"[1] == 'b');
+}
+
+// CHECK-LABEL: define {{.*}}void @string_literal(
+// CHECK-NOT: load
+// CHECK-NOT: _Dynamic_check
+// CHECK: ret void
+
+void compound_literal(void) {
+  _Dynamic_check((int){4} > 0);
+}
+
+// CHECK-LABEL: define {{.*}}void @compound_literal(
+// CHECK-NOT: _Dynamic_check
+// CHECK: ret void
+
+int g(void);
+
+void side_effects(void) {
+  _Dynamic_check((g(), "abc"[1] == 'b'));
+}
+
+// CHECK-LABEL: define {{.*}}void @side_effects(
+// CHECK: call i32 @g()
+// CHECK: br i1 %{{.*}}, label %_Dynamic_check.succeeded
+// CHECK: ret void
+
+void not_constant(void) {
+  _Dynamic_check("abc"[1] == 'c');
+}
+
+// A condition that is false is still checked, and fails at run time.
+// CHECK-LABEL: define {{.*}}void @not_constant(
+// CHECK: br i1 %{{.*}}, label %_Dynamic_check.succeeded
+// CHECK: ret void
@@ -0,0 +1,62 @@
+// Tests that with -fcheckedc-fuse-null-checks, the non-null check of the
+// base of a memory access is tested by the branch of the bounds check of the
+// access, and that the checks of accesses separated by a store or a call are
+// not fused with each other: each access tests its own base after the store
+// or call.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-fuse-null-checks -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=FUSED
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-fuse-null-checks -fno-checkedc-fuse-null-checks \
+// RUN:   -emit-llvm -o - %s | FileCheck %s --check-prefix=SEPARATE
+
+#include <stdchecked.h>
+
+int deref(array_ptr<int> p : count(n), int n) {
+  return *p;
+}
+
+// FUSED-LABEL: define {{.*}}i32 @deref(
+// FUSED: %_Dynamic_check.non_null = icmp ne i32* %{{.*}}, null
+// FUSED-NOT: br i1
+// FUSED: %_Dynamic_check.non_null_range = and i1 %_Dynamic_check.non_null, %_Dynamic_check.range
+// FUSED-NEXT: br i1 %_Dynamic_check.non_null_range, label %_Dynamic_check.succeeded
+// FUSED-NOT: br i1 %_Dynamic_check.
+// FUSED: ret i32
+
+// SEPARATE-LABEL: define {{.*}}i32 @deref(
+// SEPARATE: br i1 %_Dynamic_check.non_null, label %_Dynamic_check.succeeded
+// SEPARATE: br i1 %_Dynamic_check.range, label %_Dynamic_check.succeeded
+// SEPARATE-NOT: non_null_range
+// SEPARATE: ret i32
+
+void g(void);
+
+int store_and_call(array_ptr<int> p : count(n), int n, int i, int j) {
+  p[i] = 1;
+  g();
+  return p[j];
+}
+
+// FUSED-LABEL: define {{.*}}i32 @store_and_call(
+// FUSED: %_Dynamic_check.non_null{{[0-9]*}} = icmp ne i32*
+// FUSED: br i1 %_Dynamic_check.non_null_range{{[0-9]*}}, label %_Dynamic_check.succeeded
+// FUSED: store i32 1, i32*
+// FUSED-NEXT: call void @g()
+// FUSED-NEXT: load i32*, i32** %p.addr
+// FUSED-NOT: br i1
+// FUSED: %[[NONNULL:_Dynamic_check.non_null[0-9]*]] = icmp ne i32*
+// FUSED-NOT: br i1
+// FUSED: %[[FUSED:_Dynamic_check.non_null_range[0-9]*]] = and i1 %[[NONNULL]],
+// FUSED-NEXT: br i1 %[[FUSED]], label %_Dynamic_check.succeeded
+// FUSED-NOT: br i1 %_Dynamic_check.
+// FUSED: ret i32
+
+// SEPARATE-LABEL: define {{.*}}i32 @store_and_call(
+// SEPARATE: br i1 %_Dynamic_check.non_null{{[0-9]*}}, label
+// SEPARATE: br i1 %_Dynamic_check.range{{[0-9]*}}, label
+// SEPARATE: call void @g()
+// SEPARATE: br i1 %_Dynamic_check.non_null{{[0-9]*}}, label
+// SEPARATE: br i1 %_Dynamic_check.range{{[0-9]*}}, label
+// SEPARATE: ret i32
@@ -0,0 +1,82 @@
+// Tests that a bounds check against count bounds with a count that is known
+// not to be negative is emitted as the single unsigned compare
+// ptr - lower < count * size, and that the other checks keep both compares.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-llvm -o - %s \
+// RUN:   | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-hoist-bounds-checks -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=HOIST
+
+#include <stdchecked.h>
+
+int unsigned_count(unsigned n, array_ptr<int> p : count(n), unsigned i) {
+  return p[i];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @unsigned_count(
+// CHECK-NOT: _Dynamic_check.lower
+// CHECK-NOT: _Dynamic_check.upper
+// CHECK: ptrtoint i32* %{{.*}} to i64
+// CHECK: %_Dynamic_check.offset = sub i64 %{{.*}}, %{{.*}}
+// CHECK: %_Dynamic_check.count = zext i32 %{{.*}} to i64
+// CHECK-NEXT: %_Dynamic_check.size = mul i64 %_Dynamic_check.count, 4
+// CHECK-NEXT: %_Dynamic_check.range = icmp ult i64 %_Dynamic_check.offset, %_Dynamic_check.size
+// CHECK-NOT: _Dynamic_check.lower
+// CHECK-NOT: _Dynamic_check.upper
+// CHECK: br i1 %_Dynamic_check.{{[a-z_]*}}range, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed
+// CHECK: ret i32
+
+int constant_count(array_ptr<int> p : count(8), int i) {
+  return p[i];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @constant_count(
+// CHECK: %_Dynamic_check.offset = sub i64
+// CHECK: %_Dynamic_check.range = icmp ult i64 %_Dynamic_check.offset, {{32|%_Dynamic_check.size}}
+// CHECK-NOT: _Dynamic_check.upper
+// CHECK: ret i32
+
+// The element at the upper bound of a null-terminated pointer may be read.
+char nt_read(unsigned n, nt_array_ptr<char> s : count(n), unsigned i) {
+  return s[i];
+}
+
+// CHECK-LABEL: define {{.*}}i8 @nt_read(
+// CHECK: %_Dynamic_check.offset = sub i64
+// CHECK-NOT: _Dynamic_check.size
+// CHECK: %_Dynamic_check.range = icmp ule i64 %_Dynamic_check.offset, %_Dynamic_check.count
+// CHECK-NOT: _Dynamic_check.upper
+// CHECK: ret i8
+
+// A negative signed count would give upper < lower, which the fused compare
+// would accept, so both compares are emitted.
+int signed_count(int n, array_ptr<int> p : count(n), int i) {
+  return p[i];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @signed_count(
+// CHECK-NOT: _Dynamic_check.offset
+// CHECK: %_Dynamic_check.lower = icmp ule i32*
+// CHECK: %_Dynamic_check.upper = icmp ult i32*
+// CHECK: %_Dynamic_check.range = and i1 %_Dynamic_check.lower, %_Dynamic_check.upper
+// CHECK: ret i32
+
+// A write through a null-terminated pointer needs the lower compare on its
+// own.
+void nt_write(unsigned n, nt_array_ptr<char> s : count(n), unsigned i,
+              char c) {
+  s[i] = c;
+}
+
+// CHECK-LABEL: define {{.*}}void @nt_write(
+// CHECK-NOT: _Dynamic_check.offset
+// CHECK: %_Dynamic_check.lower = icmp ule i8*
+// CHECK: ret void
+
+// The bounds check optimizations only recognize checks with two compares.
+// HOIST-LABEL: define {{.*}}i32 @unsigned_count(
+// HOIST-NOT: _Dynamic_check.offset
+// HOIST: %_Dynamic_check.lower = icmp ule i32*
+// HOIST: %_Dynamic_check.upper = icmp ult i32*
+// HOIST: ret i32
@@ -0,0 +1,41 @@
+// Tests that the lower bound comparison of a bounds check is left out only
+// when the access is at a small constant offset from the lower bound.  An
+// unsigned variable index can make the address wrap around below the lower
+// bound, so its check keeps the lower bound comparison.
+//
+// RUN: %clang_cc1 -emit-llvm -o - %s | FileCheck %s
+
+#include <stdchecked.h>
+
+int unsigned_index(array_ptr<int> p : bounds(p, e), array_ptr<int> e,
+                   unsigned i) {
+  return p[i];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @unsigned_index(
+// CHECK: %_Dynamic_check.lower = icmp ule
+// CHECK: %_Dynamic_check.upper = icmp ult
+// CHECK: %_Dynamic_check.range = and i1 %_Dynamic_check.lower, %_Dynamic_check.upper
+// CHECK: br i1 %_Dynamic_check.range, label %_Dynamic_check.succeeded
+// CHECK: ret i32
+
+int constant_index(array_ptr<int> p : bounds(p, e), array_ptr<int> e) {
+  return p[2] + *p;
+}
+
+// CHECK-LABEL: define {{.*}}i32 @constant_index(
+// CHECK-NOT: _Dynamic_check.lower
+// CHECK: %_Dynamic_check.upper = icmp ult
+// CHECK-NOT: _Dynamic_check.lower
+// CHECK: br i1 %_Dynamic_check.upper{{[0-9]*}}, label %_Dynamic_check.succeeded
+// CHECK-NOT: _Dynamic_check.lower
+// CHECK: ret i32
+
+int large_constant_index(array_ptr<int> p : bounds(p, e), array_ptr<int> e) {
+  return p[100000];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @large_constant_index(
+// CHECK: %_Dynamic_check.lower = icmp ule
+// CHECK: br i1 %_Dynamic_check.range, label %_Dynamic_check.succeeded
+// CHECK: ret i32
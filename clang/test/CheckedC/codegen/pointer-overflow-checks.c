@@ -0,0 +1,71 @@
+// Tests that with -fcheckedc-pointer-overflow-checks, arithmetic on checked
+// pointers adds the byte offset to the pointer with llvm.uadd.with.overflow
+// and fails when the carry differs from the sign of the offset, and that the
+// non-null check of the arithmetic is tested by the same branch.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-pointer-overflow-checks -emit-llvm -o - %s \
+// RUN:   | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=DEFAULT
+
+#include <stdchecked.h>
+
+// A positive offset wraps around if the addition carries.
+array_ptr<int> add_one(array_ptr<int> p) {
+  return p + 1;
+}
+
+// CHECK-LABEL: define {{.*}}i32* @add_one(
+// CHECK: %[[INT:[0-9]+]] = ptrtoint i32* %[[P:[0-9]+]] to i64
+// CHECK-NEXT: %[[SUM:[0-9]+]] = call { i64, i1 } @llvm.uadd.with.overflow.i64(i64 %[[INT]], i64 4)
+// CHECK-NEXT: %[[CARRY:[0-9]+]] = extractvalue { i64, i1 } %[[SUM]], 1
+// CHECK-NEXT: %[[WRAP:[0-9]+]] = xor i1 %[[CARRY]], false
+// CHECK-NEXT: %_Dynamic_check.overflow = or i1 {{.*}}%[[WRAP]]
+// CHECK-NEXT: %_Dynamic_check.no_overflow = xor i1 %_Dynamic_check.overflow, true
+// CHECK-NEXT: %_Dynamic_check.non_null = icmp ne i32* %[[P]], null
+// CHECK-NEXT: %_Dynamic_check.pointer_arith = and i1 %_Dynamic_check.non_null, %_Dynamic_check.no_overflow
+// CHECK-NEXT: br i1 %_Dynamic_check.pointer_arith, label %_Dynamic_check.succeeded
+// CHECK: ret i32*
+
+// A negative offset wraps around if the addition does not carry.
+array_ptr<int> sub_one(array_ptr<int> p) {
+  return p - 1;
+}
+
+// CHECK-LABEL: define {{.*}}i32* @sub_one(
+// CHECK: %[[SUM:[0-9]+]] = call { i64, i1 } @llvm.uadd.with.overflow.i64(i64 %{{[0-9]+}}, i64 -4)
+// CHECK-NEXT: %[[CARRY:[0-9]+]] = extractvalue { i64, i1 } %[[SUM]], 1
+// CHECK-NEXT: %[[WRAP:[0-9]+]] = xor i1 %[[CARRY]], true
+// CHECK-NEXT: %_Dynamic_check.overflow = or i1 {{.*}}%[[WRAP]]
+// CHECK: br i1 %_Dynamic_check.pointer_arith, label %_Dynamic_check.succeeded
+// CHECK: ret i32*
+
+// The sign of a variable offset is tested at run time.  Computing the offset
+// in bytes may also overflow.
+array_ptr<int> add_index(array_ptr<int> p, int i) {
+  return p + i;
+}
+
+// CHECK-LABEL: define {{.*}}i32* @add_index(
+// CHECK: call { i64, i1 } @llvm.smul.with.overflow.i64(
+// CHECK: %[[SUM:[0-9]+]] = call { i64, i1 } @llvm.uadd.with.overflow.i64(i64 %{{[0-9]+}}, i64 %[[OFFSET:[0-9]+]])
+// CHECK-NEXT: %[[CARRY:[0-9]+]] = extractvalue { i64, i1 } %[[SUM]], 1
+// CHECK-NEXT: %[[NEG:[0-9]+]] = icmp slt i64 %[[OFFSET]], 0
+// CHECK-NEXT: %[[WRAP:[0-9]+]] = xor i1 %[[CARRY]], %[[NEG]]
+// CHECK-NEXT: %_Dynamic_check.overflow = or i1 %{{[0-9]+}}, %[[WRAP]]
+// CHECK: br i1 %_Dynamic_check.pointer_arith, label %_Dynamic_check.succeeded
+// CHECK: ret i32*
+
+// Decrements are checked like the subtraction of 1.
+void decrement(array_ptr<int> p) {
+  --p;
+}
+
+// CHECK-LABEL: define {{.*}}void @decrement(
+// CHECK: call { i64, i1 } @llvm.uadd.with.overflow.i64(i64 %{{[0-9]+}}, i64 -4)
+// CHECK: br i1 %_Dynamic_check.pointer_arith, label %_Dynamic_check.succeeded
+// CHECK: ret void
+
+// DEFAULT-NOT: uadd.with.overflow
+// DEFAULT-NOT: _Dynamic_check.overflow
@@ -0,0 +1,49 @@
+// Tests that with -fcheckedc-propagate-null-ptr-arith, arithmetic on a null
+// checked pointer yields a null pointer through a select instead of branching
+// to a failure block, and that arithmetic checked for overflow keeps its
+// branch.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-propagate-null-ptr-arith -emit-llvm -o - %s \
+// RUN:   | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=BRANCH
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-propagate-null-ptr-arith \
+// RUN:   -fcheckedc-pointer-overflow-checks -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=OVERFLOW
+
+#include <stdchecked.h>
+
+array_ptr<int> add(array_ptr<int> p, int i) {
+  return p + i;
+}
+
+// CHECK-LABEL: define {{.*}}i32* @add(
+// CHECK: [[SUM:%.*]] = getelementptr inbounds i32, i32* [[P:%.*]], i64 %{{.*}}
+// CHECK-NEXT: %_Dynamic_check.null_arith = icmp eq i32* [[P]], null
+// CHECK-NEXT: %_Dynamic_check.arith = select i1 %_Dynamic_check.null_arith, i32* null, i32* [[SUM]]
+// CHECK-NEXT: ret i32* %_Dynamic_check.arith
+// CHECK-NOT: _Dynamic_check.failed
+
+void increment(array_ptr<int> p) {
+  p++;
+}
+
+// CHECK-LABEL: define {{.*}}void @increment(
+// CHECK: %_Dynamic_check.null_arith = icmp eq i32*
+// CHECK: %_Dynamic_check.arith = select i1 %_Dynamic_check.null_arith, i32* null, i32* %incdec.ptr
+// CHECK: store i32* %_Dynamic_check.arith
+// CHECK-NOT: _Dynamic_check.failed
+// CHECK: ret void
+
+// BRANCH-LABEL: define {{.*}}i32* @add(
+// BRANCH: br i1 %_Dynamic_check.non_null, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed
+// BRANCH-NOT: _Dynamic_check.null_arith
+// BRANCH-LABEL: define {{.*}}void @increment(
+// BRANCH: br i1 %_Dynamic_check.non_null, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed
+// BRANCH-NOT: _Dynamic_check.null_arith
+
+// OVERFLOW-LABEL: define {{.*}}i32* @add(
+// OVERFLOW-NOT: _Dynamic_check.null_arith
+// OVERFLOW: br i1 %_Dynamic_check.pointer_arith, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed
@@ -0,0 +1,49 @@
+// Tests that with -fcheckedc-reuse-bounds-values, a bounds check reuses the
+// count computed by an earlier check with the same bounds, and that the count
+// is computed again after a store, which may have changed it, and without the
+// flag.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-reuse-bounds-values -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=REUSE
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-reuse-bounds-values -fno-checkedc-reuse-bounds-values \
+// RUN:   -emit-llvm -o - %s | FileCheck %s --check-prefix=RECOMPUTE
+
+#include <stdchecked.h>
+
+int two_reads(array_ptr<int> p : count(n), unsigned n, int i, int j) {
+  return p[i] + p[j];
+}
+
+// REUSE-LABEL: define {{.*}}i32 @two_reads(
+// REUSE: load i32, i32* %n.addr
+// REUSE: %_Dynamic_check.size = mul i64 %_Dynamic_check.count, 4
+// REUSE: icmp ult i64 %_Dynamic_check.offset, %_Dynamic_check.size
+// REUSE-NOT: load i32, i32* %n.addr
+// REUSE-NOT: = mul i64
+// REUSE: icmp ult i64 %_Dynamic_check.offset{{[0-9]+}}, %_Dynamic_check.size{{$}}
+// REUSE: ret i32
+
+// RECOMPUTE-LABEL: define {{.*}}i32 @two_reads(
+// RECOMPUTE: load i32, i32* %n.addr
+// RECOMPUTE: %_Dynamic_check.size = mul
+// RECOMPUTE: load i32, i32* %n.addr
+// RECOMPUTE: %[[SIZE:_Dynamic_check.size[0-9]+]] = mul
+// RECOMPUTE: icmp ult i64 %_Dynamic_check.offset{{[0-9]+}}, %[[SIZE]]
+// RECOMPUTE: ret i32
+
+int write_then_read(array_ptr<int> p : count(n), unsigned n, int i, int j) {
+  p[i] = 0;
+  return p[j];
+}
+
+// The store may write n, so the second check loads it again.
+// REUSE-LABEL: define {{.*}}i32 @write_then_read(
+// REUSE: load i32, i32* %n.addr
+// REUSE: %_Dynamic_check.size = mul
+// REUSE: store i32 0, i32*
+// REUSE: load i32, i32* %n.addr
+// REUSE: %[[SIZE:_Dynamic_check.size[0-9]+]] = mul
+// REUSE: icmp ult i64 %_Dynamic_check.offset{{[0-9]+}}, %[[SIZE]]
+// REUSE: ret i32
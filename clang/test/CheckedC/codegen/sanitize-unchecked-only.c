@@ -0,0 +1,56 @@
+// Tests that with -fcheckedc-sanitize-unchecked-only, the loads and stores
+// that a dynamic range check or a bounds proof guards are marked nosanitize,
+// so that AddressSanitizer and HWAddressSanitizer skip them, and that other
+// accesses are still instrumented.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -fsanitize=address \
+// RUN:   -fcheckedc-sanitize-unchecked-only -disable-llvm-passes \
+// RUN:   -emit-llvm -o - %s | FileCheck %s
+// RUN: %clang_cc1 -triple aarch64-unknown-linux-gnu -fsanitize=hwaddress \
+// RUN:   -fcheckedc-sanitize-unchecked-only -disable-llvm-passes \
+// RUN:   -emit-llvm -o - %s | FileCheck %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -fsanitize=address \
+// RUN:   -disable-llvm-passes -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=INSTRUMENTED
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-sanitize-unchecked-only -disable-llvm-passes \
+// RUN:   -emit-llvm -o - %s | FileCheck %s --check-prefix=INSTRUMENTED
+
+#include <stdchecked.h>
+
+int checked_read(int n, array_ptr<int> q : count(n), int i) {
+  return q[i];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @checked_read(
+// CHECK: br i1 %_Dynamic_check.{{[a-z_]*}}range
+// CHECK: load i32, i32* %{{.*}}, align 4, !nosanitize ![[NOSAN:[0-9]+]]
+// CHECK: ret i32
+
+void checked_write(int n, array_ptr<int> q : count(n), int i) {
+  q[i] = 0;
+}
+
+// CHECK-LABEL: define {{.*}}void @checked_write(
+// CHECK: br i1 %_Dynamic_check.{{[a-z_]*}}range
+// CHECK: store i32 0, i32* %{{.*}}, align 4, !nosanitize ![[NOSAN]]
+// CHECK: ret void
+
+// The access is proved to be in bounds.
+int proven_read(array_ptr<int> q : count(4)) {
+  return q[1];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @proven_read(
+// CHECK: load i32, i32* %{{.*}}, align 4, !nosanitize ![[NOSAN]]
+// CHECK: ret i32
+
+int unchecked_read(int *u, int i) {
+  return u[i];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @unchecked_read(
+// CHECK-NOT: !nosanitize
+// CHECK: ret i32
+
+// INSTRUMENTED-NOT: !nosanitize
@@ -0,0 +1,42 @@
+// Tests that with -fcheckedc-shared-check-failure, all failing dynamic checks
+// in a function branch to a single failure block, and that without it each
+// check has a failure block of its own.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-shared-check-failure -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --check-prefix=SHARED
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu \
+// RUN:   -fcheckedc-shared-check-failure -fno-checkedc-shared-check-failure \
+// RUN:   -emit-llvm -o - %s | FileCheck %s --check-prefix=SEPARATE
+
+#include <stdchecked.h>
+
+int f(int n, array_ptr<int> p : count(n), int i, int j) {
+  return p[i] + p[j];
+}
+
+int g(ptr<int> p) {
+  return *p;
+}
+
+// SHARED-LABEL: define {{.*}}i32 @f(
+// SHARED: br i1 %{{.*}}, label %_Dynamic_check.succeeded{{[0-9]*}}, label %[[FAIL:_Dynamic_check.failed[0-9]*]]
+// SHARED: br i1 %{{.*}}, label %_Dynamic_check.succeeded{{[0-9]*}}, label %[[FAIL]]{{(,|$)}}
+// SHARED: [[FAIL]]:
+// SHARED-NEXT: call void @llvm.trap()
+// SHARED-NEXT: unreachable
+// SHARED-NOT: _Dynamic_check.failed{{[0-9]*}}:
+// SHARED-LABEL: define {{.*}}i32 @g(
+// The failure block of a function is not reused by the next one.
+// SHARED: br i1 %_Dynamic_check.non_null, label %_Dynamic_check.succeeded{{[0-9]*}}, label %[[GFAIL:_Dynamic_check.failed[0-9]*]]
+// SHARED: [[GFAIL]]:
+// SHARED-NEXT: call void @llvm.trap()
+
+// SEPARATE-LABEL: define {{.*}}i32 @f(
+// SEPARATE: br i1 %{{.*}}, label %_Dynamic_check.succeeded{{[0-9]*}}, label %[[FAIL1:_Dynamic_check.failed[0-9]*]]
+// SEPARATE-NOT: label %[[FAIL1]]{{(,|$)}}
+// SEPARATE: br i1 %{{.*}}, label %_Dynamic_check.succeeded{{[0-9]*}}, label %[[FAIL2:_Dynamic_check.failed[0-9]*]]
+// SEPARATE: [[FAIL1]]:
+// SEPARATE-NEXT: call void @llvm.trap()
+// SEPARATE: [[FAIL2]]:
+// SEPARATE-NEXT: call void @llvm.trap()
@@ -0,0 +1,20 @@
+// Tests that a function body that uses no Checked C features still gets the
+// dynamic bounds checks of its unchecked accesses with
+// -funchecked-pointers-dynamic-check.
+//
+// RUN: %clang_cc1 -funchecked-pointers-dynamic-check -emit-llvm -o - %s \
+// RUN: | FileCheck %s
+// RUN: %clang_cc1 -emit-llvm -o - %s | FileCheck %s --check-prefix=NOCHECK
+
+int f(int i) {
+  int a[4] = {0};
+  return a[i];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @f(
+// CHECK: br i1 %_Dynamic_check.{{.*}}, label %_Dynamic_check.succeeded
+// CHECK: ret i32
+
+// NOCHECK-LABEL: define {{.*}}i32 @f(
+// NOCHECK-NOT: _Dynamic_check
+// NOCHECK: ret i32
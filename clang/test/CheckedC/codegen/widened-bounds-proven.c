@@ -0,0 +1,35 @@
+// Tests that an access p[i] within the bounds (p, p + i + 1) that bounds
+// widening computes after a test of p[i] needs no dynamic check, and that
+// an upper bound whose base is cast to a pointer to a smaller type does not
+// prove an access through the original pointer.
+//
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-llvm -o - %s \
+// RUN:   | FileCheck %s
+
+#include <stdchecked.h>
+
+char widened(unsigned i, nt_array_ptr<char> p : bounds(p, p + i)) {
+  if (p[i])
+    return p[i];
+  return 0;
+}
+
+// Only the test of p[i] is checked.  The test compares p + i against the
+// lower bound p, which the read in the widened bounds relies on.
+// CHECK-LABEL: define {{.*}}i8 @widened(
+// CHECK: %_Dynamic_check.lower = icmp ule i8*
+// CHECK: br i1 %_Dynamic_check.{{[a-z_.0-9]*}}, label %_Dynamic_check.succeeded
+// CHECK-NOT: br i1 %_Dynamic_check.
+// CHECK: ret i8
+
+// The upper bound is (char *)p + n + 4, which is 4 bytes above p + n bytes,
+// not above the int at p[n].
+int cast_upper(unsigned n,
+               array_ptr<int> p : bounds(p, (array_ptr<char>)p + n + 4)) {
+  return p[n];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @cast_upper(
+// CHECK: %_Dynamic_check.upper = icmp ult i32*
+// CHECK: br i1 %_Dynamic_check.{{[a-z_.0-9]*}}, label %_Dynamic_check.succeeded
+// CHECK: ret i32
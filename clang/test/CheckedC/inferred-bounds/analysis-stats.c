@@ -0,0 +1,43 @@
+// Tests the per-function counters printed by -fdump-checkedc-analysis-stats.
+//
+// RUN: %clang_cc1 -fsyntax-only -fdump-checkedc-analysis-stats %s \
+// RUN:   | FileCheck %s
+
+// A function that uses no Checked C features is not analyzed.
+int plain(int x) {
+  return x;
+}
+
+// CHECK-NOT: stats for plain
+
+// The declaration of q is proved with the equality of q and p, and the
+// declaration of s syntactically, since a null pointer has any bounds.
+void straight_line(_Array_ptr<int> p : count(n), int n) {
+  _Array_ptr<int> q : count(n) = p;
+  _Array_ptr<int> s : count(n) = 0;
+}
+
+// CHECK-LABEL: Checked C analysis stats for straight_line:
+// CHECK-NEXT: CFG blocks: 3
+// CHECK-NEXT: Available facts block visits: {{[0-9]+}}
+// CHECK-NEXT: Bounds widening block visits: {{[0-9]+}}
+// CHECK-NEXT: Bounds proofs: 2 (true: 2, false: 0, maybe: 0, syntactic: 1, cached: 0)
+// CHECK-NEXT: Max EquivExprs sets: {{[0-9]+}}, max set size: {{[0-9]+}}
+// CHECK-NEXT: Time (s): prepass {{[0-9]+\.[0-9]+}}, CFG {{[0-9]+\.[0-9]+}}, facts {{[0-9]+\.[0-9]+}}, widening {{[0-9]+\.[0-9]+}}, checking {{[0-9]+\.[0-9]+}}
+
+// The dataflow analyses visit the blocks of the loop.
+int loop(_Nt_array_ptr<char> p : count(0)) {
+  int n = 0;
+  while (*p) {
+    p++;
+    n++;
+  }
+  return n;
+}
+
+// CHECK-LABEL: Checked C analysis stats for loop:
+// CHECK-NEXT: CFG blocks: {{[5-9]|[1-9][0-9]+}}
+// CHECK-NEXT: Available facts block visits: {{[1-9][0-9]*}}
+// CHECK-NEXT: Bounds widening block visits: {{[1-9][0-9]*}}
+// CHECK-NEXT: Bounds proofs: {{[0-9]+}} (true: {{[0-9]+}}, false: 0, maybe: {{[0-9]+}}, syntactic: {{[0-9]+}}, cached: {{[0-9]+}})
+// CHECK-NOT: stats for
@@ -0,0 +1,41 @@
+// Tests for checking the deferred function bodies in bottom-up call graph
+// order. The diagnostics must be the same as when each function body is
+// checked as soon as it is parsed, but the diagnostics for a callee come
+// before the diagnostics for its callers.
+//
+// RUN: %clang_cc1 -fcheckedc-call-graph-order -verify \
+// RUN: -verify-ignore-unexpected=note -verify-ignore-unexpected=warning %s
+// RUN: %clang_cc1 -fcheckedc-call-graph-order -Wno-everything %s 2>&1 \
+// RUN: | FileCheck %s
+
+int a;
+
+void f2(int i);
+
+void f1(int i) {
+  _Nt_array_ptr<char> p : bounds(p, p + i) = "a"; // expected-error {{it is not possible to prove that the inferred bounds of 'p' imply the declared bounds of 'p' after initialization}}
+  if (*p)
+    f2(i);
+}
+
+void f2(int i) {
+  char p _Nt_checked[] : bounds(p + i, p)  = "abc";
+
+  if (p[0]) {
+    i = 0; // expected-error {{inferred bounds for 'p' are unknown after assignment}}
+    a = 2;
+  }
+}
+
+void f3(void) {
+  _Nt_array_ptr<char> q : count(0) = "a";
+  if (*q) {
+    if (*(q - 1)) { // expected-error {{out-of-bounds memory access}}
+      f1(3);
+    }
+  }
+}
+
+// CHECK: call-graph-order.c:25:{{.*}} error: inferred bounds for 'p' are unknown after assignment
+// CHECK: call-graph-order.c:16:{{.*}} error: it is not possible to prove that the inferred bounds of 'p'
+// CHECK: call-graph-order.c:33:{{.*}} error: out-of-bounds memory access
@@ -0,0 +1,44 @@
+// Tests for deferring bounds checking of function bodies and global variables
+// to the end of the translation unit. The diagnostics must be the same as (and in the same
+// order as) when each function body is checked as soon as it is parsed.
+//
+// RUN: %clang_cc1 -fcheckedc-deferred-bounds-checking -verify \
+// RUN: -verify-ignore-unexpected=note -verify-ignore-unexpected=warning %s
+// RUN: %clang_cc1 -verify \
+// RUN: -verify-ignore-unexpected=note -verify-ignore-unexpected=warning %s
+// RUN: %clang_cc1 -fcheckedc-deferred-bounds-checking -Wno-everything %s 2>&1 \
+// RUN: | FileCheck %s
+
+int a;
+
+void f1(int i) {
+  _Nt_array_ptr<char> p : bounds(p, p + i) = "a"; // expected-error {{it is not possible to prove that the inferred bounds of 'p' imply the declared bounds of 'p' after initialization}}
+  if (*p)
+    a = 1;
+}
+
+int garr[2];
+_Array_ptr<int> g : count(3) = garr; // expected-error {{declared bounds for 'g' are invalid after initialization}}
+
+void f2(int i) {
+  char p _Nt_checked[] : bounds(p + i, p)  = "abc";
+
+  if (p[0]) {
+    i = 0; // expected-error {{inferred bounds for 'p' are unknown after assignment}}
+    a = 2;
+  }
+}
+
+void f3(void) {
+  _Nt_array_ptr<char> q : count(0) = "a";
+  if (*q) {
+    if (*(q - 1)) { // expected-error {{out-of-bounds memory access}}
+      a = 3;
+    }
+  }
+}
+
+// CHECK: deferred-checking.c:15:{{.*}} error: it is not possible to prove that the inferred bounds of 'p'
+// CHECK: deferred-checking.c:21:{{.*}} error: declared bounds for 'g' are invalid after initialization
+// CHECK: deferred-checking.c:27:{{.*}} error: inferred bounds for 'p' are unknown after assignment
+// CHECK: deferred-checking.c:35:{{.*}} error: out-of-bounds memory access
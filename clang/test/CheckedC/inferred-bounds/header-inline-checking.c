@@ -0,0 +1,27 @@
+// Tests that the bounds declarations within the static inline functions of
+// system headers are checked only when the functions are used.
+//
+// RUN: %clang_cc1 -verify -verify-ignore-unexpected=note %s
+// RUN: %clang_cc1 -fcheckedc-deferred-bounds-checking -verify \
+// RUN: -verify-ignore-unexpected=note %s
+
+# 1 "header.h" 1 3
+static inline void unused_inline(void) {
+  int a[2];
+  _Array_ptr<int> p : count(3) = a;
+}
+
+static inline void used_inline(void) {
+  int a[2];
+  _Array_ptr<int> p : count(3) = a; // expected-error {{declared bounds for 'p' are invalid after initialization}}
+}
+
+void header_fn(void) {
+  int a[2];
+  _Array_ptr<int> p : count(3) = a; // expected-error {{declared bounds for 'p' are invalid after initialization}}
+}
+# 23 "header-inline-checking.c" 2
+
+void f(void) {
+  used_inline();
+}
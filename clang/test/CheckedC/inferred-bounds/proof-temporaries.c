@@ -0,0 +1,25 @@
+// Tests that bounds declarations are proved valid when the source bounds use
+// bounds temporaries, which cannot be profiled for the bounds proof cache or
+// for the syntactic comparison of bounds.
+//
+// RUN: %clang_cc1 -verify %s
+// expected-no-diagnostics
+
+#include <stdchecked.h>
+
+void string_literal(void) {
+  // The bounds of the initializer are bounds(temp("abc"), temp("abc") + 3).
+  nt_array_ptr<char> buf : count(2) = "abc";
+  nt_array_ptr<char> buf2 : count(2) = "abc";
+  nt_array_ptr<char> same : count(3) = "abc";
+}
+
+void dynamic_bounds_cast(array_ptr<int> arr : count(1)) {
+  // The bounds of the cast are bounds(temp(arr), temp(arr) + 2).
+  arr = _Dynamic_bounds_cast<array_ptr<int>>(arr, count(2));
+  arr = _Dynamic_bounds_cast<array_ptr<int>>(arr, count(2));
+
+  array_ptr<int> p : count(2) = 0;
+  p = _Dynamic_bounds_cast<array_ptr<int>>(arr, count(2));
+  p = _Dynamic_bounds_cast<array_ptr<int>>(arr, count(2));
+}
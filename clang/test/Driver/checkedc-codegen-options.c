@@ -0,0 +1,99 @@
+// Make sure the driver passes the Checked C code generation options on to
+// the frontend, and that the last of an option and its negation wins.
+//
+// RUN: %clang -### -c -fcheckedc-shared-check-failure %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=shared-check-failure
+// shared-check-failure: "-cc1"
+// shared-check-failure-SAME: "-fcheckedc-shared-check-failure"
+//
+// RUN: %clang -### -c -fcheckedc-shared-check-failure \
+// RUN:   -fno-checkedc-shared-check-failure %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=no-shared-check-failure
+// no-shared-check-failure: "-cc1"
+// no-shared-check-failure-NOT: "-fcheckedc-shared-check-failure"
+// no-shared-check-failure-SAME: "-fno-checkedc-shared-check-failure"
+//
+// RUN: %clang -### -c -fcheckedc-dynamic-check-profile %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=dynamic-check-profile
+// dynamic-check-profile: "-cc1"
+// dynamic-check-profile-SAME: "-fcheckedc-dynamic-check-profile"
+//
+// RUN: %clang -### -c -fcheckedc-dynamic-check-profile \
+// RUN:   -fno-checkedc-dynamic-check-profile %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=no-dynamic-check-profile
+// no-dynamic-check-profile: "-cc1"
+// no-dynamic-check-profile-NOT: "-fcheckedc-dynamic-check-profile"
+// no-dynamic-check-profile-SAME: "-fno-checkedc-dynamic-check-profile"
+//
+// RUN: %clang -### -c -fcheckedc-cold-check-failure %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=cold-check-failure
+// cold-check-failure: "-cc1"
+// cold-check-failure-SAME: "-fcheckedc-cold-check-failure"
+//
+// RUN: %clang -### -c -fcheckedc-cold-check-failure \
+// RUN:   -fno-checkedc-cold-check-failure %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=no-cold-check-failure
+// no-cold-check-failure: "-cc1"
+// no-cold-check-failure-NOT: "-fcheckedc-cold-check-failure"
+// no-cold-check-failure-SAME: "-fno-checkedc-cold-check-failure"
+//
+// RUN: %clang -### -c -fcheckedc-assume-proven-bounds %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=assume-proven-bounds
+// assume-proven-bounds: "-cc1"
+// assume-proven-bounds-SAME: "-fcheckedc-assume-proven-bounds"
+//
+// RUN: %clang -### -c -fcheckedc-assume-proven-bounds \
+// RUN:   -fno-checkedc-assume-proven-bounds %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=no-assume-proven-bounds
+// no-assume-proven-bounds: "-cc1"
+// no-assume-proven-bounds-NOT: "-fcheckedc-assume-proven-bounds"
+// no-assume-proven-bounds-SAME: "-fno-checkedc-assume-proven-bounds"
+//
+// RUN: %clang -### -c -fcheckedc-check-failure-handler %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=check-failure-handler
+// check-failure-handler: "-cc1"
+// check-failure-handler-SAME: "-fcheckedc-check-failure-handler"
+//
+// RUN: %clang -### -c -fcheckedc-check-failure-handler \
+// RUN:   -fno-checkedc-check-failure-handler %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=no-check-failure-handler
+// no-check-failure-handler: "-cc1"
+// no-check-failure-handler-NOT: "-fcheckedc-check-failure-handler"
+// no-check-failure-handler-SAME: "-fno-checkedc-check-failure-handler"
+//
+// RUN: %clang -### -c -fcheckedc-checks=nonnull,range %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=checks
+// checks: "-cc1"
+// checks-SAME: "-fcheckedc-checks=nonnull,range"
+//
+// RUN: %clang -### -c -fcheckedc-checks=none -fcheckedc-checks=all %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=checks-last
+// checks-last: "-cc1"
+// checks-last-NOT: "-fcheckedc-checks=none"
+// checks-last-SAME: "-fcheckedc-checks=all"
+//
+// RUN: %clang -### -c -fcheckedc-sanitize-unchecked-only %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=sanitize-unchecked-only
+// sanitize-unchecked-only: "-cc1"
+// sanitize-unchecked-only-SAME: "-fcheckedc-sanitize-unchecked-only"
+//
+// RUN: %clang -### -c -fcheckedc-sanitize-unchecked-only \
+// RUN:   -fno-checkedc-sanitize-unchecked-only %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=no-sanitize-unchecked-only
+// no-sanitize-unchecked-only: "-cc1"
+// no-sanitize-unchecked-only-NOT: "-fcheckedc-sanitize-unchecked-only"
+// no-sanitize-unchecked-only-SAME: "-fno-checkedc-sanitize-unchecked-only"
+//
+// RUN: %clang -### -c -fcheckedc-propagate-null-ptr-arith %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=propagate-null-ptr-arith
+// propagate-null-ptr-arith: "-cc1"
+// propagate-null-ptr-arith-SAME: "-fcheckedc-propagate-null-ptr-arith"
+//
+// RUN: %clang -### -c -fcheckedc-propagate-null-ptr-arith \
+// RUN:   -fno-checkedc-propagate-null-ptr-arith %s 2>&1 \
+// RUN:  | FileCheck %s -check-prefix=no-propagate-null-ptr-arith
+// no-propagate-null-ptr-arith: "-cc1"
+// no-propagate-null-ptr-arith-NOT: "-fcheckedc-propagate-null-ptr-arith"
+// no-propagate-null-ptr-arith-SAME: "-fno-checkedc-propagate-null-ptr-arith"
+
+extern void f(_Ptr<int> p) {}
@@ -0,0 +1,50 @@
+// Test that the normalized bounds of Checked C declarations and the uses of
+// members by member bounds survive a round trip through a PCH file.
+
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -emit-pch -o %t %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -include-pch %t \
+// RUN:   -verify -DADDRESS_OF_MEMBER %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -include-pch %t \
+// RUN:   -emit-llvm -o - %s | FileCheck %s
+
+#ifndef HEADER
+#define HEADER
+
+struct S {
+  _Array_ptr<int> p : count(len);
+  int len;
+};
+
+int n;
+_Array_ptr<int> gp : count(n);
+
+#else
+
+#ifdef ADDRESS_OF_MEMBER
+// The PCH records that the bounds of S::p use S::len.
+int *f(struct S *s) {
+  return &s->len; // expected-error {{cannot take address of member used in member bounds}}
+                  // expected-note@* {{member bounds declared here}}
+}
+#else
+// The dynamic checks use the normalized bounds read from the PCH.
+int g(struct S *s, int i) {
+  return s->p[i];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @g(
+// CHECK: getelementptr inbounds %struct.S, %struct.S* %{{.*}}, i32 0, i32 1
+// CHECK: %_Dynamic_check.upper = icmp ult i32*
+// CHECK: br i1 %_Dynamic_check.{{[a-z_]*}}range, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed
+
+int h(int i) {
+  return gp[i];
+}
+
+// CHECK-LABEL: define {{.*}}i32 @h(
+// CHECK: load i32, i32* @n
+// CHECK: %_Dynamic_check.upper = icmp ult i32*
+// CHECK: br i1 %_Dynamic_check.{{[a-z_]*}}range, label %_Dynamic_check.succeeded{{[0-9]*}}, label %_Dynamic_check.failed
+#endif
+
+#endif
@@ -12,8 +12,11 @@
 
 #include "clang/3C/3C.h"
 #include "clang/Tooling/CommonOptionsParser.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 
 using namespace clang::driver;
 using namespace clang::tooling;
@@ -97,6 +100,13 @@ static cl::opt<std::string> OptOutputDir(
              "relative paths as the originals under the -base-dir"),
     cl::init(""), cl::cat(_3CCategory));
 
+static cl::opt<std::string> OptOutputPatch(
+    "output-patch",
+    cl::desc("File to which the changes are written as a unified diff, with "
+             "paths relative to the -base-dir, instead of writing the updated "
+             "files"),
+    cl::init(""), cl::cat(_3CCategory));
+
 static cl::opt<std::string>
     OptMalloc("use-malloc",
               cl::desc("Allows for the usage of user-specified "
@@ -132,6 +142,18 @@ static cl::opt<std::string> OptPerPtrWILDInfoJson(
 static cl::opt<bool> OptDumpStats("dump-stats", cl::desc("Dump statistics"),
                                   cl::init(false), cl::cat(_3CCategory));
 
+static cl::opt<bool> OptDumpMemoryStats(
+    "dump-memory-stats",
+    cl::desc("Dump the memory used by the constraint variables"),
+    cl::init(false), cl::cat(_3CCategory));
+
+static cl::opt<bool> OptDumpConstraintGraphStats(
+    "dump-constraint-graph-stats",
+    cl::desc("Dump the degree distributions and largest components of the "
+             "constraint graphs, the atoms with the most edges and the "
+             "reasons with the most constraints"),
+    cl::init(false), cl::cat(_3CCategory));
+
 static cl::opt<bool> OptHandleVARARGS("handle-varargs",
                                       cl::desc("Enable handling of varargs "
                                                "in a "
@@ -227,6 +249,77 @@ static cl::opt<bool> OptAllowRewriteFailures(
              "affect common use cases."),
     cl::init(false), cl::cat(_3CCategory));
 
+static cl::opt<unsigned> OptParseThreads(
+    "j",
+    cl::desc("Parse the source files, and solve the independent components of "
+             "the constraint graphs, using N threads in parallel (0 uses one "
+             "thread per hardware thread). Constraints are still built on one "
+             "thread."),
+    cl::value_desc("N"), cl::init(1), cl::cat(_3CCategory));
+
+static cl::opt<bool> OptFirstCompileCommandOnly(
+    "first-compile-command-only",
+    cl::desc("When the compilation database has several compile commands for "
+             "a source file, for example because it is built for several "
+             "targets, parse the file only with the first of them."),
+    cl::init(false), cl::cat(_3CCategory));
+
+static cl::opt<std::string> OptTimeTrace(
+    "time-trace",
+    cl::desc("Write the time spent in each stage of 3C, and in each "
+             "translation unit within a stage, to this file in the Chrome "
+             "trace event format (see chrome://tracing)."),
+    cl::value_desc("filename"), cl::init(""), cl::cat(_3CCategory));
+
+static cl::opt<bool> OptServer(
+    "server",
+    cl::desc("After solving the constraints, keep the ASTs and constraints in "
+             "memory and answer JSON-RPC requests about root causes, one per "
+             "line on stdin, until a \"shutdown\" request. Files are only "
+             "written on a \"writeFiles\" request."),
+    cl::init(false), cl::cat(_3CCategory));
+
+static cl::list<std::string> OptSummary(
+    "3c-summary",
+    cl::desc("Load a 3C summary written by -write-3c-summary. The external "
+             "functions that are defined in the earlier run but only declared "
+             "in this one are constrained as in the summary instead of being "
+             "made WILD. May be repeated."),
+    cl::value_desc("filename"), cl::ZeroOrMore, cl::cat(_3CCategory));
+
+static cl::opt<std::string> OptWriteSummary(
+    "write-3c-summary",
+    cl::desc("After solving, write a 3C summary of the solution and bounds "
+             "of the parameters and returns of the external functions "
+             "defined in this run to this file, for use with -3c-summary."),
+    cl::value_desc("filename"), cl::init(""), cl::cat(_3CCategory));
+
+static cl::opt<std::string> OptSolutionOutput(
+    "solution-output",
+    cl::desc("After solving, write the solution and bounds of every pointer, "
+             "and the first root cause of every WILD pointer, to this file "
+             "in a compact binary format indexed by file and line, which "
+             "other tools can map into memory (see SolutionFile.h)."),
+    cl::value_desc("filename"), cl::init(""), cl::cat(_3CCategory));
+
+static cl::opt<std::string> OptLintAgainst(
+    "lint-against",
+    cl::desc("Instead of writing the converted files, compare the solution "
+             "against this solution file of an earlier run of the whole "
+             "program (see -solution-output), print the pointers that are "
+             "now WILD but were not WILD in it, with their root causes, and "
+             "exit with a non-zero status if there are any. Run on the "
+             "changed source files only, with the summary of the earlier run "
+             "(see -3c-summary)."),
+    cl::value_desc("filename"), cl::init(""), cl::cat(_3CCategory));
+
+static cl::list<std::string> OptPreviewFile(
+    "preview-file",
+    cl::desc("Instead of writing the converted files, print the new version "
+             "of this file to stdout. Only the translation units that contain "
+             "the file are rewritten. May be repeated."),
+    cl::value_desc("filename"), cl::ZeroOrMore, cl::cat(_3CCategory));
+
 #ifdef FIVE_C
 static cl::opt<bool> OptRemoveItypes(
     "remove-itypes",
@@ -239,6 +332,188 @@ static cl::opt<bool> OptForceItypes(
     cl::init(false), cl::cat(_3CCategory));
 #endif
 
+// JSON-RPC 2.0 error codes.
+enum ServerErrorCode {
+  SEC_ParseError = -32700,
+  SEC_InvalidRequest = -32600,
+  SEC_MethodNotFound = -32601,
+  SEC_InvalidParams = -32602,
+};
+
+static json::Value rootCauseToJson(_3CInterface &Interface,
+                                   ConstraintKey RootKey) {
+  json::Object Cause{{"key", static_cast<int64_t>(RootKey)}};
+  if (const Constraint *C = Interface.getRootCauseConstraint(RootKey)) {
+    Cause["reason"] = C->REASON.str();
+    const PersistentSourceLoc &PSL = C->getLocation();
+    if (PSL.valid())
+      Cause["location"] = PSL.toString();
+  }
+  return std::move(Cause);
+}
+
+static json::Value rootCausesToJson(_3CInterface &Interface,
+                                    const CVars &Roots) {
+  json::Array Causes;
+  for (ConstraintKey RootKey : Roots)
+    Causes.push_back(rootCauseToJson(Interface, RootKey));
+  return std::move(Causes);
+}
+
+// Answer one request. Returns false and sets Code and Message if the request
+// fails.
+static bool handleServerRequest(_3CInterface &Interface, StringRef Method,
+                                const json::Object *Params, json::Value &Result,
+                                int &Code, std::string &Message,
+                                bool &Shutdown) {
+  auto GetKey = [&](ConstraintKey &Key) {
+    Optional<int64_t> K = Params ? Params->getInteger("key") : None;
+    if (!K || *K < 0) {
+      Code = SEC_InvalidParams;
+      Message = "expected an integer \"key\" parameter";
+      return false;
+    }
+    Key = static_cast<ConstraintKey>(*K);
+    return true;
+  };
+
+  ConstraintKey Key;
+  if (Method == "rootCauses") {
+    if (!GetKey(Key))
+      return false;
+    Result = rootCausesToJson(Interface, Interface.getRootCauses(Key));
+  } else if (Method == "affectedPointers") {
+    if (!GetKey(Key))
+      return false;
+    json::Array Ptrs;
+    for (ConstraintKey PtrKey : Interface.getPtrsAffectedByRootCause(Key))
+      Ptrs.push_back(static_cast<int64_t>(PtrKey));
+    Result = std::move(Ptrs);
+  } else if (Method == "rootCausesInFile") {
+    Optional<StringRef> File = Params ? Params->getString("file") : None;
+    if (!File) {
+      Code = SEC_InvalidParams;
+      Message = "expected a string \"file\" parameter";
+      return false;
+    }
+    Result = rootCausesToJson(Interface, Interface.getRootCausesInFile(*File));
+  } else if (Method == "makeNonWild") {
+    if (!GetKey(Key))
+      return false;
+    Result = Interface.makeSinglePtrNonWild(Key);
+  } else if (Method == "invalidateRootCause") {
+    if (!GetKey(Key))
+      return false;
+    Result = Interface.invalidateWildReasonGlobally(Key);
+  } else if (Method == "previewFiles") {
+    const json::Array *Files = Params ? Params->getArray("files") : nullptr;
+    std::vector<std::string> FileNames;
+    if (Files)
+      for (const json::Value &File : *Files)
+        if (Optional<StringRef> Name = File.getAsString())
+          FileNames.push_back(Name->str());
+    if (!Files || FileNames.size() != Files->size()) {
+      Code = SEC_InvalidParams;
+      Message = "expected an array of strings \"files\" parameter";
+      return false;
+    }
+    std::map<std::string, std::string> NewContents;
+    if (!Interface.previewConvertedFiles(FileNames, NewContents)) {
+      Code = SEC_InvalidParams;
+      Message = "a file is not part of any translation unit";
+      return false;
+    }
+    json::Object Previews;
+    for (auto &FileAndContents : NewContents)
+      Previews[FileAndContents.first] = std::move(FileAndContents.second);
+    Result = std::move(Previews);
+  } else if (Method == "writeFiles") {
+    Result = Interface.writeAllConvertedFilesToDisk();
+  } else if (Method == "shutdown") {
+    Shutdown = true;
+    Result = nullptr;
+  } else {
+    Code = SEC_MethodNotFound;
+    Message = ("unknown method \"" + Method + "\"").str();
+    return false;
+  }
+  return true;
+}
+
+// Read the next line from stdin into Line, without the newline. Pending holds
+// the input that was read after the previous line. Stdin is read as far as
+// is available, so a client may wait for the response to each request
+// before sending the next one. Returns false at the end of the input.
+static bool readStdinLine(std::string &Pending, std::string &Line) {
+  size_t End;
+  while ((End = Pending.find('\n')) == std::string::npos) {
+    char Buf[4096];
+    Expected<size_t> Read =
+        sys::fs::readNativeFile(sys::fs::getStdinHandle(), Buf);
+    if (!Read) {
+      consumeError(Read.takeError());
+      return false;
+    }
+    if (*Read == 0) {
+      // A last line without a newline is still a line.
+      if (Pending.empty())
+        return false;
+      Line = std::move(Pending);
+      Pending.clear();
+      return true;
+    }
+    Pending.append(Buf, *Read);
+  }
+  Line = Pending.substr(0, End);
+  Pending.erase(0, End + 1);
+  return true;
+}
+
+// Read JSON-RPC 2.0 requests, one per line, from stdin and write one response
+// per line to stdout until a "shutdown" request or the end of the input. The
+// ASTs and the solved constraints stay in memory between requests, so only
+// the first request pays for parsing and solving, and a request that changes
+// the constraints only re-runs the solver.
+static void runServer(_3CInterface &Interface) {
+  // makeNonWild and invalidateRootCause report whether they changed the set
+  // of WILD pointers, which needs the set computed before the first change.
+  Interface.computeWildPtrsInfo();
+
+  bool Shutdown = false;
+  std::string Pending, Line;
+  while (!Shutdown && readStdinLine(Pending, Line)) {
+    if (StringRef(Line).trim().empty())
+      continue;
+    json::Object Response{{"jsonrpc", "2.0"}};
+    json::Value Result = nullptr;
+    int Code = 0;
+    std::string Message;
+    Expected<json::Value> Request = json::parse(Line);
+    const json::Object *Obj = Request ? Request->getAsObject() : nullptr;
+    if (!Request) {
+      Code = SEC_ParseError;
+      Message = toString(Request.takeError());
+    } else if (!Obj || !Obj->getString("method")) {
+      Code = SEC_InvalidRequest;
+      Message = "expected an object with a string \"method\"";
+    } else {
+      if (const json::Value *Id = Obj->get("id"))
+        Response["id"] = *Id;
+      handleServerRequest(Interface, *Obj->getString("method"),
+                          Obj->getObject("params"), Result, Code, Message,
+                          Shutdown);
+    }
+    if (!Response.get("id"))
+      Response["id"] = nullptr;
+    if (Code != 0)
+      Response["error"] = json::Object{{"code", Code}, {"message", Message}};
+    else
+      Response["result"] = std::move(Result);
+    outs() << json::Value(std::move(Response)) << "\n";
+    outs().flush();
+  }
+}
+
 int main(int argc, const char **argv) {
   sys::PrintStackTraceOnErrorSignal(argv[0]);
 
@@ -269,6 +544,20 @@ int main(int argc, const char **argv) {
     return 1;
   }
 
+  // Write the time trace, if one was requested, whichever way main returns.
+  struct TimeTraceWriter {
+    ~TimeTraceWriter() {
+      if (!timeTraceProfilerEnabled())
+        return;
+      if (auto E = timeTraceProfilerWrite(OptTimeTrace, "3c"))
+        errs() << "3c: Error writing the time trace: "
+               << toString(std::move(E)) << "\n";
+      timeTraceProfilerCleanup();
+    }
+  } TimeTrace;
+  if (!OptTimeTrace.empty())
+    timeTraceProfilerInitialize(/*TimeTraceGranularity=*/500, argv[0]);
+
   // Setup options.
   struct _3COptions CcOptions;
   CcOptions.BaseDir = OptBaseDir.getValue();
@@ -276,8 +565,11 @@ int main(int argc, const char **argv) {
   CcOptions.EnablePropThruIType = OptEnablePropThruIType;
   CcOptions.HandleVARARGS = OptHandleVARARGS;
   CcOptions.DumpStats = OptDumpStats;
+  CcOptions.DumpMemoryStats = OptDumpMemoryStats;
+  CcOptions.DumpConstraintGraphStats = OptDumpConstraintGraphStats;
   CcOptions.OutputPostfix = OptOutputPostfix.getValue();
   CcOptions.OutputDir = OptOutputDir.getValue();
+  CcOptions.OutputPatch = OptOutputPatch.getValue();
   CcOptions.Verbose = OptVerbose;
   CcOptions.DumpIntermediate = OptDumpIntermediate;
   CcOptions.ConstraintOutputJson = OptConstraintOutputJson.getValue();
@@ -292,6 +584,13 @@ int main(int argc, const char **argv) {
   CcOptions.DumpUnwritableChanges = OptDumpUnwritableChanges;
   CcOptions.AllowUnwritableChanges = OptAllowUnwritableChanges;
   CcOptions.AllowRewriteFailures = OptAllowRewriteFailures;
+  CcOptions.ParseThreads = OptParseThreads;
+  CcOptions.FirstCompileCommandOnly = OptFirstCompileCommandOnly;
+  CcOptions.SolveThreads = OptParseThreads;
+  CcOptions.SummaryFiles =
+      std::vector<std::string>(OptSummary.begin(), OptSummary.end());
+  CcOptions.SummaryOutput = OptWriteSummary.getValue();
+  CcOptions.SolutionOutput = OptSolutionOutput.getValue();
 
 #ifdef FIVE_C
   CcOptions.RemoveItypes = OptRemoveItypes;
@@ -371,6 +670,62 @@ int main(int argc, const char **argv) {
     return _3CInterface.determineExitCode();
   }
 
+  if (OptServer) {
+    if (OptVerbose)
+      errs() << "Finished solving constraints. Waiting for requests.\n";
+    runServer(_3CInterface);
+    return _3CInterface.determineExitCode();
+  }
+
+  if (!OptLintAgainst.empty()) {
+    std::string Error;
+    std::unique_ptr<SolutionFile> Baseline =
+        SolutionFile::open(OptLintAgainst, Error);
+    if (!Baseline) {
+      errs() << "3c: Error: Failed to open the solution file \""
+             << OptLintAgainst << "\": " << Error << "\n";
+      _3CInterface.determineExitCode();
+      return 1;
+    }
+    std::vector<SolutionFile::NewWildPtr> NewWild =
+        _3CInterface.findNewWildPtrs(*Baseline);
+    for (const auto &New : NewWild) {
+      outs() << New.Loc.getFileName() << ":" << New.Loc.getLineNo() << ":"
+             << New.Loc.getColSNo() << ": new WILD pointer";
+      if (!New.RootCauseReason.empty()) {
+        outs() << ": " << New.RootCauseReason;
+        if (New.RootCauseLoc.valid())
+          outs() << " (" << New.RootCauseLoc.getFileName() << ":"
+                 << New.RootCauseLoc.getLineNo() << ")";
+      }
+      if (New.NumRootCauses > 1)
+        outs() << " [" << New.NumRootCauses << " root causes]";
+      outs() << "\n";
+    }
+    if (OptVerbose)
+      errs() << NewWild.size() << " new WILD pointers.\n";
+    int ExitCode = _3CInterface.determineExitCode();
+    return ExitCode != 0 || NewWild.empty() ? ExitCode : 1;
+  }
+
+  if (!OptPreviewFile.empty()) {
+    std::vector<std::string> FileNames(OptPreviewFile.begin(),
+                                       OptPreviewFile.end());
+    std::map<std::string, std::string> NewContents;
+    if (!_3CInterface.previewConvertedFiles(FileNames, NewContents)) {
+      errs() << "Failure occurred while trying to preview the converted "
+                "files. Exiting.\n";
+      _3CInterface.determineExitCode();
+      return 1;
+    }
+    for (const auto &FileAndContents : NewContents) {
+      if (NewContents.size() > 1)
+        outs() << "=== New version of " << FileAndContents.first << " ===\n";
+      outs() << FileAndContents.second;
+    }
+    return _3CInterface.determineExitCode();
+  }
+
   if (OptVerbose) {
     errs() << "Finished solving constraints.\n";
     errs() << "Trying to rewrite the converted files back.\n";
@@ -0,0 +1,324 @@
+#!/usr/bin/env python
+#
+#===- 3c-bench.py - 3C end-to-end scaling benchmark ---------*- python -*-===#
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+#===------------------------------------------------------------------------===#
+
+"""
+This script runs 3c over programs of increasing size and records, for each
+run, the wall time and peak memory of 3c along with the statistics that 3c
+writes with -dump-stats: the time of each phase (PerformanceStats), the
+constraint and pointer counts (Summary) and the solver statistics. The
+programs are generated along one axis at a time:
+
+  multi-tu    translation units that pass pointers to each other's functions
+              through a shared header
+  pointers    pointer variables, assignments and calls in one file
+  arrays      malloc'ed buffers indexed in loops, for array bounds inference
+  structs     structs with pointer fields that are linked together
+
+Real programs can be added with -corpus DIR, where DIR contains the
+compile_commands.json of a build of the program. Every source file of the
+compilation database is converted in one run.
+
+For each generated axis, the growth of the time with the size of the program
+is estimated as the exponent k of time ~ size^k between the smallest and the
+largest size, after subtracting the time taken to convert an empty file. The
+script exits with a non-zero status if any exponent exceeds -max-exponent.
+The report is written to results.json. With -compare OLD.json, the times and
+memory of each run are also printed relative to an earlier report, e.g. one
+written by another version of 3c. Example usage:
+
+  3c-bench.py -3c build/bin/3c -axis multi-tu -sizes 10,100,1000
+"""
+from __future__ import absolute_import, division, print_function
+
+import argparse
+import json
+import math
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def gen_multi_tu(n):
+  # One header declares a function per translation unit. Each unit calls the
+  # function of the next unit, so the constraints of all the units are
+  # connected.
+  header = ['#include <stdlib.h>']
+  for i in range(n):
+    header.append('int *f%d(int *p, int **q, int len);' % i)
+  header.append('extern int *g_shared;')
+  files = {'common.h': '\n'.join(header) + '\n'}
+  for i in range(n):
+    lines = ['#include "common.h"']
+    if i == 0:
+      lines.append('int *g_shared;')
+    lines.append('static int *helper%d(int *p) { return p + 1; }' % i)
+    lines.append('int *f%d(int *p, int **q, int len) {' % i)
+    lines.append('  int *r = helper%d(p);' % i)
+    lines.append('  *q = r;')
+    lines.append('  if (len > 0)')
+    lines.append('    return f%d(r, q, len - 1);' % ((i + 1) % n))
+    if i % 7 == 3:
+      # An occasional cast makes a few pointers WILD, as in real code.
+      lines.append('  g_shared = (int *)(long)len;')
+    lines.append('  return g_shared;')
+    lines.append('}')
+    files['tu%d.c' % i] = '\n'.join(lines) + '\n'
+  return files
+
+
+def gen_pointers(n):
+  lines = ['int *id(int *p) { return p; }',
+           'void f(int *a, int **b) {']
+  for i in range(n):
+    lines.append('  int *p%d = %s;' % (i, 'a' if i == 0 else 'p%d' % (i - 1)))
+  for i in range(n):
+    lines.append('  p%d = id(p%d);' % (i, (i * 7 + 3) % n))
+    if i % 5 == 0:
+      lines.append('  *b = p%d;' % i)
+  lines.append('}')
+  return {'pointers.c': '\n'.join(lines) + '\n'}
+
+
+def gen_arrays(n):
+  lines = ['#include <stdlib.h>']
+  for i in range(n):
+    lines.append('int sum%d(int *a, int len) {' % i)
+    lines.append('  int s = 0;')
+    lines.append('  for (int i = 0; i < len; i++)')
+    lines.append('    s += a[i];')
+    lines.append('  return s;')
+    lines.append('}')
+  lines.append('int f(int len) {')
+  lines.append('  int t = 0;')
+  for i in range(n):
+    lines.append('  int *b%d = malloc(len * sizeof(int));' % i)
+    lines.append('  t += sum%d(b%d, len);' % (i, i))
+  lines.append('  return t;')
+  lines.append('}')
+  return {'arrays.c': '\n'.join(lines) + '\n'}
+
+
+def gen_structs(n):
+  lines = []
+  for i in range(n):
+    # Each struct also links to the struct declared before it.
+    lines.append('struct s%d { int *data; struct s%d *next; '
+                 'struct s%d *link; };' % (i, i, max(i - 1, 0)))
+  lines.append('void f(int *p) {')
+  for i in range(n):
+    lines.append('  struct s%d v%d;' % (i, i))
+    lines.append('  v%d.data = p;' % i)
+    lines.append('  v%d.next = &v%d;' % (i, i))
+    lines.append('  p = v%d.data;' % i)
+  lines.append('}')
+  return {'structs.c': '\n'.join(lines) + '\n'}
+
+
+GENERATORS = {
+  'multi-tu': gen_multi_tu,
+  'pointers': gen_pointers,
+  'arrays': gen_arrays,
+  'structs': gen_structs,
+}
+
+
+def write_program(directory, files):
+  if os.path.isdir(directory):
+    shutil.rmtree(directory)
+  os.makedirs(directory)
+  sources = []
+  for name, text in sorted(files.items()):
+    path = os.path.join(directory, name)
+    with open(path, 'w') as f:
+      f.write(text)
+    if name.endswith('.c'):
+      sources.append(path)
+  return sources
+
+
+def run_3c(tool, args, base_dir, output_dir):
+  """Run 3c and return its wall time, peak memory in KiB and statistics."""
+  stats = os.path.join(output_dir, 'stats.json')
+  if os.path.isdir(output_dir):
+    shutil.rmtree(output_dir)
+  os.makedirs(output_dir)
+  command = [tool, '-alltypes', '-dump-stats', '-stats-output=' + stats,
+             '-wildptrstats-output=' + os.path.join(output_dir, 'wild.json'),
+             '-perptrstats-output=' + os.path.join(output_dir, 'perptr.json'),
+             '-base-dir=' + base_dir,
+             '-output-dir=' + os.path.join(output_dir, 'out')] + args
+  with tempfile.TemporaryFile() as err:
+    start = time.time()
+    proc = subprocess.Popen(command, stdout=subprocess.DEVNULL, stderr=err)
+    # Wait with os.wait4 rather than proc.wait() to get the peak memory of
+    # this run alone.
+    _, status, rusage = os.wait4(proc.pid, 0)
+    elapsed = time.time() - start
+    proc.returncode = 0
+    if not os.WIFEXITED(status) or os.WEXITSTATUS(status) != 0:
+      err.seek(0)
+      raise RuntimeError('3c failed on %s:\n%s' %
+                         (base_dir, err.read().decode('utf-8', 'replace')))
+  result = {'time': elapsed, 'rss_kib': rusage.ru_maxrss}
+  result.update(read_stats(stats))
+  return result
+
+
+def read_stats(path):
+  """Extract the summary, phase times and solver statistics of 3c."""
+  if not os.path.exists(path):
+    return {}
+  with open(path) as f:
+    stats = json.load(f)['Stats']
+  result = {'summary': stats['ConstraintStats']['Summary']}
+  # PerformanceStats is a list of single entry objects.
+  for entry in stats['PerformanceStats']:
+    for key, value in entry.items():
+      result[key] = value
+  return result
+
+
+def measure(tool, args, base_dir, output_dir, repeat):
+  runs = [run_3c(tool, args, base_dir, output_dir) for _ in range(repeat)]
+  return min(runs, key=lambda r: r['time'])
+
+
+def exponent(results, baseline):
+  first, last = results[0], results[-1]
+  t0 = first['time'] - baseline
+  t1 = last['time'] - baseline
+  # Times around the resolution of the clock don't tell anything about the
+  # growth rate.
+  if t0 <= 1e-3 or t1 <= 1e-3 or last['size'] == first['size']:
+    return None
+  return math.log(t1 / t0) / math.log(last['size'] / first['size'])
+
+
+def print_result(name, size, result, old):
+  line = '%-11s %6s  %8.3fs %8d KiB' % (name, size, result['time'],
+                                         result['rss_kib'])
+  summary = result.get('summary')
+  if summary:
+    line += '  %8d constraints' % summary['TotalConstraints']
+  if old:
+    line += '  (time x%.2f, memory x%.2f)' % (
+        result['time'] / max(old['time'], 1e-6),
+        result['rss_kib'] / max(old['rss_kib'], 1))
+  print(line)
+
+
+def find_old(report, axis, size):
+  if not report:
+    return None
+  for result in report.get('axes', {}).get(axis, {}).get('results', []):
+    if result['size'] == size:
+      return result
+  return None
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+                                   formatter_class=
+                                           argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('-3c', dest='tool', default='3c',
+                      help='the 3c to benchmark (default: 3c on PATH)')
+  parser.add_argument('-axis', action='append', choices=sorted(GENERATORS),
+                      help='benchmark only this axis (may be repeated)')
+  parser.add_argument('-sizes', default='25,50,100,200',
+                      help='comma separated program sizes along each axis '
+                      '(default: %(default)s)')
+  parser.add_argument('-corpus', action='append', default=[],
+                      help='also convert the program whose '
+                      'compile_commands.json is in this directory (may be '
+                      'repeated)')
+  parser.add_argument('-repeat', type=int, default=1,
+                      help='run 3c this many times on each program and keep '
+                      'the fastest run (default: %(default)s)')
+  parser.add_argument('-max-exponent', type=float, default=1.5,
+                      help='fail if time grows faster than size^N '
+                      '(default: %(default)s)')
+  parser.add_argument('-compare', default=None,
+                      help='print the results relative to this earlier '
+                      'results.json')
+  parser.add_argument('-output-dir', default=None,
+                      help='keep the generated programs and write '
+                      'results.json to this directory')
+  args = parser.parse_args()
+
+  sizes = sorted(int(s) for s in args.sizes.split(','))
+  axes = args.axis or sorted(GENERATORS)
+  workdir = args.output_dir or tempfile.mkdtemp(prefix='3c-bench-')
+  if not os.path.isdir(workdir):
+    os.makedirs(workdir)
+  old_report = None
+  if args.compare:
+    with open(args.compare) as f:
+      old_report = json.load(f)
+
+  version = subprocess.check_output([args.tool, '--version'],
+                                    universal_newlines=True)
+
+  empty_dir = os.path.join(workdir, 'empty')
+  empty = write_program(empty_dir, {'empty.c': '\n'})
+  base = measure(args.tool, empty + ['--'], empty_dir,
+                 empty_dir + '.3c', args.repeat)
+  baseline = base['time']
+
+  report = {'version': version.strip(), 'baseline_time': baseline,
+            'axes': {}, 'corpus': {}}
+  failed = False
+  for axis in axes:
+    results = []
+    for size in sizes:
+      program = os.path.join(workdir, '%s-%d' % (axis, size))
+      sources = write_program(program, GENERATORS[axis](size))
+      result = measure(args.tool, sources + ['--'], program,
+                       program + '.3c', args.repeat)
+      result['size'] = size
+      results.append(result)
+      print_result(axis, size, result, find_old(old_report, axis, size))
+    k = exponent(results, baseline)
+    report['axes'][axis] = {'results': results, 'exponent': k}
+    if k is None:
+      print('%-11s growth: too fast to measure' % axis)
+    else:
+      superlinear = k > args.max_exponent
+      failed = failed or superlinear
+      print('%-11s growth: size^%.2f%s' %
+            (axis, k, '  (exceeds %.2f)' % args.max_exponent
+                      if superlinear else ''))
+
+  for corpus in args.corpus:
+    corpus = os.path.abspath(corpus)
+    with open(os.path.join(corpus, 'compile_commands.json')) as f:
+      entries = json.load(f)
+    sources = sorted(set(os.path.normpath(os.path.join(e['directory'],
+                                                       e['file']))
+                         for e in entries))
+    base_dir = os.path.commonpath([os.path.dirname(s) for s in sources])
+    name = os.path.basename(corpus)
+    result = measure(args.tool, ['-p', corpus] + sources, base_dir,
+                     os.path.join(workdir, 'corpus-%s.3c' % name), args.repeat)
+    result['files'] = len(sources)
+    report['corpus'][corpus] = result
+    old = old_report.get('corpus', {}).get(corpus) if old_report else None
+    print_result(name, len(sources), result, old)
+
+  with open(os.path.join(workdir, 'results.json'), 'w') as f:
+    json.dump(report, f, indent=2, sort_keys=True)
+  print('results written to %s' % os.path.join(workdir, 'results.json'))
+  return 1 if failed else 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
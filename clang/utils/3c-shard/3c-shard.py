@@ -0,0 +1,250 @@
+#!/usr/bin/env python
+#
+#===- 3c-shard.py - Convert a program with 3C in shards -------*- python -*-===#
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+#===------------------------------------------------------------------------===#
+
+"""
+This script converts a program that is too large for one 3c run by splitting
+its compilation database into shards and running 3c on each shard separately,
+so that no run holds the ASTs and constraints of the whole program.
+
+The shards exchange 3C summaries (see -write-3c-summary and -3c-summary in
+clang/tools/3c/README.md). In each round, every shard is converted with the
+summaries that the other shards wrote in the previous round, so the external
+functions that a shard only declares are constrained as they were solved by
+the shard that defines them. The rounds are repeated until no summary
+changes, or until -max-rounds. The files rewritten by the shards in the last
+round are then merged into the output directory. A file that is rewritten
+differently by two shards, such as a header included by both, is reported
+as a conflict and the script exits with a non-zero status.
+
+Summaries only carry the parameters and returns of external functions, so
+the solution can be less precise than that of a single run: for example,
+the constraints on global variables and struct fields are not shared
+between shards.
+
+The shards of a round are independent and are run -jobs at a time. To run
+them on other machines, pass a -launcher command (for example a job
+scheduler's "run" command), which is prepended to each 3c command; the work
+directory must then be on a file system that is shared with those machines.
+Example usage:
+
+  3c-shard.py -3c build/bin/3c -p project/build -base-dir project \\
+      -shards 8 -output-dir project.checked -- -alltypes
+"""
+from __future__ import absolute_import, division, print_function
+
+import argparse
+import filecmp
+import json
+import os
+import shlex
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+
+
+def read_entries(build_dir):
+  with open(os.path.join(build_dir, 'compile_commands.json')) as f:
+    entries = json.load(f)
+  files = {}
+  for entry in entries:
+    path = os.path.normpath(os.path.join(entry['directory'], entry['file']))
+    files.setdefault(path, []).append(entry)
+  return files
+
+
+def partition(files, num_shards):
+  """Split the source files into shards of about the same total size."""
+  shards = [[] for _ in range(min(num_shards, len(files)))]
+  sizes = [0] * len(shards)
+
+  def file_size(path):
+    try:
+      return os.path.getsize(path)
+    except OSError:
+      return 0
+
+  # Place the largest files first, each in the shard that is smallest so far.
+  for path in sorted(files, key=lambda p: (-file_size(p), p)):
+    i = sizes.index(min(sizes))
+    shards[i].append(path)
+    sizes[i] += file_size(path)
+  return [sorted(s) for s in shards]
+
+
+class Shard(object):
+  def __init__(self, index, sources, work_dir):
+    self.index = index
+    self.sources = sources
+    self.dir = os.path.join(work_dir, 'shard-%d' % index)
+
+  def summary(self, round_num):
+    return os.path.join(self.dir, 'summary-%d.json' % round_num)
+
+  def output_dir(self, round_num):
+    return os.path.join(self.dir, 'out-%d' % round_num)
+
+  def log(self, round_num):
+    return os.path.join(self.dir, 'log-%d.txt' % round_num)
+
+
+def run_shard(args, shard, shards, round_num):
+  """Convert one shard in round round_num. Returns True on success."""
+  out_dir = shard.output_dir(round_num)
+  if os.path.isdir(out_dir):
+    shutil.rmtree(out_dir)
+  command = shlex.split(args.launcher) if args.launcher else []
+  command += [args.tool, '-p', shard.dir, '-base-dir=' + args.base_dir,
+              '-output-dir=' + out_dir,
+              '-write-3c-summary=' + shard.summary(round_num)]
+  if round_num > 0:
+    command += ['-3c-summary=' + other.summary(round_num - 1)
+                for other in shards if other is not shard]
+  command += args.extra + shard.sources
+  with open(shard.log(round_num), 'w') as log:
+    status = subprocess.call(command, stdout=log, stderr=subprocess.STDOUT)
+  return status == 0
+
+
+def run_round(args, shards, round_num):
+  """Convert all shards, -jobs at a time. Returns the shards that failed."""
+  failed = []
+  pending = list(shards)
+  lock = threading.Lock()
+
+  def worker():
+    while True:
+      with lock:
+        if not pending:
+          return
+        shard = pending.pop(0)
+      if not run_shard(args, shard, shards, round_num):
+        with lock:
+          failed.append(shard)
+
+  threads = [threading.Thread(target=worker) for _ in range(args.jobs)]
+  for t in threads:
+    t.start()
+  for t in threads:
+    t.join()
+  return sorted(failed, key=lambda s: s.index)
+
+
+def summaries_changed(shards, round_num):
+  if round_num == 0:
+    return True
+  return any(not filecmp.cmp(s.summary(round_num), s.summary(round_num - 1),
+                             shallow=False)
+             for s in shards)
+
+
+def merge_outputs(shards, round_num, output_dir):
+  """Copy the files written by the shards to output_dir. Returns the files
+  that two shards rewrote differently."""
+  owners = {}
+  conflicts = set()
+  for shard in shards:
+    shard_out = shard.output_dir(round_num)
+    for root, _, names in os.walk(shard_out):
+      for name in names:
+        path = os.path.join(root, name)
+        rel = os.path.relpath(path, shard_out)
+        if rel in owners:
+          if not filecmp.cmp(owners[rel], path, shallow=False):
+            conflicts.add(rel)
+          continue
+        owners[rel] = path
+  for rel, path in sorted(owners.items()):
+    dest = os.path.join(output_dir, rel)
+    if not os.path.isdir(os.path.dirname(dest)):
+      os.makedirs(os.path.dirname(dest))
+    shutil.copyfile(path, dest)
+  return sorted(conflicts)
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+                                   formatter_class=
+                                           argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('-3c', dest='tool', default='3c',
+                      help='the 3c to run (default: 3c on PATH)')
+  parser.add_argument('-p', dest='build_dir', required=True,
+                      help='the directory that contains the '
+                      'compile_commands.json of the program')
+  parser.add_argument('-base-dir', required=True,
+                      help='the 3C base directory of the program')
+  parser.add_argument('-output-dir', required=True,
+                      help='write the converted files to this directory')
+  parser.add_argument('-shards', type=int, default=4,
+                      help='the number of shards (default: %(default)s)')
+  parser.add_argument('-jobs', type=int, default=1,
+                      help='run this many shards at a time '
+                      '(default: %(default)s)')
+  parser.add_argument('-launcher', default=None,
+                      help='a command to prepend to each 3c command, to run '
+                      'the shards on other machines')
+  parser.add_argument('-max-rounds', type=int, default=4,
+                      help='stop after this many rounds even if the '
+                      'summaries are still changing (default: %(default)s)')
+  parser.add_argument('-work-dir', default=None,
+                      help='keep the shards, summaries and logs in this '
+                      'directory')
+  parser.add_argument('extra', nargs='*',
+                      help='options passed to each 3c run, after --')
+  args = parser.parse_args()
+  args.base_dir = os.path.abspath(args.base_dir)
+  if args.shards < 1 or args.jobs < 1 or args.max_rounds < 1:
+    parser.error('-shards, -jobs and -max-rounds must be positive')
+
+  files = read_entries(args.build_dir)
+  if not files:
+    print('error: no source files in %s' % args.build_dir, file=sys.stderr)
+    return 1
+  work_dir = os.path.abspath(args.work_dir or
+                             tempfile.mkdtemp(prefix='3c-shard-'))
+  shards = [Shard(i, sources, work_dir)
+            for i, sources in enumerate(partition(files, args.shards))]
+  for shard in shards:
+    if not os.path.isdir(shard.dir):
+      os.makedirs(shard.dir)
+    with open(os.path.join(shard.dir, 'compile_commands.json'), 'w') as f:
+      json.dump([e for path in shard.sources for e in files[path]], f,
+                indent=2)
+
+  round_num = 0
+  while True:
+    print('round %d: converting %d shards' % (round_num, len(shards)))
+    failed = run_round(args, shards, round_num)
+    if failed:
+      for shard in failed:
+        print('error: shard %d failed; see %s' %
+              (shard.index, shard.log(round_num)), file=sys.stderr)
+      return 1
+    if not summaries_changed(shards, round_num):
+      print('round %d: the summaries did not change' % round_num)
+      break
+    if round_num + 1 == args.max_rounds:
+      print('warning: the summaries were still changing after %d rounds' %
+            args.max_rounds, file=sys.stderr)
+      break
+    round_num += 1
+
+  conflicts = merge_outputs(shards, round_num, args.output_dir)
+  for rel in conflicts:
+    print('error: %s was rewritten differently by two shards; the version '
+          'from the first shard was kept' % rel, file=sys.stderr)
+  print('converted files written to %s (work directory: %s)' %
+        (args.output_dir, work_dir))
+  return 1 if conflicts else 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,101 @@
+#!/usr/bin/env python
+#
+#===- checkedc-check-profile.py - Rank Checked C dynamic checks -*- python -*-===#
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+#===------------------------------------------------------------------------===#
+
+"""
+This script reads the dynamic check counts that a program compiled with
+-fcheckedc-dynamic-check-profile (or -fcheckedc-dynamic-check-mode=count)
+prints to stderr when it exits, sums the counts of each check over all the
+inputs and prints the checks ranked by how often they were executed, together
+with the source line of each check. Example usage:
+
+  ./prog 2> run1.txt
+  ./prog other-input 2> run2.txt
+  checkedc-check-profile.py run1.txt run2.txt -top 20
+"""
+from __future__ import absolute_import, division, print_function
+
+import argparse
+import re
+import sys
+
+COUNT_LINE = re.compile(r'^(?P<file>.*):(?P<line>\d+):(?P<column>\d+): '
+                        r'(?P<kind>.+) check executed (?P<executions>\d+) '
+                        r'times, failed (?P<failures>\d+) times$')
+
+
+def read_counts(stream, counts):
+  for text in stream:
+    match = COUNT_LINE.match(text.rstrip('\r\n'))
+    if not match:
+      continue
+    site = (match.group('file'), int(match.group('line')),
+            int(match.group('column')), match.group('kind'))
+    executions, failures = counts.get(site, (0, 0))
+    counts[site] = (executions + int(match.group('executions')),
+                    failures + int(match.group('failures')))
+
+
+def source_line(filename, line, cache):
+  if filename not in cache:
+    try:
+      with open(filename) as f:
+        cache[filename] = f.read().splitlines()
+    except (IOError, OSError):
+      cache[filename] = None
+  lines = cache[filename]
+  if lines is None or line < 1 or line > len(lines):
+    return None
+  return lines[line - 1].strip()
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+                                   formatter_class=
+                                           argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('files', metavar='FILE', nargs='*',
+                      help='check counts printed by a program (default: '
+                      'read from stdin)')
+  parser.add_argument('-top', metavar='N', type=int, default=0,
+                      help='print only the N highest ranked checks')
+  parser.add_argument('-sort', choices=['executions', 'failures'],
+                      default='executions',
+                      help='rank the checks by their number of executions '
+                      '(default) or failures')
+  parser.add_argument('-no-source', action='store_true', default=False,
+                      help='do not print the source line of each check')
+  args = parser.parse_args()
+
+  counts = {}
+  if args.files:
+    for filename in args.files:
+      with open(filename) as f:
+        read_counts(f, counts)
+  else:
+    read_counts(sys.stdin, counts)
+
+  key = 0 if args.sort == 'executions' else 1
+  sites = sorted(counts.items(), key=lambda item: (-item[1][key], item[0]))
+  if args.top > 0:
+    sites = sites[:args.top]
+
+  total = sum(count[key] for count in counts.values())
+  cache = {}
+  for (filename, line, column, kind), (executions, failures) in sites:
+    share = 100.0 * (executions, failures)[key] / total if total else 0.0
+    print('%s:%d:%d: %s check: %d executions, %d failures (%.1f%%)' %
+          (filename, line, column, kind, executions, failures, share))
+    if not args.no_source:
+      text = source_line(filename, line, cache)
+      if text is not None:
+        print('    %s' % text)
+
+
+if __name__ == '__main__':
+  main()
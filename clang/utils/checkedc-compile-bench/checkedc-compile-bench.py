@@ -0,0 +1,245 @@
+#!/usr/bin/env python
+#
+#===- checkedc-compile-bench.py - Checked C compile benchmark -*- python -*-===#
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+#===------------------------------------------------------------------------===#
+
+"""
+This script generates synthetic Checked C programs that grow along one axis
+at a time, compiles each of them with clang and records the time and peak
+memory used by semantic analysis (-fsyntax-only) and by code generation
+(-emit-llvm minus -fsyntax-only). The axes are:
+
+  array-ptrs  _Array_ptr variables with count bounds in one function
+  where       _Where clauses in one function
+  cfg         nested if/else statements in one function
+  nt-loops    loops that widen the bounds of _Nt_array_ptr variables
+  generics    calls to _For_any functions
+  facts       if statements whose conditions give comparison facts
+
+For each axis, the growth of the time with the size of the program is
+estimated as the exponent k of time ~ size^k between the smallest and the
+largest size, after subtracting the time taken to compile an empty file. The
+script exits with a non-zero status if any exponent exceeds -max-exponent,
+so it can be used to catch superlinear compile-time regressions. Example
+usage:
+
+  checkedc-compile-bench.py -clang build/bin/clang -axis cfg -axis where
+"""
+from __future__ import absolute_import, division, print_function
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def gen_array_ptrs(n):
+  lines = ['void f(_Array_ptr<int> a : count(len), int len) {']
+  for i in range(n):
+    lines.append('  _Array_ptr<int> p%d : count(len) = a;' % i)
+  for i in range(n):
+    lines.append('  if (len > %d) p%d[%d] = p%d[0] + 1;' %
+                 (i, i, i, (i + 1) % n))
+  lines.append('}')
+  return '\n'.join(lines) + '\n'
+
+
+def gen_where(n):
+  lines = ['void f(_Array_ptr<int> a : count(len), int len) {',
+           '  _Array_ptr<int> p : count(len) = a;',
+           '  int x = 0;']
+  for i in range(n):
+    lines.append('  x = x + %d _Where p : bounds(p, p + len);' % i)
+  lines.append('}')
+  return '\n'.join(lines) + '\n'
+
+
+def gen_cfg(n):
+  lines = ['int f(_Array_ptr<int> a : count(len), int len, int c) {',
+           '  int x = 0;']
+  indent = '  '
+  for i in range(n):
+    lines.append('%sif (c > %d) {' % (indent, i))
+    lines.append('%s  x += a[%d %% len];' % (indent, i))
+    lines.append('%s} else {' % indent)
+    lines.append('%s  x -= a[0];' % indent)
+    indent += '  '
+  for i in range(n):
+    indent = indent[:-2]
+    lines.append('%s}' % indent)
+  lines.append('  return x;')
+  lines.append('}')
+  return '\n'.join(lines) + '\n'
+
+
+def gen_nt_loops(n):
+  params = ', '.join('_Nt_array_ptr<char> s%d : count(0)' % i
+                     for i in range(n))
+  lines = ['int f(%s) {' % params, '  int x = 0;']
+  for i in range(n):
+    lines.append('  for (_Nt_array_ptr<char> p%d : count(0) = s%d; *p%d; '
+                 'x++) {' % (i, i, i))
+    lines.append('    if (*(p%d + 1)) x++;' % i)
+    lines.append('    break;')
+    lines.append('  }')
+  lines.append('  return x;')
+  lines.append('}')
+  return '\n'.join(lines) + '\n'
+
+
+def gen_facts(n):
+  # The same few comparisons are tested over and over again, and the variables
+  # they use are modified in between, as in the tests of
+  # -fdump-extracted-comparison-facts.
+  lines = ['int f(_Array_ptr<int> a : count(len), int len, int i, int j) {',
+           '  int x = 0;']
+  for k in range(n):
+    lines.append('  if (i < len && j >= %d && i <= j) {' % (k % 8))
+    lines.append('    x += a[i];')
+    lines.append('    if (j < len) x += a[j];')
+    lines.append('  }')
+    if k % 4 == 3:
+      lines.append('  i = x % len;')
+  lines.append('  return x;')
+  lines.append('}')
+  return '\n'.join(lines) + '\n'
+
+
+def gen_generics(n):
+  lines = ['_For_any(T) _Ptr<T> id(_Ptr<T> x) { return x; }',
+           '_For_any(T, U) _Ptr<T> first(_Ptr<T> x, _Ptr<U> y) { return x; }']
+  lines.append('void f(_Ptr<int> p, _Ptr<char> q) {')
+  for i in range(n):
+    if i % 2:
+      lines.append('  _Ptr<int> r%d = first<int, char>(p, q);' % i)
+    else:
+      lines.append('  _Ptr<char> r%d = id<char>(q);' % i)
+  lines.append('}')
+  return '\n'.join(lines) + '\n'
+
+
+GENERATORS = {
+  'array-ptrs': gen_array_ptrs,
+  'where': gen_where,
+  'cfg': gen_cfg,
+  'nt-loops': gen_nt_loops,
+  'generics': gen_generics,
+  'facts': gen_facts,
+}
+
+
+def run_clang(clang, args, source):
+  """Compile source and return (seconds, peak memory in KiB)."""
+  with tempfile.TemporaryFile() as err:
+    start = time.time()
+    proc = subprocess.Popen([clang, '-fcheckedc-extension', '-w'] + args +
+                            [source], stdout=subprocess.DEVNULL, stderr=err)
+    # Wait with os.wait4 rather than proc.wait() to get the peak memory of
+    # this compile alone.
+    _, status, rusage = os.wait4(proc.pid, 0)
+    elapsed = time.time() - start
+    proc.returncode = 0
+    if not os.WIFEXITED(status) or os.WEXITSTATUS(status) != 0:
+      err.seek(0)
+      raise RuntimeError('clang failed on %s:\n%s' %
+                         (source, err.read().decode('utf-8', 'replace')))
+  return elapsed, rusage.ru_maxrss
+
+
+def measure(clang, source, repeat):
+  sema = min(run_clang(clang, ['-fsyntax-only'], source)
+             for _ in range(repeat))
+  full = min(run_clang(clang, ['-S', '-emit-llvm', '-o', os.devnull], source)
+             for _ in range(repeat))
+  return {'sema_time': sema[0], 'sema_rss_kib': sema[1],
+          'codegen_time': max(full[0] - sema[0], 0.0),
+          'codegen_rss_kib': full[1]}
+
+
+def exponent(results, baseline):
+  first, last = results[0], results[-1]
+  t0 = first['sema_time'] + first['codegen_time'] - baseline
+  t1 = last['sema_time'] + last['codegen_time'] - baseline
+  # Times around the resolution of the clock don't tell anything about the
+  # growth rate.
+  if t0 <= 1e-3 or t1 <= 1e-3 or last['size'] == first['size']:
+    return None
+  return math.log(t1 / t0) / math.log(last['size'] / first['size'])
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+                                   formatter_class=
+                                           argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('-clang', default='clang',
+                      help='the clang to benchmark (default: clang on PATH)')
+  parser.add_argument('-axis', action='append', choices=sorted(GENERATORS),
+                      help='benchmark only this axis (may be repeated)')
+  parser.add_argument('-sizes', default='50,100,200,400',
+                      help='comma separated program sizes along each axis '
+                      '(default: %(default)s)')
+  parser.add_argument('-repeat', type=int, default=3,
+                      help='compile each program this many times and keep '
+                      'the fastest run (default: %(default)s)')
+  parser.add_argument('-max-exponent', type=float, default=1.5,
+                      help='fail if time grows faster than size^N '
+                      '(default: %(default)s)')
+  parser.add_argument('-output-dir', default=None,
+                      help='keep the generated programs and write '
+                      'results.json to this directory')
+  args = parser.parse_args()
+
+  sizes = sorted(int(s) for s in args.sizes.split(','))
+  axes = args.axis or sorted(GENERATORS)
+  workdir = args.output_dir or tempfile.mkdtemp(prefix='checkedc-bench-')
+  if not os.path.isdir(workdir):
+    os.makedirs(workdir)
+
+  empty = os.path.join(workdir, 'empty.c')
+  with open(empty, 'w') as f:
+    f.write('\n')
+  base = measure(args.clang, empty, args.repeat)
+  baseline = base['sema_time'] + base['codegen_time']
+
+  report = {'baseline_time': baseline, 'axes': {}}
+  failed = False
+  for axis in axes:
+    results = []
+    for size in sizes:
+      source = os.path.join(workdir, '%s-%d.c' % (axis, size))
+      with open(source, 'w') as f:
+        f.write(GENERATORS[axis](size))
+      result = measure(args.clang, source, args.repeat)
+      result['size'] = size
+      results.append(result)
+      print('%-11s %6d  sema %8.3fs %8d KiB  codegen %8.3fs %8d KiB' %
+            (axis, size, result['sema_time'], result['sema_rss_kib'],
+             result['codegen_time'], result['codegen_rss_kib']))
+    k = exponent(results, baseline)
+    report['axes'][axis] = {'results': results, 'exponent': k}
+    if k is None:
+      print('%-11s growth: too fast to measure' % axis)
+    else:
+      superlinear = k > args.max_exponent
+      failed = failed or superlinear
+      print('%-11s growth: size^%.2f%s' %
+            (axis, k, '  (exceeds %.2f)' % args.max_exponent
+                      if superlinear else ''))
+
+  with open(os.path.join(workdir, 'results.json'), 'w') as f:
+    json.dump(report, f, indent=2, sort_keys=True)
+  print('results written to %s' % os.path.join(workdir, 'results.json'))
+  return 1 if failed else 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
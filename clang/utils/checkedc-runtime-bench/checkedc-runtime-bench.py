@@ -0,0 +1,221 @@
+#!/usr/bin/env python
+#
+#===- checkedc-runtime-bench.py - Checked C check cost --------*- python -*-===#
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+#===------------------------------------------------------------------------===#
+
+"""
+This script measures the runtime cost of the dynamic checks of Checked C.
+Each kernel in the kernels directory is compiled twice from the same source:
+as Checked C (with -DCHECKED) and as plain C. For each kernel the script
+reports
+
+  - the slowdown of the checked variant over the unchecked one,
+  - the number of dynamic checks executed by the checked variant, counted by
+    a third build with -fcheckedc-dynamic-check-profile, and
+  - the number of dynamic checks that codegen inserted and elided, from the
+    DynamicCheckCodeGen statistics of the checked build (only when clang was
+    built with statistics enabled).
+
+The kernels are:
+
+  strings     length, character counts and copies over _Nt_array_ptr
+  matrix      matrix multiplication and an image blur over _Array_ptr
+  structs     traversal of structs with member bounds
+  casts       sliding windows taken with _Dynamic_bounds_cast
+  containers  loops over a vector through small checked accessors
+
+The report is written to results.json. With -compare OLD.json, the slowdown
+and the executed checks of each kernel are also printed relative to an
+earlier report. The script exits with a non-zero status if a slowdown
+exceeds -max-slowdown, or, with -compare, if a kernel executes more checks
+than before, so it can be used as the acceptance test of changes that remove
+checks. Example usage:
+
+  checkedc-runtime-bench.py -clang build/bin/clang -kernel matrix
+"""
+from __future__ import absolute_import, division, print_function
+
+import argparse
+import importlib.util
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+KERNELS = ['casts', 'containers', 'matrix', 'strings', 'structs']
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def load_check_profile():
+  """Load checkedc-check-profile.py, which parses the check counts."""
+  path = os.path.join(os.path.dirname(HERE), 'checkedc-check-profile.py')
+  spec = importlib.util.spec_from_file_location('checkedc_check_profile',
+                                                path)
+  module = importlib.util.module_from_spec(spec)
+  spec.loader.exec_module(module)
+  return module
+
+
+def compile_kernel(clang, cflags, kernel, output, extra):
+  source = os.path.join(HERE, 'kernels', kernel + '.c')
+  command = [clang] + cflags + extra + ['-w', source, '-o', output]
+  proc = subprocess.Popen(command, stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT)
+  out, _ = proc.communicate()
+  if proc.returncode != 0:
+    raise RuntimeError('%s failed:\n%s' %
+                       (' '.join(command), out.decode('utf-8', 'replace')))
+
+
+def run(binary, scale):
+  """Run binary and return (seconds, stdout, stderr)."""
+  start = time.time()
+  proc = subprocess.Popen([binary, str(scale)], stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE)
+  out, err = proc.communicate()
+  elapsed = time.time() - start
+  if proc.returncode != 0:
+    raise RuntimeError('%s failed with exit code %d:\n%s' %
+                       (binary, proc.returncode,
+                        err.decode('utf-8', 'replace')))
+  return elapsed, out.decode('utf-8'), err.decode('utf-8', 'replace')
+
+
+def read_codegen_stats(path):
+  if not os.path.exists(path):
+    return None
+  with open(path) as f:
+    text = f.read()
+  if not text.strip():
+    return None
+  prefix = 'DynamicCheckCodeGen.'
+  return dict((key[len(prefix):], value)
+              for key, value in json.loads(text).items()
+              if key.startswith(prefix))
+
+
+def measure(args, kernel, workdir, profile):
+  unchecked = os.path.join(workdir, kernel + '-unchecked')
+  checked = os.path.join(workdir, kernel + '-checked')
+  counting = os.path.join(workdir, kernel + '-profile')
+  stats = os.path.join(workdir, kernel + '-stats.json')
+  if os.path.exists(stats):
+    os.remove(stats)
+  cflags = args.cflags.split()
+  compile_kernel(args.clang, cflags, kernel, unchecked, [])
+  compile_kernel(args.clang, cflags, kernel, checked,
+                 ['-DCHECKED', '-Xclang', '-stats-file=' + stats])
+  compile_kernel(args.clang, cflags, kernel, counting,
+                 ['-DCHECKED', '-fcheckedc-dynamic-check-profile'])
+
+  unchecked_runs = [run(unchecked, args.scale) for _ in range(args.repeat)]
+  checked_runs = [run(checked, args.scale) for _ in range(args.repeat)]
+  expected = unchecked_runs[0][1]
+  if checked_runs[0][1] != expected:
+    raise RuntimeError('%s: the checked and unchecked variants computed '
+                       'different results' % kernel)
+
+  _, _, dump = run(counting, args.scale)
+  counts = {}
+  profile.read_counts(dump.splitlines(), counts)
+  executed = sum(c[0] for c in counts.values())
+  failed = sum(c[1] for c in counts.values())
+  if failed:
+    raise RuntimeError('%s: %d dynamic checks failed' % (kernel, failed))
+
+  unchecked_time = min(r[0] for r in unchecked_runs)
+  checked_time = min(r[0] for r in checked_runs)
+  return {
+    'unchecked_time': unchecked_time,
+    'checked_time': checked_time,
+    'slowdown': checked_time / max(unchecked_time, 1e-6),
+    'checks_executed': executed,
+    'check_sites_executed': sum(1 for c in counts.values() if c[0]),
+    'checks_executed_by_kind': dict(
+        (kind, sum(c[0] for (_, _, _, k), c in counts.items() if k == kind))
+        for kind in sorted(set(site[3] for site in counts))),
+    'codegen_stats': read_codegen_stats(stats),
+  }
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__,
+                                   formatter_class=
+                                           argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('-clang', default='clang',
+                      help='the clang to benchmark (default: clang on PATH)')
+  parser.add_argument('-kernel', action='append', choices=KERNELS,
+                      help='run only this kernel (may be repeated)')
+  parser.add_argument('-cflags', default='-O2',
+                      help='flags used to compile the kernels '
+                      '(default: %(default)s)')
+  parser.add_argument('-scale', type=int, default=1,
+                      help='multiply the work of each kernel by N '
+                      '(default: %(default)s)')
+  parser.add_argument('-repeat', type=int, default=5,
+                      help='run each variant this many times and keep the '
+                      'fastest run (default: %(default)s)')
+  parser.add_argument('-max-slowdown', type=float, default=None,
+                      help='fail if a checked kernel is more than N times '
+                      'slower than its unchecked variant')
+  parser.add_argument('-compare', default=None,
+                      help='print the results relative to this earlier '
+                      'results.json, and fail if a kernel executes more '
+                      'checks than it did then')
+  parser.add_argument('-output-dir', default=None,
+                      help='keep the binaries and write results.json to '
+                      'this directory')
+  args = parser.parse_args()
+
+  kernels = args.kernel or KERNELS
+  workdir = args.output_dir or tempfile.mkdtemp(prefix='checkedc-runtime-')
+  if not os.path.isdir(workdir):
+    os.makedirs(workdir)
+  old_report = None
+  if args.compare:
+    with open(args.compare) as f:
+      old_report = json.load(f)
+  profile = load_check_profile()
+
+  report = {'cflags': args.cflags, 'scale': args.scale, 'kernels': {}}
+  failed = False
+  for kernel in kernels:
+    result = measure(args, kernel, workdir, profile)
+    report['kernels'][kernel] = result
+    line = ('%-8s  unchecked %7.3fs  checked %7.3fs  slowdown %5.2fx  '
+            '%12d checks executed' %
+            (kernel, result['unchecked_time'], result['checked_time'],
+             result['slowdown'], result['checks_executed']))
+    stats = result['codegen_stats']
+    if stats:
+      line += '  (%d inserted, %d elided)' % (
+          stats.get('NumDynamicChecksInserted', 0),
+          stats.get('NumDynamicChecksElided', 0))
+    print(line)
+    if args.max_slowdown is not None and \
+       result['slowdown'] > args.max_slowdown:
+      print('%-8s  slowdown exceeds %.2fx' % (kernel, args.max_slowdown))
+      failed = True
+    old = old_report['kernels'].get(kernel) if old_report else None
+    if old:
+      print('%-8s  was: slowdown %5.2fx  %12d checks executed' %
+            (kernel, old['slowdown'], old['checks_executed']))
+      if result['checks_executed'] > old['checks_executed']:
+        print('%-8s  executes more checks than before' % kernel)
+        failed = True
+
+  with open(os.path.join(workdir, 'results.json'), 'w') as f:
+    json.dump(report, f, indent=2, sort_keys=True)
+  print('results written to %s' % os.path.join(workdir, 'results.json'))
+  return 1 if failed else 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
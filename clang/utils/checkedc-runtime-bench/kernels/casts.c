@@ -0,0 +1,35 @@
+// Sliding windows taken with dynamic bounds casts.
+
+#include "common.h"
+
+#define LEN 65536
+#define WINDOW 16
+
+static int DATA CHECKED_ARRAY[LEN];
+
+static long window_sum(ARRAY_PTR(int) w COUNT(k), int k) {
+  long s = 0;
+  for (int i = 0; i < k; i++)
+    s += w[i];
+  return s;
+}
+
+static long sliding_sums(ARRAY_PTR(int) a COUNT(n), int n, int k) {
+  long s = 0;
+  for (int i = 0; i + k <= n; i++) {
+    ARRAY_PTR(int) w COUNT(k) =
+      DYNAMIC_BOUNDS_CAST(ARRAY_PTR(int), a + i, count(k));
+    s += window_sum(w, k);
+  }
+  return s;
+}
+
+int main(int argc, char **argv) {
+  for (int i = 0; i < LEN; i++)
+    DATA[i] = i % 13;
+  long sum = 0;
+  for (int k = iterations(argc, argv, 1000); k > 0; k--)
+    sum += sliding_sums(DATA, LEN, WINDOW) + k;
+  printf("%ld\n", sum);
+  return 0;
+}
@@ -0,0 +1,29 @@
+// Macros that let each kernel be compiled as Checked C (with -DCHECKED) or as
+// plain C from the same source.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef CHECKED
+#define ARRAY_PTR(T) _Array_ptr<T>
+#define NT_ARRAY_PTR(T) _Nt_array_ptr<T>
+#define PTR(T) _Ptr<T>
+#define COUNT(n) : count(n)
+#define CHECKED_ARRAY _Checked
+#define NT_CHECKED_ARRAY _Nt_checked
+#define DYNAMIC_BOUNDS_CAST(T, e, b) _Dynamic_bounds_cast<T>(e, b)
+#else
+#define ARRAY_PTR(T) T *
+#define NT_ARRAY_PTR(T) T *
+#define PTR(T) T *
+#define COUNT(n)
+#define CHECKED_ARRAY
+#define NT_CHECKED_ARRAY
+#define DYNAMIC_BOUNDS_CAST(T, e, b) ((T)(e))
+#endif
+
+// The number of times to run the kernel, which can be scaled from the
+// command line.
+static int iterations(int argc, char **argv, int n) {
+  return argc > 1 ? n * atoi(argv[1]) : n;
+}
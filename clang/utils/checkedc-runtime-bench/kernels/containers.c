@@ -0,0 +1,64 @@
+// Small accessors of a checked vector, called from loops in other
+// functions. Whether the accessors are inlined depends on the inline cost of
+// their dynamic checks; compare a run with
+//   -cflags "-O2 -mllvm -inline-discount-cold-trap-paths=false"
+// against the default to see the effect of leaving the failure paths of the
+// checks out of that cost.
+
+#include "common.h"
+
+#define LEN 4096
+
+struct vec {
+  ARRAY_PTR(int) data COUNT(len);
+  int len;
+};
+
+static int STORE CHECKED_ARRAY[LEN];
+
+// The accessors have external linkage, so that they are not inlined just
+// because each of them has a single caller.
+int vec_get(PTR(struct vec) v, int i) {
+  return v->data[i];
+}
+
+void vec_set(PTR(struct vec) v, int i, int x) {
+  v->data[i] = x;
+}
+
+void vec_swap(PTR(struct vec) v, int i, int j) {
+  int t = vec_get(v, i);
+  vec_set(v, i, vec_get(v, j));
+  vec_set(v, j, t);
+}
+
+static long sum(PTR(struct vec) v) {
+  long s = 0;
+  for (int i = 0; i < v->len; i++)
+    s += vec_get(v, i);
+  return s;
+}
+
+static void reverse(PTR(struct vec) v) {
+  for (int i = 0, j = v->len - 1; i < j; i++, j--)
+    vec_swap(v, i, j);
+}
+
+static void prefix_sums(PTR(struct vec) v) {
+  for (int i = 1; i < v->len; i++)
+    vec_set(v, i, (vec_get(v, i - 1) + vec_get(v, i)) % 1000);
+}
+
+int main(int argc, char **argv) {
+  struct vec v = { STORE, LEN };
+  for (int i = 0; i < LEN; i++)
+    vec_set(&v, i, i % 10);
+  long s = 0;
+  for (int k = iterations(argc, argv, 2000); k > 0; k--) {
+    prefix_sums(&v);
+    reverse(&v);
+    s += sum(&v);
+  }
+  printf("%ld\n", s);
+  return 0;
+}
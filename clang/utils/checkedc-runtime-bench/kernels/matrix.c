@@ -0,0 +1,55 @@
+// Matrix multiplication and an image blur over _Array_ptr with count bounds.
+
+#include "common.h"
+
+#define N 128
+#define W 512
+#define H 512
+
+static double A CHECKED_ARRAY[N * N];
+static double B CHECKED_ARRAY[N * N];
+static double C CHECKED_ARRAY[N * N];
+static unsigned char IMAGE CHECKED_ARRAY[W * H];
+static unsigned char BLURRED CHECKED_ARRAY[W * H];
+
+static void matmul(ARRAY_PTR(double) c COUNT(n * n),
+                   ARRAY_PTR(const double) a COUNT(n * n),
+                   ARRAY_PTR(const double) b COUNT(n * n), int n) {
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++) {
+      double s = 0;
+      for (int k = 0; k < n; k++)
+        s += a[i * n + k] * b[k * n + j];
+      c[i * n + j] = s;
+    }
+}
+
+static void blur(ARRAY_PTR(unsigned char) dst COUNT(w * h),
+                 ARRAY_PTR(const unsigned char) src COUNT(w * h),
+                 int w, int h) {
+  for (int y = 1; y < h - 1; y++)
+    for (int x = 1; x < w - 1; x++) {
+      int s = 0;
+      for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+          s += src[(y + dy) * w + x + dx];
+      dst[y * w + x] = (unsigned char)(s / 9);
+    }
+}
+
+int main(int argc, char **argv) {
+  for (int i = 0; i < N * N; i++) {
+    A[i] = i % 7;
+    B[i] = i % 5;
+  }
+  for (int i = 0; i < W * H; i++)
+    IMAGE[i] = (unsigned char)(i * 31);
+  double sum = 0;
+  for (int k = iterations(argc, argv, 100); k > 0; k--) {
+    matmul(C, A, B, N);
+    blur(BLURRED, IMAGE, W, H);
+    sum += C[k % (N * N)] + BLURRED[k % (W * H)];
+  }
+  printf("%f\n", sum);
+  return 0;
+}
@@ -0,0 +1,54 @@
+// String processing over null-terminated pointers: length, character counts
+// and a copy that converts to upper case.
+
+#include "common.h"
+
+#define TEXT_LEN 4096
+
+static char TEXT NT_CHECKED_ARRAY[TEXT_LEN + 1];
+static char OUT CHECKED_ARRAY[TEXT_LEN + 1];
+
+static int nt_length(NT_ARRAY_PTR(const char) s) {
+  int n = 0;
+  NT_ARRAY_PTR(const char) p = s;
+  while (*p) {
+    p++;
+    n++;
+  }
+  return n;
+}
+
+static int nt_count(NT_ARRAY_PTR(const char) s, char c) {
+  int n = 0;
+  for (NT_ARRAY_PTR(const char) p = s; *p; p++)
+    n += *p == c;
+  return n;
+}
+
+static int copy_upper(ARRAY_PTR(char) dst COUNT(cap), int cap,
+                      NT_ARRAY_PTR(const char) src) {
+  int i = 0;
+  NT_ARRAY_PTR(const char) p = src;
+  while (*p && i < cap - 1) {
+    char c = *p;
+    dst[i] = c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+    i++;
+    p++;
+  }
+  dst[i] = '\0';
+  return i;
+}
+
+int main(int argc, char **argv) {
+  for (int i = 0; i < TEXT_LEN; i++)
+    TEXT[i] = "the quick brown fox jumps over the lazy dog "[i % 44];
+  long sum = 0;
+  for (int k = iterations(argc, argv, 40000); k > 0; k--) {
+    sum += nt_length(TEXT);
+    sum += nt_count(TEXT, 'o');
+    sum += copy_upper(OUT, TEXT_LEN + 1, TEXT);
+    sum += OUT[k % TEXT_LEN];
+  }
+  printf("%ld\n", sum);
+  return 0;
+}
@@ -0,0 +1,51 @@
+// Traversal of structs whose members have bounds declarations that use
+// other members.
+
+#include "common.h"
+
+#define NUM_VECS 256
+#define POOL_SIZE (NUM_VECS * 64)
+
+struct vec {
+  ARRAY_PTR(int) data COUNT(len);
+  int len;
+};
+
+static int POOL CHECKED_ARRAY[POOL_SIZE];
+static struct vec VECS CHECKED_ARRAY[NUM_VECS];
+
+static struct vec make_vec(ARRAY_PTR(int) p COUNT(n), int n) {
+  struct vec v = { p, n };
+  return v;
+}
+
+static long sum_vec(PTR(struct vec) v) {
+  long s = 0;
+  for (int i = 0; i < v->len; i++)
+    s += v->data[i];
+  return s;
+}
+
+static void scale_vec(PTR(struct vec) v, int factor) {
+  for (int i = 0; i < v->len; i++)
+    v->data[i] = v->data[i] * factor % 1000;
+}
+
+int main(int argc, char **argv) {
+  for (int i = 0; i < POOL_SIZE; i++)
+    POOL[i] = i % 100;
+  for (int i = 0; i < NUM_VECS; i++) {
+    int len = 1 + i % 64;
+    ARRAY_PTR(int) p COUNT(len) =
+      DYNAMIC_BOUNDS_CAST(ARRAY_PTR(int), POOL + i * 64, count(len));
+    VECS[i] = make_vec(p, len);
+  }
+  long sum = 0;
+  for (int k = iterations(argc, argv, 20000); k > 0; k--)
+    for (int i = 0; i < NUM_VECS; i++) {
+      scale_vec(&VECS[i], 3);
+      sum += sum_vec(&VECS[i]);
+    }
+  printf("%ld\n", sum);
+  return 0;
+}
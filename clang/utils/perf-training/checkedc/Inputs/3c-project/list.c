@@ -0,0 +1,29 @@
+#include "project.h"
+
+struct node *list_push(struct node *head, char *key, int *values, int n) {
+  struct node *new_node = malloc(sizeof(struct node));
+  new_node->key = strdup(key);
+  new_node->values = malloc(n * sizeof(int));
+  for (int i = 0; i < n; i++)
+    new_node->values[i] = values[i];
+  new_node->num_values = n;
+  new_node->next = head;
+  return new_node;
+}
+
+struct node *list_find(struct node *head, const char *key) {
+  for (struct node *p = head; p; p = p->next)
+    if (strcmp(p->key, key) == 0)
+      return p;
+  return NULL;
+}
+
+void list_free(struct node *head) {
+  while (head) {
+    struct node *next = head->next;
+    free(head->key);
+    free(head->values);
+    free(head);
+    head = next;
+  }
+}
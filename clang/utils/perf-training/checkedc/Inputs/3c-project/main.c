@@ -0,0 +1,15 @@
+#include "project.h"
+
+int main(int argc, char **argv) {
+  struct table *t = table_new(16);
+  int values[3] = {1, 2, 3};
+  for (int i = 1; i < argc; i++)
+    table_put(t, argv[i], values, 3);
+  int n = 0;
+  int sum = 0;
+  int *found = argc > 1 ? table_get(t, argv[1], &n) : NULL;
+  for (int i = 0; i < n; i++)
+    sum += found[i];
+  table_free(t);
+  return sum;
+}
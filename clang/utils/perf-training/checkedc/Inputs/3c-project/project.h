@@ -0,0 +1,23 @@
+#include <stdlib.h>
+#include <string.h>
+
+struct node {
+  char *key;
+  int *values;
+  int num_values;
+  struct node *next;
+};
+
+struct table {
+  struct node **buckets;
+  int num_buckets;
+};
+
+struct node *list_push(struct node *head, char *key, int *values, int n);
+struct node *list_find(struct node *head, const char *key);
+void list_free(struct node *head);
+
+struct table *table_new(int num_buckets);
+void table_put(struct table *t, char *key, int *values, int n);
+int *table_get(struct table *t, const char *key, int *n);
+void table_free(struct table *t);
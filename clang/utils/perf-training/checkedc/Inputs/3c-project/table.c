@@ -0,0 +1,36 @@
+#include "project.h"
+
+static unsigned hash(const char *key) {
+  unsigned h = 5381;
+  for (const char *p = key; *p; p++)
+    h = h * 33 + (unsigned char)*p;
+  return h;
+}
+
+struct table *table_new(int num_buckets) {
+  struct table *t = malloc(sizeof(struct table));
+  t->buckets = calloc(num_buckets, sizeof(struct node *));
+  t->num_buckets = num_buckets;
+  return t;
+}
+
+void table_put(struct table *t, char *key, int *values, int n) {
+  unsigned b = hash(key) % t->num_buckets;
+  t->buckets[b] = list_push(t->buckets[b], key, values, n);
+}
+
+int *table_get(struct table *t, const char *key, int *n) {
+  unsigned b = hash(key) % t->num_buckets;
+  struct node *found = list_find(t->buckets[b], key);
+  if (!found)
+    return NULL;
+  *n = found->num_values;
+  return found->values;
+}
+
+void table_free(struct table *t) {
+  for (int i = 0; i < t->num_buckets; i++)
+    list_free(t->buckets[i]);
+  free(t->buckets);
+  free(t);
+}
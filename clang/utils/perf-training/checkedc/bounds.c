@@ -0,0 +1,51 @@
+// Bounds declarations that need proofs: count and range bounds, bounds
+// widening in loops, where clauses, dynamic bounds casts and bounds of
+// struct members.
+//
+// RUN: %clang -c %s -o /dev/null
+// RUN: %clang -O2 -c %s -o /dev/null
+
+#pragma CHECKED_SCOPE on
+
+struct buffer {
+  _Array_ptr<int> data : count(len);
+  int len;
+};
+
+int sum(_Array_ptr<int> a : count(n), int n) {
+  int s = 0;
+  for (int i = 0; i < n; i++)
+    s += a[i];
+  return s;
+}
+
+int sum_range(_Array_ptr<int> lo : bounds(lo, hi), _Array_ptr<int> hi) {
+  int s = 0;
+  for (_Array_ptr<int> p : bounds(lo, hi) = lo; p < hi; p++)
+    s += *p;
+  return s;
+}
+
+int suffixes(_Array_ptr<int> a : count(n), int n) {
+  int s = 0;
+  for (int i = 0; i < n; i++) {
+    _Array_ptr<int> q : count(n - i) = a + i;
+    s += sum(q, n - i);
+  }
+  return s;
+}
+
+int first_half(_Array_ptr<int> a : count(n), int n) {
+  int half = n / 2;
+  _Where a : count(n);
+  _Array_ptr<int> b : count(half) =
+    _Dynamic_bounds_cast<_Array_ptr<int>>(a, count(half));
+  return sum(b, half);
+}
+
+int use_buffer(struct buffer b) {
+  int s = 0;
+  if (b.len > 2)
+    s = b.data[0] + b.data[b.len - 1];
+  return s + sum(b.data, b.len);
+}
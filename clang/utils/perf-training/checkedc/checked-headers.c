@@ -0,0 +1,29 @@
+// Use the checked versions of the C library headers, whose declarations
+// carry bounds-safe interfaces.
+//
+// RUN: %clang -c %s -o /dev/null
+// RUN: %clang -O2 -c %s -o /dev/null
+
+#include <stdio_checked.h>
+#include <stdlib_checked.h>
+#include <string_checked.h>
+
+#pragma CHECKED_SCOPE on
+
+int copy_and_print(_Nt_array_ptr<const char> src : count(len), size_t len) {
+  _Array_ptr<char> buf : byte_count(len + 1) = malloc<char>(len + 1);
+  if (buf == NULL)
+    return -1;
+  memcpy<char>(buf, src, len);
+  buf[len] = '\0';
+  _Unchecked {
+    printf("%s\n", (const char *)buf);
+  }
+  int n = (int)strlen(src);
+  free<char>(buf);
+  return n;
+}
+
+int main(void) {
+  return copy_and_print("checked", 7) == 7 ? 0 : 1;
+}
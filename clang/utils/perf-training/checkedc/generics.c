@@ -0,0 +1,27 @@
+// Generic functions, generic bounds-safe interfaces and their
+// instantiations.
+//
+// RUN: %clang -c %s -o /dev/null
+// RUN: %clang -O2 -c %s -o /dev/null
+
+#pragma CHECKED_SCOPE on
+
+_For_any(T) _Ptr<T> id(_Ptr<T> x) {
+  return x;
+}
+
+_For_any(T, U) _Ptr<T> choose(_Ptr<T> x, _Ptr<U> y, int which) {
+  return which ? x : id<T>(x);
+}
+
+_Itype_for_any(T) void *pick(void *a : itype(_Ptr<T>),
+                             void *b : itype(_Ptr<T>), int which)
+    : itype(_Ptr<T>) {
+  return which ? a : b;
+}
+
+int use(_Ptr<int> p, _Ptr<char> c) {
+  _Ptr<int> r = choose<int, char>(p, c, 1);
+  _Ptr<int> t = pick<int>(r, id<int>(p), 0);
+  return *t + *id<char>(c);
+}
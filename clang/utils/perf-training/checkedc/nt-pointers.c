@@ -0,0 +1,40 @@
+// Null-terminated pointers whose bounds are widened by loops and
+// conditionals.
+//
+// RUN: %clang -c %s -o /dev/null
+// RUN: %clang -O2 -c %s -o /dev/null
+
+#pragma CHECKED_SCOPE on
+
+int length(_Nt_array_ptr<const char> s : count(0)) {
+  int n = 0;
+  for (_Nt_array_ptr<const char> p : count(0) = s; *p; n++) {
+    _Nt_array_ptr<const char> q : count(0) = p + 1;
+    p = q;
+  }
+  return n;
+}
+
+int compare(_Nt_array_ptr<const char> a : count(0),
+            _Nt_array_ptr<const char> b : count(0)) {
+  while (*a && *b) {
+    if (*(a + 1) != *(b + 1))
+      break;
+    a++;
+    b++;
+  }
+  return *a - *b;
+}
+
+int count_char(_Nt_array_ptr<char> s : count(0), char c) {
+  int n = 0;
+  if (*s) {
+    if (*(s + 1)) {
+      if (*(s + 2))
+        n += *(s + 2) == c;
+      n += *(s + 1) == c;
+    }
+    n += *s == c;
+  }
+  return n;
+}
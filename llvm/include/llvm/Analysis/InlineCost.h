@@ -54,6 +54,12 @@ const unsigned TotalAllocaSizeRecursiveCaller = 1024;
 const uint64_t MaxSimplifiedDynamicAllocaToInline = 65536;
 } // namespace InlineConstants
 
+/// The kind of the metadata that the Checked C front end attaches to the call
+/// that reports the failure of a dynamic check. The inline cost analysis does
+/// not count the blocks with such a call, which are never executed in a
+/// correct program.
+constexpr const char *CheckedCCheckFailureMDName = "checkedc.check_failure";
+
 /// Represents the cost of inlining a function.
 ///
 /// This supports special values for functions which should "always" or
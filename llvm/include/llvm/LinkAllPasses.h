@@ -177,6 +177,8 @@ namespace {
       (void) llvm::createUnifyFunctionExitNodesPass();
       (void) llvm::createInstCountPass();
       (void) llvm::createConstantHoistingPass();
+      (void) llvm::createCheckedCBoundsCheckOptPass();
+      (void) llvm::createCheckedCIPBoundsCheckOptPass();
       (void) llvm::createCodeGenPreparePass();
       (void) llvm::createEntryExitInstrumenterPass();
       (void) llvm::createPostInlineEntryExitInstrumenterPass();
@@ -73,6 +73,20 @@ FunctionPass *createDeadStoreEliminationPass();
 // values.
 FunctionPass *createCallSiteSplittingPass();
 
+//===----------------------------------------------------------------------===//
+//
+// CheckedCBoundsCheckOpt - This pass hoists Checked C dynamic bounds checks
+// on induction variables out of loops.
+//
+FunctionPass *createCheckedCBoundsCheckOptPass();
+
+//===----------------------------------------------------------------------===//
+//
+// CheckedCIPBoundsCheckOpt - This pass removes Checked C dynamic bounds checks
+// of internal functions that every caller has already made.
+//
+ModulePass *createCheckedCIPBoundsCheckOptPass();
+
 //===----------------------------------------------------------------------===//
 //
 // AggressiveDCE - This pass uses the SSA based Aggressive DCE algorithm.  This
@@ -0,0 +1,72 @@
+//===- CheckedCBoundsCheckOpt.h - Optimize Checked C bounds checks -*- C++ -*-//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass optimizes the dynamic bounds checks that the Checked C front end
+// emits for memory accesses through checked pointers. The front end marks the
+// conditional branch of each such check with CheckedCBoundsCheckMDName
+// metadata. A check has the form:
+//
+//   %lower = icmp ule %lb, %ptr
+//   %upper = icmp ult %ptr, %ub   ; or icmp ule for null-terminated reads
+//   %range = and i1 %lower, %upper
+//   br i1 %range, label %succeeded, label %failed
+//
+// where %failed is a block that traps or calls the failure handler
+// CheckedCFailureHandlerName. The metadata of a check of an
+// unchecked pointer, which the front end adds with
+// -funchecked-pointers-dynamic-check, has CheckedCUncheckedPointerMDKind as
+// its operand. Such checks are optimized in the same way.
+//
+// CheckedCIPBoundsCheckOptPass removes the bounds checks of internal
+// functions that all of their callers have already made.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_SCALAR_CHECKEDCBOUNDSCHECKOPT_H
+#define LLVM_TRANSFORMS_SCALAR_CHECKEDCBOUNDSCHECKOPT_H
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+
+namespace llvm {
+
+/// The kind of the metadata attached to the branch of a Checked C dynamic
+/// bounds check.
+constexpr const char *CheckedCBoundsCheckMDName = "checkedc.bounds_check";
+
+/// The operand of the CheckedCBoundsCheckMDName metadata of a bounds check of
+/// an unchecked pointer.
+constexpr const char *CheckedCUncheckedPointerMDKind = "unchecked";
+
+/// The name of the function that the failure block of a dynamic check calls
+/// with the ID of the failing check when -fcheckedc-check-failure-handler is
+/// given.
+constexpr const char *CheckedCFailureHandlerName =
+    "_Dynamic_check.failure_handler";
+
+/// Remove Checked C bounds checks implied by dominating checks and hoist
+/// bounds checks on induction variables out of loops.
+class CheckedCBoundsCheckOptPass
+    : public PassInfoMixin<CheckedCBoundsCheckOptPass> {
+public:
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
+};
+
+/// Remove Checked C bounds checks of functions with local linkage whose
+/// conditions only depend on the arguments of the function and are implied
+/// by bounds checks dominating every call to the function.
+class CheckedCIPBoundsCheckOptPass
+    : public PassInfoMixin<CheckedCIPBoundsCheckOptPass> {
+public:
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+};
+
+} // end namespace llvm
+
+#endif // LLVM_TRANSFORMS_SCALAR_CHECKEDCBOUNDSCHECKOPT_H
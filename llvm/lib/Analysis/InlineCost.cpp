@@ -128,6 +128,41 @@ static cl::opt<bool> DisableGEPConstOperand(
     "disable-gep-const-evaluation", cl::Hidden, cl::init(false),
     cl::desc("Disables evaluation of GetElementPtr with constant operands"));
 
+static cl::opt<bool> DiscountColdTrapPaths(
+    "inline-discount-cold-trap-paths", cl::Hidden, cl::init(true),
+    cl::desc("Do not count the failure paths of Checked C dynamic checks, or "
+             "the branches to them, in the inline cost"));
+
+/// Return true if BB is a cold trap path: the failure block of a Checked C
+/// dynamic check, which reports the failure with a call tagged with
+/// CheckedCCheckFailureMDName and ends in unreachable. It may also call other
+/// cold functions first, such as __VERIFIER_error. The block is never
+/// executed in a correct program and is usually shared or merged after
+/// inlining, so it is not counted against inlining its function.
+static bool isColdTrapBlock(const BasicBlock *BB) {
+  if (!DiscountColdTrapPaths || !isa<UnreachableInst>(BB->getTerminator()))
+    return false;
+  bool Fails = false;
+  for (const Instruction &I : *BB) {
+    if (I.isTerminator() || isa<DbgInfoIntrinsic>(I))
+      continue;
+    const auto *CI = dyn_cast<CallInst>(&I);
+    if (!CI || !CI->hasFnAttr(Attribute::Cold))
+      return false;
+    Fails |= CI->getMetadata(CheckedCCheckFailureMDName) != nullptr;
+  }
+  return Fails;
+}
+
+/// Return the number of the successors of TI that are not cold trap paths.
+static unsigned getNumNonTrapSuccessors(const Instruction *TI) {
+  unsigned NumSuccessors = 0;
+  for (const BasicBlock *Succ : successors(TI))
+    if (!isColdTrapBlock(Succ))
+      ++NumSuccessors;
+  return NumSuccessors;
+}
+
 namespace {
 class InlineCostCallAnalyzer;
 
@@ -646,7 +681,7 @@ class InlineCostCallAnalyzer final : public CallAnalyzer {
     // have them as well. Note that we assume any basic blocks which existed
     // due to branches or switches which folded above will also fold after
     // inlining.
-    if (SingleBB && TI->getNumSuccessors() > 1) {
+    if (SingleBB && getNumNonTrapSuccessors(TI) > 1) {
       // Take off the bonus we applied to the threshold.
       Threshold -= SingleBBBonus;
       SingleBB = false;
@@ -1902,10 +1937,12 @@ bool CallAnalyzer::visitBranchInst(BranchInst &BI) {
   // We model unconditional branches as essentially free -- they really
   // shouldn't exist at all, but handling them makes the behavior of the
   // inliner more regular and predictable. Interestingly, conditional branches
-  // which will fold away are also free.
+  // which will fold away are also free. So are the branches of checks to cold
+  // trap paths, which are counted as part of the checks.
   return BI.isUnconditional() || isa<ConstantInt>(BI.getCondition()) ||
          dyn_cast_or_null<ConstantInt>(
-             SimplifiedValues.lookup(BI.getCondition()));
+             SimplifiedValues.lookup(BI.getCondition())) ||
+         getNumNonTrapSuccessors(&BI) < BI.getNumSuccessors();
 }
 
 bool CallAnalyzer::visitSelectInst(SelectInst &SI) {
@@ -2374,10 +2411,11 @@ InlineResult CallAnalyzer::analyze() {
     }
 
     // If we're unable to select a particular successor, just count all of
-    // them.
+    // them, except for cold trap paths.
     for (unsigned TIdx = 0, TSize = TI->getNumSuccessors(); TIdx != TSize;
          ++TIdx)
-      BBWorklist.insert(TI->getSuccessor(TIdx));
+      if (!isColdTrapBlock(TI->getSuccessor(TIdx)))
+        BBWorklist.insert(TI->getSuccessor(TIdx));
 
     onBlockAnalyzed(BB);
   }
@@ -0,0 +1,885 @@
+//===- CheckedCBoundsCheckOpt.cpp - Optimize Checked C bounds checks ------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass optimizes the dynamic bounds checks that the Checked C front end
+// emits for memory accesses through checked pointers.
+//
+// Bounds checks inside a loop whose pointer is an affine induction variable
+// and whose bounds are loop invariant are replaced with a single range check
+// in the loop preheader. If the pointer takes the values Start, Start + Step,
+// ..., Last over the iterations of the loop, the per-iteration check
+//   (Lower <= Ptr) && (Ptr < Upper)
+// holds for every iteration iff
+//   (Lower <= Start) && (Last < Upper)
+// holds, provided the pointer does not wrap around the address space. The
+// check is only hoisted if the loop is guaranteed to execute it on every
+// iteration and the loop can only leave early by failing a check. So the
+// hoisted check traps iff the original loop would have trapped.
+//
+// Loops whose trip count is not known, such as scans of null-terminated
+// arrays, still benefit if the pointer increases on every iteration without
+// wrapping around and the lower bound is loop invariant. If the check is
+// executed on the first iteration, its lower bound comparison is replaced
+// with a check of the initial value of the pointer in the loop preheader,
+// leaving only the upper bound comparison inside the loop.
+//
+// A bounds check is removed if checks that dominate it already established
+// its condition. With the same bounds, checks on Ptr + A and Ptr + B, where
+// A <= 0 <= B are constants, together imply a check on Ptr, again provided
+// the pointers do not wrap around the address space.
+//
+// CheckedCIPBoundsCheckOpt removes the bounds checks of functions with local
+// linkage that are only called directly. If the bounds and the pointer of a
+// check only depend on the arguments of the function, the check has the same
+// outcome anywhere in the function. It is removed if at every call, a check
+// in the caller that dominates the call implies it for the arguments of the
+// call. By induction on the depth of the call stack, the removed checks would
+// always have succeeded, even when the function calls itself.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar/CheckedCBoundsCheckOpt.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+using namespace llvm;
+using namespace llvm::PatternMatch;
+
+#define DEBUG_TYPE "checkedc-bounds-check-opt"
+
+STATISTIC(NumChecksHoisted,
+          "Number of Checked C bounds checks hoisted out of loops");
+STATISTIC(NumLowerChecksHoisted,
+          "Number of Checked C lower bound checks hoisted out of loops");
+STATISTIC(NumChecksEliminated,
+          "Number of Checked C bounds checks implied by dominating checks");
+STATISTIC(NumChecksMadeByCallers,
+          "Number of Checked C bounds checks implied by checks in all callers");
+STATISTIC(NumUncheckedChecksOptimized,
+          "Number of the hoisted or removed Checked C bounds checks that are "
+          "on unchecked pointers");
+
+namespace {
+
+/// The operands of a Checked C bounds check
+///   (Lower <= Ptr) && (Ptr < Upper)
+/// The comparisons may be strict or non-strict.
+struct BoundsCheck {
+  BranchInst *Branch;
+  Value *Lower;
+  Value *Ptr;
+  Value *Upper;
+  bool LowerIsStrict;
+  bool UpperIsStrict;
+  Value *UpperCond;
+};
+
+} // end anonymous namespace
+
+/// Match an unsigned comparison A < B or A <= B, looking through comparisons
+/// whose operands have been swapped.
+static bool matchUnsignedLess(Value *V, Value *&A, Value *&B, bool &IsStrict) {
+  auto *Cmp = dyn_cast<ICmpInst>(V);
+  if (!Cmp)
+    return false;
+
+  ICmpInst::Predicate Pred = Cmp->getPredicate();
+  A = Cmp->getOperand(0);
+  B = Cmp->getOperand(1);
+  if (Pred == ICmpInst::ICMP_UGT || Pred == ICmpInst::ICMP_UGE) {
+    Pred = Cmp->getSwappedPredicate();
+    std::swap(A, B);
+  }
+
+  if (Pred != ICmpInst::ICMP_ULT && Pred != ICmpInst::ICMP_ULE)
+    return false;
+  IsStrict = Pred == ICmpInst::ICMP_ULT;
+  return true;
+}
+
+/// Match the branch of a Checked C bounds check.
+static bool matchBoundsCheck(BranchInst *BI, BoundsCheck &Check) {
+  if (!BI || !BI->isConditional() ||
+      !BI->getMetadata(CheckedCBoundsCheckMDName))
+    return false;
+
+  Value *LHS, *RHS;
+  if (!match(BI->getCondition(), m_And(m_Value(LHS), m_Value(RHS))))
+    return false;
+
+  Value *A1, *B1, *A2, *B2;
+  bool Strict1, Strict2;
+  if (!matchUnsignedLess(LHS, A1, B1, Strict1) ||
+      !matchUnsignedLess(RHS, A2, B2, Strict2))
+    return false;
+
+  // Find the pointer common to both comparisons: A1 <= Ptr && Ptr < B2, or
+  // A2 <= Ptr && Ptr < B1.
+  if (B1 == A2)
+    Check = {BI, A1, B1, B2, Strict1, Strict2, RHS};
+  else if (B2 == A1)
+    Check = {BI, A2, B2, B1, Strict2, Strict1, LHS};
+  else
+    return false;
+  return true;
+}
+
+/// Drop the bounds check metadata of the branch of Check, which has been
+/// hoisted or removed, counting the checks of unchecked pointers.
+static void dropBoundsCheckMD(const BoundsCheck &Check) {
+  MDNode *MD = Check.Branch->getMetadata(CheckedCBoundsCheckMDName);
+  if (MD && MD->getNumOperands() > 0)
+    if (auto *Kind = dyn_cast<MDString>(MD->getOperand(0)))
+      if (Kind->getString() == CheckedCUncheckedPointerMDKind)
+        ++NumUncheckedChecksOptimized;
+  Check.Branch->setMetadata(CheckedCBoundsCheckMDName, nullptr);
+}
+
+/// Return true if CI reports a failed dynamic check without returning: a
+/// call to the failure handler that the front end emits with
+/// -fcheckedc-check-failure-handler, or to another cold function that does
+/// not return.
+static bool isCheckFailureCall(const CallInst *CI, const Function *Callee) {
+  if (Callee->getName() == CheckedCFailureHandlerName)
+    return true;
+  return CI->doesNotReturn() && CI->hasFnAttr(Attribute::Cold);
+}
+
+/// Return true if BB is the failure block of a dynamic check: a block that
+/// only traps (possibly after reporting the failure to a verifier) or calls
+/// a failure handler.
+static bool isCheckFailureBlock(const BasicBlock *BB) {
+  if (!isa<UnreachableInst>(BB->getTerminator()) || isa<PHINode>(BB->front()))
+    return false;
+
+  for (const Instruction &I : *BB) {
+    if (I.isTerminator() || isa<DbgInfoIntrinsic>(I))
+      continue;
+    const auto *CI = dyn_cast<CallInst>(&I);
+    const Function *Callee = CI ? CI->getCalledFunction() : nullptr;
+    if (!Callee)
+      return false;
+    if (Callee->getIntrinsicID() != Intrinsic::trap &&
+        Callee->getName() != "__VERIFIER_error" &&
+        !isCheckFailureCall(CI, Callee))
+      return false;
+  }
+  return true;
+}
+
+/// Set LowerHolds and UpperHolds if the comparisons of the bounds check
+/// Check on PtrSCEV are implied by the successful bounds check Dom on
+/// DomPtrSCEV. Both checks must have the same bounds.
+static void addImpliedComparisons(ScalarEvolution &SE, const BoundsCheck &Dom,
+                                  const SCEV *DomPtrSCEV,
+                                  const BoundsCheck &Check,
+                                  const SCEV *PtrSCEV, bool &LowerHolds,
+                                  bool &UpperHolds) {
+  if (SE.getTypeSizeInBits(DomPtrSCEV->getType()) !=
+      SE.getTypeSizeInBits(PtrSCEV->getType()))
+    return;
+  const auto *Offset =
+      dyn_cast<SCEVConstant>(SE.getMinusSCEV(DomPtrSCEV, PtrSCEV));
+  if (!Offset)
+    return;
+
+  // Lower <= Ptr + Offset with Offset <= 0 implies Lower <= Ptr, and
+  // Ptr + Offset < Upper with Offset >= 0 implies Ptr < Upper. With a
+  // zero offset the dominating comparison must be at least as strict.
+  const APInt &Off = Offset->getAPInt();
+  if (Off.isNegative() ||
+      (Off.isNullValue() && (Dom.LowerIsStrict || !Check.LowerIsStrict)))
+    LowerHolds = true;
+  if (Off.isStrictlyPositive() ||
+      (Off.isNullValue() && (Dom.UpperIsStrict || !Check.UpperIsStrict)))
+    UpperHolds = true;
+}
+
+/// Explain why the bounds checks in L were not hoisted out of it, if missed
+/// optimization remarks are requested for this pass.
+static void remarkChecksNotHoisted(Loop *L, OptimizationRemarkEmitter &ORE,
+                                   StringRef Reason) {
+  if (!ORE.allowExtraAnalysis(DEBUG_TYPE))
+    return;
+  for (BasicBlock *BB : L->blocks()) {
+    BoundsCheck Check;
+    if (!matchBoundsCheck(dyn_cast<BranchInst>(BB->getTerminator()), Check))
+      continue;
+    ORE.emit([&]() {
+      return OptimizationRemarkMissed(DEBUG_TYPE, "NotHoisted", Check.Branch)
+             << "bounds check not hoisted out of loop: " << Reason;
+    });
+  }
+}
+
+/// Remove the bounds checks whose conditions are implied by dominating
+/// bounds checks with the same bounds.
+static bool eliminateRedundantChecks(DominatorTree &DT, ScalarEvolution &SE,
+                                     OptimizationRemarkEmitter &ORE) {
+  // The checks that have been seen so far, grouped by their bounds. Visiting
+  // the blocks in dominator tree preorder means that all checks dominating a
+  // check have been seen before it.
+  using BoundsKey = std::pair<const SCEV *, const SCEV *>;
+  DenseMap<BoundsKey, SmallVector<BoundsCheck, 4>> ChecksByBounds;
+  bool Changed = false;
+
+  for (DomTreeNode *Node : depth_first(DT.getRootNode())) {
+    BasicBlock *BB = Node->getBlock();
+    BoundsCheck Check;
+    if (!matchBoundsCheck(dyn_cast<BranchInst>(BB->getTerminator()), Check))
+      continue;
+
+    BoundsKey Key(SE.getSCEV(Check.Lower), SE.getSCEV(Check.Upper));
+    SmallVectorImpl<BoundsCheck> &Dominating = ChecksByBounds[Key];
+    const SCEV *PtrSCEV = SE.getSCEV(Check.Ptr);
+    bool LowerHolds = false, UpperHolds = false;
+    for (const BoundsCheck &Dom : Dominating) {
+      BasicBlock *DomBB = Dom.Branch->getParent();
+      if (!DT.dominates(BasicBlockEdge(DomBB, Dom.Branch->getSuccessor(0)),
+                        BB))
+        continue;
+
+      addImpliedComparisons(SE, Dom, SE.getSCEV(Dom.Ptr), Check, PtrSCEV,
+                            LowerHolds, UpperHolds);
+      if (LowerHolds && UpperHolds)
+        break;
+    }
+
+    if (LowerHolds && UpperHolds) {
+      LLVM_DEBUG(dbgs() << "CheckedC: removing redundant bounds check "
+                        << *Check.Branch << "\n");
+      ORE.emit([&]() {
+        return OptimizationRemark(DEBUG_TYPE, "Redundant", Check.Branch)
+               << "bounds check implied by a dominating check removed";
+      });
+      Check.Branch->setCondition(
+          ConstantInt::getTrue(Check.Branch->getContext()));
+      dropBoundsCheckMD(Check);
+      ++NumChecksEliminated;
+      Changed = true;
+      continue;
+    }
+    Dominating.push_back(Check);
+  }
+  return Changed;
+}
+
+/// Split the preheader of L and branch to the failure block of Check unless
+/// Cond holds.
+static void emitPreheaderCheck(Loop *L, const BoundsCheck &Check, Value *Cond,
+                               DominatorTree &DT, LoopInfo &LI) {
+  BasicBlock *Preheader = L->getLoopPreheader();
+  BasicBlock *FailBB = Check.Branch->getSuccessor(1);
+  BasicBlock *NewPreheader =
+      SplitBlock(Preheader, Preheader->getTerminator(), &DT, &LI);
+  NewPreheader->setName(Preheader->getName() + ".checked");
+  BranchInst *NewBr = BranchInst::Create(NewPreheader, FailBB, Cond);
+  NewBr->copyMetadata(*Check.Branch, {LLVMContext::MD_prof});
+  ReplaceInstWithInst(Preheader->getTerminator(), NewBr);
+  DT.insertEdge(Preheader, FailBB);
+}
+
+/// Try to replace the bounds check Check in loop L with a check in the loop
+/// preheader. ExitCount is the number of times the backedge of L is taken.
+static bool hoistBoundsCheck(Loop *L, const BoundsCheck &Check,
+                             const SCEV *ExitCount, DominatorTree &DT,
+                             LoopInfo &LI, ScalarEvolution &SE,
+                             OptimizationRemarkEmitter &ORE) {
+  BasicBlock *Preheader = L->getLoopPreheader();
+  if (!Preheader)
+    return false;
+
+  auto Missed = [&](StringRef Reason) {
+    ORE.emit([&]() {
+      return OptimizationRemarkMissed(DEBUG_TYPE, "NotHoisted", Check.Branch)
+             << "bounds check not hoisted out of loop: " << Reason;
+    });
+    return false;
+  };
+
+  const SCEV *LowerSCEV = SE.getSCEV(Check.Lower);
+  const SCEV *UpperSCEV = SE.getSCEV(Check.Upper);
+  if (!SE.isLoopInvariant(LowerSCEV, L) || !SE.isLoopInvariant(UpperSCEV, L))
+    return Missed("the bounds change in the loop");
+
+  const auto *AR = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(Check.Ptr));
+  if (!AR || AR->getLoop() != L || !AR->isAffine())
+    return Missed("the pointer is not an affine function of the loop "
+                  "induction variable");
+
+  const auto *Step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(SE));
+  if (!Step || Step->getAPInt().isNullValue())
+    return Missed("the pointer does not move by a constant step");
+
+  // Make sure that Step * ExitCount does not overflow. Then the pointer can
+  // wrap around the address space at most once, which the hoisted check
+  // detects by comparing the first and the last value of the pointer.
+  unsigned Bits = SE.getTypeSizeInBits(AR->getType());
+  if (SE.getTypeSizeInBits(ExitCount->getType()) > Bits)
+    return false;
+  APInt MaxCount = SE.getUnsignedRangeMax(ExitCount).zextOrSelf(Bits);
+  APInt AbsStep = Step->getAPInt().abs().zextOrTrunc(Bits);
+  bool Overflow = false;
+  (void)MaxCount.umul_ov(AbsStep, Overflow);
+  if (Overflow)
+    return Missed("the range of the pointer may overflow");
+
+  const SCEV *First = AR->getStart();
+  const SCEV *Last = AR->evaluateAtIteration(ExitCount, SE);
+
+  // For a decreasing pointer, the lowest value is the last one.
+  const SCEV *Low = First, *High = Last;
+  if (Step->getAPInt().isNegative())
+    std::swap(Low, High);
+
+  Instruction *InsertPt = Preheader->getTerminator();
+  for (const SCEV *S : {LowerSCEV, UpperSCEV, Low, High})
+    if (!isSafeToExpandAt(S, InsertPt, SE))
+      return Missed("the range cannot be computed before the loop");
+
+  LLVM_DEBUG(dbgs() << "CheckedC: hoisting bounds check " << *Check.Branch
+                    << " out of loop " << L->getHeader()->getName() << "\n");
+
+  // Emit the range check in the preheader:
+  //   (Low <= High) && (Lower <= Low) && (High < Upper)
+  // The first comparison fails if the pointer wraps around the address
+  // space. The original checks could then only succeed on every iteration if
+  // the bounds spanned almost the entire address space, so we treat this as a
+  // failed check.
+  const DataLayout &DL = Preheader->getModule()->getDataLayout();
+  SCEVExpander Expander(SE, DL, "checkedc.hoist");
+  Type *PtrTy = Check.Ptr->getType();
+  Value *LowerV = Expander.expandCodeFor(LowerSCEV, PtrTy, InsertPt);
+  Value *UpperV = Expander.expandCodeFor(UpperSCEV, PtrTy, InsertPt);
+  Value *LowV = Expander.expandCodeFor(Low, PtrTy, InsertPt);
+  Value *HighV = Expander.expandCodeFor(High, PtrTy, InsertPt);
+
+  IRBuilder<> Builder(InsertPt);
+  Value *NoWrap = Builder.CreateICmpULE(LowV, HighV, "checkedc.nowrap");
+  Value *LowerChk =
+      Check.LowerIsStrict
+          ? Builder.CreateICmpULT(LowerV, LowV, "checkedc.lower")
+          : Builder.CreateICmpULE(LowerV, LowV, "checkedc.lower");
+  Value *UpperChk =
+      Check.UpperIsStrict
+          ? Builder.CreateICmpULT(HighV, UpperV, "checkedc.upper")
+          : Builder.CreateICmpULE(HighV, UpperV, "checkedc.upper");
+  Value *Cond = Builder.CreateAnd(NoWrap, LowerChk);
+  Cond = Builder.CreateAnd(Cond, UpperChk, "checkedc.range");
+  emitPreheaderCheck(L, Check, Cond, DT, LI);
+
+  // The check inside the loop now always succeeds.
+  Check.Branch->setCondition(ConstantInt::getTrue(Check.Branch->getContext()));
+  dropBoundsCheckMD(Check);
+  ++NumChecksHoisted;
+  ORE.emit([&]() {
+    return OptimizationRemark(DEBUG_TYPE, "Hoisted", Check.Branch)
+           << "bounds check replaced by a check of the whole range before "
+              "the loop";
+  });
+  return true;
+}
+
+/// Try to replace the lower bound comparison of the bounds check Check in
+/// loop L with a check of the initial value of the pointer in the loop
+/// preheader. Check must be executed on the first iteration of L.
+static bool hoistLowerBoundCheck(Loop *L, const BoundsCheck &Check,
+                                 DominatorTree &DT, LoopInfo &LI,
+                                 ScalarEvolution &SE,
+                                 OptimizationRemarkEmitter &ORE) {
+  BasicBlock *Preheader = L->getLoopPreheader();
+  const SCEV *LowerSCEV = SE.getSCEV(Check.Lower);
+  if (!SE.isLoopInvariant(LowerSCEV, L))
+    return false;
+
+  // The pointer must increase on every iteration without wrapping around the
+  // address space. It then cannot drop below the lower bound after the first
+  // iteration. The upper bound comparisons inside the loop do not rule out a
+  // wraparound: a pointer that wraps around is below the upper bound again.
+  const auto *AR = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(Check.Ptr));
+  if (!AR || AR->getLoop() != L || !AR->isAffine() ||
+      !AR->hasNoUnsignedWrap() ||
+      !SE.isKnownPositive(AR->getStepRecurrence(SE)))
+    return false;
+
+  const SCEV *Start = AR->getStart();
+  Instruction *InsertPt = Preheader->getTerminator();
+  if (!isSafeToExpandAt(LowerSCEV, InsertPt, SE) ||
+      !isSafeToExpandAt(Start, InsertPt, SE))
+    return false;
+
+  LLVM_DEBUG(dbgs() << "CheckedC: hoisting lower bound of " << *Check.Branch
+                    << " out of loop " << L->getHeader()->getName() << "\n");
+
+  const DataLayout &DL = Preheader->getModule()->getDataLayout();
+  SCEVExpander Expander(SE, DL, "checkedc.hoist");
+  Type *PtrTy = Check.Ptr->getType();
+  Value *LowerV = Expander.expandCodeFor(LowerSCEV, PtrTy, InsertPt);
+  Value *StartV = Expander.expandCodeFor(Start, PtrTy, InsertPt);
+
+  IRBuilder<> Builder(InsertPt);
+  Value *Cond =
+      Check.LowerIsStrict
+          ? Builder.CreateICmpULT(LowerV, StartV, "checkedc.lower")
+          : Builder.CreateICmpULE(LowerV, StartV, "checkedc.lower");
+  emitPreheaderCheck(L, Check, Cond, DT, LI);
+
+  // Only the upper bound comparison remains inside the loop.
+  Check.Branch->setCondition(Check.UpperCond);
+  dropBoundsCheckMD(Check);
+  ++NumLowerChecksHoisted;
+  ORE.emit([&]() {
+    return OptimizationRemark(DEBUG_TYPE, "LowerBoundHoisted", Check.Branch)
+           << "lower bound of bounds check hoisted out of loop";
+  });
+  return true;
+}
+
+/// Hoist the lower bound comparisons of the bounds checks that are executed
+/// on the first iteration of L before anything else can happen. These are
+/// the checks on the path of unconditional branches and successful checks
+/// starting at the header of L.
+static bool hoistLowerBoundChecks(Loop *L, DominatorTree &DT, LoopInfo &LI,
+                                  ScalarEvolution &SE,
+                                  OptimizationRemarkEmitter &ORE) {
+  if (!L->getLoopPreheader())
+    return false;
+
+  SmallVector<BoundsCheck, 4> Checks;
+  SmallPtrSet<BasicBlock *, 8> Visited;
+  BasicBlock *BB = L->getHeader();
+  while (BB && L->contains(BB) && Visited.insert(BB).second) {
+    if (any_of(*BB, [](Instruction &I) {
+          return !isGuaranteedToTransferExecutionToSuccessor(&I);
+        }))
+      break;
+
+    auto *BI = dyn_cast<BranchInst>(BB->getTerminator());
+    if (!BI)
+      break;
+    // Follow unconditional branches and checks that were already removed.
+    if (BI->isUnconditional() || match(BI->getCondition(), m_One())) {
+      BB = BI->getSuccessor(0);
+      continue;
+    }
+
+    BoundsCheck Check;
+    BasicBlock *FailBB = BI->getSuccessor(1);
+    if (!matchBoundsCheck(BI, Check) || L->contains(FailBB) ||
+        !isCheckFailureBlock(FailBB))
+      break;
+    Checks.push_back(Check);
+    BB = BI->getSuccessor(0);
+  }
+
+  bool Hoisted = false;
+  for (const BoundsCheck &Check : Checks)
+    Hoisted |= hoistLowerBoundCheck(L, Check, DT, LI, SE, ORE);
+
+  if (Hoisted)
+    SE.forgetLoop(L);
+  return Hoisted;
+}
+
+/// Hoist the bounds checks in the innermost loop L.
+static bool hoistLoopBoundsChecks(Loop *L, DominatorTree &DT, LoopInfo &LI,
+                                  ScalarEvolution &SE,
+                                  OptimizationRemarkEmitter &ORE) {
+  // Only handle innermost loops. An inner loop may not terminate, in which
+  // case the checks after it in the outer loop would never be executed.
+  bool Changed = false;
+  if (!L->isInnermost())
+    return Changed;
+
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Latch || !L->getLoopPreheader()) {
+    remarkChecksNotHoisted(L, ORE, "the loop is not in simplified form");
+    return Changed;
+  }
+
+  // The loop may only leave early by failing a dynamic check.
+  SmallVector<BasicBlock *, 4> ExitingBlocks;
+  L->getExitingBlocks(ExitingBlocks);
+  for (BasicBlock *Exiting : ExitingBlocks) {
+    if (Exiting == Latch)
+      continue;
+    for (BasicBlock *Succ : successors(Exiting))
+      if (!L->contains(Succ) && !isCheckFailureBlock(Succ)) {
+        remarkChecksNotHoisted(L, ORE, "the loop may exit early");
+        return Changed;
+      }
+  }
+
+  // Every iteration must run to the latch unless a check fails.
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB)
+      if (!isGuaranteedToTransferExecutionToSuccessor(&I)) {
+        remarkChecksNotHoisted(L, ORE, "an iteration may not complete");
+        return Changed;
+      }
+
+  const SCEV *ExitCount = SE.getExitCount(L, Latch);
+  if (isa<SCEVCouldNotCompute>(ExitCount)) {
+    remarkChecksNotHoisted(L, ORE, "the trip count is unknown");
+    return Changed;
+  }
+
+  SmallVector<BoundsCheck, 4> Checks;
+  for (BasicBlock *BB : L->blocks()) {
+    BoundsCheck Check;
+    if (!matchBoundsCheck(dyn_cast<BranchInst>(BB->getTerminator()), Check))
+      continue;
+    // The check must be executed on every iteration of the loop.
+    if (!DT.dominates(BB, Latch))
+      continue;
+    BasicBlock *FailBB = Check.Branch->getSuccessor(1);
+    if (L->contains(FailBB) || !isCheckFailureBlock(FailBB))
+      continue;
+    Checks.push_back(Check);
+  }
+
+  bool Hoisted = false;
+  for (const BoundsCheck &Check : Checks)
+    Hoisted |= hoistBoundsCheck(L, Check, ExitCount, DT, LI, SE, ORE);
+
+  if (Hoisted)
+    SE.forgetLoop(L);
+  return Changed || Hoisted;
+}
+
+/// Hoist the bounds checks in L and its subloops.
+static bool hoistBoundsChecks(Loop *L, DominatorTree &DT, LoopInfo &LI,
+                              ScalarEvolution &SE,
+                              OptimizationRemarkEmitter &ORE) {
+  bool Changed = false;
+  for (Loop *SubLoop : L->getSubLoops())
+    Changed |= hoistBoundsChecks(SubLoop, DT, LI, SE, ORE);
+
+  Changed |= hoistLoopBoundsChecks(L, DT, LI, SE, ORE);
+  Changed |= hoistLowerBoundChecks(L, DT, LI, SE, ORE);
+  return Changed;
+}
+
+static bool optimizeBoundsChecks(DominatorTree &DT, LoopInfo &LI,
+                                 ScalarEvolution &SE,
+                                 OptimizationRemarkEmitter &ORE) {
+  bool Changed = eliminateRedundantChecks(DT, SE, ORE);
+  if (Changed)
+    SE.forgetAllLoops();
+  for (Loop *L : LI)
+    Changed |= hoistBoundsChecks(L, DT, LI, SE, ORE);
+  return Changed;
+}
+
+PreservedAnalyses CheckedCBoundsCheckOptPass::run(Function &F,
+                                                  FunctionAnalysisManager &AM) {
+  auto &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  auto &LI = AM.getResult<LoopAnalysis>(F);
+  auto &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+  auto &ORE = AM.getResult<OptimizationRemarkEmitterAnalysis>(F);
+
+  if (!optimizeBoundsChecks(DT, LI, SE, ORE))
+    return PreservedAnalyses::all();
+
+  PreservedAnalyses PA;
+  PA.preserve<DominatorTreeAnalysis>();
+  PA.preserve<LoopAnalysis>();
+  return PA;
+}
+
+namespace {
+class CheckedCBoundsCheckOptLegacyPass : public FunctionPass {
+public:
+  static char ID; // Pass identification
+  CheckedCBoundsCheckOptLegacyPass() : FunctionPass(ID) {
+    initializeCheckedCBoundsCheckOptLegacyPassPass(
+        *PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override {
+    if (skipFunction(F))
+      return false;
+
+    auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    auto &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    auto &SE = getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+    auto &ORE = getAnalysis<OptimizationRemarkEmitterWrapperPass>().getORE();
+    return optimizeBoundsChecks(DT, LI, SE, ORE);
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+  }
+};
+} // end anonymous namespace
+
+char CheckedCBoundsCheckOptLegacyPass::ID = 0;
+INITIALIZE_PASS_BEGIN(CheckedCBoundsCheckOptLegacyPass,
+                      "checkedc-bounds-check-opt",
+                      "Optimize Checked C bounds checks", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(OptimizationRemarkEmitterWrapperPass)
+INITIALIZE_PASS_END(CheckedCBoundsCheckOptLegacyPass,
+                    "checkedc-bounds-check-opt",
+                    "Optimize Checked C bounds checks", false, false)
+
+FunctionPass *llvm::createCheckedCBoundsCheckOptPass() {
+  return new CheckedCBoundsCheckOptLegacyPass();
+}
+
+namespace {
+
+/// The bounds checks of a function, with the analyses used to compare them
+/// with the checks of other functions. The analyses of all the functions
+/// are needed at the same time, so they are computed here rather than by a
+/// pass manager.
+struct FunctionBoundsChecks {
+  TargetLibraryInfo TLI;
+  DominatorTree DT;
+  LoopInfo LI;
+  AssumptionCache AC;
+  ScalarEvolution SE;
+  SmallVector<BoundsCheck, 4> Checks;
+
+  FunctionBoundsChecks(Function &F, const TargetLibraryInfo &TLI)
+      : TLI(TLI), DT(F), LI(DT), AC(F), SE(F, this->TLI, AC, DT, LI) {
+    for (BasicBlock &BB : F) {
+      BoundsCheck Check;
+      if (matchBoundsCheck(dyn_cast<BranchInst>(BB.getTerminator()), Check))
+        Checks.push_back(Check);
+    }
+  }
+};
+
+} // end anonymous namespace
+
+/// Rewrite S, an expression in the callee of Call whose only unknowns are
+/// arguments of the callee and constants, as an expression in the caller.
+/// Returns null if S has any other form.
+static const SCEV *rewriteForCaller(const SCEV *S, CallBase &Call,
+                                    ScalarEvolution &CallerSE) {
+  switch (S->getSCEVType()) {
+  case scConstant:
+    return CallerSE.getConstant(cast<SCEVConstant>(S)->getValue());
+  case scUnknown: {
+    Value *V = cast<SCEVUnknown>(S)->getValue();
+    if (auto *A = dyn_cast<Argument>(V))
+      return CallerSE.getSCEV(Call.getArgOperand(A->getArgNo()));
+    if (isa<Constant>(V))
+      return CallerSE.getSCEV(V);
+    return nullptr;
+  }
+  case scPtrToInt:
+  case scTruncate:
+  case scZeroExtend:
+  case scSignExtend: {
+    const auto *Cast = cast<SCEVCastExpr>(S);
+    const SCEV *Op = rewriteForCaller(Cast->getOperand(), Call, CallerSE);
+    if (!Op)
+      return nullptr;
+    Type *Ty = Cast->getType();
+    switch (S->getSCEVType()) {
+    case scPtrToInt:
+      return CallerSE.getPtrToIntExpr(Op, Ty);
+    case scTruncate:
+      return CallerSE.getTruncateExpr(Op, Ty);
+    case scZeroExtend:
+      return CallerSE.getZeroExtendExpr(Op, Ty);
+    default:
+      return CallerSE.getSignExtendExpr(Op, Ty);
+    }
+  }
+  case scAddExpr:
+  case scMulExpr: {
+    SmallVector<const SCEV *, 4> Ops;
+    for (const SCEV *Op : cast<SCEVNAryExpr>(S)->operands()) {
+      const SCEV *NewOp = rewriteForCaller(Op, Call, CallerSE);
+      if (!NewOp)
+        return nullptr;
+      Ops.push_back(NewOp);
+    }
+    return S->getSCEVType() == scAddExpr ? CallerSE.getAddExpr(Ops)
+                                         : CallerSE.getMulExpr(Ops);
+  }
+  case scUDivExpr: {
+    const auto *Div = cast<SCEVUDivExpr>(S);
+    const SCEV *LHS = rewriteForCaller(Div->getLHS(), Call, CallerSE);
+    const SCEV *RHS = rewriteForCaller(Div->getRHS(), Call, CallerSE);
+    if (!LHS || !RHS)
+      return nullptr;
+    return CallerSE.getUDivExpr(LHS, RHS);
+  }
+  default:
+    return nullptr;
+  }
+}
+
+/// Return true if the bounds check Check in the callee of Call, with bounds
+/// Lower and Upper and pointer Ptr, is implied by checks in Caller that
+/// dominate Call.
+static bool isCheckedAtCall(const BoundsCheck &Check, const SCEV *Lower,
+                            const SCEV *Ptr, const SCEV *Upper,
+                            CallBase &Call, FunctionBoundsChecks &Caller) {
+  ScalarEvolution &SE = Caller.SE;
+  const SCEV *CallerLower = rewriteForCaller(Lower, Call, SE);
+  const SCEV *CallerPtr = rewriteForCaller(Ptr, Call, SE);
+  const SCEV *CallerUpper = rewriteForCaller(Upper, Call, SE);
+  if (!CallerLower || !CallerPtr || !CallerUpper)
+    return false;
+
+  bool LowerHolds = false, UpperHolds = false;
+  for (const BoundsCheck &Dom : Caller.Checks) {
+    BasicBlock *DomBB = Dom.Branch->getParent();
+    if (!Caller.DT.dominates(
+            BasicBlockEdge(DomBB, Dom.Branch->getSuccessor(0)),
+            Call.getParent()))
+      continue;
+    if (SE.getSCEV(Dom.Lower) != CallerLower ||
+        SE.getSCEV(Dom.Upper) != CallerUpper)
+      continue;
+    addImpliedComparisons(SE, Dom, SE.getSCEV(Dom.Ptr), Check, CallerPtr,
+                          LowerHolds, UpperHolds);
+    if (LowerHolds && UpperHolds)
+      return true;
+  }
+  return false;
+}
+
+/// Remove the bounds checks of functions with local linkage that are implied
+/// by checks in all of their callers.
+static bool eliminateChecksMadeByCallers(
+    Module &M, function_ref<TargetLibraryInfo &(Function &)> GetTLI) {
+  DenseMap<Function *, std::unique_ptr<FunctionBoundsChecks>> Infos;
+  auto GetInfo = [&](Function &F) -> FunctionBoundsChecks & {
+    std::unique_ptr<FunctionBoundsChecks> &Info = Infos[&F];
+    if (!Info)
+      Info = std::make_unique<FunctionBoundsChecks>(F, GetTLI(F));
+    return *Info;
+  };
+
+  bool Changed = false;
+  for (Function &F : M) {
+    if (F.isDeclaration() || !F.hasLocalLinkage())
+      continue;
+
+    // Every use must be a direct call, so that all callers are known.
+    SmallVector<CallBase *, 4> Calls;
+    bool AllCallsKnown = true;
+    for (User *U : F.users()) {
+      auto *Call = dyn_cast<CallBase>(U);
+      if (!Call || Call->getCalledOperand() != &F ||
+          Call->getFunctionType() != F.getFunctionType()) {
+        AllCallsKnown = false;
+        break;
+      }
+      Calls.push_back(Call);
+    }
+    if (!AllCallsKnown || Calls.empty())
+      continue;
+
+    FunctionBoundsChecks &Callee = GetInfo(F);
+    for (const BoundsCheck &Check : Callee.Checks) {
+      const SCEV *Lower = Callee.SE.getSCEV(Check.Lower);
+      const SCEV *Ptr = Callee.SE.getSCEV(Check.Ptr);
+      const SCEV *Upper = Callee.SE.getSCEV(Check.Upper);
+      if (!all_of(Calls, [&](CallBase *Call) {
+            return isCheckedAtCall(Check, Lower, Ptr, Upper, *Call,
+                                   GetInfo(*Call->getFunction()));
+          }))
+        continue;
+
+      LLVM_DEBUG(dbgs() << "CheckedC: removing bounds check " << *Check.Branch
+                        << " made by all callers of " << F.getName() << "\n");
+      Check.Branch->setCondition(
+          ConstantInt::getTrue(Check.Branch->getContext()));
+      dropBoundsCheckMD(Check);
+      ++NumChecksMadeByCallers;
+      Changed = true;
+    }
+  }
+  return Changed;
+}
+
+PreservedAnalyses CheckedCIPBoundsCheckOptPass::run(Module &M,
+                                                    ModuleAnalysisManager &AM) {
+  auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  auto GetTLI = [&FAM](Function &F) -> TargetLibraryInfo & {
+    return FAM.getResult<TargetLibraryAnalysis>(F);
+  };
+
+  if (!eliminateChecksMadeByCallers(M, GetTLI))
+    return PreservedAnalyses::all();
+  return PreservedAnalyses::none();
+}
+
+namespace {
+class CheckedCIPBoundsCheckOptLegacyPass : public ModulePass {
+public:
+  static char ID; // Pass identification
+  CheckedCIPBoundsCheckOptLegacyPass() : ModulePass(ID) {
+    initializeCheckedCIPBoundsCheckOptLegacyPassPass(
+        *PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override {
+    if (skipModule(M))
+      return false;
+
+    auto GetTLI = [this](Function &F) -> TargetLibraryInfo & {
+      return getAnalysis<TargetLibraryInfoWrapperPass>().getTLI(F);
+    };
+    return eliminateChecksMadeByCallers(M, GetTLI);
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetLibraryInfoWrapperPass>();
+  }
+};
+} // end anonymous namespace
+
+char CheckedCIPBoundsCheckOptLegacyPass::ID = 0;
+INITIALIZE_PASS_BEGIN(CheckedCIPBoundsCheckOptLegacyPass,
+                      "checkedc-ip-bounds-check-opt",
+                      "Remove Checked C bounds checks made by all callers",
+                      false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
+INITIALIZE_PASS_END(CheckedCIPBoundsCheckOptLegacyPass,
+                    "checkedc-ip-bounds-check-opt",
+                    "Remove Checked C bounds checks made by all callers",
+                    false, false)
+
+ModulePass *llvm::createCheckedCIPBoundsCheckOptPass() {
+  return new CheckedCIPBoundsCheckOptLegacyPass();
+}
@@ -38,6 +38,8 @@ void llvm::initializeScalarOpts(PassRegistry &Registry) {
   initializeBDCELegacyPassPass(Registry);
   initializeAlignmentFromAssumptionsPass(Registry);
   initializeCallSiteSplittingLegacyPassPass(Registry);
+  initializeCheckedCBoundsCheckOptLegacyPassPass(Registry);
+  initializeCheckedCIPBoundsCheckOptLegacyPassPass(Registry);
   initializeConstantHoistingLegacyPassPass(Registry);
   initializeConstraintEliminationPass(Registry);
   initializeCorrelatedValuePropagationPass(Registry);
@@ -0,0 +1,132 @@
+; Test that a Checked C bounds check whose failure block calls the failure
+; handler of -fcheckedc-check-failure-handler, or another cold function that
+; does not return, is hoisted out of a loop like a check whose failure block
+; traps.
+;
+; RUN: opt -passes=checkedc-bounds-check-opt -S < %s | FileCheck %s
+
+define internal void @_Dynamic_check.failure_handler(i32 %site) noinline cold noreturn nounwind {
+entry:
+  call void @llvm.trap()
+  unreachable
+}
+
+declare void @llvm.trap()
+declare void @report_failure() cold noreturn nounwind
+declare void @may_return() cold nounwind
+declare void @exit_program() noreturn nounwind
+
+define void @handler(i32* %lo, i32* %hi, i32* %base) {
+; CHECK-LABEL: @handler(
+; CHECK: entry:
+; CHECK: %checkedc.range = and i1
+; CHECK: br i1 %checkedc.range, label %entry.checked, label %fail
+; CHECK: loop:
+; CHECK: br i1 true, label %ok, label %fail{{$}}
+; CHECK: fail:
+; CHECK-NEXT: call void @_Dynamic_check.failure_handler(i32 3)
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %ok ]
+  %p = getelementptr inbounds i32, i32* %base, i64 %i
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  store i32 0, i32* %p
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 100
+  br i1 %done, label %exit, label %loop
+
+fail:
+  call void @_Dynamic_check.failure_handler(i32 3)
+  unreachable
+
+exit:
+  ret void
+}
+
+define void @cold_noreturn(i32* %lo, i32* %hi, i32* %base) {
+; CHECK-LABEL: @cold_noreturn(
+; CHECK: entry:
+; CHECK: %checkedc.range = and i1
+; CHECK: br i1 %checkedc.range, label %entry.checked, label %fail
+; CHECK: loop:
+; CHECK: br i1 true, label %ok, label %fail{{$}}
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %ok ]
+  %p = getelementptr inbounds i32, i32* %base, i64 %i
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  store i32 0, i32* %p
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 100
+  br i1 %done, label %exit, label %loop
+
+fail:
+  call void @report_failure()
+  unreachable
+
+exit:
+  ret void
+}
+
+; A failure block that calls a function that may return, or one that is not
+; cold, is not recognized, so the check stays in the loop.
+define void @not_failure_calls(i32* %lo, i32* %hi, i32* %base) {
+; CHECK-LABEL: @not_failure_calls(
+; CHECK-NOT: checkedc.range
+; CHECK: loop:
+; CHECK: br i1 %range, label %ok, label %fail, !checkedc.bounds_check
+; CHECK: ok:
+; CHECK: br i1 %range2, label %ok2, label %fail2, !checkedc.bounds_check
+; CHECK: ret void
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %ok2 ]
+  %p = getelementptr inbounds i32, i32* %base, i64 %i
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  store i32 0, i32* %p
+  %q = getelementptr inbounds i32, i32* %p, i64 1
+  %lower2 = icmp ule i32* %lo, %q
+  %upper2 = icmp ult i32* %q, %hi
+  %range2 = and i1 %lower2, %upper2
+  br i1 %range2, label %ok2, label %fail2, !checkedc.bounds_check !0
+
+ok2:
+  store i32 0, i32* %q
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 100
+  br i1 %done, label %exit, label %loop
+
+fail:
+  call void @may_return()
+  unreachable
+
+fail2:
+  call void @exit_program()
+  unreachable
+
+exit:
+  ret void
+}
+
+!0 = !{}
@@ -0,0 +1,102 @@
+; Test that the lower bound comparison of a Checked C bounds check executed
+; on the first iteration of a loop with an unknown trip count is hoisted into
+; the loop preheader when the pointer increases without wrapping around.
+;
+; RUN: opt -passes=checkedc-bounds-check-opt -S < %s | FileCheck %s
+
+declare void @llvm.trap()
+
+; The inbounds increment of the pointer cannot wrap around.
+define void @scan(i8* %lo, i8* %hi, i8* %start) {
+; CHECK-LABEL: @scan(
+; CHECK: entry:
+; CHECK-NEXT: %checkedc.lower = icmp ule i8* %lo, %start
+; CHECK-NEXT: br i1 %checkedc.lower, label %entry.checked, label %fail
+; CHECK: loop:
+; CHECK: br i1 %upper, label %cont, label %fail{{$}}
+entry:
+  br label %loop
+
+loop:
+  %p = phi i8* [ %start, %entry ], [ %p.next, %cont ]
+  %lower = icmp ule i8* %lo, %p
+  %upper = icmp ult i8* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %cont, label %fail, !checkedc.bounds_check !0
+
+cont:
+  %c = load i8, i8* %p
+  %p.next = getelementptr inbounds i8, i8* %p, i64 1
+  %done = icmp eq i8 %c, 0
+  br i1 %done, label %exit, label %loop
+
+fail:
+  call void @llvm.trap()
+  unreachable
+
+exit:
+  ret void
+}
+
+; Without inbounds, the pointer may wrap around the address space and drop
+; below the lower bound, so the lower bound comparison stays in the loop.
+define void @may_wrap(i8* %lo, i8* %hi, i8* %start) {
+; CHECK-LABEL: @may_wrap(
+; CHECK-NOT: checkedc.lower
+; CHECK: loop:
+; CHECK: br i1 %range, label %cont, label %fail, !checkedc.bounds_check
+entry:
+  br label %loop
+
+loop:
+  %p = phi i8* [ %start, %entry ], [ %p.next, %cont ]
+  %lower = icmp ule i8* %lo, %p
+  %upper = icmp ult i8* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %cont, label %fail, !checkedc.bounds_check !0
+
+cont:
+  %c = load i8, i8* %p
+  %p.next = getelementptr i8, i8* %p, i64 1
+  %done = icmp eq i8 %c, 0
+  br i1 %done, label %exit, label %loop
+
+fail:
+  call void @llvm.trap()
+  unreachable
+
+exit:
+  ret void
+}
+
+; A decreasing pointer can drop below the lower bound on a later iteration.
+define void @decreasing(i8* %lo, i8* %hi, i8* %start) {
+; CHECK-LABEL: @decreasing(
+; CHECK-NOT: checkedc.lower
+; CHECK: loop:
+; CHECK: br i1 %range, label %cont, label %fail, !checkedc.bounds_check
+entry:
+  br label %loop
+
+loop:
+  %p = phi i8* [ %start, %entry ], [ %p.next, %cont ]
+  %lower = icmp ule i8* %lo, %p
+  %upper = icmp ult i8* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %cont, label %fail, !checkedc.bounds_check !0
+
+cont:
+  %c = load i8, i8* %p
+  %p.next = getelementptr inbounds i8, i8* %p, i64 -1
+  %done = icmp eq i8 %c, 0
+  br i1 %done, label %exit, label %loop
+
+fail:
+  call void @llvm.trap()
+  unreachable
+
+exit:
+  ret void
+}
+
+!0 = !{}
@@ -0,0 +1,116 @@
+; Test that the Checked C bounds check of a pointer that moves by a constant
+; step in a loop with a known trip count is replaced by a check of the whole
+; range in the loop preheader, guarded against the pointer wrapping around
+; the address space.
+;
+; RUN: opt -passes=checkedc-bounds-check-opt -S < %s | FileCheck %s
+
+declare void @llvm.trap()
+
+; The pointer takes the values %base, ..., %base + 99 (in elements).
+define void @hoisted(i32* %lo, i32* %hi, i32* %base) {
+; CHECK-LABEL: @hoisted(
+; CHECK: entry:
+; CHECK: %checkedc.nowrap = icmp ule i32* %base, [[LAST:%.*]]
+; CHECK: %checkedc.lower = icmp ule i32* %lo, %base
+; CHECK: %checkedc.upper = icmp ult i32* [[LAST]], %hi
+; CHECK: %checkedc.range = and i1
+; CHECK: br i1 %checkedc.range, label %entry.checked, label %fail
+; CHECK: loop:
+; CHECK: br i1 true, label %ok, label %fail{{$}}
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %ok ]
+  %p = getelementptr inbounds i32, i32* %base, i64 %i
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  store i32 0, i32* %p
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 100
+  br i1 %done, label %exit, label %loop
+
+fail:
+  call void @llvm.trap()
+  unreachable
+
+exit:
+  ret void
+}
+
+; The trip count may be as large as the address space, so the range of the
+; pointer may overflow and the check stays in the loop.
+define void @range_may_overflow(i32* %lo, i32* %hi, i32* %base, i64 %n) {
+; CHECK-LABEL: @range_may_overflow(
+; CHECK-NOT: checkedc.nowrap
+; CHECK: loop:
+; CHECK-NOT: br i1 true
+; CHECK: ret void
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %ok ]
+  %p = getelementptr inbounds i32, i32* %base, i64 %i
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  store i32 0, i32* %p
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+fail:
+  call void @llvm.trap()
+  unreachable
+
+exit:
+  ret void
+}
+
+; The loop may leave before the pointer reaches the end of its range, so
+; checking the whole range before the loop could trap where the loop does not.
+define void @early_exit(i32* %lo, i32* %hi, i32* %base) {
+; CHECK-LABEL: @early_exit(
+; CHECK-NOT: checkedc.nowrap
+; CHECK: loop:
+; CHECK: br i1 %range, label %ok, label %fail, !checkedc.bounds_check
+; CHECK: ret void
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %next ]
+  %p = getelementptr i32, i32* %base, i64 %i
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  %v = load i32, i32* %p
+  %zero = icmp eq i32 %v, 0
+  br i1 %zero, label %exit, label %next
+
+next:
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 100
+  br i1 %done, label %exit, label %loop
+
+fail:
+  call void @llvm.trap()
+  unreachable
+
+exit:
+  ret void
+}
+
+!0 = !{}
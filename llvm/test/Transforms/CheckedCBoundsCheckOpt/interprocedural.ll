@@ -0,0 +1,239 @@
+; Test that the Checked C bounds checks of an internal function are removed
+; when checks in all of its callers imply them, and only then.
+;
+; RUN: opt -passes=checkedc-ip-bounds-check-opt -S < %s | FileCheck %s
+
+@fnptr = global i32 (i32*, i32*, i32*)* null
+
+declare void @llvm.trap()
+
+; Every caller checks %p with the same bounds before the call.
+define internal i32 @checked_by_callers(i32* %lo, i32* %hi, i32* %p) {
+; CHECK-LABEL: @checked_by_callers(
+; CHECK: br i1 true, label %ok, label %fail{{$}}
+entry:
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  %v = load i32, i32* %p
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+define i32 @caller1(i32* %lo, i32* %hi, i32* %p) {
+; CHECK-LABEL: @caller1(
+; CHECK: br i1 %range, label %ok, label %fail, !checkedc.bounds_check
+entry:
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  %v = call i32 @checked_by_callers(i32* %lo, i32* %hi, i32* %p)
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+; The caller checks %q - 1 and %q + 1, which together imply a check on %q.
+define i32 @caller2(i32* %lo, i32* %hi, i32* %q) {
+entry:
+  %prev = getelementptr i32, i32* %q, i64 -1
+  %next = getelementptr i32, i32* %q, i64 1
+  %l1 = icmp ule i32* %lo, %prev
+  %u1 = icmp ult i32* %prev, %hi
+  %r1 = and i1 %l1, %u1
+  br i1 %r1, label %ok1, label %fail, !checkedc.bounds_check !0
+
+ok1:
+  %l2 = icmp ule i32* %lo, %next
+  %u2 = icmp ult i32* %next, %hi
+  %r2 = and i1 %l2, %u2
+  br i1 %r2, label %ok2, label %fail, !checkedc.bounds_check !0
+
+ok2:
+  %v = call i32 @checked_by_callers(i32* %lo, i32* %hi, i32* %q)
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+; One caller does not check the pointer before the call.
+define internal i32 @unchecked_caller(i32* %lo, i32* %hi, i32* %p) {
+; CHECK-LABEL: @unchecked_caller(
+; CHECK: br i1 %range, label %ok, label %fail, !checkedc.bounds_check
+entry:
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  %v = load i32, i32* %p
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+define i32 @caller3(i32* %lo, i32* %hi, i32* %p) {
+entry:
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  %v1 = call i32 @unchecked_caller(i32* %lo, i32* %hi, i32* %p)
+  %v2 = call i32 @unchecked_caller(i32* %lo, i32* %hi, i32* %hi)
+  %sum = add i32 %v1, %v2
+  ret i32 %sum
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+; The address of the function is taken, so not all of its callers are known.
+define internal i32 @address_taken(i32* %lo, i32* %hi, i32* %p) {
+; CHECK-LABEL: @address_taken(
+; CHECK: br i1 %range, label %ok, label %fail, !checkedc.bounds_check
+entry:
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  %v = load i32, i32* %p
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+define i32 @caller4(i32* %lo, i32* %hi, i32* %p) {
+entry:
+  store i32 (i32*, i32*, i32*)* @address_taken, i32 (i32*, i32*, i32*)** @fnptr
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  %v = call i32 @address_taken(i32* %lo, i32* %hi, i32* %p)
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+; A function that calls itself with the pointer it has just checked. Its own
+; check implies the check at the recursive call, and the external caller
+; checks the pointer too.
+define internal i32 @recursive(i32* %lo, i32* %hi, i32* %p, i32 %n) {
+; CHECK-LABEL: @recursive(
+; CHECK: br i1 true, label %ok, label %fail{{$}}
+entry:
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  %v = load i32, i32* %p
+  %more = icmp sgt i32 %n, 0
+  br i1 %more, label %recurse, label %done
+
+recurse:
+  %n.next = sub i32 %n, 1
+  %r = call i32 @recursive(i32* %lo, i32* %hi, i32* %p, i32 %n.next)
+  %sum = add i32 %v, %r
+  ret i32 %sum
+
+done:
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+define i32 @caller5(i32* %lo, i32* %hi, i32* %p, i32 %n) {
+entry:
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  %v = call i32 @recursive(i32* %lo, i32* %hi, i32* %p, i32 %n)
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+; A function that calls itself with the next pointer. Its check on %p does
+; not imply the check on %p + 1 at the recursive call.
+define internal i32 @recursive_next(i32* %lo, i32* %hi, i32* %p, i32 %n) {
+; CHECK-LABEL: @recursive_next(
+; CHECK: br i1 %range, label %ok, label %fail, !checkedc.bounds_check
+entry:
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  %v = load i32, i32* %p
+  %more = icmp sgt i32 %n, 0
+  br i1 %more, label %recurse, label %done
+
+recurse:
+  %next = getelementptr i32, i32* %p, i64 1
+  %n.next = sub i32 %n, 1
+  %r = call i32 @recursive_next(i32* %lo, i32* %hi, i32* %next, i32 %n.next)
+  %sum = add i32 %v, %r
+  ret i32 %sum
+
+done:
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+define i32 @caller6(i32* %lo, i32* %hi, i32* %p, i32 %n) {
+entry:
+  %lower = icmp ule i32* %lo, %p
+  %upper = icmp ult i32* %p, %hi
+  %range = and i1 %lower, %upper
+  br i1 %range, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  %v = call i32 @recursive_next(i32* %lo, i32* %hi, i32* %p, i32 %n)
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+!0 = !{}
@@ -0,0 +1,154 @@
+; Test that a Checked C bounds check is removed when bounds checks with the
+; same bounds that dominate it on their success edges imply its condition.
+;
+; RUN: opt -passes=checkedc-bounds-check-opt -S < %s | FileCheck %s
+
+declare void @llvm.trap()
+
+; The second check on %p repeats the first one.
+define i32 @same_pointer(i32* %lo, i32* %hi, i32* %p) {
+; CHECK-LABEL: @same_pointer(
+; CHECK: br i1 %r1, label %ok1, label %fail, !checkedc.bounds_check
+; CHECK: br i1 true, label %ok2, label %fail{{$}}
+entry:
+  %l1 = icmp ule i32* %lo, %p
+  %u1 = icmp ult i32* %p, %hi
+  %r1 = and i1 %l1, %u1
+  br i1 %r1, label %ok1, label %fail, !checkedc.bounds_check !0
+
+ok1:
+  %v1 = load i32, i32* %p
+  %l2 = icmp ule i32* %lo, %p
+  %u2 = icmp ult i32* %p, %hi
+  %r2 = and i1 %l2, %u2
+  br i1 %r2, label %ok2, label %fail, !checkedc.bounds_check !0
+
+ok2:
+  %v2 = load i32, i32* %p
+  %sum = add i32 %v1, %v2
+  ret i32 %sum
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+; The checks on %p - 1 and %p + 1 together imply the check on %p.
+define i32 @neighbours(i32* %lo, i32* %hi, i32* %p) {
+; CHECK-LABEL: @neighbours(
+; CHECK: br i1 %r1, label %ok1, label %fail, !checkedc.bounds_check
+; CHECK: br i1 %r2, label %ok2, label %fail, !checkedc.bounds_check
+; CHECK: br i1 true, label %ok3, label %fail{{$}}
+entry:
+  %prev = getelementptr i32, i32* %p, i64 -1
+  %next = getelementptr i32, i32* %p, i64 1
+  %l1 = icmp ule i32* %lo, %prev
+  %u1 = icmp ult i32* %prev, %hi
+  %r1 = and i1 %l1, %u1
+  br i1 %r1, label %ok1, label %fail, !checkedc.bounds_check !0
+
+ok1:
+  %l2 = icmp ule i32* %lo, %next
+  %u2 = icmp ult i32* %next, %hi
+  %r2 = and i1 %l2, %u2
+  br i1 %r2, label %ok2, label %fail, !checkedc.bounds_check !0
+
+ok2:
+  %l3 = icmp ule i32* %lo, %p
+  %u3 = icmp ult i32* %p, %hi
+  %r3 = and i1 %l3, %u3
+  br i1 %r3, label %ok3, label %fail, !checkedc.bounds_check !0
+
+ok3:
+  %v = load i32, i32* %p
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+; A check on %p + 1 does not imply the lower bound check on %p.
+define i32 @only_upper_implied(i32* %lo, i32* %hi, i32* %p) {
+; CHECK-LABEL: @only_upper_implied(
+; CHECK: br i1 %r1, label %ok1, label %fail, !checkedc.bounds_check
+; CHECK: br i1 %r2, label %ok2, label %fail, !checkedc.bounds_check
+entry:
+  %next = getelementptr i32, i32* %p, i64 1
+  %l1 = icmp ule i32* %lo, %next
+  %u1 = icmp ult i32* %next, %hi
+  %r1 = and i1 %l1, %u1
+  br i1 %r1, label %ok1, label %fail, !checkedc.bounds_check !0
+
+ok1:
+  %l2 = icmp ule i32* %lo, %p
+  %u2 = icmp ult i32* %p, %hi
+  %r2 = and i1 %l2, %u2
+  br i1 %r2, label %ok2, label %fail, !checkedc.bounds_check !0
+
+ok2:
+  %v = load i32, i32* %p
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+; The block of the first check dominates the second check, but its success
+; edge does not: the second check is also reached when the first one fails.
+define i32 @not_dominated_on_success(i32* %lo, i32* %hi, i32* %p) {
+; CHECK-LABEL: @not_dominated_on_success(
+; CHECK: br i1 %r1, label %join, label %slow, !checkedc.bounds_check
+; CHECK: br i1 %r2, label %ok, label %fail, !checkedc.bounds_check
+entry:
+  %l1 = icmp ule i32* %lo, %p
+  %u1 = icmp ult i32* %p, %hi
+  %r1 = and i1 %l1, %u1
+  br i1 %r1, label %join, label %slow, !checkedc.bounds_check !0
+
+slow:
+  br label %join
+
+join:
+  %l2 = icmp ule i32* %lo, %p
+  %u2 = icmp ult i32* %p, %hi
+  %r2 = and i1 %l2, %u2
+  br i1 %r2, label %ok, label %fail, !checkedc.bounds_check !0
+
+ok:
+  %v = load i32, i32* %p
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+; Checks with different bounds do not imply each other.
+define i32 @different_bounds(i32* %lo, i32* %hi, i32* %hi2, i32* %p) {
+; CHECK-LABEL: @different_bounds(
+; CHECK: br i1 %r1, label %ok1, label %fail, !checkedc.bounds_check
+; CHECK: br i1 %r2, label %ok2, label %fail, !checkedc.bounds_check
+entry:
+  %l1 = icmp ule i32* %lo, %p
+  %u1 = icmp ult i32* %p, %hi
+  %r1 = and i1 %l1, %u1
+  br i1 %r1, label %ok1, label %fail, !checkedc.bounds_check !0
+
+ok1:
+  %l2 = icmp ule i32* %lo, %p
+  %u2 = icmp ult i32* %p, %hi2
+  %r2 = and i1 %l2, %u2
+  br i1 %r2, label %ok2, label %fail, !checkedc.bounds_check !0
+
+ok2:
+  %v = load i32, i32* %p
+  ret i32 %v
+
+fail:
+  call void @llvm.trap()
+  unreachable
+}
+
+!0 = !{}
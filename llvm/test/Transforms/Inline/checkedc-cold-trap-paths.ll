@@ -0,0 +1,196 @@
+; Test that the failure blocks of Checked C dynamic checks, which the front
+; end tags with !checkedc.check_failure, and the branches to them are not
+; counted in the inline cost, so that a small function with checks is
+; inlined. Blocks that only trap without the tag are still counted.
+;
+; RUN: opt -passes=inline -inline-threshold=100 -S < %s \
+; RUN:   | FileCheck %s
+; RUN: opt -passes=inline -inline-threshold=100 \
+; RUN:   -inline-discount-cold-trap-paths=false -S < %s \
+; RUN:   | FileCheck %s --check-prefix=NODISCOUNT
+
+declare void @llvm.trap()
+
+; Each check is two compares, an and and a branch to a block of its own that
+; reports the failure.
+define i32 @checked_get(i32* %lo, i32* %hi, i32* %p) {
+entry:
+  %l0 = icmp ule i32* %lo, %p
+  %u0 = icmp ult i32* %p, %hi
+  %r0 = and i1 %l0, %u0
+  br i1 %r0, label %ok0, label %fail0
+
+ok0:
+  %p1 = getelementptr i32, i32* %p, i64 1
+  %l1 = icmp ule i32* %lo, %p1
+  %u1 = icmp ult i32* %p1, %hi
+  %r1 = and i1 %l1, %u1
+  br i1 %r1, label %ok1, label %fail1
+
+ok1:
+  %p2 = getelementptr i32, i32* %p, i64 2
+  %l2 = icmp ule i32* %lo, %p2
+  %u2 = icmp ult i32* %p2, %hi
+  %r2 = and i1 %l2, %u2
+  br i1 %r2, label %ok2, label %fail2
+
+ok2:
+  %p3 = getelementptr i32, i32* %p, i64 3
+  %l3 = icmp ule i32* %lo, %p3
+  %u3 = icmp ult i32* %p3, %hi
+  %r3 = and i1 %l3, %u3
+  br i1 %r3, label %ok3, label %fail3
+
+ok3:
+  %p4 = getelementptr i32, i32* %p, i64 4
+  %l4 = icmp ule i32* %lo, %p4
+  %u4 = icmp ult i32* %p4, %hi
+  %r4 = and i1 %l4, %u4
+  br i1 %r4, label %ok4, label %fail4
+
+ok4:
+  %p5 = getelementptr i32, i32* %p, i64 5
+  %l5 = icmp ule i32* %lo, %p5
+  %u5 = icmp ult i32* %p5, %hi
+  %r5 = and i1 %l5, %u5
+  br i1 %r5, label %ok5, label %fail5
+
+ok5:
+  %v0 = load i32, i32* %p
+  %v1 = load i32, i32* %p1
+  %v2 = load i32, i32* %p2
+  %v3 = load i32, i32* %p3
+  %v4 = load i32, i32* %p4
+  %v5 = load i32, i32* %p5
+  %s1 = add i32 %v0, %v1
+  %s2 = add i32 %s1, %v2
+  %s3 = add i32 %s2, %v3
+  %s4 = add i32 %s3, %v4
+  %s5 = add i32 %s4, %v5
+  ret i32 %s5
+
+fail0:
+  call void @llvm.trap() #0, !checkedc.check_failure !0
+  unreachable
+
+fail1:
+  call void @llvm.trap() #0, !checkedc.check_failure !0
+  unreachable
+
+fail2:
+  call void @llvm.trap() #0, !checkedc.check_failure !0
+  unreachable
+
+fail3:
+  call void @llvm.trap() #0, !checkedc.check_failure !0
+  unreachable
+
+fail4:
+  call void @llvm.trap() #0, !checkedc.check_failure !0
+  unreachable
+
+fail5:
+  call void @llvm.trap() #0, !checkedc.check_failure !0
+  unreachable
+}
+
+; The same function with failure blocks that are not tagged.
+define i32 @untagged_get(i32* %lo, i32* %hi, i32* %p) {
+entry:
+  %l0 = icmp ule i32* %lo, %p
+  %u0 = icmp ult i32* %p, %hi
+  %r0 = and i1 %l0, %u0
+  br i1 %r0, label %ok0, label %fail0
+
+ok0:
+  %p1 = getelementptr i32, i32* %p, i64 1
+  %l1 = icmp ule i32* %lo, %p1
+  %u1 = icmp ult i32* %p1, %hi
+  %r1 = and i1 %l1, %u1
+  br i1 %r1, label %ok1, label %fail1
+
+ok1:
+  %p2 = getelementptr i32, i32* %p, i64 2
+  %l2 = icmp ule i32* %lo, %p2
+  %u2 = icmp ult i32* %p2, %hi
+  %r2 = and i1 %l2, %u2
+  br i1 %r2, label %ok2, label %fail2
+
+ok2:
+  %p3 = getelementptr i32, i32* %p, i64 3
+  %l3 = icmp ule i32* %lo, %p3
+  %u3 = icmp ult i32* %p3, %hi
+  %r3 = and i1 %l3, %u3
+  br i1 %r3, label %ok3, label %fail3
+
+ok3:
+  %p4 = getelementptr i32, i32* %p, i64 4
+  %l4 = icmp ule i32* %lo, %p4
+  %u4 = icmp ult i32* %p4, %hi
+  %r4 = and i1 %l4, %u4
+  br i1 %r4, label %ok4, label %fail4
+
+ok4:
+  %p5 = getelementptr i32, i32* %p, i64 5
+  %l5 = icmp ule i32* %lo, %p5
+  %u5 = icmp ult i32* %p5, %hi
+  %r5 = and i1 %l5, %u5
+  br i1 %r5, label %ok5, label %fail5
+
+ok5:
+  %v0 = load i32, i32* %p
+  %v1 = load i32, i32* %p1
+  %v2 = load i32, i32* %p2
+  %v3 = load i32, i32* %p3
+  %v4 = load i32, i32* %p4
+  %v5 = load i32, i32* %p5
+  %s1 = add i32 %v0, %v1
+  %s2 = add i32 %s1, %v2
+  %s3 = add i32 %s2, %v3
+  %s4 = add i32 %s3, %v4
+  %s5 = add i32 %s4, %v5
+  ret i32 %s5
+
+fail0:
+  call void @llvm.trap() #0
+  unreachable
+
+fail1:
+  call void @llvm.trap() #0
+  unreachable
+
+fail2:
+  call void @llvm.trap() #0
+  unreachable
+
+fail3:
+  call void @llvm.trap() #0
+  unreachable
+
+fail4:
+  call void @llvm.trap() #0
+  unreachable
+
+fail5:
+  call void @llvm.trap() #0
+  unreachable
+}
+
+define i32 @caller(i32* %lo, i32* %hi, i32* %p) {
+; CHECK-LABEL: @caller(
+; CHECK-NOT: call i32 @checked_get(
+; CHECK: call i32 @untagged_get(
+; CHECK: ret i32
+; NODISCOUNT-LABEL: @caller(
+; NODISCOUNT: call i32 @checked_get(
+; NODISCOUNT: call i32 @untagged_get(
+; NODISCOUNT: ret i32
+  %a = call i32 @checked_get(i32* %lo, i32* %hi, i32* %p)
+  %b = call i32 @untagged_get(i32* %lo, i32* %hi, i32* %p)
+  %s = add i32 %a, %b
+  ret i32 %s
+}
+
+attributes #0 = { cold noreturn nounwind }
+
+!0 = !{}